@@ -84,6 +84,10 @@
 #include "nlua_pilot.h"
 #include "nlua_faction.h"
 #include "board.h"
+#include "perf.h"
+#include "count.h"
+#include "intern.h"
+#include "nmem.h"
 
 
 /**
@@ -117,6 +121,15 @@
 #define AI_INCLUDE      "include/" /**< Where to search for includes. */
 
 
+/*
+ * think scheduling
+ */
+#define AI_THINK_MIN       0.05 /**< Shortest idle think interval (seconds). */
+#define AI_THINK_MAX       0.50 /**< Longest idle think interval (seconds). */
+#define AI_THINK_DIST      5000. /**< Distance from player at which idle pilots
+                                      think at the longest interval. */
+
+
 /*
  * all the AI profiles
  */
@@ -136,9 +149,13 @@ extern int pilot_nstack;
  * prototypes
  */
 /* Internal C routines */
+static double ai_thinkInterval( const Pilot *p );
+static void ai_steer( Pilot *p );
 static void ai_run( lua_State *L, const char *funcname );
 static int ai_loadProfile( const char* filename );
+static Task* ai_taskAlloc (void);
 static void ai_freetask( Task* t );
+static const struct AISensor_* ai_sensorGet( const Pilot *t );
 static void ai_setMemory (void);
 static void ai_create( Pilot* pilot, char *param );
 static int ai_loadEquip (void);
@@ -169,6 +186,7 @@ static int aiL_armour( lua_State *L ); /* armour() */
 static int aiL_shield( lua_State *L ); /* shield() */
 static int aiL_parmour( lua_State *L ); /* parmour() */
 static int aiL_pshield( lua_State *L ); /* pshield() */
+static int aiL_getstatus( lua_State *L ); /* table status( [number], [table] ) */
 static int aiL_getdistance( lua_State *L ); /* number getdist(Vector2d) */
 static int aiL_getpos( lua_State *L ); /* getpos(number) */
 static int aiL_minbrakedist( lua_State *L ); /* number minbrakedist( [number] ) */
@@ -200,6 +218,13 @@ static int aiL_getlandplanet( lua_State *L ); /* Vec2 getlandplanet() */
 static int aiL_hyperspace( lua_State *L ); /* [number] hyperspace() */
 static int aiL_stop( lua_State *L ); /* stop() */
 static int aiL_relvel( lua_State *L ); /* relvel( number ) */
+static int aiL_sensor( lua_State *L ); /* dist, bearing, relvel sensor( number ) */
+
+/* steering behaviors */
+static int aiL_pursue( lua_State *L ); /* pursue( number, number ) */
+static int aiL_orbit( lua_State *L ); /* orbit( number, number ) */
+static int aiL_evade( lua_State *L ); /* evade( number ) */
+static int aiL_steeroff( lua_State *L ); /* steeroff() */
 
 /* escorts */
 static int aiL_e_attack( lua_State *L ); /* bool e_attack() */
@@ -261,6 +286,7 @@ static const luaL_reg aiL_methods[] = {
    { "shield", aiL_shield },
    { "parmour", aiL_parmour },
    { "pshield", aiL_pshield },
+   { "status", aiL_getstatus },
    { "dist", aiL_getdistance },
    { "pos", aiL_getpos },
    { "minbrakedist", aiL_minbrakedist },
@@ -280,6 +306,12 @@ static const luaL_reg aiL_methods[] = {
    { "stop", aiL_stop },
    { "hyperspace", aiL_hyperspace },
    { "relvel", aiL_relvel },
+   { "sensor", aiL_sensor },
+   /* steering behaviors */
+   { "pursue", aiL_pursue },
+   { "orbit", aiL_orbit },
+   { "evade", aiL_evade },
+   { "steeroff", aiL_steeroff },
    /* escorts */
    { "e_attack", aiL_e_attack },
    { "e_hold", aiL_e_hold },
@@ -317,6 +349,45 @@ static const luaL_reg aiL_methods[] = {
 
 
 
+/*
+ * Tasks come out of a slab pool with a free list - combat AI pushes and
+ *  pops tasks constantly across the whole pilot stack, so behaviour
+ *  switches never hit the allocator.  Task names are interned, so they
+ *  are never copied or freed and compare by pointer.
+ */
+#define TASK_SLAB_SIZE  128 /**< Tasks per allocation slab. */
+/**
+ * @brief A slot in a task slab - a live task or a free list link.
+ */
+typedef union TaskSlot_ {
+   Task t; /**< Actual task data when in use. */
+   union TaskSlot_ *next; /**< Next free slot when unused. */
+} TaskSlot;
+static TaskSlot **task_slabs = NULL; /**< All the allocated slabs. */
+static int task_nslabs = 0; /**< Number of allocated slabs. */
+static TaskSlot *task_slotfree = NULL; /**< Head of the free slot list. */
+
+
+/*
+ * Per-think sensor snapshot.  Scripts query distance, bearing and
+ *  closure rate against the same target several times in one think, so
+ *  the derived values are computed once per target and memoized until
+ *  the next ai_setPilot().
+ */
+#define AI_SENSOR_MAX   8 /**< Targets remembered per think. */
+/**
+ * @brief Memoized sensor readings against one target.
+ */
+typedef struct AISensor_ {
+   unsigned int id; /**< Target pilot ID. */
+   double dist; /**< Distance to the target. */
+   double bearing; /**< Absolute direction towards the target. */
+   double relvel; /**< Rate the range changes, > 0 means opening. */
+} AISensor;
+static AISensor ai_sensors[AI_SENSOR_MAX]; /**< Sensor memo entries. */
+static int ai_nsensors = 0; /**< Number of memoized targets. */
+
+
 /*
  * current pilot "thinking" and assorted variables
  */
@@ -365,10 +436,50 @@ static void ai_setMemory (void)
 void ai_setPilot( Pilot *p )
 {
    cur_pilot = p;
+   ai_nsensors = 0; /* readings belong to the previous pilot */
    ai_setMemory();
 }
 
 
+/**
+ * @brief Gets the memoized sensor readings against a target.
+ *
+ * Computes the snapshot on the first query of a think and reuses it for
+ *  every later query against the same target.
+ *
+ *    @param t Target to get the readings against.
+ *    @return The sensor readings.
+ */
+static const AISensor* ai_sensorGet( const Pilot *t )
+{
+   int i;
+   AISensor *s;
+   Vector2d pv, vv;
+
+   for (i=0; i<ai_nsensors; i++)
+      if (ai_sensors[i].id == t->id)
+         return &ai_sensors[i];
+
+   /* Reuse the last slot when full - more targets per think than slots
+    *  would be most unusual. */
+   if (ai_nsensors < AI_SENSOR_MAX)
+      ai_nsensors++;
+   s = &ai_sensors[ ai_nsensors-1 ];
+
+   vect_cset( &pv, t->solid->pos.x - cur_pilot->solid->pos.x,
+         t->solid->pos.y - cur_pilot->solid->pos.y );
+   vect_cset( &vv, t->solid->vel.x - cur_pilot->solid->vel.x,
+         t->solid->vel.y - cur_pilot->solid->vel.y );
+
+   s->id      = t->id;
+   s->dist    = VMOD(pv);
+   s->bearing = VANGLE(pv);
+   s->relvel  = vect_dot( &pv, &vv ) / MAX( s->dist, 1. ); /* avoid /0 */
+
+   return s;
+}
+
+
 /**
  * @brief Attempts to run a function.
  *
@@ -388,6 +499,7 @@ static void ai_run( lua_State *L, const char *funcname )
    }
 #endif /* DEBUGGING */
 
+   COUNT_INC( COUNT_LUA );
    if (lua_pcall(L, 0, 0, 0)) { /* error has occured */
       WARN("Pilot '%s' ai -> '%s': %s", cur_pilot->name, funcname, lua_tostring(L,-1));
       lua_pop(L,1);
@@ -405,7 +517,7 @@ static void ai_run( lua_State *L, const char *funcname )
  */
 int ai_pinit( Pilot *p, const char *ai )
 {
-   int i, n;
+   int i, n, m;
    AI_Profile *prof;
    lua_State *L;
    char buf[PATH_MAX], param[PATH_MAX];
@@ -443,9 +555,21 @@ int ai_pinit( Pilot *p, const char *ai )
    p->fuel  = (RNG_2SIGMA()/4. + 0.5) * (p->fuel_max - HYPERSPACE_FUEL);
    p->fuel += HYPERSPACE_FUEL;
 
-   /* Adds a new pilot memory in the memory table. */
+   /* Adds a new pilot memory in the memory table, reusing a recycled
+    * table from the pool when one is available. */
    lua_getglobal(L, "pilotmem"); /* pm */
-   lua_newtable(L);              /* pm, nt */
+   lua_getglobal(L, "memfree");  /* pm, mf */
+   m = (int) lua_objlen(L,-1);
+   if (m > 0) {
+      lua_rawgeti(L,-1,m);       /* pm, mf, nt */
+      lua_pushnil(L);            /* pm, mf, nt, nil */
+      lua_rawseti(L,-3,m);       /* pm, mf, nt */
+      lua_remove(L,-2);          /* pm, nt */
+   }
+   else {
+      lua_pop(L,1);              /* pm */
+      lua_newtable(L);           /* pm, nt */
+   }
    lua_pushnumber(L, p->id);     /* pm, nt, n */
    lua_pushvalue(L,-2);          /* pm, nt, n, nt */
    lua_settable(L,-4);           /* pm, nt */
@@ -477,15 +601,40 @@ int ai_pinit( Pilot *p, const char *ai )
  */
 void ai_destroy( Pilot* p )
 {
+   int m;
    lua_State *L;
    L = p->ai->L;
 
-   /* Get rid of pilot's memory. */
-   lua_getglobal(L, "pilotmem");
-   lua_pushnumber(L, p->id);
-   lua_pushnil(L);
-   lua_settable(L,-3);
-   lua_pop(L,1);
+   /* Get rid of pilot's memory, recycling the table into the pool
+    * instead of feeding it to the garbage collector. */
+   lua_getglobal(L, "pilotmem"); /* pm */
+   lua_pushnumber(L, p->id);     /* pm, id */
+   lua_gettable(L,-2);           /* pm, t */
+   if (lua_istable(L,-1)) {
+      /* Wipe the keys so the next owner starts clean.  Clearing the
+       * current field during traversal is explicitly allowed. */
+      lua_pushnil(L);               /* pm, t, nil */
+      while (lua_next(L,-2) != 0) { /* pm, t, k, v */
+         lua_pop(L,1);              /* pm, t, k */
+         lua_pushvalue(L,-1);       /* pm, t, k, k */
+         lua_pushnil(L);            /* pm, t, k, k, nil */
+         lua_settable(L,-4);        /* pm, t, k */
+      }                             /* pm, t */
+
+      /* Push it onto the pool. */
+      lua_getglobal(L, "memfree");  /* pm, t, mf */
+      m = (int) lua_objlen(L,-1);
+      lua_pushvalue(L,-2);          /* pm, t, mf, t */
+      lua_rawseti(L,-2,m+1);        /* pm, t, mf */
+      lua_pop(L,1);                 /* pm, t */
+   }
+   lua_pop(L,1);                 /* pm */
+
+   /* Unlink it from the pilot. */
+   lua_pushnumber(L, p->id);     /* pm, id */
+   lua_pushnil(L);               /* pm, id, nil */
+   lua_settable(L,-3);           /* pm */
+   lua_pop(L,1);                 /* */
 
    /* Clean up tasks. */
    if (p->task)
@@ -501,35 +650,31 @@ void ai_destroy( Pilot* p )
  */
 int ai_init (void)
 {
-   char** files;
+   const char** files;
    uint32_t nfiles, i;
-   char path[PATH_MAX];
    int flen, suflen;
 
-   /* get the file list */
-   files = ndata_list( AI_PREFIX, &nfiles );
+   /* get the file list, a borrowed slice with full paths */
+   files = ndata_listPrefix( AI_PREFIX, &nfiles );
 
    /* load the profiles */
    suflen = strlen(AI_SUFFIX);
    for (i=0; i<nfiles; i++) {
+      /* Skip subdirectories like the includes. */
+      if (strchr( &files[i][strlen(AI_PREFIX)], '/' ) != NULL)
+         continue;
+
       flen = strlen(files[i]);
       if ((flen > suflen) &&
             strncmp(&files[i][flen-suflen], AI_SUFFIX, suflen)==0) {
 
-         snprintf( path, PATH_MAX, AI_PREFIX"%s", files[i] );
-         if (ai_loadProfile(path)) /* Load the profile */
-            WARN("Error loading AI profile '%s'", path);
+         if (ai_loadProfile(files[i])) /* Load the profile */
+            WARN("Error loading AI profile '%s'", files[i]);
       }
-
-      /* Clean up. */
-      free(files[i]);
    }
 
    DEBUG("Loaded %d AI Profile%c", nprofiles, (nprofiles==1)?' ':'s');
 
-   /* More clean up. */
-   free(files);
-
    /* Load equipment thingy. */
    return ai_loadEquip();
 }
@@ -575,8 +720,6 @@ static int ai_loadEquip (void)
  */
 static int ai_loadProfile( const char* filename )
 {
-   char* buf = NULL;
-   uint32_t bufsize = 0;
    lua_State *L;
 
    profiles = realloc( profiles, sizeof(AI_Profile)*(++nprofiles) );
@@ -613,6 +756,10 @@ static int ai_loadProfile( const char* filename )
    lua_newtable(L);
    lua_setglobal(L, "pilotmem");
 
+   /* Pool of memory tables recycled from dead pilots. */
+   lua_newtable(L);
+   lua_setglobal(L, "memfree");
+
    /* Set "mem" to be default template. */
    lua_getglobal(L, "pilotmem"); /* pm */
    lua_newtable(L);              /* pm, nt */
@@ -623,15 +770,13 @@ static int ai_loadProfile( const char* filename )
    lua_pop(L,1);                 /* */
 
    /* now load the file since all the functions have been previously loaded */
-   buf = ndata_read( filename, &bufsize );
-   if (luaL_dobuffer(L, buf, bufsize, filename) != 0) {
+   if (nlua_dofileCached(L, filename) != 0) {
       ERR("Error loading AI file: %s\n"
           "%s\n"
           "Most likely Lua file has improper syntax, please check",
             filename, lua_tostring(L,-1));
       return -1;
    }
-   free(buf);
 
    return 0;
 }
@@ -666,9 +811,109 @@ void ai_exit (void)
    int i;
    for (i=0; i<nprofiles; i++) {
       free(profiles[i].name);
-      lua_close(profiles[i].L);
+      nlua_freeState(profiles[i].L);
    }
    free(profiles);
+
+   /* Task slabs. */
+   for (i=0; i<task_nslabs; i++) {
+      free(task_slabs[i]);
+      nmem_count( MEM_PILOT, TASK_SLAB_SIZE * sizeof(TaskSlot), -1 );
+   }
+   free(task_slabs);
+   task_slabs    = NULL;
+   task_nslabs   = 0;
+   task_slotfree = NULL;
+}
+
+
+/**
+ * @brief Gets how long a pilot may wait until its next think.
+ *
+ * Pilots in combat think every tick, idle pilots think at an interval
+ *  that grows with distance from the player.
+ *
+ *    @param p Pilot to get the think interval of.
+ *    @return Seconds until the pilot should think again.
+ */
+static double ai_thinkInterval( const Pilot *p )
+{
+   double dist;
+
+   /* Fighting pilots and missile targets need to react every tick. */
+   if (pilot_isFlag(p, PILOT_COMBAT) || (p->lockons > 0))
+      return 0.;
+
+   /* Idle pilots think less the farther they are from the player. */
+   if (player != NULL) {
+      dist = vect_dist( &p->solid->pos, &player->solid->pos );
+      return CLAMP( AI_THINK_MIN, AI_THINK_MAX,
+            dist / AI_THINK_DIST * AI_THINK_MAX );
+   }
+
+   return AI_THINK_MIN;
+}
+
+
+/**
+ * @brief Flies the pilot's active C-side steering behavior.
+ *
+ * Runs every frame, including the frames where the Lua brain is asleep,
+ *  so routine chasing/orbiting/fleeing costs zero Lua.  The behavior is
+ *  set once from a task via ai.pursue()/ai.orbit()/ai.evade() and keeps
+ *  flying the ship until cleared or its target dies.
+ *
+ *    @param p Pilot to steer.
+ */
+static void ai_steer( Pilot *p )
+{
+   Pilot *t;
+   double dist, dir, diff, lead;
+
+   if (p->steer == PILOT_STEER_NONE)
+      return;
+
+   /* Behavior dies with its target. */
+   t = pilot_get( p->steer_target );
+   if (t == NULL) {
+      p->steer = PILOT_STEER_NONE;
+      pilot_setThrust( p, 0. );
+      return;
+   }
+
+   dist = vect_dist( &p->solid->pos, &t->solid->pos );
+
+   switch (p->steer) {
+      case PILOT_STEER_PURSUE:
+         /* Lead the target by roughly the time needed to reach it. */
+         lead = (p->speed > 0.) ? MIN( 2., dist / p->speed ) : 0.;
+         dir  = atan2(
+               VY(t->solid->pos) + VY(t->solid->vel)*lead - VY(p->solid->pos),
+               VX(t->solid->pos) + VX(t->solid->vel)*lead - VX(p->solid->pos) );
+         diff = pilot_face( p, dir );
+         pilot_setThrust( p,
+               ((dist > p->steer_dist) && (ABS(diff) < M_PI/6.)) ? 1. : 0. );
+         break;
+
+      case PILOT_STEER_ORBIT:
+         /* Fly the tangent, bent in or out by the radius error. */
+         dir  = vect_angle( &t->solid->pos, &p->solid->pos ) + M_PI/2.;
+         dir += CLAMP( -M_PI/3., M_PI/3.,
+               (dist - p->steer_dist) / MAX( p->steer_dist, 1. ) );
+         diff = pilot_face( p, dir );
+         pilot_setThrust( p, (ABS(diff) < M_PI/4.) ? 1. : 0. );
+         break;
+
+      case PILOT_STEER_EVADE:
+         /* Straight away from the threat. */
+         dir  = vect_angle( &t->solid->pos, &p->solid->pos );
+         diff = pilot_face( p, dir );
+         pilot_setThrust( p, (ABS(diff) < M_PI/6.) ? 1. : 0. );
+         break;
+
+      default:
+         break;
+   }
 }
 
 
@@ -679,10 +924,19 @@ void ai_exit (void)
  */
 void ai_think( Pilot* pilot, const double dt )
 {
-   (void) dt;
-
    lua_State *L;
 
+   /* Scheduler - spreads the Lua cost across frames.  Between thinks the
+    * pilot just keeps integrating its last turn/thrust commands. */
+   pilot->tthink -= dt;
+   if (pilot->tthink > 0.) {
+      ai_steer( pilot ); /* Behaviors keep flying while the brain sleeps. */
+      return;
+   }
+   pilot->tthink = ai_thinkInterval( pilot );
+
+   PERF_BEGIN(PERF_AI);
+
    ai_setPilot(pilot);
    L = cur_pilot->ai->L; /* set the AI profile to the current pilot's */
 
@@ -713,6 +967,9 @@ void ai_think( Pilot* pilot, const double dt )
    pilot_setTurn( cur_pilot, pilot_turn );
    pilot_setThrust( cur_pilot, pilot_acc );
 
+   /* An active steering behavior overrides the manual flying commands. */
+   ai_steer( cur_pilot );
+
    /* fire weapons if needed */
    if (ai_isFlag(AI_PRIMARY))
       pilot_shoot(cur_pilot, pilot_firemode); /* primary */
@@ -722,6 +979,8 @@ void ai_think( Pilot* pilot, const double dt )
    /* other behaviours. */
    if (ai_isFlag(AI_DISTRESS))
       pilot_distress(cur_pilot, aiL_distressmsg, 0);
+
+   PERF_END(PERF_AI);
 }
 
 
@@ -739,6 +998,9 @@ void ai_attacked( Pilot* attacked, const unsigned int attacker )
    if (attacked->ai == NULL)
       return;
 
+   /* Getting shot at is a good reason to think right away. */
+   attacked->tthink = 0.;
+
    ai_setPilot(attacked);
    L = cur_pilot->ai->L;
    lua_getglobal(L, "attacked");
@@ -761,9 +1023,9 @@ void ai_refuel( Pilot* refueler, unsigned int target )
    Task *t;
 
    /* Create the task. */
-   t = malloc(sizeof(Task));
+   t = ai_taskAlloc();
    t->next     = NULL;
-   t->name     = strdup("refuel");
+   t->name     = str_intern("refuel");
    t->dtype    = TYPE_INT;
    t->dat.num  = target;
 
@@ -874,19 +1136,54 @@ static void ai_create( Pilot* pilot, char *param )
  * internal use C functions
  */
 /**
- * @brief Frees an AI task.
+ * @brief Allocates a task from the slab pool.
+ *
+ *    @return The newly allocated task.
+ */
+static Task* ai_taskAlloc (void)
+{
+   int i;
+   TaskSlot *slab, *slot;
+
+   /* Grow by a slab when the free list runs out. */
+   if (task_slotfree == NULL) {
+      slab = malloc( TASK_SLAB_SIZE * sizeof(TaskSlot) );
+      task_nslabs++;
+      task_slabs = realloc( task_slabs, task_nslabs * sizeof(TaskSlot*) );
+      task_slabs[ task_nslabs-1 ] = slab;
+      nmem_count( MEM_PILOT, TASK_SLAB_SIZE * sizeof(TaskSlot), +1 );
+
+      /* Chain the slots in reverse so they pop in ascending address order. */
+      for (i=TASK_SLAB_SIZE-1; i>=0; i--) {
+         slab[i].next  = task_slotfree;
+         task_slotfree = &slab[i];
+      }
+   }
+
+   slot = task_slotfree;
+   task_slotfree = slot->next;
+   return &slot->t;
+}
+
+
+/**
+ * @brief Returns an AI task (and whatever it chains to) to the slab pool.
  *
  *    @param t Task to free.
  */
 static void ai_freetask( Task* t )
 {
+   TaskSlot *slot;
+
    if (t->next != NULL) {
       ai_freetask(t->next); /* yay recursive freeing */
       t->next = NULL;
    }
 
-   if (t->name) free(t->name);
-   free(t);
+   /* Name is interned, nothing to free. */
+   slot = (TaskSlot*) t;
+   slot->next = task_slotfree;
+   task_slotfree = slot;
 }
 
 
@@ -923,9 +1220,9 @@ static int aiL_pushtask( lua_State *L )
    pos   = luaL_checkint(L,1);
    func  = luaL_checkstring(L,2);
 
-   t = malloc(sizeof(Task));
+   t = ai_taskAlloc();
    t->next = NULL;
-   t->name = strdup(func);
+   t->name = str_intern(func);
    t->dtype = TYPE_NULL;
 
    if (lua_gettop(L) > 2) {
@@ -943,6 +1240,8 @@ static int aiL_pushtask( lua_State *L )
    else { /* default put at the beginning */
       t->next = cur_pilot->task;
       cur_pilot->task = t;
+      /* Steering behaviors are task scoped. */
+      cur_pilot->steer = PILOT_STEER_NONE;
    }
 
    return 0;
@@ -967,6 +1266,9 @@ static int aiL_poptask( lua_State *L )
    cur_pilot->task = t->next;
    t->next = NULL;
    ai_freetask(t);
+
+   /* Steering behaviors are task scoped. */
+   cur_pilot->steer = PILOT_STEER_NONE;
    return 0;
 }
 
@@ -1134,6 +1436,62 @@ static int aiL_pshield( lua_State *L )
    return 1;
 } 
 
+/*
+ * gets a whole status snapshot in one call
+ *
+ * Attack scripts poll armour, shield, energy, position, velocity and
+ *  target distance individually every think, each a separate C call.
+ *  Bundling them cuts the boundary crossings; pass the table back in
+ *  to refill it instead of allocating a new one every tick.
+ *
+ * status( [target id], [table] )
+ */
+static int aiL_getstatus( lua_State *L )
+{
+   Pilot *t;
+   int tbl;
+
+   /* Optional target pilot for the dist field. */
+   t = NULL;
+   if (lua_isnumber(L,1)) {
+      t = pilot_get((unsigned int)lua_tonumber(L,1));
+      if (t==NULL) {
+         NLUA_ERROR(L, "Pilot ID does not belong to a pilot.");
+         return 0;
+      }
+   }
+
+   /* Reuse the caller's table when given. */
+   if (lua_istable(L,1))
+      tbl = 1;
+   else if (lua_istable(L,2))
+      tbl = 2;
+   else
+      tbl = 0;
+   if (tbl != 0)
+      lua_pushvalue(L,tbl);
+   else
+      lua_createtable(L, 0, 6);
+
+   lua_pushnumber(L, cur_pilot->armour);
+   lua_setfield(L, -2, "armour");
+   lua_pushnumber(L, cur_pilot->shield);
+   lua_setfield(L, -2, "shield");
+   lua_pushnumber(L, cur_pilot->energy);
+   lua_setfield(L, -2, "energy");
+   lua_pushlightuserdata(L, &cur_pilot->solid->pos);
+   lua_setfield(L, -2, "pos");
+   lua_pushlightuserdata(L, &cur_pilot->solid->vel);
+   lua_setfield(L, -2, "vel");
+   if (t != NULL)
+      lua_pushnumber(L, vect_dist(&t->solid->pos, &cur_pilot->solid->pos));
+   else
+      lua_pushnil(L);
+   lua_setfield(L, -2, "dist");
+
+   return 1;
+}
+
 /*
  * gets the distance from the pointer
  */
@@ -1142,7 +1500,6 @@ static int aiL_getdistance( lua_State *L )
    Vector2d *v;
    LuaVector *lv;
    Pilot *pilot;
-   unsigned int n;
 
    NLUA_MIN_ARGS(1);
 
@@ -1155,17 +1512,17 @@ static int aiL_getdistance( lua_State *L )
    else if (lua_islightuserdata(L,1))
       v = lua_touserdata(L,1);
    
-   /* pilot id as parameter */
+   /* pilot id as parameter - memoized for the rest of the think */
    else if (lua_isnumber(L,1)) {
-      n = (unsigned int) lua_tonumber(L,1);
       pilot = pilot_get( (unsigned int) lua_tonumber(L,1) );
-      if (pilot==NULL) { 
+      if (pilot==NULL) {
          NLUA_ERROR(L, "Pilot ID does not belong to a pilot.");
          return 0;
       }
-      v = &pilot->solid->pos;
+      lua_pushnumber(L, ai_sensorGet(pilot)->dist);
+      return 1;
    }
-   
+
    /* wrong parameter */
    else
       NLUA_INVALID_PARAMETER();
@@ -1743,9 +2100,7 @@ static int aiL_hyperspace( lua_State *L )
 static int aiL_relvel( lua_State *L )
 {
    unsigned int id;
-   double dot, mod;
    Pilot *p;
-   Vector2d vv, pv;
 
    id = luaL_checklong(L,1);
    p = pilot_get(id);
@@ -1754,18 +2109,114 @@ static int aiL_relvel( lua_State *L )
       return 0;
    }
 
-   /* Get the projection of target on current velocity. */
-   vect_cset( &vv, p->solid->vel.x - cur_pilot->solid->vel.x,
-         p->solid->vel.y - cur_pilot->solid->vel.y );
-   vect_cset( &pv, p->solid->pos.x - cur_pilot->solid->pos.x,
-         p->solid->pos.y - cur_pilot->solid->pos.y );
-   dot = vect_dot( &pv, &vv );
-   mod = MAX(VMOD(pv), 1.); /* Avoid /0. */
-   
-   lua_pushnumber(L, dot / mod );
+   /* Projection of the relative velocity on the line of sight,
+    *  memoized for the rest of the think. */
+   lua_pushnumber(L, ai_sensorGet(p)->relvel );
    return 1;
 }
 
+/*
+ * gets the whole sensor snapshot against a target in one call
+ *
+ * dist, bearing, relvel = ai.sensor( id )
+ */
+static int aiL_sensor( lua_State *L )
+{
+   unsigned int id;
+   Pilot *p;
+   const AISensor *s;
+
+   id = luaL_checklong(L,1);
+   p = pilot_get(id);
+   if (p==NULL) {
+      NLUA_ERROR(L, "Pilot ID does not belong to a pilot.");
+      return 0;
+   }
+
+   s = ai_sensorGet(p);
+   lua_pushnumber(L, s->dist);
+   lua_pushnumber(L, s->bearing);
+   lua_pushnumber(L, s->relvel);
+   return 3;
+}
+
+/*
+ * starts a C-side pursue behavior - chases the target, cutting thrust
+ *  within range.  Flown every frame without the Lua until cleared,
+ *  the target dies or the task changes.
+ *
+ * pursue( id, range )
+ */
+static int aiL_pursue( lua_State *L )
+{
+   unsigned int id;
+
+   id = luaL_checklong(L,1);
+   if (pilot_get(id) == NULL) {
+      NLUA_ERROR(L, "Pilot ID does not belong to a pilot.");
+      return 0;
+   }
+
+   cur_pilot->steer        = PILOT_STEER_PURSUE;
+   cur_pilot->steer_target = id;
+   cur_pilot->steer_dist   = MAX( 0., luaL_optnumber(L,2,0.) );
+   return 0;
+}
+
+/*
+ * starts a C-side orbit behavior - circles the target at radius
+ *
+ * orbit( id, radius )
+ */
+static int aiL_orbit( lua_State *L )
+{
+   NLUA_MIN_ARGS(2);
+   unsigned int id;
+
+   id = luaL_checklong(L,1);
+   if (pilot_get(id) == NULL) {
+      NLUA_ERROR(L, "Pilot ID does not belong to a pilot.");
+      return 0;
+   }
+
+   cur_pilot->steer        = PILOT_STEER_ORBIT;
+   cur_pilot->steer_target = id;
+   cur_pilot->steer_dist   = MAX( 1., luaL_checknumber(L,2) );
+   return 0;
+}
+
+/*
+ * starts a C-side evade behavior - runs straight away from the threat
+ *
+ * evade( id )
+ */
+static int aiL_evade( lua_State *L )
+{
+   unsigned int id;
+
+   id = luaL_checklong(L,1);
+   if (pilot_get(id) == NULL) {
+      NLUA_ERROR(L, "Pilot ID does not belong to a pilot.");
+      return 0;
+   }
+
+   cur_pilot->steer        = PILOT_STEER_EVADE;
+   cur_pilot->steer_target = id;
+   cur_pilot->steer_dist   = 0.;
+   return 0;
+}
+
+/*
+ * clears any active steering behavior, handing flying back to the Lua
+ */
+static int aiL_steeroff( lua_State *L )
+{
+   (void) L; /* avoid gcc warning */
+
+   cur_pilot->steer = PILOT_STEER_NONE;
+   return 0;
+}
+
 /*
  * completely stops the pilot if it is below minimum vel error (no instastops)
  */
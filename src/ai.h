@@ -35,7 +35,7 @@ typedef enum TaskData_ { TYPE_NULL, TYPE_INT } TaskData;
  */
 typedef struct Task_ {
    struct Task_* next; /**< Next task */
-   char *name; /**< Task name. */
+   const char *name; /**< Task name, interned so it compares by pointer. */
    
    TaskData dtype; /**< Data type. */
    union {
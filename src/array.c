@@ -4,17 +4,37 @@
 #include <string.h>
 #include <stdio.h>
 
-void *_array_create_helper(size_t e_size)
+void *_array_create_size_helper(size_t e_size, int n)
 {
-   _private_container *c = malloc(sizeof(_private_container) - 1 + e_size);
+   _private_container *c;
+   if (n < 1)
+      n = 1;
+   c = malloc(sizeof(_private_container) - 1 + e_size * n);
 #ifdef DEBUGGING
    c->_sentinel = SENTINEL;
 #endif
-   c->_reserved = 1;
+   c->_reserved = n;
    c->_size = 0;
    return c->_array;
 }
 
+void *_array_create_helper(size_t e_size)
+{
+   /* Starting with a few elements reserved skips the initial ladder of
+    * tiny reallocs that doubling from one produces. */
+   return _array_create_size_helper(e_size, 8);
+}
+
+void _array_reserve_helper(void **a, size_t e_size, int n)
+{
+   _private_container *c = _array_private_container(*a);
+   if (n <= c->_reserved)
+      return;
+   c = realloc(c, sizeof(_private_container) - 1 + e_size * n);
+   c->_reserved = n;
+   *a = c->_array;
+}
+
 void *_array_grow_helper(void **a, size_t e_size) {
    _private_container *c = _array_private_container(*a);
    if (c->_size == c->_reserved) {
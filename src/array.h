@@ -28,7 +28,9 @@ typedef struct {
 
 
 void *_array_create_helper(size_t e_size);
+void *_array_create_size_helper(size_t e_size, int n);
 void *_array_grow_helper(void **a, size_t e_size);
+void _array_reserve_helper(void **a, size_t e_size, int n);
 void _array_shrink_helper(void **a, size_t e_size);
 void _array_free_helper(void *a);
 
@@ -55,11 +57,20 @@ __inline__ static void *_array_end_helper(void *a, size_t e_size)
 /** @brief Creates a new dynamic array of `basic_type' */
 #define array_create(basic_type) \
       ((basic_type *)(_array_create_helper(sizeof(basic_type))))
+/** @brief Creates a new dynamic array of `basic_type' with `n' elements reserved */
+#define array_create_size(basic_type, n) \
+      ((basic_type *)(_array_create_size_helper(sizeof(basic_type), (n))))
 
 /** @brief Increases the number of elements by one and returns the last element.
  * NOTE: Invalidates all iterators. */
 #define array_grow(ptr_array) \
       (*(__typeof__((ptr_array)[0]))_array_grow_helper((void **)(ptr_array), sizeof((ptr_array)[0][0])))
+/** @brief Reserves memory for at least `n' elements without changing the size.
+ * NOTE: Invalidates all iterators. */
+#define array_reserve(ptr_array, n) \
+      (_array_reserve_helper((void **)(ptr_array), sizeof((ptr_array)[0][0]), (n)))
+/** @brief Removes all the elements without freeing the reserved memory */
+#define array_clear(array) ((void)(_array_private_container(array)->_size = 0))
 /** @brief Shrinks memory to fit only `size' elements.
  * NOTE: Invalidates all iterators. */
 #define array_shrink(ptr_array) \
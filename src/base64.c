@@ -152,104 +152,137 @@ static const signed char cd64[256] = { /* makes it much faster */
 
 
 /*
- * encodes src of sz length storing the new length in len
+ * encodes sz bytes of src into dst, which must hold at least
+ *  base64_encode_len(sz) bytes - returns the encoded length
  */
-char* base64_encode( size_t *len, char *src, size_t sz )
+size_t base64_encode_buf( char *dst, const char *src, size_t sz )
 {
-   char *r;
+   const unsigned char *s;
    size_t i, c;
    uint32_t n;
-   uint8_t ch[4], pad;
-
-   /* create r */
-   c = sz * 4 / 3 + sz % 3 + 2;
-   c += c / 76;
-   r = malloc( c * sizeof(char) );
+   int line;
 
-   /* setup padding */
-   pad = ((sz % 3) == 0) ? 0 : 3 - sz % 3;
-   
-   /* time to do the bulk work */
+   s = (const unsigned char*) src;
    i = 0;
-   for (c=0; c<sz; c+=3) {
+   line = 0;
+
+   /* bulk of the work - full 3 byte groups, no bounds checks needed */
+   for (c=0; c+3<=sz; c+=3) {
 
       /* specification wants newline after every 76 characters */
-      if ((c > 0) && ((c / 3 * 4) % 76 == 0))
-         r[i++] = '\n';
+      if (line == 76) {
+         dst[i++] = '\n';
+         line = 0;
+      }
 
       /* n is 24 bits */
-      n =  (src[c] << 16);
-      n += (c+1<sz) ? (src[c+1] << 8) : 0; /* may be out of range */
-      n += (c+2<sz) ? (src[c+2] << 0) : 0; /* may be out of range */
-     
-      /* ch[0-3] are 6 bits each */
-      ch[0] = (n >> 18) & 63;
-      ch[1] = (n >> 12) & 63;
-      ch[2] = (n >> 6)  & 63;
-      ch[3] = (n >> 0)  & 63;
-
-      /* add to str */
-      r[i++] = cb64[ ch[0] ];
-      r[i++] = cb64[ ch[1] ];
-      r[i++] = cb64[ ch[2] ];
-      r[i++] = cb64[ ch[3] ];
+      n = (s[c] << 16) | (s[c+1] << 8) | s[c+2];
+
+      /* add to str - 6 bits each */
+      dst[i++] = cb64[ (n >> 18) & 63 ];
+      dst[i++] = cb64[ (n >> 12) & 63 ];
+      dst[i++] = cb64[ (n >> 6)  & 63 ];
+      dst[i++] = cb64[ (n >> 0)  & 63 ];
+      line += 4;
    }
 
-   for (c=0; c<pad; c++)
-      r[i-c-1] = '=';
-   r[i] = '\0'; /* it'll be a valid string */
-   (*len) = i;
+   /* trailing 1 or 2 bytes get padded */
+   if (c < sz) {
+      if (line == 76)
+         dst[i++] = '\n';
 
-   return r;
+      n = s[c] << 16;
+      if (c+1 < sz)
+         n |= s[c+1] << 8;
+
+      dst[i++] = cb64[ (n >> 18) & 63 ];
+      dst[i++] = cb64[ (n >> 12) & 63 ];
+      dst[i++] = (c+1 < sz) ? cb64[ (n >> 6) & 63 ] : '=';
+      dst[i++] = '=';
+   }
+
+   dst[i] = '\0'; /* it'll be a valid string */
+   return i;
 }
 
 
 /*
- * decode the buffer, same syntax as base64_encode
+ * encodes src of sz length storing the new length in len
  */
-#define dec_valid(inp)  (cd64[(int)inp] == -1) ? 0 : 1
-#define dec_ch(inp)     cd64[(int)inp]
-char* base64_decode( size_t *len, char *src, size_t sz )
+char* base64_encode( size_t *len, char *src, size_t sz )
 {
-   char *r, *dat, pad;
-   size_t c,i,j;
-   uint32_t n;
+   char *r;
+   size_t c;
 
-   /* allocate r */
-   c = sz * 3 / 4 + 2;
+   /* create r */
+   c = base64_encode_len( sz );
    r = malloc( c * sizeof(char) );
 
-   /* create a clean version of the text */
+   (*len) = base64_encode_buf( r, src, sz );
+   return r;
+}
+
+
+/*
+ * decodes sz bytes of base 64 text from src into dst, which must hold
+ *  at least base64_decode_len(sz) bytes - returns the decoded length
+ *
+ * single pass - invalid characters are skipped on the fly instead of
+ *  compacting the input into an intermediate buffer first
+ */
+size_t base64_decode_buf( char *dst, const char *src, size_t sz )
+{
+   size_t i, c;
+   uint32_t n;
+   int nch, pad;
+   signed char d;
+
+   i = 0;
+   n = 0;
+   nch = 0;
    pad = 0;
-   dat = malloc( sz * sizeof(char) );
-   j = 0;
-   for (i=0; i<sz; i++) {
-      if (src[i] == '=') /* control padding */
+   for (c=0; c<sz; c++) {
+      if (src[c] == '=') /* control padding */
          pad++;
-      if (dec_valid( src[i] )) /* only allow valid characters */
-         dat[j++] = src[i];
+
+      d = cd64[ (int)(unsigned char) src[c] ];
+      if (d == -1) /* only allow valid characters */
+         continue;
+
+      /* gather 24 bits then emit 3 bytes */
+      n = (n << 6) | d;
+      if (++nch == 4) {
+         dst[i++] = (n >> 16) & 255;
+         dst[i++] = (n >> 8)  & 255;
+         dst[i++] = (n >> 0)  & 255;
+         nch = 0;
+         n = 0;
+      }
    }
 
-   /* fill r */
-   i = 0;
-   for (c=0; c<j; c+=4) {
-
-      /* process the input from base 64 */
-      n = dec_ch( dat[c+0] ) << 18; /* guaranteed to be valid */
-      n += (c+1<j) ? (dec_ch( dat[c+1] ) << 12) : 0; /* check if inbounds */
-      n += (c+2<j) ? (dec_ch( dat[c+2] ) << 6)  : 0;
-      n += (c+3<j) ? (dec_ch( dat[c+3] ) << 0)  : 0;
-
-      /* convert the 24 bits of encoded data into 3 8 bit chunks */ 
-      r[i++] = (n >> 16) & 255;
-      r[i++] = (n >> 8)  & 255;
-      r[i++] = (n >> 0)  & 255;
+   /* leftover partial group */
+   if (nch > 0) {
+      n <<= 6 * (4 - nch);
+      dst[i++] = (n >> 16) & 255;
+      dst[i++] = (n >> 8)  & 255;
+      dst[i++] = (n >> 0)  & 255;
    }
 
-   /* cleanup */
-   free(dat);
-   
-   (*len) = i - pad; /* must decount the padding */
+   return (i >= (size_t)pad) ? i - (size_t)pad : 0; /* decount the padding */
+}
+
+
+/*
+ * decode the buffer, same syntax as base64_encode
+ */
+char* base64_decode( size_t *len, char *src, size_t sz )
+{
+   char *r;
+
+   /* allocate r */
+   r = malloc( base64_decode_len( sz ) * sizeof(char) );
+
+   (*len) = base64_decode_buf( r, src, sz );
    return r;
 }
 
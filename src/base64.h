@@ -9,8 +9,16 @@
 #include <stddef.h>
 
 
+/* worst case buffer sizes for the streaming variants */
+#define base64_encode_len(sz)    (((sz)+2)/3*4 + (((sz)+2)/3*4)/76 + 1)
+#define base64_decode_len(sz)    ((sz) * 3 / 4 + 3)
+
 char* base64_encode( size_t *len, char *src, size_t sz );
 char* base64_decode( size_t *len, char *src, size_t sz );
 
+/* streaming variants - write into caller buffers, no allocation */
+size_t base64_encode_buf( char *dst, const char *src, size_t sz );
+size_t base64_decode_buf( char *dst, const char *src, size_t sz );
+
 
 #endif /* BASE64_H */
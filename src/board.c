@@ -334,7 +334,7 @@ static int board_fail( unsigned int wdw )
  */
 static void board_update( unsigned int wdw )
 {
-   int i, j;
+   int j;
    char str[PATH_MAX];
    char cred[10];
    Pilot* p;
@@ -346,15 +346,12 @@ static void board_update( unsigned int wdw )
    credits2str( cred, p->credits, 2 );
    j += snprintf( &str[j], PATH_MAX-j, "%s\n", cred );
 
-   /* Commodities. */
+   /* Commodities.  Just the total, walking the whole list would both
+    * scale with the cargo variety and overflow the three line layout. */
    if (p->ncommodities==0)
       j += snprintf( &str[j], PATH_MAX-j, "none\n" );
-   else {
-      for (i=0; i<p->ncommodities; i++)
-         j += snprintf( &str[j], PATH_MAX-j,
-               "%d %s\n",
-               p->commodities[i].quantity, p->commodities[i].commodity->name );
-   }
+   else
+      j += snprintf( &str[j], PATH_MAX-j, "%d Tons\n", pilot_cargoUsed(p) );
 
    /* Fuel. */
    if (p->fuel <= 0.)
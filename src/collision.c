@@ -14,6 +14,7 @@
 #include "naev.h"
 
 #include "log.h"
+#include "count.h"
 
 
 /**
@@ -37,13 +38,16 @@ int CollideSprite( const glTexture* at, const int asx, const int asy, const Vect
       const glTexture* bt, const int bsx, const int bsy, const Vector2d* bp,
       Vector2d* crash )
 {
-   int x,y;
+   int x,y, tx,ty, tx2,ty2;
+   uint32_t mask;
    int ax1,ax2, ay1,ay2;
    int bx1,bx2, by1,by2;
    int inter_x0, inter_x1, inter_y0, inter_y1;
    int rasy, rbsy;
    int abx,aby, bbx, bby;
 
+   COUNT_INC( COUNT_COLLIDE );
+
    /* Make sure the surfaces have transparency maps. */
    if (at->trans == NULL) {
       WARN("Texture '%s' has no transparency map.", at->name);
@@ -86,17 +90,35 @@ int CollideSprite( const glTexture* at, const int asx, const int asy, const Vect
    bbx =  bsx*(int)(bt->sw) - bx1;
    bby = rbsy*(int)(bt->sh) - by1;
 
-   for (y=inter_y0; y<=inter_y1; y++)
-      for (x=inter_x0; x<=inter_x1; x++)
-         /* compute offsets for surface before pass to TransparentPixel test */ 
-         if ((!gl_isTrans(at, abx + x, aby + y)) &&
-               (!gl_isTrans(bt, bbx + x, bby + y))) {
+   /* Walk the intersection in 8x8 tiles so the coarse block maps can
+    * reject most of the area without touching individual pixels. */
+   for (ty=inter_y0; ty<=inter_y1; ty+=8) {
+      ty2 = MIN( ty+7, inter_y1 );
+      for (tx=inter_x0; tx<=inter_x1; tx+=8) {
+         tx2 = MIN( tx+7, inter_x1 );
+
+         /* Tile is empty in either sprite, skip it wholesale. */
+         if (gl_isTransArea(at, abx + tx, aby + ty, abx + tx2, aby + ty2) ||
+               gl_isTransArea(bt, bbx + tx, bby + ty, bbx + tx2, bby + ty2))
+            continue;
+
+         /* Test the tile row by row, a word AND at a time. */
+         for (y=ty; y<=ty2; y++) {
+            mask = gl_transRowMask(at, abx + tx, aby + y, tx2-tx+1) &
+                   gl_transRowMask(bt, bbx + tx, bby + y, tx2-tx+1);
+            if (mask == 0)
+               continue;
+
+            /* Find the first overlapping pixel. */
+            for (x=0; !(mask & (1u << x)); x++);
 
             /* Set the crash position. */
-            crash->x = x;
+            crash->x = tx + x;
             crash->y = y;
             return 1;
          }
+      }
+   }
 
    return 0;
 }
@@ -180,6 +202,8 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
    int hits, real_hits;
    Vector2d tmp_crash, border[2];
 
+   COUNT_INC( COUNT_COLLIDE );
+
    /* Make sure texture has transparency map. */
    if (bt->trans == NULL) {
       WARN("Texture '%s' has no transparency map.", bt->name);
@@ -231,14 +255,32 @@ int CollideLineSprite( const Vector2d* ap, double ad, double al,
       hits++;
    }
 
-   /* No hits - missed. */
-   if (hits == 0)
-      return 0;
+   /* No border hits - either a miss or the segment is entirely inside
+    * the rectangle, which happens for swept projectiles mid-overlap. */
+   if (hits == 0) {
+      if ((ap->x > bl[0]) && (ap->x < tr[0]) &&
+            (ap->y > bl[1]) && (ap->y < tr[1])) {
+         border[0].x = ap->x;
+         border[0].y = ap->y;
+         border[1].x = ep[0];
+         border[1].y = ep[1];
+      }
+      else
+         return 0;
+   }
 
-   /* Beam must die in the rectangle. */
+   /* One endpoint lies in the rectangle - for a beam that's the end, for
+    * a swept segment it may be the start. */
    if (hits == 1) {
-      border[1].x = ep[0];
-      border[1].y = ep[1];
+      if ((ap->x > bl[0]) && (ap->x < tr[0]) &&
+            (ap->y > bl[1]) && (ap->y < tr[1])) {
+         border[1].x = ap->x;
+         border[1].y = ap->y;
+      }
+      else {
+         border[1].x = ep[0];
+         border[1].y = ep[1];
+      }
    }
 
    /* 
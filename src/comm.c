@@ -178,15 +178,18 @@ static unsigned int comm_open( glTexture *gfx, int faction,
    unsigned int wid;
    glColour *c;
 
-   /* Clean up. */
-   if (comm_graphic != NULL) {
-      /* First clean up if needed. */
-      gl_freeTexture(comm_graphic);
-      comm_graphic = NULL;
+   /* Graphic is cached between opens so hailing the same target again
+    * (or another pilot of the same ship, the texture stack dedupes by
+    * path) skips the reload. */
+   if (gfx == comm_graphic)
+      gl_freeTexture(gfx); /* Drop the duplicate reference. */
+   else {
+      if (comm_graphic != NULL)
+         gl_freeTexture(comm_graphic);
+      comm_graphic = gfx;
    }
 
    /* Get faction details. */
-   comm_graphic   = gfx;
    logo           = faction_logoSmall(faction);
 
    /* Get standing colour / text. */
@@ -259,11 +262,7 @@ static unsigned int comm_open( glTexture *gfx, int faction,
  */
 static void comm_close( unsigned int wid, char *unused )
 {
-   /* Clean up a bit after ourselves. */
-   if (comm_graphic != NULL) {
-      gl_freeTexture(comm_graphic);
-      comm_graphic = NULL;
-   }
+   /* comm_graphic is kept cached for the next hail, comm_exit frees it. */
    comm_pilot  = NULL;
    comm_planet = NULL;
    /* Close the window. */
@@ -271,6 +270,18 @@ static void comm_close( unsigned int wid, char *unused )
 }
 
 
+/**
+ * @brief Frees the cached comm window resources.
+ */
+void comm_exit (void)
+{
+   if (comm_graphic != NULL) {
+      gl_freeTexture(comm_graphic);
+      comm_graphic = NULL;
+   }
+}
+
+
 /**
  * @brief Tries to bribe the pilot.
  *
@@ -13,6 +13,7 @@
 int comm_isOpen (void);
 int comm_openPilot( unsigned int pilot );
 int comm_openPlanet( Planet *planet );
+void comm_exit (void);
 
 
 #endif /* COMM_H */
@@ -3,9 +3,15 @@
  */
 
 /**
- * @file mission.c
+ * @file cond.c
  *
- * @brief Handles missions.
+ * @brief Handles lua conditionals.
+ *
+ * Conditions get compiled to a Lua chunk once and the chunk is reused on
+ *  every later evaluation.  Results are also memoized against an epoch
+ *  counter that gets bumped whenever condition inputs (faction standing,
+ *  time, mission variables, mission state) change, so re-landing on a
+ *  planet only runs the conditions whose inputs could have changed.
  */
 
 
@@ -13,14 +19,39 @@
 
 #include "naev.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "log.h"
 #include "nlua.h"
 #include "nluadef.h"
+#include "strhash.h"
 
 
 static lua_State *cond_L = NULL; /** Conditional Lua state. */
 
 
+/**
+ * @brief Cached state of a compiled condition.
+ */
+typedef struct CondCache_ {
+   char *cond; /**< Owned copy of the condition, used as the hash key. */
+   int ref; /**< Registry reference of the compiled chunk, LUA_NOREF on error. */
+   int epoch; /**< Epoch the result was computed at, -1 if never. */
+   int result; /**< Memoized result of the last evaluation. */
+   struct CondCache_ *next; /**< Linked list of all entries, for cleanup. */
+} CondCache;
+static StrHash *cond_cache    = NULL; /**< Maps condition string to its cache. */
+static CondCache *cond_list   = NULL; /**< All cache entries. */
+static int cond_epoch         = 0; /**< Current game-state epoch. */
+
+
+/*
+ * prototypes
+ */
+static CondCache* cond_get( const char *cond );
+
+
 /**
  * @brief Initializes the conditional subsystem.
  */
@@ -35,6 +66,8 @@ int cond_init (void)
       return -1;
    }
 
+   cond_cache = strhash_create( 128 );
+
    return 0;
 }
 
@@ -44,43 +77,128 @@ int cond_init (void)
  */
 void cond_exit (void)
 {
+   CondCache *c;
+
    if (cond_L == NULL)
       return;
 
-   lua_close(cond_L);
+   /* Chunk references die with the state. */
+   while (cond_list != NULL) {
+      c           = cond_list;
+      cond_list   = c->next;
+      free( c->cond );
+      free( c );
+   }
+   strhash_destroy( cond_cache );
+   cond_cache = NULL;
+   cond_epoch = 0;
+
+   nlua_freeState(cond_L);
    cond_L = NULL;
 }
 
 
 /**
- * @brief Checks to see if a condition is true.
+ * @brief Marks all memoized condition results as stale.
  *
- *    @param cond Condition to check.
- *    @return 0 if is false, 1 if is true, -1 on error.
+ * Must be called whenever something conditions depend on changes.
  */
-int cond_check( const char* cond )
+void cond_invalidate (void)
 {
-   int b;
+   cond_epoch++;
+}
+
+
+/**
+ * @brief Gets the cache entry of a condition, compiling it if needed.
+ *
+ *    @param cond Condition to get the cache entry of.
+ *    @return The cache entry.
+ */
+static CondCache* cond_get( const char *cond )
+{
+   CondCache *c;
+   char *buf;
+   size_t len;
    int ret;
 
-   /* Load the string. */ 
-   lua_pushstring(cond_L, "return ");
-   lua_pushstring(cond_L, cond);
-   lua_concat(cond_L, 2);
-   ret = luaL_loadbuffer(cond_L, lua_tostring(cond_L,-1),
-         lua_strlen(cond_L,-1), "Lua Conditional");
+   /* Already compiled. */
+   c = strhash_get( cond_cache, cond );
+   if (c != NULL)
+      return c;
+
+   /* Create the entry. */
+   c           = malloc( sizeof(CondCache) );
+   c->cond     = strdup( cond );
+   c->ref      = LUA_NOREF;
+   c->epoch    = -1;
+   c->result   = -1;
+   c->next     = cond_list;
+   cond_list   = c;
+   strhash_put( cond_cache, c->cond, c );
+
+   /* Compile the chunk. */
+   len = strlen(cond) + 7; /* "return " + cond */
+   buf = malloc( len+1 );
+   strcpy( buf, "return " );
+   strcat( buf, cond );
+   ret = luaL_loadbuffer( cond_L, buf, len, "Lua Conditional" );
+   free( buf );
    switch (ret) {
-      case  LUA_ERRSYNTAX:
+      case LUA_ERRSYNTAX:
          WARN("Lua conditional syntax error");
-         goto cond_err;
+         return c;
       case LUA_ERRMEM:
          WARN("Lua Conditional ran out of memory");
-         goto cond_err;
+         return c;
       default:
          break;
    }
 
-   /* Run the string. */
+   /* Stash the chunk in the registry for reuse. */
+   c->ref = luaL_ref( cond_L, LUA_REGISTRYINDEX );
+
+   return c;
+}
+
+
+/**
+ * @brief Compiles a condition ahead of time.
+ *
+ * Called at load time so evaluation never has to parse.
+ *
+ *    @param cond Condition to compile.
+ *    @return 0 on success, -1 if the condition doesn't compile.
+ */
+int cond_compile( const char *cond )
+{
+   return (cond_get( cond )->ref == LUA_NOREF) ? -1 : 0;
+}
+
+
+/**
+ * @brief Checks to see if a condition is true.
+ *
+ *    @param cond Condition to check.
+ *    @return 0 if is false, 1 if is true, -1 on error.
+ */
+int cond_check( const char* cond )
+{
+   CondCache *c;
+   int b;
+   int ret;
+
+   /* Get the compiled chunk. */
+   c = cond_get( cond );
+   if (c->ref == LUA_NOREF)
+      return -1;
+
+   /* Result still valid for the current epoch. */
+   if (c->epoch == cond_epoch)
+      return c->result;
+
+   /* Run the chunk. */
+   lua_rawgeti( cond_L, LUA_REGISTRYINDEX, c->ref );
    ret = lua_pcall( cond_L, 0, 1, 0 );
    switch (ret) {
       case LUA_ERRRUN:
@@ -105,6 +223,10 @@ int cond_check( const char* cond )
       else
          ret = 0;
 
+      /* Memoize for this epoch. */
+      c->epoch  = cond_epoch;
+      c->result = ret;
+
       /* Clear the stack. */
       lua_settop(cond_L, 0);
 
@@ -9,7 +9,9 @@
 
 int cond_init (void);
 void cond_exit (void);
+int cond_compile( const char *cond );
 int cond_check( const char *cond );
+void cond_invalidate (void);
 
 
 #endif /* COND_H */
@@ -12,6 +12,7 @@
 #include <unistd.h> /* getopt */
 #include <string.h> /* strdup */
 #include <getopt.h> /* getopt_long */
+#include <sys/stat.h> /* stat */
 
 #include "nlua.h"
 #include "lauxlib.h" /* luaL_dofile */
@@ -58,6 +59,27 @@ if (lua_isstring(L, -1)) { \
 lua_pop(L,1);
 
 
+/*
+ * Binary sidecar cache of the parsed configuration, so warm startups
+ *  skip booting a Lua interpreter just to read a few dozen scalars.
+ *  Keyed on the conf file's mtime and size, editing or resaving the
+ *  conf invalidates it.
+ */
+#define CONF_CACHE_SUFFIX  ".cache" /**< Appended to the conf file path. */
+#define CONF_CACHE_MAGIC   0x4643434eU /**< Identifies the sidecar. */
+#define CONF_CACHE_VERSION 1 /**< Bump when the serialized layout changes. */
+#define CONF_CACHE_MAX     4096 /**< Serialized configurations are tiny. */
+
+/* Fixed size fields, put overflows the stack buffer, get runs off the
+ * loaded data - both bail to the function's error label. */
+#define conf_cachePut(v) \
+do { if (pos + (int)sizeof(v) > CONF_CACHE_MAX) goto overflow; \
+memcpy( &buf[pos], &(v), sizeof(v) ); pos += sizeof(v); } while (0)
+#define conf_cacheGet(v) \
+do { if (pos + (int)sizeof(v) > len) goto invalid; \
+memcpy( &(v), &buf[pos], sizeof(v) ); pos += sizeof(v); } while (0)
+
+
 /* Global configuration. */
 PlayerConf_t conf;
 
@@ -77,6 +99,10 @@ extern unsigned int input_afterburnSensitivity;
  * prototypes
  */
 static void print_usage( char **argv );
+static int conf_cachePutStr( char *buf, int *pos, const char *s );
+static int conf_cacheGetStr( const char *buf, int *pos, int len, char **s );
+static int conf_cacheLoad( const char *file, long mtime, long fsize );
+static void conf_cacheSave( const char *file, long mtime, long fsize );
 
 
 /*
@@ -98,6 +124,11 @@ static void print_usage( char **argv )
    LOG("   -S, --sound           forces sound");
    LOG("   -m f, --mvol f        sets the music volume to f");
    LOG("   -s f, --svol f        sets the sound volume to f");
+   LOG("   -B s, --benchmark s   run scenario s and exit: \"Fleet[*n][,Fleet...][@system]\"");
+   LOG("   -T n, --benchticks n  number of simulation ticks to benchmark");
+   LOG("   -R s, --record s      record the session to replay log s");
+   LOG("   -P s, --replay s      play back replay log s");
+   LOG("   -y,   --verify        verify the ndata archive on startup");
    LOG("   -G                    regenerates the nebula (slow)");
    LOG("   -h, --help            display this message and exit");
    LOG("   -v, --version         print the version and exit");
@@ -120,6 +151,8 @@ void conf_setDefaults (void)
    conf.vbo          = 1;
    conf.mipmaps      = 1;
    conf.compress     = 0;
+   conf.texmem       = 128;
+   conf.render_scale = 1.;
 
    /* Window. */
    conf.width        = 800;
@@ -148,6 +181,15 @@ void conf_setDefaults (void)
    conf.joystick_ind = -1;
    conf.joystick_nam = NULL;
 
+   /* Benchmark. */
+   conf.benchmark    = NULL;
+   conf.verify       = 0;
+   conf.bench_ticks  = 3600; /* One minute of simulation. */
+
+   /* Replay. */
+   conf.record       = NULL;
+   conf.replay       = NULL;
+
    /* Land. */
    conf.autorefuel   = 0;
 
@@ -179,6 +221,245 @@ void conf_cleanup (void)
 }
 
 
+/**
+ * @brief Serializes a possibly NULL string into the cache buffer.
+ *
+ *    @param buf Buffer to write into.
+ *    @param pos Write position, advanced on success.
+ *    @param s String to store (NULL is fine).
+ *    @return 0 on success, -1 if it doesn't fit.
+ */
+static int conf_cachePutStr( char *buf, int *pos, const char *s )
+{
+   int l;
+
+   l = (s == NULL) ? -1 : (int)strlen(s);
+   if (*pos + (int)sizeof(int) + ((l > 0) ? l : 0) > CONF_CACHE_MAX)
+      return -1;
+   memcpy( &buf[*pos], &l, sizeof(int) );
+   *pos += sizeof(int);
+   if (l > 0) {
+      memcpy( &buf[*pos], s, l );
+      *pos += l;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Reads a string out of the cache buffer into a conf field.
+ *
+ * Frees whatever the field held, a stored NULL leaves it NULL.
+ *
+ *    @param buf Buffer to read from.
+ *    @param pos Read position, advanced on success.
+ *    @param len Total length of buf.
+ *    @param[out] s Field to store the string in.
+ *    @return 0 on success, -1 on truncated data.
+ */
+static int conf_cacheGetStr( const char *buf, int *pos, int len, char **s )
+{
+   int l;
+
+   if (*pos + (int)sizeof(int) > len)
+      return -1;
+   memcpy( &l, &buf[*pos], sizeof(int) );
+   *pos += sizeof(int);
+   if ((l < -1) || (l > len - *pos))
+      return -1;
+
+   if (*s != NULL) {
+      free(*s);
+      *s = NULL;
+   }
+   if (l >= 0) {
+      *s = malloc(l+1);
+      memcpy( *s, &buf[*pos], l );
+      (*s)[l] = '\0';
+      *pos += l;
+   }
+   return 0;
+}
+
+
+/**
+ * @brief Tries to load the binary configuration cache.
+ *
+ *    @param file Path of the conf file the cache shadows.
+ *    @param mtime Modification time the conf file has now.
+ *    @param fsize Size the conf file has now.
+ *    @return 0 if the cache was valid and applied, -1 otherwise.
+ */
+static int conf_cacheLoad( const char *file, long mtime, long fsize )
+{
+   char *buf;
+   int len, pos, i, n;
+   unsigned int magic;
+   int version, type, key, mod;
+   long c_mtime, c_fsize;
+
+   buf = nfile_readFile( &len, "%s"CONF_CACHE_SUFFIX, file );
+   if (buf == NULL)
+      return -1;
+
+   /* Header, must match the conf file exactly. */
+   pos = 0;
+   conf_cacheGet(magic);
+   if (magic != CONF_CACHE_MAGIC)
+      goto invalid;
+   conf_cacheGet(version);
+   if (version != CONF_CACHE_VERSION)
+      goto invalid;
+   conf_cacheGet(c_mtime);
+   conf_cacheGet(c_fsize);
+   if ((c_mtime != mtime) || (c_fsize != fsize))
+      goto invalid;
+
+   /* Strings. */
+   if (conf_cacheGetStr( buf, &pos, len, &conf.ndata ) != 0)
+      goto invalid;
+   if (conf_cacheGetStr( buf, &pos, len, &conf.sound_backend ) != 0)
+      goto invalid;
+   if (conf_cacheGetStr( buf, &pos, len, &conf.joystick_nam ) != 0)
+      goto invalid;
+
+   /* Scalars, same order as conf_cacheSave(). */
+   conf_cacheGet(conf.fsaa);
+   conf_cacheGet(conf.vsync);
+   conf_cacheGet(conf.vbo);
+   conf_cacheGet(conf.mipmaps);
+   conf_cacheGet(conf.compress);
+   conf_cacheGet(conf.texmem);
+   conf_cacheGet(conf.render_scale);
+   conf_cacheGet(conf.width);
+   conf_cacheGet(conf.height);
+   conf_cacheGet(conf.explicit_dim);
+   conf_cacheGet(conf.scalefactor);
+   conf_cacheGet(conf.fullscreen);
+   conf_cacheGet(conf.fps_show);
+   conf_cacheGet(conf.fps_max);
+   conf_cacheGet(conf.al_efx);
+   conf_cacheGet(conf.al_bufsize);
+   conf_cacheGet(conf.nosound);
+   conf_cacheGet(conf.sound);
+   conf_cacheGet(conf.music);
+   conf_cacheGet(conf.joystick_ind);
+   conf_cacheGet(conf.autorefuel);
+   conf_cacheGet(conf.zoom_min);
+   conf_cacheGet(conf.zoom_max);
+   conf_cacheGet(conf.zoom_speed);
+   conf_cacheGet(conf.zoom_stars);
+   conf_cacheGet(conf.afterburn_sens);
+   conf_cacheGet(conf.nosave);
+   conf_cacheGet(conf.fpu_except);
+
+   /* Keybindings, stored in keybindNames order. */
+   conf_cacheGet(n);
+   for (i=0; strcmp(keybindNames[i],"end"); i++);
+   if (n != i)
+      goto invalid;
+   for (i=0; i < n; i++) {
+      conf_cacheGet(type);
+      conf_cacheGet(key);
+      conf_cacheGet(mod);
+      input_setKeybind( keybindNames[i], type, key, mod );
+   }
+
+   free(buf);
+   return 0;
+
+invalid:
+   free(buf);
+   return -1;
+}
+
+
+/**
+ * @brief Writes the binary configuration cache for the next startup.
+ *
+ * Failure just means the next startup parses the Lua again, so errors
+ *  are silently ignored.
+ *
+ *    @param file Path of the conf file the cache shadows.
+ *    @param mtime Modification time of the conf file that was parsed.
+ *    @param fsize Size of the conf file that was parsed.
+ */
+static void conf_cacheSave( const char *file, long mtime, long fsize )
+{
+   char buf[CONF_CACHE_MAX];
+   int pos, i, n, type, key, mod;
+   unsigned int magic;
+   int version;
+   KeybindType ktype;
+   SDLMod kmod;
+
+   magic   = CONF_CACHE_MAGIC;
+   version = CONF_CACHE_VERSION;
+
+   pos = 0;
+   conf_cachePut(magic);
+   conf_cachePut(version);
+   conf_cachePut(mtime);
+   conf_cachePut(fsize);
+
+   /* Strings. */
+   if (conf_cachePutStr( buf, &pos, conf.ndata ) != 0)
+      return;
+   if (conf_cachePutStr( buf, &pos, conf.sound_backend ) != 0)
+      return;
+   if (conf_cachePutStr( buf, &pos, conf.joystick_nam ) != 0)
+      return;
+
+   /* Scalars, same order as conf_cacheLoad(). */
+   conf_cachePut(conf.fsaa);
+   conf_cachePut(conf.vsync);
+   conf_cachePut(conf.vbo);
+   conf_cachePut(conf.mipmaps);
+   conf_cachePut(conf.compress);
+   conf_cachePut(conf.texmem);
+   conf_cachePut(conf.render_scale);
+   conf_cachePut(conf.width);
+   conf_cachePut(conf.height);
+   conf_cachePut(conf.explicit_dim);
+   conf_cachePut(conf.scalefactor);
+   conf_cachePut(conf.fullscreen);
+   conf_cachePut(conf.fps_show);
+   conf_cachePut(conf.fps_max);
+   conf_cachePut(conf.al_efx);
+   conf_cachePut(conf.al_bufsize);
+   conf_cachePut(conf.nosound);
+   conf_cachePut(conf.sound);
+   conf_cachePut(conf.music);
+   conf_cachePut(conf.joystick_ind);
+   conf_cachePut(conf.autorefuel);
+   conf_cachePut(conf.zoom_min);
+   conf_cachePut(conf.zoom_max);
+   conf_cachePut(conf.zoom_speed);
+   conf_cachePut(conf.zoom_stars);
+   conf_cachePut(conf.afterburn_sens);
+   conf_cachePut(conf.nosave);
+   conf_cachePut(conf.fpu_except);
+
+   /* Keybindings. */
+   for (n=0; strcmp(keybindNames[n],"end"); n++);
+   conf_cachePut(n);
+   for (i=0; i < n; i++) {
+      key  = (int) input_getKeybind( keybindNames[i], &ktype, &kmod );
+      type = (int) ktype;
+      mod  = (int) kmod;
+      conf_cachePut(type);
+      conf_cachePut(key);
+      conf_cachePut(mod);
+   }
+
+   nfile_writeFile( buf, pos, "%s"CONF_CACHE_SUFFIX, file );
+   return;
+
+overflow:
+   return; /* Doesn't fit, the next startup parses the Lua again. */
+}
+
+
 /*
  * parses the config file
  */
@@ -191,6 +472,8 @@ int conf_loadConfig ( const char* file )
    int type;
    int w,h;
    SDLMod m;
+   struct stat st;
+   long mtime, fsize;
 
    i = 0;
    d = 0.;
@@ -199,6 +482,17 @@ int conf_loadConfig ( const char* file )
    if (!nfile_fileExists(file))
       return nfile_touch(file);
 
+   /* Warm startups read the binary sidecar instead of booting a Lua
+    * interpreter, the conf file's stat keys it so edits invalidate. */
+   mtime = 0;
+   fsize = 0;
+   if (stat( file, &st ) == 0) {
+      mtime = (long) st.st_mtime;
+      fsize = (long) st.st_size;
+   }
+   if (conf_cacheLoad( file, mtime, fsize ) == 0)
+      return 0;
+
    /* Load the configuration. */
    lua_State *L = nlua_newState();
    if (luaL_dofile(L, file) == 0) {
@@ -212,6 +506,9 @@ int conf_loadConfig ( const char* file )
       conf_loadBool("vbo",conf.vbo);
       conf_loadBool("mipmaps",conf.mipmaps);
       conf_loadBool("compress",conf.compress);
+      conf_loadInt("texmem",conf.texmem);
+      conf_loadFloat("render_scale",conf.render_scale);
+      conf.render_scale = CLAMP( 0.25, 1., conf.render_scale );
 
       /* Window. */
       w = h = 0;
@@ -365,11 +662,15 @@ int conf_loadConfig ( const char* file )
    else { /* failed to load the config file */
       WARN("Config file '%s' has invalid syntax:", file );
       WARN("   %s", lua_tostring(L,-1));
-      lua_close(L);
+      nlua_freeState(L);
       return 1;
    }
 
-   lua_close(L);
+   nlua_freeState(L);
+
+   /* Parsed fine, leave the sidecar for the next startup. */
+   conf_cacheSave( file, mtime, fsize );
+
    return 0;
 }
 
@@ -392,13 +693,18 @@ void conf_parseCLI( int argc, char** argv )
       { "sound", no_argument, 0, 'S' },
       { "mvol", required_argument, 0, 'm' },
       { "svol", required_argument, 0, 's' },
+      { "benchmark", required_argument, 0, 'B' },
+      { "benchticks", required_argument, 0, 'T' },
+      { "record", required_argument, 0, 'R' },
+      { "verify", no_argument, 0, 'y' },
+      { "replay", required_argument, 0, 'P' },
       { "help", no_argument, 0, 'h' }, 
       { "version", no_argument, 0, 'v' },
       { NULL, 0, 0, 0 } };
    int option_index = 0;
    int c = 0;
    while ((c = getopt_long(argc, argv,
-         "fF:Vd:j:J:W:H:MSm:s:Ghv",
+         "fF:Vd:j:J:W:H:MSm:s:B:T:R:P:Gyhv",
          long_options, &option_index)) != -1) {
       switch (c) {
          case 'f':
@@ -439,9 +745,24 @@ void conf_parseCLI( int argc, char** argv )
          case 's':
             conf.sound = atof(optarg);
             break;
+         case 'B':
+            conf.benchmark = strdup(optarg);
+            break;
+         case 'T':
+            conf.bench_ticks = atoi(optarg);
+            break;
+         case 'R':
+            conf.record = strdup(optarg);
+            break;
+         case 'P':
+            conf.replay = strdup(optarg);
+            break;
          case 'G':
             nebu_forceGenerate();
             break;
+         case 'y':
+            conf.verify = 1;
+            break;
 
          case 'v':
             /* by now it has already displayed the version
@@ -715,6 +1036,15 @@ int conf_saveConfig ( const char* file )
    conf_saveBool("compress",conf.compress);
    conf_saveEmptyLine();
 
+   conf_saveComment("Texture cache memory budget in MiB, unused textures are evicted over it");
+   conf_saveInt("texmem",conf.texmem);
+   conf_saveEmptyLine();
+
+   conf_saveComment("Fraction of the window resolution to render the world at");
+   conf_saveComment("The result is upscaled, the GUI and text always render at full resolution");
+   conf_saveFloat("render_scale",conf.render_scale);
+   conf_saveEmptyLine();
+
    /* Window. */
    conf_saveComment("The window size or screen resolution");
    conf_saveComment("Set both of these to 0 to make "APPNAME" try the desktop resolution");
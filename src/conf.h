@@ -24,6 +24,8 @@ typedef struct PlayerConf_s {
    int vbo; /**< Use vbo. */
    int mipmaps; /**< Use mipmaps. */
    int compress; /**< Use texture compression. */
+   int texmem; /**< Texture cache memory budget in MiB. */
+   double render_scale; /**< Fraction of the resolution to render the world at. */
 
    /* Window dimensions. */
    int width; /**< Width of the window to use. */
@@ -51,6 +53,17 @@ typedef struct PlayerConf_s {
    /* Land. */
    int autorefuel; /**< Whether or not to autorefuel when landing. */
 
+   /* Benchmark. */
+   char *benchmark; /**< Benchmark scenario to run, NULL plays normally. */
+   int bench_ticks; /**< Number of fixed simulation ticks to benchmark. */
+
+   /* Replay. */
+   char *record; /**< File to record the session to, NULL disables. */
+   char *replay; /**< Replay log to play back, NULL disables. */
+
+   /* ndata verification. */
+   int verify; /**< Verify the ndata archive digests on startup. */
+
    /* Misc. */
    double zoom_max; /**< Maximum ingame zoom to use. */
    double zoom_min; /**< Minimum ingame zoom to use. */
@@ -46,6 +46,8 @@ static glFont *cli_font     = NULL; /**< CLI font to use. */
 #define LINE_LENGTH        80 /**< Length of lines in the buffer. */
 static int cli_cursor      = 0; /**< Current cursor position. */
 static char cli_buffer[BUF_LINES][LINE_LENGTH]; /**< CLI buffer. */
+static int cli_bufferFit[BUF_LINES]; /**< Characters of each line that fit. */
+static const glColour *cli_bufferCol[BUF_LINES]; /**< Colour of each line. */
 static int cli_viewport    = 0; /**< Current viewport. */
 static int cli_history     = 0; /**< Position in history. */
 static int cli_width       = 0; /**< Console width. */
@@ -131,16 +133,33 @@ static int cli_script( lua_State *L )
 /**
  * @brief Adds a message to the buffer.
  *
+ * Lines are classified and laid out once here so rendering doesn't have
+ *  to rescan them every frame.
+ *
  *    @param msg Message to add.
  */
 static void cli_addMessage( const char *msg )
 {
    int n;
+   char *line;
 
+   line = cli_buffer[cli_cursor];
    if (msg != NULL)
-      strncpy( cli_buffer[cli_cursor], msg, LINE_LENGTH );
+      strncpy( line, msg, LINE_LENGTH );
+   else
+      line[0] = '\0';
+   line[LINE_LENGTH-1] = '\0';
+
+   /* Classify the colour. */
+   if (line[0] == '>')
+      cli_bufferCol[cli_cursor] = &cDConsole;
+   else if (strncmp(line, "cli:", 4)==0)
+      cli_bufferCol[cli_cursor] = &cRed;
    else
-      cli_buffer[cli_cursor][0] = '\0';
+      cli_bufferCol[cli_cursor] = &cBlack;
+
+   /* Lay the line out against the console widget width. */
+   cli_bufferFit[cli_cursor] = gl_printFit( cli_font, line, cli_width-40 );
 
    cli_cursor = (cli_cursor+1) % BUF_LINES;
    cli_history = cli_cursor; /* History matches cursor. */
@@ -158,21 +177,16 @@ static void cli_addMessage( const char *msg )
 static void cli_render( double bx, double by, double w, double h, void *data )
 {
    (void) data;
+   (void) w;
    int i, y;
-   glColour *c;
 
-   /* Draw the text. */
+   /* Draw the text from the layouts cached at add time. */
    i = cli_viewport;
    for (y=h-cli_font->h-5; y>0; y -= cli_font->h + 5) {
-      if (cli_buffer[i][0] == '>')
-         c = &cDConsole;
-      else if (strncmp(cli_buffer[i], "cli:", 4)==0)
-         c = &cRed;
-      else
-         c = &cBlack;
-      gl_printMaxRaw( cli_font, w,
-            bx + SCREEN_W/2., by + y + SCREEN_H/2., 
-            c, cli_buffer[i] );
+      if (cli_buffer[i][0] != '\0')
+         gl_printNRaw( cli_font,
+               bx + SCREEN_W/2., by + y + SCREEN_H/2.,
+               cli_bufferCol[i], cli_buffer[i], cli_bufferFit[i] );
       i = (i + 1) % BUF_LINES;
    }
 }
@@ -256,6 +270,8 @@ int cli_init (void)
 
    /* Clear the buffer. */
    memset( cli_buffer, 0, sizeof(cli_buffer) );
+   memset( cli_bufferFit, 0, sizeof(cli_bufferFit) );
+   memset( cli_bufferCol, 0, sizeof(cli_bufferCol) );
 
    /* Put a friendly message at first. */
    cli_addMessage( "Welcome to the Lua console!" );
@@ -272,7 +288,7 @@ void cli_exit (void)
 {
    /* Destroy the state. */
    if (cli_state != NULL) {
-      lua_close( cli_state );
+      nlua_freeState( cli_state );
       cli_state = NULL;
    }
 
@@ -0,0 +1,70 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file count.c
+ *
+ * @brief Per-frame rate counters.
+ *
+ * Timings say where a frame went, these say how often the hot paths ran:
+ *  draw calls, narrow-phase collision tests, pilot lookups, Lua calls and
+ *  sound starts.  A counter creeping up between builds predicts a frame
+ *  time problem before it is big enough to feel.
+ *
+ * The increments are plain array adds through COUNT_INC()/COUNT_ADD() and
+ *  stay enabled in release builds.  perf_frame() snapshots and resets the
+ *  counters once per frame and the profiler overlay displays them.
+ */
+
+#include "count.h"
+
+#include "naev.h"
+
+#include <string.h>
+
+
+long count_accum[COUNT_MAX]; /**< Running counts for the current frame. */
+
+static long count_last[COUNT_MAX]; /**< Counts of the last closed frame. */
+
+static const char *count_names[COUNT_MAX] = {
+   "draws",
+   "collide",
+   "pilot_get",
+   "lua",
+   "sound",
+   "gcstep"
+}; /**< Overlay names, must match CountStat order. */
+
+
+/**
+ * @brief Closes the frame: snapshots the counters and zeroes them.
+ */
+void count_reset (void)
+{
+   memcpy( count_last, count_accum, sizeof(count_last) );
+   memset( count_accum, 0, sizeof(count_accum) );
+}
+
+
+/**
+ * @brief Gets a counter's value for the last closed frame.
+ */
+long count_get( CountStat c )
+{
+   if ((c < 0) || (c >= COUNT_MAX))
+      return 0;
+   return count_last[c];
+}
+
+
+/**
+ * @brief Gets a counter's overlay name.
+ */
+const char* count_name( CountStat c )
+{
+   if ((c < 0) || (c >= COUNT_MAX))
+      return NULL;
+   return count_names[c];
+}
@@ -0,0 +1,44 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef COUNT_H
+#  define COUNT_H
+
+
+/**
+ * @enum CountStat
+ *
+ * @brief The per-frame rate counters.
+ */
+typedef enum CountStat_ {
+   COUNT_DRAWS = 0,  /**< Draw calls issued. */
+   COUNT_COLLIDE,    /**< Narrow-phase sprite collision tests. */
+   COUNT_PILOT_GET,  /**< pilot_get() lookups. */
+   COUNT_LUA,        /**< Lua function invocations. */
+   COUNT_SOUND,      /**< Sounds started. */
+   COUNT_GCSTEP,     /**< Lua GC steps run by the governor. */
+   COUNT_MAX         /**< Sentinel. */
+} CountStat;
+
+
+extern long count_accum[COUNT_MAX];
+
+
+/*
+ * Increment macros, cheap enough to leave in hot loops unconditionally.
+ */
+#define COUNT_INC(c)      (count_accum[(c)]++)
+#define COUNT_ADD(c,n)    (count_accum[(c)] += (n))
+
+
+/*
+ * Frame handling and access, see perf.c for the consumer.
+ */
+void count_reset (void);
+long count_get( CountStat c );
+const char* count_name( CountStat c );
+
+
+#endif /* COUNT_H */
@@ -15,6 +15,11 @@
  *  the main loop until it's over, making these functions seem to be blocking
  *  without really being blocking.
  *
+ * The blocking interface has to stay for the mission Lua, which consumes
+ *  the results inline, but dialogue_alert() and the Async variants are
+ *  ordinary windows that return immediately and never re-enter the main
+ *  loop.  Prefer those from engine code.
+ *
  * @todo Make dialogue system more flexible.
  *
  * @sa toolkit.c
@@ -32,6 +37,7 @@
 #include "pause.h"
 #include "opengl.h"
 #include "input.h"
+#include "replay.h"
 
 
 int dialogue_open; /**< Number of dialogues open. */
@@ -47,6 +53,7 @@ static glFont* dialogue_getSize( const char* title,
       const char* msg, int* width, int* height );
 static void dialogue_alertClose( unsigned int wid, char* str );
 static void dialogue_msgClose( unsigned int wid, char* str );
+static void dialogue_YesNoCreate( const char* caption, const char *msg );
 static void dialogue_YesNoClose( unsigned int wid, char* str );
 static void dialogue_inputClose( unsigned int wid, char* str );
 static void dialogue_inputCancel( unsigned int wid, char* str );
@@ -91,8 +98,8 @@ void dialogue_alert( const char *fmt, ... )
    window_addButton( wdw, 135, 20, 50, 30, "btnOK", "OK",
          dialogue_alertClose );
 
+   /* Ordinary window, returns right away as the header advertises. */
    dialogue_open++;
-   toolkit_loop();
 }
 /**
  * @brief Closes the alert dialogue.
@@ -103,7 +110,6 @@ static void dialogue_alertClose( unsigned int wid, char* str )
 {
    (void)str;
    window_destroy( wid );
-   loop_done = 1;
    dialogue_open--;
 }
 
@@ -218,6 +224,8 @@ static void dialogue_msgClose( unsigned int wid, char* str )
 
 static int yesno_result; /**< Stores the yesno dialogue result. */
 static unsigned int yesno_wid = 0; /**< Stores the yesno window id. */
+static void (*yesno_done)( int result, void *data ) = NULL; /**< Async completion callback. */
+static void *yesno_data = NULL; /**< User data for the async callback. */
 /**
  * @brief Runs a dialogue with both yes and no options.
  *
@@ -251,6 +259,53 @@ int dialogue_YesNo( const char* caption, const char *fmt, ... )
  *    @return 1 if yes is clicked or 0 if no is clicked.
  */
 int dialogue_YesNoRaw( const char* caption, const char *msg )
+{
+   dialogue_YesNoCreate( caption, msg );
+
+   /* tricky secondary loop */
+   dialogue_open++;
+   toolkit_loop();
+
+   /* return the result */
+   return yesno_result;
+}
+
+
+/**
+ * @brief Runs a yesno dialogue that reports through a callback.
+ *
+ * Unlike dialogue_YesNoRaw() this returns immediately, the dialogue is an
+ *  ordinary window and the main loop keeps running.  The callback fires
+ *  once when either button is clicked.
+ *
+ *    @param caption Caption to use for the dialogue.
+ *    @param msg Message to display.
+ *    @param done Called with the result (1 yes, 0 no) when answered.
+ *    @param data User data passed through to the callback.
+ */
+void dialogue_YesNoAsync( const char* caption, const char *msg,
+      void (*done)( int result, void *data ), void *data )
+{
+   if (yesno_wid) {
+      WARN("Yesno dialogue already open!");
+      return;
+   }
+
+   dialogue_YesNoCreate( caption, msg );
+
+   yesno_done = done;
+   yesno_data = data;
+   dialogue_open++;
+}
+
+
+/**
+ * @brief Builds the yesno window shared by the blocking and async paths.
+ *
+ *    @param caption Caption to use for the dialogue.
+ *    @param msg Message to display.
+ */
+static void dialogue_YesNoCreate( const char* caption, const char *msg )
 {
    int w,h;
    glFont* font;
@@ -267,13 +322,6 @@ int dialogue_YesNoRaw( const char* caption, const char *msg )
          dialogue_YesNoClose );
    window_addButton( yesno_wid, w/2+10, 20, 50, 30, "btnNo", "No",
          dialogue_YesNoClose );
-
-   /* tricky secondary loop */
-   dialogue_open++;
-   toolkit_loop();
-
-   /* return the result */
-   return yesno_result;
 }
 /**
  * @brief Closes a yesno dialogue.
@@ -282,6 +330,8 @@ int dialogue_YesNoRaw( const char* caption, const char *msg )
  */
 static void dialogue_YesNoClose( unsigned int wid, char* str )
 {
+   void (*done)( int result, void *data );
+
    /* store the result */
    if (strcmp(str,"btnYes")==0)
       yesno_result = 1;
@@ -292,6 +342,15 @@ static void dialogue_YesNoClose( unsigned int wid, char* str )
    window_destroy( wid );
    yesno_wid = 0;
 
+   /* Async dialogue, report through the callback, no loop to break. */
+   if (yesno_done != NULL) {
+      done       = yesno_done;
+      yesno_done = NULL;
+      dialogue_open--;
+      done( yesno_result, yesno_data );
+      return;
+   }
+
    loop_done = 1;
    dialogue_open--;
 }
@@ -445,8 +504,11 @@ static int toolkit_loop (void)
             return -1;
          }
 
-         input_handle(&event); /* handles all the events and player keybinds */
+         /* Real input is ignored in playback, the log injects its own. */
+         if (replay_mode() != REPLAY_PLAYBACK)
+            input_handle(&event); /* handles all the events and player keybinds */
       }
+      input_update(); /* flushes coalesced joystick motion */
    }
 
    return 0;
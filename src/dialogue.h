@@ -16,6 +16,8 @@ void dialogue_msg( const char *caption, const char *fmt, ... );
 void dialogue_msgRaw( const char *caption, const char *msg );
 int dialogue_YesNo( const char *caption, const char *fmt, ... ); /* Yes = 1, No = 0 */
 int dialogue_YesNoRaw( const char *caption, const char *msg );
+void dialogue_YesNoAsync( const char *caption, const char *msg,
+      void (*done)( int result, void *data ), void *data ); /* does not block */
 char* dialogue_input( const char* title, int min, int max, const char *fmt, ... );
 char* dialogue_inputRaw( const char* title, int min, int max, const char *msg  );
 
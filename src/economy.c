@@ -46,6 +46,7 @@
 #define ECON_FACTION_MOD   0.1 /**< Modifier on Base for faction standings. */
 #define ECON_PROD_MODIFIER 500000. /**< Production modifier, divide production by this amount. */
 #define ECON_PROD_VAR      0.01 /**< Defines the variability of production. */
+#define ECON_TICK_STU      NTIME_UNIT_LENGTH /**< Game time between price solves. */
 
 
 /* commodity stack */
@@ -66,6 +67,16 @@ static int *econ_comm         = NULL; /**< Commodities to calculate. */
 static int econ_nprices       = 0; /**< Number of prices to calculate. */
 static cs *econ_G             = NULL; /**< Admittance matrix. */
 
+/*
+ * Price storage.
+ *
+ * One flat price-row x system matrix so the solver writes rows
+ *  contiguously and economy_getPrice() is a pure array read.
+ */
+static double *econ_prices    = NULL; /**< Price matrix [row*nsystems+system]. */
+static int *econ_commRow      = NULL; /**< Maps commodity index to price row, -1 if untraded. */
+static unsigned int econ_queued = 0; /**< Game time accrued towards the next solve. */
+
 
 /*
  * Prototypes.
@@ -76,6 +87,7 @@ static int commodity_parse( Commodity *temp, xmlNodePtr parent );
 /* Economy. */
 static double econ_calcJumpR( StarSystem *A, StarSystem *B );
 static int econ_createGMatrix (void);
+static int econ_solve( unsigned int dt );
 unsigned int economy_getPrice( const Commodity *com,
       const StarSystem *sys, const Planet *p ); /* externed in land.c */
 
@@ -229,7 +241,7 @@ int commodity_load (void)
       return -1;
 
    /* Handle the XML. */
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
    if (doc == NULL) {
       WARN("'%s' is not valid XML.", COMMODITY_DATA);
       return -1;
@@ -303,26 +315,19 @@ unsigned int economy_getPrice( const Commodity *com,
       const StarSystem *sys, const Planet *p )
 {
    (void) p;
-   int i, k;
+   int i;
    double price;
 
-   /* Get position in stack. */
-   k = com - commodity_stack;
-  
-   /* Find what commodity that is. */
-   for (i=0; i<econ_nprices; i++)
-      if (econ_comm[i] == k)
-         break;
-
-   /* Check if found. */
-   if (i >= econ_nprices) {
+   /* Map the commodity to its price row. */
+   i = (econ_commRow != NULL) ? econ_commRow[ com - commodity_stack ] : -1;
+   if (i < 0) {
       WARN("Price for commodity '%s' not known.", com->name);
       return 0;
    }
 
    /* Calculate price. */
    price  = (double) com->price;
-   price *= sys->prices[i];
+   price *= econ_prices[ i*systems_nstack + (sys - systems_stack) ];
    return (unsigned int) price;
 }
 
@@ -476,12 +481,19 @@ int economy_init (void)
    if (econ_initialized)
       return 0;
 
-   /* Allocate price space. */
-   for (i=0; i<systems_nstack; i++) {
-      if (systems_stack[i].prices != NULL)
-         free(systems_stack[i].prices);
-      systems_stack[i].prices = calloc(econ_nprices, sizeof(double));
-   }
+   /* Allocate the price matrix. */
+   if (econ_prices != NULL)
+      free(econ_prices);
+   econ_prices = calloc( econ_nprices * systems_nstack, sizeof(double) );
+
+   /* Build the commodity to price row map. */
+   if (econ_commRow != NULL)
+      free(econ_commRow);
+   econ_commRow = malloc( commodity_nstack * sizeof(int) );
+   for (i=0; i<commodity_nstack; i++)
+      econ_commRow[i] = -1;
+   for (i=0; i<econ_nprices; i++)
+      econ_commRow[ econ_comm[i] ] = i;
 
    /* Mark economy as initialized. */
    econ_initialized = 1;
@@ -508,7 +520,7 @@ int economy_refresh (void)
       return -1;
 
    /* Initialize the prices. */
-   economy_update( 0 );
+   econ_solve( 0 );
 
    return 0;
 }
@@ -517,9 +529,32 @@ int economy_refresh (void)
 /**
  * @brief Updates the economy.
  *
+ * Solving is deferred until enough game time has accrued, so bursts of
+ *  small time increments only pay for one solve.
+ *
  *    @param dt Deltatick in NTIME.
  */
 int economy_update( unsigned int dt )
+{
+   /* Economy must be initialized. */
+   if (econ_initialized == 0)
+      return 0;
+
+   /* Accrue towards the slow tick. */
+   econ_queued += dt;
+   if (econ_queued < ECON_TICK_STU)
+      return 0;
+
+   return econ_solve( econ_queued );
+}
+
+
+/**
+ * @brief Solves the economy system, filling in the price matrix.
+ *
+ *    @param dt Deltatick in NTIME.
+ */
+static int econ_solve( unsigned int dt )
 {
    int ret;
    int i, j;
@@ -527,9 +562,8 @@ int economy_update( unsigned int dt )
    double scale, offset;
    /*double min, max;*/
 
-   /* Economy must be initialized. */
-   if (econ_initialized == 0)
-      return 0;
+   /* Time has been consumed. */
+   econ_queued = 0;
 
    /* Create the vector to solve the system. */
    X = malloc(sizeof(double)*systems_nstack);
@@ -573,9 +607,8 @@ int economy_update( unsigned int dt )
        */
       scale    = 1.;
       offset   = 1.;
-      for (i=0; i<systems_nstack; i++) {
-         systems_stack[i].prices[j] = X[i] * scale + offset;
-      }
+      for (i=0; i<systems_nstack; i++)
+         econ_prices[ j*systems_nstack + i ] = X[i] * scale + offset;
    }
 
    /* Clean up. */
@@ -590,19 +623,20 @@ int economy_update( unsigned int dt )
  */
 void economy_destroy (void)
 {
-   int i;
-
    /* Must be initialized. */
    if (!econ_initialized)
       return;
 
-   /* Clean up the prices in the systems stack. */
-   for (i=0; i<systems_nstack; i++) {
-      if (systems_stack[i].prices != NULL) {
-         free(systems_stack[i].prices);
-         systems_stack[i].prices = NULL;
-      }
+   /* Clean up the price matrix. */
+   if (econ_prices != NULL) {
+      free(econ_prices);
+      econ_prices = NULL;
+   }
+   if (econ_commRow != NULL) {
+      free(econ_commRow);
+      econ_commRow = NULL;
    }
+   econ_queued = 0;
 
    /* Destroy the economy matrix. */
    if (econ_G != NULL) {
@@ -235,6 +235,8 @@ void equipment_slotWidget( unsigned int wid,
          equipment_renderSlots, equipment_mouseSlots, data );
    window_custSetClipping( wid, "cstEquipment", 0 );
    window_custSetOverlay( wid, "cstEquipment", equipment_renderOverlaySlots );
+   /* Slots only change in response to input, let the window cache them. */
+   window_custSetDynamic( wid, "cstEquipment", 0 );
 }
 /**
  * @brief Renders an outfit column.
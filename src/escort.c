@@ -67,6 +67,39 @@ int escort_addList( Pilot *p, char *ship, EscortType_t type, unsigned int id )
 }
 
 
+/**
+ * @brief Removes an escort from the escort list of a pilot.
+ *
+ *    @param p Pilot to remove escort from.
+ *    @param id ID of the pilot representing the escort.
+ *    @return 0 on success, -1 if the escort wasn't in the list.
+ */
+int escort_rmList( Pilot *p, unsigned int id )
+{
+   int i;
+
+   /* Find the escort. */
+   for (i=0; i<p->nescorts; i++)
+      if (p->escorts[i].id == id)
+         break;
+   if (i >= p->nescorts)
+      return -1;
+
+   /* Remove it. */
+   free( p->escorts[i].ship );
+   p->nescorts--;
+   if (p->nescorts == 0) {
+      free(p->escorts);
+      p->escorts = NULL;
+   }
+   else
+      memmove( &p->escorts[i], &p->escorts[i+1],
+            sizeof(Escort_t) * (p->nescorts-i) );
+
+   return 0;
+}
+
+
 /**
  * @brief Creates an escort.
  *
@@ -137,14 +170,7 @@ static int escort_disabled( void *data )
       return 0;
 
    /* Remove from escorts list. */
-   for (i=0; i<p->nescorts; i++) {
-      if (p->escorts[i].id == pe->id) {
-         p->nescorts--;
-         memmove( &p->escorts[i], &p->escorts[i+1],
-               sizeof(Escort_t)*(p->nescorts-i) );
-         break;
-      }
-   }
+   escort_rmList( p, pe->id );
 
    /* Remove from deployed list. */
    for (i=0; i<p->noutfits; i++) {
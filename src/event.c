@@ -67,6 +67,13 @@ typedef struct EventData_s {
 static EventData_t *event_data   = NULL; /**< Allocated event data. */
 static int event_ndata           = 0; /**< Number of actual event data. */
 
+/*
+ * Trigger index, built at load time so a trigger point only walks the
+ *  events that can actually fire there.
+ */
+static int *event_trigIdx[EVENT_TRIGGER_MAX]; /**< Data ids per trigger. */
+static int event_trigN[EVENT_TRIGGER_MAX]; /**< Data ids per trigger. */
+
 
 /*
  * Active events.
@@ -77,6 +84,15 @@ static int event_nactive         = 0; /**< Number of active events. */
 static int event_mactive         = 0; /**< Allocated space for active events. */
 
 
+/*
+ * Timer scheduling, mirrors the mission timers: accrue time against the
+ *  soonest deadline and only walk the active events when it could have
+ *  expired.
+ */
+static double event_timerElapsed = 0.; /**< Time accrued since the last sweep. */
+static double event_timerNext    = -1.; /**< Soonest timer deadline, negative when none armed. */
+
+
 /*
  * Prototypes.
  */
@@ -161,8 +177,6 @@ int event_isUnique( unsigned int eventid )
 static int event_create( int dataid )
 {
    lua_State *L;
-   uint32_t bufsize;
-   char *buf;
    Event_t *ev;
    EventData_t *data;
 
@@ -188,20 +202,14 @@ static int event_create( int dataid )
    nlua_loadHook(L);
    nlua_loadTk(L);
 
-   /* Load file. */
-   buf = ndata_read( data->lua, &bufsize );
-   if (buf == NULL) {
-      WARN("Event '%s' Lua script not found.", data->lua );
-      return -1;
-   }
-   if (luaL_dobuffer(L, buf, bufsize, data->lua) != 0) {
+   /* Load file through the bytecode cache. */
+   if (nlua_dofileCached(L, data->lua) != 0) {
       WARN("Error loading event file: %s\n"
             "%s\n"
             "Most likely Lua file has improper syntax, please check",
             data->lua, lua_tostring(L,-1));
       return -1;
    }
-   free(buf);
 
    /* Run Lua. */
    event_runLua( ev, "create" );
@@ -220,7 +228,7 @@ static void event_cleanup( Event_t *ev )
    int i;
 
    /* Destroy Lua. */
-   lua_close(ev->L);
+   nlua_freeState(ev->L);
 
    /* Free events. */
    hook_rmEventParent(ev->id);
@@ -270,21 +278,35 @@ void event_remove( unsigned int eventid )
 void events_update( double dt )
 {
    int i, j;
+   double elapsed;
    Event_t *ev;
    char *tfunc;
 
+   /* Nothing armed. */
+   if (event_timerNext < 0.)
+      return;
+
+   /* Accrue time and bail until the soonest deadline could have passed. */
+   event_timerElapsed += dt;
+   if (event_timerElapsed < event_timerNext)
+      return;
+
+   /* Sweep, charging the accrued time to every armed timer. */
+   elapsed = event_timerElapsed;
+   event_timerElapsed = 0.;
+   event_timerNext    = -1.;
    for (i=0; i<event_nactive; i++) {
       ev = &event_active[i];
-     
+
       /* Decrement timers see if must run. */
       for (j=0; j<EVENT_TIMER_MAX; j++) {
 
          if (ev->timer[j] > 0.) {
 
-            ev->timer[j] -= dt;
+            ev->timer[j] -= elapsed;
 
             /* Timer is up - trigger function. */
-            if (ev->timer[j] < 0.) {
+            if (ev->timer[j] <= 0.) {
 
                /* Destroy timer. */
                ev->timer[j] = 0.;
@@ -297,12 +319,47 @@ void events_update( double dt )
                /* Free remainder stuff. */
                free(tfunc);
             }
+            /* Still running, candidate for the next deadline. */
+            else if ((event_timerNext < 0.) || (ev->timer[j] < event_timerNext))
+               event_timerNext = ev->timer[j];
          }
       }
    }
 }
 
 
+/**
+ * @brief Recomputes the soonest event timer deadline.
+ *
+ * Must be called whenever an event timer gets armed.
+ */
+void events_timerRecalc (void)
+{
+   int i, j;
+   Event_t *ev;
+
+   /* Charge the accrued time first so fresh timers start from now. */
+   if (event_timerElapsed > 0.) {
+      for (i=0; i<event_nactive; i++) {
+         ev = &event_active[i];
+         for (j=0; j<EVENT_TIMER_MAX; j++)
+            if (ev->timer[j] > 0.)
+               ev->timer[j] -= event_timerElapsed;
+      }
+      event_timerElapsed = 0.;
+   }
+
+   event_timerNext = -1.;
+   for (i=0; i<event_nactive; i++) {
+      ev = &event_active[i];
+      for (j=0; j<EVENT_TIMER_MAX; j++)
+         if ((ev->timer[j] > 0.) &&
+               ((event_timerNext < 0.) || (ev->timer[j] < event_timerNext)))
+            event_timerNext = ev->timer[j];
+   }
+}
+
+
 /**
  * @brief Check to see if an event is already running.
  *
@@ -332,12 +389,10 @@ static int event_alreadyRunning( int data )
  */
 void events_trigger( EventTrigger_t trigger )
 {
-   int i;
+   int i, j;
 
-   for (i=0; i<event_ndata; i++) {
-      /* Make sure trigger matches. */
-      if (event_data[i].trigger != trigger)
-         continue;
+   for (j=0; j<event_trigN[trigger]; j++) {
+      i = event_trigIdx[trigger][j];
 
       /* Make sure chance is succeeded. */
       if (RNGF() > event_data[i].chance)
@@ -413,6 +468,10 @@ static int event_parse( EventData_t *temp, const xmlNodePtr parent )
          
          if (strcmp(buf,"enter")==0)
             temp->trigger = EVENT_TRIGGER_ENTER;
+         else if (strcmp(buf,"land")==0)
+            temp->trigger = EVENT_TRIGGER_LAND;
+         else if (strcmp(buf,"takeoff")==0)
+            temp->trigger = EVENT_TRIGGER_TAKEOFF;
          else
             WARN("Event '%s' has invalid 'trigger' parameter: %s", temp->name, buf);
       }
@@ -455,7 +514,7 @@ static int event_parse( EventData_t *temp, const xmlNodePtr parent )
  */
 int events_load (void)
 {
-   int m;
+   int i, m;
    uint32_t bufsize;
    char *buf;
    xmlNodePtr node;
@@ -469,7 +528,7 @@ int events_load (void)
    }
 
    /* Load the document. */
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
    if (doc == NULL) {
       WARN("Unable to parse document '%s'", EVENT_DATA);
       return -1;
@@ -508,6 +567,27 @@ int events_load (void)
    /* Shrink to minimum. */
    event_data = realloc(event_data, sizeof(EventData_t)*event_ndata);
 
+   /* Build the trigger index and precompile the conditionals so the
+    * trigger points only walk relevant events with cached predicates. */
+   memset( event_trigN, 0, sizeof(event_trigN) );
+   for (i=0; i<event_ndata; i++)
+      if (event_data[i].trigger < EVENT_TRIGGER_MAX)
+         event_trigN[ event_data[i].trigger ]++;
+   for (i=0; i<EVENT_TRIGGER_MAX; i++) {
+      event_trigIdx[i] = (event_trigN[i] > 0) ?
+            malloc( sizeof(int) * event_trigN[i] ) : NULL;
+      event_trigN[i] = 0; /* reused as the fill cursor */
+   }
+   for (i=0; i<event_ndata; i++) {
+      if (event_data[i].trigger < EVENT_TRIGGER_MAX)
+         event_trigIdx[ event_data[i].trigger ][
+               event_trigN[ event_data[i].trigger ]++ ] = i;
+      if ((event_data[i].cond != NULL) &&
+            (cond_compile( event_data[i].cond ) != 0))
+         WARN("Event '%s' has a conditional that does not compile.",
+               event_data[i].name);
+   }
+
    /* Clean up. */                                                        
    xmlFreeDoc(doc);
    free(buf);
@@ -577,6 +657,14 @@ void events_exit (void)
    }
    event_data  = NULL;
    event_ndata = 0;
+
+   /* Free the trigger index. */
+   for (i=0; i<EVENT_TRIGGER_MAX; i++) {
+      if (event_trigIdx[i] != NULL)
+         free(event_trigIdx[i]);
+      event_trigIdx[i] = NULL;
+      event_trigN[i]   = 0;
+   }
 }
 
 
@@ -32,7 +32,10 @@ typedef struct Event_s {
  */
 typedef enum EventTrigger_s {
    EVENT_TRIGGER_NULL, /**< Invalid trigger. */
-   EVENT_TRIGGER_ENTER /**< Entering a system (jump/takeoff). */
+   EVENT_TRIGGER_ENTER, /**< Entering a system (jump/takeoff). */
+   EVENT_TRIGGER_LAND, /**< Landing on a planet. */
+   EVENT_TRIGGER_TAKEOFF, /**< Taking off from a planet. */
+   EVENT_TRIGGER_MAX /**< Sentinel, number of triggers. */
 } EventTrigger_t;
 
 
@@ -48,6 +51,7 @@ void events_cleanup (void);
  * Updating.
  */
 void events_update( double dt );
+void events_timerRecalc (void);
 
 
 /*
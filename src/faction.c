@@ -20,9 +20,11 @@
 
 #include "opengl.h"
 #include "log.h"
+#include "save.h"
 #include "ndata.h"
 #include "rng.h"
 #include "colour.h"
+#include "cond.h"
 
 
 #define XML_FACTION_ID     "Factions"   /**< XML section identifier */
@@ -68,6 +70,7 @@ typedef struct Faction_ {
 
    double player_def; /**< Default player standing. */
    double player; /**< Standing with player - from -100 to 100 */
+   glColour *pcol; /**< Cached standing colour, NULL until computed. */
 
    unsigned int flags; /**< Flags affecting the faction. */
 } Faction;
@@ -77,11 +80,36 @@ static Faction* faction_stack = NULL; /**< Faction stack. */
 static int faction_nstack = 0; /**< Number of factions in the faction stack. */
 
 
+/*
+ * Relationship bitmatrices, so the hot hostility checks are a bit test
+ *  instead of walking the enemy/ally arrays of both factions.  Only the
+ *  player's rows ever change after loading, when standing crosses a
+ *  threshold.
+ */
+static unsigned char *faction_enemyMatrix = NULL; /**< NxN enemy bitmatrix. */
+static unsigned char *faction_allyMatrix = NULL; /**< NxN ally bitmatrix. */
+static int faction_matrixStride = 0; /**< Bytes per bitmatrix row. */
+
+/*
+ * Standing change notification.  Bumped whenever a standing changes so
+ *  consumers caching derived state (colours, standing strings) can compare
+ *  a generation instead of recomputing every frame.
+ */
+static unsigned int faction_pgen = 1; /**< Player standing generation. */
+
+#define faction_matrixTest(m,a,b) \
+      ((m)[ (a)*faction_matrixStride + ((b)>>3) ] & (1 << ((b)&7))) /**< Tests relationship bit a->b. */
+
+
 /*
  * Prototypes
  */
 /* static */
 static int faction_isFaction( int f );
+static glColour* faction_standingColour( int f );
+static void faction_matrixSet( unsigned char *m, int a, int b, int set );
+static void faction_buildMatrices (void);
+static void faction_updatePlayerRelations( Faction* faction );
 static void faction_sanitizePlayer( Faction* faction );
 static int faction_parse( Faction* temp, xmlNodePtr parent );
 static void faction_parseSocial( xmlNodePtr parent );
@@ -110,6 +138,17 @@ int faction_get( const char* name )
 }
 
 
+/**
+ * @brief Gets the number of loaded factions.
+ *
+ * Faction ids are indices below this value.
+ */
+int faction_count (void)
+{
+   return faction_nstack;
+}
+
+
 /**
  * @brief Gets all the factions.
  */
@@ -246,6 +285,87 @@ static void faction_sanitizePlayer( Faction* faction )
       faction->player = 100.;
    else if (faction->player < -100.)
       faction->player = -100.;
+
+   /* Standing may have crossed a relationship threshold. */
+   faction_updatePlayerRelations(faction);
+
+   /* Mission conditions depending on standing must re-evaluate. */
+   cond_invalidate();
+}
+
+
+/**
+ * @brief Sets or clears a relationship bit symmetrically.
+ *
+ *    @param m Bitmatrix to modify.
+ *    @param a First faction.
+ *    @param b Second faction.
+ *    @param set Non-zero to set the bits, zero to clear them.
+ */
+static void faction_matrixSet( unsigned char *m, int a, int b, int set )
+{
+   if (set) {
+      m[ a*faction_matrixStride + (b>>3) ] |= 1 << (b&7);
+      m[ b*faction_matrixStride + (a>>3) ] |= 1 << (a&7);
+   }
+   else {
+      m[ a*faction_matrixStride + (b>>3) ] &= ~(1 << (b&7));
+      m[ b*faction_matrixStride + (a>>3) ] &= ~(1 << (a&7));
+   }
+}
+
+
+/**
+ * @brief Builds the relationship bitmatrices from the faction stack.
+ */
+static void faction_buildMatrices (void)
+{
+   int i, j;
+   Faction *f;
+
+   faction_matrixStride = (faction_nstack+7) / 8;
+   faction_enemyMatrix = calloc( faction_nstack, faction_matrixStride );
+   faction_allyMatrix = calloc( faction_nstack, faction_matrixStride );
+
+   for (i=0; i<faction_nstack; i++) {
+      f = &faction_stack[i];
+
+      /* A faction is always its own ally. */
+      faction_matrixSet( faction_allyMatrix, i, i, 1 );
+
+      for (j=0; j<f->nenemies; j++)
+         faction_matrixSet( faction_enemyMatrix, i, f->enemies[j], 1 );
+      for (j=0; j<f->nallies; j++)
+         faction_matrixSet( faction_allyMatrix, i, f->allies[j], 1 );
+   }
+
+   /* Player rows come from the standings. */
+   for (i=0; i<faction_nstack; i++)
+      faction_updatePlayerRelations( &faction_stack[i] );
+}
+
+
+/**
+ * @brief Refreshes the player's relationship bits with a faction.
+ *
+ *    @param faction Faction whose standing with the player changed.
+ */
+static void faction_updatePlayerRelations( Faction* faction )
+{
+   int f;
+
+   f = faction - faction_stack;
+
+   if ((faction_enemyMatrix != NULL) && (f != FACTION_PLAYER)) {
+      faction_matrixSet( faction_enemyMatrix, FACTION_PLAYER, f,
+            (faction->player < 0.) );
+      faction_matrixSet( faction_allyMatrix, FACTION_PLAYER, f,
+            (faction->player > PLAYER_ALLY) );
+   }
+
+   /* Refresh the cached colour and notify caching consumers. */
+   faction->pcol = faction_standingColour( f );
+   faction_pgen++;
 }
 
 
@@ -327,6 +447,8 @@ void faction_modPlayerRaw( int f, double mod )
 
    faction->player += mod;
    faction_sanitizePlayer(faction);
+
+   save_dirty(SAVE_FACTION);
 }
 
 
@@ -375,6 +497,20 @@ double faction_getPlayerDef( int f )
  *    @return Pointer to the colour.
  */
 glColour* faction_getColour( int f )
+{
+   if ((f >= 0) && (f < faction_nstack) && (faction_stack[f].pcol != NULL))
+      return faction_stack[f].pcol; /* Cached since the last change. */
+   return faction_standingColour( f );
+}
+
+
+/**
+ * @brief Computes the standing colour of a faction.
+ *
+ *    @param f Faction to compute the colour of.
+ *    @return Pointer to the colour.
+ */
+static glColour* faction_standingColour( int f )
 {
    if (f<0) return &cInert;
    else if (areAllies(FACTION_PLAYER,f)) return &cFriend;
@@ -383,6 +519,20 @@ glColour* faction_getColour( int f )
 }
 
 
+/**
+ * @brief Gets the player standing generation.
+ *
+ * Incremented every time a standing changes, so consumers that cache
+ *  colours or standing strings can skip recomputing them until it moves.
+ *
+ *    @return Current standing generation, never 0.
+ */
+unsigned int faction_playerGen (void)
+{
+   return faction_pgen;
+}
+
+
 #define STANDING(m,s)  if (mod >= m) return s /**< Hack to get standings easily. */
 /**
  * @brief Get's the player's standing in human readable form.
@@ -434,6 +584,11 @@ int areEnemies( int a, int b)
 
    if (a==b) return 0; /* luckily our factions aren't masochistic */
 
+   /* Fast path once the bitmatrix is built. */
+   if ((faction_enemyMatrix != NULL) &&
+         faction_isFaction(a) && faction_isFaction(b))
+      return (faction_matrixTest( faction_enemyMatrix, a, b ) != 0);
+
    /* player handled seperately */
    if (a==FACTION_PLAYER) {
       if (faction_isFaction(b)) {
@@ -501,6 +656,11 @@ int areAllies( int a, int b )
    /* If they are the same they must be allies. */
    if (a==b) return 1;
 
+   /* Fast path once the bitmatrix is built. */
+   if ((faction_allyMatrix != NULL) &&
+         faction_isFaction(a) && faction_isFaction(b))
+      return (faction_matrixTest( faction_allyMatrix, a, b ) != 0);
+
    /* we assume player becomes allies with high rating */
    if (a==FACTION_PLAYER) {
       if (faction_isFaction(b)) {
@@ -694,8 +854,10 @@ static void faction_parseSocial( xmlNodePtr parent )
 void factions_reset (void)
 {
    int i;
-   for (i=0; i<faction_nstack; i++)
+   for (i=0; i<faction_nstack; i++) {
       faction_stack[i].player = faction_stack[i].player_def;
+      faction_updatePlayerRelations( &faction_stack[i] );
+   }
 }
 
 
@@ -711,7 +873,7 @@ int factions_load (void)
    char *buf = ndata_read( FACTION_DATA, &bufsize);
 
    xmlNodePtr factions, node;
-   xmlDocPtr doc = xmlParseMemory( buf, bufsize );
+   xmlDocPtr doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode; /* Factions node */
    if (!xml_isNode(node,XML_FACTION_ID)) {
@@ -797,6 +959,9 @@ int factions_load (void)
    }
 #endif /* DEBUGGING */
 
+   /* Relationships are now known, build the lookup matrices. */
+   faction_buildMatrices();
+
    xmlFreeDoc(doc);
    free(buf);
 
@@ -828,6 +993,13 @@ void factions_free (void)
    free(faction_stack);
    faction_stack = NULL;
    faction_nstack = 0;
+
+   /* Free the relationship matrices. */
+   free(faction_enemyMatrix);
+   faction_enemyMatrix = NULL;
+   free(faction_allyMatrix);
+   faction_allyMatrix = NULL;
+   faction_matrixStride = 0;
 }
 
 
@@ -877,10 +1049,13 @@ int pfaction_load( xmlNodePtr parent )
          cur = node->xmlChildrenNode;
          do {
             if (xml_isNode(cur,"faction")) {
-               xmlr_attr(cur,"name",str); 
+               xmlr_attr(cur,"name",str);
                faction = faction_get(str);
-               if (faction != -1) /* Faction is valid. */
+               if (faction != -1) { /* Faction is valid. */
                   faction_stack[faction].player = xml_getFloat(cur);
+                  faction_updatePlayerRelations( &faction_stack[faction] );
+                  cond_invalidate();
+               }
                free(str);
             }
          } while (xml_nextNode(cur));
@@ -16,6 +16,7 @@
 
 /* get stuff */
 int faction_get( const char* name );
+int faction_count (void);
 int* faction_getAll( int *n );
 char* faction_name( int f );
 char* faction_longname( int f );
@@ -32,6 +33,7 @@ double faction_getPlayerDef( int f );
 char* faction_getStanding( double mod );
 char *faction_getStandingBroad( double mod );
 glColour* faction_getColour( int f );
+unsigned int faction_playerGen (void);
 
 /* works with only factions */
 int areEnemies( int a, int b );
@@ -247,7 +247,7 @@ static int fleet_loadFleets (void)
  
    /* Load the data. */
    buf = ndata_read( FLEET_DATA, &bufsize);
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode; /* fleets node */
    if (strcmp((char*)node->name,"Fleets")) {
@@ -362,7 +362,7 @@ static int fleet_loadFleetGroups (void)
   
    /* Create the document. */
    buf = ndata_read( FLEETGROUP_DATA, &bufsize);
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode; /* fleetgroups node. */
    if (strcmp((char*)node->name,"FleetGroups")) {
@@ -7,7 +7,11 @@
  *
  * @brief OpenGL font rendering routines.
  *
- * Use a displaylist to store ASCII chars rendered with freefont
+ * All the ASCII chars are baked into a single atlas texture at init and
+ * strings are assembled into quads drawn with one call, so text costs a
+ * single texture bind per string instead of a display list per glyph.
+ * Frequently drawn strings get their assembled quads cached in static
+ * VBOs so static labels cost no layout work at all.
  * There are several drawing methods depending on whether you want
  * print it all, print to a max width, print centered or print a
  * block of text.
@@ -33,17 +37,51 @@
 
 #define FONT_DEF  "dat/font.ttf" /**< Default font path. */
 
+#define FONT_MAX_GLYPHS 256 /**< Max glyphs assembled in one draw. */
+#define FONT_CACHE_SIZE 64 /**< Cached string layouts. */
+
 
 /* default font */
 glFont gl_defFont; /**< Default font. */
 glFont gl_smallFont; /**< Small font. */
 
 
+/**
+ * @struct FontCache
+ *
+ * @brief Cached layout of a string, ready to draw from a static VBO.
+ */
+typedef struct FontCache_ {
+   const glFont *font; /**< Font the string was laid out with. */
+   char *text; /**< Exact string that was cached. */
+   int nglyphs; /**< Number of quads in the VBO. */
+   gl_vbo *vbo; /**< Vertices then texture coordinates. */
+} FontCache;
+
+
+/*
+ * Shared rendering state.
+ */
+static gl_vbo *font_vbo = NULL; /**< Stream VBO for uncached strings. */
+static int font_nfonts = 0; /**< Loaded fonts, shared state refcount. */
+static FontCache font_cache[FONT_CACHE_SIZE]; /**< String layout cache. */
+static int font_cacheIdx = 0; /**< Round-robin eviction cursor. */
+#define FONT_MISS_SIZE  32 /**< Recently missed strings tracked. */
+#define FONT_MISS_LEN   96 /**< Longest string considered for caching. */
+static char font_missText[FONT_MISS_SIZE][FONT_MISS_LEN]; /**< Recent misses. */
+static const glFont *font_missFont[FONT_MISS_SIZE]; /**< Fonts of the misses. */
+static int font_missIdx = 0; /**< Round-robin miss cursor. */
+
+
 /*
  * prototypes
  */
-static void glFontMakeDList( FT_Face face, char ch,
-      GLuint list_base, GLuint *tex_base, int *width_base );
+static int font_genVBOData( const glFont *ft_font, GLfloat bx, GLfloat by,
+      const char *text, int n, GLfloat *vert, GLfloat *tex );
+static FontCache* font_cacheAdd( const glFont *ft_font, const char *text,
+      int n, int ng, GLfloat *vert, GLfloat *tex );
+static void font_renderText( const glFont *ft_font, double x, double y,
+      const char *text, int n );
 static int font_limitSize( const glFont *ft_font, int *width,
       const char *text, const int max );
 
@@ -124,6 +162,359 @@ int gl_printWidthForText( const glFont *ft_font, const char *text,
 }
 
 
+/**
+ * @brief Assembles the quads for a string.
+ *
+ * The position is composed into the vertices here so drawing needs no
+ *  matrix translation at all.
+ *
+ *    @param ft_font Font to lay the text out with.
+ *    @param bx X position to lay the text out at.
+ *    @param by Y position to lay the text out at.
+ *    @param text Text to lay out.
+ *    @param n Number of characters to process.
+ *    @param[out] vert Vertex positions, 4 per glyph.
+ *    @param[out] tex Texture coordinates, 4 per glyph.
+ *    @return Number of glyphs assembled.
+ */
+static int font_genVBOData( const glFont *ft_font, GLfloat bx, GLfloat by,
+      const char *text, int n, GLfloat *vert, GLfloat *tex )
+{
+   const glFontGlyph *g;
+   int i, ch, ng;
+   double x;
+
+   x  = 0.;
+   ng = 0;
+   for (i=0; i<n; i++) {
+      ch = (int)text[i];
+      if ((ch < 0) || (ch >= 128))
+         continue;
+      g = &ft_font->glyphs[ch];
+
+      /* Invisible glyphs still advance the pen. */
+      if ((g->gw > 0) && (g->gh > 0) && (ng < FONT_MAX_GLYPHS)) {
+         /* Top-left, top-right, bottom-right, bottom-left. */
+         vert[8*ng+0] = bx + (GLfloat)(x + g->offx);
+         vert[8*ng+1] = by + (GLfloat)(g->offy + g->gh);
+         vert[8*ng+2] = bx + (GLfloat)(x + g->offx + g->gw);
+         vert[8*ng+3] = vert[8*ng+1];
+         vert[8*ng+4] = vert[8*ng+2];
+         vert[8*ng+5] = by + (GLfloat)g->offy;
+         vert[8*ng+6] = vert[8*ng+0];
+         vert[8*ng+7] = vert[8*ng+5];
+
+         tex[8*ng+0] = g->tx;
+         tex[8*ng+1] = g->ty;
+         tex[8*ng+2] = g->tx + g->tw;
+         tex[8*ng+3] = g->ty;
+         tex[8*ng+4] = tex[8*ng+2];
+         tex[8*ng+5] = g->ty + g->th;
+         tex[8*ng+6] = g->tx;
+         tex[8*ng+7] = tex[8*ng+5];
+
+         ng++;
+      }
+
+      x += ft_font->w[ch];
+   }
+
+   return ng;
+}
+
+
+/**
+ * @brief Stores a laid-out string in the cache, evicting round-robin.
+ *
+ * The layout must have been generated at the origin so the VBO can draw
+ *  at any position.
+ *
+ *    @param ft_font Font the string was laid out with.
+ *    @param text String that was laid out.
+ *    @param n Number of characters of text.
+ *    @param ng Number of glyph quads in vert/tex.
+ *    @param vert Vertex data.
+ *    @param tex Texture coordinate data.
+ *    @return The cache entry filled in.
+ */
+static FontCache* font_cacheAdd( const glFont *ft_font, const char *text,
+      int n, int ng, GLfloat *vert, GLfloat *tex )
+{
+   FontCache *fc;
+
+   fc = &font_cache[ font_cacheIdx ];
+   font_cacheIdx = (font_cacheIdx+1) % FONT_CACHE_SIZE;
+   if (fc->vbo != NULL)
+      gl_vboDestroy(fc->vbo);
+   if (fc->text != NULL)
+      free(fc->text);
+   fc->font    = ft_font;
+   fc->text    = malloc(n+1);
+   memcpy( fc->text, text, n );
+   fc->text[n] = '\0';
+   fc->nglyphs = ng;
+   fc->vbo     = gl_vboCreateStatic( ng*16*sizeof(GLfloat), NULL );
+   gl_vboSubData( fc->vbo, 0, ng*8*sizeof(GLfloat), vert );
+   gl_vboSubData( fc->vbo, ng*8*sizeof(GLfloat), ng*8*sizeof(GLfloat), tex );
+
+   return fc;
+}
+
+
+/**
+ * @brief Pre-caches a string's layout so its first draw is already fast.
+ *
+ * Meant for text assembled once and then drawn every frame, like OSD
+ *  lines or player messages - the miss heuristic would cache them
+ *  eventually, but it can be starved when many new strings appear at
+ *  once.
+ *
+ *    @param ft_font Font to lay the string out with (NULL is gl_defFont).
+ *    @param text Text to pre-cache.
+ */
+void gl_printCacheRaw( const glFont *ft_font, const char *text )
+{
+   GLfloat vert[FONT_MAX_GLYPHS*8], tex[FONT_MAX_GLYPHS*8];
+   FontCache *fc;
+   int i, n, ng;
+
+   if (ft_font == NULL)
+      ft_font = &gl_defFont;
+   if (text == NULL)
+      return;
+   n = strlen(text);
+
+   /* Already cached. */
+   for (i=0; i<FONT_CACHE_SIZE; i++) {
+      fc = &font_cache[i];
+      if ((fc->font == ft_font) && (fc->text != NULL) &&
+            (strcmp( fc->text, text )==0))
+         return;
+   }
+
+   /* Lay out at the origin and store. */
+   ng = font_genVBOData( ft_font, 0., 0., text, n, vert, tex );
+   if (ng == 0)
+      return;
+   font_cacheAdd( ft_font, text, n, ng, vert, tex );
+}
+
+
+/**
+ * @brief Updates a caller owned text cache, laying the string out only
+ *  when it changed.
+ *
+ * The format step runs every call, but the layout and the VBO upload are
+ *  skipped while the resulting string stays the same, which is the common
+ *  case for GUI readouts like credits or free cargo space.
+ *
+ *    @param tc Text cache to update, zero initialized before first use.
+ *    @param ft_font Font to lay the string out with (NULL is gl_defFont).
+ *    @param fmt String formatted like printf to cache.
+ *    @return Width of the laid out string in pixels.
+ */
+int gl_printCacheUpdate( glTextCache *tc, const glFont *ft_font,
+      const char *fmt, ... )
+{
+   GLfloat vert[FONT_MAX_GLYPHS*8], tex[FONT_MAX_GLYPHS*8];
+   char text[256]; /* holds the string */
+   va_list ap;
+   int n, ng;
+
+   if (fmt == NULL) return 0;
+   else { /* convert the symbols to text */
+      va_start(ap, fmt);
+      vsnprintf(text, 256, fmt, ap);
+      va_end(ap);
+   }
+
+   if (ft_font == NULL)
+      ft_font = &gl_defFont;
+
+   /* Unchanged, the stored layout is still good. */
+   if ((tc->text != NULL) && (tc->font == ft_font) &&
+         (strcmp( tc->text, text )==0))
+      return tc->width;
+
+   /* Lay out at the origin, the draw translates. */
+   n  = strlen(text);
+   ng = font_genVBOData( ft_font, 0., 0., text, n, vert, tex );
+   if (tc->vbo != NULL) {
+      gl_vboDestroy(tc->vbo);
+      tc->vbo = NULL;
+   }
+   if (tc->text != NULL)
+      free(tc->text);
+   tc->font    = ft_font;
+   tc->text    = malloc(n+1);
+   memcpy( tc->text, text, n+1 );
+   tc->nglyphs = ng;
+   tc->width   = gl_printWidthRaw( ft_font, text );
+   if (ng > 0) {
+      tc->vbo = gl_vboCreateStatic( ng*16*sizeof(GLfloat), NULL );
+      gl_vboSubData( tc->vbo, 0, ng*8*sizeof(GLfloat), vert );
+      gl_vboSubData( tc->vbo, ng*8*sizeof(GLfloat),
+            ng*8*sizeof(GLfloat), tex );
+   }
+
+   return tc->width;
+}
+
+
+/**
+ * @brief Draws a caller owned text cache at a position.
+ *
+ * Pair with gl_printCacheUpdate(), which does the layout work.
+ *
+ *    @param tc Text cache to draw.
+ *    @param x X position to draw the text at.
+ *    @param y Y position to draw the text at.
+ *    @param c Colour to use (uses white if NULL).
+ */
+void gl_printCachedRaw( glTextCache *tc,
+      const double x, const double y, const glColour *c )
+{
+   if ((tc->vbo == NULL) || (tc->nglyphs == 0))
+      return;
+
+   glEnable(GL_TEXTURE_2D);
+   glBindTexture( GL_TEXTURE_2D, tc->font->texture );
+
+   if (c==NULL) glColor4d( 1., 1., 1., 1. );
+   else COLOUR(*c);
+
+   glMatrixMode(GL_MODELVIEW);
+   glPushMatrix(); /* translation matrix */
+      glTranslated( round(x-(double)SCREEN_W/2.),
+            round(y-(double)SCREEN_H/2.), 0. );
+   gl_vboActivateOffset( tc->vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( tc->vbo, GL_TEXTURE_COORD_ARRAY,
+         tc->nglyphs*8*sizeof(GLfloat), 2, GL_FLOAT, 0 );
+   glDrawArrays( GL_QUADS, 0, 4*tc->nglyphs );
+   gl_vboDeactivate();
+   glPopMatrix(); /* translation matrix */
+
+   glDisable(GL_TEXTURE_2D);
+
+   gl_checkErr();
+}
+
+
+/**
+ * @brief Releases the layout held by a caller owned text cache.
+ *
+ *    @param tc Text cache to free.
+ */
+void gl_printCacheFree( glTextCache *tc )
+{
+   if (tc->vbo != NULL)
+      gl_vboDestroy(tc->vbo);
+   if (tc->text != NULL)
+      free(tc->text);
+   memset( tc, 0, sizeof(glTextCache) );
+}
+
+
+/**
+ * @brief Draws n characters of text at a position.
+ *
+ * Looks the string up in the layout cache first; on a miss the quads are
+ *  assembled with the position composed in, so no matrix calls are made.
+ *  Cached strings are laid out at the origin so their static VBO can draw
+ *  anywhere, they take a single translation.  The atlas texture must
+ *  already be bound.
+ *
+ *    @param ft_font Font to use.
+ *    @param x X position to draw the text at.
+ *    @param y Y position to draw the text at.
+ *    @param text Text to draw.
+ *    @param n Number of characters to draw.
+ */
+static void font_renderText( const glFont *ft_font, double x, double y,
+      const char *text, int n )
+{
+   GLfloat vert[FONT_MAX_GLYPHS*8], tex[FONT_MAX_GLYPHS*8];
+   FontCache *fc;
+   int i, ng, seen;
+
+   /* See if the layout is already cached. */
+   for (i=0; i<FONT_CACHE_SIZE; i++) {
+      fc = &font_cache[i];
+      if ((fc->font == ft_font) && (fc->text != NULL) &&
+            (strncmp( fc->text, text, n )==0) && (fc->text[n] == '\0')) {
+         glMatrixMode(GL_MODELVIEW);
+         glPushMatrix(); /* translation matrix */
+            glTranslated( x, y, 0. );
+         gl_vboActivateOffset( fc->vbo, GL_VERTEX_ARRAY,
+               0, 2, GL_FLOAT, 0 );
+         gl_vboActivateOffset( fc->vbo, GL_TEXTURE_COORD_ARRAY,
+               fc->nglyphs*8*sizeof(GLfloat), 2, GL_FLOAT, 0 );
+         glDrawArrays( GL_QUADS, 0, 4*fc->nglyphs );
+         gl_vboDeactivate();
+         glPopMatrix(); /* translation matrix */
+         return;
+      }
+   }
+
+   /* Lay the string out with the position composed into the vertices. */
+   ng = font_genVBOData( ft_font, (GLfloat)x, (GLfloat)y, text, n, vert, tex );
+   if (ng == 0)
+      return;
+
+   /* Only cache a string once it's been drawn twice, so text that
+    * changes every frame doesn't churn static VBOs. */
+   seen = 0;
+   if (n < FONT_MISS_LEN) {
+      for (i=0; i<FONT_MISS_SIZE; i++) {
+         if ((font_missFont[i] == ft_font) &&
+               (strncmp( font_missText[i], text, n )==0) &&
+               (font_missText[i][n] == '\0')) {
+            seen = 1;
+            font_missFont[i] = NULL;
+            break;
+         }
+      }
+   }
+   if (seen) {
+      /* Re-lay at the origin so the cached VBO can draw at any position. */
+      ng = font_genVBOData( ft_font, 0., 0., text, n, vert, tex );
+      fc = font_cacheAdd( ft_font, text, n, ng, vert, tex );
+
+      /* Draw from the fresh cache entry. */
+      glMatrixMode(GL_MODELVIEW);
+      glPushMatrix(); /* translation matrix */
+         glTranslated( x, y, 0. );
+      gl_vboActivateOffset( fc->vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+      gl_vboActivateOffset( fc->vbo, GL_TEXTURE_COORD_ARRAY,
+            ng*8*sizeof(GLfloat), 2, GL_FLOAT, 0 );
+      glDrawArrays( GL_QUADS, 0, 4*ng );
+      gl_vboDeactivate();
+      glPopMatrix(); /* translation matrix */
+      return;
+   }
+
+   /* Remember the miss for possible promotion. */
+   if (n < FONT_MISS_LEN) {
+      memcpy( font_missText[font_missIdx], text, n );
+      font_missText[font_missIdx][n] = '\0';
+      font_missFont[font_missIdx]    = ft_font;
+      font_missIdx = (font_missIdx+1) % FONT_MISS_SIZE;
+   }
+
+   /* Draw from the shared stream VBO, orphaning since every string
+    *  rewrites it while the previous draw may still be reading it. */
+   gl_vboOrphan( font_vbo );
+   gl_vboSubData( font_vbo, 0, ng*8*sizeof(GLfloat), vert );
+   gl_vboSubData( font_vbo, FONT_MAX_GLYPHS*8*sizeof(GLfloat),
+         ng*8*sizeof(GLfloat), tex );
+   gl_vboActivateOffset( font_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( font_vbo, GL_TEXTURE_COORD_ARRAY,
+         FONT_MAX_GLYPHS*8*sizeof(GLfloat), 2, GL_FLOAT, 0 );
+   glDrawArrays( GL_QUADS, 0, 4*ng );
+   gl_vboDeactivate();
+}
+
+
 /**
  * @brief Prints text on screen.
  *
@@ -143,19 +534,48 @@ void gl_printRaw( const glFont *ft_font,
       ft_font = &gl_defFont;
 
    glEnable(GL_TEXTURE_2D);
+   glBindTexture( GL_TEXTURE_2D, ft_font->texture );
 
-   glListBase(ft_font->list_base);
+   if (c==NULL) glColor4d( 1., 1., 1., 1. );
+   else COLOUR(*c);
+   font_renderText( ft_font, round(x-(double)SCREEN_W/2.),
+         round(y-(double)SCREEN_H/2.), text, strlen(text) );
 
-   glMatrixMode(GL_MODELVIEW);
-   glPushMatrix(); /* translation matrix */
-      glTranslated( round(x-(double)SCREEN_W/2.),
-            round(y-(double)SCREEN_H/2.), 0);
+   glDisable(GL_TEXTURE_2D);
+
+   gl_checkErr();
+}
+
+
+/**
+ * @brief Prints the first n characters of text on screen.
+ *
+ * Does no layout work of its own, so callers that have already computed
+ *  how much of the string fits (see gl_printFit) can redraw it every
+ *  frame without rescanning it.
+ *
+ *    @param ft_font Font to use (NULL means gl_defFont).
+ *    @param x X position to put text at.
+ *    @param y Y position to put text at.
+ *    @param c Colour to use (uses white if NULL).
+ *    @param text String to display.
+ *    @param n Number of characters to display.
+ */
+void gl_printNRaw( const glFont *ft_font,
+      const double x, const double y,
+      const glColour* c, const char *text, const int n )
+{
+   if (ft_font == NULL)
+      ft_font = &gl_defFont;
+
+   glEnable(GL_TEXTURE_2D);
+   glBindTexture( GL_TEXTURE_2D, ft_font->texture );
 
    if (c==NULL) glColor4d( 1., 1., 1., 1. );
    else COLOUR(*c);
-   glCallLists(strlen(text), GL_UNSIGNED_BYTE, text);
+   font_renderText( ft_font, round(x-(double)SCREEN_W/2.),
+         round(y-(double)SCREEN_H/2.), text, n );
 
-   glPopMatrix(); /* translation matrix */
    glDisable(GL_TEXTURE_2D);
 
    gl_checkErr();
@@ -219,19 +639,13 @@ int gl_printMaxRaw( const glFont *ft_font, const int max,
 
    /* display the text */
    glEnable(GL_TEXTURE_2D);
-
-   glListBase(ft_font->list_base);
-
-   glMatrixMode(GL_MODELVIEW); /* using MODELVIEW, PROJECTION gets full fast */
-   glPushMatrix(); /* translation matrix */
-      glTranslated( round(x-(double)SCREEN_W/2.),
-            round(y-(double)SCREEN_H/2.), 0);
+   glBindTexture( GL_TEXTURE_2D, ft_font->texture );
 
    if (c==NULL) glColor4d( 1., 1., 1., 1. );
    else COLOUR(*c);
-   glCallLists(ret, GL_UNSIGNED_BYTE, text);
+   font_renderText( ft_font, round(x-(double)SCREEN_W/2.),
+         round(y-(double)SCREEN_H/2.), text, ret );
 
-   glPopMatrix(); /* translation matrix */
    glDisable(GL_TEXTURE_2D);
 
    gl_checkErr();
@@ -302,19 +716,13 @@ int gl_printMidRaw( const glFont *ft_font, const int width,
 
    /* display the text */
    glEnable(GL_TEXTURE_2D);
-
-   glListBase(ft_font->list_base);
-
-   glMatrixMode(GL_MODELVIEW); /* using MODELVIEW, PROJECTION gets full fast */
-   glPushMatrix(); /* translation matrix */
-      glTranslated( round(x-(double)SCREEN_W/2.),
-            round(y-(double)SCREEN_H/2.), 0);
+   glBindTexture( GL_TEXTURE_2D, ft_font->texture );
 
    if (c==NULL) glColor4d( 1., 1., 1., 1. );
    else COLOUR(*c);
-   glCallLists(ret, GL_UNSIGNED_BYTE, text);
+   font_renderText( ft_font, round(x-(double)SCREEN_W/2.),
+         round(y-(double)SCREEN_H/2.), text, ret );
 
-   glPopMatrix(); /* translation matrix */
    glDisable(GL_TEXTURE_2D);
 
    gl_checkErr();
@@ -386,7 +794,7 @@ int gl_printTextRaw( const glFont *ft_font,
 
    /* prepare ze opengl */
    glEnable(GL_TEXTURE_2D);
-   glListBase(ft_font->list_base);
+   glBindTexture( GL_TEXTURE_2D, ft_font->texture );
    if (c==NULL) glColor4d( 1., 1., 1., 1. );
    else COLOUR(*c);
 
@@ -394,13 +802,8 @@ int gl_printTextRaw( const glFont *ft_font,
    while (y - by > -1e-5) {
       i = gl_printWidthForText( ft_font, &text[p], width );
 
-      glMatrixMode(GL_MODELVIEW); /* using MODELVIEW, PROJECTION gets full fast */
-      glPushMatrix(); /* translation matrix */
-         glTranslated( round(x), round(y), 0);
-
-      glCallLists(i, GL_UNSIGNED_BYTE, &text[p]); /* the actual displaying */
-
-      glPopMatrix(); /* translation matrix */
+      /* the actual displaying */
+      font_renderText( ft_font, round(x), round(y), &text[p], i );
 
       if (text[p+i] == '\0')
          break;
@@ -451,6 +854,25 @@ int gl_printText( const glFont *ft_font,
 }
 
 
+/**
+ * @brief Gets the number of characters of text that fit into max pixels.
+ *
+ * Does not display text on screen.
+ *
+ *    @param ft_font Font to use (NULL defaults to gl_defFont).
+ *    @param text Text to check.
+ *    @param max Maximum width in pixels.
+ *    @return Number of characters that fit.
+ */
+int gl_printFit( const glFont *ft_font, const char *text, const int max )
+{
+   if (ft_font == NULL)
+      ft_font = &gl_defFont;
+
+   return font_limitSize( ft_font, NULL, text, max );
+}
+
+
 /**
  * @brief Gets the width that it would take to print some text.
  *
@@ -565,109 +987,12 @@ int gl_printHeight( const glFont *ft_font,
  * G L _ F O N T
  *
  */
-/**
- * @brief Makes the font display list.
- *
- * Basically taken from NeHe lesson 43
- * http://nehe.gamedev.net/data/lessons/lesson.asp?lesson=43
- */
-static void glFontMakeDList( FT_Face face, char ch,
-      GLuint list_base, GLuint *tex_base, int* width_base )
-{
-   FT_Bitmap bitmap;
-   GLubyte* expanded_data;
-   FT_GlyphSlot slot;
-   int w,h;
-   int i,j;
-   double x,y;
-
-   slot = face->glyph; /* Small shortcut. */
-
-   /* Load the glyph. */
-   if (FT_Load_Char( face, ch, FT_LOAD_RENDER )) {
-      WARN("FT_Load_Char failed.");
-      return;
-   }
-
-   bitmap = slot->bitmap; /* to simplify */
-
-   /* need the POT wrapping for opengl */
-   w = gl_pot(bitmap.width);
-   h = gl_pot(bitmap.rows);
-
-   /* memory for textured data
-    * bitmap is using two channels, one for luminosity and one for alpha */
-   expanded_data = (GLubyte*) malloc(sizeof(GLubyte)*2* w*h + 1);
-   for (j=0; j < h; j++) {
-      for (i=0; i < w; i++ ) {
-         expanded_data[2*(i+j*w)] = 0xcf; /* Set LUMINANCE to constant. */
-         expanded_data[2*(i+j*w)+1] = /* Alpha varies with bitmap. */
-               ((i>=bitmap.width) || (j>=bitmap.rows)) ?
-                  0 : bitmap.buffer[i + bitmap.width*j];
-      }
-   }
-
-   /* creating the opengl texture */
-   glBindTexture( GL_TEXTURE_2D, tex_base[(int)ch]);
-   if (gl_screen.scale == 1.) {
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-   }
-   else {
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-   }
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0,
-         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, expanded_data );
-
-   free(expanded_data); /* no use for this anymore */
-
-   /* creating of the display list */
-   glNewList(list_base+ch,GL_COMPILE);
-
-   /* corrects a spacing flaw between letters and
-    * downwards correction for letters like g or y */
-   glPushMatrix();
-      glTranslated( (double)slot->bitmap_left, (double)(slot->bitmap_top-bitmap.rows), 0. );
-
-   /* take into account opengl POT wrapping */
-   x = (double)bitmap.width/(double)w;
-   y = (double)bitmap.rows/(double)h;
-
-   /* draw the texture mapped QUAD */
-   glBindTexture(GL_TEXTURE_2D,tex_base[(int)ch]);
-   glBegin( GL_QUADS );
-
-      glTexCoord2d( 0., 0. );
-         glVertex2d( 0., (double)bitmap.rows );
-
-      glTexCoord2d( x, 0. );
-         glVertex2d( (double)bitmap.width, (double)bitmap.rows );
-
-      glTexCoord2d( x, y );
-         glVertex2d( (double)bitmap.width, 0. );
-
-      glTexCoord2d( 0., y );
-         glVertex2d( 0., 0. );
-
-   glEnd(); /* GL_QUADS */
-
-   glPopMatrix(); /* translation matrix */
-   glTranslated( (double)(slot->advance.x >> 6), (double)(slot->advance.y >> 6), 0. );
-   width_base[(int)ch] = slot->advance.x >> 6;
-
-   /* end of display list */
-   glEndList();
-
-   gl_checkErr();
-}
-
-
 /**
  * @brief Initializes a font.
  *
+ * Bakes all the glyphs into a single atlas texture and records their
+ *  metrics so strings can be assembled into quads.
+ *
  *    @param font Font to load (NULL defaults to gl_defFont).
  *    @param fname Name of the font (from inside packfile, NULL defaults to default font).
  *    @param h Height of the font to generate.
@@ -676,9 +1001,14 @@ void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
 {
    FT_Library library;
    FT_Face face;
+   FT_GlyphSlot slot;
+   FT_Bitmap bitmap;
    uint32_t bufsize;
-   int i;
+   int i, j, k;
    FT_Byte* buf;
+   GLubyte* expanded_data;
+   glFontGlyph *g;
+   int maxw, maxh, cw, ch, tw, th, cx, cy;
 
    /* Get default font if not set. */
    if (font == NULL)
@@ -692,10 +1022,9 @@ void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
    }
 
    /* Allocage. */
-   font->textures = malloc(sizeof(GLuint)*128);
    font->w = malloc(sizeof(int)*128);
    font->h = (int)floor((double)h * gl_screen.scale);
-   if ((font->textures==NULL) || (font->w==NULL)) {
+   if (font->w==NULL) {
       WARN("Out of memory!");
       return;
    }
@@ -730,13 +1059,96 @@ void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
    if (FT_Select_Charmap( face, FT_ENCODING_UNICODE ))
       WARN("FT_Select_Charmap failed to change character mapping.");
 
-   /* have OpenGL allocate space for the textures / display list */
-   font->list_base = glGenLists(128);
-   glGenTextures( 128, font->textures );
+   slot = face->glyph; /* Small shortcut. */
+
+   /* First pass, see how big the atlas cells have to be. */
+   maxw = 1;
+   maxh = 1;
+   for (i=0; i<128; i++) {
+      if (FT_Load_Char( face, i, FT_LOAD_RENDER ))
+         continue;
+      maxw = MAX( maxw, (int)slot->bitmap.width );
+      maxh = MAX( maxh, (int)slot->bitmap.rows );
+   }
+
+   /* 16x8 grid of cells, padded a pixel so filtering doesn't bleed. */
+   cw = maxw + 1;
+   ch = maxh + 1;
+   tw = gl_pot( 16*cw );
+   th = gl_pot( 8*ch );
+
+   /* Bitmap is using two channels, one for luminosity and one for alpha.
+    * Luminance is set everywhere so linear filtering at glyph edges
+    * doesn't darken the antialiasing fringe. */
+   expanded_data = malloc( sizeof(GLubyte)*2*tw*th );
+   for (i=0; i<tw*th; i++) {
+      expanded_data[2*i]   = 0xcf;
+      expanded_data[2*i+1] = 0x00;
+   }
+
+   /* Second pass, render each glyph into its cell. */
+   for (i=0; i<128; i++) {
+      g = &font->glyphs[i];
+      g->tx   = 0.;
+      g->ty   = 0.;
+      g->tw   = 0.;
+      g->th   = 0.;
+      g->gw   = 0;
+      g->gh   = 0;
+      g->offx = 0;
+      g->offy = 0;
+      font->w[i] = 0;
+
+      if (FT_Load_Char( face, i, FT_LOAD_RENDER )) {
+         WARN("FT_Load_Char failed.");
+         continue;
+      }
+      bitmap = slot->bitmap; /* to simplify */
+
+      /* Blit into the cell. */
+      cx = (i % 16) * cw;
+      cy = (i / 16) * ch;
+      for (j=0; j < (int)bitmap.rows; j++)
+         for (k=0; k < (int)bitmap.width; k++)
+            expanded_data[ 2*((cx+k) + (cy+j)*tw) + 1 ] =
+                  bitmap.buffer[ k + bitmap.width*j ];
+
+      /* Glyph metrics. */
+      g->tx   = (GLfloat)cx / (GLfloat)tw;
+      g->ty   = (GLfloat)cy / (GLfloat)th;
+      g->tw   = (GLfloat)bitmap.width / (GLfloat)tw;
+      g->th   = (GLfloat)bitmap.rows / (GLfloat)th;
+      g->gw   = bitmap.width;
+      g->gh   = bitmap.rows;
+      g->offx = slot->bitmap_left;
+      g->offy = slot->bitmap_top - bitmap.rows;
+      font->w[i] = slot->advance.x >> 6;
+   }
+
+   /* Upload the atlas. */
+   glGenTextures( 1, &font->texture );
+   glBindTexture( GL_TEXTURE_2D, font->texture );
+   if (gl_screen.scale == 1.) {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   }
+   else {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   }
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, tw, th, 0,
+         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, expanded_data );
+   free(expanded_data);
 
-   /* create each of the font display lists */
-   for (i=0; i<128; i++)
-      glFontMakeDList( face, i, font->list_base, font->textures, font->w );
+   /* Create the shared stream VBO on the first font. */
+   if (font_vbo == NULL)
+      font_vbo = gl_vboCreateStream(
+            FONT_MAX_GLYPHS*16*sizeof(GLfloat), NULL );
+   font_nfonts++;
+
+   gl_checkErr();
 
    /* we can now free the face and library */
    FT_Done_Face(face);
@@ -751,10 +1163,34 @@ void gl_fontInit( glFont* font, const char *fname, const unsigned int h )
  */
 void gl_freeFont( glFont* font )
 {
+   int i;
+   FontCache *fc;
+
    if (font == NULL)
       font = &gl_defFont;
-   glDeleteLists(font->list_base,128);
-   glDeleteTextures(128,font->textures);
-   free(font->textures);
+
+   /* Drop cached layouts using this font. */
+   for (i=0; i<FONT_CACHE_SIZE; i++) {
+      fc = &font_cache[i];
+      if (fc->font != font)
+         continue;
+      if (fc->vbo != NULL)
+         gl_vboDestroy(fc->vbo);
+      if (fc->text != NULL)
+         free(fc->text);
+      memset( fc, 0, sizeof(FontCache) );
+   }
+   for (i=0; i<FONT_MISS_SIZE; i++)
+      if (font_missFont[i] == font)
+         font_missFont[i] = NULL;
+
+   glDeleteTextures(1,&font->texture);
    free(font->w);
+
+   /* Last font out frees the shared stream VBO. */
+   font_nfonts--;
+   if ((font_nfonts <= 0) && (font_vbo != NULL)) {
+      gl_vboDestroy(font_vbo);
+      font_vbo = NULL;
+   }
 }
@@ -11,6 +11,22 @@
 #include "opengl.h"
 
 
+/**
+ * @struct glFontGlyph
+ *
+ * @brief Metrics and atlas position of a single glyph.
+ */
+typedef struct glFontGlyph_ {
+   GLfloat tx; /**< Atlas X texture coordinate. */
+   GLfloat ty; /**< Atlas Y texture coordinate. */
+   GLfloat tw; /**< Atlas texture coordinate width. */
+   GLfloat th; /**< Atlas texture coordinate height. */
+   int gw; /**< Glyph bitmap width. */
+   int gh; /**< Glyph bitmap height. */
+   int offx; /**< Horizontal drawing offset. */
+   int offy; /**< Vertical drawing offset. */
+} glFontGlyph;
+
 /**
  * @struct glFont
  *
@@ -18,13 +34,31 @@
  */
 typedef struct glFont_ {
    int h; /**< Font height. */
-   int* w; /**< Width of each font member. */
-   GLuint *textures; /**< Textures in the font. */
-   GLuint list_base; /**< Display list base. */
+   int* w; /**< X advance of each font member. */
+   GLuint texture; /**< Atlas texture all the glyphs are baked into. */
+   glFontGlyph glyphs[128]; /**< Per-glyph metrics and atlas position. */
 } glFont;
 extern glFont gl_defFont; /**< default font */
 extern glFont gl_smallFont; /**< small font */
 
+/**
+ * @struct glTextCache
+ *
+ * @brief Caller owned cached text layout.
+ *
+ * For readouts redrawn every frame whose string rarely changes, the
+ *  handle keeps its own static VBO so drawing skips the shared layout
+ *  cache entirely.  Zero initialize before first use and release with
+ *  gl_printCacheFree().
+ */
+typedef struct glTextCache_ {
+   const glFont *font; /**< Font the string was laid out with. */
+   char *text; /**< String currently laid out. */
+   int nglyphs; /**< Glyph quads in the layout. */
+   int width; /**< Width of the layout in pixels. */
+   gl_vbo *vbo; /**< Static VBO, vertices then texture coordinates. */
+} glTextCache;
+
 
 /*
  * glFont loading / freeing
@@ -41,6 +75,9 @@ void gl_freeFont( glFont* font );
 void gl_printRaw( const glFont *ft_font,
       const double x, const double y,
       const glColour* c, const char *text );
+void gl_printNRaw( const glFont *ft_font,
+      const double x, const double y,
+      const glColour* c, const char *text, const int n );
 int gl_printMaxRaw( const glFont *ft_font, const int max,
       const double x, const double y,
       const glColour* c, const char *text );
@@ -74,9 +111,18 @@ int gl_printText( const glFont *ft_font,
       glColour* c, const char *fmt, ... );
 
 
+/* Cache stuff. */
+void gl_printCacheRaw( const glFont *ft_font, const char *text );
+int gl_printCacheUpdate( glTextCache *tc, const glFont *ft_font,
+      const char *fmt, ... );
+void gl_printCachedRaw( glTextCache *tc,
+      const double x, const double y, const glColour *c );
+void gl_printCacheFree( glTextCache *tc );
+
 /* Dimension stuff. */
 int gl_printWidthForText( const glFont *ft_font, const char *text,
       const int width );
+int gl_printFit( const glFont *ft_font, const char *text, const int max );
 int gl_printWidthRaw( const glFont *ft_font, const char *text );
 int gl_printWidth( const glFont *ft_font, const char *fmt, ... );
 int gl_printHeightRaw( const glFont *ft_font, const int width, const char *text );
@@ -58,25 +58,41 @@
 #define TARGET_WIDTH 128 /**< Width of target graphics. */
 #define TARGET_HEIGHT 96 /**< Height of target graphics. */
 
-#define INTERFERENCE_LAYERS      16 /**< Number of interference layers. */
 #define INTERFERENCE_CHANGE_DT   0.1 /**< Speed to change at. */
+#define INTERFERENCE_NOISE_SIZE  256 /**< Side of the shared noise texture. */
 
 #define RADAR_BLINK_PILOT        1. /**< Blink rate of the pilot target on radar. */
 #define RADAR_BLINK_PLANET       1. /**< Blink rate of the planet target on radar. */
 
 
 /* for interference. */
-static int interference_layer = 0; /**< Layer of the current interference. */
 double interference_alpha     = 0.; /**< Alpha of the current interference layer. */
 static double interference_t  = 0.; /**< Interference timer to control transitions. */
+static double interference_u  = 0.; /**< U offset of the noise window. */
+static double interference_v  = 0.; /**< V offset of the noise window. */
+static glTexture *interference_tex = NULL; /**< Shared tileable noise texture. */
+static gl_vbo *interference_vbo = NULL; /**< Quad for the interference draw. */
 
 /* some blinking stuff. */
 static double blink_pilot     = 0.; /**< Timer on target blinking on radar. */
 static double blink_planet    = 0.; /**< Timer on planet blinking on radar. */
 
-/* for VBO. */
-static gl_vbo *gui_vbo = NULL; /**< GUI VBO. */
+/* border marker batching - every off-screen planet/pilot marker is
+ *  accumulated as line segments and drawn with a single call. */
+#define BORDER_VERT_MAX    1024 /**< Vertices in the border marker batch. */
+static gl_vbo *gui_vbo = NULL; /**< GUI VBO, holds the border batch. */
 static GLsizei gui_vboColourOffset = 0; /**< Offset of colour pixels. */
+static GLfloat border_vertex[BORDER_VERT_MAX*2]; /**< Staging vertices. */
+static GLfloat border_colour[BORDER_VERT_MAX*4]; /**< Staging colours. */
+static int border_nv = 0; /**< Vertices queued this frame. */
+
+/* radar blip batching. */
+#define RADAR_MAX_BLIPS    256 /**< Maximum pilot blips batched per frame. */
+static gl_vbo *radar_vbo = NULL; /**< Persistent stream VBO for radar blips. */
+static GLsizei radar_vboColourOffset = 0; /**< Offset of blip colour data. */
+static GLfloat radar_vertex[RADAR_MAX_BLIPS*2*4]; /**< Staging blip vertices. */
+static GLfloat radar_colour[RADAR_MAX_BLIPS*4*4]; /**< Staging blip colours. */
+static int radar_nblips = 0; /**< Number of blips queued this frame. */
 
 /*
  * pilot stuff for GUI
@@ -102,7 +118,7 @@ typedef struct Radar_ {
    double h; /**< Height. */
    RadarShape shape; /**< Shape */
    double res; /**< Resolution */
-   glTexture *interference[INTERFERENCE_LAYERS]; /**< Interference texture. */
+   glTexture *mask; /**< Alpha mask for the circular radar, NULL for rect. */
 } Radar;
 /* radar resolutions */
 #define RADAR_RES_MAX      100. /**< Maximum radar resolution. */
@@ -179,6 +195,10 @@ static GUI gui = { .gfx_frame = NULL,
 static double gui_xoff = 0.; /**< X Offset that GUI introduces. */
 static double gui_yoff = 0.; /**< Y offset that GUI introduces. */
 
+/* cached readouts, they only relayout when the value changes */
+static glTextCache gui_creditsText; /**< Credits readout. */
+static glTextCache gui_cargoText; /**< Free cargo space readout. */
+
 /* messages */
 #define MESG_SIZE_MAX   120 /**< Maxmimu message length. */
 double mesg_timeout = 5.; /**< How long it takes for a message to timeout. */
@@ -192,7 +212,28 @@ typedef struct Mesg_ {
    char str[MESG_SIZE_MAX]; /**< The message. */
    double t; /**< Timer related to message. */
 } Mesg;
-static Mesg* mesg_stack = NULL; /**< Stack of mesages, will be of mesg_max size. */
+static Mesg* mesg_stack = NULL; /**< Ring of messages, will be of mesg_max size. */
+static int mesg_head = 0; /**< Slot holding the newest message. */
+
+
+/**
+ * @struct GuiCache
+ *
+ * @brief A parsed GUI definition kept for the session.
+ *
+ * Ship switches swap GUIs constantly, so instead of re-reading the XML
+ *  and reloading the textures every time, each GUI is parsed once and
+ *  its state snapshotted here.  The cache owns the textures; the active
+ *  gui struct only borrows them.
+ */
+typedef struct GuiCache_ {
+   struct GuiCache_ *next; /**< Next cached GUI. */
+   char *name; /**< GUI name the entry is keyed by. */
+   GUI gui; /**< Parsed state, textures included. */
+   double xoff; /**< Parsed X offset. */
+   double yoff; /**< Parsed Y offset. */
+} GuiCache;
+static GuiCache *gui_cache = NULL; /**< Cached GUI definitions. */
 
 
 /* 
@@ -215,9 +256,12 @@ static void rect_parse( const xmlNodePtr parent,
 static int gui_parseBar( xmlNodePtr parent, HealthBar *bar, const glColour *col );
 static int gui_parse( const xmlNodePtr parent, const char *name );
 static void gui_cleanupBar( HealthBar *bar );
+static void gui_cacheAdd( const char *name );
+static void gui_cacheFree (void);
 /* Render GUI. */
 static void gui_renderPilotTarget( double dt );
 static void gui_renderPlanetTarget( double dt );
+static void gui_borderPoint( double x, double y, const glColour *col, double a );
 static void gui_renderBorder( double dt );
 static void gui_renderRadar( double dt );
 static void gui_renderMessages( double dt );
@@ -225,6 +269,9 @@ static glColour *gui_getPlanetColour( int i );
 static void gui_renderPlanet( int i );
 static glColour* gui_getPilotColour( const Pilot* p );
 static void gui_renderPilot( const Pilot* p );
+static void gui_addBlip( double x, double y, double w, double h,
+      const glColour *c, double a );
+static void gui_renderBlips (void);
 static void gui_renderHealth( const HealthBar *bar, const double w );
 static void gui_renderInterference( double dt );
 
@@ -237,6 +284,7 @@ void gui_setDefaults (void)
 {
    gui.radar.res = RADAR_RES_DEFAULT;
    memset( mesg_stack, 0, mesg_max * sizeof(Mesg));
+   mesg_head = 0;
 }
 
 
@@ -247,20 +295,14 @@ void gui_setDefaults (void)
  */
 void player_messageRaw ( const char *str )
 {
-   int i;
-
-   /* copy old messages back */
-   for (i=1; i<mesg_max; i++) {
-      if (mesg_stack[mesg_max-i-1].str[0] != '\0') {
-         strcpy(mesg_stack[mesg_max-i].str, mesg_stack[mesg_max-i-1].str);
-         mesg_stack[mesg_max-i].t = mesg_stack[mesg_max-i-1].t;
-      }
-   }
+   /* The ring just advances, the oldest slot gets overwritten. */
+   mesg_head = (mesg_head+1) % mesg_max;
+   strncpy( mesg_stack[mesg_head].str, str, MESG_SIZE_MAX );
 
-   /* add the new one */
-   strncpy( mesg_stack[0].str, str, MESG_SIZE_MAX );
+   mesg_stack[mesg_head].t = mesg_timeout;
 
-   mesg_stack[0].t = mesg_timeout;
+   /* Pre-cache the layout, the message gets drawn every frame. */
+   gl_printCacheRaw( NULL, mesg_stack[mesg_head].str );
 }
 
 /**
@@ -271,24 +313,19 @@ void player_messageRaw ( const char *str )
 void player_message ( const char *fmt, ... )
 {
    va_list ap;
-   int i;
 
    if (fmt == NULL) return; /* message not valid */
 
-   /* copy old messages back */
-   for (i=1; i<mesg_max; i++) {
-      if (mesg_stack[mesg_max-i-1].str[0] != '\0') {
-         strcpy(mesg_stack[mesg_max-i].str, mesg_stack[mesg_max-i-1].str);
-         mesg_stack[mesg_max-i].t = mesg_stack[mesg_max-i-1].t;
-      }
-   }
-
-   /* add the new one */
+   /* Format straight into the ring slot, no intermediate copies. */
+   mesg_head = (mesg_head+1) % mesg_max;
    va_start(ap, fmt);
-   vsnprintf( mesg_stack[0].str, MESG_SIZE_MAX, fmt, ap );
+   vsnprintf( mesg_stack[mesg_head].str, MESG_SIZE_MAX, fmt, ap );
    va_end(ap);
 
-   mesg_stack[0].t = mesg_timeout;
+   mesg_stack[mesg_head].t = mesg_timeout;
+
+   /* Pre-cache the layout, the message gets drawn every frame. */
+   gl_printCacheRaw( NULL, mesg_stack[mesg_head].str );
 }
 
 
@@ -326,16 +363,16 @@ static void gui_renderPlanetTarget( double dt )
 
    x = planet->pos.x - planet->gfx_space->sw/2.;
    y = planet->pos.y + planet->gfx_space->sh/2.;
-   gl_blitSprite( gui.gfx_targetPlanet, x, y, 0, 0, c ); /* top left */
+   gl_batchSprite( gui.gfx_targetPlanet, x, y, 0, 0, c ); /* top left */
 
    x += planet->gfx_space->sw;
-   gl_blitSprite( gui.gfx_targetPlanet, x, y, 1, 0, c ); /* top right */
+   gl_batchSprite( gui.gfx_targetPlanet, x, y, 1, 0, c ); /* top right */
 
    y -= planet->gfx_space->sh;
-   gl_blitSprite( gui.gfx_targetPlanet, x, y, 1, 1, c ); /* bottom right */
+   gl_batchSprite( gui.gfx_targetPlanet, x, y, 1, 1, c ); /* bottom right */
 
    x -= planet->gfx_space->sw;
-   gl_blitSprite( gui.gfx_targetPlanet, x, y, 0, 1, c ); /* bottom left */
+   gl_batchSprite( gui.gfx_targetPlanet, x, y, 0, 1, c ); /* bottom left */
 }
 
 
@@ -367,7 +404,7 @@ static void gui_renderPilotTarget( double dt )
    }
 
    /* Make sure target is still in range. */
-   if (!pilot_inRangePilot( player, p )) {
+   if (!pilot_inRangePlayer( p )) {
       player->target = PLAYER_ID;
       return;
    }
@@ -386,29 +423,52 @@ static void gui_renderPilotTarget( double dt )
 
    x = p->solid->pos.x - p->ship->gfx_space->sw * PILOT_SIZE_APROX/2.;
    y = p->solid->pos.y + p->ship->gfx_space->sh * PILOT_SIZE_APROX/2.;
-   gl_blitSprite( gui.gfx_targetPilot, x, y, 0, 0, c ); /* top left */
+   gl_batchSprite( gui.gfx_targetPilot, x, y, 0, 0, c ); /* top left */
 
    x += p->ship->gfx_space->sw * PILOT_SIZE_APROX;
-   gl_blitSprite( gui.gfx_targetPilot, x, y, 1, 0, c ); /* top right */
+   gl_batchSprite( gui.gfx_targetPilot, x, y, 1, 0, c ); /* top right */
 
    y -= p->ship->gfx_space->sh * PILOT_SIZE_APROX;
-   gl_blitSprite( gui.gfx_targetPilot, x, y, 1, 1, c ); /* bottom right */
+   gl_batchSprite( gui.gfx_targetPilot, x, y, 1, 1, c ); /* bottom right */
 
    x -= p->ship->gfx_space->sw * PILOT_SIZE_APROX;
-   gl_blitSprite( gui.gfx_targetPilot, x, y, 0, 1, c ); /* bottom left */
+   gl_batchSprite( gui.gfx_targetPilot, x, y, 0, 1, c ); /* bottom left */
+}
+
+
+/**
+ * @brief Queues one vertex into the border marker batch.
+ *
+ *    @param x X position of the vertex.
+ *    @param y Y position of the vertex.
+ *    @param col Colour of the vertex.
+ *    @param a Alpha to render the vertex with.
+ */
+static void gui_borderPoint( double x, double y, const glColour *col, double a )
+{
+   border_vertex[2*border_nv+0] = (GLfloat)x;
+   border_vertex[2*border_nv+1] = (GLfloat)y;
+   border_colour[4*border_nv+0] = col->r;
+   border_colour[4*border_nv+1] = col->g;
+   border_colour[4*border_nv+2] = col->b;
+   border_colour[4*border_nv+3] = (GLfloat)a;
+   border_nv++;
 }
 
 
 /**
  * @brief Renders the ships/planets in the border.
  *
+ * Markers accumulate as line segments and draw with a single call, so
+ *  the cost stays flat in entity count.
+ *
  *    @param dt Current delta tick.
  */
 static void gui_renderBorder( double dt )
 {
    (void) dt;
    double z;
-   int i, j;
+   int i;
    Pilot *plt;
    Planet *pnt;
    glTexture *tex;
@@ -419,7 +479,6 @@ static void gui_renderBorder( double dt )
    double cx,cy;
    glColour *col;
    double a, int_a;
-   GLfloat vertex[5*2], colours[5*4];
 
    /* Get zoom. */
    gl_cameraZoomGet( &z );
@@ -479,33 +538,18 @@ static void gui_renderBorder( double dt )
          }
 
 
-         /* Set up colours. */
-         col = gui_getPlanetColour(i);
-         for (j=0; j<5; j++) {
-            colours[4*j + 0] = col->r;
-            colours[4*j + 1] = col->g;
-            colours[4*j + 2] = col->b;
-            colours[4*j + 3] = int_a;
+         /* Queue the square outline as four segments. */
+         if (border_nv + 8 <= BORDER_VERT_MAX) {
+            col = gui_getPlanetColour(i);
+            gui_borderPoint( cx-5., cy-5., col, int_a );
+            gui_borderPoint( cx-5., cy+5., col, int_a );
+            gui_borderPoint( cx-5., cy+5., col, int_a );
+            gui_borderPoint( cx+5., cy+5., col, int_a );
+            gui_borderPoint( cx+5., cy+5., col, int_a );
+            gui_borderPoint( cx+5., cy-5., col, int_a );
+            gui_borderPoint( cx+5., cy-5., col, int_a );
+            gui_borderPoint( cx-5., cy-5., col, int_a );
          }
-         gl_vboSubData( gui_vbo, gui_vboColourOffset,
-               sizeof(GLfloat) * 5*4, colours );
-         /* Set up vertex. */
-         vertex[0] = cx-5.;
-         vertex[1] = cy-5;
-         vertex[2] = cx-5.;
-         vertex[3] = cy+5;
-         vertex[4] = cx+5.;
-         vertex[5] = cy+5;
-         vertex[6] = cx+5.;
-         vertex[7] = cy-5;
-         vertex[8] = cx-5.;
-         vertex[9] = cy-5;
-         gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 5*2, vertex );
-         /* Draw tho VBO. */
-         gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-               gui_vboColourOffset, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINE_STRIP, 0, 5 );
       }
    }
 
@@ -515,7 +559,7 @@ static void gui_renderBorder( double dt )
       tex = plt->ship->gfx_space;
 
       /* See if in sensor range. */
-      if (!pilot_inRangePilot(player, plt))
+      if (!pilot_inRangePlayer( plt ))
          continue;
 
       /* Get relative positions. */
@@ -555,36 +599,31 @@ static void gui_renderBorder( double dt )
             cy = sin(a) * (hh-7.) * M_SQRT2;
          }
 
-         /* Set up colours. */
-         col = gui_getPilotColour(plt);
-         for (j=0; j<4; j++) {
-            colours[4*j + 0] = col->r;
-            colours[4*j + 1] = col->g;
-            colours[4*j + 2] = col->b;
-            colours[4*j + 3] = int_a;
+         /* Queue the cross as two segments. */
+         if (border_nv + 4 <= BORDER_VERT_MAX) {
+            col = gui_getPilotColour(plt);
+            gui_borderPoint( cx-5., cy-5., col, int_a );
+            gui_borderPoint( cx+5., cy+5., col, int_a );
+            gui_borderPoint( cx+5., cy-5., col, int_a );
+            gui_borderPoint( cx-5., cy+5., col, int_a );
          }
-         gl_vboSubData( gui_vbo, gui_vboColourOffset,
-               sizeof(GLfloat) * 4*4, colours );
-         /* Set up vertex. */
-         vertex[0] = cx-5.;
-         vertex[1] = cy-5;
-         vertex[2] = cx+5.;
-         vertex[3] = cy+5;
-         vertex[4] = cx+5.;
-         vertex[5] = cy-5;
-         vertex[6] = cx-5.;
-         vertex[7] = cy+5;
-         gl_vboSubData( gui_vbo, 0, sizeof(GLfloat) * 4*2, vertex );
-         /* Draw tho VBO. */
-         gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
-               gui_vboColourOffset, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINES, 0, 4 );
       }
    }
 
-   /* Deactivate the VBO. */
-   gl_vboDeactivate();
+   /* One draw for every queued marker. */
+   if (border_nv > 0) {
+      gl_vboOrphan( gui_vbo );
+      gl_vboSubData( gui_vbo, 0,
+            sizeof(GLfloat) * 2*border_nv, border_vertex );
+      gl_vboSubData( gui_vbo, gui_vboColourOffset,
+            sizeof(GLfloat) * 4*border_nv, border_colour );
+      gl_vboActivateOffset( gui_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+      gl_vboActivateOffset( gui_vbo, GL_COLOR_ARRAY,
+            gui_vboColourOffset, 4, GL_FLOAT, 0 );
+      glDrawArrays( GL_LINES, 0, border_nv );
+      gl_vboDeactivate();
+      border_nv = 0;
+   }
 }
 
 
@@ -603,6 +642,7 @@ void gui_render( double dt )
    glColour* c, col;
    glFont* f;
    StarSystem *sys;
+   StarSystem **route;
    int q;
 
    /* If player is dead just render the cinematic mode. */
@@ -623,10 +663,13 @@ void gui_render( double dt )
    blink_pilot -= dt;
    blink_planet -= dt;
 
-   /* Render the border ships and targets. */
+   /* Render the border ships and targets.  The brackets batch into one
+    * draw per corner texture. */
    gui_renderBorder(dt);
+   gl_batchBegin();
    gui_renderPlanetTarget(dt);
    gui_renderPilotTarget(dt);
+   gl_batchEnd();
 
    /* Lockon warning */
    if (player->lockons > 0)
@@ -687,6 +730,14 @@ void gui_render( double dt )
             gui.nav.x, gui.nav.y - 10 - gl_smallFont.h,
             NULL, "%d - %s", pilot_getJumps(player),
             (sys_isKnown(sys)) ? sys->name : "Unknown" );
+
+      /* Multi-jump route progress, straight off the stored plan. */
+      route = map_getRoute( &q );
+      if (q > 1)
+         gl_printMid( &gl_smallFont, (int)gui.nav.w,
+               gui.nav.x, gui.nav.y - 15 - 2*gl_smallFont.h,
+               &cGrey, "%d jumps to %s", q,
+               sys_isKnown(route[q-1]) ? route[q-1]->name : "Unknown" );
    }
    else { /* no NAV target */
       gl_printMid( NULL, (int)gui.nav.w,
@@ -834,10 +885,9 @@ void gui_render( double dt )
          gui.misc.x + 8, j,
          &cConsole, "Creds:" );
    credits2str( str, player->credits, 2 );
-   i = gl_printWidth( &gl_smallFont, str );
-   gl_print( &gl_smallFont,
-         gui.misc.x + gui.misc.w - 8 - i, j,
-         NULL, str );
+   i = gl_printCacheUpdate( &gui_creditsText, &gl_smallFont, "%s", str );
+   gl_printCachedRaw( &gui_creditsText,
+         gui.misc.x + gui.misc.w - 8 - i, j, NULL );
    /* cargo and friends */
    if (player->ncommodities > 0) {
       j -= gl_smallFont.h + 5;
@@ -865,10 +915,10 @@ void gui_render( double dt )
    gl_print( &gl_smallFont,
          gui.misc.x + 8, j,
          &cConsole, "Free:" );
-   i = gl_printWidth( &gl_smallFont, "%d", pilot_cargoFree(player) );
-   gl_print( &gl_smallFont,
-         gui.misc.x + gui.misc.w - 8 - i, j,
-         NULL, "%d", pilot_cargoFree(player) );
+   i = gl_printCacheUpdate( &gui_cargoText, &gl_smallFont,
+         "%d", pilot_cargoFree(player) );
+   gl_printCachedRaw( &gui_cargoText,
+         gui.misc.x + gui.misc.w - 8 - i, j, NULL );
 
 
    /* Messages. */
@@ -902,7 +952,10 @@ void gui_render( double dt )
  */
 static void gui_renderRadar( double dt )
 {
-   int i, j;
+   int i, n;
+   double range;
+   Pilot *p, **nearby;
+   SpatialGrid *grid;
    GLfloat vertex[2*4], colours[4*4];
 
    gl_matrixMode( GL_PROJECTION );
@@ -930,17 +983,39 @@ static void gui_renderRadar( double dt )
          gui.radar.shape, 1.-interference_alpha);
 
 
-   /* render the pilot_nstack */
-   j = 0;
-   for (i=1; i<pilot_nstack; i++) { /* skip the player */
-      if (pilot_stack[i]->id == player->target)
-         j = i;
+   /* Render the pilots, using the spatial grid to only visit the ones
+    * that can show up on the radar. */
+   grid = pilot_getGrid();
+   if (grid != NULL) {
+      if (gui.radar.shape==RADAR_RECT)
+         range = MAX( gui.radar.w, gui.radar.h )/2. * gui.radar.res;
       else
-         gui_renderPilot(pilot_stack[i]);
+         range = gui.radar.w * gui.radar.res;
+      n = spatial_query( grid, (void***)&nearby,
+            player->solid->pos.x, player->solid->pos.y, range );
+      for (i=0; i<n; i++) {
+         p = nearby[i];
+         if ((p->id == PLAYER_ID) || (p->id == player->target))
+            continue;
+         gui_renderPilot(p);
+      }
+   }
+   else { /* No grid yet, walk the whole stack. */
+      for (i=1; i<pilot_nstack; i++) { /* skip the player */
+         if (pilot_stack[i]->id != player->target)
+            gui_renderPilot(pilot_stack[i]);
+      }
+   }
+   /* render the targetted pilot above the rest, even when the grid query
+    * doesn't reach him (off-radar direction marker) */
+   if (player->target != PLAYER_ID) {
+      p = pilot_get(player->target);
+      if (p != NULL)
+         gui_renderPilot(p);
    }
-   /* render the targetted pilot */
-   if (j!=0)
-      gui_renderPilot(pilot_stack[j]);
+
+   /* Flush the batched blips in one draw. */
+   gui_renderBlips();
 
    /* Intereference. */
    gui_renderInterference(dt);
@@ -1002,26 +1077,28 @@ static void gui_renderMessages( double dt )
    y = gui.mesg.y + (double)(gl_defFont.h*mesg_max)*1.2;
    c.r = c.g = c.b = 1.;
 
-   for (i=mesg_max-1; i>=0; i--) {
+   for (i=1; i<=mesg_max; i++) {
+      Mesg *m = &mesg_stack[ (mesg_head+i) % mesg_max ]; /* oldest first */
       y -= (double)gl_defFont.h*1.2;
 
       /* Only handle non-NULL messages. */
-      if (mesg_stack[i].str[0] != '\0') {
+      if (m->str[0] != '\0') {
 
          /* Decrement timer. */
-         mesg_stack[i].t -= dt;
+         m->t -= dt;
 
          /* Set to NULL if timer is up. */
-         if (mesg_stack[i].t < 0.)
-            mesg_stack[i].str[0] = '\0';
+         if (m->t < 0.)
+            m->str[0] = '\0';
 
-         /* Draw with variable alpha. */
+         /* Draw with variable alpha, raw so the pre-cached layout
+          * gets used without any reformatting. */
          else {
-            if (mesg_stack[i].t - mesg_timeout/2 < 0.)
-               c.a = mesg_stack[i].t / (mesg_timeout/2.);
+            if (m->t - mesg_timeout/2 < 0.)
+               c.a = m->t / (mesg_timeout/2.);
             else
                c.a = 1.;
-            gl_print( NULL, x, y, &c, "%s", mesg_stack[i].str );
+            gl_printRaw( NULL, x, y, &c, m->str );
          }
       }
    }
@@ -1033,43 +1110,117 @@ static void gui_renderMessages( double dt )
 /**
  * @brief Renders interference if needed.
  *
+ * One small tileable noise texture is sampled through a window that
+ *  jumps to a random offset every INTERFERENCE_CHANGE_DT, which gives
+ *  the old flicker without a stack of full-size layer textures.  The
+ *  circular radar masks the quad with its alpha mask on the second
+ *  texture unit.
+ *
  *    @param dt Current deltatick.
  */
 static void gui_renderInterference( double dt )
 {
-   glColour c;
-   glTexture *tex;
-   int t;
+   GLfloat vertex[4*2], tex[4*2], mtex[4*2];
+   double x,y, w,h, uw,vh;
+   int i;
 
    /* Must be displaying interference. */
-   if (interference_alpha <= 0.)
+   if ((interference_alpha <= 0.) || (interference_tex == NULL))
       return;
 
-   /* Calculate frame to draw. */
+   /* Jump the noise window around. */
    interference_t += dt;
    if (interference_t > INTERFERENCE_CHANGE_DT) { /* Time to change */
-      t = RNG(0, INTERFERENCE_LAYERS-1);
-      if (t != interference_layer)
-         interference_layer = t;
-      else
-         interference_layer = (interference_layer == INTERFERENCE_LAYERS-1) ?
-               0 : interference_layer+1;
+      interference_u = RNGF();
+      interference_v = RNGF();
       interference_t -= INTERFERENCE_CHANGE_DT;
    }
 
-   /* Render the interference. */
-   c.r = c.g = c.b = 1.;
-   c.a = interference_alpha;
-   tex = gui.radar.interference[interference_layer];
-   if (gui.radar.shape == RADAR_CIRCLE)
-   gl_blitStatic( tex,
-      SCREEN_W/2. - gui.radar.w,
-      SCREEN_H/2. - gui.radar.w,
-      &c );
-   else if (gui.radar.shape == RADAR_RECT)
-      gl_blitStatic( tex,
-            SCREEN_W/2. - gui.radar.w/2,
-            SCREEN_H/2. - gui.radar.h/2, &c );
+   /* Radar-centered quad, the radar matrix is already pushed. */
+   if (gui.radar.shape == RADAR_CIRCLE) {
+      w = 2.*gui.radar.w;
+      h = w;
+   }
+   else {
+      w = gui.radar.w;
+      h = gui.radar.h;
+   }
+   x = -w/2.;
+   y = -h/2.;
+
+   /* Sample the window at the noise texture's native scale. */
+   uw = w / (double)INTERFERENCE_NOISE_SIZE;
+   vh = h / (double)INTERFERENCE_NOISE_SIZE;
+
+   vertex[0] = (GLfloat)x;
+   vertex[1] = (GLfloat)y;
+   vertex[2] = (GLfloat)(x+w);
+   vertex[3] = (GLfloat)y;
+   vertex[4] = (GLfloat)x;
+   vertex[5] = (GLfloat)(y+h);
+   vertex[6] = (GLfloat)(x+w);
+   vertex[7] = (GLfloat)(y+h);
+   tex[0] = (GLfloat)interference_u;
+   tex[1] = (GLfloat)interference_v;
+   tex[2] = (GLfloat)(interference_u+uw);
+   tex[3] = tex[1];
+   tex[4] = tex[0];
+   tex[5] = (GLfloat)(interference_v+vh);
+   tex[6] = tex[2];
+   tex[7] = tex[5];
+   gl_vboSubData( interference_vbo, 0, sizeof(GLfloat) * 4*2, vertex );
+   gl_vboSubData( interference_vbo, sizeof(GLfloat) * 4*2,
+         sizeof(GLfloat) * 4*2, tex );
+   gl_vboActivateOffset( interference_vbo, GL_VERTEX_ARRAY, 0,
+         2, GL_FLOAT, 0 );
+
+   glColor4d( 1., 1., 1., interference_alpha );
+
+   if ((gui.radar.mask != NULL) && (nglActiveTexture != NULL)) {
+      /* Noise on the first unit, mask on the second. */
+      nglActiveTexture( GL_TEXTURE0 );
+      glEnable(GL_TEXTURE_2D);
+      glBindTexture( GL_TEXTURE_2D, interference_tex->texture );
+      glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+      gl_vboActivateOffset( interference_vbo, GL_TEXTURE0,
+            sizeof(GLfloat) * 4*2, 2, GL_FLOAT, 0 );
+
+      nglActiveTexture( GL_TEXTURE1 );
+      glEnable(GL_TEXTURE_2D);
+      glBindTexture( GL_TEXTURE_2D, gui.radar.mask->texture );
+      glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+      for (i=0; i<4; i++) {
+         mtex[2*i+0] = (GLfloat)(gui.radar.mask->tox +
+               ((i & 1) ? gui.radar.mask->srw : 0.));
+         mtex[2*i+1] = (GLfloat)(gui.radar.mask->toy +
+               ((i & 2) ? gui.radar.mask->srh : 0.));
+      }
+      gl_vboSubData( interference_vbo, sizeof(GLfloat) * 4*4,
+            sizeof(GLfloat) * 4*2, mtex );
+      gl_vboActivateOffset( interference_vbo, GL_TEXTURE1,
+            sizeof(GLfloat) * 4*4, 2, GL_FLOAT, 0 );
+
+      glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+
+      gl_vboDeactivate();
+      glDisable(GL_TEXTURE_2D);
+      nglActiveTexture( GL_TEXTURE0 );
+      glDisable(GL_TEXTURE_2D);
+   }
+   else {
+      /* Rectangular radar needs no mask; without multitexture the
+       * circular radar draws unmasked, matching the rest of the
+       * degraded single-unit path. */
+      glEnable(GL_TEXTURE_2D);
+      glBindTexture( GL_TEXTURE_2D, interference_tex->texture );
+      gl_vboActivateOffset( interference_vbo, GL_TEXTURE_COORD_ARRAY,
+            sizeof(GLfloat) * 4*2, 2, GL_FLOAT, 0 );
+      glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+      gl_vboDeactivate();
+      glDisable(GL_TEXTURE_2D);
+   }
+
+   gl_checkErr();
 }
 
 
@@ -1108,14 +1259,14 @@ static void gui_renderPilot( const Pilot* p )
    int x, y, sx, sy;
    double w, h;
    double px, py;
-   glColour *col, ccol;
+   glColour *col;
    double a;
    GLfloat vertex[2*8], colours[4*8];
    GLfloat cx, cy;
    int rc;
 
    /* Make sure is in range. */
-   if (!pilot_inRangePilot( player, p ))
+   if (!pilot_inRangePlayer( p ))
       return;
 
    /* Get position. */
@@ -1239,15 +1390,79 @@ static void gui_renderPilot( const Pilot* p )
    /* Deactivate VBO. */
    gl_vboDeactivate();
 
-   /* Draw square. */
+   /* Queue the blip square for the batched draw. */
    px = MAX(x-sx,-w);
    py = MAX(y-sy, -h);
    col = gui_getPilotColour(p);
-   ccol.r = col->r;
-   ccol.g = col->g;
-   ccol.b = col->b;
-   ccol.a = 1.-interference_alpha;
-   gl_renderRect( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ), &ccol );
+   gui_addBlip( px, py, MIN( 2*sx, w-px ), MIN( 2*sy, h-py ),
+         col, 1.-interference_alpha );
+}
+
+
+/**
+ * @brief Queues a radar blip quad for the batched draw.
+ *
+ *    @param x Blip X position.
+ *    @param y Blip Y position.
+ *    @param w Blip width.
+ *    @param h Blip height.
+ *    @param c Colour of the blip.
+ *    @param a Alpha to render the blip with.
+ */
+static void gui_addBlip( double x, double y, double w, double h,
+      const glColour *c, double a )
+{
+   int i;
+   GLfloat *vtx, *col;
+
+   if (radar_nblips >= RADAR_MAX_BLIPS)
+      return;
+
+   vtx = &radar_vertex[ radar_nblips*2*4 ];
+   vtx[0] = (GLfloat)x;
+   vtx[1] = (GLfloat)y;
+   vtx[2] = (GLfloat)(x+w);
+   vtx[3] = (GLfloat)y;
+   vtx[4] = (GLfloat)(x+w);
+   vtx[5] = (GLfloat)(y+h);
+   vtx[6] = (GLfloat)x;
+   vtx[7] = (GLfloat)(y+h);
+
+   col = &radar_colour[ radar_nblips*4*4 ];
+   for (i=0; i<4; i++) {
+      col[4*i + 0] = c->r;
+      col[4*i + 1] = c->g;
+      col[4*i + 2] = c->b;
+      col[4*i + 3] = a;
+   }
+
+   radar_nblips++;
+}
+
+
+/**
+ * @brief Draws all the queued radar blips in a single call.
+ */
+static void gui_renderBlips (void)
+{
+   if (radar_nblips == 0)
+      return;
+
+   /* Upload this frame's blips. */
+   gl_vboOrphan( radar_vbo );
+   gl_vboSubData( radar_vbo, 0,
+         sizeof(GLfloat) * radar_nblips*2*4, radar_vertex );
+   gl_vboSubData( radar_vbo, radar_vboColourOffset,
+         sizeof(GLfloat) * radar_nblips*4*4, radar_colour );
+
+   /* Draw tho VBO. */
+   gl_vboActivateOffset( radar_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( radar_vbo, GL_COLOR_ARRAY,
+         radar_vboColourOffset, 4, GL_FLOAT, 0 );
+   glDrawArrays( GL_QUADS, 0, radar_nblips*4 );
+   gl_vboDeactivate();
+
+   radar_nblips = 0;
 }
 
 
@@ -1579,8 +1794,14 @@ int gui_init (void)
     * VBO.
     */
    if (gui_vbo == NULL) {
-      gui_vbo = gl_vboCreateStream( sizeof(GLfloat) * 8*(2+4), NULL );
-      gui_vboColourOffset = sizeof(GLfloat) * 8*2;
+      gui_vbo = gl_vboCreateStream(
+            sizeof(GLfloat) * BORDER_VERT_MAX*(2+4), NULL );
+      gui_vboColourOffset = sizeof(GLfloat) * BORDER_VERT_MAX*2;
+   }
+   if (radar_vbo == NULL) {
+      radar_vbo = gl_vboCreateStream(
+            sizeof(GLfloat) * RADAR_MAX_BLIPS*4*(2+4), NULL );
+      radar_vboColourOffset = sizeof(GLfloat) * RADAR_MAX_BLIPS*4*2;
    }
 
    /*
@@ -1601,12 +1822,27 @@ int gui_init (void)
 int gui_load( const char* name )
 {
    uint32_t bufsize;
-   char *buf = ndata_read( GUI_DATA, &bufsize );
+   char *buf;
    char *tmp;
    int found = 0;
+   GuiCache *gc;
 
    xmlNodePtr node;
-   xmlDocPtr doc = xmlParseMemory( buf, bufsize );
+   xmlDocPtr doc;
+
+   /* Already parsed this session? */
+   for (gc=gui_cache; gc!=NULL; gc=gc->next) {
+      if (strcmp(gc->name,name)==0) {
+         gui_cleanup();
+         gui      = gc->gui;
+         gui_xoff = gc->xoff;
+         gui_yoff = gc->yoff;
+         return 0;
+      }
+   }
+
+   buf = ndata_read( GUI_DATA, &bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (!xml_isNode(node,XML_GUI_ID)) {
@@ -1631,6 +1867,8 @@ int gui_load( const char* name )
             /* parse the xml node */
             if (gui_parse(node,name))
                WARN("Trouble loading GUI '%s'", name);
+            else /* Keep the parsed state for the session. */
+               gui_cacheAdd( name );
             free(tmp);
             break;
          }
@@ -1693,12 +1931,17 @@ static void rect_parse( const xmlNodePtr parent,
 
 
 /**
- * @brief Creates teh interference map for the current gui.
+ * @brief Creates the interference assets for the current gui.
+ *
+ * One small tileable noise texture is shared by every gui and sampled
+ *  through a random window at render time, so only the circular
+ *  radar's alpha mask is per-gui.  This replaces the old stack of
+ *  sixteen full-size interference textures per gui.
  */
 static void gui_createInterference (void)
 {
    uint8_t raw;
-   int i, j, k;
+   int i, j;
    float *map;
    uint32_t *pix;
    SDL_Surface *sur;
@@ -1706,67 +1949,59 @@ static void gui_createInterference (void)
    float c;
    int r;
 
-   /* Dimension shortcuts. */
-   if (gui.radar.shape == RADAR_CIRCLE) {
-      w = gui.radar.w*2.;
-      h = w;
-   }
-   else if (gui.radar.shape == RADAR_RECT) {
-      w = gui.radar.w;
-      h = gui.radar.h;
-   }
-
-   for (k=0; k<INTERFERENCE_LAYERS; k++) {
-
-      /* Free the old texture. */
-      if (gui.radar.interference[k] != NULL)
-         gl_freeTexture(gui.radar.interference[k]);
-
-      /* Create the temporary surface. */
+   /* Generate the shared noise texture once. */
+   if (interference_tex == NULL) {
+      w = h = INTERFERENCE_NOISE_SIZE;
       sur = SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, RGBAMASK );
       pix = sur->pixels;
-
-      /* Clear pixels. */
-      memset( pix, 0, sizeof(uint32_t)*w*h );
-
-      /* Load the interference map. */
       map = noise_genRadarInt( w, h, 100. );
-
-      /* Create the texture. */
       SDL_LockSurface( sur );
-      if (gui.radar.shape == RADAR_CIRCLE) {
-         r = pow2((int)gui.radar.w);
-         hw = w/2;
-         hh = h/2;
-         for (i=0; i<h; i++) {
-            for (j=0; j<w; j++) {
-               /* Must be in circle. */
-               if (pow2(i-hh) + pow2(j-hw) > r)
-                  continue;
-               c = map[i*w + j];
-               raw = 0xff & (uint8_t)((float)0xff * c);
-               memset( &pix[i*w + j], raw, sizeof(uint32_t) );
-               pix[i*w + j] |= AMASK;
-            }
-         }
-      }
-      else if (gui.radar.shape == RADAR_RECT) {
-         for (i=0; i<h*w; i++) {
-            /* Process pixels. */
-            c = map[i];
-            raw = 0xff & (uint8_t)((float)0xff * c);
-            memset( &pix[i], raw, sizeof(uint32_t) );
-            pix[i] |= AMASK;
-         }
+      for (i=0; i<h*w; i++) {
+         c = map[i];
+         raw = 0xff & (uint8_t)((float)0xff * c);
+         memset( &pix[i], raw, sizeof(uint32_t) );
+         pix[i] |= AMASK;
       }
       SDL_UnlockSurface( sur );
+      free(map);
+      interference_tex = gl_loadImage( sur, 0 );
 
-      /* Set the interference. */
-      gui.radar.interference[k] = gl_loadImage( sur, 0 );
+      /* The sampling window wraps, the texture must tile. */
+      glBindTexture( GL_TEXTURE_2D, interference_tex->texture );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+      glBindTexture( GL_TEXTURE_2D, 0 );
+   }
 
-      /* Clean up. */
-      free(map);
+   /* The draw quad, vertex + noise UV + mask UV. */
+   if (interference_vbo == NULL)
+      interference_vbo = gl_vboCreateStream( sizeof(GLfloat) * 4*(2+2+2),
+            NULL );
+
+   /* Free the old mask. */
+   if (gui.radar.mask != NULL) {
+      gl_freeTexture( gui.radar.mask );
+      gui.radar.mask = NULL;
    }
+
+   /* Only the circular radar needs masking. */
+   if (gui.radar.shape != RADAR_CIRCLE)
+      return;
+
+   w = h = gui.radar.w*2.;
+   sur = SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, RGBAMASK );
+   pix = sur->pixels;
+   memset( pix, 0, sizeof(uint32_t)*w*h );
+   SDL_LockSurface( sur );
+   r  = pow2((int)gui.radar.w);
+   hw = w/2;
+   hh = h/2;
+   for (i=0; i<h; i++)
+      for (j=0; j<w; j++)
+         if (pow2(i-hh) + pow2(j-hw) <= r)
+            memset( &pix[i*w + j], 0xff, sizeof(uint32_t) );
+   SDL_UnlockSurface( sur );
+   gui.radar.mask = gl_loadImage( sur, 0 );
 }
 
 
@@ -2040,41 +2275,25 @@ static void gui_cleanupBar( HealthBar *bar )
 
 /**
  * @brief Cleans up the GUI.
+ *
+ * The textures belong to the definition cache, so the active gui struct
+ *  only detaches from them here.
  */
 void gui_cleanup (void)
 {
-   int i;
-
-   /* Free textures. */
-   if (gui.gfx_frame != NULL) {
-      gl_freeTexture( gui.gfx_frame );
-      gui.gfx_frame = NULL;
-   }
-   if (gui.gfx_targetPilot != NULL) {
-      gl_freeTexture( gui.gfx_targetPilot );
-      gui.gfx_targetPilot = NULL;
-   }
-   if (gui.gfx_targetPlanet != NULL) {
-      gl_freeTexture( gui.gfx_targetPlanet );
-      gui.gfx_targetPlanet = NULL;
-   }
-   /* Health textures. */
-   gui_cleanupBar( &gui.shield );
-   gui_cleanupBar( &gui.armour );
-   gui_cleanupBar( &gui.energy );
-   gui_cleanupBar( &gui.fuel );
-   /* Interference. */
-   for (i=0; i<INTERFERENCE_LAYERS; i++) {
-      if (gui.radar.interference[i] != NULL) {
-         gl_freeTexture(gui.radar.interference[i]);
-         gui.radar.interference[i] = NULL;
-      }
-   }
-
-   /* Clean up interference. */ 
-   interference_alpha = 0.; 
-   interference_layer = 0; 
-   interference_t     = 0.; 
+   /* Detach from the textures. */
+   gui.gfx_frame        = NULL;
+   gui.gfx_targetPilot  = NULL;
+   gui.gfx_targetPlanet = NULL;
+   gui.shield.gfx = NULL;
+   gui.armour.gfx = NULL;
+   gui.energy.gfx = NULL;
+   gui.fuel.gfx   = NULL;
+   gui.radar.mask = NULL;
+
+   /* Clean up interference. */
+   interference_alpha = 0.;
+   interference_t     = 0.;
 
    /* Destroy offset. */
    gui_xoff = 0.;
@@ -2082,6 +2301,53 @@ void gui_cleanup (void)
 }
 
 
+/**
+ * @brief Snapshots the active GUI into the definition cache.
+ *
+ *    @param name Name to key the entry by.
+ */
+static void gui_cacheAdd( const char *name )
+{
+   GuiCache *gc;
+
+   gc = malloc( sizeof(GuiCache) );
+   gc->name = strdup( name );
+   gc->gui  = gui;
+   gc->xoff = gui_xoff;
+   gc->yoff = gui_yoff;
+   gc->next = gui_cache;
+   gui_cache = gc;
+}
+
+
+/**
+ * @brief Frees the cached GUI definitions and their textures.
+ */
+static void gui_cacheFree (void)
+{
+   GuiCache *gc, *next;
+
+   for (gc=gui_cache; gc!=NULL; gc=next) {
+      next = gc->next;
+      if (gc->gui.gfx_frame != NULL)
+         gl_freeTexture( gc->gui.gfx_frame );
+      if (gc->gui.gfx_targetPilot != NULL)
+         gl_freeTexture( gc->gui.gfx_targetPilot );
+      if (gc->gui.gfx_targetPlanet != NULL)
+         gl_freeTexture( gc->gui.gfx_targetPlanet );
+      gui_cleanupBar( &gc->gui.shield );
+      gui_cleanupBar( &gc->gui.armour );
+      gui_cleanupBar( &gc->gui.energy );
+      gui_cleanupBar( &gc->gui.fuel );
+      if (gc->gui.radar.mask != NULL)
+         gl_freeTexture( gc->gui.radar.mask );
+      free( gc->name );
+      free( gc );
+   }
+   gui_cache = NULL;
+}
+
+
 /**
  * @brief Frees the gui stuff.
  */
@@ -2090,6 +2356,9 @@ void gui_free (void)
    /* Clean up gui. */
    gui_cleanup();
 
+   /* Free the cached definitions. */
+   gui_cacheFree();
+
    /* Free messages. */
    if (mesg_stack != NULL) {
       free(mesg_stack);
@@ -2101,6 +2370,24 @@ void gui_free (void)
       gl_vboDestroy( gui_vbo );
       gui_vbo = NULL;
    }
+   if (radar_vbo != NULL) {
+      gl_vboDestroy( radar_vbo );
+      radar_vbo = NULL;
+   }
+   if (interference_vbo != NULL) {
+      gl_vboDestroy( interference_vbo );
+      interference_vbo = NULL;
+   }
+
+   /* Free the shared interference noise. */
+   if (interference_tex != NULL) {
+      gl_freeTexture( interference_tex );
+      interference_tex = NULL;
+   }
+
+   /* Free the cached readouts. */
+   gl_printCacheFree( &gui_creditsText );
+   gl_printCacheFree( &gui_cargoText );
 
    /* Clean up the osd. */
    osd_exit();
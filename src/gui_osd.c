@@ -145,12 +145,16 @@ unsigned int osd_create( const char *title, int nitems, const char **items )
             snprintf( osd->items[i].chunks[j], s+1, "%s", &items[i][n] );
          }
 
+         /* Pre-cache the line's layout, it gets drawn every frame. */
+         gl_printCacheRaw( &gl_smallFont, osd->items[i].chunks[j] );
+
          /* Go t onext line. */
          n += s + 1;
          j++;
       }
       osd->items[i].nchunks = j;
    }
+   gl_printCacheRaw( &gl_smallFont, osd->title );
 
    /* Append to linked list. */
    if (osd_list == NULL)
@@ -19,9 +19,11 @@
 #include <string.h>
 
 #include "log.h"
+#include "save.h"
 #include "nxml.h"
 #include "player.h"
 #include "event.h"
+#include "strhash.h"
 
 
 #define HOOK_CHUNK   32 /**< Size to grow by when out of space */
@@ -75,6 +77,50 @@ static int hook_nstack        = 0; /**< Number of hooks currently used. */
 static int hook_runningstack  = 0; /**< Check if stack is running. */
 
 
+/*
+ * Per-stack buckets.
+ *
+ * Dispatch used to scan every hook comparing stack strings, which adds up
+ *  when "death" fires for each kill in a battle.  Hooks are instead indexed
+ *  into one bucket per stack name so hooks_run() only touches the hooks
+ *  actually registered for that event.
+ */
+/**
+ * @brief Bucket of hooks sharing a stack name.
+ */
+typedef struct HookBucket_ {
+   char *stack; /**< Name of the stack, owned by the bucket. */
+   unsigned int *ids; /**< Ids of the hooks in the stack, in creation order. */
+   int nids; /**< Number of ids in the bucket. */
+   int mids; /**< Allocated size of ids. */
+} HookBucket;
+static StrHash* hook_index    = NULL; /**< Maps stack name to its bucket. */
+static HookBucket** hook_buckets = NULL; /**< All buckets, for cleanup. */
+static int hook_nbuckets      = 0; /**< Number of buckets. */
+static int hook_mbuckets      = 0; /**< Allocated buckets. */
+
+
+/*
+ * Deferred hooks.
+ *
+ * While the simulation runs on the update thread, mission and event Lua
+ *  must not execute - it can open dialogues which re-enter the main loop.
+ *  Hooks fired during that window get queued here and run on the main
+ *  thread once the frame has been joined.
+ */
+/**
+ * @brief A hook whose execution has been deferred.
+ */
+typedef struct DeferredHook_ {
+   char *stack; /**< Stack to run, NULL if running by id. */
+   unsigned int id; /**< Id to run when stack is NULL. */
+} DeferredHook;
+static int hook_deferring           = 0; /**< Whether or not deferring. */
+static DeferredHook* hook_deferred  = NULL; /**< Queue of deferred hooks. */
+static int hook_ndeferred           = 0; /**< Number of deferred hooks. */
+static int hook_mdeferred           = 0; /**< Allocated deferred hooks. */
+
+
 /*
  * prototypes
  */
@@ -82,6 +128,9 @@ static int hook_runningstack  = 0; /**< Check if stack is running. */
 extern int misn_run( Mission *misn, const char *func );
 /* intern */
 static Hook* hook_new( HookType_t type, const char *stack );
+static Hook* hook_get( unsigned int id );
+static HookBucket* hook_bucketGet( const char *stack, int create );
+static void hook_bucketRm( const char *stack, unsigned int id );
 static int hook_runMisn( Hook *hook );
 static int hook_runEvent( Hook *hook );
 static int hook_runFunc( Hook *hook );
@@ -89,6 +138,7 @@ static int hook_run( Hook *hook );
 static void hook_free( Hook *h );
 static int hook_needSave( Hook *h );
 static int hook_parse( xmlNodePtr base );
+static void hook_deferPush( const char *stack, unsigned int id );
 /* externed */
 int hook_save( xmlTextWriterPtr writer );
 int hook_load( xmlNodePtr parent );
@@ -195,6 +245,99 @@ static int hook_run( Hook *hook )
 }
 
 
+/**
+ * @brief Gets a hook by identifier.
+ *
+ * Hooks are created with increasing ids and removal keeps order, so the
+ *  stack is always sorted by id.
+ *
+ *    @param id Identifier of the hook to get.
+ *    @return The hook or NULL if not found.
+ */
+static Hook* hook_get( unsigned int id )
+{
+   int l,m,h;
+
+   /* Binary search. */
+   l = 0;
+   h = hook_nstack-1;
+   while (l <= h) {
+      m = (l+h)/2;
+      if (hook_stack[m].id > id) h = m-1;
+      else if (hook_stack[m].id < id) l = m+1;
+      else return &hook_stack[m];
+   }
+
+   return NULL;
+}
+
+
+/**
+ * @brief Gets the bucket for a stack, optionally creating it.
+ *
+ *    @param stack Name of the stack to get the bucket of.
+ *    @param create Whether or not to create the bucket if it doesn't exist.
+ *    @return The bucket or NULL if it doesn't exist and create is 0.
+ */
+static HookBucket* hook_bucketGet( const char *stack, int create )
+{
+   HookBucket *bucket;
+
+   if (hook_index == NULL) {
+      if (!create)
+         return NULL;
+      hook_index = strhash_create( 16 );
+   }
+
+   bucket = strhash_get( hook_index, stack );
+   if ((bucket != NULL) || !create)
+      return bucket;
+
+   /* Create a new bucket. */
+   bucket         = malloc( sizeof(HookBucket) );
+   bucket->stack  = strdup( stack );
+   bucket->ids    = NULL;
+   bucket->nids   = 0;
+   bucket->mids   = 0;
+
+   /* Buckets are allocated individually so the index can keep pointers. */
+   if (hook_nbuckets+1 > hook_mbuckets) {
+      hook_mbuckets += HOOK_CHUNK;
+      hook_buckets   = realloc( hook_buckets,
+            hook_mbuckets*sizeof(HookBucket*) );
+   }
+   hook_buckets[hook_nbuckets++] = bucket;
+   strhash_put( hook_index, bucket->stack, bucket );
+
+   return bucket;
+}
+
+
+/**
+ * @brief Removes a hook id from its stack's bucket.
+ *
+ *    @param stack Stack the hook belongs to.
+ *    @param id Identifier of the hook to remove.
+ */
+static void hook_bucketRm( const char *stack, unsigned int id )
+{
+   HookBucket *bucket;
+   int i;
+
+   bucket = hook_bucketGet( stack, 0 );
+   if (bucket == NULL)
+      return;
+
+   for (i=0; i<bucket->nids; i++)
+      if (bucket->ids[i] == id) {
+         memmove( &bucket->ids[i], &bucket->ids[i+1],
+               sizeof(unsigned int) * (bucket->nids-i-1) );
+         bucket->nids--;
+         return;
+      }
+}
+
+
 /**
  * @brief Generates and allocates a new hook.
  *
@@ -204,6 +347,9 @@ static int hook_run( Hook *hook )
 static Hook* hook_new( HookType_t type, const char *stack )
 {
    Hook *new_hook;
+   HookBucket *bucket;
+
+   save_dirty(SAVE_HOOK);
 
    /* if memory must grow */
    if (hook_nstack+1 > hook_mstack) {
@@ -220,6 +366,15 @@ static Hook* hook_new( HookType_t type, const char *stack )
    new_hook->id      = ++hook_id;
    new_hook->stack   = strdup(stack);
 
+   /* Index it into its stack's bucket. */
+   bucket = hook_bucketGet( stack, 1 );
+   if (bucket->nids+1 > bucket->mids) {
+      bucket->mids += HOOK_CHUNK;
+      bucket->ids   = realloc( bucket->ids,
+            bucket->mids*sizeof(unsigned int) );
+   }
+   bucket->ids[bucket->nids++] = new_hook->id;
+
    /* Increment stack size. */
    hook_nstack++;
 
@@ -326,13 +481,16 @@ int hook_rm( unsigned int id )
    if (f == 0)
       return 0;
 
+   save_dirty(SAVE_HOOK);
+
    /* Mark to delete, but do not delete yet, hooks are running. */
    if (hook_runningstack) {
       hook_stack[m].delete = 1;
       return 2;
    }
 
-   /* Free the hook. */
+   /* Remove it from its stack's bucket and free it. */
+   hook_bucketRm( hook_stack[m].stack, id );
    hook_free( &hook_stack[m] );
 
    /* Last hook, just clip the stack. */
@@ -394,17 +552,32 @@ void hook_rmEventParent( unsigned int parent )
  */
 int hooks_run( const char* stack )
 {
+   HookBucket *bucket;
+   Hook *h;
    int i;
 
    /* Don't update if player is dead. */
    if ((player==NULL) || player_isFlag(PLAYER_DESTROYED))
       return 0;
 
+   /* Queue for the main thread instead. */
+   if (hook_deferring) {
+      hook_deferPush( stack, 0 );
+      return 0;
+   }
+
+   /* Nothing registered for this stack. */
+   bucket = hook_bucketGet( stack, 0 );
+   if (bucket == NULL)
+      return 0;
+
    hook_runningstack = 1; /* running hooks */
-   for (i=0; i<hook_nstack; i++)
-      if ((strcmp(stack, hook_stack[i].stack)==0) && !hook_stack[i].delete) {
-         hook_run( &hook_stack[i] );
-      }
+   for (i=0; i<bucket->nids; i++) {
+      /* Hooks may be added while running, growing the bucket. */
+      h = hook_get( bucket->ids[i] );
+      if ((h != NULL) && !h->delete)
+         hook_run( h );
+   }
    hook_runningstack = 0; /* not running hooks anymore */
 
    for (i=0; i<hook_nstack; i++)
@@ -426,28 +599,81 @@ int hooks_run( const char* stack )
 void hook_runID( unsigned int id )
 {
    Hook *h;
-   int i, ret;
 
    /* Don't update if player is dead. */
    if ((player==NULL) || player_isFlag(PLAYER_DESTROYED))
       return;
 
-   /* Try to find the hook and run it. */
-   ret = 0;
-   for (i=0; i<hook_nstack; i++)
-      if (hook_stack[i].id == id) {
-         h     = &hook_stack[i];
-         hook_run( h );
-         ret   = 1;
-         break;
-      }
+   /* Queue for the main thread instead. */
+   if (hook_deferring) {
+      hook_deferPush( NULL, id );
+      return;
+   }
 
-   /* Hook not found. */
-   if (ret == 0)
+   /* Try to find the hook and run it. */
+   h = hook_get( id );
+   if (h != NULL)
+      hook_run( h );
+   else
       DEBUG("Attempting to run hook of id '%d' which is not in the stack", id);
 }
 
 
+/**
+ * @brief Queues a hook to be run later by hooks_runDeferred().
+ *
+ *    @param stack Stack to queue or NULL to queue by id.
+ *    @param id Id to queue when stack is NULL.
+ */
+static void hook_deferPush( const char *stack, unsigned int id )
+{
+   /* See if memory needs to grow. */
+   if (hook_ndeferred+1 > hook_mdeferred) {
+      hook_mdeferred += HOOK_CHUNK;
+      hook_deferred = realloc( hook_deferred,
+            hook_mdeferred*sizeof(DeferredHook) );
+   }
+
+   hook_deferred[hook_ndeferred].stack = (stack != NULL) ? strdup(stack) : NULL;
+   hook_deferred[hook_ndeferred].id    = id;
+   hook_ndeferred++;
+}
+
+
+/**
+ * @brief Sets whether or not hooks get deferred instead of run.
+ *
+ * Must be enabled while the update thread runs and disabled again before
+ *  running the queue with hooks_runDeferred().
+ *
+ *    @param enable 1 to defer hooks, 0 to run them normally again.
+ */
+void hooks_defer( int enable )
+{
+   hook_deferring = enable;
+}
+
+
+/**
+ * @brief Runs all the hooks queued up while deferring was enabled.
+ */
+void hooks_runDeferred (void)
+{
+   int i;
+
+   /* Deferring is off here so hooks fired by these run inline. */
+   for (i=0; i<hook_ndeferred; i++) {
+      if (hook_deferred[i].stack != NULL) {
+         hooks_run( hook_deferred[i].stack );
+         free( hook_deferred[i].stack );
+      }
+      else
+         hook_runID( hook_deferred[i].id );
+   }
+   hook_ndeferred = 0;
+}
+
+
 /**
  * @brief Frees a hook.
  *
@@ -490,6 +716,21 @@ void hook_cleanup (void)
    hook_stack  = NULL;
    hook_nstack = 0;
    hook_mstack = 0;
+
+   /* Clean up the buckets. */
+   for (i=0; i<hook_nbuckets; i++) {
+      free( hook_buckets[i]->stack );
+      free( hook_buckets[i]->ids );
+      free( hook_buckets[i] );
+   }
+   free( hook_buckets );
+   hook_buckets  = NULL;
+   hook_nbuckets = 0;
+   hook_mbuckets = 0;
+   if (hook_index != NULL) {
+      strhash_destroy( hook_index );
+      hook_index = NULL;
+   }
 }
 
 
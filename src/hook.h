@@ -38,6 +38,10 @@ void hook_rmEventParent( unsigned int parent );
 int hooks_run( const char* stack );
 void hook_runID( unsigned int id ); /* runs hook of specific id */
 
+/* deferring - used while the update thread runs */
+void hooks_defer( int enable );
+void hooks_runDeferred (void);
+
 /* destroys hooks */
 void hook_cleanup (void);
 
@@ -128,14 +128,12 @@ static void info_openMain( unsigned int wid )
    char **licenses;
    int nlicenses;
    int i;
-   char *nt;
    int w, h;
 
    /* Get the dimensions. */
    window_dimWindow( wid, &w, &h );
 
    /* pilot generics */
-   nt = ntime_pretty( ntime_get() );
    window_addText( wid, 40, 20, 120, h-80,
          0, "txtDPilot", &gl_smallFont, &cDConsole,
          "Pilot:\n"
@@ -156,7 +154,7 @@ static void info_openMain( unsigned int wid )
          "%s\n"
          "%.0f (%d Jumps)",
          player_name,
-         nt,
+         ntime_prettyRaw(),
          player_rating(),
          creds,
          player->name,
@@ -164,7 +162,6 @@ static void info_openMain( unsigned int wid )
    window_addText( wid, 140, 20,
          200, h-80,
          0, "txtPilot", &gl_smallFont, &cBlack, str );
-   free(nt);
 
    /* menu */
    window_addButton( wid, -20, 20,
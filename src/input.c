@@ -27,6 +27,8 @@
 #include "weapon.h"
 #include "console.h"
 #include "conf.h"
+#include "perf.h"
+#include "replay.h"
 
 
 #define KEY_PRESS    ( 1.) /**< Key is pressed. */
@@ -42,11 +44,45 @@ typedef struct Keybind_ {
    KeybindType type; /**< type, defined in playe.h */
    SDLKey key; /**< key/axis/button event number */
    SDLMod mod; /**< Key modifiers (where applicable). */
+   int next; /**< Next binding sharing the same lookup slot, -1 ends. */
 } Keybind;
 
 
 static Keybind** input_keybinds; /**< contains the players keybindings */
 
+/**
+ * @brief Compile time id of each keybinding.
+ *
+ * Must stay in the exact order of keybindNames below, input_init()
+ *  warns when the two drift apart.
+ */
+typedef enum KeybindIdx_ {
+   /* Movement. */
+   KB_ACCEL, KB_LEFT, KB_RIGHT, KB_REVERSE, KB_AFTERBURN,
+   /* Targetting. */
+   KB_TARGET_NEXT, KB_TARGET_PREV, KB_TARGET_NEAREST,
+   KB_TARGET_NEXTHOSTILE, KB_TARGET_PREVHOSTILE, KB_TARGET_HOSTILE,
+   KB_TARGET_CLEAR,
+   /* Fighting. */
+   KB_PRIMARY, KB_FACE, KB_BOARD, KB_SAFETY,
+   /* Weapon selection. */
+   KB_WEAP_ALL, KB_WEAP_TURRET, KB_WEAP_FORWARD,
+   /* Secondary weapons. */
+   KB_SECONDARY, KB_SECONDARY_NEXT, KB_SECONDARY_PREV,
+   /* Escorts. */
+   KB_E_TARGETNEXT, KB_E_TARGETPREV, KB_E_ATTACK, KB_E_HOLD,
+   KB_E_RETURN, KB_E_CLEAR,
+   /* Space navigation. */
+   KB_AUTONAV, KB_TARGET_PLANET, KB_LAND, KB_THYPERSPACE, KB_STARMAP,
+   KB_JUMP,
+   /* Communication. */
+   KB_HAIL,
+   /* Misc. */
+   KB_MAPZOOMIN, KB_MAPZOOMOUT, KB_SCREENSHOT, KB_PAUSE, KB_SPEED,
+   KB_MENU, KB_INFO, KB_CONSOLE, KB_PROFILER,
+   KB_END /**< Total number of keybindings. */
+} KeybindIdx;
+
 /* name of each keybinding */
 const char *keybindNames[] = {
    /* Movement. */
@@ -69,7 +105,7 @@ const char *keybindNames[] = {
    "hail",
    /* Misc. */
    "mapzoomin", "mapzoomout", "screenshot", "pause", "speed", "menu", "info",
-   "console",
+   "console", "profiler",
    /* Must terminate in "end". */
    "end"
 }; /**< Names of possible keybindings. */
@@ -129,6 +165,7 @@ const char *keybindDescription[] = {
    "Opens the small ingame menu.",
    "Opens the information menu.",
    "Opens the Lua console.",
+   "Cycles the frame profiler overlay and CSV dump.",
    NULL /* To match sentinel. */
 }; /**< Descriptions of the keybindings. Should be in the same position as the
         matching keybinding name. */
@@ -158,11 +195,37 @@ extern double player_right; /**< player.c */
 static char *keyconv[INPUT_NUMKEYS]; /**< Key conversion table. */
 
 
+/*
+ * Direct event lookup tables, compiled from the keybind array by
+ *  input_compile().  Each slot heads a chain of binding indexes linked
+ *  through Keybind.next, so event handling touches only the bindings
+ *  that can match instead of scanning all of them.
+ */
+#define INPUT_JOYMAX 32 /**< Joystick axes/buttons tracked in the lookup tables. */
+static int input_keytable[INPUT_NUMKEYS]; /**< Keyboard binding chains per key. */
+static int input_jaxistable[INPUT_JOYMAX]; /**< Joystick binding chains per axis. */
+static int input_jbuttontable[INPUT_JOYMAX]; /**< Joystick binding chains per button. */
+
+/*
+ * Coalesced joystick motion, high-polling-rate devices flood axis
+ *  events so only the latest value per axis is kept and flushed once
+ *  per frame by input_update().  Values inside the deadzone are snapped
+ *  to zero at the source and flushes that only jitter are dropped, so
+ *  an idle throttle quadrant generates no work at all.
+ */
+#define INPUT_AXIS_DEADZONE   1638 /**< Snapped to zero, ~5% of full deflection. */
+#define INPUT_AXIS_DELTA       256 /**< Smallest change worth re-dispatching. */
+static int input_axisValue[INPUT_JOYMAX]; /**< Latest value seen per axis. */
+static int input_axisChanged[INPUT_JOYMAX]; /**< Axis moved since last flush. */
+static int input_axisLast[INPUT_JOYMAX]; /**< Value the bindings last saw. */
+
+
 /*
  * Prototypes.
  */
 static void input_keyConvGen (void);
 static void input_keyConvDestroy (void);
+static void input_compile (void);
 
 
 /**
@@ -222,6 +285,7 @@ void input_setDefault (void)
    input_setKeybind( "menu", KEYBIND_KEYBOARD, SDLK_ESCAPE, KMOD_ALL );
    input_setKeybind( "info", KEYBIND_KEYBOARD, SDLK_i, KMOD_NONE );
    input_setKeybind( "console", KEYBIND_KEYBOARD, SDLK_F2, KMOD_ALL );
+   input_setKeybind( "profiler", KEYBIND_KEYBOARD, SDLK_F3, KMOD_ALL );
 }
 
 
@@ -286,6 +350,12 @@ void input_init (void)
    for (i=0; strcmp(keybindNames[i],"end"); i++);
       input_keybinds = malloc(i*sizeof(Keybind*));
 
+#ifdef DEBUGGING
+   /* The enum is the names' compile time mirror, catch drift early. */
+   if (i != KB_END)
+      WARN("KeybindIdx enum has %d entries for %d keybind names!", KB_END, i);
+#endif /* DEBUGGING */
+
    /* Create sane null keybinding for each. */
    for (i=0; strcmp(keybindNames[i],"end"); i++) {
       temp = malloc(sizeof(Keybind));
@@ -297,6 +367,9 @@ void input_init (void)
       input_keybinds[i] = temp;
    }
 
+   /* All null so far, but leaves the lookup tables sane. */
+   input_compile();
+
    /* Generate Key translation table. */
    input_keyConvGen();
 }
@@ -340,6 +413,56 @@ static void input_keyConvDestroy (void)
 }
 
 
+/**
+ * @brief Compiles the keybind array into the direct lookup tables.
+ *
+ * Called whenever a binding changes, so event handling never has to
+ *  scan the whole array.  Bindings are prepended walking the array
+ *  backwards, keeping each chain in array order like the old scan.
+ */
+static void input_compile (void)
+{
+   int i, k;
+
+   for (k=0; k < INPUT_NUMKEYS; k++)
+      input_keytable[k] = -1;
+   for (k=0; k < INPUT_JOYMAX; k++) {
+      input_jaxistable[k]   = -1;
+      input_jbuttontable[k] = -1;
+   }
+
+   for (i=KB_END-1; i >= 0; i--) {
+      k = (int) input_keybinds[i]->key;
+      switch (input_keybinds[i]->type) {
+         case KEYBIND_KEYBOARD:
+            if ((k >= 0) && (k < INPUT_NUMKEYS)) {
+               input_keybinds[i]->next = input_keytable[k];
+               input_keytable[k] = i;
+            }
+            break;
+
+         case KEYBIND_JAXISPOS:
+         case KEYBIND_JAXISNEG:
+            if ((k >= 0) && (k < INPUT_JOYMAX)) {
+               input_keybinds[i]->next = input_jaxistable[k];
+               input_jaxistable[k] = i;
+            }
+            break;
+
+         case KEYBIND_JBUTTON:
+            if ((k >= 0) && (k < INPUT_JOYMAX)) {
+               input_keybinds[i]->next = input_jbuttontable[k];
+               input_jbuttontable[k] = i;
+            }
+            break;
+
+         default:
+            break;
+      }
+   }
+}
+
+
 /**
  * @brief Gets the key id from it's name.
  *
@@ -403,6 +526,7 @@ void input_setKeybind( const char *keybind, KeybindType type, int key, SDLMod mo
          input_keybinds[i]->key = key;
          /* Non-keyboards get mod KMOD_ALL to always match. */
          input_keybinds[i]->mod = (type==KEYBIND_KEYBOARD) ? mod : KMOD_ALL;
+         input_compile(); /* Refresh the lookup tables. */
          return;
       }
    WARN("Unable to set keybinding '%s', that command doesn't exist", keybind);
@@ -519,7 +643,7 @@ const char* input_getKeybindDescription( const char *keybind )
 }
 
 
-#define KEY(s)    (strcmp(input_keybinds[keynum]->name,s)==0) /**< Shortcut for ease. */
+#define KEY(s)    (keynum == (s)) /**< Shortcut for ease. */
 #define INGAME()  (!toolkit_isOpen() && !paused) /**< Makes sure player is in game. */
 #define NOHYP()   \
 (player && !pilot_isFlag(player,PILOT_HYP_PREP) &&\
@@ -543,7 +667,7 @@ static void input_key( int keynum, double value, double kabs )
     * movement
     */
    /* accelerating */
-   if (KEY("accel")) {
+   if (KEY(KB_ACCEL)) {
       if (kabs >= 0.) {
          player_abortAutonav(NULL);
          player_accel(kabs);
@@ -570,14 +694,14 @@ static void input_key( int keynum, double value, double kabs )
             input_accelLast = t;
       }
    /* Afterburning. */
-   } else if (KEY("afterburn") && INGAME()) {
+   } else if (KEY(KB_AFTERBURN) && INGAME()) {
       if ((value==KEY_PRESS) && NOHYP() && NODEAD())
          player_afterburn();
       else if (value==KEY_RELEASE)
          player_afterburnOver();
 
    /* turning left */
-   } else if (KEY("left")) {
+   } else if (KEY(KB_LEFT)) {
       if (kabs >= 0.) {
          player_abortAutonav(NULL);
          player_setFlag(PLAYER_TURN_LEFT); 
@@ -597,7 +721,7 @@ static void input_key( int keynum, double value, double kabs )
       }
 
    /* turning right */
-   } else if (KEY("right")) {
+   } else if (KEY(KB_RIGHT)) {
       if (kabs >= 0.) {
          player_abortAutonav(NULL);
          player_setFlag(PLAYER_TURN_RIGHT);
@@ -617,7 +741,7 @@ static void input_key( int keynum, double value, double kabs )
       }
    
    /* turn around to face vel */
-   } else if (KEY("reverse")) {
+   } else if (KEY(KB_REVERSE)) {
       if (value==KEY_PRESS) {
          player_abortAutonav(NULL);
          player_setFlag(PLAYER_REVERSE);
@@ -630,7 +754,7 @@ static void input_key( int keynum, double value, double kabs )
     * combat
     */
    /* shooting primary weapon */
-   } else if (KEY("primary") && NODEAD()) {
+   } else if (KEY(KB_PRIMARY) && NODEAD()) {
       if (value==KEY_PRESS) { 
          player_abortAutonav(NULL);
          player_setFlag(PLAYER_PRIMARY);
@@ -638,22 +762,22 @@ static void input_key( int keynum, double value, double kabs )
       else if (value==KEY_RELEASE) 
          player_rmFlag(PLAYER_PRIMARY);
    /* targetting */
-   } else if (INGAME() && NODEAD() && KEY("target_next")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_NEXT)) {
       if (value==KEY_PRESS) player_targetNext(0);
-   } else if (INGAME() && NODEAD() && KEY("target_prev")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_PREV)) {
       if (value==KEY_PRESS) player_targetPrev(0);
-   } else if (INGAME() && NODEAD() && KEY("target_nearest")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_NEAREST)) {
       if (value==KEY_PRESS) player_targetNearest();
-   } else if (INGAME() && NODEAD() && KEY("target_nextHostile")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_NEXTHOSTILE)) {
       if (value==KEY_PRESS) player_targetNext(1);
-   } else if (INGAME() && NODEAD() && KEY("target_prevHostile")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_PREVHOSTILE)) {
       if (value==KEY_PRESS) player_targetPrev(1);
-   } else if (INGAME() && NODEAD() && KEY("target_hostile")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_HOSTILE)) {
       if (value==KEY_PRESS) player_targetHostile();
-   } else if (INGAME() && NODEAD() && KEY("target_clear")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_TARGET_CLEAR)) {
       if (value==KEY_PRESS) player_targetClear();
    /* face the target */
-   } else if (KEY("face")) {
+   } else if (KEY(KB_FACE)) {
       if (value==KEY_PRESS) { 
          player_abortAutonav(NULL);
          player_setFlag(PLAYER_FACE);
@@ -662,12 +786,12 @@ static void input_key( int keynum, double value, double kabs )
          player_rmFlag(PLAYER_FACE);
 
    /* board them ships */
-   } else if (KEY("board") && INGAME() && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_BOARD) && INGAME() && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) {
          player_abortAutonav(NULL);
          player_board();
       }
-   } else if (KEY("safety") && INGAME()) {
+   } else if (KEY(KB_SAFETY) && INGAME()) {
       if (value==KEY_PRESS)
          weapon_toggleSafety();
 
@@ -675,28 +799,28 @@ static void input_key( int keynum, double value, double kabs )
    /* 
     * Weapon selection.
     */
-   } else if (KEY("weap_all") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_WEAP_ALL) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) player_setFireMode( 0 );
-   } else if (KEY("weap_turret") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_WEAP_TURRET) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) player_setFireMode( 1 );
-   } else if (KEY("weap_forward") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_WEAP_FORWARD) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) player_setFireMode( 2 );
 
 
    /*
     * Escorts.
     */
-   } else if (INGAME() && NODEAD() && KEY("e_targetNext")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_E_TARGETNEXT)) {
       if (value==KEY_PRESS) player_targetEscort(0);
-   } else if (INGAME() && NODEAD() && KEY("e_targetPrev")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_E_TARGETPREV)) {
       if (value==KEY_PRESS) player_targetEscort(1);
-   } else if (INGAME() && NODEAD() && KEY("e_attack")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_E_ATTACK)) {
       if (value==KEY_PRESS) escorts_attack(player);
-   } else if (INGAME() && NODEAD() && KEY("e_hold")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_E_HOLD)) {
       if (value==KEY_PRESS) escorts_hold(player);
-   } else if (INGAME() && NODEAD() && KEY("e_return")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_E_RETURN)) {
       if (value==KEY_PRESS) escorts_return(player);
-   } else if (INGAME() && NODEAD() && KEY("e_clear")) {
+   } else if (INGAME() && NODEAD() && KEY(KB_E_CLEAR)) {
       if (value==KEY_PRESS) escorts_clear(player);
 
 
@@ -704,7 +828,7 @@ static void input_key( int keynum, double value, double kabs )
     * secondary weapons
     */
    /* shooting secondary weapon */
-   } else if (KEY("secondary") && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_SECONDARY) && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) {
          player_abortAutonav(NULL);
          player_setFlag(PLAYER_SECONDARY);
@@ -713,34 +837,34 @@ static void input_key( int keynum, double value, double kabs )
          player_rmFlag(PLAYER_SECONDARY);
 
    /* selecting secondary weapon */
-   } else if (KEY("secondary_next") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_SECONDARY_NEXT) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) player_secondaryNext();
-   } else if (KEY("secondary_prev") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_SECONDARY_PREV) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) player_secondaryPrev();
 
 
    /*                                                                     
     * space
     */
-   } else if (KEY("autonav") && INGAME() && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_AUTONAV) && INGAME() && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) player_startAutonav();
    /* target planet (cycles like target) */
-   } else if (KEY("target_planet") && INGAME() && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_TARGET_PLANET) && INGAME() && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) player_targetPlanet();
    /* target nearest planet or attempt to land */
-   } else if (KEY("land") && INGAME() && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_LAND) && INGAME() && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) {
          player_abortAutonav(NULL);
          player_land();
       }
-   } else if (KEY("thyperspace") && NOHYP() && NOLAND() && NODEAD()) {
+   } else if (KEY(KB_THYPERSPACE) && NOHYP() && NOLAND() && NODEAD()) {
       if (value==KEY_PRESS) {
          player_abortAutonav(NULL);
          player_targetHyperspace();
       }
-   } else if (KEY("starmap") && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_STARMAP) && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) map_open();
-   } else if (KEY("jump") && INGAME()) {
+   } else if (KEY(KB_JUMP) && INGAME()) {
       if (value==KEY_PRESS) {
          player_abortAutonav(NULL);
          player_jump();
@@ -750,7 +874,7 @@ static void input_key( int keynum, double value, double kabs )
    /*
     * Communication.
     */
-   } else if (KEY("hail") && INGAME() && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_HAIL) && INGAME() && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) {
          player_hail();
       }
@@ -760,16 +884,16 @@ static void input_key( int keynum, double value, double kabs )
     * misc
     */
    /* zooming in */
-   } else if (KEY("mapzoomin") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_MAPZOOMIN) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) gui_setRadarRel(-1);
    /* zooming out */
-   } else if (KEY("mapzoomout") && INGAME() && NODEAD()) {
+   } else if (KEY(KB_MAPZOOMOUT) && INGAME() && NODEAD()) {
       if (value==KEY_PRESS) gui_setRadarRel(1);
    /* take a screenshot */
-   } else if (KEY("screenshot")) {
+   } else if (KEY(KB_SCREENSHOT)) {
       if (value==KEY_PRESS) player_screenshot();
    /* pause the games */
-   } else if (KEY("pause")) {
+   } else if (KEY(KB_PAUSE)) {
       if (value==KEY_PRESS) {
          if (!toolkit_isOpen()) {
             if (paused)
@@ -779,22 +903,26 @@ static void input_key( int keynum, double value, double kabs )
          }
       }
    /* toggle speed mode */
-   } else if (KEY("speed")) {
+   } else if (KEY(KB_SPEED)) {
       if (value==KEY_PRESS) {
          if (dt_mod == 1.) pause_setSpeed(2.);
          else pause_setSpeed(1.);
       }
    /* opens a small menu */
-   } else if (KEY("menu") && NODEAD()) {
+   } else if (KEY(KB_MENU) && NODEAD()) {
       if (value==KEY_PRESS) menu_small();
    
    /* shows pilot information */
-   } else if (KEY("info") && NOHYP() && NODEAD()) {
+   } else if (KEY(KB_INFO) && NOHYP() && NODEAD()) {
       if (value==KEY_PRESS) menu_info();
 
    /* Opens the Lua console. */
-   } else if (KEY("console") && NODEAD()) {
+   } else if (KEY(KB_CONSOLE) && NODEAD()) {
       if (value==KEY_PRESS) cli_open();
+
+   /* Cycles the frame profiler. */
+   } else if (KEY(KB_PROFILER)) {
+      if (value==KEY_PRESS) perf_toggle();
    }
 }
 #undef KEY
@@ -819,21 +947,22 @@ static void input_keyevent( const int event, const SDLKey key, const SDLMod mod
 static void input_joyaxis( const SDLKey axis, const int value )
 {
    int i, k;
-   for (i=0; strcmp(keybindNames[i],"end"); i++) {
-      if (input_keybinds[i]->key == axis) {
-         /* Positive axis keybinding. */
-         if ((input_keybinds[i]->type == KEYBIND_JAXISPOS)
-               && (value >= 0)) {
-            k = (value > 0) ? KEY_PRESS : KEY_RELEASE;
-            input_key( i, k, fabs(((double)value)/32767.) );
-         }
 
-         /* Negative axis keybinding. */
-         if ((input_keybinds[i]->type == KEYBIND_JAXISNEG)
-               && (value <= 0)) {
-            k = (value < 0) ? KEY_PRESS : KEY_RELEASE;
-            input_key( i, k, fabs(((double)value)/32767.) );
-         }
+   if (axis >= INPUT_JOYMAX)
+      return;
+   for (i=input_jaxistable[axis]; i != -1; i=input_keybinds[i]->next) {
+      /* Positive axis keybinding. */
+      if ((input_keybinds[i]->type == KEYBIND_JAXISPOS)
+            && (value >= 0)) {
+         k = (value > 0) ? KEY_PRESS : KEY_RELEASE;
+         input_key( i, k, fabs(((double)value)/32767.) );
+      }
+
+      /* Negative axis keybinding. */
+      if ((input_keybinds[i]->type == KEYBIND_JAXISNEG)
+            && (value <= 0)) {
+         k = (value < 0) ? KEY_PRESS : KEY_RELEASE;
+         input_key( i, k, fabs(((double)value)/32767.) );
       }
    }
 }
@@ -845,10 +974,11 @@ static void input_joyaxis( const SDLKey axis, const int value )
 static void input_joyevent( const int event, const SDLKey button )
 {
    int i;
-   for (i=0; strcmp(keybindNames[i],"end"); i++)
-      if ((input_keybinds[i]->type == KEYBIND_JBUTTON) &&
-            (input_keybinds[i]->key == button))
-         input_key(i, event, -1.);
+
+   if (button >= INPUT_JOYMAX)
+      return;
+   for (i=input_jbuttontable[button]; i != -1; i=input_keybinds[i]->next)
+      input_key(i, event, -1.);
 }
 
 
@@ -869,15 +999,14 @@ static void input_keyevent( const int event, SDLKey key, const SDLMod mod )
    /* We want to ignore "global" modifiers. */
    mod_filtered = mod & ~(KMOD_CAPS | KMOD_NUM | KMOD_MODE);
 
-   for (i=0; strcmp(keybindNames[i],"end"); i++) {
-      if ((input_keybinds[i]->type == KEYBIND_KEYBOARD) &&
-            (input_keybinds[i]->key == key)) {
-         if ((input_keybinds[i]->mod == mod_filtered) ||
-               (input_keybinds[i]->mod == KMOD_ALL) ||
-               (event == KEY_RELEASE)) /**< Release always gets through. */
-            input_key(i, event, -1.);
-            /* No break so all keys get pressed if needed. */
-      }
+   if (key >= INPUT_NUMKEYS)
+      return;
+   for (i=input_keytable[key]; i != -1; i=input_keybinds[i]->next) {
+      if ((input_keybinds[i]->mod == mod_filtered) ||
+            (input_keybinds[i]->mod == KMOD_ALL) ||
+            (event == KEY_RELEASE)) /**< Release always gets through. */
+         input_key(i, event, -1.);
+         /* No break so all keys get pressed if needed. */
    }
 }
 
@@ -891,6 +1020,10 @@ static void input_keyevent( const int event, SDLKey key, const SDLMod mod )
  */
 void input_handle( SDL_Event* event )
 {
+   int v;
+
+   replay_event(event); /* Records the event when a replay is being written. */
+
    if (toolkit_isOpen()) /* toolkit handled seperately completely */
       if (toolkit_input(event))
          return; /* we don't process it if toolkit grabs it */
@@ -901,7 +1034,16 @@ void input_handle( SDL_Event* event )
        * game itself
        */
       case SDL_JOYAXISMOTION:
-         input_joyaxis(event->jaxis.axis, event->jaxis.value);
+         /* Coalesced, only the latest value per axis is acted on so
+          * high-polling-rate sticks don't flood the binding path.
+          * input_update() flushes it once per frame. */
+         if (event->jaxis.axis < INPUT_JOYMAX) {
+            v = event->jaxis.value;
+            if (ABS(v) < INPUT_AXIS_DEADZONE) /* only jitter in there */
+               v = 0;
+            input_axisValue[event->jaxis.axis]   = v;
+            input_axisChanged[event->jaxis.axis] = 1;
+         }
          break;
 
       case SDL_JOYBUTTONDOWN:
@@ -922,3 +1064,31 @@ void input_handle( SDL_Event* event )
    }
 }
 
+
+/**
+ * @brief Flushes coalesced motion input, run once per frame after the
+ *  event loop drains.
+ */
+void input_update (void)
+{
+   int a, v;
+
+   for (a=0; a < INPUT_JOYMAX; a++) {
+      if (!input_axisChanged[a])
+         continue;
+      input_axisChanged[a] = 0;
+      v = input_axisValue[a];
+
+      /* Drop jitter, but a return to zero always gets through so the
+       * binding sees its release. */
+      if (v == input_axisLast[a])
+         continue;
+      if ((v != 0) && (input_axisLast[a] != 0) &&
+            (ABS(v - input_axisLast[a]) < INPUT_AXIS_DELTA))
+         continue;
+
+      input_axisLast[a] = v;
+      input_joyaxis( a, v );
+   }
+}
+
@@ -39,6 +39,7 @@ const char *input_keyAlreadyBound( KeybindType type, int key, SDLMod mod );
  * handle input
  */
 void input_handle( SDL_Event* event );
+void input_update (void);
 
 /*
  * init/exit
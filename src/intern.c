@@ -0,0 +1,93 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file intern.c
+ *
+ * @brief Global string intern pool.
+ *
+ * Game data is full of small names copied over and over: every spawned
+ *  pilot strdup'd its fleet name, every mission marker strdup'd a system
+ *  name.  The pool stores each distinct string once and hands out the
+ *  same pointer every time, which both drops the copies and lets hot
+ *  paths compare names with pointer equality instead of strcmp().
+ *
+ * Interned strings are never freed individually; distinct names come
+ *  from game data so the pool stays small and lives until intern_exit().
+ */
+
+#include "intern.h"
+
+#include "naev.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define INTERN_BUCKETS  1024 /**< Number of hash buckets, power of two. */
+
+
+/**
+ * @brief A pooled string.
+ */
+typedef struct InternNode_ {
+   struct InternNode_ *next; /**< Next in the bucket chain. */
+   char str[1]; /**< The string itself, allocated to fit. */
+} InternNode;
+
+static InternNode *intern_buckets[INTERN_BUCKETS]; /**< The pool. */
+
+
+/**
+ * @brief Interns a string.
+ *
+ * The same contents always return the same pointer, so interned strings
+ *  can be compared with ==.  The returned string must not be freed.
+ *
+ *    @param s String to intern.
+ *    @return The pooled copy, or NULL if s is NULL.
+ */
+const char* str_intern( const char *s )
+{
+   unsigned int hash;
+   const char *c;
+   InternNode *node;
+
+   if (s == NULL)
+      return NULL;
+
+   /* djb2. */
+   hash = 5381;
+   for (c=s; *c!='\0'; c++)
+      hash = hash*33 + (unsigned char)*c;
+   hash &= INTERN_BUCKETS-1;
+
+   for (node=intern_buckets[hash]; node!=NULL; node=node->next)
+      if (strcmp(node->str, s)==0)
+         return node->str;
+
+   node = malloc( sizeof(InternNode) + strlen(s) );
+   strcpy( node->str, s );
+   node->next = intern_buckets[hash];
+   intern_buckets[hash] = node;
+   return node->str;
+}
+
+
+/**
+ * @brief Frees the whole pool, no interned string survives this.
+ */
+void intern_exit (void)
+{
+   int i;
+   InternNode *node, *next;
+
+   for (i=0; i<INTERN_BUCKETS; i++) {
+      for (node=intern_buckets[i]; node!=NULL; node=next) {
+         next = node->next;
+         free(node);
+      }
+      intern_buckets[i] = NULL;
+   }
+}
@@ -0,0 +1,21 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef INTERN_H
+#  define INTERN_H
+
+
+/*
+ * Global string intern pool.
+ *
+ * Interning the same string twice returns the same pointer, so interned
+ * strings compare with == and are never freed individually; the pool
+ * lives until intern_exit().
+ */
+const char* str_intern( const char *s );
+void intern_exit (void);
+
+
+#endif /* INTERN_H */
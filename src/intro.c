@@ -26,6 +26,7 @@
 #include "music.h"
 #include "nstd.h"
 #include "toolkit.h"
+#include "opengl.h"
 
 
 #define INTRO_FONT_SIZE    18. /**< Intro text font size. */
@@ -40,11 +41,27 @@ static int intro_nlines = 0; /**< Number of introduction text lines. */
 static int intro_length = 0; /**< Length of the text. */
 static glFont intro_font; /**< Introduction font. */
 
+/*
+ * Prerendered crawl.
+ *
+ * The whole text is rendered once into a strip of textures at intro
+ *  start, so each frame scrolls with one textured quad per visible strip
+ *  instead of re-rendering every line through the font path.
+ */
+static GLuint *intro_tex = NULL; /**< Strip textures, NULL when not baked. */
+static int intro_ntex = 0; /**< Number of strips. */
+static int intro_texw = 0; /**< Width of a strip texture. */
+static int intro_texh = 0; /**< Height of a strip texture. */
+static int intro_perstrip = 0; /**< Lines per strip. */
+static gl_vbo *intro_vbo = NULL; /**< Quad used to draw the strips. */
+
 
 /*
  * Prototypes.
  */
 static int intro_load( const char *text );
+static void intro_bake (void);
+static void intro_drawStrips( double offset, double lineh );
 static void intro_cleanup (void);
 
 
@@ -57,6 +74,7 @@ static int intro_load( const char *text )
    char *intro_buf;
    int i, p, n;
    int mem;
+   double width;
 
    /* Load text. */
    intro_buf = ndata_read( text, &intro_size );
@@ -65,13 +83,23 @@ static int intro_load( const char *text )
    /* Create intro font. */
    gl_fontInit( &intro_font, NULL, INTRO_FONT_SIZE );
 
+   /* Wrap width.  The strip textures can't be wider than the backbuffer
+    * they get captured from, so wrap to whichever is narrower. */
+   width = SCREEN_W - 200.;
+   if (gl_screen.scale == 1.) {
+      intro_texw = gl_pot( (int)width );
+      while (intro_texw > SCREEN_W)
+         intro_texw >>= 1;
+      width = MIN( width, (double)intro_texw );
+   }
+
    /* Load lines. */
    p = 0;
    n = 0;
    mem = 0;
    while ((uint32_t)p < intro_size) {
       /* Get the length. */
-      i = gl_printWidthForText( &intro_font, &intro_buf[p], SCREEN_W - 200. );
+      i = gl_printWidthForText( &intro_font, &intro_buf[p], width );
 
       /* Copy the line. */
       if (n+1 > mem) {
@@ -94,6 +122,123 @@ static int intro_load( const char *text )
 }
 
 
+/**
+ * @brief Prerenders the crawl into a strip of textures.
+ *
+ * Renders screenfuls of lines to the backbuffer and captures them with
+ *  glCopyTexSubImage2D(), the same trick the toolkit window cache uses.
+ *  Skipped when the screen is scaled, since then window pixels no longer
+ *  match game pixels - intro_display() falls back to per-line rendering.
+ */
+static void intro_bake (void)
+{
+   double lineh, y;
+   int s, k, j;
+
+   if (gl_screen.scale != 1.)
+      return;
+
+   lineh = intro_font.h + 5.;
+
+   /* Strips are as tall as fits the backbuffer. */
+   intro_texh = gl_pot( (int)SCREEN_H );
+   while (intro_texh > SCREEN_H)
+      intro_texh >>= 1;
+   intro_perstrip = (int)((double)intro_texh / lineh);
+   intro_ntex     = (intro_nlines + intro_perstrip - 1) / intro_perstrip;
+
+   /* Create the textures. */
+   intro_tex = malloc( sizeof(GLuint) * intro_ntex );
+   glGenTextures( intro_ntex, intro_tex );
+   for (s=0; s<intro_ntex; s++) {
+      glBindTexture( GL_TEXTURE_2D, intro_tex[s] );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, intro_texw, intro_texh, 0,
+            GL_RGB, GL_UNSIGNED_BYTE, NULL );
+   }
+
+   /* Render and capture strip by strip, lines filling from the top. */
+   for (s=0; s<intro_ntex; s++) {
+      glClear( GL_COLOR_BUFFER_BIT );
+      for (k=0; k<intro_perstrip; k++) {
+         j = s*intro_perstrip + k;
+         if (j >= intro_nlines)
+            break;
+         y = (double)intro_texh - (double)(k+1) * lineh;
+         gl_print( &intro_font, 0., y, &cConsole, intro_lines[j] );
+      }
+      glBindTexture( GL_TEXTURE_2D, intro_tex[s] );
+      glCopyTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0,
+            0, 0, intro_texw, intro_texh );
+   }
+   glBindTexture( GL_TEXTURE_2D, 0 );
+
+   /* Quad the strips get drawn with. */
+   intro_vbo = gl_vboCreateStream( sizeof(GLfloat) * (2+2) * 4, NULL );
+
+   gl_checkErr();
+}
+
+
+/**
+ * @brief Draws the visible strips of the prerendered crawl.
+ *
+ *    @param offset Pixels the crawl has scrolled.
+ *    @param lineh Height of a text line in pixels.
+ */
+static void intro_drawStrips( double offset, double lineh )
+{
+   GLfloat vertex[4*2], tex[4*2];
+   double sh, x, y;
+   int s;
+
+   sh = (double)intro_perstrip * lineh; /* Content height of a strip. */
+   x  = 100. - (double)SCREEN_W/2.;
+
+   glEnable(GL_TEXTURE_2D);
+   glColor4d( 1., 1., 1., 1. );
+
+   for (s=0; s<intro_ntex; s++) {
+      /* Strip s sits at [offset-(s+1)*sh, offset-s*sh] on screen. */
+      y = offset - (double)(s+1)*sh;
+      if ((y > SCREEN_H) || (y + sh < 0.))
+         continue;
+      y -= (double)SCREEN_H/2.;
+
+      vertex[0] = (GLfloat)x;
+      vertex[4] = vertex[0];
+      vertex[2] = vertex[0] + (GLfloat)intro_texw;
+      vertex[6] = vertex[2];
+      vertex[1] = (GLfloat)y;
+      vertex[3] = vertex[1];
+      vertex[5] = vertex[1] + (GLfloat)sh;
+      vertex[7] = vertex[5];
+      gl_vboSubData( intro_vbo, 0, sizeof(vertex), vertex );
+      gl_vboActivateOffset( intro_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+
+      /* Content occupies the top sh rows of the texture. */
+      tex[0] = 0.;
+      tex[4] = tex[0];
+      tex[2] = 1.;
+      tex[6] = tex[2];
+      tex[1] = (GLfloat)(((double)intro_texh - sh) / (double)intro_texh);
+      tex[3] = tex[1];
+      tex[5] = 1.;
+      tex[7] = tex[5];
+      gl_vboSubData( intro_vbo, sizeof(vertex), sizeof(tex), tex );
+      gl_vboActivateOffset( intro_vbo, GL_TEXTURE_COORD_ARRAY,
+            sizeof(vertex), 2, GL_FLOAT, 0 );
+
+      glBindTexture( GL_TEXTURE_2D, intro_tex[s] );
+      glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+   }
+
+   gl_vboDeactivate();
+   glDisable(GL_TEXTURE_2D);
+}
+
+
 /**
  * @brief Cleans up the intro stuff.
  */
@@ -107,6 +252,16 @@ static void intro_cleanup (void)
    free(intro_lines);
    gl_freeFont(&intro_font);
 
+   /* Free the prerendered crawl. */
+   if (intro_tex != NULL) {
+      glDeleteTextures( intro_ntex, intro_tex );
+      free(intro_tex);
+      gl_vboDestroy( intro_vbo );
+   }
+   intro_tex = NULL;
+   intro_ntex = 0;
+   intro_vbo = NULL;
+
    /* Set defaults. */
    intro_lines = NULL;
    intro_nlines = 0;
@@ -134,6 +289,9 @@ int intro_display( const char *text, const char *mus )
    if (intro_load(text) < 0)
       return -1;
 
+   /* Prerender the crawl. */
+   intro_bake();
+
    /* Calculate velocity. */
    density  = ((double)intro_length / (double)intro_nlines); /* char / line */
    density /= (double)intro_font.h; /* char / pixel */
@@ -190,22 +348,26 @@ int intro_display( const char *text, const char *mus )
       i = (int)(offset / (intro_font.h + 5.));
       if (i > max) /* Out of lines. */
          break;
-      y = offset - (i+1) * (intro_font.h + 5.);
+      if (intro_tex != NULL)
+         intro_drawStrips( offset, intro_font.h + 5. );
+      else {
+         y = offset - (i+1) * (intro_font.h + 5.);
 
-      while (i >= 0) {
+         while (i >= 0) {
 
-         /* Skip in line isn't valid. */
-         if (i >= intro_nlines) {
+            /* Skip in line isn't valid. */
+            if (i >= intro_nlines) {
+               i--;
+               y += intro_font.h + 5.;
+               continue;
+            }
+
+            gl_print( &intro_font, x, y, &cConsole, intro_lines[i] );
+
+            /* Increment line and position. */
             i--;
             y += intro_font.h + 5.;
-            continue;
          }
-
-         gl_print( &intro_font, x, y, &cConsole, intro_lines[i] );
-
-         /* Increment line and position. */
-         i--;
-         y += intro_font.h + 5.;
       }
 
       /* Only thing we actually care about updating is music. */
@@ -18,6 +18,9 @@
 #include <string.h>
 #include <math.h>
 
+#include "SDL.h"
+#include "SDL_thread.h"
+
 #include "log.h"
 #include "toolkit.h"
 #include "dialogue.h"
@@ -106,6 +109,8 @@ static int mission_ncomputer = 0; /**< Number of missions at the computer. */
  * mission bar stack
  */
 static Mission* mission_bar = NULL; /**< Missions at the spaceport bar. */
+static SDL_Thread *mission_genThread = NULL; /**< Generates the mission lists
+                                                  in the background on landing. */
 static int mission_nbar = 0; /**< Number of missions at the spaceport bar. */
 static glTexture *mission_portrait = NULL; /**< Mission portrait. */
 
@@ -120,6 +125,8 @@ static int last_window = 0; /**< Default window. */
  * prototypes
  */
 static unsigned int land_getWid( int window );
+static int land_genMissions( void *unused );
+static void land_joinMissions (void);
 static void land_createMainTab( unsigned int wid );
 static void land_cleanupWindow( unsigned int wid, char *name );
 static void land_changeTab( unsigned int wid, char *wgt, int tab );
@@ -152,7 +159,6 @@ static int spaceport_bar_genList( unsigned int wid );
 static void spaceport_bar_update( unsigned int wid, char* str );
 static void spaceport_bar_close( unsigned int wid, char* str );
 static void spaceport_bar_approach( unsigned int wid, char* str );
-static int news_load (void);
 /* mission computer */
 static void misn_open( unsigned int wid );
 static void misn_close( unsigned int wid, char *name );
@@ -380,7 +386,7 @@ static void outfits_open( unsigned int wid )
          &gl_smallFont, NULL, NULL );
 
    /* set up the outfits to buy/sell */
-   outfits = outfit_getTech( &noutfits, land_planet->tech, PLANET_TECH_MAX);
+   outfits = planet_getOutfitTech( &noutfits, land_planet );
    if (noutfits <= 0) { /* No outfits */
       soutfits    = malloc(sizeof(char*));
       soutfits[0] = strdup("None");
@@ -396,7 +402,6 @@ static void outfits_open( unsigned int wid )
          soutfits[i] = strdup(outfits[i]->name);
          toutfits[i] = outfits[i]->gfx_store;
       }
-      free(outfits);
    }
    window_addImageArray( wid, 20, 20,
          iw, ih, "iarOutfits", 64, 64,
@@ -420,7 +425,7 @@ static void outfits_updateQuantities( unsigned int wid )
    int i;
 
    /* Get outfits. */
-   outfits = outfit_getTech( &noutfits, land_planet->tech, PLANET_TECH_MAX);
+   outfits = planet_getOutfitTech( &noutfits, land_planet );
    if (noutfits <= 0)
       return;
 
@@ -436,7 +441,6 @@ static void outfits_updateQuantities( unsigned int wid )
       else
          quantity[i] = NULL;
    }
-   free(outfits);
    toolkit_setImageArrayQuantity( wid, "iarOutfits", quantity );
 }
 /**
@@ -775,7 +779,7 @@ static void shipyard_open( unsigned int wid )
          &gl_smallFont, NULL, NULL );
 
    /* set up the ships to buy/sell */
-   ships = ship_getTech( &nships, land_planet->tech, PLANET_TECH_MAX );
+   ships = planet_getShipTech( &nships, land_planet );
    if (nships <= 0) {
       sships    = malloc(sizeof(char*));
       sships[0] = strdup("None");
@@ -790,7 +794,6 @@ static void shipyard_open( unsigned int wid )
          sships[i] = strdup(ships[i]->name);
          tships[i] = ships[i]->gfx_target;
       }
-      free(ships);
    }
    window_addImageArray( wid, 20, 20,
          iw, ih, "iarShipyard", 64./96.*128., 64.,
@@ -977,6 +980,9 @@ static void spaceport_bar_open( unsigned int wid )
 {
    int w, h, iw, ih, bw, bh, dh, th;
 
+   /* Need the bar mission list. */
+   land_joinMissions();
+
    /* Set window functions. */
    window_onClose( wid, spaceport_bar_close );
 
@@ -1085,6 +1091,12 @@ static void spaceport_bar_update( unsigned int wid, char* str )
 
    /* See if is news. */
    if (pos==0) { /* News selected. */
+      /* Defer news generation until the bar tab is actually shown; the
+       * tab change callback updates us again when it becomes visible. */
+      if (window_tabWinGetActive( land_wid, "tabLand" ) !=
+            land_windowsMap[LAND_WINDOW_BAR])
+         return;
+
       if (!widget_exists(wid, "cstNews")) {
          /* Destroy portrait. */
          if (widget_exists(wid, "imgPortrait")) {
@@ -1098,7 +1110,8 @@ static void spaceport_bar_update( unsigned int wid, char* str )
          window_modifyText(  wid, "txtPortrait", NULL );
          window_modifyText(  wid, "txtMission",  NULL );
 
-         /* Create news. */
+         /* Create news, generating it on first view this visit. */
+         news_generateCached( land_planet->name, ntime_get(), 10 );
          news_widget( wid, iw + 60, -40 - (40 + dh),
                w - iw - 100, h - 40 - (dh+20) - 40 - bh - 20 );
       }
@@ -1189,19 +1202,6 @@ static void spaceport_bar_approach( unsigned int wid, char *str )
    /* Reset markers. */
    mission_sysMark();
 }
-/**
- * @brief Loads the news.
- *
- * @return 0 on success.
- */
-static int news_load (void)
-{
-   news_generate( NULL, 10 );
-   return 0;
-}
-
-
-
 /**
  * @brief Opens the mission computer window.
  */
@@ -1210,6 +1210,9 @@ static void misn_open( unsigned int wid )
    int w, h;
    int y;
 
+   /* Need the computer mission list. */
+   land_joinMissions();
+
    /* Get window dimensions. */
    window_dimWindow( wid, &w, &h );
 
@@ -1357,12 +1360,11 @@ static void misn_update( unsigned int wid, char* str )
    (void) str;
    char *active_misn;
    Mission* misn;
-   char txt[256], *buf;
+   char txt[256];
 
    /* Update date stuff. */
-   buf = ntime_pretty(0);
-   snprintf( txt, sizeof(txt), "%s\n%d Tons", buf, player->cargo_free );
-   free(buf);
+   snprintf( txt, sizeof(txt), "%s\n%d Tons",
+         ntime_prettyRaw(), player->cargo_free );
    window_modifyText( wid, "txtDate", txt );
 
    active_misn = toolkit_getList( wid, "lstMission" );
@@ -1523,6 +1525,73 @@ static unsigned int land_getWid( int window )
 }
 
 
+/**
+ * @brief Generates the computer and bar mission lists.
+ *
+ * Runs on a worker thread so the Lua create() of every eligible mission
+ *  doesn't hitch the landing; nothing else runs Lua until the thread is
+ *  joined.
+ */
+static int land_genMissions( void *unused )
+{
+   (void) unused;
+
+   /* Generate computer missions. */
+   mission_computer = missions_genList( &mission_ncomputer,
+         land_planet->faction, land_planet->name, cur_system->name,
+         MIS_AVAIL_COMPUTER );
+
+   /* Generate spaceport bar missions. */
+   mission_bar = missions_genList( &mission_nbar,
+         land_planet->faction, land_planet->name, cur_system->name,
+         MIS_AVAIL_BAR );
+
+   return 0;
+}
+
+
+/**
+ * @brief Waits for the mission list generation to finish.
+ *
+ * Must be called before touching mission_computer or mission_bar.
+ */
+static void land_joinMissions (void)
+{
+   if (mission_genThread != NULL) {
+      SDL_WaitThread( mission_genThread, NULL );
+      mission_genThread = NULL;
+   }
+}
+
+
+/**
+ * @brief Starts preparing a planet's landing assets ahead of time.
+ *
+ * Called when the player targets a landable planet, so the exterior
+ *  graphic decode runs on a worker and the shop stock caches are warm
+ *  by the time land() binds them.  Safe to call repeatedly.
+ *
+ *    @param p Planet the player is likely to land on.
+ */
+void land_prefetch( Planet* p )
+{
+   int n;
+
+   if (p == NULL)
+      return;
+
+   /* Exterior graphic, land() then only does the GPU upload. */
+   if (p->gfx_exterior != NULL)
+      gl_prefetchImage( p->gfx_exterior, 0 );
+
+   /* Shop stocks, memoized per planet. */
+   if (planet_hasService( p, PLANET_SERVICE_OUTFITS ))
+      planet_getOutfitTech( &n, p );
+   if (planet_hasService( p, PLANET_SERVICE_SHIPYARD ))
+      planet_getShipTech( &n, p );
+}
+
+
 /**
  * @brief Opens up all the land dialogue stuff.
  *    @param p Planet to open stuff for.
@@ -1556,19 +1625,11 @@ void land( Planet* p )
    land_wid = window_create( p->name, -1, -1, w, h );
    window_onClose( land_wid, land_cleanupWindow );
 
-   /* Generate computer missions. */
-   mission_computer = missions_genList( &mission_ncomputer,
-         land_planet->faction, land_planet->name, cur_system->name,
-         MIS_AVAIL_COMPUTER );
-
-   /* Generate spaceport bar missions. */
-   mission_bar = missions_genList( &mission_nbar,
-         land_planet->faction, land_planet->name, cur_system->name,
-         MIS_AVAIL_BAR );
-
-   /* Generate the news. */
-   if (planet_hasService(land_planet, PLANET_SERVICE_BASIC))
-      news_load();
+   /* Generate the mission lists in the background while the land windows
+    * are being built; readers join the thread before first access. */
+   mission_genThread = SDL_CreateThread( land_genMissions, NULL );
+   if (mission_genThread == NULL)
+      land_genMissions(NULL);
 
    /* Set window map to invald. */
    for (i=0; i<LAND_NUMWINDOWS; i++)
@@ -1639,6 +1700,9 @@ void land( Planet* p )
    /* Change the music */
    music_choose("land");
 
+   /* Land hooks run Lua, wait for the generation thread. */
+   land_joinMissions();
+
    /* Run hooks, run after music in case hook wants to change music. */
    hooks_run("land");
 
@@ -1820,7 +1884,6 @@ static void land_changeTab( unsigned int wid, char *wgt, int tab )
 void takeoff( int delay )
 {
    int sw,sh, h;
-   char *nt;
 
    if (!landed)
       return;
@@ -1852,9 +1915,8 @@ void takeoff( int delay )
    /* time goes by, triggers hook before takeoff */
    if (delay)
       ntime_inc( RNG( 2*NTIME_UNIT_LENGTH, 3*NTIME_UNIT_LENGTH ) );
-   nt = ntime_pretty(0);
-   player_message("Taking off from %s on %s.", land_planet->name, nt);
-   free(nt);
+   player_message("Taking off from %s on %s.",
+         land_planet->name, ntime_prettyRaw() );
 
    /* initialize the new space */
    h = hyperspace_target;
@@ -1881,6 +1943,9 @@ void land_cleanup (void)
 {
    int i;
 
+   /* Make sure the mission lists are done generating. */
+   land_joinMissions();
+
    /* Clean up default stuff. */
    land_planet    = NULL;
    landed         = 0;
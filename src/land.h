@@ -22,6 +22,7 @@ extern Planet* land_planet;
  * Main interface.
  */
 void land ( Planet* p );
+void land_prefetch( Planet* p );
 void takeoff( int delay );
 void land_cleanup (void);
 void land_exit (void);
@@ -0,0 +1,192 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file loadtime.c
+ *
+ * @brief Startup stage timing.
+ *
+ * Every loadscreen_render() message opens a new stage, so the stages
+ *  match exactly what the player sees on the loading screen.  Inside a
+ *  stage the I/O, image-decode and GPU-upload paths report how long they
+ *  took; the remainder is parse/cpu time.  The report goes to the log
+ *  once loading finishes and is exported as loadtime.csv next to the
+ *  config for comparing across runs.
+ *
+ * The worker thread accounts into the current main-thread stage.  The
+ *  counters are plain and unlocked: these are statistics, a torn read
+ *  costs one misattributed row, not a crash.
+ */
+
+#include "loadtime.h"
+
+#include "naev.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#if HAS_POSIX
+#include <sys/time.h>
+#endif /* HAS_POSIX */
+#if HAS_WIN32
+#include <sys/timeb.h>
+#endif /* HAS_WIN32 */
+
+#include "log.h"
+#include "nfile.h"
+
+
+#define LOADTIME_STAGES    32 /**< Maximum stages tracked. */
+#define LOADTIME_NAME_LEN  64 /**< Maximum stage name length. */
+
+
+/**
+ * @brief A single timed loading stage.
+ */
+typedef struct LoadStage_ {
+   char name[LOADTIME_NAME_LEN]; /**< Loadscreen message of the stage. */
+   long total; /**< Total stage time in us. */
+   long cat[LOADTIME_MAX]; /**< Category time in us. */
+} LoadStage;
+
+
+static LoadStage lt_stages[ LOADTIME_STAGES ]; /**< Recorded stages. */
+static int lt_nstages   = 0; /**< Stages recorded so far. */
+static long lt_open     = 0; /**< When the current stage opened. */
+static long lt_running[ LOADTIME_MAX ]; /**< Running category totals. */
+static long lt_snap[ LOADTIME_MAX ]; /**< Totals when the stage opened. */
+static int lt_done      = 0; /**< Report printed, accounting is over. */
+
+
+/**
+ * @brief Gets the current time in microseconds.
+ */
+static long lt_time (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (long)tv.tv_sec * 1000000L + (long)tv.tv_usec;
+#elif HAS_WIN32
+   struct _timeb tb;
+   _ftime( &tb );
+   return (long)tb.time * 1000000L + (long)tb.millitm * 1000L;
+#else
+#error "Needs either POSIX or WIN32."
+#endif
+}
+
+
+/**
+ * @brief Closes the stage currently being timed, if any.
+ */
+static void lt_close (void)
+{
+   LoadStage *s;
+   int i;
+
+   if ((lt_nstages == 0) || (lt_nstages > LOADTIME_STAGES))
+      return;
+
+   s = &lt_stages[ lt_nstages-1 ];
+   s->total = lt_time() - lt_open;
+   for (i=0; i<LOADTIME_MAX; i++)
+      s->cat[i] = lt_running[i] - lt_snap[i];
+}
+
+
+/**
+ * @brief Opens a new loading stage, closing the previous one.
+ *
+ *    @param name Loadscreen message naming the stage.
+ */
+void loadtime_stage( const char *name )
+{
+   int i;
+
+   if (lt_done)
+      return;
+
+   lt_close();
+
+   if (lt_nstages >= LOADTIME_STAGES)
+      return;
+
+   strncpy( lt_stages[ lt_nstages ].name, name, LOADTIME_NAME_LEN-1 );
+   lt_nstages++;
+   lt_open = lt_time();
+   for (i=0; i<LOADTIME_MAX; i++)
+      lt_snap[i] = lt_running[i];
+}
+
+
+/**
+ * @brief Charges time to a category within the current stage.
+ *
+ *    @param cat Category, one of LOADTIME_*.
+ *    @param us Microseconds to charge.
+ */
+void loadtime_account( int cat, long us )
+{
+   if (lt_done || (cat < 0) || (cat >= LOADTIME_MAX))
+      return;
+   lt_running[cat] += us;
+}
+
+
+/**
+ * @brief Logs the stage table and exports it, ending the accounting.
+ */
+void loadtime_report (void)
+{
+   char buf[PATH_MAX];
+   FILE *csv;
+   LoadStage *s;
+   long par, total;
+   int i;
+
+   if (lt_done)
+      return;
+   lt_close();
+   lt_done = 1;
+
+   snprintf( buf, PATH_MAX, "%sloadtime.csv", nfile_basePath() );
+   csv = fopen( buf, "w" );
+   if (csv != NULL)
+      fprintf( csv, "stage,total_us,io_us,decode_us,gpu_us,parse_us\n" );
+
+   LOG("Load times:");
+   total = 0;
+   for (i=0; i<lt_nstages; i++) {
+      s = &lt_stages[i];
+      par = s->total - s->cat[LOADTIME_IO] - s->cat[LOADTIME_DECODE]
+            - s->cat[LOADTIME_GPU];
+      if (par < 0) /* Worker overlap can exceed the wall time. */
+         par = 0;
+      LOG("   %-32s %7.1f ms (io %6.1f, decode %6.1f, gpu %6.1f, parse %6.1f)",
+            s->name, s->total/1000., s->cat[LOADTIME_IO]/1000.,
+            s->cat[LOADTIME_DECODE]/1000., s->cat[LOADTIME_GPU]/1000.,
+            par/1000. );
+      if (csv != NULL)
+         fprintf( csv, "\"%s\",%ld,%ld,%ld,%ld,%ld\n", s->name, s->total,
+               s->cat[LOADTIME_IO], s->cat[LOADTIME_DECODE],
+               s->cat[LOADTIME_GPU], par );
+      total += s->total;
+   }
+   LOG("   Total: %.1f ms", total/1000.);
+
+   if (csv != NULL)
+      fclose(csv);
+}
+
+
+/**
+ * @brief Gets the time for bracketing a timed section.
+ *
+ * Exposed so callers don't each need their own clock.
+ */
+long loadtime_now (void)
+{
+   return lt_time();
+}
@@ -0,0 +1,37 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef LOADTIME_H
+#  define LOADTIME_H
+
+
+/*
+ * Categories the stage time gets broken down into.  Whatever is left
+ * over is reported as parse/cpu.
+ */
+#define LOADTIME_IO        0 /**< ndata/pack reads. */
+#define LOADTIME_DECODE    1 /**< Image decode and surface conversion. */
+#define LOADTIME_GPU       2 /**< Texture uploads. */
+#define LOADTIME_MAX       3 /**< Category sentinel. */
+
+
+/*
+ * Stage boundaries, driven by the loadscreen.
+ */
+void loadtime_stage( const char *name );
+
+/*
+ * Category accounting, called from the I/O and texture paths.
+ */
+long loadtime_now (void);
+void loadtime_account( int cat, long us );
+
+/*
+ * Report, closes the last stage and disables further accounting.
+ */
+void loadtime_report (void);
+
+
+#endif /* LOADTIME_H */
@@ -0,0 +1,194 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file lprof.c
+ *
+ * @brief Sampling profiler for all the Lua states.
+ *
+ * nlua_newState() installs a count hook on every state it creates, so AI,
+ *  mission and event scripts all report into the same table.  The hook
+ *  fires every LPROF_INTERVAL VM instructions and charges one sample to
+ *  the function on top of the stack, keyed by where it was defined.
+ *  Instructions are a proxy for time, but a stable one: a function with
+ *  ten times the samples of its siblings is eating ten times the VM.
+ *
+ * Browsable from the console through cli.profile(), see nlua_cli.c.
+ */
+
+#include "lprof.h"
+
+#include "naev.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+
+#include "log.h"
+
+
+#define LPROF_INTERVAL  200 /**< VM instructions between samples. */
+#define LPROF_MAX       512 /**< Maximum distinct functions tracked. */
+#define LPROF_KEY_LEN    96 /**< Maximum length of a function key. */
+
+
+/**
+ * @brief A profiled Lua function.
+ */
+typedef struct LProfEntry_ {
+   char key[LPROF_KEY_LEN]; /**< "source:line name", empty if unused. */
+   long samples; /**< Samples charged to the function. */
+} LProfEntry;
+
+
+static LProfEntry lprof_table[ LPROF_MAX ]; /**< Sample accumulator. */
+static int lprof_on = 0; /**< Whether samples are being collected. */
+static long lprof_dropped = 0; /**< Samples lost to a full table. */
+
+
+/**
+ * @brief Charges one sample to the given key.
+ */
+static void lprof_charge( const char *key )
+{
+   unsigned int h;
+   int i, j;
+
+   /* djb2. */
+   h = 5381;
+   for (i=0; key[i] != '\0'; i++)
+      h = h*33 + (unsigned char)key[i];
+
+   /* Linear probing. */
+   for (j=0; j<LPROF_MAX; j++) {
+      i = (h+j) % LPROF_MAX;
+      if (lprof_table[i].key[0] == '\0') {
+         strncpy( lprof_table[i].key, key, LPROF_KEY_LEN-1 );
+         lprof_table[i].samples = 1;
+         return;
+      }
+      if (strcmp( lprof_table[i].key, key ) == 0) {
+         lprof_table[i].samples++;
+         return;
+      }
+   }
+
+   lprof_dropped++;
+}
+
+
+/**
+ * @brief The count hook itself, runs every LPROF_INTERVAL instructions.
+ */
+static void lprof_hookFunc( lua_State *L, lua_Debug *ar )
+{
+   char key[LPROF_KEY_LEN];
+
+   if (!lprof_on)
+      return;
+
+   if (lua_getinfo( L, "nS", ar ) == 0)
+      return;
+
+   /* C functions have no source position worth printing. */
+   if (ar->what[0] == 'C')
+      snprintf( key, sizeof(key), "[C] %s",
+            (ar->name != NULL) ? ar->name : "?" );
+   else if (ar->name != NULL)
+      snprintf( key, sizeof(key), "%s:%d %s",
+            ar->short_src, ar->linedefined, ar->name );
+   else
+      snprintf( key, sizeof(key), "%s:%d",
+            ar->short_src, ar->linedefined );
+
+   lprof_charge( key );
+}
+
+
+/**
+ * @brief Installs the profiling hook on a freshly created state.
+ *
+ * Always installed so states created before the profiler is started
+ *  still report; the hook returns immediately while collection is off.
+ *
+ *    @param L State to hook.
+ */
+void lprof_hook( lua_State *L )
+{
+   lua_sethook( L, lprof_hookFunc, LUA_MASKCOUNT, LPROF_INTERVAL );
+}
+
+
+/**
+ * @brief Starts collecting samples.
+ */
+void lprof_start (void)
+{
+   lprof_on = 1;
+}
+
+
+/**
+ * @brief Stops collecting samples, keeping the table.
+ */
+void lprof_stop (void)
+{
+   lprof_on = 0;
+}
+
+
+/**
+ * @brief Throws away all collected samples.
+ */
+void lprof_clear (void)
+{
+   memset( lprof_table, 0, sizeof(lprof_table) );
+   if (lprof_dropped > 0)
+      WARN("Lua profiler dropped %ld samples, table full.", lprof_dropped);
+   lprof_dropped = 0;
+}
+
+
+/**
+ * @brief Whether samples are currently being collected.
+ */
+int lprof_active (void)
+{
+   return lprof_on;
+}
+
+
+/**
+ * @brief Gets the size of the result table.
+ *
+ * Entries may be empty, check lprof_name().
+ */
+int lprof_entries (void)
+{
+   return LPROF_MAX;
+}
+
+
+/**
+ * @brief Gets the key of entry i or NULL if the slot is unused.
+ */
+const char* lprof_name( int i )
+{
+   if ((i < 0) || (i >= LPROF_MAX) || (lprof_table[i].key[0] == '\0'))
+      return NULL;
+   return lprof_table[i].key;
+}
+
+
+/**
+ * @brief Gets the samples charged to entry i.
+ */
+long lprof_samples( int i )
+{
+   if ((i < 0) || (i >= LPROF_MAX))
+      return 0;
+   return lprof_table[i].samples;
+}
@@ -0,0 +1,34 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef LPROF_H
+#  define LPROF_H
+
+
+#include "lua.h"
+
+
+/*
+ * Hook installation, done once per state by nlua_newState().
+ */
+void lprof_hook( lua_State *L );
+
+/*
+ * Control.
+ */
+void lprof_start (void);
+void lprof_stop (void);
+void lprof_clear (void);
+int lprof_active (void);
+
+/*
+ * Result access, for the console bindings.
+ */
+int lprof_entries (void);
+const char* lprof_name( int i );
+long lprof_samples( int i );
+
+
+#endif /* LPROF_H */
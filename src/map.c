@@ -38,11 +38,39 @@ static int map_drag           = 0; /**< Is the user dragging the map? */
 static int map_selected       = -1; /**< What system is selected on the map. */
 static StarSystem **map_path  = NULL; /**< The path to current selected system. */
 int map_npath                 = 0; /**< Number of systems in map_path. */
-glTexture *gl_faction_disk    = NULL; /**< Texture of the disk representing factions. */
 
 /* VBO. */
 static gl_vbo *map_vbo = NULL; /**< Map VBO. */
 
+/*
+ * Baked geometry cache.  Node circles and hyperspace lanes only depend
+ *  on the zoom, the current route and what the player knows, so they
+ *  are baked into a single VBO when any of those change and the
+ *  per-frame render is a translation plus two draw calls.  Faction
+ *  discs, names and markers stay immediate since they are textured or
+ *  text.
+ */
+#define MAP_CIRCLE_SEG  24 /**< Segments of a baked node circle. */
+static gl_vbo *map_cacheVBO   = NULL; /**< Baked lane/node geometry. */
+static GLfloat *map_cacheData = NULL; /**< Staging buffer for rebuilds. */
+static int map_cacheSize      = 0; /**< Vertices the staging buffer fits. */
+static int map_cacheLines     = 0; /**< Baked line vertices. */
+static int map_cacheTris      = 0; /**< Baked triangle vertices. */
+static int map_cacheDiscs     = 0; /**< Baked faction disc vertices. */
+static int map_cacheDirty     = 1; /**< Geometry must be rebuilt. */
+static int map_cacheHyper     = -2; /**< hyperspace_target at bake time. */
+static int map_cacheFuel      = -1; /**< Jumps worth of fuel at bake time. */
+static double map_cacheZoom   = 0.; /**< map_zoom at bake time. */
+
+/*
+ * All-pairs next-hop cache over the static jump graph, built once at
+ *  space_load() time.  map_nexthop[s*N + t] is the index of the first
+ *  system to jump to on a shortest route from s to t, or -1 when t is
+ *  unreachable.  Only usable for queries that ignore player knowledge.
+ */
+static int *map_nexthop       = NULL; /**< All-pairs next-hop matrix. */
+static int map_nexthopSys     = 0; /**< Number of systems the cache covers. */
+
 
 /*
  * extern
@@ -57,6 +85,7 @@ extern int systems_nstack;
  */
 static void map_update( unsigned int wid );
 static int map_inPath( StarSystem *sys );
+static void map_cacheBuild (void);
 static void map_render( double bx, double by, double w, double h, void *data );
 static void map_mouse( unsigned int wid, SDL_Event* event, double mx, double my,
       double w, double h, void *data );
@@ -90,6 +119,74 @@ void map_exit (void)
       gl_vboDestroy(map_vbo);
       map_vbo = NULL;
    }
+
+   /* Destroy the geometry cache. */
+   if (map_cacheVBO != NULL) {
+      gl_vboDestroy(map_cacheVBO);
+      map_cacheVBO = NULL;
+   }
+   if (map_cacheData != NULL) {
+      free(map_cacheData);
+      map_cacheData = NULL;
+      map_cacheSize = 0;
+   }
+
+   /* Destroy the route cache. */
+   if (map_nexthop != NULL) {
+      free(map_nexthop);
+      map_nexthop = NULL;
+      map_nexthopSys = 0;
+   }
+}
+
+
+/**
+ * @brief Builds the all-pairs next-hop route cache.
+ *
+ * Called from space_load() once the jump graph is final.  Does a BFS
+ *  from every system, which is cheap since jumps are unweighted.
+ */
+void map_buildRouteCache (void)
+{
+   int i, s, t, n, head, tail;
+   int *row, *dist, *queue;
+   StarSystem *sys;
+
+   if (map_nexthop != NULL)
+      free(map_nexthop);
+   map_nexthopSys = systems_nstack;
+   map_nexthop = malloc( sizeof(int) * systems_nstack * systems_nstack );
+   dist  = malloc( sizeof(int) * systems_nstack );
+   queue = malloc( sizeof(int) * systems_nstack );
+
+   for (s=0; s<systems_nstack; s++) {
+      row = &map_nexthop[ s*systems_nstack ];
+      for (i=0; i<systems_nstack; i++) {
+         row[i]  = -1;
+         dist[i] = -1;
+      }
+
+      /* Breadth first search from s. */
+      head = tail = 0;
+      dist[s] = 0;
+      row[s]  = s;
+      queue[tail++] = s;
+      while (head < tail) {
+         t   = queue[head++];
+         sys = system_getIndex(t);
+         for (i=0; i<sys->njumps; i++) {
+            n = sys->jumps[i];
+            if (dist[n] >= 0)
+               continue;
+            dist[n] = dist[t] + 1;
+            row[n]  = (t==s) ? n : row[t]; /* First hop towards n. */
+            queue[tail++] = n;
+         }
+      }
+   }
+
+   free(dist);
+   free(queue);
 }
 
 
@@ -116,6 +213,9 @@ void map_open (void)
    /* mark systems as needed */
    mission_sysMark();
 
+   /* Marking may have changed what is visible. */
+   map_cacheDirty = 1;
+
    /* Attempt to select current map if none is selected */
    if (map_selected == -1)
       map_selectCur();
@@ -495,146 +595,197 @@ static void map_drawMarker( double x, double y, double r,
 }
 
 /**
- * @brief Generates a texture to represent factions
+ * @brief Marks the baked map geometry as stale.
  *
- * @param radius radius of the disk
- * @return the texture
+ * For changes map.c cannot see itself, like unidiff adding or removing
+ *  planets and with them a system's faction.
  */
-static glTexture *gl_genFactionDisk( int radius )
+void map_cacheInvalidate (void)
 {
-   int i, j;
-   uint8_t *pixels;
-   SDL_Surface *sur;
-   int dist;
-   double alpha;
-
-   /* Calculate parameters. */
-   const int w = 2 * radius + 1;
-   const int h = 2 * radius + 1;
-
-   /* Create the surface. */
-   sur = SDL_CreateRGBSurface( SDL_SRCALPHA | SDL_HWSURFACE, w, h, 32, RGBAMASK );
-
-   pixels = sur->pixels;
-   memset(pixels, 0xff, sizeof(uint8_t) * 4 * h * w);
-
-   /* Generate the circle. */
-   SDL_LockSurface( sur );
-
-   /* Draw the circle with filter. */
-   for (i=0; i<h; i++) {
-      for (j=0; j<w; j++) {
-         /* Calculate blur. */
-         dist = (i - radius) * (i - radius) + (j - radius) * (j - radius);
-         alpha = 0.;
-
-         if (dist < radius * radius) {
-            /* Computes alpha with an empirically chosen formula.
-             * This formula accounts for the fact that the eyes
-             * has a logarithmic sensitivity to light */
-            alpha = 1. * dist / (radius * radius);
-            alpha = (exp(1 / (alpha + 1) - 0.5) - 1) * 0xFF;
-         }
-
-         /* Sets the pixel alpha which is the forth byte
-          * in the pixel representation. */
-         pixels[i*sur->pitch + j*4 + 3] = (uint8_t)alpha;
-      }
-   }
-
-   SDL_UnlockSurface( sur );
-
-   /* Return texture. */
-   return gl_loadImage( sur, OPENGL_TEX_MIPMAPS );
+   map_cacheDirty = 1;
 }
 
+
 /**
- * @brief Renders the custom map widget.
+ * @brief Rebuilds the baked lane and node geometry.
  *
- *    @param bx Base X position to render at.
- *    @param by Base Y position to render at.
- *    @param w Width of the widget.
- *    @param h Height of the widget.
+ * Bakes every visible system's node circle, every known system's
+ *  hyperspace lanes and the faction territory discs - colours included -
+ *  into map_cacheData at screen scale, so map_render() only has to
+ *  translate by the pan offset and issue a few draw calls.  Layout is
+ *  all the positions followed by all the colours, line vertices first,
+ *  then node triangles, then disc triangles.
+ *
+ * Invalidated by map_open(), map_select(), map_jump() and
+ *  map_cacheInvalidate(); zoom, route and fuel changes are caught by
+ *  snapshot comparison in map_render().
  */
-static void map_render( double bx, double by, double w, double h, void *data )
+static void map_cacheBuild (void)
 {
-   (void) data;
-   int i,j, n,m;
-   double x,y,r, tx,ty;
+   int i, j, k, n, m, nl, nt, nd, li, nv;
+   double r, rd, cx, cy, mx, my, a, b, a0, a1;
    StarSystem *sys, *jsys, *hsys;
-   glColour *col, c;
-   GLfloat vertex[8*(2+4)];
-   int sw, sh;
+   glColour *col;
+   GLfloat *pos, *clr;
 
-   /* Parameters. */
-   r = round(CLAMP(5., 15., 6.*map_zoom));
-   x = round((bx - map_xpos + w/2) * 1.);
-   y = round((by - map_ypos + h/2) * 1.);
+   r  = round(CLAMP(5., 15., 6.*map_zoom));
+   rd = 50. * map_zoom; /* Faction disc radius. */
 
-   /* background */
-   gl_renderRect( bx, by, w, h, &cBlack );
-
-   /*
-    * First pass renders everything almost (except names and markers).
-    */
+   /* Count pass so a single allocation fits everything. */
+   nl = 0;
+   nt = 0;
+   nd = 0;
    for (i=0; i<systems_nstack; i++) {
       sys = system_getIndex( i );
-
-      /* check to make sure system is known or adjacent to known (or marked) */
       if (!sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED)
             && !space_sysReachable(sys))
          continue;
+      nl += 2*MAP_CIRCLE_SEG; /* Node outline. */
+      if (!sys_isKnown(sys))
+         continue;
+      if (sys->faction != -1)
+         nd += 9*MAP_CIRCLE_SEG; /* Faction disc, fan plus one ring. */
+      if (sys->nplanets > 0)
+         nt += 3*MAP_CIRCLE_SEG; /* Filled node. */
+      nl += 4*sys->njumps; /* Lanes, two segments each for the fade. */
+   }
+   map_cacheLines = nl;
+   map_cacheTris  = nt;
+   map_cacheDiscs = nd;
+   nv = nl + nt + nd;
+
+   /* Snapshot what the bake depends on. */
+   map_cacheZoom  = map_zoom;
+   map_cacheHyper = hyperspace_target;
+   map_cacheFuel  = pilot_getJumps(player);
+   map_cacheDirty = 0;
+
+   if (nv == 0)
+      return;
 
-      tx = x + sys->pos.x*map_zoom;
-      ty = y + sys->pos.y*map_zoom;
+   /* Grow the staging buffer as needed. */
+   if (map_cacheSize < nv) {
+      map_cacheSize = nv;
+      map_cacheData = realloc( map_cacheData, sizeof(GLfloat) * (2+4)*nv );
+   }
+   pos = map_cacheData;
+   clr = &map_cacheData[ 2*nv ];
 
-      /* draws the disk representing the faction */
-      if (sys_isKnown(sys) && (sys->faction != -1)) {
-         sw = gl_faction_disk->sw;
-         sh = gl_faction_disk->sw;
-
-         col = faction_colour(sys->faction);
-         c.r = col->r;
-         c.g = col->g;
-         c.b = col->b;
-         c.a = 0.7;
-
-         gl_blitTexture(
-               gl_faction_disk,
-               tx - sw/2, ty - sh/2, sw, sh,
-               0., 0., gl_faction_disk->srw, gl_faction_disk->srw, &c );
-      }
+   /* Approximates the old disc texture's radial alpha falloff
+    * (exp(1/(s^2+1)-1/2)-1, 0.7 overall) at the center and half way. */
+   a0 = 0.7 * (exp(0.5) - 1.);
+   a1 = 0.7 * (exp(0.3) - 1.);
+
+   li = 0; /* Next line vertex. */
+   nt = nl; /* Next node triangle vertex, they follow the lines. */
+   nd = nl + map_cacheTris; /* Next disc vertex, they come last. */
+   for (i=0; i<systems_nstack; i++) {
+      sys = system_getIndex( i );
+      if (!sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED)
+            && !space_sysReachable(sys))
+         continue;
 
-      /* Draw the system. */
+      cx = sys->pos.x * map_zoom;
+      cy = sys->pos.y * map_zoom;
+
+      /* Node outline, colour gives the security at a glance. */
       if (!sys_isKnown(sys) || (sys->nfleets==0)) col = &cInert;
       else if (sys->security >= 1.) col = &cGreen;
       else if (sys->security >= 0.6) col = &cOrange;
       else if (sys->security >= 0.3) col = &cRed;
       else col = &cDarkRed;
 
-      gl_drawCircleInRect( tx, ty, r, bx, by, w, h, col, 0 );
-
-      /* If system is known fill it. */
-      if (sys_isKnown(sys) && (sys->nplanets > 0)) {
-         /* Planet colours */
-         if (!sys_isKnown(sys)) col = &cInert;
-         else if (sys->nplanets==0) col = &cInert;
-         else col = faction_getColour( sys->faction);
-
-         /* Radius slightly shorter. */
-         gl_drawCircleInRect( tx, ty, 0.5*r, bx, by, w, h, col, 1 );
+      for (k=0; k<MAP_CIRCLE_SEG; k++) {
+         a = 2.*M_PI * (double)k / (double)MAP_CIRCLE_SEG;
+         b = 2.*M_PI * (double)(k+1) / (double)MAP_CIRCLE_SEG;
+         pos[2*li+0] = cx + r * cos(a);
+         pos[2*li+1] = cy + r * sin(a);
+         pos[2*li+2] = cx + r * cos(b);
+         pos[2*li+3] = cy + r * sin(b);
+         for (m=0; m<2; m++) {
+            clr[4*(li+m)+0] = col->r;
+            clr[4*(li+m)+1] = col->g;
+            clr[4*(li+m)+2] = col->b;
+            clr[4*(li+m)+3] = col->a;
+         }
+         li += 2;
       }
 
       if (!sys_isKnown(sys))
-         continue; /* we don't draw hyperspace lines */
+         continue; /* We don't bake hyperspace lanes. */
+
+      /* Faction territory disc, a fan and a ring so the radial fade
+       * stays close to the old texture. */
+      if (sys->faction != -1) {
+         col = faction_colour( sys->faction );
+         for (k=0; k<MAP_CIRCLE_SEG; k++) {
+            a = 2.*M_PI * (double)k / (double)MAP_CIRCLE_SEG;
+            b = 2.*M_PI * (double)(k+1) / (double)MAP_CIRCLE_SEG;
+            /* Fan from the center to the inner ring. */
+            pos[2*nd+0]  = cx;
+            pos[2*nd+1]  = cy;
+            pos[2*nd+2]  = cx + 0.5*rd * cos(a);
+            pos[2*nd+3]  = cy + 0.5*rd * sin(a);
+            pos[2*nd+4]  = cx + 0.5*rd * cos(b);
+            pos[2*nd+5]  = cy + 0.5*rd * sin(b);
+            /* Inner ring to the rim, two triangles. */
+            pos[2*nd+6]  = cx + 0.5*rd * cos(a);
+            pos[2*nd+7]  = cy + 0.5*rd * sin(a);
+            pos[2*nd+8]  = cx + rd * cos(a);
+            pos[2*nd+9]  = cy + rd * sin(a);
+            pos[2*nd+10] = cx + rd * cos(b);
+            pos[2*nd+11] = cy + rd * sin(b);
+            pos[2*nd+12] = cx + 0.5*rd * cos(a);
+            pos[2*nd+13] = cy + 0.5*rd * sin(a);
+            pos[2*nd+14] = cx + rd * cos(b);
+            pos[2*nd+15] = cy + rd * sin(b);
+            pos[2*nd+16] = cx + 0.5*rd * cos(b);
+            pos[2*nd+17] = cy + 0.5*rd * sin(b);
+            for (m=0; m<9; m++) {
+               clr[4*(nd+m)+0] = col->r;
+               clr[4*(nd+m)+1] = col->g;
+               clr[4*(nd+m)+2] = col->b;
+            }
+            clr[4*(nd+0)+3] = a0;
+            clr[4*(nd+1)+3] = a1;
+            clr[4*(nd+2)+3] = a1;
+            clr[4*(nd+3)+3] = a1;
+            clr[4*(nd+4)+3] = 0.;
+            clr[4*(nd+5)+3] = 0.;
+            clr[4*(nd+6)+3] = a1;
+            clr[4*(nd+7)+3] = 0.;
+            clr[4*(nd+8)+3] = a1;
+            nd += 9;
+         }
+      }
+
+      /* If system is known fill it. */
+      if (sys->nplanets > 0) {
+         col = faction_getColour( sys->faction );
+         for (k=0; k<MAP_CIRCLE_SEG; k++) {
+            a = 2.*M_PI * (double)k / (double)MAP_CIRCLE_SEG;
+            b = 2.*M_PI * (double)(k+1) / (double)MAP_CIRCLE_SEG;
+            pos[2*nt+0] = cx;
+            pos[2*nt+1] = cy;
+            pos[2*nt+2] = cx + 0.5*r * cos(a);
+            pos[2*nt+3] = cy + 0.5*r * sin(a);
+            pos[2*nt+4] = cx + 0.5*r * cos(b);
+            pos[2*nt+5] = cy + 0.5*r * sin(b);
+            for (m=0; m<3; m++) {
+               clr[4*(nt+m)+0] = col->r;
+               clr[4*(nt+m)+1] = col->g;
+               clr[4*(nt+m)+2] = col->b;
+               clr[4*(nt+m)+3] = col->a;
+            }
+            nt += 3;
+         }
+      }
 
-      /* draw the hyperspace paths */
-      glShadeModel(GL_SMOOTH);
-      /* cheaply use transparency instead of actually calculating
-       * from where to where the line must go :) */  
+      /* Bake the hyperspace lanes. */
       for (j=0; j<sys->njumps; j++) {
 
          jsys = system_getIndex( sys->jumps[j] );
+         hsys = NULL;
          if (hyperspace_target != -1)
             hsys = system_getIndex( cur_system->jumps[hyperspace_target] );
 
@@ -642,7 +793,7 @@ static void map_render( double bx, double by, double w, double h, void *data )
          m = map_inPath(sys);
          /* set the colours */
          /* is the route the current one? */
-         if ((hyperspace_target != -1) && 
+         if ((hyperspace_target != -1) &&
                ( ((cur_system==sys) && (j==hyperspace_target)) ||
                   ((cur_system==jsys) &&
                      (sys==hsys )))) {
@@ -661,33 +812,86 @@ static void map_render( double bx, double by, double w, double h, void *data )
          else
             col = &cDarkBlue;
 
-         /* Draw the lines. */
-         vertex[0]  = x + sys->pos.x * map_zoom;
-         vertex[1]  = y + sys->pos.y * map_zoom;
-         vertex[2]  = vertex[0] + (jsys->pos.x - sys->pos.x)/2. * map_zoom;
-         vertex[3]  = vertex[1] + (jsys->pos.y - sys->pos.y)/2. * map_zoom;
-         vertex[4]  = x + jsys->pos.x * map_zoom;
-         vertex[5]  = y + jsys->pos.y * map_zoom;
-         vertex[6]  = col->r;
-         vertex[7]  = col->g;
-         vertex[8]  = col->b;
-         vertex[9]  = 0.;
-         vertex[10] = col->r;
-         vertex[11] = col->g;
-         vertex[12] = col->b;
-         vertex[13] = col->a;
-         vertex[14] = col->r;
-         vertex[15] = col->g;
-         vertex[16] = col->b;
-         vertex[17] = 0.;
-         gl_vboSubData( map_vbo, 0, sizeof(GLfloat) * 3*(2+4), vertex );
-         gl_vboActivateOffset( map_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-         gl_vboActivateOffset( map_vbo, GL_COLOR_ARRAY,
-               sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
-         glDrawArrays( GL_LINE_STRIP, 0, 3 );
-         gl_vboDeactivate();
+         /* Two segments meeting at the midpoint carry the alpha fade. */
+         mx = cx + (jsys->pos.x - sys->pos.x)/2. * map_zoom;
+         my = cy + (jsys->pos.y - sys->pos.y)/2. * map_zoom;
+         pos[2*li+0] = cx;
+         pos[2*li+1] = cy;
+         pos[2*li+2] = mx;
+         pos[2*li+3] = my;
+         pos[2*li+4] = mx;
+         pos[2*li+5] = my;
+         pos[2*li+6] = jsys->pos.x * map_zoom;
+         pos[2*li+7] = jsys->pos.y * map_zoom;
+         for (m=0; m<4; m++) {
+            clr[4*(li+m)+0] = col->r;
+            clr[4*(li+m)+1] = col->g;
+            clr[4*(li+m)+2] = col->b;
+            clr[4*(li+m)+3] = ((m==1) || (m==2)) ? col->a : 0.;
+         }
+         li += 4;
       }
+   }
+
+   /* Upload. */
+   if (map_cacheVBO == NULL)
+      map_cacheVBO = gl_vboCreateStatic( sizeof(GLfloat) * (2+4)*nv,
+            map_cacheData );
+   else
+      gl_vboData( map_cacheVBO, sizeof(GLfloat) * (2+4)*nv, map_cacheData );
+}
+
+
+/**
+ * @brief Renders the custom map widget.
+ *
+ *    @param bx Base X position to render at.
+ *    @param by Base Y position to render at.
+ *    @param w Width of the widget.
+ *    @param h Height of the widget.
+ */
+static void map_render( double bx, double by, double w, double h, void *data )
+{
+   (void) data;
+   int i,j, n,m, nv;
+   double x,y,r, tx,ty;
+   StarSystem *sys;
+
+   /* Parameters. */
+   r = round(CLAMP(5., 15., 6.*map_zoom));
+   x = round((bx - map_xpos + w/2) * 1.);
+   y = round((by - map_ypos + h/2) * 1.);
+
+   /* background */
+   gl_renderRect( bx, by, w, h, &cBlack );
+
+   /* Rebuild the baked geometry if anything it depends on changed. */
+   if (map_cacheDirty || (map_cacheZoom != map_zoom) ||
+         (map_cacheHyper != hyperspace_target) ||
+         (map_cacheFuel != pilot_getJumps(player)))
+      map_cacheBuild();
+
+   /* Draw the baked discs, lanes and nodes, panning is just a
+    * translation.  Discs go first so they end up under everything. */
+   nv = map_cacheLines + map_cacheTris + map_cacheDiscs;
+   if ((map_cacheVBO != NULL) && (nv > 0)) {
+      gl_matrixMode( GL_PROJECTION );
+      gl_matrixPush();
+      gl_matrixTranslate( x, y );
+      glShadeModel(GL_SMOOTH); /* Lane and disc fades are baked per vertex. */
+      gl_vboActivateOffset( map_cacheVBO, GL_VERTEX_ARRAY, 0,
+            2, GL_FLOAT, 0 );
+      gl_vboActivateOffset( map_cacheVBO, GL_COLOR_ARRAY,
+            sizeof(GLfloat) * 2*nv, 4, GL_FLOAT, 0 );
+      if (map_cacheDiscs > 0)
+         glDrawArrays( GL_TRIANGLES,
+               map_cacheLines + map_cacheTris, map_cacheDiscs );
+      glDrawArrays( GL_LINES, 0, map_cacheLines );
+      if (map_cacheTris > 0)
+         glDrawArrays( GL_TRIANGLES, map_cacheLines, map_cacheTris );
+      gl_vboDeactivate();
       glShadeModel( GL_FLAT );
+      gl_matrixPop();
    }
 
 
@@ -933,11 +1137,15 @@ static void map_selectCur (void)
  */
 void map_jump (void)
 {
-   int j;
+   int i, j;
+   StarSystem *esys;
 
    /* set selected system to self */
    map_selectCur();
 
+   /* The route and the known set both changed. */
+   map_cacheDirty = 1;
+
    map_xpos = cur_system->pos.x;
    map_ypos = cur_system->pos.y;
 
@@ -954,12 +1162,31 @@ void map_jump (void)
          memmove( &map_path[0], &map_path[1], sizeof(StarSystem*) * map_npath );
          map_path = realloc( map_path, sizeof(StarSystem*) * map_npath );
 
-         /* set the next jump to be to the next in path */
-         for (j=0; j<cur_system->njumps; j++) {
-            if (map_path[0]==system_getIndex(cur_system->jumps[j])) {
-               planet_target = -1; /* override planet_target */
-               hyperspace_target = j;
+         /* The universe may have changed under the plan (unidiff) -
+          *  replan to the same destination if a system on the remaining
+          *  route is no longer reachable, instead of following a stale
+          *  route or repathing every jump. */
+         for (i=0; i<map_npath; i++)
+            if (!sys_isKnown(map_path[i]) && !space_sysReachable(map_path[i]))
                break;
+         if (i < map_npath) {
+            esys = map_path[ map_npath-1 ];
+            free( map_path );
+            map_path = map_getJumpPath( &map_npath,
+                  cur_system->name, esys->name, 0 );
+         }
+
+         /* set the next jump to be to the next in path */
+         hyperspace_target = -1;
+         if (map_path == NULL)
+            planet_target = -1;
+         else {
+            for (j=0; j<cur_system->njumps; j++) {
+               if (map_path[0]==system_getIndex(cur_system->jumps[j])) {
+                  planet_target = -1; /* override planet_target */
+                  hyperspace_target = j;
+                  break;
+               }
             }
          }
 
@@ -968,6 +1195,21 @@ void map_jump (void)
 }
 
 
+/**
+ * @brief Gets the current route, for GUI progress display.
+ *
+ * The array is owned by the map, do not free it.
+ *
+ *    @param[out] n Number of systems left on the route.
+ *    @return The route or NULL when none is set.
+ */
+StarSystem** map_getRoute( int *n )
+{
+   *n = map_npath;
+   return map_path;
+}
+
+
 /**
  * @brief Selects the system in the map.
  *
@@ -1006,6 +1248,9 @@ void map_select( StarSystem *sys )
       }
    }
 
+   /* The path lanes need rebaking. */
+   map_cacheDirty = 1;
+
    map_update(wid);
 }
 
@@ -1055,11 +1300,8 @@ static SysNode* A_newNode( StarSystem* sys, SysNode* parent )
 /** @brief Heurestic model to use. */
 static double A_h( StarSystem *n, StarSystem *g )
 {
-   (void)n;
-   (void)g;
    /* Euclidean distance */
-   /*return sqrt(pow2(n->pos.x - g->pos.x) + pow2(n->pos.y - g->pos.y))/100.;*/
-   return 0.;
+   return sqrt(pow2(n->pos.x - g->pos.x) + pow2(n->pos.y - g->pos.y))/100.;
 }
 /** @brief Gets the g from a node. */
 static double A_g( SysNode* n )
@@ -1154,13 +1396,10 @@ static void A_freeList( SysNode *first )
    free(p);
 }
 
-/** @brief Sets map_zoom to zoom and recreats the faction disk texture. */
+/** @brief Sets map_zoom to zoom, map_render() rebakes the geometry. */
 void map_setZoom(double zoom)
 {
    map_zoom = zoom;
-   if (gl_faction_disk != NULL)
-      gl_freeTexture( gl_faction_disk );
-   gl_faction_disk = gl_genFactionDisk( 50 * zoom );
 }
 
 /**
@@ -1196,6 +1435,34 @@ StarSystem** map_getJumpPath( int* njumps,
       return NULL;
    }
 
+   /* Knowledge-blind queries can be answered from the next-hop cache. */
+   if (ignore_known && (map_nexthop != NULL) &&
+         (map_nexthopSys == systems_nstack)) {
+      i = ssys - systems_stack;
+      j = esys - systems_stack;
+      if (map_nexthop[ i*systems_nstack + j ] < 0) { /* unreachable */
+         (*njumps) = 0;
+         return NULL;
+      }
+
+      /* Count the jumps. */
+      cost = 0;
+      while (i != j) {
+         i = map_nexthop[ i*systems_nstack + j ];
+         cost++;
+      }
+
+      /* Build the path. */
+      (*njumps) = cost;
+      res = malloc( sizeof(StarSystem*) * cost );
+      i = ssys - systems_stack;
+      for (cost=0; i!=j; cost++) {
+         i = map_nexthop[ i*systems_nstack + j ];
+         res[cost] = &systems_stack[i];
+      }
+      return res;
+   }
+
    /* start the linked lists */
    open = closed =  NULL;
    cur = A_newNode( ssys, NULL );
@@ -1237,7 +1504,7 @@ StarSystem** map_getJumpPath( int* njumps,
          
          if ((ocost == NULL) && (ccost == NULL)) {
             neighbour->g = cost;
-            neighbour->r = A_g(neighbour) + A_h(cur->sys,sys);
+            neighbour->r = A_g(neighbour) + A_h(sys,esys);
             neighbour->parent = cur;
             open = A_add( open, neighbour );
          }
@@ -1392,6 +1659,9 @@ void map_show( int wid, int x, int y, int w, int h, double zoom )
    /* mark systems as needed */
    mission_sysMark();
 
+   /* Marking may have changed what is visible. */
+   map_cacheDirty = 1;
+
    /* Set position to focus on current system. */
    map_xpos = cur_system->pos.x * zoom;
    map_ypos = cur_system->pos.y * zoom;
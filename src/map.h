@@ -14,6 +14,7 @@
 /* init/exit */
 int map_init (void);
 void map_exit (void);
+void map_buildRouteCache (void);
 
 /* open the map window */
 void map_open (void);
@@ -25,6 +26,8 @@ void map_select( StarSystem *sys );
 void map_cleanup (void);
 void map_clear (void);
 void map_jump (void);
+void map_cacheInvalidate (void);
+StarSystem** map_getRoute( int *n ); /* borrowed, do not free */
 
 /* manipulate universe stuff */
 StarSystem** map_getJumpPath( int* njumps,
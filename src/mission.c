@@ -32,6 +32,7 @@
 #include "space.h"
 #include "cond.h"
 #include "gui_osd.h"
+#include "intern.h"
 
 
 #define XML_MISSION_ID        "Missions" /**< XML document identifier */
@@ -42,6 +43,8 @@
 
 #define MISSION_CHUNK         32 /**< Chunk allocation. */
 
+#define MISSION_STATE_POOL    8 /**< Prepared lua states kept for reuse. */
+
 
 /*
  * current player missions
@@ -57,6 +60,29 @@ static MissionData *mission_stack = NULL; /**< Unmuteable after creation */
 static int mission_nstack = 0; /**< Mssions in stack. */
 
 
+/*
+ * Timer scheduling.
+ *
+ * Mission timers fire at most every few seconds, so instead of walking
+ *  player_missions every frame the update just accrues time against the
+ *  soonest deadline and only sweeps the table when it could have expired.
+ */
+static double mission_timerElapsed = 0.; /**< Time accrued since the last sweep. */
+static double mission_timerNext    = -1.; /**< Soonest timer deadline, negative when none armed. */
+
+
+/*
+ * Recycled mission lua states.
+ *
+ * Setting up a state - registering the standard and mission libraries -
+ *  costs far more than running a mission's create function, and the
+ *  mission computer does it for every candidate on every landing.
+ *  Cleaned-up states go back into a small pool instead of being closed.
+ */
+static lua_State *mission_statePool[MISSION_STATE_POOL]; /**< Reusable states. */
+static int mission_nstatePool = 0; /**< States currently pooled. */
+
+
 /*
  * prototypes
  */
@@ -65,6 +91,8 @@ static int mission_nstack = 0; /**< Mssions in stack. */
 static unsigned int mission_genID (void);
 static int mission_init( Mission* mission, MissionData* misn, int genid, int create );
 static void mission_freeData( MissionData* mission );
+static lua_State* mission_stateGet (void);
+static void mission_stateRecycle( lua_State *L );
 /* Matching. */
 static int mission_compare( const void* arg1, const void* arg2 );
 static int mission_alreadyRunning( MissionData* misn );
@@ -135,6 +163,80 @@ MissionData* mission_get( int id )
 }
 
 
+/**
+ * @brief Gets a lua state with the mission libraries already registered.
+ *
+ * Takes one from the pool when possible, otherwise sets up a fresh one
+ *  and snapshots its global names so recycling knows what to keep.
+ *
+ *    @return The prepared state or NULL on error.
+ */
+static lua_State* mission_stateGet (void)
+{
+   lua_State *L;
+
+   if (mission_nstatePool > 0)
+      return mission_statePool[--mission_nstatePool];
+
+   L = nlua_newState();
+   if (L == NULL)
+      return NULL;
+   nlua_loadBasic( L ); /* pairs and such */
+   misn_loadLibs( L ); /* load our custom libraries */
+
+   /* Record the base global names. */
+   lua_newtable(L); /* t */
+   lua_pushnil(L); /* t, nil */
+   while (lua_next(L, LUA_GLOBALSINDEX) != 0) { /* t, k, v */
+      lua_pop(L,1); /* t, k */
+      lua_pushvalue(L,-1); /* t, k, k */
+      lua_pushboolean(L,1); /* t, k, k, b */
+      lua_settable(L,-4); /* t, k */
+   }
+   lua_setfield(L, LUA_REGISTRYINDEX, "misn_baseGlobals"); /* */
+
+   return L;
+}
+
+
+/**
+ * @brief Returns a mission lua state to the pool.
+ *
+ * Strips every global the mission defined so only the base libraries
+ *  remain, then keeps the state for the next mission_init().
+ *
+ *    @param L State to recycle.
+ */
+static void mission_stateRecycle( lua_State *L )
+{
+   if (mission_nstatePool >= MISSION_STATE_POOL) {
+      nlua_freeState(L);
+      return;
+   }
+
+   lua_settop(L, 0);
+   lua_getfield(L, LUA_REGISTRYINDEX, "misn_baseGlobals"); /* t */
+   lua_pushnil(L); /* t, nil */
+   while (lua_next(L, LUA_GLOBALSINDEX) != 0) { /* t, k, v */
+      lua_pop(L,1); /* t, k */
+      lua_pushvalue(L,-1); /* t, k, k */
+      lua_gettable(L,-3); /* t, k, b */
+      if (!lua_toboolean(L,-1)) { /* clearing existing fields is safe mid-next */
+         lua_pushvalue(L,-2); /* t, k, b, k */
+         lua_pushnil(L); /* t, k, b, k, nil */
+         lua_settable(L, LUA_GLOBALSINDEX); /* t, k, b */
+      }
+      lua_pop(L,1); /* t, k */
+   }
+   lua_pop(L,1); /* */
+
+   /* Shed whatever garbage the mission left behind. */
+   lua_gc(L, LUA_GCCOLLECT, 0);
+
+   mission_statePool[mission_nstatePool++] = L;
+}
+
+
 /**
  * @brief Initializes a mission.
  *
@@ -147,8 +249,6 @@ MissionData* mission_get( int id )
 static int mission_init( Mission* mission, MissionData* misn, int genid, int create )
 {
    int i;
-   char *buf;
-   uint32_t bufsize;
 
    /* clear the mission */
    memset(mission,0,sizeof(Mission));
@@ -164,28 +264,20 @@ static int mission_init( Mission* mission, MissionData* misn, int genid, int cre
    }
 
    /* init lua */
-   mission->L = nlua_newState();
+   mission->L = mission_stateGet();
    if (mission->L == NULL) {
       WARN("Unable to create a new lua state.");
       return -1;
    }
-   nlua_loadBasic( mission->L ); /* pairs and such */
-   misn_loadLibs( mission->L ); /* load our custom libraries */
 
-   /* load the file */
-   buf = ndata_read( misn->lua, &bufsize );
-   if (buf == NULL) {
-      WARN("Mission '%s' Lua script not found.", misn->lua );
-      return -1;
-   }
-   if (luaL_dobuffer(mission->L, buf, bufsize, misn->lua) != 0) {
+   /* load the file through the bytecode cache */
+   if (nlua_dofileCached(mission->L, misn->lua) != 0) {
       WARN("Error loading mission file: %s\n"
           "%s\n"
           "Most likely Lua file has improper syntax, please check",
             misn->lua, lua_tostring(mission->L,-1));
       return -1;
    }
-   free(buf);
 
    /* run create function */
    if (create) {
@@ -267,16 +359,17 @@ static int mission_meetReq( int mission, int faction,
           mission_alreadyRunning(misn)))
       return 0;
 
+   /* Must meet previous mission requirements.  Checked before the Lua
+    * condition so eligibility filters without entering Lua at all. */
+   if ((misn->avail.done != NULL) &&
+         (player_missionAlreadyDone( misn->avail.done_id ) == 0))
+      return 0;
+
    /* Must meet Lua condition. */
    if ((misn->avail.cond != NULL) &&
          !cond_check(misn->avail.cond))
       return 0;
 
-   /* Must meet previous mission requirements. */
-   if ((misn->avail.done != NULL) &&
-         (player_missionAlreadyDone( mission_getID(misn->avail.done) ) == 0))
-      return 0;
-
   return 1;
 }
 
@@ -437,11 +530,25 @@ int mission_unlinkCargo( Mission* misn, unsigned int cargo_id )
 void missions_update( const double dt )
 {
    int i,j;
+   double elapsed;
 
    /* Don't update if player is dead. */
    if ((player==NULL) || player_isFlag(PLAYER_DESTROYED))
       return;
 
+   /* Nothing armed. */
+   if (mission_timerNext < 0.)
+      return;
+
+   /* Accrue time and bail until the soonest deadline could have passed. */
+   mission_timerElapsed += dt;
+   if (mission_timerElapsed < mission_timerNext)
+      return;
+
+   /* Sweep, charging the accrued time to every armed timer. */
+   elapsed = mission_timerElapsed;
+   mission_timerElapsed = 0.;
+   mission_timerNext    = -1.;
    for (i=0; i<MISSION_MAX; i++) {
 
       /* Mission must be active. */
@@ -451,15 +558,19 @@ void missions_update( const double dt )
             /* Timer must be active. */
             if (player_missions[i].timer[j] > 0.) {
 
-               player_missions[i].timer[j] -= dt;
+               player_missions[i].timer[j] -= elapsed;
 
                /* Timer is up - trigger function. */
-               if (player_missions[i].timer[j] < 0.) {
+               if (player_missions[i].timer[j] <= 0.) {
                   misn_run( &player_missions[i], player_missions[i].tfunc[j] );
                   player_missions[i].timer[j] = 0.;
                   free(player_missions[i].tfunc[j]);
                   player_missions[i].tfunc[j] = NULL;
                }
+               /* Still running, candidate for the next deadline. */
+               else if ((mission_timerNext < 0.) ||
+                     (player_missions[i].timer[j] < mission_timerNext))
+                  mission_timerNext = player_missions[i].timer[j];
             }
          }
       }
@@ -467,6 +578,37 @@ void missions_update( const double dt )
 }
 
 
+/**
+ * @brief Recomputes the soonest mission timer deadline.
+ *
+ * Must be called whenever a timer gets armed or a mission with armed
+ *  timers enters player_missions.
+ */
+void missions_timerRecalc (void)
+{
+   int i,j;
+
+   /* Charge the accrued time first so fresh timers start from now. */
+   if (mission_timerElapsed > 0.) {
+      for (i=0; i<MISSION_MAX; i++)
+         if (player_missions[i].id != 0)
+            for (j=0; j<MISSION_TIMER_MAX; j++)
+               if (player_missions[i].timer[j] > 0.)
+                  player_missions[i].timer[j] -= mission_timerElapsed;
+      mission_timerElapsed = 0.;
+   }
+
+   mission_timerNext = -1.;
+   for (i=0; i<MISSION_MAX; i++)
+      if (player_missions[i].id != 0)
+         for (j=0; j<MISSION_TIMER_MAX; j++)
+            if ((player_missions[i].timer[j] > 0.) &&
+                  ((mission_timerNext < 0.) ||
+                   (player_missions[i].timer[j] < mission_timerNext)))
+               mission_timerNext = player_missions[i].timer[j];
+}
+
+
 /**
  * @brief Cleans up a mission.
  *
@@ -492,9 +634,7 @@ void mission_cleanup( Mission* misn )
    if (misn->npc != NULL)
       free(misn->npc);
 
-   /* Markers. */
-   if (misn->sys_marker != NULL)
-      free(misn->sys_marker);
+   /* Markers are interned, not owned. */
 
    /* Cargo. */
    if (misn->cargo != NULL) {
@@ -512,7 +652,10 @@ void mission_cleanup( Mission* misn )
    if (misn->osd > 0)
       osd_destroy(misn->osd);
    if (misn->L)
-      lua_close(misn->L);
+      mission_stateRecycle(misn->L);
+
+   /* Mission state changed, conditions may evaluate differently. */
+   cond_invalidate();
 
    /* Clear the memory. */
    memset( misn, 0, sizeof(Mission) );
@@ -787,7 +930,7 @@ int missions_load (void)
    char *buf = ndata_read( MISSION_DATA, &bufsize );
 
    xmlNodePtr node;
-   xmlDocPtr doc = xmlParseMemory( buf, bufsize );
+   xmlDocPtr doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (!xml_isNode(node,XML_MISSION_ID)) {
@@ -820,6 +963,16 @@ int missions_load (void)
    /* Shrink to minimum. */
    mission_stack = realloc(mission_stack, sizeof(MissionData)*mission_nstack);
 
+   /* Resolve the "done" mission names now the stack is complete. */
+   for (m=0; m<mission_nstack; m++) {
+      mission_stack[m].avail.done_id = (mission_stack[m].avail.done != NULL) ?
+            mission_getID( mission_stack[m].avail.done ) : -1;
+
+      /* Compile the condition so evaluation never has to parse. */
+      if (mission_stack[m].avail.cond != NULL)
+         cond_compile( mission_stack[m].avail.cond );
+   }
+
    /* Clean up. */
    xmlFreeDoc(doc);
    free(buf);
@@ -840,6 +993,11 @@ void missions_free (void)
    /* Free all the player missions. */
    missions_cleanup();
 
+   /* Drain the recycled state pool. */
+   for (i=0; i<mission_nstatePool; i++)
+      nlua_freeState( mission_statePool[i] );
+   mission_nstatePool = 0;
+
    /* Free the mission data. */
    for (i=0; i<mission_nstack; i++)
       mission_freeData( &mission_stack[i] );
@@ -1322,7 +1480,7 @@ static int missions_parseActive( xmlNodePtr parent )
                misn->sys_markerType = (buf != NULL) ? atoi(buf) : 0;
                if (buf != NULL)
                   free(buf);
-               misn->sys_marker = xml_getStrd(cur);
+               misn->sys_marker = (char*) str_intern( xml_get(cur) );
             }
 
             /* Cargo. */
@@ -1393,6 +1551,9 @@ static int missions_parseActive( xmlNodePtr parent )
       }
    } while (xml_nextNode(node));
 
+   /* Loaded missions may carry armed timers. */
+   missions_timerRecalc();
+
    return 0;
 }
 
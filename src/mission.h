@@ -59,6 +59,7 @@ typedef struct MissionAvail_s {
 
    char* cond; /**< Condition that must be met (Lua). */
    char* done; /**< Previous mission that must have been done. */
+   int done_id; /**< Cached id of the done mission, -1 if none. */
 
    int priority; /**< Mission priority: 0 = main plot, 5 = default, 10 = insignificant. */
 } MissionAvail_t;
@@ -134,6 +135,7 @@ int mission_start( const char *name );
  * misc
  */
 void missions_update( const double dt );
+void missions_timerRecalc (void);
 int mission_getID( const char* name );
 MissionData* mission_get( int id );
 void mission_sysMark (void);
@@ -74,6 +74,21 @@ static unsigned int music_start = 0; /**< Music start playing time. */
 static double music_timer     = 0.; /**< Music timer. */
 
 
+#define MUSIC_CACHE_SIZE   4 /**< Tracks to keep in memory for fast switching. */
+
+/**
+ * @brief In-memory copy of a track file, avoids hitting the ndata on switch.
+ */
+typedef struct MusicCache_ {
+   char *name; /**< Track name, NULL if the slot is empty. */
+   char *data; /**< Raw file contents. */
+   uint32_t size; /**< Size of data in bytes. */
+   unsigned int used; /**< Stamp of last use, for LRU eviction. */
+} MusicCache;
+static MusicCache music_cache[ MUSIC_CACHE_SIZE ]; /**< Recently used tracks. */
+static unsigned int music_cache_stamp = 0; /**< Running use counter. */
+
+
 /*
  * Function pointers for backend.
  */
@@ -100,6 +115,8 @@ int  (*music_sys_isPlaying) (void) = NULL;
 /* music stuff */
 static int music_find (void);
 static void music_free (void);
+static MusicCache* music_cacheGet( const char *name );
+static void music_cacheExit (void);
 /* lua stuff */
 static int music_luaInit (void);
 static void music_luaQuit (void);
@@ -270,6 +287,9 @@ void music_exit (void)
    /* Exit the subsystem. */
    music_sys_exit();
 
+   /* Free the cached tracks, after the backend is done streaming. */
+   music_cacheExit();
+
    /* Destroy the lock. */
    if (music_lock != NULL) {
       SDL_DestroyMutex(music_lock);
@@ -382,6 +402,107 @@ double music_getVolume (void)
 }
 
 
+/**
+ * @brief Gets a track from the cache, reading it from the ndata if needed.
+ *
+ * Evicts the least recently used slot when full, but never the track
+ *  currently playing since the backend streams straight from the buffer.
+ *
+ *    @param name Name of the track to get.
+ *    @return The cache entry or NULL if the track could not be read.
+ */
+static MusicCache* music_cacheGet( const char *name )
+{
+   int i;
+   MusicCache *slot;
+   char filename[PATH_MAX];
+   uint32_t size;
+   char *data;
+
+   /* See if it's already cached. */
+   for (i=0; i<MUSIC_CACHE_SIZE; i++) {
+      if ((music_cache[i].name != NULL) &&
+            (strcmp(music_cache[i].name, name)==0)) {
+         music_cache[i].used = ++music_cache_stamp;
+         return &music_cache[i];
+      }
+   }
+
+   /* Read the file from the ndata. */
+   snprintf( filename, PATH_MAX, MUSIC_PREFIX"%s"MUSIC_SUFFIX, name );
+   data = ndata_read( filename, &size );
+   if (data == NULL)
+      return NULL;
+
+   /* Pick a victim slot - empty or least recently used and not playing. */
+   slot = NULL;
+   for (i=0; i<MUSIC_CACHE_SIZE; i++) {
+      if (music_cache[i].name == NULL) {
+         slot = &music_cache[i];
+         break;
+      }
+      if ((music_name != NULL) &&
+            (strcmp(music_cache[i].name, music_name)==0))
+         continue;
+      if ((slot == NULL) || (music_cache[i].used < slot->used))
+         slot = &music_cache[i];
+   }
+   if (slot == NULL) { /* everything is in use, shouldn't happen */
+      free(data);
+      return NULL;
+   }
+
+   /* Fill the slot in. */
+   if (slot->name != NULL) {
+      free(slot->name);
+      free(slot->data);
+   }
+   slot->name = strdup(name);
+   slot->data = data;
+   slot->size = size;
+   slot->used = ++music_cache_stamp;
+   return slot;
+}
+
+
+/**
+ * @brief Frees all the cached tracks.
+ */
+static void music_cacheExit (void)
+{
+   int i;
+
+   for (i=0; i<MUSIC_CACHE_SIZE; i++) {
+      if (music_cache[i].name != NULL) {
+         free(music_cache[i].name);
+         free(music_cache[i].data);
+         music_cache[i].name = NULL;
+         music_cache[i].data = NULL;
+      }
+   }
+}
+
+
+/**
+ * @brief Preloads a track into the cache without playing it.
+ *
+ * Meant for warming up the likely next track, e.g. the combat theme
+ *  when hostiles enter the system.
+ *
+ *    @param name Name of the track to preload.
+ *    @return 0 on success.
+ */
+int music_prefetch( const char* name )
+{
+   if (music_disabled)
+      return 0;
+
+   if (music_cacheGet( name ) == NULL)
+      return -1;
+   return 0;
+}
+
+
 /**
  * @brief Loads the music by name.
  *
@@ -390,7 +511,7 @@ double music_getVolume (void)
 int music_load( const char* name )
 {
    SDL_RWops *rw;
-   char filename[PATH_MAX];
+   MusicCache *cache;
 
    if (music_disabled)
       return 0;
@@ -401,10 +522,14 @@ int music_load( const char* name )
    /* Load new music. */
    music_name  = strdup(name);
    music_start = SDL_GetTicks();
-   snprintf( filename, PATH_MAX, MUSIC_PREFIX"%s"MUSIC_SUFFIX, name); 
-   rw = ndata_rwops( filename );
+   cache = music_cacheGet( name );
+   if (cache == NULL) {
+      WARN("Music '%s' not found.", name);
+      return -1;
+   }
+   rw = SDL_RWFromConstMem( cache->data, cache->size );
    if (rw == NULL) {
-      WARN("Music '%s' not found.", filename);
+      WARN("Unable to create rwops for music '%s'.", name);
       return -1;
    }
    music_sys_load( name, rw );
@@ -563,7 +688,7 @@ static void music_luaQuit (void)
    if (music_lua == NULL)
       return;
 
-   lua_close(music_lua);
+   nlua_freeState(music_lua);
    music_lua = NULL;
 }
 
@@ -23,6 +23,7 @@
 #include "log.h"
 #include "pack.h"
 #include "conf.h"
+#include "nthread.h"
 
 
 /**
@@ -87,9 +88,20 @@ extern SDL_mutex *sound_lock; /**< Global sound lock, used for all OpenAL calls.
 static SDL_mutex *music_vorbis_lock = NULL; /**< Lock for vorbisfile operations. */
 static SDL_cond  *music_state_cond  = NULL; /**< Cond for thread to signal status updates. */
 static SDL_mutex *music_state_lock  = NULL; /**< Lock for music state. */
-static music_cmd_t   music_command  = MUSIC_CMD_NONE; /**< Target music state. */
 static music_state_t music_state    = MUSIC_STATE_DEAD; /**< Current music state. */
 static int music_forced             = 0; /**< Whether or not music is force stopped. */
+static int music_die                = 0; /**< Music thread should die, under music_state_lock. */
+
+
+/*
+ * Command ring between the game thread and the music thread.
+ *
+ * Single producer (game thread) and single consumer (music thread), so
+ * it runs on the shared lock free SPSC ring.
+ */
+#define MUSIC_CMD_RING  8 /**< Size of the command ring. */
+static NRing *music_cmd_ring = NULL; /**< Queued commands. */
+static int music_pending_play       = 0; /**< Play queued but not yet handled, under music_state_lock. */
 
 
 /*
@@ -128,6 +140,35 @@ static void rg_filter( float **pcm, long channels, long samples, void *filter_pa
 static void music_kill (void);
 static int music_thread( void* unused );
 static int stream_loadBuffer( ALuint buffer );
+static void music_cmd_push( music_cmd_t cmd );
+static music_cmd_t music_cmd_pop (void);
+
+
+/**
+ * @brief Queues a command for the music thread, does not block.
+ *
+ *    @param cmd Command to queue.
+ */
+static void music_cmd_push( music_cmd_t cmd )
+{
+   if (nring_push( music_cmd_ring, (int)cmd ) != 0)
+      WARN("Music command ring full, dropping command.");
+}
+
+
+/**
+ * @brief Grabs the next queued command, for the music thread only.
+ *
+ *    @return Next command or MUSIC_CMD_NONE if the ring is empty.
+ */
+static music_cmd_t music_cmd_pop (void)
+{
+   int cmd;
+
+   if (nring_pop( music_cmd_ring, &cmd ) != 0)
+      return MUSIC_CMD_NONE;
+   return (music_cmd_t)cmd;
+}
 
 
 /**
@@ -145,24 +186,31 @@ static int music_thread( void* unused )
    ALuint removed[2];
    ALenum value;
    music_state_t cur_state;
+   music_cmd_t cmd;
    ALfloat gain;
    int fadein_start = 0;
    uint32_t fade, fade_timer = 0;
 
    while (1) {
 
+      /* Grab the next queued command, doesn't need the lock. */
+      cmd = music_cmd_pop();
+
       /* Handle states. */
       musicLock();
 
+      /* Dying overrides whatever is queued. */
+      if (music_die)
+         cmd = MUSIC_CMD_KILL;
+
       /* Handle new command. */
-      switch (music_command) {
+      switch (cmd) {
          case MUSIC_CMD_KILL:
             if (music_state != MUSIC_STATE_IDLE)
                music_state = MUSIC_STATE_STOPPING;
             else {
                music_state = MUSIC_STATE_DEAD;
             }
-            /* Does not clear command. */
             break;
 
          case MUSIC_CMD_STOP:
@@ -183,8 +231,7 @@ static int music_thread( void* unused )
                music_state = MUSIC_STATE_LOADING;
             /* Disable fadein. */
             fadein_start = 0;
-            /* Clear command. */
-            music_command = MUSIC_CMD_NONE;
+            music_pending_play = 0;
             SDL_CondBroadcast( music_state_cond );
             break;
 
@@ -195,8 +242,6 @@ static int music_thread( void* unused )
                /* Set timer. */
                fade_timer = SDL_GetTicks();
             }
-            /* Clear command. */
-            music_command = MUSIC_CMD_NONE;
             SDL_CondBroadcast( music_state_cond );
             break;
 
@@ -210,8 +255,7 @@ static int music_thread( void* unused )
                fade_timer = SDL_GetTicks();
                fadein_start = 1;
             }
-            /* Clear command. */
-            music_command = MUSIC_CMD_NONE;
+            music_pending_play = 0;
             break;
 
          case MUSIC_CMD_PAUSE:
@@ -220,7 +264,6 @@ static int music_thread( void* unused )
             else if ((music_state == MUSIC_STATE_PLAYING) ||
                   (music_state == MUSIC_STATE_FADEIN))
                music_state = MUSIC_STATE_PAUSING;
-            music_command = MUSIC_CMD_NONE;
             break;
 
          case MUSIC_CMD_NONE:
@@ -622,6 +665,7 @@ int music_al_init (void)
    music_state_cond  = SDL_CreateCond();
    music_state_lock  = SDL_CreateMutex();
    music_vorbis_lock = SDL_CreateMutex();
+   music_cmd_ring    = nring_create( MUSIC_CMD_RING );
    music_vorbis.rw   = NULL; /* indication it's not loaded */
 
    /* Create the buffer. */
@@ -690,6 +734,8 @@ void music_al_exit (void)
    SDL_DestroyMutex( music_vorbis_lock );
    SDL_DestroyMutex( music_state_lock );
    SDL_DestroyCond( music_state_cond );
+   nring_destroy( music_cmd_ring );
+   music_cmd_ring = NULL;
 }
 
 
@@ -753,14 +799,17 @@ int music_al_load( const char* name, SDL_RWops *rw )
  */
 void music_al_free (void)
 {
-   /* Stop music if needed. */
+   /* Stop music if needed, this is the only place that must wait for
+    * the thread since the vorbis stream is about to go away. */
    musicLock();
-   if (music_state != MUSIC_STATE_IDLE) {
-      music_command = MUSIC_CMD_STOP;
+   if ((music_state != MUSIC_STATE_IDLE) || music_pending_play ||
+         !nring_empty( music_cmd_ring )) {
       music_forced  = 1;
+      music_cmd_push( MUSIC_CMD_STOP );
       while (1) {
          SDL_CondWait( music_state_cond, music_state_lock );
-         if (music_state == MUSIC_STATE_IDLE) {
+         if ((music_state == MUSIC_STATE_IDLE) &&
+               nring_empty( music_cmd_ring )) {
             music_forced = 0;
             break;
          }
@@ -813,76 +862,48 @@ double music_al_getVolume (void)
 
 
 /**
- * @brief Tells the music thread to play.
+ * @brief Tells the music thread to play, does not wait for it.
  */
 void music_al_play (void)
 {
+   /* Mark as pending before queueing so isPlaying can't miss it. */
    musicLock();
-
-   music_command = MUSIC_CMD_FADEIN;
-   while (1) {
-      SDL_CondWait( music_state_cond, music_state_lock );
-      if (music_isPlaying())
-         break;
-   }
-
+   music_pending_play = 1;
    musicUnlock();
+
+   music_cmd_push( MUSIC_CMD_FADEIN );
 }
 
 
 /**
- * @brief Tells the music thread to stop playing.
+ * @brief Tells the music thread to stop playing, does not wait for it.
  */
 void music_al_stop (void)
 {
-   musicLock();
-
-   music_command = MUSIC_CMD_FADEOUT;
-   while (1) {
-      SDL_CondWait( music_state_cond, music_state_lock );
-      if ((music_state == MUSIC_STATE_IDLE) ||
-            (music_state == MUSIC_STATE_FADEOUT))
-         break;
-   }
-
-   musicUnlock();
+   music_cmd_push( MUSIC_CMD_FADEOUT );
 }
 
 
 /**
- * @brief Tells the music thread to pause.
+ * @brief Tells the music thread to pause, does not wait for it.
  */
 void music_al_pause (void)
 {
-   musicLock();
-
-   music_command = MUSIC_CMD_PAUSE;
-   while (1) {
-      SDL_CondWait( music_state_cond, music_state_lock );
-      if ((music_state == MUSIC_STATE_IDLE) ||
-            (music_state == MUSIC_STATE_PAUSED))
-         break;
-   }
-
-   musicUnlock();
+   music_cmd_push( MUSIC_CMD_PAUSE );
 }
 
 
 /**
- * @brief Tells the music thread to resume.
+ * @brief Tells the music thread to resume, does not wait for it.
  */
 void music_al_resume (void)
 {
+   /* Mark as pending before queueing so isPlaying can't miss it. */
    musicLock();
-
-   music_command = MUSIC_CMD_PLAY;
-   while (1) {
-      SDL_CondWait( music_state_cond, music_state_lock );
-      if (music_isPlaying())
-         break;
-   }
-
+   music_pending_play = 1;
    musicUnlock();
+
+   music_cmd_push( MUSIC_CMD_PLAY );
 }
 
 
@@ -916,7 +937,8 @@ int music_al_isPlaying (void)
 
    musicLock();
 
-   if ((music_state == MUSIC_STATE_PLAYING) ||
+   if (music_pending_play ||
+         (music_state == MUSIC_STATE_PLAYING) ||
          (music_state == MUSIC_STATE_LOADING) ||
          (music_state == MUSIC_STATE_RESUMING) ||
          (music_state == MUSIC_STATE_FADEIN) ||
@@ -939,7 +961,8 @@ static void music_kill (void)
 {
    musicLock();
 
-   music_command = MUSIC_CMD_KILL;
+   /* A flag rather than a command so it persists while stopping. */
+   music_die     = 1;
    music_forced  = 1;
 
    musicUnlock();
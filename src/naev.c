@@ -18,12 +18,21 @@
  */
 /* localised global */
 #include "SDL.h"
+#include "SDL_thread.h"
 
 #include "naev.h"
 #include "log.h" /* for DEBUGGING */
 
 /* global */
 #include <string.h> /* strdup */
+#include <math.h> /* fabs */
+#if HAS_POSIX
+#include <sys/time.h> /* gettimeofday */
+#endif /* HAS_POSIX */
+#if HAS_WIN32
+#include <sys/types.h>
+#include <sys/timeb.h>
+#endif /* HAS_WIN32 */
 #if !(HAS_WIN32) && defined(DEBUGGING)
 #include <fenv.h>
 #endif /* !(HAS_WIN32) && defined(DEBUGGING) */
@@ -61,6 +70,7 @@
 #include "economy.h"
 #include "menu.h"
 #include "mission.h"
+#include "nlua.h"
 #include "nlua_misn.h"
 #include "nfile.h"
 #include "nebula.h"
@@ -71,8 +81,20 @@
 #include "nlua_var.h"
 #include "map.h"
 #include "event.h"
+#include "hook.h"
+#include "njob.h"
+#include "nthread.h"
 #include "cond.h"
 #include "land.h"
+#include "comm.h"
+#include "save.h"
+#include "perf.h"
+#include "loadtime.h"
+#include "intern.h"
+#include "nalloc.h"
+#include "plasmaf.h"
+#include "replay.h"
+#include "nmem.h"
 
 
 #define CONF_FILE       "conf.lua" /**< Configuration file by default. */
@@ -84,7 +106,7 @@
 
 
 static int quit = 0; /**< For primary loop */
-static unsigned int time = 0; /**< used to calculate FPS and movement. */
+static unsigned int time = 0; /**< used to time the loading screen delay. */
 static char short_version[64]; /**< Contains version. */
 static char human_version[256]; /**< Human readable version. */
 static glTexture *loading; /**< Loading screen. */
@@ -96,6 +118,22 @@ static double fps_dt  = 1.; /**< Display fps accumulator. */
 static double game_dt = 0.; /**< Current game deltatick (uses dt_mod). */
 static double real_dt = 0.; /**< Real deltatick. */
 
+
+/*
+ * Update thread.
+ *
+ * The simulation of the next frame runs on a worker thread so that it
+ *  overlaps with the buffer swap, where the driver blocks on vsync and
+ *  command flushing.  Mission and event Lua stays on the main thread
+ *  since it can re-enter the main loop through the toolkit (dialogues).
+ */
+static SDL_Thread *update_th  = NULL; /**< The update thread itself. */
+static SDL_sem *update_go     = NULL; /**< Signals the thread to simulate. */
+static SDL_sem *update_done   = NULL; /**< Signals the frame is simulated. */
+static int update_quit        = 0; /**< Tells the update thread to exit. */
+static int update_pending     = 0; /**< Whether an update is in flight. */
+static double update_script_dt = 0.; /**< Deltatick for mission/event Lua. */
+
 #if HAS_LINUX && defined(DEBUGGING)
 static bfd *abfd = NULL;
 static asymbol **syms = NULL;
@@ -108,16 +146,22 @@ static asymbol **syms = NULL;
 static void print_SDLversion (void);
 static void loadscreen_load (void);
 static void loadscreen_unload (void);
+static int load_thread( void *unused );
 static void load_all (void);
 static void unload_all (void);
 static void display_fps( const double dt );
 static void window_caption (void);
 static void debug_sigInit (const char *executable);
 /* update */
+static long fps_getTime (void);
 static void fps_control (void);
 static void update_all (void);
-static void update_routine( double dt );
+void update_routine( double dt ); /* Non-static, the Lua stress ramp drives it. */
+static void update_scripts( double dt );
+static int update_thread( void *unused );
 static void render_all (void);
+/* Benchmark. */
+static void benchmark_run (void);
 /* Misc. */
 void loadscreen_render( double done, const char *msg ); /* nebula.c */
 void main_loop (void); /* dialogue.c */
@@ -170,6 +214,10 @@ int main( int argc, char** argv )
    conf_loadConfig(buf); /* Lua to parse the configuration file */
    conf_parseCLI( argc, argv ); /* parse CLI arguments */
 
+   /* Benchmarks run silent. */
+   if (conf.benchmark != NULL)
+      conf.nosound = 1;
+
    /* Enable FPU exceptions. */
 #if !(HAS_WIN32) && defined(DEBUGGING)
    if (conf.fpu_except)
@@ -182,6 +230,13 @@ int main( int argc, char** argv )
 
    /* Load the data basics. */
    LOG(" %s", ndata_name());
+   if (conf.verify) {
+      int nbad = ndata_verify();
+      if (nbad > 0)
+         WARN("ndata verification found %d corrupt files!", nbad);
+      else if (nbad == 0)
+         LOG("ndata verified, all files OK");
+   }
    DEBUG();
 
    /* Display the SDL Version. */
@@ -190,6 +245,7 @@ int main( int argc, char** argv )
 
    /* random numbers */
    rng_init();
+   replay_init(); /* may reseed the RNG for deterministic record/playback */
 
 
    /*
@@ -230,6 +286,11 @@ int main( int argc, char** argv )
    }
 
 
+   /* Shared concurrency primitives, then the worker pool - the loaders
+    * and the threaded subsystems below use both. */
+   nthread_init();
+   njob_init();
+
    /*
     * OpenAL - Sound
     */
@@ -259,6 +320,10 @@ int main( int argc, char** argv )
    /* Data loading */
    load_all();
 
+   /* Benchmark mode simulates and exits without entering the game. */
+   if (conf.benchmark != NULL)
+      benchmark_run(); /* Does not return. */
+
    /* Unload load screen. */
    loadscreen_unload();
 
@@ -269,6 +334,14 @@ int main( int argc, char** argv )
    if ((SDL_GetTicks() - time) < NAEV_INIT_DELAY)
       SDL_Delay( NAEV_INIT_DELAY - (SDL_GetTicks() - time) );
    time = SDL_GetTicks(); /* initializes the time */
+   /* Start the update thread. */
+   update_go   = SDL_CreateSemaphore(0);
+   update_done = SDL_CreateSemaphore(0);
+   if ((update_go != NULL) && (update_done != NULL))
+      update_th = SDL_CreateThread( update_thread, NULL );
+   if (update_th == NULL)
+      WARN("Unable to create update thread, simulating serially.");
+
    /* 
     * main loop
     */
@@ -282,23 +355,42 @@ int main( int argc, char** argv )
          if (event.type == SDL_QUIT)
             quit = 1; /* quit is handled here */
 
-         input_handle(&event); /* handles all the events and player keybinds */
+         /* Real input is ignored in playback, the log injects its own. */
+         if (replay_mode() != REPLAY_PLAYBACK)
+            input_handle(&event); /* handles all the events and player keybinds */
       }
+      input_update(); /* flushes coalesced joystick motion */
 
       main_loop();
    }
 
 
+   /* Stop the update thread. */
+   if (update_th != NULL) {
+      update_quit = 1;
+      SDL_SemPost( update_go );
+      SDL_WaitThread( update_th, NULL );
+      update_th = NULL;
+   }
+   if (update_go != NULL)
+      SDL_DestroySemaphore( update_go );
+   if (update_done != NULL)
+      SDL_DestroySemaphore( update_done );
+   njob_exit();
+
    /* Save configuration. */
    conf_saveConfig(buf);
 
    /* cleanup some stuff */
+   save_exit(); /* waits for any pending savegame write */
    player_cleanup(); /* cleans up the player stuff */
    gui_free(); /* cleans up the player's GUI */
    weapon_exit(); /* destroys all active weapons */
    pilots_free(); /* frees the pilots, they were locked up :( */
    cond_exit(); /* destroy conditional subsystem. */
+   nlua_cacheExit(); /* frees the Lua bytecode cache. */
    land_exit(); /* Destroys landing vbo and friends. */
+   comm_exit(); /* Frees the cached comm graphic. */
 
    /* data unloading */
    unload_all();
@@ -322,7 +414,11 @@ int main( int argc, char** argv )
    nebu_exit(); /* destroys the nebula */
    gl_exit(); /* kills video output */
    sound_exit(); /* kills the sound */
+   perf_exit(); /* closes any pending profile dump */
+   replay_exit(); /* closes any pending replay log */
+   nmem_exit(); /* dumps the memory accounting */
    news_exit(); /* destroys the news. */
+   nthread_exit(); /* all the threads are joined by now */
    SDL_Quit(); /* quits SDL */
 
 
@@ -379,6 +475,9 @@ void loadscreen_render( double done, const char *msg )
    double bx,by, bw,bh;
    double x,y, w,h, rh;
 
+   /* The messages double as stage boundaries for the timing report. */
+   loadtime_stage( msg );
+
    /* Clear background. */
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -446,33 +545,74 @@ static void loadscreen_unload (void)
 }
 
 
+static SDL_sem *load_factions = NULL; /**< Posted once factions are loaded. */
+/**
+ * @brief Loads the stages that don't touch OpenGL on a worker thread.
+ *
+ *    @param unused Unused.
+ *    @return 0 on exit.
+ */
+static int load_thread( void *unused )
+{
+   (void) unused;
+
+   commodity_load(); /* dep for space */
+   events_load(); /* no dep */
+   SDL_SemWait( load_factions ); /* missions look factions up */
+   missions_load(); /* dep on factions */
+   return 0;
+}
 /**
  * @brief Loads all the data, makes main() simpler.
  */
-#define LOADING_STAGES     10. /**< Amount of loading stages. */
+#define LOADING_STAGES     8. /**< Amount of loading stages. */
 void load_all (void)
 {
+   SDL_Thread *th;
+
+   /* Parsing on two threads needs the parser initialized up front. */
+   xmlInitParser();
+
+   /* Commodities, events and missions don't touch OpenGL, so they load
+    * on a worker while the texture-heavy stages use the context. */
+   th = NULL;
+   load_factions = SDL_CreateSemaphore(0);
+   if (load_factions != NULL)
+      th = SDL_CreateThread( load_thread, NULL );
+
    /* order is very important as they're interdependent */
-   loadscreen_render( 1./LOADING_STAGES, "Loading Commodities..." );
-   commodity_load(); /* dep for space */
-   loadscreen_render( 2./LOADING_STAGES, "Loading Factions..." );
+   loadscreen_render( 1./LOADING_STAGES, "Loading Factions..." );
    factions_load(); /* dep for fleet, space, missions */
-   loadscreen_render( 3./LOADING_STAGES, "Loading Missions..." );
-   missions_load(); /* no dep */
-   loadscreen_render( 4./LOADING_STAGES, "Loading Events..." );
-   events_load(); /* no dep */
-   loadscreen_render( 5./LOADING_STAGES, "Loading Special Effects..." );
+   if (th != NULL)
+      SDL_SemPost( load_factions ); /* unblocks missions on the worker */
+   loadscreen_render( 2./LOADING_STAGES, "Loading Special Effects..." );
    spfx_load(); /* no dep */
-   loadscreen_render( 6./LOADING_STAGES, "Loading Outfits..." );
+   loadscreen_render( 3./LOADING_STAGES, "Loading Outfits..." );
    outfit_load(); /* dep for ships */
-   loadscreen_render( 7./LOADING_STAGES, "Loading Ships..." );
+   loadscreen_render( 4./LOADING_STAGES, "Loading Ships..." );
    ships_load(); /* dep for fleet */
-   loadscreen_render( 8./LOADING_STAGES, "Loading Fleets..." );
+
+   loadscreen_render( 5./LOADING_STAGES, "Loading Missions..." );
+   if (th != NULL)
+      SDL_WaitThread( th, NULL );
+   else { /* No worker, load serially. */
+      commodity_load(); /* dep for space */
+      events_load(); /* no dep */
+      missions_load(); /* dep on factions */
+   }
+   if (load_factions != NULL) {
+      SDL_DestroySemaphore( load_factions );
+      load_factions = NULL;
+   }
+
+   loadscreen_render( 6./LOADING_STAGES, "Loading Fleets..." );
    fleet_load(); /* dep for space */
-   loadscreen_render( 9./LOADING_STAGES, "Loading the Universe..." );
+   loadscreen_render( 7./LOADING_STAGES, "Loading the Universe..." );
    space_load();
+   diff_loadAvailable(); /* pre-parse the universe diffs */
    loadscreen_render( 1., "Loading Completed!" );
    xmlCleanupParser(); /* Only needed to be run after all the loading is done. */
+   loadtime_report();
 }
 /**
  * @brief Unloads all data, simplifies main().
@@ -481,6 +621,7 @@ void unload_all (void)
 {
    /* data unloading - inverse load_all is a good order */
    economy_destroy(); /* must be called before space_exit */
+   diff_exit(); /* frees the pre-parsed diffs */
    space_exit(); /* cleans up the universe itself */
    fleet_free();
    ships_free();
@@ -490,6 +631,9 @@ void unload_all (void)
    factions_free();
    commodity_free();
    var_cleanup(); /* cleans up mission variables */
+   pf_exit(); /* frees the cached plasma fractals */
+   nalloc_exit(); /* frees the frame arena */
+   intern_exit(); /* frees the name intern pool, must go last */
 }
 
 /**
@@ -507,44 +651,154 @@ void main_loop (void)
 
    fps_control(); /* everyone loves fps control */
 
+   PERF_BEGIN(PERF_SOUND);
    sound_update( real_dt ); /* Update sounds. */
+   PERF_END(PERF_SOUND);
    if (tk) toolkit_update(); /* to simulate key repetition */
    if (!menu_isOpen(MENU_MAIN)) {
+      render_all(); /* renders the state the last frame simulated */
       if (!paused)
-         update_all(); /* update game */
-      render_all();
+         update_pending = 1; /* simulate the next frame below */
    }
    /* Toolkit is rendered on top. */
    if (tk) toolkit_render();
 
    gl_checkErr(); /* check error every loop */
 
+   /* Kick the update thread now that all the rendering is submitted, so
+    * simulating frame N+1 overlaps with the swap of frame N. */
+   if (update_pending) {
+      if (update_th != NULL) {
+         hooks_defer(1);
+         SDL_SemPost( update_go );
+      }
+      else /* No thread, simulate in place. */
+         update_all();
+   }
+
    /* Draw buffer. */
    SDL_GL_SwapBuffers();
+
+   /* Join the frame and run the Lua that had to wait for the main thread. */
+   if (update_pending) {
+      update_pending = 0;
+      if (update_th != NULL) {
+         SDL_SemWait( update_done );
+         hooks_defer(0);
+         hooks_runDeferred();
+      }
+      if (update_script_dt > 0.)
+         update_scripts( update_script_dt );
+   }
+
+   /* Both threads are done with the frame, its transients can go. */
+   nalloc_frameReset();
+
+   perf_frame(); /* Update thread is idle again, safe to close the frame. */
+}
+
+
+/**
+ * @brief Body of the update thread.
+ *
+ *    @param unused Unused.
+ *    @return 0 on exit.
+ */
+static int update_thread( void *unused )
+{
+   (void) unused;
+
+   while (1) {
+      SDL_SemWait( update_go );
+      if (update_quit)
+         break;
+      update_all();
+      SDL_SemPost( update_done );
+   }
+
+   return 0;
+}
+
+
+#define FPS_EMA_ALPHA   0.2   /**< Smoothing of the dt fed to the simulation. */
+#define FPS_EMA_SNAP    0.01  /**< Hitches over this (s) pass through raw. */
+#define FPS_SPIN_US     2000L /**< Sleep coarsely until this close to the deadline. */
+
+
+/**
+ * @brief Gets the current time in microseconds.
+ *
+ * Same trick as the profiler clock - only differences matter so the
+ *  epoch is irrelevant.  SDL_GetTicks() is far too coarse to pace
+ *  frames with.
+ *
+ *    @return Current time in us.
+ */
+static long fps_getTime (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (long)tv.tv_sec * 1000000L + (long)tv.tv_usec;
+#elif HAS_WIN32
+   struct _timeb tb;
+   _ftime( &tb );
+   return (long)tb.time * 1000000L + (long)tb.millitm * 1000L;
+#else
+#error "Feature needs implementation on this Operating System for NAEV to work."
+#endif
 }
 
 
 /**
  * @brief Controls the FPS.
+ *
+ * SDL_Delay() alone has ~10ms granularity which shows up as visible
+ *  jitter at 60Hz caps, so the pacer sleeps coarsely to within
+ *  FPS_SPIN_US of the deadline and burns the rest on the us clock.
  */
 static void fps_control (void)
 {
-   unsigned int t;
+   long t, deadline, remain;
    double delay;
+   static long fps_last   = 0;
+   static double fps_ema  = 0.;
 
    /* dt in s */
-   t = SDL_GetTicks();
-   real_dt  = (double)(t - time); /* Get the elapsed ms. */
-   real_dt /= 1000.; /* Convert to seconds. */
-   game_dt  = real_dt * dt_mod; /* Apply the modifier. */
-   time = t;
+   t = fps_getTime();
+   if (fps_last == 0)
+      fps_last = t; /* first frame has no history */
+   real_dt  = (double)(t - fps_last) / 1000000.;
+   fps_last = t;
+   replay_update( &real_dt ); /* Records or substitutes the frame dt. */
+   perf_spike( real_dt ); /* Dumps the flight recorder on a hitch. */
+
+   /* Smooth the simulated dt so pacing jitter doesn't wobble the fixed
+    *  step accumulator.  Hitches pass through raw - smoothing those
+    *  would slow the game down instead. */
+   if ((fps_ema <= 0.) || (fabs(real_dt - fps_ema) > FPS_EMA_SNAP))
+      fps_ema = real_dt;
+   else
+      fps_ema += FPS_EMA_ALPHA * (real_dt - fps_ema);
+   game_dt = fps_ema * dt_mod; /* Apply the modifier. */
 
-   /* if fps is limited */                       
+   /* if fps is limited */
    if ((conf.fps_max != 0) && (real_dt < 1./conf.fps_max)) {
       delay = 1./conf.fps_max - real_dt;
-      SDL_Delay( (unsigned int)(delay * 1000) );
-      fps_dt += delay; /* makes sure it displays the proper fps */
+      /* Spend part of the idle wait collecting Lua garbage. */
+      delay -= nlua_gcRun( delay );
+      if (delay > 0.) {
+         deadline = fps_getTime() + (long)(delay * 1000000.);
+         /* Coarse sleep to within a couple ms of the deadline... */
+         while ((remain = deadline - fps_getTime()) > FPS_SPIN_US)
+            SDL_Delay( (unsigned int)((remain - FPS_SPIN_US) / 1000L) );
+         /* ...then spin out the remainder on the us clock. */
+         while (fps_getTime() < deadline);
+         fps_dt += delay; /* makes sure it displays the proper fps */
+      }
    }
+   else
+      nlua_gcRun( 0. ); /* no slack, only memory pressure forces steps */
 }
 
 
@@ -555,32 +809,25 @@ static void fps_control (void)
  */
 static void update_all (void)
 {
-   double tempdt;
-   static const double fps_min = 1./50.; /**< Minimum fps to run at. */
+   static const double sim_step = 1./60.; /**< Fixed simulation timestep. */
+   static double sim_accum = 0.; /**< Frame time not yet simulated. */
 
-   if (real_dt > 0.25) { /* slow timers down and rerun calculations */
-      pause_delay((unsigned int)game_dt*1000);
+   if (real_dt > 0.25) { /* skip the frame and rerun calculations */
+      update_script_dt = 0.;
       return;
    }
-   else if (game_dt > fps_min) { /* we'll force a minimum of 50 FPS */
-
-      /* First iteration. */
-      tempdt = game_dt - fps_min;
-      pause_delay( (unsigned int)(tempdt*1000));
-      update_routine(fps_min);
-
-      /* run as many cycles of dt=fps_min as needed */
-      while (tempdt > fps_min) {
-         pause_delay((unsigned int)(-fps_min*1000)); /* increment counters */
-         update_routine(fps_min);
-         tempdt -= fps_min;
-      }
 
-      update_routine(tempdt); /* leftovers */
-      /* Note we don't touch game_dt so that fps_display works well */
+   update_script_dt = game_dt; /* scripts run once on the whole frame */
+
+   /* Simulate in fixed steps so simulation cost tracks game speed, not
+    * the display refresh rate; the render interpolates positions over
+    * the leftover fraction of a step. */
+   sim_accum += game_dt;
+   while (sim_accum >= sim_step) {
+      update_routine(sim_step);
+      sim_accum -= sim_step;
    }
-   else /* Standard, just update with the last dt */
-      update_routine(game_dt);
+   sim_interp = sim_accum / sim_step;
 }
 
 
@@ -589,17 +836,122 @@ static void update_all (void)
  *
  *    @param[in] dt Current delta tick.
  */
-static void update_routine( double dt )
+void update_routine( double dt )
 {
+   PERF_BEGIN(PERF_UPDATE);
+   sim_time += dt; /* advance the pausable simulation clock */
    space_update(dt);
+   PERF_BEGIN(PERF_WEAPONS);
    weapons_update(dt);
-   spfx_update(dt);
+   PERF_END(PERF_WEAPONS);
+   PERF_BEGIN(PERF_PILOTS);
    pilots_update(dt);
+   PERF_END(PERF_PILOTS);
+   PERF_END(PERF_UPDATE);
+}
+
+
+/**
+ * @brief Runs the mission and event updates.
+ *
+ * Split from update_routine() since this executes Lua that may open
+ *  dialogues and thus must run on the main thread, once per frame.
+ *
+ *    @param[in] dt Current delta tick.
+ */
+static void update_scripts( double dt )
+{
    missions_update(dt);
    events_update(dt);
 }
 
 
+/**
+ * @brief Runs the benchmark scenario and exits.
+ *
+ * Scenario format is "Fleet[*count][,Fleet...][@system]" - each fleet is
+ *  spawned count times scattered around the origin and the simulation runs
+ *  for conf.bench_ticks fixed steps as fast as possible, then ticks per
+ *  second and the per-subsystem times are printed.
+ *
+ * The window is still created since ship graphics live in OpenGL textures,
+ *  but nothing is ever rendered and sound is forced off.
+ */
+static void benchmark_run (void)
+{
+   static const double sim_step = 1./60.; /**< Matches update_all(). */
+   int i, n, count;
+   unsigned int t;
+   char *scen, *tok, *sep, *mult;
+   const char *sysname;
+   Fleet *fleet;
+   FleetPilot *plt;
+   Vector2d vp, vv;
+   double ticks_sec;
+
+   scen = strdup( conf.benchmark );
+
+   /* Optional "@system" suffix, defaults to the first system. */
+   sep = strchr( scen, '@' );
+   if (sep != NULL) {
+      *sep = '\0';
+      sysname = sep+1;
+   }
+   else
+      sysname = system_getIndex(0)->name;
+   space_init( sysname ); /* ERRs out if the system doesn't exist. */
+
+   /* Spawn the fleets. */
+   n = 0;
+   tok = strtok( scen, "," );
+   while (tok != NULL) {
+      /* Optional "*count" suffix. */
+      count = 1;
+      mult = strchr( tok, '*' );
+      if (mult != NULL) {
+         *mult = '\0';
+         count = atoi(mult+1);
+      }
+      fleet = fleet_get( tok );
+      if (fleet == NULL)
+         ERR("Benchmark fleet '%s' not found", tok);
+      while (count-- > 0) {
+         for (i=0; i<fleet->npilots; i++) {
+            plt = &fleet->pilots[i];
+            vect_pset( &vp, RNGF()*2000., RNGF()*2.*M_PI );
+            vectnull( &vv );
+            pilot_create( plt->ship, plt->name, fleet->faction,
+                  (plt->ai != NULL) ? plt->ai : fleet->ai,
+                  RNGF()*2.*M_PI, &vp, &vv, 0 );
+            n++;
+         }
+      }
+      tok = strtok( NULL, "," );
+   }
+   LOG("Benchmark: %d pilots in %s, %d ticks of %.4f s",
+         n, sysname, conf.bench_ticks, sim_step );
+   free(scen);
+
+   /* Run the simulation as fast as possible with the zones counting. */
+   perf_toggle(); /* Off -> overlay, starts the zone accounting. */
+   t = SDL_GetTicks();
+   for (i=0; i<conf.bench_ticks; i++)
+      update_routine( sim_step );
+   t = SDL_GetTicks() - t;
+
+   /* Report. */
+   ticks_sec = (t > 0) ? 1000. * (double)conf.bench_ticks / (double)t : 0.;
+   LOG("Benchmark: %d ticks in %.3f s, %.1f ticks/s (%.1fx realtime)",
+         conf.bench_ticks, (double)t/1000., ticks_sec, ticks_sec*sim_step );
+   LOG("   update:  %.3f s", (double)perf_current(PERF_UPDATE)/1e6 );
+   LOG("   weapons: %.3f s", (double)perf_current(PERF_WEAPONS)/1e6 );
+   LOG("   pilots:  %.3f s", (double)perf_current(PERF_PILOTS)/1e6 );
+   LOG("   ai:      %.3f s", (double)perf_current(PERF_AI)/1e6 );
+
+   exit(EXIT_SUCCESS);
+}
+
+
 /**
  * @brief Renders the game itself (player flying around and friends).
  *
@@ -624,7 +976,10 @@ static void render_all (void)
 
    dt = (paused) ? 0. : game_dt;
 
+   PERF_BEGIN(PERF_RENDER);
    /* setup */
+   gl_cameraFrame(); /* caches the camera transform for the renderers */
+   gl_renderScaleBegin(); /* world renders at a fraction of the resolution */
    spfx_begin(dt);
    /* BG */
    space_render(dt);
@@ -639,7 +994,9 @@ static void render_all (void)
    spfx_render(SPFX_LAYER_FRONT);
    space_renderOverlay(dt);
    spfx_end();
+   gl_renderScaleEnd(); /* upscale the world, GUI stays native */
    gui_render(dt);
+   PERF_END(PERF_RENDER); /* Don't count the displays below. */
    display_fps( real_dt ); /* Exception. */
 }
 
@@ -668,8 +1025,11 @@ static void display_fps( const double dt )
       gl_print( NULL, x, y, NULL, "%3.2f", fps );
       y -= gl_defFont.h + 5.;
    }
-   if (dt_mod != 1.)
+   if (dt_mod != 1.) {
       gl_print( NULL, x, y, NULL, "%3.1fx", dt_mod);
+      y -= gl_defFont.h + 5.;
+   }
+   perf_render( x, y );
 }
 
 
@@ -0,0 +1,163 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file nalloc.c
+ *
+ * @brief Frame-scoped bump arena for transient allocations.
+ *
+ * A lot of code allocates buffers that only live for the frame that
+ *  created them: name lists handed to Lua, outfit strings for the
+ *  toolkit, temporary vectors in the AI. Routing those through
+ *  nalloc_frame() replaces a malloc/free pair per call with a pointer
+ *  bump, and main_loop() releases everything with one reset when both
+ *  the render and the update thread are done with the frame.
+ *
+ * Frame pointers must therefore never be stored across frames and never
+ *  be freed - anything that outlives the frame keeps using malloc().
+ *
+ * The bump is guarded by a mutex since both the main thread (toolkit,
+ *  rendering) and the update thread (AI Lua) allocate; the lock is
+ *  uncontended in practice and far cheaper than the allocator it
+ *  replaces.
+ */
+
+#include "nalloc.h"
+
+#include "naev.h"
+
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "log.h"
+#include "nmem.h"
+
+
+#define NALLOC_BLOCK_SIZE  (64*1024) /**< Size of a standard arena block. */
+
+
+/**
+ * @struct NallocBlock
+ *
+ * @brief A single arena block, bump-allocated front to back.
+ */
+typedef struct NallocBlock_ {
+   struct NallocBlock_ *next; /**< Next block in the chain. */
+   size_t size;               /**< Usable bytes in data. */
+   size_t used;               /**< Bytes already handed out. */
+   double data[1];            /**< Start of the block, double for alignment. */
+} NallocBlock;
+
+
+static NallocBlock *nalloc_blocks = NULL; /**< Block chain, first is current. */
+static SDL_mutex *nalloc_lock     = NULL; /**< Guards the bump pointer. */
+
+
+/*
+ * Prototypes.
+ */
+static NallocBlock* nalloc_blockNew( size_t size );
+
+
+/**
+ * @brief Allocates a new arena block.
+ *
+ *    @param size Usable size the block must provide.
+ *    @return The new block.
+ */
+static NallocBlock* nalloc_blockNew( size_t size )
+{
+   NallocBlock *b;
+
+   b = malloc( sizeof(NallocBlock) - sizeof(double) + size );
+   b->next = NULL;
+   b->size = size;
+   b->used = 0;
+   nmem_count( MEM_FRAME, (long)size, +1 );
+   return b;
+}
+
+
+/**
+ * @brief Allocates transient memory that lives until the end of the frame.
+ *
+ * The returned block is aligned for any type. It must not be freed and
+ *  must not be referenced after main_loop() resets the arena.
+ *
+ *    @param size Bytes to allocate.
+ *    @return The allocated block.
+ */
+void* nalloc_frame( size_t size )
+{
+   NallocBlock *b;
+   void *ptr;
+
+   /* Keep every bump aligned. */
+   size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+
+   if (nalloc_lock == NULL) /* First use, main thread only. */
+      nalloc_lock = SDL_CreateMutex();
+   SDL_mutexP( nalloc_lock );
+
+   b = nalloc_blocks;
+   if ((b == NULL) || (b->used + size > b->size)) {
+      /* Oversized requests get a block of their own, the rest chain
+       * standard blocks. */
+      b = nalloc_blockNew( MAX( size, (size_t)NALLOC_BLOCK_SIZE ) );
+      b->next = nalloc_blocks;
+      nalloc_blocks = b;
+   }
+   ptr = (char*)b->data + b->used;
+   b->used += size;
+
+   SDL_mutexV( nalloc_lock );
+   return ptr;
+}
+
+
+/**
+ * @brief Releases all the frame allocations at once.
+ *
+ * Called by main_loop() when the render and the update thread have both
+ *  finished the frame. The first standard block is kept so the steady
+ *  state never touches the heap.
+ */
+void nalloc_frameReset (void)
+{
+   NallocBlock *b, *next;
+
+   if (nalloc_blocks == NULL)
+      return;
+
+   /* Free all but the head, which is rewound and reused. */
+   b = nalloc_blocks->next;
+   while (b != NULL) {
+      next = b->next;
+      nmem_count( MEM_FRAME, -(long)b->size, -1 );
+      free(b);
+      b = next;
+   }
+   nalloc_blocks->next = NULL;
+   nalloc_blocks->used = 0;
+}
+
+
+/**
+ * @brief Frees the arena itself, run on exit.
+ */
+void nalloc_exit (void)
+{
+   nalloc_frameReset();
+   if (nalloc_blocks != NULL) {
+      nmem_count( MEM_FRAME, -(long)nalloc_blocks->size, -1 );
+      free(nalloc_blocks);
+      nalloc_blocks = NULL;
+   }
+   if (nalloc_lock != NULL) {
+      SDL_DestroyMutex( nalloc_lock );
+      nalloc_lock = NULL;
+   }
+}
@@ -0,0 +1,24 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef NALLOC_H
+#  define NALLOC_H
+
+
+#include <stdlib.h>
+
+
+/*
+ * Frame-scoped allocations, released all at once by the reset.
+ */
+void* nalloc_frame( size_t size );
+void nalloc_frameReset (void);
+
+/* Clean up. */
+void nalloc_exit (void);
+
+
+#endif /* NALLOC_H */
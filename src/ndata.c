@@ -28,6 +28,7 @@
 #include "pack.h"
 #include "nfile.h"
 #include "conf.h"
+#include "loadtime.h"
 
 
 #define NDATA_FILENAME  "ndata" /**< Generic ndata file name. */
@@ -53,6 +54,21 @@ static SDL_mutex *ndata_lock        = NULL; /**< Lock for ndata creation. */
 static const char **ndata_fileList  = NULL; /**< List of files in the packfile. */
 static uint32_t ndata_fileNList     = 0; /**< Number of files in ndata_fileList. */
 
+/**
+ * @brief A cached directory listing for local-directory mode.
+ *
+ * The packfile answers prefix queries with index slices; without a
+ *  packfile the listings get built once per path and kept here so the
+ *  borrowed-slice contract holds either way.
+ */
+typedef struct NdataDir_s {
+   struct NdataDir_s *next; /**< Next cached listing. */
+   char *path; /**< Path the listing is of. */
+   char **files; /**< Full paths of the files. */
+   uint32_t nfiles; /**< Number of files. */
+} NdataDir_t;
+static NdataDir_t *ndata_dirCache   = NULL; /**< Cached local listings. */
+
 
 /*
  * Prototypes.
@@ -75,6 +91,23 @@ int ndata_check( const char* path )
 }
 
 
+/**
+ * @brief Verifies the whole ndata archive against its stored digests.
+ *
+ * Must be called after ndata_open().
+ *
+ *    @return Number of corrupt files found, 0 when clean, -1 on error.
+ */
+int ndata_verify (void)
+{
+   if (ndata_cache == NULL) {
+      WARN("Cannot verify ndata: no packfile loaded.");
+      return -1;
+   }
+   return pack_verifyCache( ndata_cache );
+}
+
+
 /**
  * @brief Sets the current ndata path to use.
  *
@@ -226,6 +259,18 @@ void ndata_close (void)
       ndata_fileNList = 0;
    }
 
+   /* Destroy the cached local listings. */
+   while (ndata_dirCache != NULL) {
+      NdataDir_t *dl = ndata_dirCache;
+      uint32_t i;
+      ndata_dirCache = dl->next;
+      for (i=0; i<dl->nfiles; i++)
+         free(dl->files[i]);
+      free(dl->files);
+      free(dl->path);
+      free(dl);
+   }
+
    /* Close the packfile. */
    if (ndata_cache) {
       pack_closeCache(ndata_cache);
@@ -262,7 +307,7 @@ const char* ndata_name (void)
       WARN("Unable to open '%s'.", START_DATA);
       return NULL;
    }
-   doc = xmlParseMemory( buf, size );
+   doc = xml_parseMemory( buf, size );
 
    /* Make sure it's what we are looking for. */
    node = doc->xmlChildrenNode;
@@ -303,6 +348,9 @@ void* ndata_read( const char* filename, uint32_t *filesize )
 {
    char *buf;
    int nbuf;
+   long t;
+
+   t = loadtime_now();
 
    /* See if needs to load packfile. */
    if (ndata_cache == NULL) {
@@ -312,6 +360,7 @@ void* ndata_read( const char* filename, uint32_t *filesize )
          buf = nfile_readFile( &nbuf, filename );
          if (buf != NULL) {
             *filesize = nbuf;
+            loadtime_account( LOADTIME_IO, loadtime_now()-t );
             return buf;
          }
       }
@@ -321,7 +370,9 @@ void* ndata_read( const char* filename, uint32_t *filesize )
    }
 
    /* Get data from packfile. */
-   return pack_readfileCached( ndata_cache, filename, filesize );
+   buf = pack_readfileCached( ndata_cache, filename, filesize );
+   loadtime_account( LOADTIME_IO, loadtime_now()-t );
+   return buf;
 }
 
 
@@ -430,3 +481,61 @@ char** ndata_list( const char* path, uint32_t* nfiles )
    return filterList( ndata_fileList, ndata_fileNList, path, nfiles );
 }
 
+
+/**
+ * @brief Gets the files under a path prefix without allocating.
+ *
+ * Unlike ndata_list() the returned entries keep the full path and the
+ *  list is borrowed - do not free it or its entries.  Backed by a
+ *  sorted-index slice when a packfile is open, see
+ *  pack_listfilesPrefix().
+ *
+ *    @param path Path prefix to list, e.g. "ai/".
+ *    @param nfiles Number of files found.
+ *    @return Borrowed list of full paths.
+ */
+const char** ndata_listPrefix( const char* path, uint32_t* nfiles )
+{
+   NdataDir_t *dl;
+   char **files;
+   size_t len;
+   int n;
+   uint32_t i;
+
+   if (ndata_cache == NULL) {
+      /* Served a listing of this directory before. */
+      for (dl=ndata_dirCache; dl!=NULL; dl=dl->next) {
+         if (strcmp(dl->path, path)==0) {
+            *nfiles = dl->nfiles;
+            return (const char**) dl->files;
+         }
+      }
+
+      /* See if can load from local directory. */
+      files = nfile_readDir( &n, path );
+      if (files != NULL) {
+         dl          = malloc( sizeof(NdataDir_t) );
+         dl->path    = strdup(path);
+         dl->nfiles  = n;
+         dl->files   = malloc( sizeof(char*) * n );
+         len         = strlen(path);
+         for (i=0; i<(uint32_t)n; i++) {
+            dl->files[i] = malloc( len + strlen(files[i]) + 1 );
+            strcpy( dl->files[i], path );
+            strcat( dl->files[i], files[i] );
+            free(files[i]);
+         }
+         free(files);
+         dl->next       = ndata_dirCache;
+         ndata_dirCache = dl;
+         *nfiles = dl->nfiles;
+         return (const char**) dl->files;
+      }
+
+      /* Open packfile. */
+      ndata_openPackfile();
+   }
+
+   return pack_listfilesPrefix( ndata_cache, path, nfiles );
+}
+
@@ -22,6 +22,7 @@ void ndata_close (void);
  * General.
  */
 int ndata_check( const char* path );
+int ndata_verify (void);
 int ndata_setPath( const char* path );
 const char* ndata_name (void);
 
@@ -30,6 +31,7 @@ const char* ndata_name (void);
  */
 void* ndata_read( const char* filename, uint32_t *filesize );
 char** ndata_list( const char *path, uint32_t* nfiles );
+const char** ndata_listPrefix( const char *path, uint32_t* nfiles ); /* borrowed, do not free */
 
 
 /*
@@ -13,8 +13,9 @@
 #include "naev.h"
 
 #include <errno.h>
-
-#include "SDL_image.h"
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
 
 #include "log.h"
 #include "opengl.h"
@@ -30,8 +31,13 @@
 
 #define NEBULA_Z             16 /**< Z plane */
 #define NEBULA_PUFFS         32 /**< Amount of puffs to generate */
+#define NEBU_LAYER_W         512 /**< Internal layer width, must be a power of two. */
+#define NEBU_LAYER_H         512 /**< Internal layer height, must be a power of two. */
 #define NEBULA_DIR           "gen/" /**< Directory containing the nebula stuff. */
-#define NEBULA_PATH_BG       NEBULA_DIR"nebu_bg_%dx%d_%02d.png" /**< Nebula path format. */
+#define NEBULA_PATH_BG       NEBULA_DIR"nebu_bg_%dx%d.nebu" /**< Nebula cache path format. */
+
+#define NEBULA_CACHE_MAGIC   0x4e454255 /**< Nebula cache magic number: "NEBU". */
+#define NEBULA_CACHE_VERSION 1 /**< Bump to invalidate old caches on format change. */
 
 #define NEBULA_PUFF_BUFFER   300 /**< Nebula buffer */
 
@@ -45,8 +51,6 @@ extern void loadscreen_render( double done, const char *msg ); /**< from naev.c
 static GLuint nebu_textures[NEBULA_Z]; /**< BG Nebula textures. */
 static int nebu_w    = 0; /**< BG Nebula width. */
 static int nebu_h    = 0; /**< BG Nebula height. */
-static int nebu_pw   = 0; /**< BG Padded Nebula width. */
-static int nebu_ph   = 0; /**< BG Padded Nebula height. */
 
 /* Information on rendering */
 static int cur_nebu[2]           = { 0, 1 }; /**< Nebulas currently rendering. */
@@ -77,16 +81,20 @@ typedef struct NebulaPuff_ {
 static NebulaPuff *nebu_puffs   = NULL; /**< Stack of puffs. */
 static int nebu_npuffs           = 0; /**< Number of puffs. */
 
+/* Puff batching, one streamed VBO instead of a blit per puff. */
+static gl_vbo *nebu_vboPuffs    = NULL; /**< Streamed puff quads. */
+static GLfloat *nebu_puffData   = NULL; /**< Staging buffer for the quads. */
+static GLuint *nebu_puffTexID   = NULL; /**< Texture of each staged quad. */
+static int nebu_puffSize        = 0; /**< Quads the staging buffer fits. */
+
 
 /*
  * prototypes
  */
-static int nebu_checkCompat( const char* file );
-static void nebu_loadTexture( SDL_Surface *sur, int w, int h, GLuint tex );
+static void nebu_loadTexture( uint8_t *data, int w, int h, GLuint tex );
+static int nebu_loadCache (void);
 static int nebu_generate (void);
 static void nebu_generatePuffs (void);
-static int saveNebula( float *map, const uint32_t w, const uint32_t h, const char* file );
-static SDL_Surface* loadNebula( const char* file );
 static SDL_Surface* nebu_surfaceFromNebulaMap( float* map, const int w, const int h );
 static void nebu_genOverlay (void);
 /* Nebula render methods. */
@@ -100,54 +108,36 @@ static void nebu_renderMultitexture( const double dt );
  */
 int nebu_init (void)
 {
-   int i;
-   char nebu_file[PATH_MAX];
-   SDL_Surface* nebu_sur;
    int ret;
    GLfloat vertex[4*3*2];
-   GLfloat tw, th;
 
    /* Special code to regenerate the nebula */
    if ((nebu_w == -9) && (nebu_h == -9)) {
       nebu_generate();
    }
 
-   /* Set expected sizes */
-   nebu_w = SCREEN_W;
-   nebu_h = SCREEN_H;
-   nebu_pw = gl_pot(nebu_w);
-   nebu_ph = gl_pot(nebu_h);
+   /* Layers are generated and stored at a fixed internal resolution and
+    * stretched to the screen; they're smooth noise, so the linear
+    * upscale is invisible and one cache serves any resolution. */
+   nebu_w = NEBU_LAYER_W;
+   nebu_h = NEBU_LAYER_H;
 
    nebu_generatePuffs();
 
-   /* Load each, checking for compatibility and padding */
+   /* Load from the cache, generating it if it's missing or stale. */
    glGenTextures( NEBULA_Z, nebu_textures );
-   for (i=0; i<NEBULA_Z; i++) {
-      snprintf( nebu_file, PATH_MAX, NEBULA_PATH_BG, nebu_w, nebu_h, i );
-
-      if (nebu_checkCompat( nebu_file )) { /* Incompatible */
-         LOG("No nebula found, generating (this may take a while).");
+   if (nebu_loadCache() != 0) {
+      LOG("No nebula found, generating (this may take a while).");
 
-         /* So we generate and reload */
-         ret = nebu_generate();
-         if (ret != 0) /* An error has happened - break recursivity*/
-            return ret;
+      ret = nebu_generate();
+      if (ret != 0) /* An error has happened */
+         return ret;
 
-         return nebu_init();
-      }
-
-      /* Load the file */
-      nebu_sur = loadNebula( nebu_file );
-      if ((nebu_sur->w != nebu_w) || (nebu_sur->h != nebu_h))
-         WARN("Nebula raw size doesn't match expected! (%dx%d instead of %dx%d)",
-               nebu_sur->w, nebu_sur->h, nebu_pw, nebu_ph );
-
-      /* Load the texture */
-      nebu_loadTexture( nebu_sur, nebu_pw, nebu_ph, nebu_textures[i] );
+      ret = nebu_loadCache();
+      if (ret != 0) /* Generated cache doesn't load, don't loop. */
+         return ret;
    }
 
-   DEBUG("Loaded %d Nebula Layers", NEBULA_Z);
-
 
    /* Create the VBO. */
    /* Vertex. */
@@ -160,25 +150,23 @@ int nebu_init (void)
    vertex[6] =  vertex[2];
    vertex[7] =  vertex[5];
    /* Texture 0. */
-   tw = (double)nebu_w / (double)nebu_pw;
-   th = (double)nebu_h / (double)nebu_ph;
    vertex[8]  = 0.;
    vertex[9]  = 0.;
-   vertex[10] = tw;
+   vertex[10] = 1.;
    vertex[11] = 0.;
    vertex[12] = 0.;
-   vertex[13] = th;
-   vertex[14] = tw;
-   vertex[15] = th;
+   vertex[13] = 1.;
+   vertex[14] = 1.;
+   vertex[15] = 1.;
    /* Texture 1. */
    vertex[16] = 0.;
    vertex[17] = 0.;
-   vertex[18] = tw;
+   vertex[18] = 1.;
    vertex[19] = 0.;
    vertex[20] = 0.;
-   vertex[21] = th;
-   vertex[22] = tw;
-   vertex[23] = th;
+   vertex[21] = 1.;
+   vertex[22] = 1.;
+   vertex[23] = 1.;
    nebu_vboBG = gl_vboCreateStatic( sizeof(GLfloat) * (4*2*3), vertex );
 
    return 0;
@@ -197,38 +185,81 @@ double nebu_getSightRadius (void)
 
 
 /**
- * @brief Loads sur into tex, checks for expected size of w and h.
+ * @brief Loads a raw alpha layer into tex.
  *
- *    @param sur Surface to load into texture.
- *    @param w Expected width of surface.
- *    @param h Expected height of surface.
+ *    @param data Alpha values to load into the texture.
+ *    @param w Width of the layer.
+ *    @param h Height of the layer.
  *    @param tex Already generated texture to load into.
  */
-static void nebu_loadTexture( SDL_Surface *sur, int w, int h, GLuint tex )
+static void nebu_loadTexture( uint8_t *data, int w, int h, GLuint tex )
 {
-   SDL_Surface *nebu_sur;
+   glBindTexture( GL_TEXTURE_2D, tex );
+   /* Linear filtering, the layers are upscaled to the screen. */
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+
+   /* Only the alpha channel ever reaches video memory. */
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_ALPHA, w, h,
+         0, GL_ALPHA, GL_UNSIGNED_BYTE, data );
+   gl_checkErr();
+}
 
-   nebu_sur = gl_prepareSurface( sur );
-   if ((w!=0) && (h!=0) &&
-         ((nebu_sur->w != w) || (nebu_sur->h != h))) {
-      WARN("Nebula size doesn't match expected! (%dx%d instead of %dx%d)",
-            nebu_sur->w, nebu_sur->h, nebu_pw, nebu_ph );
-      return;
+
+/**
+ * @brief Loads the nebula layers from the compressed cache.
+ *
+ * Layers stream to the GPU one at a time as they decompress instead of
+ *  building full RGBA surfaces for the whole stack first.
+ *
+ *    @return 0 on success, non-zero if the cache is missing or stale.
+ */
+static int nebu_loadCache (void)
+{
+   int i;
+   char file_path[PATH_MAX];
+   uint32_t hdr[5];
+   uint8_t *raw;
+   gzFile f;
+
+   snprintf( file_path, PATH_MAX, "%s"NEBULA_PATH_BG,
+         nfile_basePath(), nebu_w, nebu_h );
+   f = nfile_gzOpen( "rb", "%s", file_path );
+   if (f == NULL)
+      return -1;
+
+   /* Validate the header. */
+   if ((gzread( f, hdr, sizeof(hdr) ) != sizeof(hdr)) ||
+         (hdr[0] != NEBULA_CACHE_MAGIC) ||
+         (hdr[1] != NEBULA_CACHE_VERSION) ||
+         (hdr[2] != (uint32_t)nebu_w) ||
+         (hdr[3] != (uint32_t)nebu_h) ||
+         (hdr[4] != NEBULA_Z)) {
+      WARN("Nebula cache '%s' is stale, regenerating.", file_path);
+      gzclose(f);
+      return -1;
    }
 
-   /* Load the texture */
-   glBindTexture( GL_TEXTURE_2D, tex );
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   /* Decompress and upload layer by layer; the internal size is a
+    * power of two so no padding is needed. */
+   raw = malloc( nebu_w * nebu_h );
+   for (i=0; i<NEBULA_Z; i++) {
+      if (gzread( f, raw, nebu_w*nebu_h ) != nebu_w*nebu_h) {
+         WARN("Nebula cache '%s' is truncated, regenerating.", file_path);
+         free(raw);
+         gzclose(f);
+         return -1;
+      }
 
-   /* Store into opengl saving only alpha channel in video memory */
-   SDL_LockSurface( nebu_sur );
-   glTexImage2D( GL_TEXTURE_2D, 0, GL_ALPHA, nebu_sur->w, nebu_sur->h,
-         0, GL_RGBA, GL_UNSIGNED_BYTE, nebu_sur->pixels );
-   SDL_UnlockSurface( nebu_sur );
+      nebu_loadTexture( raw, nebu_w, nebu_h, nebu_textures[i] );
+   }
+   free(raw);
+   gzclose(f);
 
-   SDL_FreeSurface(nebu_sur);
-   gl_checkErr();
+   DEBUG("Loaded %d Nebula Layers", NEBULA_Z);
+   return 0;
 }
 
 
@@ -255,6 +286,17 @@ void nebu_exit (void)
       gl_vboDestroy( nebu_vboOverlay );
       nebu_vboOverlay= NULL;
    }
+   if (nebu_vboPuffs != NULL) {
+      gl_vboDestroy( nebu_vboPuffs );
+      nebu_vboPuffs = NULL;
+   }
+   if (nebu_puffData != NULL) {
+      free( nebu_puffData );
+      nebu_puffData = NULL;
+      free( nebu_puffTexID );
+      nebu_puffTexID = NULL;
+      nebu_puffSize = 0;
+   }
 }
 
 
@@ -575,43 +617,136 @@ void nebu_renderOverlay( const double dt )
 /**
  * @brief Renders the puffs.
  *
+ * The quads of a layer are staged into one streamed VBO and flushed
+ *  with a draw call per run of puffs sharing a texture - a single call
+ *  per layer since the puff textures share the atlas.  The positions
+ *  are still advanced on the CPU: the drift integrates the player's
+ *  velocity and wraps per puff, so it is not a pure function of time.
+ *
  *    @param dt Current delta tick.
  *    @param below_player Render the puffs below player or above player?
  */
 void nebu_renderPuffs( const double dt, int below_player )
 {
-   int i;
+   int i, n, first;
+   double x,y, sw,sh, u0,v0, u1,v1;
+   glTexture *t;
+   NebulaPuff *p;
+   GLfloat *pos, *uv;
 
    /* Main menu shouldn't have puffs */
    if (menu_isOpen(MENU_MAIN)) return;
 
+   if (nebu_npuffs == 0)
+      return;
+
+   /* Grow the staging buffer and the VBO to fit every puff. */
+   if (nebu_puffSize < nebu_npuffs) {
+      nebu_puffSize  = nebu_npuffs;
+      nebu_puffData  = realloc( nebu_puffData,
+            sizeof(GLfloat) * (12+12)*nebu_puffSize );
+      nebu_puffTexID = realloc( nebu_puffTexID,
+            sizeof(GLuint) * nebu_puffSize );
+      if (nebu_vboPuffs != NULL)
+         gl_vboDestroy( nebu_vboPuffs );
+      nebu_vboPuffs = gl_vboCreateStream(
+            sizeof(GLfloat) * (12+12)*nebu_puffSize, NULL );
+   }
+   pos = nebu_puffData;
+   uv  = &nebu_puffData[ 12*nebu_puffSize ];
+
+   /* Advance and stage the layer's puffs. */
+   n = 0;
    for (i=0; i<nebu_npuffs; i++) {
+      p = &nebu_puffs[i];
 
       /* Seperate by layers */
-      if ((below_player && (nebu_puffs[i].height < 1.)) ||
-            (!below_player && (nebu_puffs[i].height > 1.))) {
+      if ((below_player && (p->height < 1.)) ||
+            (!below_player && (p->height > 1.))) {
 
          /* calculate new position */
          if (!paused && (player!=NULL)) {
-            nebu_puffs[i].x -= player->solid->vel.x * nebu_puffs[i].height * dt;
-            nebu_puffs[i].y -= player->solid->vel.y * nebu_puffs[i].height * dt;
+            p->x -= player->solid->vel.x * p->height * dt;
+            p->y -= player->solid->vel.y * p->height * dt;
          }
 
          /* Check boundries */
-         if (nebu_puffs[i].x > SCREEN_W + NEBULA_PUFF_BUFFER)
-            nebu_puffs[i].x -= SCREEN_W + 2*NEBULA_PUFF_BUFFER;
-         else if (nebu_puffs[i].y > SCREEN_H + NEBULA_PUFF_BUFFER)
-            nebu_puffs[i].y -= SCREEN_H + 2*NEBULA_PUFF_BUFFER;
-         else if (nebu_puffs[i].x < -NEBULA_PUFF_BUFFER)
-            nebu_puffs[i].x += SCREEN_W + 2*NEBULA_PUFF_BUFFER;
-         else if (nebu_puffs[i].y < -NEBULA_PUFF_BUFFER)
-            nebu_puffs[i].y += SCREEN_H + 2*NEBULA_PUFF_BUFFER;
-
-         /* Render */
-         gl_blitStatic( nebu_pufftexs[nebu_puffs[i].tex],
-               nebu_puffs[i].x, nebu_puffs[i].y, &cLightBlue );
+         if (p->x > SCREEN_W + NEBULA_PUFF_BUFFER)
+            p->x -= SCREEN_W + 2*NEBULA_PUFF_BUFFER;
+         else if (p->y > SCREEN_H + NEBULA_PUFF_BUFFER)
+            p->y -= SCREEN_H + 2*NEBULA_PUFF_BUFFER;
+         else if (p->x < -NEBULA_PUFF_BUFFER)
+            p->x += SCREEN_W + 2*NEBULA_PUFF_BUFFER;
+         else if (p->y < -NEBULA_PUFF_BUFFER)
+            p->y += SCREEN_H + 2*NEBULA_PUFF_BUFFER;
+
+         /* Stage the quad as two triangles. */
+         t  = nebu_pufftexs[p->tex];
+         x  = p->x - (double)SCREEN_W/2.;
+         y  = p->y - (double)SCREEN_H/2.;
+         sw = t->sw;
+         sh = t->sh;
+         pos[12*n+0]  = x;
+         pos[12*n+1]  = y;
+         pos[12*n+2]  = x + sw;
+         pos[12*n+3]  = y;
+         pos[12*n+4]  = x + sw;
+         pos[12*n+5]  = y + sh;
+         pos[12*n+6]  = x;
+         pos[12*n+7]  = y;
+         pos[12*n+8]  = x + sw;
+         pos[12*n+9]  = y + sh;
+         pos[12*n+10] = x;
+         pos[12*n+11] = y + sh;
+         u0 = t->tox;
+         v0 = t->toy;
+         u1 = t->tox + t->srw;
+         v1 = t->toy + t->srh;
+         uv[12*n+0]  = u0;
+         uv[12*n+1]  = v0;
+         uv[12*n+2]  = u1;
+         uv[12*n+3]  = v0;
+         uv[12*n+4]  = u1;
+         uv[12*n+5]  = v1;
+         uv[12*n+6]  = u0;
+         uv[12*n+7]  = v0;
+         uv[12*n+8]  = u1;
+         uv[12*n+9]  = v1;
+         uv[12*n+10] = u0;
+         uv[12*n+11] = v1;
+         nebu_puffTexID[n] = t->texture;
+         n++;
+      }
+   }
+
+   if (n == 0)
+      return;
+
+   /* Upload the used part of both blocks. */
+   gl_vboOrphan( nebu_vboPuffs );
+   gl_vboSubData( nebu_vboPuffs, 0, sizeof(GLfloat) * 12*n, pos );
+   gl_vboSubData( nebu_vboPuffs, sizeof(GLfloat) * 12*nebu_puffSize,
+         sizeof(GLfloat) * 12*n, uv );
+
+   /* Draw the runs, one call per texture change. */
+   glEnable(GL_TEXTURE_2D);
+   COLOUR(cLightBlue);
+   gl_vboActivateOffset( nebu_vboPuffs, GL_VERTEX_ARRAY, 0,
+         2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( nebu_vboPuffs, GL_TEXTURE_COORD_ARRAY,
+         sizeof(GLfloat) * 12*nebu_puffSize, 2, GL_FLOAT, 0 );
+   first = 0;
+   for (i=1; i<=n; i++) {
+      if ((i == n) || (nebu_puffTexID[i] != nebu_puffTexID[first])) {
+         glBindTexture( GL_TEXTURE_2D, nebu_puffTexID[first] );
+         glDrawArrays( GL_TRIANGLES, 6*first, 6*(i-first) );
+         first = i;
       }
    }
+   gl_vboDeactivate();
+   glDisable(GL_TEXTURE_2D);
+
+   gl_checkErr();
 }
 
 
@@ -665,18 +800,21 @@ void nebu_forceGenerate (void)
  */
 static int nebu_generate (void)
 {
-   int i;
+   int i, j;
    float *nebu;
-   char nebu_file[PATH_MAX];
+   char file_path[PATH_MAX];
+   uint32_t hdr[5];
+   uint8_t *raw;
+   gzFile f;
    int w,h;
    int ret;
 
    /* Warn user of what is happening. */
    loadscreen_render( 0.05, "Generating Nebula (slow, run once)..." );
 
-   /* Get resolution to create at. */
-   w = SCREEN_W;
-   h = SCREEN_H;
+   /* Internal resolution, independent of the screen. */
+   w = NEBU_LAYER_W;
+   h = NEBU_LAYER_H;
 
    /* Try to make the dir first if it fails. */
    nfile_dirMakeExist( "%s"NEBULA_DIR, nfile_basePath() );
@@ -687,13 +825,40 @@ static int nebu_generate (void)
    /* Start saving - compression can take a bit. */
    loadscreen_render( 0.05, "Compressing Nebula layers..." );
 
-   /* Save each nebula as an image */
-   for (i=0; i<NEBULA_Z; i++) {
-      snprintf( nebu_file, PATH_MAX, NEBULA_PATH_BG, w, h, i );
-      ret = saveNebula( &nebu[ i*w*h ], w, h, nebu_file );
-      if (ret != 0) break; /* An error has happenend */
+   /* The internal size is in the name so a size bump regenerates. */
+   snprintf( file_path, PATH_MAX, "%s"NEBULA_PATH_BG,
+         nfile_basePath(), w, h );
+   f = nfile_gzOpen( "wb", "%s", file_path );
+   if (f == NULL) {
+      WARN("Unable to open nebula cache '%s' for writing: %s",
+            file_path, strerror(errno));
+      free(nebu);
+      return -1;
    }
 
+   /* Header. */
+   hdr[0] = NEBULA_CACHE_MAGIC;
+   hdr[1] = NEBULA_CACHE_VERSION;
+   hdr[2] = w;
+   hdr[3] = h;
+   hdr[4] = NEBULA_Z;
+   ret = 0;
+   if (gzwrite( f, hdr, sizeof(hdr) ) != sizeof(hdr))
+      ret = -1;
+
+   /* Only the alpha channel matters, so store one byte per pixel. */
+   raw = malloc( w*h );
+   for (i=0; (ret==0) && (i<NEBULA_Z); i++) {
+      for (j=0; j<w*h; j++)
+         raw[j] = (uint8_t) (255. * nebu[ i*w*h + j ]);
+      if (gzwrite( f, raw, w*h ) != w*h) {
+         WARN("Error writing nebula cache '%s'.", file_path);
+         ret = -1;
+      }
+   }
+   free(raw);
+   gzclose(f);
+
    /* Cleanup */
    free(nebu);
    return ret;
@@ -722,81 +887,12 @@ static void nebu_generatePuffs (void)
       sur = nebu_surfaceFromNebulaMap( nebu, w, h );
       free(nebu);
       
-      /* Load the texture */
-      nebu_pufftexs[i] =  gl_loadImage( sur, 0 );
+      /* Load the texture, atlased so the batched draw binds once. */
+      nebu_pufftexs[i] =  gl_loadImage( sur, OPENGL_TEX_ATLAS );
    }
 }
 
 
-/**
- * @brief Checks the validity of a nebula.
- *
- *    @param file Path of the nebula to check (relative to base directory).
- *    @return 0 on success.
- */
-static int nebu_checkCompat( const char* file )
-{
-   /* first check to see if file exists */
-   if (nfile_fileExists("%s%s", nfile_basePath(), file) == 0)
-      return -1;
-   return 0;
-}
-
-
-/**
- * @brief Saves a nebula.
- *
- *    @param map Nebula map to save.
- *    @param w Width of nebula map.
- *    @param h Height of nebula map.
- *    @param file Path to save into.
- *    @return 0 on success.
- */
-static int saveNebula( float *map, const uint32_t w, const uint32_t h, const char* file )
-{
-   char file_path[PATH_MAX];
-   SDL_Surface* sur;
-   int ret;
-
-   /* fix surface */
-   sur = nebu_surfaceFromNebulaMap( map, w, h );
-
-   /* save */
-   ret = 0;
-   snprintf(file_path, PATH_MAX, "%s%s", nfile_basePath(), file );
-   ret = SDL_SavePNG( sur, file_path );
-
-   /* cleanup */
-   SDL_FreeSurface( sur );
-
-   return ret;
-}
-
-
-/**
- * @brief Loads the nebuale from file.
- *
- *    @param file Path of the nebula to load.  Relative to base directory.
- *    @return A SDL surface with the nebula.
- */
-static SDL_Surface* loadNebula( const char* file )
-{
-   char file_path[PATH_MAX];
-   SDL_Surface* sur;
-
-   /* loads the file */
-   snprintf(file_path, PATH_MAX, "%s%s", nfile_basePath(), file );
-   sur = IMG_Load( file_path );
-   if (sur == NULL) {
-      ERR("Unable to load Nebula image: %s", file);
-      return NULL;
-   }
-   
-   return sur;
-}
-
-
-
 /**
  * @brief Generates a SDL_Surface from a 2d nebula map
  *
@@ -15,6 +15,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "log.h"
 #include "nlua.h"
@@ -41,6 +42,8 @@ static lua_State *news_state  = NULL; /**< Lua news state. */
  */
 static news_t *news_buf       = NULL; /**< Buffer of news. */
 static int news_nbuf          = 0; /**< Size of news buffer. */
+static char *news_genPlanet   = NULL; /**< Planet the buffer was generated for. */
+static unsigned int news_genTime = 0; /**< Game time the buffer was generated at. */
 
 
 /*
@@ -311,6 +314,10 @@ void news_exit (void)
 
    /* Clean the buffers. */
    news_cleanBuffer();
+   if (news_genPlanet != NULL) {
+      free(news_genPlanet);
+      news_genPlanet = NULL;
+   }
 
    /* Clean the lines. */
    news_cleanLines();
@@ -319,11 +326,39 @@ void news_exit (void)
    news_mlines = 0;
 
    /* Clean up. */
-   lua_close(news_state);
+   nlua_freeState(news_state);
    news_state = NULL;
 }
 
 
+/**
+ * @brief Generates news for a planet, reusing the last batch if possible.
+ *
+ * The buffer is keyed on planet and game time, so reopening the news
+ *  within the same visit doesn't rerun the generation Lua.
+ *
+ *    @param planet Name of the planet the news is for.
+ *    @param t Current game time.
+ *    @param n News items to generate on a miss.
+ *    @return The news buffer.
+ */
+const news_t *news_generateCached( const char *planet, unsigned int t, int n )
+{
+   /* Still fresh. */
+   if ((news_buf != NULL) && (news_genPlanet != NULL) &&
+         (strcmp(news_genPlanet, planet)==0) && (news_genTime == t))
+      return news_buf;
+
+   /* Remember the new key. */
+   if (news_genPlanet != NULL)
+      free(news_genPlanet);
+   news_genPlanet = strdup(planet);
+   news_genTime   = t;
+
+   return news_generate( NULL, n );
+}
+
+
 /**
  * @brief Gets a news sentence.
  */
@@ -28,6 +28,7 @@ void news_exit (void);
  * Display.
  */
 const news_t *news_generate( int *ngen, int n );
+const news_t *news_generateCached( const char *planet, unsigned int t, int n );
 void news_widget( unsigned int wid, int x, int y, int w, int h );
 
 
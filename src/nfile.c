@@ -19,7 +19,8 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
-#include <dirent.h> 
+#include <dirent.h>
+#include <zlib.h>
 #if HAS_POSIX
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -39,6 +40,14 @@
 
 
 static char naev_base[PATH_MAX] = "\0"; /**< Stores naev's base path. */
+
+/*
+ * Directories verified to exist this session, so repeated
+ *  nfile_dirMakeExist() calls don't stat the filesystem every time.
+ */
+static char **dir_cache  = NULL; /**< Known existing directories. */
+static int dir_ncache    = 0; /**< Number of cached directories. */
+static int dir_mcache    = 0; /**< Allocated cache size. */
 /**
  * @brief Gets naev's base path (for saves and such).
  *
@@ -84,6 +93,7 @@ int nfile_dirMakeExist( const char* path, ... )
 {
    char file[PATH_MAX];
    va_list ap;
+   int i;
 
    if (path == NULL)
       return -1;
@@ -93,6 +103,11 @@ int nfile_dirMakeExist( const char* path, ... )
       va_end(ap);
    }
 
+   /* Already verified this session, skip the stat. */
+   for (i=0; i<dir_ncache; i++)
+      if (strcmp(file, dir_cache[i])==0)
+         return 0;
+
 #if HAS_POSIX
    struct stat buf;
    int ret;
@@ -126,6 +141,13 @@ int nfile_dirMakeExist( const char* path, ... )
 #error "Feature needs implementation on this Operating System for NAEV to work."
 #endif
 
+   /* Remember it exists. */
+   if (dir_ncache+1 > dir_mcache) { /* more memory */
+      dir_mcache += 32;
+      dir_cache = realloc( dir_cache, dir_mcache * sizeof(char*) );
+   }
+   dir_cache[dir_ncache++] = strdup(file);
+
    return 0;
 }
 
@@ -528,3 +550,36 @@ int nfile_writeFile( const char* data, int len, const char* path, ... )
    return 0;
 }
 
+
+/**
+ * @brief Opens a gzipped file with a large I/O buffer.
+ *
+ * zlib's default buffer is tiny and turns every access into a small
+ *  syscall, which hurts badly on network filesystems.
+ *
+ *    @param mode Mode to open the file in, as per gzopen.
+ *    @param path printf formatted string pointing to the file to open.
+ *    @return The opened file or NULL on error.
+ */
+gzFile nfile_gzOpen( const char* mode, const char* path, ... )
+{
+   char file[PATH_MAX];
+   va_list ap;
+   gzFile f;
+
+   if (path == NULL)
+      return NULL;
+   else { /* get the message */
+      va_start(ap, path);
+      vsnprintf(file, PATH_MAX, path, ap);
+      va_end(ap);
+   }
+
+   f = gzopen( file, mode );
+#if ZLIB_VERNUM >= 0x1240 /* gzbuffer() needs zlib 1.2.4 */
+   if (f != NULL)
+      gzbuffer( f, BLOCK_SIZE );
+#endif
+   return f;
+}
+
@@ -7,6 +7,9 @@
 #  define NFILE_H
 
 
+#include <zlib.h>
+
+
 char* nfile_basePath (void);
 int nfile_dirMakeExist( const char* path, ... ); /* Creates if doesn't exist, 0 success */
 int nfile_fileExists( const char* path, ... ); /* Returns 1 on exists */
@@ -15,6 +18,7 @@ char** nfile_readDir( int* nfiles, const char* path, ... );
 char* nfile_readFile( int* filesize, const char* path, ... );
 int nfile_touch( const char* path, ... );
 int nfile_writeFile( const char* data, int len, const char* path, ... );
+gzFile nfile_gzOpen( const char* mode, const char* path, ... ); /* gzopen with a big buffer */
 
 
 #endif /* NFILE_H */
@@ -0,0 +1,226 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file njob.c
+ *
+ * @brief Small worker-pool job system for sharding loops across cores.
+ *
+ * A pool of SDL threads is created at init and sits on a semaphore until
+ *  njob_parallelFor() hands out a loop to run.  Chunks are pulled off a
+ *  shared cursor so uneven work self-balances, and the calling thread
+ *  works alongside the pool instead of just waiting.  The function being
+ *  sharded must only touch data disjoint between chunks.
+ */
+
+
+#include "njob.h"
+
+#include "naev.h"
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "log.h"
+#include "ncompat.h"
+
+#if HAS_POSIX
+#include <unistd.h>
+#endif /* HAS_POSIX */
+
+
+#define NJOB_MAX_WORKERS   8 /**< Maximum worker threads in the pool. */
+
+
+/*
+ * The pool.
+ */
+static SDL_Thread *njob_workers[NJOB_MAX_WORKERS]; /**< Worker threads. */
+static int njob_nworkers   = 0; /**< Number of worker threads. */
+static SDL_sem *njob_go    = NULL; /**< Posted once per worker to start a job. */
+static SDL_sem *njob_done  = NULL; /**< Posted by each worker when done. */
+static SDL_mutex *njob_lock = NULL; /**< Protects the chunk cursor. */
+static int njob_quit       = 0; /**< Tells the workers to exit. */
+
+/*
+ * The job currently being run.
+ */
+static NJobFunc njob_func  = NULL; /**< Function to shard. */
+static void *njob_data     = NULL; /**< Data to pass to the function. */
+static int njob_n          = 0; /**< Total iterations. */
+static int njob_chunk      = 0; /**< Iterations handed out at a time. */
+static int njob_next       = 0; /**< Next iteration to hand out. */
+
+
+/*
+ * prototypes
+ */
+static int njob_worker( void *unused );
+static void njob_runChunks (void);
+
+
+/**
+ * @brief Pulls and runs chunks of the current job until it's exhausted.
+ */
+static void njob_runChunks (void)
+{
+   int start, end;
+
+   while (1) {
+      /* Grab the next chunk. */
+      SDL_mutexP( njob_lock );
+      start = njob_next;
+      njob_next += njob_chunk;
+      SDL_mutexV( njob_lock );
+
+      if (start >= njob_n)
+         break;
+
+      end = MIN( start + njob_chunk, njob_n );
+      njob_func( start, end, njob_data );
+   }
+}
+
+
+/**
+ * @brief Body of a pool worker.
+ *
+ *    @param unused Unused.
+ *    @return 0 on exit.
+ */
+static int njob_worker( void *unused )
+{
+   (void) unused;
+
+   while (1) {
+      SDL_SemWait( njob_go );
+      if (njob_quit)
+         break;
+
+      njob_runChunks();
+      SDL_SemPost( njob_done );
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Runs func over [0,n) sharded across the pool.
+ *
+ * Blocks until the whole range has run.  Runs serially if the pool is
+ *  unavailable or the range is too small to be worth sharding.
+ *
+ *    @param func Function to run.
+ *    @param n Number of iterations.
+ *    @param data Data to pass to func.
+ */
+void njob_parallelFor( NJobFunc func, int n, void *data )
+{
+   int i;
+
+   if (n <= 0)
+      return;
+
+   /* Not worth waking the pool up for. */
+   if ((njob_nworkers == 0) || (n < 4*(njob_nworkers+1))) {
+      func( 0, n, data );
+      return;
+   }
+
+   /* Set up the job - aim for a few chunks per thread so it balances. */
+   njob_func  = func;
+   njob_data  = data;
+   njob_n     = n;
+   njob_chunk = n / (4*(njob_nworkers+1)) + 1;
+   njob_next  = 0;
+
+   /* Wake the pool and pitch in. */
+   for (i=0; i<njob_nworkers; i++)
+      SDL_SemPost( njob_go );
+   njob_runChunks();
+
+   /* Wait for everyone to finish their last chunk. */
+   for (i=0; i<njob_nworkers; i++)
+      SDL_SemWait( njob_done );
+
+   njob_func = NULL;
+}
+
+
+/**
+ * @brief Initializes the job system.
+ *
+ *    @return 0 on success.
+ */
+int njob_init (void)
+{
+   int i, ncores;
+
+   /* See how many cores there are to play with. */
+#if HAS_POSIX
+   ncores = (int) sysconf( _SC_NPROCESSORS_ONLN );
+#else /* HAS_POSIX */
+   ncores = 2;
+#endif /* HAS_POSIX */
+
+   /* The calling thread works too, so one worker less than cores. */
+   njob_nworkers = CLAMP( 0, NJOB_MAX_WORKERS, ncores-1 );
+   if (njob_nworkers == 0) {
+      DEBUG("Single core detected, job system will run serially.");
+      return 0;
+   }
+
+   /* Synchronization. */
+   njob_lock = SDL_CreateMutex();
+   njob_go   = SDL_CreateSemaphore(0);
+   njob_done = SDL_CreateSemaphore(0);
+   if ((njob_lock == NULL) || (njob_go == NULL) || (njob_done == NULL)) {
+      WARN("Unable to create job system synchronization.");
+      njob_nworkers = 0;
+      return -1;
+   }
+
+   /* Spin up the pool. */
+   for (i=0; i<njob_nworkers; i++) {
+      njob_workers[i] = SDL_CreateThread( njob_worker, NULL );
+      if (njob_workers[i] == NULL) {
+         WARN("Unable to create job system worker %d.", i);
+         njob_nworkers = i;
+         break;
+      }
+   }
+
+   DEBUG("Job system using %d worker thread%s.", njob_nworkers,
+         (njob_nworkers == 1) ? "" : "s" );
+   return 0;
+}
+
+
+/**
+ * @brief Cleans up the job system.
+ */
+void njob_exit (void)
+{
+   int i;
+
+   /* Tell the pool to quit. */
+   njob_quit = 1;
+   for (i=0; i<njob_nworkers; i++)
+      SDL_SemPost( njob_go );
+   for (i=0; i<njob_nworkers; i++)
+      SDL_WaitThread( njob_workers[i], NULL );
+   njob_nworkers = 0;
+
+   /* Destroy synchronization. */
+   if (njob_lock != NULL)
+      SDL_DestroyMutex( njob_lock );
+   if (njob_go != NULL)
+      SDL_DestroySemaphore( njob_go );
+   if (njob_done != NULL)
+      SDL_DestroySemaphore( njob_done );
+   njob_lock = NULL;
+   njob_go   = NULL;
+   njob_done = NULL;
+}
@@ -0,0 +1,28 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef NJOB_H
+#  define NJOB_H
+
+
+/**
+ * @brief Function run by njob_parallelFor(), gets a [start,end) range.
+ */
+typedef void (*NJobFunc)( int start, int end, void *data );
+
+
+/*
+ * Init/exit.
+ */
+int njob_init (void);
+void njob_exit (void);
+
+/*
+ * Running jobs.
+ */
+void njob_parallelFor( NJobFunc func, int n, void *data );
+
+
+#endif /* NJOB_H */
@@ -12,11 +12,22 @@
 
 #include "naev.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "SDL.h"
+
 #include "lauxlib.h"
 
 #include "nluadef.h"
+#include "perf.h"
+#include "count.h"
 #include "log.h"
+#include "nmem.h"
+#include "lprof.h"
 #include "ndata.h"
+#include "strhash.h"
 #include "nlua_rnd.h"
 #include "nlua_faction.h"
 #include "nlua_var.h"
@@ -29,32 +40,568 @@
 #include "nlua_diff.h"
 
 
+/*
+ * Pooled allocator.
+ *
+ * Lua churns small objects constantly (AI thinks, mission ticks, hook
+ *  runs), which fragments the heap over long sessions with the default
+ *  realloc allocator.  Each state gets its own pool: small blocks come
+ *  out of size-class free lists carved from bump-allocated arena chunks,
+ *  big blocks fall through to malloc.  Arena memory is only returned to
+ *  the system when the state is closed through nlua_freeState().
+ */
+#define NLUA_POOL_ALIGN    8 /**< Size-class granularity, must hold a pointer. */
+#define NLUA_POOL_MAX      256 /**< Largest block served from the pool. */
+#define NLUA_POOL_NCLASS   (NLUA_POOL_MAX/NLUA_POOL_ALIGN) /**< Number of size classes. */
+#define NLUA_POOL_CHUNK    (16*1024) /**< Usable bytes per arena chunk. */
+
+/**
+ * @brief A freed pool block, linked into its size-class free list.
+ */
+typedef struct NLuaFree_ {
+   struct NLuaFree_ *next; /**< Next free block of the same class. */
+} NLuaFree;
+/**
+ * @brief An arena chunk the pool blocks are carved from.
+ */
+typedef struct NLuaChunk_ {
+   struct NLuaChunk_ *next; /**< Next chunk in the pool. */
+} NLuaChunk;
+/**
+ * @brief Per-state allocator pool.
+ */
+typedef struct NLuaPool_ {
+   NLuaFree *freelist[NLUA_POOL_NCLASS]; /**< Free lists by size class. */
+   NLuaChunk *chunks; /**< All the arena chunks. */
+   char *cur; /**< Bump pointer into the newest chunk. */
+   size_t left; /**< Bytes left in the newest chunk. */
+   size_t used; /**< Bytes the state currently holds, for reporting. */
+} NLuaPool;
+
+
+/*
+ * GC governor.
+ *
+ * Automatic collection is stopped on every state so an allocation in the
+ *  middle of an AI think or a mission hook can't trigger a multi-ms
+ *  sweep.  nlua_gcRun() instead runs bounded incremental steps from
+ *  fps_control(), spending frame slack when there is some and falling
+ *  back to a per-state memory growth goal when there is none.
+ */
+#define NLUA_GC_STEPKB     5 /**< KB handed to each incremental step. */
+#define NLUA_GC_GROWTH     2 /**< Growth factor that forces steps without slack. */
+#define NLUA_GC_MINGOAL    256 /**< KB floor of the forced-collection goal. */
+#define NLUA_GC_FORCED     32 /**< Step cap per state and frame when forced. */
+
+/**
+ * @brief Registry entry of a live state for the GC governor.
+ */
+typedef struct NLuaStateReg_ {
+   struct NLuaStateReg_ *next; /**< Next in linked list. */
+   lua_State *L; /**< The state itself. */
+   int goal; /**< Memory in KB that forces collection when passed. */
+   long gc_time; /**< Total time spent in GC steps in ms. */
+   long gc_steps; /**< Total GC steps run. */
+} NLuaStateReg;
+static NLuaStateReg *nlua_states   = NULL; /**< All the live states. */
+static NLuaStateReg *nlua_gcCursor = NULL; /**< Round-robin position. */
+
+
 /*
  * prototypes
  */
+static void* nlua_poolGet( NLuaPool *pool, size_t size );
+static void* nlua_alloc( void *ud, void *ptr, size_t osize, size_t nsize );
+static int nlua_panic( lua_State *L );
+static int nlua_dumpWriter( lua_State *L, const void *p, size_t sz, void *ud );
 static int nlua_packfileLoader( lua_State* L );
 
 
 /**
- * @brief Wrapper around luaL_newstate.
+ * @brief Serves a small block from the pool.
+ *
+ *    @param pool Pool to allocate from.
+ *    @param size Size of the block, must not exceed NLUA_POOL_MAX.
+ *    @return The block or NULL on out of memory.
+ */
+static void* nlua_poolGet( NLuaPool *pool, size_t size )
+{
+   NLuaFree *blk;
+   NLuaChunk *chunk;
+   int c;
+
+   /* Round up to the size class. */
+   c    = (size-1) / NLUA_POOL_ALIGN;
+   size = (c+1) * NLUA_POOL_ALIGN;
+
+   /* Reuse a freed block if possible. */
+   blk = pool->freelist[c];
+   if (blk != NULL) {
+      pool->freelist[c] = blk->next;
+      return blk;
+   }
+
+   /* Carve from the newest chunk, growing the arena when it runs out.
+    * The tail of the old chunk is wasted, but it's at most one block. */
+   if (pool->left < size) {
+      chunk = malloc( sizeof(NLuaChunk) + NLUA_POOL_CHUNK );
+      if (chunk == NULL)
+         return NULL;
+      nmem_count( MEM_LUA, sizeof(NLuaChunk) + NLUA_POOL_CHUNK, +1 );
+      chunk->next = pool->chunks;
+      pool->chunks = chunk;
+      pool->cur   = (char*)(chunk+1);
+      pool->left  = NLUA_POOL_CHUNK;
+   }
+   blk = (NLuaFree*) pool->cur;
+   pool->cur  += size;
+   pool->left -= size;
+   return blk;
+}
+
+
+/**
+ * @brief Returns a small block to its size-class free list.
+ *
+ *    @param pool Pool the block belongs to.
+ *    @param ptr Block to return.
+ *    @param size Size the block was allocated with.
+ */
+static void nlua_poolPut( NLuaPool *pool, void *ptr, size_t size )
+{
+   NLuaFree *blk;
+   int c;
+
+   c = (size-1) / NLUA_POOL_ALIGN;
+   blk = (NLuaFree*) ptr;
+   blk->next = pool->freelist[c];
+   pool->freelist[c] = blk;
+}
+
+
+/**
+ * @brief lua_Alloc implementation backed by the per-state pool.
+ *
+ *    @param ud The state's NLuaPool.
+ *    @param ptr Block to reallocate or free, NULL to allocate.
+ *    @param osize Current size of the block.
+ *    @param nsize Requested size, 0 to free.
+ *    @return The block or NULL when freeing or out of memory.
+ */
+static void* nlua_alloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+   NLuaPool *pool;
+   void *nptr;
+
+   pool = (NLuaPool*) ud;
+   if (ptr == NULL)
+      osize = 0;
+
+   /* Free. */
+   if (nsize == 0) {
+      if (ptr != NULL) {
+         if (osize <= NLUA_POOL_MAX)
+            nlua_poolPut( pool, ptr, osize );
+         else {
+            free( ptr );
+            nmem_count( MEM_LUA, -(long)osize, -1 );
+         }
+         pool->used -= osize;
+      }
+      return NULL;
+   }
+
+   /* Same size class, nothing to move. */
+   if ((ptr != NULL) && (osize <= NLUA_POOL_MAX) && (nsize <= NLUA_POOL_MAX) &&
+         ((osize-1)/NLUA_POOL_ALIGN == (nsize-1)/NLUA_POOL_ALIGN)) {
+      pool->used += nsize - osize;
+      return ptr;
+   }
+
+   /* Big blocks stay with the system allocator. */
+   if ((ptr != NULL) && (osize > NLUA_POOL_MAX) && (nsize > NLUA_POOL_MAX)) {
+      nptr = realloc( ptr, nsize );
+      if (nptr != NULL) {
+         pool->used += nsize - osize;
+         nmem_count( MEM_LUA, (long)nsize - (long)osize, 0 );
+      }
+      return nptr;
+   }
+
+   /* Allocate, copying over when growing or shrinking across classes. */
+   if (nsize <= NLUA_POOL_MAX)
+      nptr = nlua_poolGet( pool, nsize );
+   else {
+      nptr = malloc( nsize );
+      if (nptr != NULL)
+         nmem_count( MEM_LUA, (long)nsize, +1 );
+   }
+   if (nptr == NULL)
+      return NULL;
+   if (ptr != NULL) {
+      memcpy( nptr, ptr, MIN(osize, nsize) );
+      if (osize <= NLUA_POOL_MAX)
+         nlua_poolPut( pool, ptr, osize );
+      else {
+         free( ptr );
+         nmem_count( MEM_LUA, -(long)osize, -1 );
+      }
+   }
+   pool->used += nsize - osize;
+   return nptr;
+}
+
+
+/**
+ * @brief Panic function matching what luaL_newstate installs.
+ */
+static int nlua_panic( lua_State *L )
+{
+   WARN("PANIC: unprotected error in call to Lua API (%s)",
+         lua_tostring(L, -1));
+   return 0;
+}
+
+
+/**
+ * @brief Wrapper around luaL_newstate using the pooled allocator.
  *
  *    @return A newly created lua_State.
  */
 lua_State *nlua_newState (void)
 {
    lua_State *L;
+   NLuaPool *pool;
+   NLuaStateReg *r;
 
    /* try to create the new state */
-   L = luaL_newstate();
+   pool = calloc( 1, sizeof(NLuaPool) );
+   L = lua_newstate( nlua_alloc, pool );
    if (L == NULL) {
+      free( pool );
       WARN("Failed to create new lua state.");
       return NULL;
    }
+   lua_atpanic( L, nlua_panic );
+   lprof_hook( L );
+
+   /* The governor schedules collection into frame slack instead. */
+   lua_gc( L, LUA_GCSTOP, 0 );
+   r = malloc( sizeof(NLuaStateReg) );
+   r->L        = L;
+   r->goal     = NLUA_GC_MINGOAL;
+   r->gc_time  = 0;
+   r->gc_steps = 0;
+   r->next     = nlua_states;
+   nlua_states = r;
 
    return L;
 }
 
 
+/**
+ * @brief Closes a state and releases its allocator pool.
+ *
+ * Must be used instead of lua_close() for states created with
+ *  nlua_newState().
+ *
+ *    @param L State to close.
+ */
+void nlua_freeState( lua_State *L )
+{
+   NLuaPool *pool;
+   NLuaChunk *chunk;
+   NLuaStateReg *r, *last;
+   void *ud;
+
+   /* Drop it from the governor's registry. */
+   last = NULL;
+   for (r=nlua_states; r!=NULL; r=r->next) {
+      if (r->L == L) {
+         if (last == NULL)
+            nlua_states = r->next;
+         else
+            last->next = r->next;
+         if (nlua_gcCursor == r)
+            nlua_gcCursor = r->next;
+         free(r);
+         break;
+      }
+      last = r;
+   }
+
+   lua_getallocf( L, &ud );
+   lua_close( L );
+
+   /* States not created by nlua_newState() have no pool. */
+   pool = (NLuaPool*) ud;
+   if (pool == NULL)
+      return;
+
+   while (pool->chunks != NULL) {
+      chunk = pool->chunks;
+      pool->chunks = chunk->next;
+      free( chunk );
+      nmem_count( MEM_LUA, -(long)(sizeof(NLuaChunk) + NLUA_POOL_CHUNK), -1 );
+   }
+   free( pool );
+}
+
+
+/**
+ * @brief Reports how much memory a state currently holds.
+ *
+ *    @param L State to query.
+ *    @return Bytes in use, 0 for states without a pool.
+ */
+size_t nlua_memUsage( lua_State *L )
+{
+   NLuaPool *pool;
+   void *ud;
+
+   lua_getallocf( L, &ud );
+   pool = (NLuaPool*) ud;
+   if (pool == NULL)
+      return 0;
+   return pool->used;
+}
+
+
+/**
+ * @brief Runs bounded GC steps across all the live states.
+ *
+ * Walks the states round robin from where the last frame stopped.  With
+ *  a budget every state gets stepped until the budget runs out; without
+ *  one only states past their memory growth goal are serviced, capped at
+ *  NLUA_GC_FORCED steps each so a runaway state still can't stall the
+ *  frame.
+ *
+ *    @param budget Time to spend in seconds, 0. for pressure-only.
+ *    @return Time actually spent in seconds.
+ */
+double nlua_gcRun( double budget )
+{
+   NLuaStateReg *r, *start;
+   unsigned int t0, ts, t;
+   int kb, done, force, steps;
+
+   if (nlua_states == NULL)
+      return 0.;
+
+   t0 = SDL_GetTicks();
+   t  = t0;
+
+   /* Pick up where the last frame left off. */
+   if (nlua_gcCursor == NULL)
+      nlua_gcCursor = nlua_states;
+   start = nlua_gcCursor;
+
+   PERF_BEGIN( PERF_LUAGC );
+   r = start;
+   do {
+      kb    = lua_gc( r->L, LUA_GCCOUNT, 0 );
+      force = (kb > r->goal);
+      if ((budget > 0.) || force) {
+         steps = 0;
+         ts    = SDL_GetTicks();
+         do {
+            done = lua_gc( r->L, LUA_GCSTEP, NLUA_GC_STEPKB );
+            steps++;
+            t = SDL_GetTicks();
+         } while (!done &&
+               (((double)(t - t0)/1000. < budget) ||
+                (force && (steps < NLUA_GC_FORCED))));
+         COUNT_ADD( COUNT_GCSTEP, steps );
+         r->gc_steps += steps;
+         r->gc_time  += t - ts;
+
+         /* Cycle finished, set the next forced goal off the low point. */
+         if (done) {
+            kb = lua_gc( r->L, LUA_GCCOUNT, 0 );
+            r->goal = MAX( kb * NLUA_GC_GROWTH, NLUA_GC_MINGOAL );
+         }
+      }
+      r = (r->next != NULL) ? r->next : nlua_states;
+   } while ((r != start) && ((double)(t - t0)/1000. < budget));
+   nlua_gcCursor = r;
+   PERF_END( PERF_LUAGC );
+
+   return (double)(SDL_GetTicks() - t0) / 1000.;
+}
+
+
+/**
+ * @brief Counts the live states in the governor's registry.
+ *
+ *    @return Number of live states.
+ */
+int nlua_gcStates (void)
+{
+   NLuaStateReg *r;
+   int n;
+
+   n = 0;
+   for (r=nlua_states; r!=NULL; r=r->next)
+      n++;
+   return n;
+}
+
+
+/**
+ * @brief Gets the GC pause stats of a state, for the console bindings.
+ *
+ *    @param i Index of the state, 0 up to nlua_gcStates().
+ *    @param[out] kb Memory the state currently holds in KB.
+ *    @param[out] ms Total time spent in its GC steps in ms.
+ *    @param[out] steps Total GC steps run on it.
+ *    @return 0 on success, -1 if the index is out of range.
+ */
+int nlua_gcStat( int i, int *kb, long *ms, long *steps )
+{
+   NLuaStateReg *r;
+
+   for (r=nlua_states; r!=NULL; r=r->next) {
+      if (i == 0) {
+         *kb    = lua_gc( r->L, LUA_GCCOUNT, 0 );
+         *ms    = r->gc_time;
+         *steps = r->gc_steps;
+         return 0;
+      }
+      i--;
+   }
+   return -1;
+}
+
+
+/*
+ * Bytecode cache.
+ *
+ * Mission and event scripts get compiled on every instantiation and AI
+ *  profiles on every startup.  The first nlua_dofileCached() of a path
+ *  compiles the source and keeps the dumped bytecode; later runs load
+ *  the dump directly, skipping the ndata read and the parser.
+ */
+/**
+ * @brief A cached compiled script.
+ */
+typedef struct NLuaCache_ {
+   char *path; /**< ndata path of the script, used as the hash key. */
+   char *chunk; /**< Dumped bytecode. */
+   size_t size; /**< Size of the dump. */
+   struct NLuaCache_ *next; /**< Linked list of all entries, for cleanup. */
+} NLuaCache;
+static StrHash *nlua_cache       = NULL; /**< Maps script path to its cache. */
+static NLuaCache *nlua_cacheList = NULL; /**< All cache entries. */
+
+/**
+ * @brief Buffer being accumulated by nlua_dumpWriter.
+ */
+typedef struct NLuaDump_ {
+   char *buf; /**< Dump data. */
+   size_t n; /**< Bytes used. */
+   size_t m; /**< Bytes allocated. */
+} NLuaDump;
+
+
+/**
+ * @brief lua_Writer accumulating the dump into a growing buffer.
+ */
+static int nlua_dumpWriter( lua_State *L, const void *p, size_t sz, void *ud )
+{
+   NLuaDump *dump;
+   (void) L;
+
+   dump = (NLuaDump*) ud;
+   if (dump->n + sz > dump->m) {
+      dump->m = MAX( dump->m * 2, dump->n + sz );
+      dump->buf = realloc( dump->buf, dump->m );
+   }
+   memcpy( &dump->buf[dump->n], p, sz );
+   dump->n += sz;
+   return 0;
+}
+
+
+/**
+ * @brief Runs a script out of the bytecode cache, compiling it on first use.
+ *
+ * Behaves like luaL_dobuffer() on the file's contents: returns 0 on
+ *  success and leaves the error message on the stack otherwise.
+ *
+ *    @param L State to run the script in.
+ *    @param filename ndata path of the script.
+ *    @return 0 on success.
+ */
+int nlua_dofileCached( lua_State *L, const char *filename )
+{
+   NLuaCache *c;
+   NLuaDump dump;
+   char *buf;
+   uint32_t bufsize;
+   int ret;
+
+   if (nlua_cache == NULL)
+      nlua_cache = strhash_create( 64 );
+
+   /* Compile and dump on first use. */
+   c = strhash_get( nlua_cache, filename );
+   if (c == NULL) {
+      buf = ndata_read( filename, &bufsize );
+      if (buf == NULL) {
+         lua_pushfstring( L, "script '%s' not found in ndata", filename );
+         return -1;
+      }
+      ret = luaL_loadbuffer( L, buf, bufsize, filename );
+      free( buf );
+      if (ret != 0)
+         return ret;
+
+      dump.buf = NULL;
+      dump.n   = 0;
+      dump.m   = 0;
+      lua_dump( L, nlua_dumpWriter, &dump );
+
+      c        = malloc( sizeof(NLuaCache) );
+      c->path  = strdup( filename );
+      c->chunk = dump.buf;
+      c->size  = dump.n;
+      c->next  = nlua_cacheList;
+      nlua_cacheList = c;
+      strhash_put( nlua_cache, c->path, c );
+
+      /* The compiled chunk is on the stack, just run it. */
+      return lua_pcall( L, 0, LUA_MULTRET, 0 );
+   }
+
+   /* Load the precompiled chunk - the dump signature skips the parser. */
+   ret = luaL_loadbuffer( L, c->chunk, c->size, filename );
+   if (ret != 0)
+      return ret;
+   return lua_pcall( L, 0, LUA_MULTRET, 0 );
+}
+
+
+/**
+ * @brief Frees the bytecode cache.
+ */
+void nlua_cacheExit (void)
+{
+   NLuaCache *c;
+
+   while (nlua_cacheList != NULL) {
+      c = nlua_cacheList;
+      nlua_cacheList = c->next;
+      free( c->path );
+      free( c->chunk );
+      free( c );
+   }
+   if (nlua_cache != NULL) {
+      strhash_destroy( nlua_cache );
+      nlua_cache = NULL;
+   }
+}
+
+
 /**
  * @brief Opens a lua library.
  *
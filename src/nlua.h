@@ -7,6 +7,8 @@
 #  define NLUA_H
 
 
+#include <stddef.h>
+
 #include "lua.h"
 
 
@@ -14,10 +16,23 @@
  * standard lua stuff wrappers
  */
 lua_State *nlua_newState (void); /* creates a new state */
+void nlua_freeState( lua_State *L ); /* closes a state and its pool */
+size_t nlua_memUsage( lua_State *L );
+
+/* GC governor, stepped from fps_control(). */
+double nlua_gcRun( double budget );
+int nlua_gcStates (void);
+int nlua_gcStat( int i, int *kb, long *ms, long *steps );
 int nlua_load( lua_State* L, lua_CFunction f );
 int nlua_loadBasic( lua_State* L );
 int nlua_loadStandard( lua_State *L, int readonly );
 
+/*
+ * bytecode cache
+ */
+int nlua_dofileCached( lua_State *L, const char *filename );
+void nlua_cacheExit (void);
+
 
 #endif /* NLUA_H */
 
@@ -12,20 +12,25 @@
 
 #include "naev.h"
 
+#include <string.h>
+
 #include "lauxlib.h"
 
 #include "nlua.h"
 #include "nluadef.h"
 #include "log.h"
 #include "mission.h"
+#include "lprof.h"
 
 
 /* CLI */
 static int cli_missionStart( lua_State *L );
 static int cli_missionTest( lua_State *L );
+static int cli_profile( lua_State *L );
 static const luaL_reg cli_methods[] = {
    { "missionStart", cli_missionStart },
    { "missionTest", cli_missionTest },
+   { "profile", cli_profile },
    {0,0}
 }; /**< CLI Lua methods. */
 
@@ -94,3 +99,46 @@ static int cli_missionTest( lua_State *L )
    return 0;
 }
 
+
+/**
+ * @brief Controls the Lua sampling profiler.
+ *
+ * Without arguments returns the samples collected so far as a table
+ *  mapping "source:line name" to sample counts.  Every Lua state is
+ *  profiled, so AI tasks, missions and events all show up together.
+ *
+ * @usage cli.profile( "start" ) -- Begin collecting samples.
+ * @usage for k,v in pairs( cli.profile() ) do print( v, k ) end
+ *
+ *    @luaparam cmd "start", "stop" or "clear", or nil to get results.
+ *    @luareturn Table of function to samples when cmd is nil.
+ * @luafunc profile( cmd )
+ */
+static int cli_profile( lua_State *L )
+{
+   const char *str;
+   int i;
+
+   if (lua_gettop(L) > 0) {
+      str = luaL_checkstring(L, 1);
+      if (strcmp( str, "start" ) == 0)
+         lprof_start();
+      else if (strcmp( str, "stop" ) == 0)
+         lprof_stop();
+      else if (strcmp( str, "clear" ) == 0)
+         lprof_clear();
+      else
+         NLUA_INVALID_PARAMETER();
+      return 0;
+   }
+
+   lua_newtable(L);
+   for (i=0; i<lprof_entries(); i++) {
+      str = lprof_name(i);
+      if (str == NULL)
+         continue;
+      lua_pushnumber( L, lprof_samples(i) );
+      lua_setfield( L, -2, str );
+   }
+   return 1;
+}
@@ -183,6 +183,9 @@ static int evt_timerStart( lua_State *L )
       return 0;
    }
 
+   /* New deadline to schedule. */
+   events_timerRecalc();
+
    /* Returns the timer id. */
    lua_pushnumber(L,i);
    return 1;
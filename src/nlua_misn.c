@@ -10,6 +10,7 @@
 
 
 #include "nlua_misn.h"
+#include "intern.h"
 
 #include "naev.h"
 
@@ -361,16 +362,13 @@ static int misn_setMarker( lua_State *L )
 
    /* No parameter clears the marker */
    if (lua_gettop(L)==0) {
-      if (cur_mission->sys_marker != NULL)
-         free(cur_mission->sys_marker);
+      cur_mission->sys_marker = NULL; /* Interned, nothing to free. */
       mission_sysMark(); /* Clear the marker */
    }
 
    /* Passing in a Star System */
    sys = luaL_checksystem(L,1);
-   if (cur_mission->sys_marker != NULL)
-      free(cur_mission->sys_marker);
-   cur_mission->sys_marker = strdup(sys->s->name);
+   cur_mission->sys_marker = (char*) str_intern(sys->s->name);
 
    /* Get the type. */
    if (lua_gettop(L) > 1) {
@@ -494,6 +492,8 @@ static int misn_accept( lua_State *L )
       setOSD(); /* Set OSD if applicable. */
       /* Needed to make sure hooks work. */
       nlua_hookTarget( cur_mission, NULL );
+      /* Timers armed during create start counting now. */
+      missions_timerRecalc();
    }
 
    lua_pushboolean(L,!ret); /* we'll convert C style return to lua */
@@ -563,6 +563,9 @@ static int misn_timerStart( lua_State *L )
       return 0;
    }
 
+   /* New deadline to schedule. */
+   missions_timerRecalc();
+
    /* Returns the timer id. */
    lua_pushnumber(L,i);
    return 1;
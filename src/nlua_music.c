@@ -25,6 +25,7 @@
 /* functions */
 static int musicL_delay( lua_State* L );
 static int musicL_load( lua_State* L );
+static int musicL_prefetch( lua_State* L );
 static int musicL_play( lua_State* L );
 static int musicL_stop( lua_State* L );
 static int musicL_isPlaying( lua_State* L );
@@ -32,6 +33,7 @@ static int musicL_current( lua_State* L );
 static const luaL_reg music_methods[] = {
    { "delay", musicL_delay },
    { "load", musicL_load },
+   { "prefetch", musicL_prefetch },
    { "play", musicL_play },
    { "stop", musicL_stop },
    { "isPlaying", musicL_isPlaying },
@@ -113,6 +115,27 @@ static int musicL_load( lua_State *L )
 }
 
 
+/**
+ * @brief Preloads a song into the music cache without playing it.
+ *
+ * @usage music.prefetch( "combat1" ) -- Warm up the likely next song
+ *
+ *    @luaparam name Name of the song to preload.
+ * @luafunc prefetch( name )
+ */
+static int musicL_prefetch( lua_State *L )
+{
+   const char* str;
+
+   /* check parameters */
+   str = luaL_checkstring(L,1);
+   if (music_prefetch( str ))
+      WARN("Music '%s' invalid or failed to preload.", str );
+
+   return 0;
+}
+
+
 /**
  * @brief Plays the loaded song.
  *
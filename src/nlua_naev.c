@@ -19,14 +19,17 @@
 #include "log.h"
 #include "nstd.h"
 #include "input.h"
+#include "nmem.h"
 
 
 /* naev */
 static int naev_lang( lua_State *L );
 static int naev_getKey( lua_State *L );
+static int naev_memstats( lua_State *L );
 static const luaL_reg naev_methods[] = {
    { "lang", naev_lang },
    { "getKey", naev_getKey },
+   { "memstats", naev_memstats },
    {0,0}
 }; /**< NAEV Lua methods. */
 
@@ -132,3 +135,31 @@ static int naev_getKey( lua_State *L )
    return 1;
 }
 
+
+
+/**
+ * @brief Gets the per-subsystem memory accounting counters.
+ *
+ * @usage for k,v in pairs(naev.memstats()) do print(k, v.bytes) end
+ *
+ *    @luareturn Table mapping each tag to a table with bytes, peak and
+ *               allocs fields.
+ * @luafunc memstats()
+ */
+static int naev_memstats( lua_State *L )
+{
+   int i;
+
+   lua_newtable(L);
+   for (i=0; i<MEM_MAX; i++) {
+      lua_newtable(L);
+      lua_pushnumber( L, nmem_bytes(i) );
+      lua_setfield( L, -2, "bytes" );
+      lua_pushnumber( L, nmem_peak(i) );
+      lua_setfield( L, -2, "peak" );
+      lua_pushnumber( L, nmem_allocs(i) );
+      lua_setfield( L, -2, "allocs" );
+      lua_setfield( L, -2, nmem_tagName(i) );
+   }
+   return 1;
+}
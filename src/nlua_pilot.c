@@ -11,9 +11,12 @@
  */
 
 #include "nlua_pilot.h"
+#include "intern.h"
 
 #include "naev.h"
 
+#include "SDL.h"
+
 #include "lauxlib.h"
 
 #include "nlua.h"
@@ -26,6 +29,8 @@
 #include "pilot.h"
 #include "player.h"
 #include "space.h"
+#include "ship.h"
+#include "faction.h"
 
 
 /*
@@ -41,11 +46,14 @@ extern int pilot_nstack;
 /* External. */
 extern int ai_pinit( Pilot *p, const char *ai );
 extern void ai_destroy( Pilot* p );
+extern void update_routine( double dt ); /* From naev.c, for the stress ramp. */
 
 
 /* Pilot metatable methods. */
 static int pilot_getPlayer( lua_State *L );
 static int pilot_addFleet( lua_State *L );
+static int pilot_addStress( lua_State *L );
+static int pilot_stressRamp( lua_State *L );
 static int pilot_clear( lua_State *L );
 static int pilot_toggleSpawn( lua_State *L );
 static int pilot_getPilots( lua_State *L );
@@ -69,6 +77,7 @@ static int pilotL_changeAI( lua_State *L );
 static int pilotL_setHealth( lua_State *L );
 static int pilotL_setNoboard( lua_State *L );
 static int pilotL_getHealth( lua_State *L );
+static int pilotL_status( lua_State *L );
 static int pilotL_shipName( lua_State *L );
 static int pilotL_ship( lua_State *L );
 static const luaL_reg pilotL_methods[] = {
@@ -86,11 +95,14 @@ static const luaL_reg pilotL_methods[] = {
    /* System. */
    { "clear", pilot_clear },
    { "toggleSpawn", pilot_toggleSpawn },
+   { "addStress", pilot_addStress },
+   { "stressRamp", pilot_stressRamp },
    /* Modify. */
    { "changeAI", pilotL_changeAI },
    { "setHealth", pilotL_setHealth },
    { "setNoboard", pilotL_setNoboard },
    { "getHealth", pilotL_getHealth },
+   { "status", pilotL_status },
    { "warp", pilotL_warp },
    { "setFaction", pilotL_setFaction },
    { "setHostile", pilotL_setHostile },
@@ -400,6 +412,147 @@ static int pilot_clear( lua_State *L )
    pilots_clean();
    return 0;
 }
+
+
+#define STRESS_SPREAD   2000. /**< Radius stress pilots are scattered over. */
+#define STRESS_MAX      2000  /**< Pilot count where the ramp gives up. */
+#define STRESS_SETTLE     30  /**< Warmup steps after spawning a batch. */
+#define STRESS_MEASURE    60  /**< Steps timed per batch. */
+/**
+ * @brief Spawns n fighting pilots split over two hostile factions.
+ *
+ *    @return 0 on success, -1 if the ship doesn't exist.
+ */
+static int pilot_stressSpawn( lua_State *L, int n, const char *shipname,
+      const char *fltai )
+{
+   Ship *ship;
+   int i, f[2];
+   Vector2d vp, vv;
+
+   ship = ship_get( shipname );
+   if (ship == NULL) {
+      NLUA_ERROR(L,"Ship '%s' doesn't exist.", shipname);
+      return -1;
+   }
+
+   /* Two factions that hate each other so the pilots actually fight. */
+   f[0] = faction_get("Pirate");
+   f[1] = faction_get("Empire");
+   if ((f[0] < 0) || (f[1] < 0)) {
+      NLUA_ERROR(L,"Stress factions not available.");
+      return -1;
+   }
+
+   vectnull( &vv );
+   for (i=0; i<n; i++) {
+      vect_pset( &vp, RNGF()*STRESS_SPREAD, RNGF()*2.*M_PI );
+      pilot_create( ship, ship->name, f[i%2], fltai,
+            RNGF()*2.*M_PI, &vp, &vv, 0 );
+   }
+   return 0;
+}
+/**
+ * @brief Spawns a parameterized stress scenario.
+ *
+ * Creates n pilots of the given ship split over two hostile factions so
+ *  they fight.  Passing a seed reseeds the RNG first, making runs
+ *  comparable across builds.
+ *
+ * @usage pilot.addStress( 200, "Hyena" )
+ * @usage pilot.addStress( 200, "Hyena", "def", 42 ) -- Reproducible.
+ *
+ *    @luaparam n Number of pilots to create.
+ *    @luaparam ship Name of the ship they fly.
+ *    @luaparam ai AI profile to use, "def" for the default.
+ *    @luaparam seed Optional RNG seed for reproducible runs.
+ * @luafunc addStress( n, ship, ai, seed )
+ */
+static int pilot_addStress( lua_State *L )
+{
+   int n;
+   const char *shipname, *fltai;
+
+   n        = luaL_checkint(L,1);
+   shipname = luaL_checkstring(L,2);
+   if (lua_gettop(L) > 2) {
+      fltai = luaL_checkstring(L,3);
+      if (strcmp(fltai, "def")==0)
+         fltai = NULL;
+   }
+   else
+      fltai = NULL;
+   if (lua_gettop(L) > 3)
+      rng_initSeed( (uint32_t)luaL_checklong(L,4) );
+
+   pilot_stressSpawn( L, n, shipname, fltai );
+   return 0;
+}
+/**
+ * @brief Ramps the pilot count until frame time exceeds a threshold.
+ *
+ * Spawns fighting pilots in batches and steps the simulation directly,
+ *  timing the update cost per step, until it crosses threshold
+ *  milliseconds.  Reports the capacity of the current build.  Only safe
+ *  from the console, where the simulation thread is idle.  Cleans up
+ *  after itself.
+ *
+ * @usage n, ms = pilot.stressRamp( 16., "Hyena" ) -- Ceiling for 60 fps.
+ *
+ *    @luaparam threshold Update time in milliseconds to ramp up to.
+ *    @luaparam ship Name of the ship the stress pilots fly.
+ *    @luaparam ai AI profile to use, "def" for the default.
+ *    @luaparam step Optional pilots added per batch, defaults to 25.
+ *    @luareturn Pilot count reached and the update ms measured there.
+ * @luafunc stressRamp( threshold, ship, ai, step )
+ */
+static int pilot_stressRamp( lua_State *L )
+{
+   double threshold, ms;
+   const char *shipname, *fltai;
+   int i, step, total;
+   unsigned int t0;
+
+   threshold = luaL_checknumber(L,1);
+   shipname  = luaL_checkstring(L,2);
+   if (lua_gettop(L) > 2) {
+      fltai = luaL_checkstring(L,3);
+      if (strcmp(fltai, "def")==0)
+         fltai = NULL;
+   }
+   else
+      fltai = NULL;
+   step = (lua_gettop(L) > 3) ? luaL_checkint(L,4) : 25;
+
+   rng_initSeed( 0 ); /* Same battle every run. */
+
+   ms    = 0.;
+   total = 0;
+   while (total < STRESS_MAX) {
+      if (pilot_stressSpawn( L, step, shipname, fltai ) != 0)
+         return 0; /* Error already raised. */
+      total += step;
+
+      /* Let the new batch pick targets before timing. */
+      for (i=0; i<STRESS_SETTLE; i++)
+         update_routine( 1./60. );
+
+      t0 = SDL_GetTicks();
+      for (i=0; i<STRESS_MEASURE; i++)
+         update_routine( 1./60. );
+      ms = (double)(SDL_GetTicks() - t0) / (double)STRESS_MEASURE;
+
+      if (ms > threshold)
+         break;
+   }
+
+   /* Leave the system as we found it. */
+   pilots_clean();
+
+   lua_pushnumber( L, total );
+   lua_pushnumber( L, ms );
+   return 2;
+}
 /**
  * @brief Disables or enables pilot spawning in the current system.
  *
@@ -595,10 +748,8 @@ static int pilotL_rename( lua_State *L )
       return 0;
    }
 
-   /* Change name. */
-   if (p->name != NULL)
-      free(p->name);
-   p->name = strdup(name);
+   /* Change name, the old one is interned and stays pooled. */
+   p->name = (char*) str_intern(name);
 
    return 0;
 }
@@ -824,7 +975,7 @@ static int pilotL_setFaction( lua_State *L )
    }
 
    /* Set the new faction. */
-   p->faction = fid;
+   pilot_setFaction( p, fid );
 
    return 0;
 }
@@ -1251,6 +1402,59 @@ static int pilotL_getHealth( lua_State *L )
 }
 
 
+/**
+ * @brief Gets a status snapshot of the pilot in a single call.
+ *
+ * Bundles what would otherwise be five separate calls into one
+ *  boundary crossing.  The returned table has the fields armour,
+ *  shield and energy (absolute values) and pos and vel (vec2).
+ *
+ * @usage s = p:status() -- s.armour, s.shield, s.energy, s.pos, s.vel
+ * @usage s = p:status(s) -- refills s instead of making a new table
+ *
+ *    @luaparam p Pilot to get the status of.
+ *    @luaparam t Optional table to refill.
+ *    @luareturn Table with the pilot's status.
+ * @luafunc status( p, t )
+ */
+static int pilotL_status( lua_State *L )
+{
+   LuaPilot *lp;
+   Pilot *p;
+   LuaVector v;
+
+   /* Get the pilot. */
+   lp = luaL_checkpilot(L,1);
+   p  = pilot_get(lp->pilot);
+   if (p==NULL) {
+      NLUA_ERROR(L,"Pilot is invalid.");
+      return 0;
+   }
+
+   /* Reuse the caller's table when given. */
+   if (lua_istable(L,2))
+      lua_pushvalue(L,2);
+   else
+      lua_createtable(L, 0, 5);
+
+   /* Fill it in. */
+   lua_pushnumber(L, p->armour);
+   lua_setfield(L, -2, "armour");
+   lua_pushnumber(L, p->shield);
+   lua_setfield(L, -2, "shield");
+   lua_pushnumber(L, p->energy);
+   lua_setfield(L, -2, "energy");
+   vectcpy( &v.vec, &p->solid->pos );
+   lua_pushvector(L, v);
+   lua_setfield(L, -2, "pos");
+   vectcpy( &v.vec, &p->solid->vel );
+   lua_pushvector(L, v);
+   lua_setfield(L, -2, "vel");
+
+   return 1;
+}
+
+
 /**
  * @brief Gets the name of the pilot's ship.
  *
@@ -23,6 +23,7 @@
 #include "rng.h"
 #include "land.h"
 #include "map.h"
+#include "nalloc.h"
 
 
 /* Planet metatable methods */
@@ -232,7 +233,7 @@ static int planetL_get( lua_State *L )
    else if (lua_istable(L,1)) {
       /* Get table length and preallocate. */
       nfactions = (int) lua_objlen(L,1);
-      factions = malloc( sizeof(int) * nfactions );
+      factions = nalloc_frame( sizeof(int) * nfactions );
       /* Load up the table. */
       lua_pushnil(L);
       i = 0;
@@ -244,20 +245,15 @@ static int planetL_get( lua_State *L )
       
       /* get the planets */
       planets = space_getFactionPlanet( &nplanets, factions, nfactions );
-      free(factions);
    }
    else NLUA_INVALID_PARAMETER(); /* Bad Parameter */
 
-   /* No suitable planet found */
-   if ((rndplanet == NULL) && (nplanets == 0)) {
-      free(planets);
+   /* No suitable planet found - the planet array is frame memory. */
+   if ((rndplanet == NULL) && (nplanets == 0))
       return 0;
-   }
    /* Pick random planet */
-   else if (rndplanet == NULL) {
+   else if (rndplanet == NULL)
       rndplanet = planets[RNG(0,nplanets-1)];
-      free(planets);
-   }
 
    /* Push the planet */
    planet.p = planet_get(rndplanet); /* The real planet */
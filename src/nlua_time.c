@@ -93,12 +93,13 @@ static int time_get( lua_State *L )
 static int time_str( lua_State *L )
 {
    char *nt;
-   if ((lua_gettop(L) > 0) && (lua_isnumber(L,1)))
+   if ((lua_gettop(L) > 0) && (lua_isnumber(L,1))) {
       nt = ntime_pretty( (unsigned int) lua_tonumber(L,1) );
-   else
-      nt = ntime_pretty( ntime_get() );
-   lua_pushstring(L, nt);
-   free(nt);
+      lua_pushstring(L, nt);
+      free(nt);
+   }
+   else /* Current time comes straight out of the cache. */
+      lua_pushstring(L, ntime_prettyRaw());
    return 1;
 }
 /**
@@ -23,8 +23,12 @@
 
 #include "nlua.h"
 #include "nluadef.h"
+#include "cond.h"
 #include "log.h"
+#include "save.h"
 #include "nxml.h"
+#include "strhash.h"
+#include "intern.h"
 
 
 
@@ -39,22 +43,24 @@
  * @brief Contains a mission variable.
  */
 typedef struct misn_var_ {
-   char* name; /**< Name of the variable. */
+   const char* name; /**< Name of the variable, interned. */
    char type; /**< Type of the variable. */
    union {
       double num; /**< Used if type is number. */
       char* str; /**< Used if type is string. */
       int b; /**< Used if type is boolean. */
    } d; /**< Variable data. */
+   struct misn_var_ *next; /**< Next variable in insertion order. */
 } misn_var;
 
 
 /*
- * variable stack
+ * variable store - a hash for O(1) lookup by name, plus an insertion
+ * ordered list so saves stay deterministic
  */
-static misn_var* var_stack = NULL; /**< Stack of mission variables. */
-static int var_nstack      = 0; /**< Number of mission variables. */
-static int var_mstack      = 0; /**< Memory size of the mission variable stack. */
+static misn_var* var_head  = NULL; /**< First mission variable. */
+static misn_var* var_tail  = NULL; /**< Last mission variable. */
+static StrHash* var_hash   = NULL; /**< Name to variable lookup. */
 
 
 /*
@@ -108,30 +114,31 @@ int nlua_loadVar( lua_State *L, int readonly )
  */
 int var_save( xmlTextWriterPtr writer )
 {
-   int i;
+   misn_var *mv;
 
    xmlw_startElem(writer,"vars");
 
-   for (i=0; i<var_nstack; i++) {
+   /* Insertion order, so identical stores save identically. */
+   for (mv=var_head; mv!=NULL; mv=mv->next) {
       xmlw_startElem(writer,"var");
 
-      xmlw_attr(writer,"name",var_stack[i].name);
+      xmlw_attr(writer,"name",mv->name);
 
-      switch (var_stack[i].type) {
+      switch (mv->type) {
          case MISN_VAR_NIL:
             xmlw_attr(writer,"type","nil");
             break;
          case MISN_VAR_NUM:
             xmlw_attr(writer,"type","num");
-            xmlw_str(writer,"%f",var_stack[i].d.num);
+            xmlw_str(writer,"%f",mv->d.num);
             break;
          case MISN_VAR_BOOL:
             xmlw_attr(writer,"type","bool");
-            xmlw_str(writer,"%d",var_stack[i].d.b);
+            xmlw_str(writer,"%d",mv->d.b);
             break;
          case MISN_VAR_STR:
             xmlw_attr(writer,"type","str");
-            xmlw_str(writer,var_stack[i].d.str);
+            xmlw_str(writer,mv->d.str);
             break;
       }
 
@@ -152,7 +159,7 @@ int var_save( xmlTextWriterPtr writer )
  */
 int var_load( xmlNodePtr parent )
 {
-   char *str;
+   char *str, *name;
    xmlNodePtr node, cur;
    misn_var var;
 
@@ -166,7 +173,9 @@ int var_load( xmlNodePtr parent )
          
          do {
             if (xml_isNode(cur,"var")) {
-               xmlr_attr(cur,"name",var.name);
+               xmlr_attr(cur,"name",name);
+               var.name = str_intern( name );
+               free(name);
                xmlr_attr(cur,"type",str);
                if (strcmp(str,"nil")==0)
                   var.type = MISN_VAR_NIL;
@@ -184,7 +193,6 @@ int var_load( xmlNodePtr parent )
                }
                else { /* super error checking */
                   WARN("Unknown var type '%s'", str);
-                  free(var.name);
                   continue;
                }
                free(str);
@@ -206,23 +214,37 @@ int var_load( xmlNodePtr parent )
  */
 static int var_add( misn_var *new_var )
 {
-   int i;
+   misn_var *mv;
 
-   if (var_nstack+1 > var_mstack) { /* more memory */
-      var_mstack += 64; /* overkill ftw */
-      var_stack = realloc( var_stack, var_mstack * sizeof(misn_var) );
+   save_dirty(SAVE_VAR);
+
+   /* Mission conditions depending on variables must re-evaluate. */
+   cond_invalidate();
+
+   if (var_hash == NULL)
+      var_hash = strhash_create( 128 );
+
+   /* Overwrite in place, keeps the insertion order stable. */
+   mv = strhash_get( var_hash, new_var->name );
+   if (mv != NULL) {
+      var_free( mv );
+      mv->type = new_var->type;
+      mv->d    = new_var->d;
+      return 0;
    }
 
-   /* check if already exists */
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(new_var->name,var_stack[i].name)==0) { /* overwrite */
-         var_free( &var_stack[i] );
-         memcpy( &var_stack[i], new_var, sizeof(misn_var) );
-         return 0;
-      }
-   
-   memcpy( &var_stack[var_nstack], new_var, sizeof(misn_var) );
-   var_nstack++;
+   /* Append to keep the save order deterministic. */
+   mv        = malloc( sizeof(misn_var) );
+   mv->name  = new_var->name;
+   mv->type  = new_var->type;
+   mv->d     = new_var->d;
+   mv->next  = NULL;
+   if (var_tail == NULL)
+      var_head = mv;
+   else
+      var_tail->next = mv;
+   var_tail = mv;
+   strhash_put( var_hash, mv->name, mv );
 
    return 0;
 }
@@ -255,12 +277,9 @@ static int var_add( misn_var *new_var )
  */
 int var_checkflag( char* str )
 {
-   int i;
-
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(var_stack[i].name,str)==0)
-         return 1;
-   return 0;
+   if (var_hash == NULL)
+      return 0;
+   return (strhash_get( var_hash, str ) != NULL);
 }
 /**
  * @brief Gets the mission variable value of a certain name.
@@ -273,30 +292,30 @@ int var_checkflag( char* str )
 static int var_peek( lua_State *L )
 {
    NLUA_MIN_ARGS(1);
-   int i;
+   misn_var *mv;
    const char *str;
 
    /* Get the parameter. */
    str = luaL_checkstring(L,1);
 
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(str,var_stack[i].name)==0) {
-         switch (var_stack[i].type) {
-            case MISN_VAR_NIL:
-               lua_pushnil(L);
-               break;
-            case MISN_VAR_NUM:
-               lua_pushnumber(L,var_stack[i].d.num);
-               break;
-            case MISN_VAR_BOOL:
-               lua_pushboolean(L,var_stack[i].d.b);
-               break;
-            case MISN_VAR_STR:
-               lua_pushstring(L,var_stack[i].d.str);
-               break;
-         }
-         return 1;
+   mv = (var_hash != NULL) ? strhash_get( var_hash, str ) : NULL;
+   if (mv != NULL) {
+      switch (mv->type) {
+         case MISN_VAR_NIL:
+            lua_pushnil(L);
+            break;
+         case MISN_VAR_NUM:
+            lua_pushnumber(L,mv->d.num);
+            break;
+         case MISN_VAR_BOOL:
+            lua_pushboolean(L,mv->d.b);
+            break;
+         case MISN_VAR_STR:
+            lua_pushstring(L,mv->d.str);
+            break;
       }
+      return 1;
+   }
 
    return 0;
 }
@@ -309,18 +328,29 @@ static int var_peek( lua_State *L )
 static int var_pop( lua_State *L )
 {
    NLUA_MIN_ARGS(1);
-   int i;
+   misn_var *mv, *prev;
    const char* str;
 
    str = luaL_checkstring(L,1);
 
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(str,var_stack[i].name)==0) {
-         var_free( &var_stack[i] );
-         memmove( &var_stack[i], &var_stack[i+1], sizeof(misn_var)*(var_nstack-i-1) );
-         var_nstack--;
-         return 0;
-      } 
+   mv = (var_hash != NULL) ? strhash_get( var_hash, str ) : NULL;
+   if (mv != NULL) {
+      /* Unlink - pops are rare, the walk only pays then. */
+      if (var_head == mv)
+         var_head = mv->next;
+      else {
+         for (prev=var_head; prev->next!=mv; prev=prev->next);
+         prev->next = mv->next;
+      }
+      if (var_tail == mv)
+         var_tail = (var_head == NULL) ? NULL : prev;
+      strhash_del( var_hash, mv->name );
+      var_free( mv );
+      free( mv );
+      save_dirty(SAVE_VAR);
+      cond_invalidate();
+      return 0;
+   }
 
    NLUA_DEBUG("Var '%s' not found in stack", str);
    return 0;
@@ -340,7 +370,7 @@ static int var_push( lua_State *L )
    misn_var var;
 
    str = luaL_checkstring(L,1);
-   var.name = strdup(str);
+   var.name = str_intern(str);
    
    /* store appropriate data */
    if (lua_isnil(L,2)) 
@@ -372,6 +402,7 @@ static int var_push( lua_State *L )
  */
 static void var_free( misn_var* var )
 {
+   /* Name is interned, only the string payload is owned. */
    switch (var->type) {
       case MISN_VAR_STR:
          if (var->d.str!=NULL) {
@@ -384,25 +415,29 @@ static void var_free( misn_var* var )
       case MISN_VAR_BOOL:
          break;
    }
-
-   if (var->name!=NULL) {
-      free(var->name);
-      var->name = NULL;
-   }
 }
 /**
  * @brief Cleans up all the mission variables.
  */
 void var_cleanup (void)
 {
-   int i;
-   for (i=0; i<var_nstack; i++)
-      var_free( &var_stack[i] );
-
-   if (var_stack!=NULL)
-      free( var_stack );
-   var_stack   = NULL;
-   var_nstack  = 0;
-   var_mstack  = 0;
+   misn_var *mv, *next;
+
+   save_dirty(SAVE_VAR);
+
+   for (mv=var_head; mv!=NULL; mv=next) {
+      next = mv->next;
+      var_free( mv );
+      free( mv );
+   }
+   var_head = NULL;
+   var_tail = NULL;
+
+   if (var_hash != NULL) {
+      strhash_destroy( var_hash );
+      var_hash = NULL;
+   }
+
+   cond_invalidate();
 }
 
@@ -21,7 +21,19 @@
 #include "log.h"
 
 
+/*
+ * AI scripts churn through thousands of temporary vectors per second, so
+ *  dying vectors are resurrected from __gc into a free list kept in the
+ *  metatable and lua_pushvector() pops from it before asking the
+ *  allocator.  Pooled vectors already carry the metatable, which also
+ *  skips the registry lookup and setmetatable on reuse.
+ */
+#define VECTOR_POOL_KEY "__pool" /**< Free list field in the metatable. */
+#define VECTOR_POOL_MAX 128 /**< Dead vectors kept for reuse per state. */
+
+
 /* Vector metatable methods */
+static int vectorL_gc( lua_State *L );
 static int vectorL_new( lua_State *L );
 static int vectorL_add( lua_State *L );
 static int vectorL_sub( lua_State *L );
@@ -67,6 +79,13 @@ int nlua_loadVector( lua_State *L )
    /* Register the values */
    luaL_register(L, NULL, vector_methods);
 
+   /* Set up the free list.  __gc must be in place before the first
+    *  userdata gets the metatable or it never gets finalized. */
+   lua_newtable(L);
+   lua_setfield(L, -2, VECTOR_POOL_KEY);
+   lua_pushcfunction(L, vectorL_gc);
+   lua_setfield(L, -2, "__gc");
+
    /* Clean up. */
    lua_setfield(L, LUA_GLOBALSINDEX, VECTOR_METATABLE);
 
@@ -74,6 +93,28 @@ int nlua_loadVector( lua_State *L )
 }
 
 
+/**
+ * @brief Resurrects a dying vector into the metatable's free list.
+ *
+ *    @param L Lua state to run the finalizer in.
+ *    @return Number of return values (0).
+ */
+static int vectorL_gc( lua_State *L )
+{
+   int n;
+
+   lua_getmetatable(L, 1);             /* ud, mt */
+   lua_getfield(L, -1, VECTOR_POOL_KEY); /* ud, mt, pool */
+   n = (int) lua_objlen(L, -1);
+   if (n < VECTOR_POOL_MAX) {
+      lua_pushvalue(L, 1);             /* ud, mt, pool, ud */
+      lua_rawseti(L, -2, n+1);         /* pool[n+1] = ud */
+   }
+   lua_pop(L, 2);
+   return 0;
+}
+
+
 /**
  * @defgroup META_VECTOR Vector Metatable
  *
@@ -132,10 +173,27 @@ LuaVector* luaL_checkvector( lua_State *L, int ind )
 LuaVector* lua_pushvector( lua_State *L, LuaVector vec )
 {
    LuaVector *v;
-   v = (LuaVector*) lua_newuserdata(L, sizeof(LuaVector));
+   int n;
+
+   /* Reuse a pooled vector when one is available. */
+   luaL_getmetatable(L, VECTOR_METATABLE); /* mt */
+   lua_getfield(L, -1, VECTOR_POOL_KEY);   /* mt, pool */
+   n = (int) lua_objlen(L, -1);
+   if (n > 0) {
+      lua_rawgeti(L, -1, n);               /* mt, pool, ud */
+      lua_pushnil(L);
+      lua_rawseti(L, -3, n);               /* pool[n] = nil */
+      lua_replace(L, -3);                  /* ud, pool */
+      lua_pop(L, 1);                       /* ud */
+      v = (LuaVector*) lua_touserdata(L, -1);
+   }
+   else {
+      lua_pop(L, 2);
+      v = (LuaVector*) lua_newuserdata(L, sizeof(LuaVector));
+      luaL_getmetatable(L, VECTOR_METATABLE);
+      lua_setmetatable(L, -2);
+   }
    *v = vec;
-   luaL_getmetatable(L, VECTOR_METATABLE);
-   lua_setmetatable(L, -2);
    return v;
 }
 
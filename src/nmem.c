@@ -0,0 +1,198 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file nmem.c
+ *
+ * @brief Per-subsystem memory accounting.
+ *
+ * Subsystems either allocate through the tagged wrappers - which prepend
+ *  a small header so nmem_free() knows the tag and size - or report sizes
+ *  manually with nmem_count() for memory that can't change allocator
+ *  (texture estimates, the Lua pools, preexisting slab allocators).
+ *
+ * The counters are plain longs updated without locking: they are
+ *  statistics, and the rare concurrent update from another thread is an
+ *  acceptable error for not paying a mutex on every allocation.
+ */
+
+#include "nmem.h"
+
+#include "naev.h"
+
+#include "log.h"
+
+
+/**
+ * @struct MemStat
+ *
+ * @brief Counters of a single tag.
+ */
+typedef struct MemStat_ {
+   const char *name; /**< Tag name for reports. */
+   long bytes;       /**< Live bytes. */
+   long peak;        /**< Peak live bytes. */
+   long allocs;      /**< Live allocation count. */
+} MemStat;
+
+
+/**
+ * @union NMemHeader
+ *
+ * @brief Header the wrappers prepend, sized to keep the block aligned.
+ */
+typedef union NMemHeader_ {
+   struct {
+      size_t size; /**< Size of the user block. */
+      int tag;     /**< MemTag of the allocation. */
+   } info;
+   double pad[2]; /**< Forces the alignment of the user block. */
+} NMemHeader;
+
+
+static MemStat nmem_stats[MEM_MAX] = {
+   { "pilot",   0, 0, 0 },
+   { "weapon",  0, 0, 0 },
+   { "texture", 0, 0, 0 },
+   { "lua",     0, 0, 0 },
+   { "toolkit", 0, 0, 0 },
+   { "frame",   0, 0, 0 }
+}; /**< All the counters. */
+
+
+/**
+ * @brief Allocates a tagged block.
+ *
+ *    @param tag Tag to account the block under.
+ *    @param size Size to allocate.
+ *    @return The block or NULL on failure.
+ */
+void* nmem_alloc( MemTag tag, size_t size )
+{
+   NMemHeader *h;
+
+   h = malloc( sizeof(NMemHeader) + size );
+   if (h == NULL)
+      return NULL;
+   h->info.size = size;
+   h->info.tag  = tag;
+   nmem_count( tag, (long)size, +1 );
+   return h+1;
+}
+
+
+/**
+ * @brief Reallocates a tagged block.
+ *
+ *    @param tag Tag to account the block under.
+ *    @param ptr Block allocated by nmem_alloc() or NULL.
+ *    @param size New size.
+ *    @return The block or NULL on failure.
+ */
+void* nmem_realloc( MemTag tag, void *ptr, size_t size )
+{
+   NMemHeader *h;
+
+   if (ptr == NULL)
+      return nmem_alloc( tag, size );
+
+   h = ((NMemHeader*)ptr) - 1;
+   nmem_count( h->info.tag, -(long)h->info.size, 0 );
+   h = realloc( h, sizeof(NMemHeader) + size );
+   if (h == NULL)
+      return NULL;
+   h->info.size = size;
+   h->info.tag  = tag;
+   nmem_count( tag, (long)size, 0 );
+   return h+1;
+}
+
+
+/**
+ * @brief Frees a tagged block.
+ *
+ *    @param ptr Block allocated by nmem_alloc(), may be NULL.
+ */
+void nmem_free( void *ptr )
+{
+   NMemHeader *h;
+
+   if (ptr == NULL)
+      return;
+   h = ((NMemHeader*)ptr) - 1;
+   nmem_count( h->info.tag, -(long)h->info.size, -1 );
+   free(h);
+}
+
+
+/**
+ * @brief Adjusts a tag's counters directly.
+ *
+ *    @param tag Tag to adjust.
+ *    @param bytes Bytes to add (may be negative).
+ *    @param allocs Allocations to add (may be negative).
+ */
+void nmem_count( MemTag tag, long bytes, int allocs )
+{
+   MemStat *s;
+
+   s = &nmem_stats[tag];
+   s->bytes  += bytes;
+   s->allocs += allocs;
+   if (s->bytes > s->peak)
+      s->peak = s->bytes;
+}
+
+
+/**
+ * @brief Gets the name of a tag.
+ */
+const char* nmem_tagName( MemTag tag )
+{
+   return nmem_stats[tag].name;
+}
+
+
+/**
+ * @brief Gets the live bytes of a tag.
+ */
+long nmem_bytes( MemTag tag )
+{
+   return nmem_stats[tag].bytes;
+}
+
+
+/**
+ * @brief Gets the peak live bytes of a tag.
+ */
+long nmem_peak( MemTag tag )
+{
+   return nmem_stats[tag].peak;
+}
+
+
+/**
+ * @brief Gets the live allocation count of a tag.
+ */
+long nmem_allocs( MemTag tag )
+{
+   return nmem_stats[tag].allocs;
+}
+
+
+/**
+ * @brief Dumps the counters, run on exit.
+ *
+ * Live bytes at exit point at leaks, peaks at where pooling pays off.
+ */
+void nmem_exit (void)
+{
+   int i;
+
+   DEBUG("Memory accounting:");
+   for (i=0; i<MEM_MAX; i++)
+      DEBUG("   %-8s %8ld KiB live, %8ld KiB peak, %6ld allocs",
+            nmem_stats[i].name, nmem_stats[i].bytes/1024,
+            nmem_stats[i].peak/1024, nmem_stats[i].allocs );
+}
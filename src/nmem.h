@@ -0,0 +1,48 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef NMEM_H
+#  define NMEM_H
+
+
+#include <stdlib.h>
+
+
+/**
+ * @enum MemTag
+ *
+ * @brief Subsystems tracked by the memory accounting.
+ */
+typedef enum MemTag_ {
+   MEM_PILOT = 0, /**< Pilot slabs and friends. */
+   MEM_WEAPON,    /**< Weapon slabs and layers. */
+   MEM_TEXTURE,   /**< Estimated VRAM of loaded textures. */
+   MEM_LUA,       /**< Lua states (pool and big blocks). */
+   MEM_TOOLKIT,   /**< Toolkit windows and widgets. */
+   MEM_FRAME,     /**< Frame-scoped arena blocks. */
+   MEM_MAX        /**< Sentinel. */
+} MemTag;
+
+
+/* Tagged wrappers, nmem_free() recovers the tag itself. */
+void* nmem_alloc( MemTag tag, size_t size );
+void* nmem_realloc( MemTag tag, void *ptr, size_t size );
+void nmem_free( void *ptr );
+
+/* Manual accounting for memory that never goes through the wrappers. */
+void nmem_count( MemTag tag, long bytes, int allocs );
+
+/* Queries. */
+const char* nmem_tagName( MemTag tag );
+long nmem_bytes( MemTag tag );
+long nmem_peak( MemTag tag );
+long nmem_allocs( MemTag tag );
+
+/* Exit dump. */
+void nmem_exit (void);
+
+
+#endif /* NMEM_H */
@@ -0,0 +1,419 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file nthread.c
+ *
+ * @brief Shared concurrency primitives for the engine subsystems.
+ *
+ * Everything threaded in the engine used to hand-roll its own plumbing
+ *  on raw SDL threads - the music command ring, the background nebula
+ *  generator, the async savegame write.  This module collects the
+ *  recurring shapes in one place: portable atomics, an SPSC ring, a
+ *  counting event and one-shot task handles.  All of it is buildable on
+ *  anything SDL threads run on; the atomics use the GCC __sync builtins
+ *  when available and degrade to a shared mutex elsewhere.
+ */
+
+
+#include "nthread.h"
+
+#include "naev.h"
+
+#include <stdlib.h>
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "log.h"
+
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define NTHREAD_GCC_SYNC 1 /**< Compiler has the __sync atomic builtins. */
+#else
+#define NTHREAD_GCC_SYNC 0
+#endif
+
+
+#if !NTHREAD_GCC_SYNC
+static SDL_mutex *natomic_lock = NULL; /**< Fallback lock for the atomics. */
+#endif /* !NTHREAD_GCC_SYNC */
+
+
+/**
+ * @brief An SPSC ring of ints.
+ */
+struct NRing_ {
+   int *slots; /**< The queued values. */
+   unsigned int size; /**< Number of slots, power of two. */
+   volatile unsigned int head; /**< Write index, producer only. */
+   volatile unsigned int tail; /**< Read index, consumer only. */
+};
+
+/**
+ * @brief A counting wakeup between two threads.
+ */
+struct NEvent_ {
+   SDL_sem *sem; /**< Does all the actual work. */
+};
+
+/**
+ * @brief A one-shot background function in flight.
+ */
+struct NTask_ {
+   int (*func)( void* ); /**< Function being run. */
+   void *data; /**< Data passed to the function. */
+   int ret; /**< Its return value, valid once done is set. */
+   natomic_t done; /**< Set by the worker after ret is written. */
+   SDL_Thread *thread; /**< The thread running it. */
+};
+
+
+/*
+ * prototypes
+ */
+static int ntask_thread( void *data );
+
+
+/**
+ * @brief Initializes the concurrency primitives.
+ *
+ *    @return 0 on success.
+ */
+int nthread_init (void)
+{
+#if !NTHREAD_GCC_SYNC
+   natomic_lock = SDL_CreateMutex();
+   if (natomic_lock == NULL) {
+      WARN("Unable to create atomic fallback lock.");
+      return -1;
+   }
+#endif /* !NTHREAD_GCC_SYNC */
+   return 0;
+}
+
+
+/**
+ * @brief Cleans up the concurrency primitives.
+ */
+void nthread_exit (void)
+{
+#if !NTHREAD_GCC_SYNC
+   if (natomic_lock != NULL) {
+      SDL_DestroyMutex( natomic_lock );
+      natomic_lock = NULL;
+   }
+#endif /* !NTHREAD_GCC_SYNC */
+}
+
+
+/**
+ * @brief Atomically adds to an atomic int.
+ *
+ *    @param a Atomic to add to.
+ *    @param v Value to add.
+ *    @return The new value.
+ */
+int natomic_add( natomic_t *a, int v )
+{
+#if NTHREAD_GCC_SYNC
+   return __sync_add_and_fetch( a, v );
+#else
+   int n;
+   SDL_mutexP( natomic_lock );
+   n = (*a += v);
+   SDL_mutexV( natomic_lock );
+   return n;
+#endif /* NTHREAD_GCC_SYNC */
+}
+
+
+/**
+ * @brief Atomically reads an atomic int.
+ *
+ *    @param a Atomic to read.
+ *    @return Its current value.
+ */
+int natomic_get( natomic_t *a )
+{
+#if NTHREAD_GCC_SYNC
+   __sync_synchronize();
+   return *a;
+#else
+   int n;
+   SDL_mutexP( natomic_lock );
+   n = *a;
+   SDL_mutexV( natomic_lock );
+   return n;
+#endif /* NTHREAD_GCC_SYNC */
+}
+
+
+/**
+ * @brief Atomically writes an atomic int.
+ *
+ *    @param a Atomic to write.
+ *    @param v Value to write.
+ */
+void natomic_set( natomic_t *a, int v )
+{
+#if NTHREAD_GCC_SYNC
+   *a = v;
+   __sync_synchronize();
+#else
+   SDL_mutexP( natomic_lock );
+   *a = v;
+   SDL_mutexV( natomic_lock );
+#endif /* NTHREAD_GCC_SYNC */
+}
+
+
+/**
+ * @brief Atomic compare and swap.
+ *
+ *    @param a Atomic to swap.
+ *    @param oldval Value it must currently hold.
+ *    @param newval Value to swap in.
+ *    @return 1 if the swap happened.
+ */
+int natomic_cas( natomic_t *a, int oldval, int newval )
+{
+#if NTHREAD_GCC_SYNC
+   return __sync_bool_compare_and_swap( a, oldval, newval );
+#else
+   int swapped;
+   SDL_mutexP( natomic_lock );
+   swapped = (*a == oldval);
+   if (swapped)
+      *a = newval;
+   SDL_mutexV( natomic_lock );
+   return swapped;
+#endif /* NTHREAD_GCC_SYNC */
+}
+
+
+/**
+ * @brief Creates an SPSC ring.
+ *
+ *    @param size Minimum number of slots, rounded up to a power of two.
+ *    @return The ring or NULL on failure.
+ */
+NRing* nring_create( int size )
+{
+   NRing *r;
+   unsigned int n;
+
+   n = 1;
+   while (n < (unsigned int)size)
+      n <<= 1;
+
+   r = malloc(sizeof(NRing));
+   if (r == NULL)
+      return NULL;
+   r->slots = malloc( sizeof(int) * n );
+   if (r->slots == NULL) {
+      free(r);
+      return NULL;
+   }
+   r->size = n;
+   r->head = 0;
+   r->tail = 0;
+   return r;
+}
+
+
+/**
+ * @brief Destroys an SPSC ring.
+ *
+ *    @param r Ring to destroy.
+ */
+void nring_destroy( NRing *r )
+{
+   if (r == NULL)
+      return;
+   free(r->slots);
+   free(r);
+}
+
+
+/**
+ * @brief Pushes a value, producer thread only.
+ *
+ *    @param r Ring to push onto.
+ *    @param v Value to push.
+ *    @return 0 on success, -1 when the ring is full.
+ */
+int nring_push( NRing *r, int v )
+{
+   if (r->head - r->tail >= r->size)
+      return -1;
+   r->slots[ r->head & (r->size-1) ] = v;
+#if NTHREAD_GCC_SYNC
+   __sync_synchronize(); /* value lands before the head moves */
+#endif /* NTHREAD_GCC_SYNC */
+   r->head = r->head + 1;
+   return 0;
+}
+
+
+/**
+ * @brief Pops a value, consumer thread only.
+ *
+ *    @param r Ring to pop from.
+ *    @param[out] v Popped value.
+ *    @return 0 on success, -1 when the ring is empty.
+ */
+int nring_pop( NRing *r, int *v )
+{
+   if (r->tail == r->head)
+      return -1;
+   *v = r->slots[ r->tail & (r->size-1) ];
+   r->tail = r->tail + 1;
+   return 0;
+}
+
+
+/**
+ * @brief Checks whether the ring is empty.
+ *
+ * Safe from either side, though the answer can of course go stale the
+ *  moment the other thread moves.
+ *
+ *    @param r Ring to check.
+ *    @return 1 when the ring holds no values.
+ */
+int nring_empty( const NRing *r )
+{
+   return (r->tail == r->head);
+}
+
+
+/**
+ * @brief Creates an event.
+ *
+ *    @return The event or NULL on failure.
+ */
+NEvent* nevent_create (void)
+{
+   NEvent *e;
+
+   e = malloc(sizeof(NEvent));
+   if (e == NULL)
+      return NULL;
+   e->sem = SDL_CreateSemaphore( 0 );
+   if (e->sem == NULL) {
+      free(e);
+      return NULL;
+   }
+   return e;
+}
+
+
+/**
+ * @brief Destroys an event.
+ *
+ *    @param e Event to destroy.
+ */
+void nevent_destroy( NEvent *e )
+{
+   if (e == NULL)
+      return;
+   SDL_DestroySemaphore( e->sem );
+   free(e);
+}
+
+
+/**
+ * @brief Signals an event, waking one waiter.
+ *
+ *    @param e Event to signal.
+ */
+void nevent_signal( NEvent *e )
+{
+   SDL_SemPost( e->sem );
+}
+
+
+/**
+ * @brief Waits on an event, consuming one signal.
+ *
+ *    @param e Event to wait on.
+ */
+void nevent_wait( NEvent *e )
+{
+   SDL_SemWait( e->sem );
+}
+
+
+/**
+ * @brief Trampoline that runs the task and publishes its result.
+ *
+ *    @param data The task.
+ *    @return The task function's result.
+ */
+static int ntask_thread( void *data )
+{
+   NTask *t = data;
+
+   t->ret = t->func( t->data );
+   natomic_set( &t->done, 1 ); /* ret is visible before done. */
+   return t->ret;
+}
+
+
+/**
+ * @brief Starts a one-shot background task.
+ *
+ *    @param func Function to run on the worker.
+ *    @param data Data to pass it.
+ *    @return The task handle, or NULL if no thread could be created -
+ *            the caller should then just run the work inline.
+ */
+NTask* ntask_start( int (*func)(void*), void *data )
+{
+   NTask *t;
+
+   t = malloc(sizeof(NTask));
+   if (t == NULL)
+      return NULL;
+   t->func   = func;
+   t->data   = data;
+   t->ret    = 0;
+   t->done   = 0;
+   t->thread = SDL_CreateThread( ntask_thread, t );
+   if (t->thread == NULL) {
+      free(t);
+      return NULL;
+   }
+   return t;
+}
+
+
+/**
+ * @brief Polls whether a task has finished.
+ *
+ *    @param t Task to poll.
+ *    @return 1 when the task function has returned.
+ */
+int ntask_done( NTask *t )
+{
+   return natomic_get( &t->done );
+}
+
+
+/**
+ * @brief Joins a task and frees its handle.
+ *
+ *    @param t Task to join.
+ *    @return The task function's result.
+ */
+int ntask_wait( NTask *t )
+{
+   int ret;
+
+   SDL_WaitThread( t->thread, NULL );
+   ret = t->ret;
+   free(t);
+   return ret;
+}
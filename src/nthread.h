@@ -0,0 +1,63 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef NTHREAD_H
+#  define NTHREAD_H
+
+
+/*
+ * Init/exit.
+ */
+int nthread_init (void);
+void nthread_exit (void);
+
+
+/*
+ * Atomics.
+ *
+ * Plain ints with atomic read-modify-write; on GCC they compile to the
+ *  __sync builtins, elsewhere they fall back to a shared mutex.
+ */
+typedef volatile int natomic_t;
+int natomic_add( natomic_t *a, int v ); /* returns the new value */
+int natomic_get( natomic_t *a );
+void natomic_set( natomic_t *a, int v );
+int natomic_cas( natomic_t *a, int oldval, int newval ); /* 1 on swap */
+
+
+/*
+ * Single-producer single-consumer ring of ints.
+ *
+ * Lock free - each index is only ever written by one thread and the
+ *  values are written before the head advances.
+ */
+typedef struct NRing_ NRing;
+NRing* nring_create( int size );
+void nring_destroy( NRing *r );
+int nring_push( NRing *r, int v ); /* 0 on success, -1 when full */
+int nring_pop( NRing *r, int *v ); /* 0 on success, -1 when empty */
+int nring_empty( const NRing *r );
+
+
+/*
+ * Event - a counting wakeup between two threads.
+ */
+typedef struct NEvent_ NEvent;
+NEvent* nevent_create (void);
+void nevent_destroy( NEvent *e );
+void nevent_signal( NEvent *e );
+void nevent_wait( NEvent *e ); /* blocks until signalled, consumes one */
+
+
+/*
+ * Task handles - one-shot background functions you can poll or join.
+ */
+typedef struct NTask_ NTask;
+NTask* ntask_start( int (*func)(void*), void *data );
+int ntask_done( NTask *t ); /* non-blocking poll */
+int ntask_wait( NTask *t ); /* joins, frees the handle, returns func's result */
+
+
+#endif /* NTHREAD_H */
@@ -27,6 +27,7 @@
 
 #include "hook.h"
 #include "economy.h"
+#include "cond.h"
 
 
 /**
@@ -42,6 +43,20 @@ static NTimeUpdate_t *ntime_inclist = NULL; /**< Time increment list. */
 
 static unsigned int naev_time = 0; /**< Contains the current time in mSTU. */
 
+/*
+ * Cached formatting of the current time, it changes at most once per
+ *  game-time tick while callers ask for it far more often.
+ */
+static char ntime_prettyBuf[128]; /**< Formatted current time. */
+static unsigned int ntime_prettyTime = 0; /**< Time the cache was built for. */
+static int ntime_prettyValid = 0; /**< Cache holds a formatted string. */
+
+
+/*
+ * Prototypes.
+ */
+static void ntime_format( char *str, int len, unsigned int nt );
+
 
 /**
  * @brief Gets the current time.
@@ -55,31 +70,61 @@ unsigned int ntime_get (void)
 
 
 /**
- * @brief Gets the time in a pretty human readable format.
+ * @brief Formats a time into a human readable string.
  *
- *    @param t Time to print (in STU), if 0 it'll use the current time.
- *    @return The time in a human readable format (must free).
+ *    @param str Buffer to format into.
+ *    @param len Length of str.
+ *    @param nt Time to format (in STU).
  */
-char* ntime_pretty( unsigned int t )
+static void ntime_format( char *str, int len, unsigned int nt )
 {
-   unsigned int nt;
    int mtu, stu;
-   char str[128], *ret;
-
-   if (t==0) nt = naev_time;
-   else nt = t;
 
    /* UST (Universal Synchronized Time) - unit is STU (Synchronized Time Unit) */
    mtu = nt / (1000*NTIME_UNIT_LENGTH);
    stu = (nt / (NTIME_UNIT_LENGTH)) % 1000;
    if (mtu == 0) /* only STU */
-      snprintf( str, 128, "%03d STU", stu );
+      snprintf( str, len, "%03d STU", stu );
    else /* UST format */
-      snprintf( str, 128, "UST %d.%03d", mtu, stu );
+      snprintf( str, len, "UST %d.%03d", mtu, stu );
+}
+
+
+/**
+ * @brief Gets the current time formatted, returning a borrowed string.
+ *
+ * Only reformats when the time actually changed, so it's cheap to call
+ *  every frame.  Do not free and do not hold across time changes.
+ *
+ *    @return The current time in a human readable format (do not free).
+ */
+const char* ntime_prettyRaw (void)
+{
+   if (!ntime_prettyValid || (ntime_prettyTime != naev_time)) {
+      ntime_format( ntime_prettyBuf, sizeof(ntime_prettyBuf), naev_time );
+      ntime_prettyTime  = naev_time;
+      ntime_prettyValid = 1;
+   }
+   return ntime_prettyBuf;
+}
+
+
+/**
+ * @brief Gets the time in a pretty human readable format.
+ *
+ *    @param t Time to print (in STU), if 0 it'll use the current time.
+ *    @return The time in a human readable format (must free).
+ */
+char* ntime_pretty( unsigned int t )
+{
+   char str[128];
 
-   ret = strdup(str);
+   /* The current time comes out of the cache. */
+   if ((t==0) || (t==naev_time))
+      return strdup( ntime_prettyRaw() );
 
-   return ret;
+   ntime_format( str, sizeof(str), t );
+   return strdup(str);
 }
 
 
@@ -91,6 +136,7 @@ char* ntime_pretty( unsigned int t )
 void ntime_set( unsigned int t )
 {
    naev_time = t;
+   cond_invalidate();
 }
 
 
@@ -102,6 +148,7 @@ void ntime_set( unsigned int t )
 void ntime_inc( unsigned int t )
 {
    naev_time += t;
+   cond_invalidate();
    hooks_run("time");
    economy_update( t );
 }
@@ -151,6 +198,7 @@ void ntime_refresh (void)
 
       /* Run hook stuff and actually update time. */
       naev_time += ntu->inc;
+      cond_invalidate();
       hooks_run("time");
       economy_update( ntu->inc );
 
@@ -13,6 +13,7 @@
 /* get */
 unsigned int ntime_get (void);
 char* ntime_pretty( unsigned int t );
+const char* ntime_prettyRaw (void); /* borrowed, do not free */
 
 /* set */
 void ntime_set( unsigned int t );
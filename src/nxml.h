@@ -30,6 +30,11 @@
 /* gets the property s of node n. WARNING: MALLOCS! */
 #define xml_nodeProp(n,s)     (char*)xmlGetProp(n,(xmlChar*)s)
 
+/* parses a whole buffer, dropping ignorable blank text nodes so the
+ * transient DOM trees built during loading stay small */
+#define xml_parseMemory(b,s)  \
+   xmlReadMemory( (b), (s), NULL, NULL, XML_PARSE_NOBLANKS )
+
 /* get data different ways */
 #define xml_raw(n)            ((char*)(n)->children->content)
 #define xml_get(n)            (((n)->children == NULL) ? NULL : (char*)(n)->children->content)
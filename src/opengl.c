@@ -43,6 +43,7 @@
 
 #include "SDL.h"
 #include "SDL_image.h"
+#include "SDL_thread.h"
 #include "SDL_version.h"
 
 #include "log.h"
@@ -76,6 +77,9 @@ static int gl_hint (void);
 /* png */
 static int write_png( const char *file_name, png_bytep *rows,
       int w, int h, int colourtype, int bitdepth );
+/* screenshots */
+static int gl_screenshotThread( void *data );
+static void gl_screenshotJoin( int slot );
 
 
 /*
@@ -83,29 +87,91 @@ static int write_png( const char *file_name, png_bytep *rows,
  * M I S C
  *
  */
+/**
+ * @brief A screenshot being encoded and written on a worker thread.
+ */
+typedef struct glScreenshot_ {
+   char *filename; /**< Path to write to. */
+   unsigned char *pixels; /**< Pixel data read back from the framebuffer. */
+   int w; /**< Width of the capture. */
+   int h; /**< Height of the capture. */
+   SDL_Thread *thread; /**< Encoder thread, NULL if the slot is free. */
+} glScreenshot;
+static glScreenshot gl_ss[2]; /**< Double buffered so rapid captures overlap. */
+static int gl_ss_cur = 0; /**< Next slot to use. */
+
+
+/**
+ * @brief Worker side of a screenshot, the PNG encode and disk write.
+ */
+static int gl_screenshotThread( void *data )
+{
+   glScreenshot *ss = (glScreenshot*) data;
+   png_bytep *rows;
+   int i;
+
+   /* Rows are bottom-up in GL, flip while building the row pointers. */
+   rows = malloc( ss->h * sizeof(png_bytep) );
+   for (i = 0; i < ss->h; i++)
+      rows[i] = &ss->pixels[ (ss->h - i - 1) * ss->w * 4 ];
+
+   write_png( ss->filename, rows, ss->w, ss->h, PNG_COLOR_TYPE_RGBA, 8 );
+
+   free(rows);
+   return 0;
+}
+
+
+/**
+ * @brief Waits on a screenshot slot's worker and frees its buffers.
+ */
+static void gl_screenshotJoin( int slot )
+{
+   if (gl_ss[slot].thread == NULL)
+      return;
+
+   SDL_WaitThread( gl_ss[slot].thread, NULL );
+   gl_ss[slot].thread = NULL;
+   free( gl_ss[slot].pixels );
+   free( gl_ss[slot].filename );
+}
+
+
 /**
  * @brief Takes a screenshot.
  *
+ * The framebuffer readback happens immediately, but the PNG encode and
+ *  write go to a worker thread so the frame barely hitches.  Two captures
+ *  may be in flight at once; a third waits on the oldest.
+ *
  *    @param filename Name of the file to save screenshot as.
  */
 void gl_screenshot( const char *filename )
 {
    SDL_Surface *screen = SDL_GetVideoSurface();
-   unsigned rowbytes = screen->w * 4;
-   unsigned char screenbuf[screen->h][rowbytes], *rows[screen->h];
-   int i;
+   glScreenshot *ss;
 
-   /* Read pixels from buffer -- SLOW. */
-   glReadPixels( 0, 0, screen->w, screen->h,
-         GL_RGBA, GL_UNSIGNED_BYTE, screenbuf );
+   /* Reuse the older slot, waiting on it if it's still encoding. */
+   gl_ss_cur = 1 - gl_ss_cur;
+   gl_screenshotJoin( gl_ss_cur );
+   ss = &gl_ss[gl_ss_cur];
 
-   /* Convert data. */
-   for (i = 0; i < screen->h; i++)
-      rows[i] = screenbuf[screen->h - i - 1];
+   ss->w        = screen->w;
+   ss->h        = screen->h;
+   ss->pixels   = malloc( screen->w * screen->h * 4 );
+   ss->filename = strdup( filename );
 
-   /* Save PNG. */
-   write_png( filename, rows, screen->w, screen->h,
-         PNG_COLOR_TYPE_RGBA, 8);
+   /* Read pixels from buffer -- SLOW, must happen on the GL thread. */
+   glReadPixels( 0, 0, screen->w, screen->h,
+         GL_RGBA, GL_UNSIGNED_BYTE, ss->pixels );
+
+   /* Hand off to the encoder. */
+   ss->thread = SDL_CreateThread( gl_screenshotThread, ss );
+   if (ss->thread == NULL) { /* Do it inline then. */
+      gl_screenshotThread( ss );
+      free( ss->pixels );
+      free( ss->filename );
+   }
 
    /* Check to see if an error occured. */
    gl_checkErr();
@@ -670,6 +736,51 @@ int gl_init (void)
 }
 
 
+/**
+ * @brief Changes the video mode at runtime.
+ *
+ * Re-creates the SDL surface and then bulk re-uploads every live texture
+ *  through gl_reloadTextures(), so a mode switch takes a fraction of a
+ *  second instead of everybody reloading through the full decode path.
+ *
+ *    @param width New screen width.
+ *    @param height New screen height.
+ *    @param fullscreen Whether to use fullscreen.
+ *    @return 0 on success.
+ */
+int gl_setVideoMode( const int width, const int height, const int fullscreen )
+{
+   unsigned int flags;
+
+   flags       = SDL_OPENGL;
+   gl_screen.w = width;
+   gl_screen.h = height;
+   if (fullscreen) {
+      gl_screen.flags |= OPENGL_FULLSCREEN;
+      flags |= SDL_FULLSCREEN;
+   }
+   else
+      gl_screen.flags &= ~OPENGL_FULLSCREEN;
+
+   /* Re-create the window. */
+   if (gl_createWindow( flags ))
+      return -1;
+
+   /* The GL context may have been lost with the old surface. */
+   glClearColor( 0., 0., 0., 1. );
+   gl_defState();
+   gl_setupScaling();
+   gl_defViewport();
+   gl_hint();
+
+   /* Bulk re-upload everything that was resident. */
+   gl_reloadTextures();
+
+   gl_checkErr();
+   return 0;
+}
+
+
 /**
  * @brief Sets the scale factor.
  *
@@ -708,6 +819,10 @@ void gl_defViewport (void)
  */
 void gl_exit (void)
 {
+   /* Let pending screenshot writes finish. */
+   gl_screenshotJoin(0);
+   gl_screenshotJoin(1);
+
    /* Exit the OpenGL subsystems. */
    gl_exitRender();
    gl_exitVBO();
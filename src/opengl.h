@@ -90,6 +90,7 @@ extern glInfo gl_screen; /* local structure set with gl_init and co */
  * initialization / cleanup
  */
 int gl_init (void);
+int gl_setVideoMode( const int width, const int height, const int fullscreen );
 void gl_exit (void);
 
 
@@ -28,37 +28,104 @@
 
 #include "opengl.h"
 
+#include <stdlib.h>
+
 #include "naev.h"
 
 #include "log.h"
+#include "conf.h"
+#include "count.h"
 #include "ndata.h"
 #include "gui.h"
 
 
 #define OPENGL_RENDER_VBO_SIZE      256 /**< Size of VBO. */
 
+#define OPENGL_BATCH_QUADS          512 /**< Maximum sprites per batch draw. */
+#define OPENGL_BATCH_CHUNK          256 /**< Chunks to increment batch by. */
+
 
-static Vector2d* gl_camera  = NULL; /**< Camera we are using. */
+static Solid* gl_camera     = NULL; /**< Solid the camera is following. */
 static double gl_cameraZ    = 1.; /**< Current in-game zoom. */
 static double gl_cameraX    = 0.; /**< X position of camera. */
 static double gl_cameraY    = 0.; /**< Y position of camera. */
+static double gl_frameX     = 0.; /**< Camera X cached for the frame. */
+static double gl_frameY     = 0.; /**< Camera Y cached for the frame. */
+static double gl_frameGX    = 0.; /**< GUI offset X cached for the frame. */
+static double gl_frameGY    = 0.; /**< GUI offset Y cached for the frame. */
 static gl_vbo *gl_renderVBO = 0; /**< VBO for rendering stuff. */
 static int gl_renderVBOtexOffset = 0; /**< VBO texture offset. */
+static int gl_renderVBOtex2Offset = 0; /**< VBO second texture offset. */
 static int gl_renderVBOcolOffset = 0; /**< VBO colour offset. */
 
 
+/**
+ * @brief A sprite accumulated for batched rendering.
+ */
+typedef struct glBatchSprite_ {
+   const glTexture *ta; /**< Texture to use. */
+   const glTexture *tb; /**< Interpolation texture or NULL. */
+   double inter; /**< Amount of interpolation when tb is set. */
+   double x; /**< X position on screen. */
+   double y; /**< Y position on screen. */
+   double w; /**< Width on screen. */
+   double h; /**< Height on screen. */
+   double tx; /**< X position within the texture. */
+   double ty; /**< Y position within the texture. */
+   glColour c; /**< Colour to use. */
+} glBatchSprite;
+
+static glBatchSprite *gl_batch = NULL; /**< Accumulated batch sprites. */
+static int gl_nbatch    = 0; /**< Number of accumulated batch sprites. */
+static int gl_mbatch    = 0; /**< Allocated batch sprites. */
+static int gl_batching  = 0; /**< Whether or not currently batching. */
+static gl_vbo *gl_batchVBO = NULL; /**< Streaming VBO for batched quads. */
+static int gl_batchVBOtexOffset = 0; /**< Batch VBO texture offset. */
+static int gl_batchVBOcolOffset = 0; /**< Batch VBO colour offset. */
+
+/**
+ * @brief A point accumulated for batched rendering.
+ *
+ * Far-LOD entities too small to show any sprite detail get drawn as
+ *  untextured points, all from one VBO.
+ */
+typedef struct glBatchPoint_ {
+   double x; /**< X position on screen. */
+   double y; /**< Y position on screen. */
+   glColour c; /**< Colour to use. */
+} glBatchPoint;
+
+static glBatchPoint *gl_batchPts = NULL; /**< Accumulated batch points. */
+static int gl_nbatchPts = 0; /**< Number of accumulated batch points. */
+static int gl_mbatchPts = 0; /**< Allocated batch points. */
+
+
 /*
  * Circle textures.
  */
 static glTexture *gl_circle      = NULL; /**< Circle mipmap. */
 
 
+/*
+ * Reduced resolution world pass - see gl_renderScaleBegin().
+ */
+static GLuint gl_rscaleTex    = 0; /**< Backing texture for the capture. */
+static int gl_rscaleTW        = 0; /**< POT width of the backing texture. */
+static int gl_rscaleTH        = 0; /**< POT height of the backing texture. */
+static int gl_rscaleW         = 0; /**< Width the world pass renders at. */
+static int gl_rscaleH         = 0; /**< Height the world pass renders at. */
+static int gl_rscaleActive    = 0; /**< Currently rendering reduced. */
+
+
 /*
  * prototypes
  */
 static void gl_drawCircleEmpty( const double cx, const double cy,
       const double r, const glColour *c );
 static glTexture *gl_genCircle( int radius );
+static int gl_batchCmp( const void *p1, const void *p2 );
+static void gl_batchDrawRun( const glTexture *t, const glBatchSprite *run, int n );
+static void gl_batchDrawPoints (void);
 static void gl_blitTextureInterpolate(  const glTexture* ta,
       const glTexture* tb, const double inter,
       const double x, const double y,
@@ -138,6 +205,7 @@ void gl_renderRect( double x, double y, double w, double h, const glColour *c )
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   COUNT_INC( COUNT_DRAWS );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Clear state. */
@@ -188,12 +256,12 @@ void gl_blitTexture(  const glTexture* texture,
    gl_vboSubData( gl_renderVBO, 0, 4*2*sizeof(GLfloat), vertex );
    gl_vboActivateOffset( gl_renderVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
 
-   /* Set the texture. */
-   tex[0] = (GLfloat)tx;
+   /* Set the texture - tox/toy offset into the atlas, if any. */
+   tex[0] = (GLfloat)(tx + texture->tox);
    tex[4] = tex[0];
    tex[2] = tex[0] + (GLfloat)tw;
    tex[6] = tex[2];
-   tex[1] = (GLfloat)ty;
+   tex[1] = (GLfloat)(ty + texture->toy);
    tex[3] = tex[1];
    tex[5] = tex[1] + (GLfloat)th;
    tex[7] = tex[5];
@@ -223,6 +291,7 @@ void gl_blitTexture(  const glTexture* texture,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   COUNT_INC( COUNT_DRAWS );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Clear state. */
@@ -257,7 +326,7 @@ static void gl_blitTextureInterpolate(  const glTexture* ta,
       const double tx, const double ty,
       const double tw, const double th, const glColour *c )
 {
-   GLfloat vertex[4*2], tex[4*2], col[4*4];
+   GLfloat vertex[4*2], tex[4*2], tex2[4*2], col[4*4];
    GLfloat mcol[4] = { 0., 0., 0. };
 
    /* Corner cases. */
@@ -373,22 +442,32 @@ static void gl_blitTextureInterpolate(  const glTexture* ta,
    gl_vboSubData( gl_renderVBO, 0, 4*2*sizeof(GLfloat), vertex );
    gl_vboActivateOffset( gl_renderVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
 
-   /* Set the texture. */
-   tex[0] = (GLfloat)tx;
+   /* Set the texture - each texture can sit elsewhere in its atlas. */
+   tex[0] = (GLfloat)(tx + ta->tox);
    tex[4] = tex[0];
    tex[2] = tex[0] + (GLfloat)tw;
    tex[6] = tex[2];
-   tex[1] = (GLfloat)ty;
+   tex[1] = (GLfloat)(ty + ta->toy);
    tex[3] = tex[1];
    tex[5] = tex[1] + (GLfloat)th;
    tex[7] = tex[5];
    gl_vboSubData( gl_renderVBO, gl_renderVBOtexOffset, 4*2*sizeof(GLfloat), tex );
    gl_vboActivateOffset( gl_renderVBO, GL_TEXTURE0,
          gl_renderVBOtexOffset, 2, GL_FLOAT, 0 );
+   tex2[0] = (GLfloat)(tx + tb->tox);
+   tex2[4] = tex2[0];
+   tex2[2] = tex2[0] + (GLfloat)tw;
+   tex2[6] = tex2[2];
+   tex2[1] = (GLfloat)(ty + tb->toy);
+   tex2[3] = tex2[1];
+   tex2[5] = tex2[1] + (GLfloat)th;
+   tex2[7] = tex2[5];
+   gl_vboSubData( gl_renderVBO, gl_renderVBOtex2Offset, 4*2*sizeof(GLfloat), tex2 );
    gl_vboActivateOffset( gl_renderVBO, GL_TEXTURE1,
-         gl_renderVBOtexOffset, 2, GL_FLOAT, 0 );
+         gl_renderVBOtex2Offset, 2, GL_FLOAT, 0 );
 
    /* Draw. */
+   COUNT_INC( COUNT_DRAWS );
    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
    /* Clear state. */
@@ -420,15 +499,11 @@ static void gl_blitTextureInterpolate(  const glTexture* ta,
 void gl_blitSprite( const glTexture* sprite, const double bx, const double by,
       const int sx, const int sy, const glColour* c )
 {
-   double x,y, w,h, tx,ty, cx,cy, gx,gy;
-
-   /* Get parameters. */
-   gl_cameraGet( &cx, &cy );
-   gui_getOffset( &gx, &gy );
+   double x,y, w,h, tx,ty;
 
    /* calculate position - we'll use relative coords to player */
-   x = (bx - cx - sprite->sw/2. + gx) * gl_cameraZ;
-   y = (by - cy - sprite->sh/2. + gy) * gl_cameraZ;
+   x = (bx - gl_frameX - sprite->sw/2. + gl_frameGX) * gl_cameraZ;
+   y = (by - gl_frameY - sprite->sh/2. + gl_frameGY) * gl_cameraZ;
 
    /* Scaled sprite dimensions. */
    w = sprite->sw*gl_cameraZ;
@@ -469,15 +544,11 @@ void gl_blitSpriteInterpolate( const glTexture* sa, const glTexture *sb,
       double inter, const double bx, const double by,
       const int sx, const int sy, const glColour *c )
 {
-   double x,y, w,h, tx,ty, cx,cy, gx,gy;
-
-   /* Get parameters. */
-   gl_cameraGet( &cx, &cy );
-   gui_getOffset( &gx, &gy );
+   double x,y, w,h, tx,ty;
 
    /* calculate position - we'll use relative coords to player */
-   x = (bx - cx - sa->sw/2. + gx) * gl_cameraZ;
-   y = (by - cy - sa->sh/2. + gy) * gl_cameraZ;
+   x = (bx - gl_frameX - sa->sw/2. + gl_frameGX) * gl_cameraZ;
+   y = (by - gl_frameY - sa->sh/2. + gl_frameGY) * gl_cameraZ;
 
    /* Scaled sprite dimensions. */
    w = sa->sw*gl_cameraZ;
@@ -497,6 +568,339 @@ void gl_blitSpriteInterpolate( const glTexture* sa, const glTexture *sb,
 }
 
 
+/**
+ * @brief Starts accumulating sprites for batched rendering.
+ *
+ * Between gl_batchBegin() and gl_batchEnd() everything drawn with
+ *  gl_batchSprite() is accumulated, sorted by texture and flushed with one
+ *  draw per texture instead of one per sprite.  Sprites within the batch
+ *  may therefore be reordered relative to each other.
+ */
+void gl_batchBegin (void)
+{
+   gl_nbatch   = 0;
+   gl_batching = 1;
+}
+
+
+/**
+ * @brief Adds a sprite to the current batch, position is relative to the player.
+ *
+ * Outside of a batch it behaves exactly like gl_blitSprite().
+ *
+ * @sa gl_blitSprite
+ */
+void gl_batchSprite( const glTexture* sprite, const double bx, const double by,
+      const int sx, const int sy, const glColour *c )
+{
+   gl_batchSpriteInterpolate( sprite, NULL, 0., bx, by, sx, sy, c );
+}
+
+
+/**
+ * @brief Adds an interpolated sprite to the current batch.
+ *
+ * Outside of a batch it behaves exactly like gl_blitSpriteInterpolate().
+ *
+ * @sa gl_blitSpriteInterpolate
+ */
+void gl_batchSpriteInterpolate( const glTexture* sa, const glTexture *sb,
+      double inter, const double bx, const double by,
+      const int sx, const int sy, const glColour *c )
+{
+   double x,y, w,h;
+   glBatchSprite *bs;
+
+   /* Not batching, draw right away. */
+   if (!gl_batching) {
+      if (sb == NULL)
+         gl_blitSprite( sa, bx, by, sx, sy, c );
+      else
+         gl_blitSpriteInterpolate( sa, sb, inter, bx, by, sx, sy, c );
+      return;
+   }
+
+   /* calculate position - we'll use relative coords to player */
+   x = (bx - gl_frameX - sa->sw/2. + gl_frameGX) * gl_cameraZ;
+   y = (by - gl_frameY - sa->sh/2. + gl_frameGY) * gl_cameraZ;
+
+   /* Scaled sprite dimensions. */
+   w = sa->sw*gl_cameraZ;
+   h = sa->sh*gl_cameraZ;
+
+   /* check if inbounds */
+   if ((fabs(x) > SCREEN_W/2 + w) ||
+         (fabs(y) > SCREEN_H/2 + h) )
+      return;
+
+   /* Without multitexture interpolation degrades to the closer texture. */
+   if ((sb != NULL) && (nglActiveTexture == NULL)) {
+      if (inter <= 0.5)
+         sa = sb;
+      sb = NULL;
+   }
+
+   /* See if memory needs to grow. */
+   if (gl_nbatch+1 > gl_mbatch) {
+      gl_mbatch += OPENGL_BATCH_CHUNK;
+      gl_batch = realloc( gl_batch, gl_mbatch*sizeof(glBatchSprite) );
+   }
+
+   /* Accumulate the sprite. */
+   bs        = &gl_batch[ gl_nbatch++ ];
+   bs->ta    = sa;
+   bs->tb    = sb;
+   bs->inter = inter;
+   bs->x     = x;
+   bs->y     = y;
+   bs->w     = w;
+   bs->h     = h;
+   bs->tx    = sa->sw*(double)(sx)/sa->rw;
+   bs->ty    = sa->sh*(sa->sy-(double)sy-1)/sa->rh;
+   bs->c     = (c == NULL) ? cWhite : *c;
+}
+
+
+/**
+ * @brief Adds a point to the current batch, position is relative to the player.
+ *
+ * Far-LOD path: no texture bind, no sprite selection, just a coloured
+ *  point.  Outside of a batch the point is drawn right away.
+ *
+ *    @param bx X position of the point relative to the player.
+ *    @param by Y position of the point relative to the player.
+ *    @param c Colour to use.
+ */
+void gl_batchPoint( const double bx, const double by, const glColour *c )
+{
+   double x, y;
+   glBatchPoint *bp;
+
+   /* calculate position - we'll use relative coords to player */
+   x = (bx - gl_frameX + gl_frameGX) * gl_cameraZ;
+   y = (by - gl_frameY + gl_frameGY) * gl_cameraZ;
+
+   /* check if inbounds */
+   if ((fabs(x) > SCREEN_W/2) || (fabs(y) > SCREEN_H/2))
+      return;
+
+   /* See if memory needs to grow. */
+   if (gl_nbatchPts+1 > gl_mbatchPts) {
+      gl_mbatchPts += OPENGL_BATCH_CHUNK;
+      gl_batchPts = realloc( gl_batchPts, gl_mbatchPts*sizeof(glBatchPoint) );
+   }
+
+   /* Accumulate the point. */
+   bp    = &gl_batchPts[ gl_nbatchPts++ ];
+   bp->x = x;
+   bp->y = y;
+   bp->c = (c == NULL) ? cWhite : *c;
+
+   if (!gl_batching)
+      gl_batchDrawPoints();
+}
+
+
+/**
+ * @brief Draws the accumulated batch points with one call per VBO fill.
+ */
+static void gl_batchDrawPoints (void)
+{
+   GLfloat vertex[2*4*OPENGL_BATCH_QUADS];
+   GLfloat col[4*4*OPENGL_BATCH_QUADS];
+   const glBatchPoint *bp;
+   int i, s;
+
+   glPointSize( MAX( 1.f, (GLfloat)(3.*gl_screen.scale) ) );
+
+   s = 0;
+   while (s < gl_nbatchPts) {
+      /* Fill a VBO's worth of points. */
+      for (i=0; (s+i<gl_nbatchPts) && (i<4*OPENGL_BATCH_QUADS); i++) {
+         bp = &gl_batchPts[s+i];
+         vertex[2*i+0] = (GLfloat)bp->x;
+         vertex[2*i+1] = (GLfloat)bp->y;
+         col[4*i+0] = bp->c.r;
+         col[4*i+1] = bp->c.g;
+         col[4*i+2] = bp->c.b;
+         col[4*i+3] = bp->c.a;
+      }
+
+      /* Upload and draw the points in one go. */
+      gl_vboOrphan( gl_batchVBO ); /* don't sync against the last flush */
+      gl_vboSubData( gl_batchVBO, 0, i*2*sizeof(GLfloat), vertex );
+      gl_vboActivateOffset( gl_batchVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+      gl_vboSubData( gl_batchVBO, gl_batchVBOcolOffset,
+            i*4*sizeof(GLfloat), col );
+      gl_vboActivateOffset( gl_batchVBO, GL_COLOR_ARRAY,
+            gl_batchVBOcolOffset, 4, GL_FLOAT, 0 );
+      COUNT_INC( COUNT_DRAWS );
+      glDrawArrays( GL_POINTS, 0, i );
+      gl_vboDeactivate();
+
+      s += i;
+   }
+
+   glPointSize( 1.f );
+   gl_nbatchPts = 0;
+
+   /* anything failed? */
+   gl_checkErr();
+}
+
+
+/**
+ * @brief qsort comparison function to group batch sprites by texture.
+ */
+static int gl_batchCmp( const void *p1, const void *p2 )
+{
+   const glBatchSprite *b1, *b2;
+
+   b1 = (const glBatchSprite*) p1;
+   b2 = (const glBatchSprite*) p2;
+
+   if (b1->ta != b2->ta)
+      return (b1->ta < b2->ta) ? -1 : +1;
+   if (b1->tb != b2->tb)
+      return (b1->tb < b2->tb) ? -1 : +1;
+   return 0;
+}
+
+
+/**
+ * @brief Draws a run of batch sprites sharing a texture with a single call.
+ *
+ *    @param t Texture the run uses.
+ *    @param run Start of the run.
+ *    @param n Number of sprites in the run.
+ */
+static void gl_batchDrawRun( const glTexture *t, const glBatchSprite *run, int n )
+{
+   GLfloat vertex[4*2*OPENGL_BATCH_QUADS];
+   GLfloat tex[4*2*OPENGL_BATCH_QUADS];
+   GLfloat col[4*4*OPENGL_BATCH_QUADS];
+   const glBatchSprite *bs;
+   int i, j;
+
+   /* Bind the texture once for the whole run. */
+   glEnable(GL_TEXTURE_2D);
+   glBindTexture( GL_TEXTURE_2D, t->texture );
+
+   while (n > 0) {
+      /* Fill a VBO's worth of quads. */
+      for (i=0; (i<n) && (i<OPENGL_BATCH_QUADS); i++) {
+         bs = &run[i];
+
+         /* Counter-clockwise quad. */
+         vertex[8*i+0] = (GLfloat)bs->x;
+         vertex[8*i+1] = (GLfloat)bs->y;
+         vertex[8*i+2] = (GLfloat)(bs->x + bs->w);
+         vertex[8*i+3] = (GLfloat)bs->y;
+         vertex[8*i+4] = (GLfloat)(bs->x + bs->w);
+         vertex[8*i+5] = (GLfloat)(bs->y + bs->h);
+         vertex[8*i+6] = (GLfloat)bs->x;
+         vertex[8*i+7] = (GLfloat)(bs->y + bs->h);
+
+         tex[8*i+0] = (GLfloat)(bs->tx + t->tox);
+         tex[8*i+1] = (GLfloat)(bs->ty + t->toy);
+         tex[8*i+2] = (GLfloat)(bs->tx + t->tox + t->srw);
+         tex[8*i+3] = (GLfloat)(bs->ty + t->toy);
+         tex[8*i+4] = (GLfloat)(bs->tx + t->tox + t->srw);
+         tex[8*i+5] = (GLfloat)(bs->ty + t->toy + t->srh);
+         tex[8*i+6] = (GLfloat)(bs->tx + t->tox);
+         tex[8*i+7] = (GLfloat)(bs->ty + t->toy + t->srh);
+
+         for (j=0; j<4; j++) {
+            col[16*i+4*j+0] = bs->c.r;
+            col[16*i+4*j+1] = bs->c.g;
+            col[16*i+4*j+2] = bs->c.b;
+            col[16*i+4*j+3] = bs->c.a;
+         }
+      }
+
+      /* Upload and draw the quads in one go. */
+      gl_vboOrphan( gl_batchVBO ); /* don't sync against the last flush */
+      gl_vboSubData( gl_batchVBO, 0, i*4*2*sizeof(GLfloat), vertex );
+      gl_vboActivateOffset( gl_batchVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+      gl_vboSubData( gl_batchVBO, gl_batchVBOtexOffset,
+            i*4*2*sizeof(GLfloat), tex );
+      gl_vboActivateOffset( gl_batchVBO, GL_TEXTURE_COORD_ARRAY,
+            gl_batchVBOtexOffset, 2, GL_FLOAT, 0 );
+      gl_vboSubData( gl_batchVBO, gl_batchVBOcolOffset,
+            i*4*4*sizeof(GLfloat), col );
+      gl_vboActivateOffset( gl_batchVBO, GL_COLOR_ARRAY,
+            gl_batchVBOcolOffset, 4, GL_FLOAT, 0 );
+      COUNT_INC( COUNT_DRAWS );
+      glDrawArrays( GL_QUADS, 0, 4*i );
+      gl_vboDeactivate();
+
+      run += i;
+      n   -= i;
+   }
+
+   /* Clear state. */
+   glDisable(GL_TEXTURE_2D);
+
+   /* anything failed? */
+   gl_checkErr();
+}
+
+
+/**
+ * @brief Flushes the accumulated batch without ending it.
+ */
+void gl_batchFlush (void)
+{
+   const glBatchSprite *bs;
+   int i, s;
+
+   /* Points go under the sprites. */
+   if (gl_nbatchPts > 0)
+      gl_batchDrawPoints();
+
+   if (gl_nbatch == 0)
+      return;
+
+   /* Group by texture so each texture binds exactly once. */
+   qsort( gl_batch, gl_nbatch, sizeof(glBatchSprite), gl_batchCmp );
+
+   i = 0;
+   while (i < gl_nbatch) {
+      bs = &gl_batch[i];
+
+      /* Interpolated sprites need per-sprite combiner state so they can't
+       * share a draw, but grouping still avoids rebinding the textures. */
+      if (bs->tb != NULL) {
+         gl_blitTextureInterpolate( bs->ta, bs->tb, bs->inter,
+               bs->x, bs->y, bs->w, bs->h,
+               bs->tx, bs->ty, bs->ta->srw, bs->ta->srh, &bs->c );
+         i++;
+         continue;
+      }
+
+      /* Find the run sharing this texture. */
+      s = i;
+      while ((i < gl_nbatch) && (gl_batch[i].ta == bs->ta) &&
+            (gl_batch[i].tb == NULL))
+         i++;
+
+      gl_batchDrawRun( bs->ta, &gl_batch[s], i-s );
+   }
+
+   gl_nbatch = 0;
+}
+
+
+/**
+ * @brief Flushes and ends the current sprite batch.
+ */
+void gl_batchEnd (void)
+{
+   gl_batchFlush();
+   gl_batching = 0;
+}
+
+
 /**
  * @brief Blits a sprite, position is in absolute screen coordinates.
  *
@@ -610,16 +1014,19 @@ void gl_blitStatic( const glTexture* texture,
 
 
 /**
- * @brief Binds the camera to a vector.
+ * @brief Binds the camera to a solid.
  *
  * All stuff displayed with relative functions will be affected by the camera's
- *  position.  Does not affect stuff in screen coordinates.
+ *  position.  Does not affect stuff in screen coordinates.  The camera
+ *  follows the solid's interpolated position so it moves as smoothly as
+ *  the sprites rendered against it.
  *
- *    @param pos Vector to use as camera.
+ *    @param s Solid to use as camera.
  */
-void gl_cameraBind( Vector2d* pos )
+void gl_cameraBind( Solid* s )
 {
-   gl_camera = pos;
+   gl_camera = s;
+   gl_cameraFrame();
 }
 
 
@@ -634,6 +1041,7 @@ void gl_cameraStatic( double x, double y )
    gl_cameraX = x;
    gl_cameraY = y;
    gl_camera  = NULL;
+   gl_cameraFrame();
 }
 
 
@@ -645,10 +1053,8 @@ void gl_cameraStatic( double x, double y )
  */
 void gl_cameraGet( double *x, double *y )
 {
-   if (gl_camera != NULL) {
-      *x = gl_camera->x;
-      *y = gl_camera->y;
-   }
+   if (gl_camera != NULL)
+      solid_getInterpPos( gl_camera, x, y );
    else {
       *x = gl_cameraX;
       *y = gl_cameraY;
@@ -656,6 +1062,41 @@ void gl_cameraGet( double *x, double *y )
 }
 
 
+/**
+ * @brief Caches the camera transform for the frame.
+ *
+ * The blitters and gl_cameraInView() use the cached values instead of
+ *  re-deriving the interpolated camera position and GUI offset per
+ *  entity.  Called once per frame from render_all() and whenever the
+ *  camera is rebound mid-frame.
+ */
+void gl_cameraFrame (void)
+{
+   gl_cameraGet( &gl_frameX, &gl_frameY );
+   gui_getOffset( &gl_frameGX, &gl_frameGY );
+}
+
+
+/**
+ * @brief Checks whether a game coordinate is inside the camera view.
+ *
+ * Lets renderers skip off-screen entities before doing any render-path
+ *  work, the same test the blitters apply after the fact.
+ *
+ *    @param x X position in game coordinates.
+ *    @param y Y position in game coordinates.
+ *    @param r Bounding radius of the entity.
+ *    @return 1 if it can appear on screen, 0 otherwise.
+ */
+int gl_cameraInView( double x, double y, double r )
+{
+   x = (x - gl_frameX) * gl_cameraZ;
+   y = (y - gl_frameY) * gl_cameraZ;
+   r *= gl_cameraZ;
+   return (fabs(x) <= SCREEN_W/2 + r) && (fabs(y) <= SCREEN_H/2 + r);
+}
+
+
 /**
  * @brief Draws an empty circle.
  *
@@ -733,6 +1174,7 @@ static void gl_drawCircleEmpty( const double cx, const double cy,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   COUNT_INC( COUNT_DRAWS );
    glDrawArrays( GL_POINTS, 0, i );
 
    /* Clear state. */
@@ -872,6 +1314,7 @@ void gl_drawCircleInRect( const double cx, const double cy, const double r,
          gl_renderVBOcolOffset, 4, GL_FLOAT, 0 );
 
    /* Draw. */
+   COUNT_INC( COUNT_DRAWS );
    glDrawArrays( GL_POINTS, 0, i );
 
    /* Clear state. */
@@ -946,6 +1389,111 @@ static glTexture *gl_genCircle( int radius )
 }
 
 
+/**
+ * @brief Starts rendering the world at a fraction of the window resolution.
+ *
+ * Shrinks the viewport so everything up to the matching gl_renderScaleEnd()
+ *  only touches conf.render_scale^2 as many pixels - the projection is left
+ *  alone so the world renderers are none the wiser.  Fill rate bound scenes
+ *  (nebula overlay, dense particles) scale near linearly with it.
+ *
+ * No-op at render_scale 1. or when the window itself is scaled, as the
+ *  capture in gl_renderScaleEnd() assumes screen units map 1:1 onto
+ *  backbuffer pixels.
+ */
+void gl_renderScaleBegin (void)
+{
+   if ((conf.render_scale >= 1.) || (gl_screen.scale != 1.))
+      return;
+
+   gl_rscaleW = (int)((double)SCREEN_W * conf.render_scale);
+   gl_rscaleH = (int)((double)SCREEN_H * conf.render_scale);
+   glViewport( 0, 0, gl_rscaleW, gl_rscaleH );
+   gl_rscaleActive = 1;
+}
+
+
+/**
+ * @brief Captures the reduced world pass and stretches it over the window.
+ *
+ * Same backbuffer trick the toolkit window cache uses: the corner of the
+ *  backbuffer the world was rendered into is copied out with
+ *  glCopyTexSubImage2D() and drawn back as one bilinearly filtered quad
+ *  covering the screen.  The GUI renders on top at native resolution.
+ */
+void gl_renderScaleEnd (void)
+{
+   int pw, ph;
+   GLfloat vertex[4*2], tex[4*2];
+
+   if (!gl_rscaleActive)
+      return;
+   gl_rscaleActive = 0;
+
+   /* (Re)create the backing texture if needed. */
+   pw = gl_pot( gl_rscaleW );
+   ph = gl_pot( gl_rscaleH );
+   if ((gl_rscaleTex == 0) || (pw != gl_rscaleTW) || (ph != gl_rscaleTH)) {
+      if (gl_rscaleTex != 0)
+         glDeleteTextures( 1, &gl_rscaleTex );
+      glGenTextures( 1, &gl_rscaleTex );
+      glBindTexture( GL_TEXTURE_2D, gl_rscaleTex );
+      /* Linear filtering - the whole point is stretching it back up. */
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, pw, ph, 0,
+            GL_RGB, GL_UNSIGNED_BYTE, NULL );
+      gl_rscaleTW = pw;
+      gl_rscaleTH = ph;
+   }
+   else
+      glBindTexture( GL_TEXTURE_2D, gl_rscaleTex );
+
+   /* Grab the world pass off the backbuffer. */
+   glCopyTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0,
+         0, 0, gl_rscaleW, gl_rscaleH );
+
+   /* Back to the full window. */
+   glViewport( 0, 0, gl_screen.rw, gl_screen.rh );
+
+   /* Stretch the capture over the whole screen. */
+   glEnable(GL_TEXTURE_2D);
+   glColor4d( 1., 1., 1., 1. );
+
+   vertex[0] = (GLfloat)(-(double)SCREEN_W/2.);
+   vertex[4] = vertex[0];
+   vertex[2] = (GLfloat)((double)SCREEN_W/2.);
+   vertex[6] = vertex[2];
+   vertex[1] = (GLfloat)(-(double)SCREEN_H/2.);
+   vertex[3] = vertex[1];
+   vertex[5] = (GLfloat)((double)SCREEN_H/2.);
+   vertex[7] = vertex[5];
+   gl_vboSubData( gl_renderVBO, 0, sizeof(vertex), vertex );
+   gl_vboActivateOffset( gl_renderVBO, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+
+   tex[0] = 0.;
+   tex[4] = tex[0];
+   tex[2] = (GLfloat)((double)gl_rscaleW / (double)gl_rscaleTW);
+   tex[6] = tex[2];
+   tex[1] = 0.;
+   tex[3] = tex[1];
+   tex[5] = (GLfloat)((double)gl_rscaleH / (double)gl_rscaleTH);
+   tex[7] = tex[5];
+   gl_vboSubData( gl_renderVBO, gl_renderVBOtexOffset, sizeof(tex), tex );
+   gl_vboActivateOffset( gl_renderVBO, GL_TEXTURE_COORD_ARRAY,
+         gl_renderVBOtexOffset, 2, GL_FLOAT, 0 );
+
+   COUNT_INC( COUNT_DRAWS );
+   glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+
+   /* Clear state. */
+   gl_vboDeactivate();
+   glDisable(GL_TEXTURE_2D);
+
+   gl_checkErr();
+}
+
+
 /**
  * @brief Initializes the OpenGL rendering routines.
  *
@@ -955,9 +1503,16 @@ int gl_initRender (void)
 {
    /* Initialize the VBO. */
    gl_renderVBO = gl_vboCreateStream( sizeof(GLfloat) *
-         OPENGL_RENDER_VBO_SIZE*(2 + 2 + 4), NULL );
-   gl_renderVBOtexOffset = sizeof(GLfloat) * OPENGL_RENDER_VBO_SIZE*2;
-   gl_renderVBOcolOffset = sizeof(GLfloat) * OPENGL_RENDER_VBO_SIZE*(2+2);
+         OPENGL_RENDER_VBO_SIZE*(2 + 2 + 2 + 4), NULL );
+   gl_renderVBOtexOffset  = sizeof(GLfloat) * OPENGL_RENDER_VBO_SIZE*2;
+   gl_renderVBOtex2Offset = sizeof(GLfloat) * OPENGL_RENDER_VBO_SIZE*(2+2);
+   gl_renderVBOcolOffset  = sizeof(GLfloat) * OPENGL_RENDER_VBO_SIZE*(2+2+2);
+
+   /* Initialize the batch VBO. */
+   gl_batchVBO = gl_vboCreateStream( sizeof(GLfloat) *
+         OPENGL_BATCH_QUADS*4*(2 + 2 + 4), NULL );
+   gl_batchVBOtexOffset = sizeof(GLfloat) * OPENGL_BATCH_QUADS*4*2;
+   gl_batchVBOcolOffset = sizeof(GLfloat) * OPENGL_BATCH_QUADS*4*(2+2);
 
    /* Initialize the circles. */
    gl_circle      = gl_genCircle( 128 );
@@ -971,9 +1526,29 @@ int gl_initRender (void)
  */
 void gl_exitRender (void)
 {
-   /* Destroy the VBO. */
+   /* Destroy the VBOs. */
    gl_vboDestroy( gl_renderVBO );
    gl_renderVBO = NULL;
+   gl_vboDestroy( gl_batchVBO );
+   gl_batchVBO = NULL;
+
+   /* Destroy the batch. */
+   free( gl_batch );
+   gl_batch  = NULL;
+   gl_nbatch = 0;
+   gl_mbatch = 0;
+   free( gl_batchPts );
+   gl_batchPts  = NULL;
+   gl_nbatchPts = 0;
+   gl_mbatchPts = 0;
+
+   /* Destroy the render scale capture texture. */
+   if (gl_rscaleTex != 0) {
+      glDeleteTextures( 1, &gl_rscaleTex );
+      gl_rscaleTex = 0;
+      gl_rscaleTW  = 0;
+      gl_rscaleTH  = 0;
+   }
 
    /* Destroy the circles. */
    gl_freeTexture(gl_circle);
@@ -20,13 +20,22 @@ void gl_exitRender (void);
 /*
  * Camera.
  */
-void gl_cameraBind( Vector2d* pos );
+void gl_cameraBind( Solid* s );
 void gl_cameraStatic( double x, double y );
 void gl_cameraGet( double *x, double *y );
+void gl_cameraFrame (void);
+int gl_cameraInView( double x, double y, double r );
 void gl_cameraZoom( double zoom );
 void gl_cameraZoomGet( double * zoom );
 
 
+/*
+ * Reduced resolution world pass.
+ */
+void gl_renderScaleBegin (void);
+void gl_renderScaleEnd (void);
+
+
 /*
  * Rendering.
  */
@@ -40,6 +49,17 @@ void gl_blitTexture(  const glTexture* texture,
 void gl_blitSprite( const glTexture* sprite,
       const double bx, const double by,
       const int sx, const int sy, const glColour *c );
+/* sprite batching - sorts by texture and draws once per texture */
+void gl_batchBegin (void);
+void gl_batchSprite( const glTexture* sprite,
+      const double bx, const double by,
+      const int sx, const int sy, const glColour *c );
+void gl_batchSpriteInterpolate( const glTexture* sa, const glTexture *sb,
+      double inter, const double bx, const double by,
+      const int sx, const int sy, const glColour *c );
+void gl_batchPoint( const double bx, const double by, const glColour *c );
+void gl_batchFlush (void);
+void gl_batchEnd (void);
 /* Blits a sprite interpolating between textures, relative pos. */
 void gl_blitSpriteInterpolate( const glTexture* sa, const glTexture *sb,
       double inter, const double bx, const double by,
@@ -20,8 +20,12 @@
 #include <string.h>
 
 #include "log.h"
+#include "nmem.h"
+#include "loadtime.h"
 #include "ndata.h"
 #include "gui.h"
+#include "conf.h"
+#include "nfile.h"
 
 
 /*
@@ -32,10 +36,75 @@
  */
 typedef struct glTexList_ {
    struct glTexList_ *next; /**< Next in linked list */
+   struct glTexList_ *hnext; /**< Next in the same name hash bucket. */
    glTexture *tex; /**< assosciated texture */
    int used; /**< counts how many times texture is being used */
+   unsigned int size; /**< Estimated VRAM the texture occupies. */
+   unsigned int lastused; /**< Use clock value when last released. */
 } glTexList;
 static glTexList* texture_list = NULL; /**< Texture list. */
+static unsigned int tex_memUsed = 0; /**< Estimated VRAM of listed textures. */
+static unsigned int tex_clock = 0; /**< Use counter for LRU ordering. */
+
+#define TEX_HASH_SIZE   256 /**< Buckets in the name hash, power of two. */
+static glTexList *tex_hash[TEX_HASH_SIZE]; /**< Name hash of the listed textures. */
+static glTexList *tex_mru = NULL; /**< Last entry a lookup returned. */
+
+/**
+ * @brief An image being decoded ahead of use on a worker thread.
+ *
+ * The list is only touched from the main thread; the worker writes just
+ *  surface and trans, and joining the thread publishes them.
+ */
+typedef struct glTexPrefetch_ {
+   struct glTexPrefetch_ *next; /**< Next in linked list. */
+   char *path; /**< Image path. */
+   unsigned int flags; /**< Flags the load will use. */
+   SDL_Surface *surface; /**< Decoded surface, valid after the join. */
+   uint8_t *trans; /**< Transparency map, valid after the join. */
+   SDL_Thread *thread; /**< Decoder thread. */
+} glTexPrefetch;
+static glTexPrefetch *tex_prefetch = NULL; /**< Prefetches in flight. */
+
+
+/*
+ * Texture atlases.
+ *
+ * Sprite sheets loaded with OPENGL_TEX_ATLAS get shelf-packed into shared
+ *  atlas textures so that sorted rendering can draw many sheets without
+ *  rebinding and without the memory wasted padding each sheet up to a
+ *  power of two.
+ */
+#define GL_DIR_LUT   1024 /**< Heading lookup entries, power of two for masking. */
+
+#define ATLAS_SIZE   1024 /**< Width and height of an atlas texture. */
+#define ATLAS_PAD    8 /**< Padding between atlas entries, wide enough to keep
+                            the lower mipmap levels from bleeding. */
+/**
+ * @brief An atlas texture being shelf-packed.
+ */
+typedef struct glTexAtlas_ {
+   struct glTexAtlas_ *next; /**< Next atlas in the list. */
+   GLuint texture; /**< The atlas texture itself. */
+   int x; /**< X position of the current shelf cursor. */
+   int y; /**< Y position of the current shelf. */
+   int shelf; /**< Height of the current shelf. */
+} glTexAtlas;
+static glTexAtlas *atlas_list = NULL; /**< All the atlases. */
+
+
+/*
+ * Pixel buffer uploads.
+ *
+ * Staging the pixels in a GL-owned buffer lets glTex*Image2D queue an
+ *  asynchronous transfer and return instead of blocking while it copies
+ *  the client memory out, which shortens the landing/shipyard stalls.
+ */
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC /**< Missing from some older headers. */
+#endif
+static GLuint tex_pbo = 0; /**< Buffer the texture uploads stream through. */
+static int tex_pboActive = 0; /**< Whether the buffer is currently bound. */
 
 
 /*
@@ -45,9 +114,86 @@ static glTexList* texture_list = NULL; /**< Texture list. */
 static int SDL_VFlipSurface( SDL_Surface* surface );
 static int SDL_IsTrans( SDL_Surface* s, int x, int y );
 static uint8_t* SDL_MapTrans( SDL_Surface* s );
+static SDL_Surface* gl_scaleSurface( SDL_Surface *surface, const int w, const int h );
 /* glTexture */
 static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned int flags );
+static SDL_Surface* gl_decodeSurface( const char* path,
+      const unsigned int flags, uint8_t **ptrans );
+static int gl_prefetchThread( void *data );
+static glTexPrefetch* gl_prefetchSpawn( const char* path, unsigned int flags );
+static SDL_Surface* gl_prefetchTake( const char* path, uint8_t **ptrans );
 static glTexture* gl_loadNewImage( const char* path, unsigned int flags );
+/* atlas */
+static glTexAtlas* gl_atlasNew (void);
+static GLuint gl_atlasAdd( SDL_Surface *surface, int *ax, int *ay );
+/* pixel buffer */
+static const GLvoid* gl_pboUploadBegin( const void *data, GLsizei size );
+static void gl_pboUploadEnd (void);
+/* texture cache */
+static unsigned int gl_textureEstimate( const glTexture *tex );
+static void gl_textureDestroy( glTexture *texture );
+static void gl_textureEvict (void);
+static unsigned int gl_texHash( const char *path );
+static void gl_texHashAdd( glTexList *node );
+static void gl_texHashRemove( glTexList *node );
+static glTexList* gl_texLookup( const char *path );
+/* transparency map cache */
+static void gl_transCachePath( char file_path[PATH_MAX],
+      const char *path, int w, int h );
+static uint8_t* gl_transLoadCache( const char *path, int w, int h );
+static void gl_transSaveCache( const char *path, int w, int h,
+      const uint8_t *trans );
+
+
+/**
+ * @brief Stages pixels in a pixel buffer for an asynchronous upload.
+ *
+ * Returns what to pass as the data argument of glTex*Image2D.  The caller
+ *  must call gl_pboUploadEnd() once the upload has been issued.  Without
+ *  pixel buffer support this degrades to the usual synchronous upload.
+ *
+ *    @param data Pixel data to stage.
+ *    @param size Size of the pixel data in bytes.
+ *    @return Data pointer to hand to glTex*Image2D.
+ */
+static const GLvoid* gl_pboUploadBegin( const void *data, GLsizei size )
+{
+   void *buf;
+
+   /* Need buffer objects and the pixel buffer extension. */
+   if ((nglGenBuffers == NULL) ||
+         (!gl_hasVersion( 2, 1 ) && !gl_hasExt("GL_ARB_pixel_buffer_object")))
+      return data;
+
+   if (tex_pbo == 0)
+      nglGenBuffers( 1, &tex_pbo );
+   nglBindBuffer( GL_PIXEL_UNPACK_BUFFER, tex_pbo );
+
+   /* Orphan the old storage so a still pending transfer can't stall us. */
+   nglBufferData( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );
+   buf = nglMapBuffer( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY );
+   if (buf == NULL) {
+      nglBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+      return data;
+   }
+   memcpy( buf, data, size );
+   nglUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+
+   tex_pboActive = 1;
+   return NULL; /* offset 0 into the bound buffer */
+}
+
+
+/**
+ * @brief Finishes a pixel buffer staged upload.
+ */
+static void gl_pboUploadEnd (void)
+{
+   if (!tex_pboActive)
+      return;
+   nglBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+   tex_pboActive = 0;
+}
 
 
 /**
@@ -181,6 +327,100 @@ static uint8_t* SDL_MapTrans( SDL_Surface* s )
 }
 
 
+/*
+ * Transparency map cache.
+ *
+ * Building a map scans every pixel of the surface, which dominates load
+ *  time for the big sprite sheets, and the result never changes for a
+ *  given image.  Maps are therefore cached on disk keyed by path and
+ *  dimensions and reread on later runs.
+ */
+#define TRANS_DIR            "gen/" /**< Directory the maps are cached in. */
+#define TRANS_CACHE_VERSION  1 /**< Bump to invalidate old caches on format change. */
+
+
+/**
+ * @brief Builds the disk cache path of a transparency map.
+ *
+ *    @param[out] file_path Resulting path.
+ *    @param path Ndata path of the image.
+ *    @param w Width of the mapped surface.
+ *    @param h Height of the mapped surface.
+ */
+static void gl_transCachePath( char file_path[PATH_MAX],
+      const char *path, int w, int h )
+{
+   char name[PATH_MAX];
+   int i;
+
+   /* Flatten the ndata path into a file name. */
+   strncpy( name, path, PATH_MAX-1 );
+   name[PATH_MAX-1] = '\0';
+   for (i=0; name[i] != '\0'; i++)
+      if (name[i] == '/')
+         name[i] = '_';
+
+   snprintf( file_path, PATH_MAX, "%s"TRANS_DIR"%s_%dx%d_v%d.trans",
+         nfile_basePath(), name, w, h, TRANS_CACHE_VERSION );
+}
+
+
+/**
+ * @brief Tries to read a transparency map from the disk cache.
+ *
+ *    @param path Ndata path of the image.
+ *    @param w Width of the mapped surface.
+ *    @param h Height of the mapped surface.
+ *    @return The cached map or NULL if it must be built.
+ */
+static uint8_t* gl_transLoadCache( const char *path, int w, int h )
+{
+   char file_path[PATH_MAX];
+   char *buf;
+   int len, size;
+
+   gl_transCachePath( file_path, path, w, h );
+   if (!nfile_fileExists( "%s", file_path ))
+      return NULL;
+
+   buf = nfile_readFile( &len, "%s", file_path );
+   if (buf == NULL)
+      return NULL;
+
+   size = w*h/8 + ((w*h%8)?1:0);
+   if (len != size) {
+      WARN("Transparency cache '%s' is stale, regenerating.", file_path);
+      free(buf);
+      return NULL;
+   }
+
+   return (uint8_t*) buf;
+}
+
+
+/**
+ * @brief Saves a transparency map to the disk cache.
+ *
+ *    @param path Ndata path of the image.
+ *    @param w Width of the mapped surface.
+ *    @param h Height of the mapped surface.
+ *    @param trans Transparency map to save.
+ */
+static void gl_transSaveCache( const char *path, int w, int h,
+      const uint8_t *trans )
+{
+   char file_path[PATH_MAX];
+   int size;
+
+   if (nfile_dirMakeExist( "%s"TRANS_DIR, nfile_basePath() ))
+      return;
+
+   size = w*h/8 + ((w*h%8)?1:0);
+   gl_transCachePath( file_path, path, w, h );
+   nfile_writeFile( (const char*)trans, size, "%s", file_path );
+}
+
+
 /**
  * @brief Prepares the surface to be loaded as a texture.
  *
@@ -250,6 +490,109 @@ SDL_Surface* gl_prepareSurface( SDL_Surface* surface )
    return surface;
 }
 
+/**
+ * @brief Creates a new empty atlas texture.
+ *
+ *    @return The new atlas or NULL on failure.
+ */
+static glTexAtlas* gl_atlasNew (void)
+{
+   glTexAtlas *atlas;
+
+   atlas = malloc( sizeof(glTexAtlas) );
+   atlas->x     = ATLAS_PAD;
+   atlas->y     = ATLAS_PAD;
+   atlas->shelf = 0;
+
+   /* Create the texture without uploading any data yet. */
+   glGenTextures( 1, &atlas->texture );
+   glBindTexture( GL_TEXTURE_2D, atlas->texture );
+
+   /* Atlased sheets are mostly mipmapped ship/outfit sprites, so filter like
+    * those would be standalone, and clamp so sampling near the borders of an
+    * entry can't pull in its neighbour. */
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   if (nglGenerateMipmap != NULL)
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   else
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_SIZE, ATLAS_SIZE, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   gl_checkErr();
+
+   /* Add to the list. */
+   atlas->next = atlas_list;
+   atlas_list  = atlas;
+
+   return atlas;
+}
+
+
+/**
+ * @brief Packs a surface into an atlas.
+ *
+ * Uses simple shelf packing - sheets are placed left to right and a new
+ *  shelf is opened when a row fills up.  Space is never reclaimed, which is
+ *  fine since atlased sheets live for the whole game.
+ *
+ *    @param surface Surface to pack, must be a 32 bpp RGBA surface.
+ *    @param[out] ax X position of the surface in the atlas.
+ *    @param[out] ay Y position of the surface in the atlas.
+ *    @return The atlas texture or 0 if the surface doesn't fit.
+ */
+static GLuint gl_atlasAdd( SDL_Surface *surface, int *ax, int *ay )
+{
+   glTexAtlas *atlas;
+   const GLvoid *pixels;
+
+   /* Can't pack what doesn't fit in an empty atlas. */
+   if ((surface->w > ATLAS_SIZE - 2*ATLAS_PAD) ||
+         (surface->h > ATLAS_SIZE - 2*ATLAS_PAD))
+      return 0;
+
+   /* Find an atlas with room. */
+   for (atlas=atlas_list; atlas!=NULL; atlas=atlas->next) {
+      /* Shelf is full, open the next one. */
+      if (atlas->x + surface->w + ATLAS_PAD > ATLAS_SIZE) {
+         atlas->x      = ATLAS_PAD;
+         atlas->y     += atlas->shelf + ATLAS_PAD;
+         atlas->shelf  = 0;
+      }
+      if (atlas->y + surface->h + ATLAS_PAD <= ATLAS_SIZE)
+         break;
+   }
+   if (atlas == NULL)
+      atlas = gl_atlasNew();
+
+   /* Place it on the shelf. */
+   (*ax) = atlas->x;
+   (*ay) = atlas->y;
+   atlas->x += surface->w + ATLAS_PAD;
+   if (surface->h > atlas->shelf)
+      atlas->shelf = surface->h;
+
+   /* Upload the pixels, staged through the pixel buffer. */
+   glBindTexture( GL_TEXTURE_2D, atlas->texture );
+   SDL_LockSurface( surface );
+   pixels = gl_pboUploadBegin( surface->pixels, surface->h * surface->pitch );
+   glPixelStorei( GL_UNPACK_ROW_LENGTH, surface->pitch / 4 );
+   glTexSubImage2D( GL_TEXTURE_2D, 0, *ax, *ay, surface->w, surface->h,
+         GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+   glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+   gl_pboUploadEnd();
+   SDL_UnlockSurface( surface );
+
+   /* Redo the mipmaps - cheap enough at load time. */
+   if (nglGenerateMipmap != NULL)
+      nglGenerateMipmap(GL_TEXTURE_2D);
+   gl_checkErr();
+
+   return atlas->texture;
+}
+
+
 /**
  * @brief Loads a surface into an opengl texture.
  *
@@ -263,6 +606,7 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
 {
    GLuint texture;
    GLfloat param;
+   const GLvoid *pixels;
 
    /* Prepare the surface. */
    surface = gl_prepareSurface( surface );
@@ -290,17 +634,19 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-   /* now lead the texture data up */
+   /* now lead the texture data up, staged through the pixel buffer */
    SDL_LockSurface( surface );
+   pixels = gl_pboUploadBegin( surface->pixels, surface->h * surface->pitch );
    if (nglCompressedTexImage2D != NULL) {
       glTexImage2D( GL_TEXTURE_2D, 0, surface->format->BytesPerPixel,
             surface->w, surface->h, 0, GL_COMPRESSED_RGBA,
-            GL_UNSIGNED_BYTE, surface->pixels );
+            GL_UNSIGNED_BYTE, pixels );
    }
    else {
       glTexImage2D( GL_TEXTURE_2D, 0, surface->format->BytesPerPixel,
-            surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels );
+            surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
    }
+   gl_pboUploadEnd();
    SDL_UnlockSurface( surface );
 
    /* Create mipmaps. */
@@ -324,6 +670,71 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
    return texture;
 }
 
+/**
+ * @brief Box-samples a surface down (or up) to the given size.
+ *
+ * Plain average of the covered source pixels per destination pixel,
+ *  good enough for toolkit icons.
+ *
+ *    @param surface Source surface, not freed.
+ *    @param w Width to scale to.
+ *    @param h Height to scale to.
+ *    @return Newly allocated scaled surface or NULL on failure.
+ */
+static SDL_Surface* gl_scaleSurface( SDL_Surface *surface, const int w, const int h )
+{
+   SDL_Surface *scaled;
+   uint32_t *src, *dst;
+   int x, y, sx, sy, sx0, sx1, sy0, sy1, n, spitch;
+   long r, g, b, a;
+   Uint8 cr, cg, cb, ca;
+
+   scaled = SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, RGBAMASK );
+   if (scaled == NULL) {
+      WARN("Unable to create scaled surface: %s", SDL_GetError());
+      return NULL;
+   }
+
+   SDL_LockSurface( surface );
+   SDL_LockSurface( scaled );
+   src    = surface->pixels;
+   dst    = scaled->pixels;
+   spitch = surface->pitch / 4;
+   for (y=0; y<h; y++) {
+      sy0 = y * surface->h / h;
+      sy1 = (y+1) * surface->h / h;
+      if (sy1 <= sy0)
+         sy1 = sy0 + 1;
+      for (x=0; x<w; x++) {
+         sx0 = x * surface->w / w;
+         sx1 = (x+1) * surface->w / w;
+         if (sx1 <= sx0)
+            sx1 = sx0 + 1;
+
+         /* Average the covered source pixels. */
+         r = g = b = a = 0;
+         for (sy=sy0; sy<sy1; sy++) {
+            for (sx=sx0; sx<sx1; sx++) {
+               SDL_GetRGBA( src[ sy*spitch + sx ], surface->format,
+                     &cr, &cg, &cb, &ca );
+               r += cr;
+               g += cg;
+               b += cb;
+               a += ca;
+            }
+         }
+         n = (sx1-sx0) * (sy1-sy0);
+         dst[ y*(scaled->pitch/4) + x ] = SDL_MapRGBA( scaled->format,
+               r/n, g/n, b/n, a/n );
+      }
+   }
+   SDL_UnlockSurface( scaled );
+   SDL_UnlockSurface( surface );
+
+   return scaled;
+}
+
+
 /**
  * @brief Loads the SDL_Surface to a glTexture.
  *
@@ -334,7 +745,9 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
 glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
 {
    glTexture *texture;
-   int rw, rh;
+   int rw, rh, ax, ay;
+   GLuint tex;
+   long lt;
 
    /* set up the texture defaults */
    texture = calloc( 1, sizeof(glTexture) );
@@ -343,8 +756,27 @@ glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
    texture->h     = (double)surface->h;
    texture->sx    = 1.;
    texture->sy    = 1.;
-
-   texture->texture = gl_loadSurface( surface, &rw, &rh, flags );
+   texture->flags = flags;
+
+   /* Try to pack into an atlas. */
+   lt = loadtime_now();
+   tex = 0;
+   if (flags & OPENGL_TEX_ATLAS) {
+      tex = gl_atlasAdd( surface, &ax, &ay );
+      if (tex != 0) {
+         texture->texture = tex;
+         rw = ATLAS_SIZE;
+         rh = ATLAS_SIZE;
+         texture->tox = (double)ax / (double)ATLAS_SIZE;
+         texture->toy = (double)ay / (double)ATLAS_SIZE;
+         SDL_FreeSurface( surface );
+      }
+   }
+   if (tex == 0) {
+      texture->flags &= ~OPENGL_TEX_ATLAS; /* Didn't make it in. */
+      texture->texture = gl_loadSurface( surface, &rw, &rh, flags );
+   }
+   loadtime_account( LOADTIME_GPU, loadtime_now()-lt );
 
    texture->rw    = (double)rw;
    texture->rh    = (double)rh;
@@ -356,10 +788,91 @@ glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
    texture->trans = NULL;
    texture->name  = NULL;
 
+   nmem_count( MEM_TEXTURE, (long)gl_textureEstimate( texture ), +1 );
    return texture;
 }
 
 
+/**
+ * @brief Hashes a texture path into its bucket.
+ *
+ *    @param path Path to hash.
+ *    @return The bucket of the path.
+ */
+static unsigned int gl_texHash( const char *path )
+{
+   unsigned int hash;
+   const char *c;
+
+   hash = 5381; /* djb2, same as the intern pool */
+   for (c=path; *c!='\0'; c++)
+      hash = hash*33 + (unsigned char)*c;
+   return hash & (TEX_HASH_SIZE-1);
+}
+
+
+/**
+ * @brief Adds a list node to the name hash.
+ *
+ *    @param node Node to add.
+ */
+static void gl_texHashAdd( glTexList *node )
+{
+   unsigned int b;
+
+   b = gl_texHash( node->tex->name );
+   node->hnext = tex_hash[b];
+   tex_hash[b] = node;
+}
+
+
+/**
+ * @brief Removes a list node from the name hash, no-op if it isn't in it.
+ *
+ *    @param node Node to remove.
+ */
+static void gl_texHashRemove( glTexList *node )
+{
+   glTexList **pp;
+
+   pp = &tex_hash[ gl_texHash( node->tex->name ) ];
+   while (*pp != NULL) {
+      if (*pp == node) {
+         *pp = node->hnext;
+         node->hnext = NULL;
+         break;
+      }
+      pp = &(*pp)->hnext;
+   }
+
+   if (tex_mru == node)
+      tex_mru = NULL;
+}
+
+
+/**
+ * @brief Looks a texture up by path.
+ *
+ *    @param path Path to look up.
+ *    @return Its list node or NULL if not resident.
+ */
+static glTexList* gl_texLookup( const char *path )
+{
+   glTexList *cur;
+
+   /* Sprite sheet loading hits the same path many times in a row. */
+   if ((tex_mru != NULL) && (strcmp(path,tex_mru->tex->name)==0))
+      return tex_mru;
+
+   for (cur=tex_hash[ gl_texHash(path) ]; cur!=NULL; cur=cur->hnext)
+      if (strcmp(path,cur->tex->name)==0) {
+         tex_mru = cur;
+         return cur;
+      }
+   return NULL;
+}
+
+
 /**
  * @brief Loads an image as a texture.
  *
@@ -374,14 +887,10 @@ glTexture* gl_newImage( const char* path, const unsigned int flags )
    glTexList *cur, *last;
 
    /* check to see if it already exists */
-   if (texture_list != NULL) {
-      for (cur=texture_list; cur!=NULL; cur=cur->next) {
-         if (strcmp(path,cur->tex->name)==0) {
-            cur->used += 1;
-            return cur->tex;
-         }
-         last = cur;
-      }
+   cur = gl_texLookup( path );
+   if (cur != NULL) {
+      cur->used += 1;
+      return cur->tex;
    }
 
    /* Create the new node */
@@ -396,28 +905,88 @@ glTexture* gl_newImage( const char* path, const unsigned int flags )
       return NULL;
    }
 
+   /* Account the memory and make room if needed. */
+   cur->size     = gl_textureEstimate( cur->tex );
+   cur->lastused = 0;
+   tex_memUsed  += cur->size;
+
+   /* Append so the reload path sees a stable list order; only misses
+    * pay for the walk, lookups go through the hash. */
    if (texture_list == NULL) /* special condition - creating new list */
       texture_list = cur;
-   else
+   else {
+      for (last=texture_list; last->next!=NULL; last=last->next);
       last->next = cur;
+   }
+   gl_texHashAdd( cur );
+   tex_mru = cur;
+
+   gl_textureEvict();
 
    return cur->tex;
 }
 
 
 /**
- * @brief Only loads the image, does not add to stack unlike gl_newImage.
+ * @brief Gets a scaled variant of an image, cached like any texture.
+ *
+ * The variant lives in the texture list under "path@WxH", so repeated
+ *  requests share it for the session and it gets atlas-packed with the
+ *  other small images.  Used by the toolkit image arrays to avoid
+ *  rescaling store icons every frame.
  *
  *    @param path Image to load.
+ *    @param w Width to scale to.
+ *    @param h Height to scale to.
  *    @param flags Flags to control image parameters.
- *    @return Texture loaded from image.
+ *    @return Scaled texture.
  */
-static glTexture* gl_loadNewImage( const char* path, const unsigned int flags )
+glTexture* gl_newScaledImage( const char* path, const int w, const int h,
+      const unsigned int flags )
+{
+   char name[PATH_MAX];
+
+   snprintf( name, PATH_MAX, "%s@%dx%d", path, w, h );
+   return gl_newImage( name, flags | OPENGL_TEX_ATLAS );
+}
+
+
+/**
+ * @brief Does the GL-free part of loading an image.
+ *
+ * Reads, decodes, flips and builds the transparency map.  Has no OpenGL
+ *  calls so it is safe to run on a worker thread, see gl_prefetchImage().
+ *
+ *    @param path Image to load.
+ *    @param flags Flags to control image parameters.
+ *    @param[out] ptrans Transparency map or NULL.
+ *    @return Decoded surface ready for gl_loadImage() or NULL on error.
+ */
+static SDL_Surface* gl_decodeSurface( const char* path,
+      const unsigned int flags, uint8_t **ptrans )
 {
    SDL_Surface *temp, *surface;
-   glTexture* t;
-   uint8_t* trans;
    SDL_RWops *rw;
+   long lt;
+   char base[PATH_MAX];
+   char *at;
+   int sw, sh;
+
+   *ptrans = NULL;
+
+   /* Scaled variant names ("img.png@WxH") decode the base image and
+    * box-sample it down, see gl_newScaledImage().  Handled here so the
+    * prefetch and reload paths work on them transparently. */
+   at = strrchr( path, '@' );
+   if ((at != NULL) && (sscanf( at, "@%dx%d", &sw, &sh ) == 2)) {
+      snprintf( base, PATH_MAX, "%.*s", (int)(at-path), path );
+      temp = gl_decodeSurface( base, flags & ~OPENGL_TEX_MAPTRANS, ptrans );
+      if (temp == NULL)
+         return NULL;
+      surface = gl_scaleSurface( temp, sw, sh );
+      SDL_FreeSurface( temp );
+      return surface;
+   }
 
    /* load from packfile */
    rw = ndata_rwops( path );
@@ -425,6 +994,8 @@ static glTexture* gl_loadNewImage( const char* path, const unsigned int flags )
       WARN("Failed to load surface '%s' from ndata.", path);
       return NULL;
    }
+   /* Decode includes its own reads, the rwops pulls as it goes. */
+   lt = loadtime_now();
    temp = IMG_Load_RW( rw, 1 );
 
    if (temp == NULL) {
@@ -448,16 +1019,152 @@ static glTexture* gl_loadNewImage( const char* path, const unsigned int flags )
 
    /* do after flipping for collision detection */
    if (flags & OPENGL_TEX_MAPTRANS) {
-      SDL_LockSurface(surface);
-      trans = SDL_MapTrans(surface);
-      SDL_UnlockSurface(surface);
+      /* The per-pixel scan is expensive, try the disk cache first. */
+      *ptrans = gl_transLoadCache( path, surface->w, surface->h );
+      if (*ptrans == NULL) {
+         SDL_LockSurface(surface);
+         *ptrans = SDL_MapTrans(surface);
+         SDL_UnlockSurface(surface);
+         if (*ptrans != NULL)
+            gl_transSaveCache( path, surface->w, surface->h, *ptrans );
+      }
+   }
+   loadtime_account( LOADTIME_DECODE, loadtime_now()-lt );
+
+   return surface;
+}
+
+
+/**
+ * @brief Worker side of a prefetch, just the decode.
+ */
+static int gl_prefetchThread( void *data )
+{
+   glTexPrefetch *p = (glTexPrefetch*) data;
+   p->surface = gl_decodeSurface( p->path, p->flags, &p->trans );
+   return 0;
+}
+
+
+/**
+ * @brief Starts decoding an image on a worker thread ahead of use.
+ *
+ * The next gl_newImage() of the same path picks the decoded surface up
+ *  and only does the GPU upload.  Call with the same flags the real load
+ *  will use or the transparency map may be missing.  A no-op if the
+ *  texture is already loaded or being prefetched.
+ *
+ *    @param path Image to prefetch.
+ *    @param flags Flags the load will use.
+ */
+void gl_prefetchImage( const char* path, const unsigned int flags )
+{
+   glTexPrefetch *p;
+
+   /* Already resident. */
+   if (gl_texLookup( path ) != NULL)
+      return;
+
+   /* Already in flight. */
+   for (p=tex_prefetch; p!=NULL; p=p->next)
+      if (strcmp(path,p->path)==0)
+         return;
+
+   gl_prefetchSpawn( path, flags );
+}
+
+
+/**
+ * @brief Starts a decode worker for a path, no duplicate checks.
+ *
+ *    @param path Image to decode.
+ *    @param flags Flags the load will use.
+ *    @return The prefetch or NULL if the thread could not be created.
+ */
+static glTexPrefetch* gl_prefetchSpawn( const char* path, unsigned int flags )
+{
+   glTexPrefetch *p;
+
+   p = malloc(sizeof(glTexPrefetch));
+   p->path    = strdup(path);
+   p->flags   = flags;
+   p->surface = NULL;
+   p->trans   = NULL;
+   p->next    = tex_prefetch;
+   tex_prefetch = p;
+   p->thread  = SDL_CreateThread( gl_prefetchThread, p );
+   if (p->thread == NULL) { /* Decode inline when it's actually needed. */
+      tex_prefetch = p->next;
+      free(p->path);
+      free(p);
+      return NULL;
+   }
+   return p;
+}
+
+
+/**
+ * @brief Takes the decoded surface of an in-flight prefetch, if any.
+ *
+ * The join is the synchronization point with the worker.
+ *
+ *    @param path Image the prefetch was started for.
+ *    @param[out] ptrans Transparency map of the prefetch.
+ *    @return The decoded surface or NULL if path is not being prefetched.
+ */
+static SDL_Surface* gl_prefetchTake( const char* path, uint8_t **ptrans )
+{
+   glTexPrefetch *p, *last;
+   SDL_Surface *surface;
+
+   last = NULL;
+   for (p=tex_prefetch; p!=NULL; p=p->next) {
+      if (strcmp(path,p->path)==0) {
+         SDL_WaitThread( p->thread, NULL );
+         surface = p->surface;
+         *ptrans = p->trans;
+         if (last == NULL)
+            tex_prefetch = p->next;
+         else
+            last->next = p->next;
+         free(p->path);
+         free(p);
+         return surface;
+      }
+      last = p;
+   }
+   return NULL;
+}
+
+
+/**
+ * @brief Only loads the image, does not add to stack unlike gl_newImage.
+ *
+ *    @param path Image to load.
+ *    @param flags Flags to control image parameters.
+ *    @return Texture loaded from image.
+ */
+static glTexture* gl_loadNewImage( const char* path, const unsigned int flags )
+{
+   SDL_Surface *surface;
+   glTexture* t;
+   uint8_t* trans;
+
+   /* Use the prefetched decode if there is one. */
+   trans   = NULL;
+   surface = gl_prefetchTake( path, &trans );
+
+   if (surface == NULL) {
+      surface = gl_decodeSurface( path, flags, &trans );
+      if (surface == NULL)
+         return NULL;
    }
-   else
-      trans = NULL;
 
    /* set the texture */
    t = gl_loadImage(surface, flags);
    t->trans = trans;
+   if (trans != NULL)
+      t->btrans = gl_transBlocks( trans, (int)t->w, (int)t->h, &t->bw );
    t->name  = strdup(path);
    return t;
 }
@@ -476,6 +1183,9 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
       const unsigned int flags )
 {
    glTexture* texture;
+   int i, s, n;
+   double shard;
+
    if ((texture = gl_newImage(path, flags)) == NULL)
       return NULL;
 
@@ -487,10 +1197,119 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
    texture->sh    = texture->h/texture->sy;
    texture->srw   = texture->sw / texture->rw;
    texture->srh   = texture->sh / texture->rh;
+
+   /* Precompute the heading lookup so the per-frame sprite selection in
+    *  gl_getSpriteFromDir() is an array index instead of a division. */
+   n = sx*sy;
+   if ((n > 1) && (n <= 256) && (texture->dirmap == NULL)) {
+      shard = 2.*M_PI / n;
+      texture->dirmap = malloc( GL_DIR_LUT );
+      for (i=0; i<GL_DIR_LUT; i++) {
+         s = (int)((i * 2.*M_PI / GL_DIR_LUT + shard/2.) / shard);
+         texture->dirmap[i] = (uint8_t)(s % n);
+      }
+   }
    return texture;
 }
 
 
+/**
+ * @brief Estimates the VRAM a texture occupies.
+ *
+ *    @param tex Texture to estimate.
+ *    @return Estimated size in bytes.
+ */
+static unsigned int gl_textureEstimate( const glTexture *tex )
+{
+   unsigned int size;
+
+   /* Atlas entries only own their slot of the shared atlas. */
+   if (tex->flags & OPENGL_TEX_ATLAS)
+      size = (unsigned int)(tex->w * tex->h) * 4;
+   else
+      size = (unsigned int)(tex->rw * tex->rh) * 4;
+   if (tex->flags & OPENGL_TEX_MIPMAPS)
+      size += size / 3; /* the mipmap chain */
+   return size;
+}
+
+
+/**
+ * @brief Actually destroys a texture.
+ *
+ *    @param texture Texture to destroy.
+ */
+static void gl_textureDestroy( glTexture *texture )
+{
+   nmem_count( MEM_TEXTURE, -(long)gl_textureEstimate( texture ), -1 );
+
+   /* Atlases are shared and outlive their entries. */
+   if (!(texture->flags & OPENGL_TEX_ATLAS))
+      glDeleteTextures( 1, &texture->texture );
+   if (texture->trans != NULL)
+      free(texture->trans);
+   if (texture->btrans != NULL)
+      free(texture->btrans);
+   if (texture->dirmap != NULL)
+      free(texture->dirmap);
+   if (texture->name != NULL)
+      free(texture->name);
+   free(texture);
+}
+
+
+/**
+ * @brief Evicts least recently used unreferenced textures over the budget.
+ *
+ * Atlas entries are never evicted since their atlas slot is not reclaimed
+ *  anyway, keeping them costs nothing extra.
+ */
+static void gl_textureEvict (void)
+{
+   glTexList *cur, *last, *lru, *lrulast;
+   unsigned int budget;
+
+   budget = (unsigned int)MAX(conf.texmem,0) * 1024U * 1024U;
+   while (tex_memUsed > budget) {
+      /* Find the least recently used unreferenced texture. */
+      lru     = NULL;
+      lrulast = NULL;
+      last    = NULL;
+      for (cur=texture_list; cur!=NULL; cur=cur->next) {
+         if ((cur->used <= 0) && !(cur->tex->flags & OPENGL_TEX_ATLAS) &&
+               ((lru == NULL) || (cur->lastused < lru->lastused))) {
+            lru     = cur;
+            lrulast = last;
+         }
+         last = cur;
+      }
+      if (lru == NULL)
+         break; /* everything left is referenced */
+
+      /* Unlink and destroy it. */
+      if (lrulast == NULL)
+         texture_list = lru->next;
+      else
+         lrulast->next = lru->next;
+      gl_texHashRemove( lru );
+      tex_memUsed -= lru->size;
+      gl_textureDestroy( lru->tex );
+      free(lru);
+   }
+}
+
+
+/**
+ * @brief Gets the estimated VRAM held by loaded textures.
+ *
+ *    @return Estimated texture memory usage in bytes.
+ */
+unsigned int gl_textureMemory (void)
+{
+   return tex_memUsed;
+}
+
+
 /**
  * @brief Frees a texture.
  *
@@ -498,7 +1317,7 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
  */
 void gl_freeTexture( glTexture* texture )
 {
-   glTexList *cur, *last;
+   glTexList *cur;
 
    /* Shouldn't be NULL (won't segfault though) */
    if (texture == NULL) {
@@ -507,33 +1326,17 @@ void gl_freeTexture( glTexture* texture )
    }
 
    /* see if we can find it in stack */
-   last = NULL;
    for (cur=texture_list; cur!=NULL; cur=cur->next) {
       if (cur->tex == texture) { /* found it */
          cur->used--;
-         if (cur->used <= 0) { /* not used anymore */
-            /* free the texture */
-            glDeleteTextures( 1, &texture->texture );
-            if (texture->trans != NULL)
-               free(texture->trans);
-            if (texture->name != NULL)
-               free(texture->name);
-            free(texture);
-
-            /* free the list node */
-            if (last == NULL) { /* case there's no texture before it */
-               if (cur->next != NULL)
-                  texture_list = cur->next;
-               else /* case it's the last texture */
-                  texture_list = NULL;
-            }
-            else
-               last->next = cur->next;
-            free(cur);
+         if (cur->used <= 0) {
+            /* Unreferenced textures stay cached until the memory budget
+             * pushes them out, so revisiting a system reuses them. */
+            cur->lastused = ++tex_clock;
+            gl_textureEvict();
          }
          return; /* we already found it so we can exit */
       }
-      last = cur;
    }
 
    /* Not found */
@@ -541,10 +1344,7 @@ void gl_freeTexture( glTexture* texture )
       WARN("Attempting to free texture '%s' not found in stack!", texture->name);
 
    /* Free anyways */
-   glDeleteTextures( 1, &texture->texture );
-   if (texture->trans != NULL) free(texture->trans);
-   if (texture->name != NULL) free(texture->name);
-   free(texture);
+   gl_textureDestroy( texture );
 
    gl_checkErr();
 }
@@ -580,25 +1380,6 @@ glTexture* gl_dupTexture( glTexture *texture )
 }
 
 
-/**
- * @brief Checks to see if a pixel is transparent in a texture.
- *
- *    @param t Texture to check for transparency.
- *    @param x X position of the pixel.
- *    @param y Y position of the pixel.
- *    @return 1 if the pixel is transparent or 0 if it isn't.
- */
-int gl_isTrans( const glTexture* t, const int x, const int y )
-{
-   int i;
-
-   /* Get the position in the sheet. */
-   i = y*(int)(t->w) + x ;
-   /* Now we have to pull out the individual bit. */
-   return !(t->trans[ i/8 ] & (1 << (i%8)));
-}
-
-
 /**
  * @brief Sets x and y to be the appropriate sprite for glTexture using dir.
  *
@@ -622,16 +1403,25 @@ void gl_getSpriteFromDir( int* x, int* y, const glTexture* t, const double dir )
    }
 #endif /* DEBUGGING */
 
+   sx = t->sx;
+   sy = t->sy;
+
+   /* Hot path - quantized heading indexes the precomputed table. */
+   if (t->dirmap != NULL) {
+      s = t->dirmap[ (int)(dir * (GL_DIR_LUT / (2.*M_PI))) & (GL_DIR_LUT-1) ];
+      (*x) = s % sx;
+      (*y) = s / sx;
+      return;
+   }
+
    /* what each image represents in angle */
    shard = 2.*M_PI / (t->sy*t->sx);
 
    /* real dir is slightly moved downwards */
    rdir = dir + shard/2.;
-  
+
    /* now calculate the sprite we need */
    s = (int)(rdir / shard);
-   sx = t->sx;
-   sy = t->sy;
 
    /* makes sure the sprite is "in range" */
    if (s > (sy*sx-1))
@@ -642,6 +1432,98 @@ void gl_getSpriteFromDir( int* x, int* y, const glTexture* t, const double dir )
 }
 
 
+/**
+ * @brief Re-uploads every live texture after a video mode change.
+ *
+ * SDL may lose the GL context when the mode changes, invalidating every
+ *  texture object.  Rather than sending each user back through the full
+ *  gl_newImage() decode path, decode all the named textures in parallel
+ *  on worker threads and re-upload them in bulk, keeping the glTexture
+ *  pointers everybody holds valid.
+ */
+void gl_reloadTextures (void)
+{
+   glTexList *cur;
+   glTexAtlas *a, *anext;
+   glTexture *t;
+   SDL_Surface *surface;
+   uint8_t *trans;
+   GLuint tex;
+   int rw, rh, ax, ay;
+
+   /* The staging buffer died with the old context, it recreates lazily. */
+   if (tex_pbo != 0) {
+      nglDeleteBuffers( 1, &tex_pbo );
+      tex_pbo = 0;
+   }
+
+   /* Atlases can't be patched entry by entry, rebuild from scratch. */
+   for (a=atlas_list; a!=NULL; a=anext) {
+      anext = a->next;
+      glDeleteTextures( 1, &a->texture );
+      free(a);
+   }
+   atlas_list = NULL;
+
+   /* Get every decode running before the first upload waits on one.  The
+    * transparency maps are still good, don't rebuild those. */
+   for (cur=texture_list; cur!=NULL; cur=cur->next)
+      gl_prefetchSpawn( cur->tex->name,
+            cur->tex->flags & ~OPENGL_TEX_MAPTRANS );
+
+   /* Re-upload in list order so the atlases pack the same way. */
+   for (cur=texture_list; cur!=NULL; cur=cur->next) {
+      t = cur->tex;
+
+      trans   = NULL;
+      surface = gl_prefetchTake( t->name, &trans );
+      if (surface == NULL)
+         surface = gl_decodeSurface( t->name,
+               t->flags & ~OPENGL_TEX_MAPTRANS, &trans );
+      if (trans != NULL)
+         free(trans);
+      if (surface == NULL) {
+         WARN("Unable to reload texture '%s'.", t->name);
+         continue;
+      }
+
+      if (t->flags & OPENGL_TEX_ATLAS) {
+         tex = gl_atlasAdd( surface, &ax, &ay );
+         if (tex != 0) {
+            t->texture = tex;
+            t->tox = (double)ax / (double)ATLAS_SIZE;
+            t->toy = (double)ay / (double)ATLAS_SIZE;
+            SDL_FreeSurface( surface );
+            continue;
+         }
+
+         /* Didn't fit this time, demote to a standalone texture. */
+         t->flags  &= ~OPENGL_TEX_ATLAS;
+         t->texture = gl_loadSurface( surface, &rw, &rh, t->flags );
+         t->rw  = (double)rw;
+         t->rh  = (double)rh;
+         t->tox = 0.;
+         t->toy = 0.;
+         t->srw = t->sw / t->rw;
+         t->srh = t->sh / t->rh;
+
+         /* Standalone pays for the POT padding, reaccount. */
+         tex_memUsed -= cur->size;
+         nmem_count( MEM_TEXTURE, -(long)cur->size, -1 );
+         cur->size    = gl_textureEstimate( t );
+         tex_memUsed += cur->size;
+         nmem_count( MEM_TEXTURE, (long)cur->size, +1 );
+      }
+      else {
+         /* Stale names from a lost context are silently ignored. */
+         glDeleteTextures( 1, &t->texture );
+         t->texture = gl_loadSurface( surface, NULL, NULL, t->flags );
+      }
+   }
+   gl_checkErr();
+}
+
+
 /**
  * @brief Initializes the opengl texture subsystem.
  *
@@ -658,7 +1540,54 @@ int gl_initTextures (void)
  */
 void gl_exitTextures (void)
 {
-   glTexList *tex;
+   glTexList *tex, *texnext, *texlast;
+   glTexAtlas *atlas, *next;
+   glTexPrefetch *p, *pnext;
+
+   /* Drain prefetches nobody picked up. */
+   for (p=tex_prefetch; p!=NULL; p=pnext) {
+      pnext = p->next;
+      SDL_WaitThread( p->thread, NULL );
+      if (p->surface != NULL)
+         SDL_FreeSurface( p->surface );
+      if (p->trans != NULL)
+         free( p->trans );
+      free( p->path );
+      free( p );
+   }
+   tex_prefetch = NULL;
+
+   /* Free the upload pixel buffer. */
+   if (tex_pbo != 0) {
+      nglDeleteBuffers( 1, &tex_pbo );
+      tex_pbo = 0;
+   }
+
+   /* Flush the unreferenced cached textures. */
+   texlast = NULL;
+   for (tex=texture_list; tex!=NULL; tex=texnext) {
+      texnext = tex->next;
+      if (tex->used <= 0) {
+         gl_texHashRemove( tex );
+         tex_memUsed -= tex->size;
+         gl_textureDestroy( tex->tex );
+         if (texlast == NULL)
+            texture_list = texnext;
+         else
+            texlast->next = texnext;
+         free(tex);
+      }
+      else
+         texlast = tex;
+   }
+
+   /* Free the atlases. */
+   for (atlas=atlas_list; atlas!=NULL; atlas=next) {
+      next = atlas->next;
+      glDeleteTextures( 1, &atlas->texture );
+      free(atlas);
+   }
+   atlas_list = NULL;
 
    /* Make sure there's no texture leak */
    if (texture_list != NULL) {
@@ -38,6 +38,7 @@
  */
 #define OPENGL_TEX_MAPTRANS   (1<<0) /**< Create a transparency map. */
 #define OPENGL_TEX_MIPMAPS    (1<<1) /**< Creates mipmaps. */
+#define OPENGL_TEX_ATLAS      (1<<2) /**< May be packed into a shared atlas. */
 
 /**
  * @brief Abstraction for rendering spriteshets.
@@ -60,10 +61,15 @@ typedef struct glTexture_ {
    double sh; /**< Height of a sprite. */
    double srw; /**< Sprite render width - equivalent to sw/rw. */
    double srh; /**< Sprite render height - equivalent to sh/rh. */
+   double tox; /**< Texture coordinate x offset, non-zero when in an atlas. */
+   double toy; /**< Texture coordinate y offset, non-zero when in an atlas. */
 
    /* data */
    GLuint texture; /**< the opengl texture itself */
    uint8_t* trans; /**< maps the transparency */
+   uint8_t* btrans; /**< coarse 8x8 block occupancy of the transparency map */
+   int bw; /**< width of btrans in blocks */
+   uint8_t* dirmap; /**< quantized heading to sprite index, built by gl_newSprite */
 
    /* properties */
    uint8_t flags; /**< flags used for texture properties */
@@ -88,6 +94,9 @@ SDL_Surface* gl_prepareSurface( SDL_Surface* surface ); /* Only preps it */
  */
 glTexture* gl_loadImage( SDL_Surface* surface, const unsigned int flags ); /* Frees the surface. */
 glTexture* gl_newImage( const char* path, const unsigned int flags );
+glTexture* gl_newScaledImage( const char* path, const int w, const int h,
+      const unsigned int flags );
+void gl_prefetchImage( const char* path, const unsigned int flags );
 glTexture* gl_newSprite( const char* path, const int sx, const int sy,
       const unsigned int flags );
 glTexture* gl_dupTexture( glTexture *texture );
@@ -96,11 +105,18 @@ glTexture* gl_dupTexture( glTexture *texture );
  * Clean up.
  */
 void gl_freeTexture( glTexture* texture );
+unsigned int gl_textureMemory (void);
+void gl_reloadTextures (void);
 
 /*
  * Misc.
  */
+uint8_t* gl_transBlocks( const uint8_t *trans, int w, int h, int *bw );
 int gl_isTrans( const glTexture* t, const int x, const int y );
+int gl_isTransArea( const glTexture* t, const int x0, const int y0,
+      const int x1, const int y1 );
+uint32_t gl_transRowMask( const glTexture* t, const int x, const int y,
+      const int n );
 void gl_getSpriteFromDir( int* x, int* y, const glTexture* t, const double dir );
 
 
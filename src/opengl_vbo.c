@@ -6,6 +6,13 @@
  * @file opengl_vbo.c
  *
  * @brief Handles OpenGL vbos.
+ *
+ * Capability is resolved once in gl_initVBO() into a small dispatch
+ *  table, like the sound backends: the public functions call through
+ *  function pointers set to either the real VBO primitives or the
+ *  client-array fallback, so the hot paths carry no availability
+ *  branches.  The fallback still draws batched from system memory
+ *  arrays, only the storage differs.
  */
 
 
@@ -40,13 +47,46 @@ struct gl_vbo_s {
 };
 
 
-static int has_vbo = 0; /**< Whether or not has VBO. */
-
-
-/**
+/*
  * Prototypes.
  */
 static gl_vbo* gl_vboCreate( GLenum target, GLsizei size, void* data, GLenum usage );
+static GLenum gl_vboUsage( const gl_vbo *vbo );
+/* Hardware VBO primitives. */
+static void vbo_hw_init( gl_vbo *vbo, GLenum target, GLsizei size, void* data, GLenum usage );
+static void vbo_hw_data( gl_vbo *vbo, GLsizei size, void* data );
+static void vbo_hw_orphan( gl_vbo *vbo );
+static void vbo_hw_subData( gl_vbo *vbo, GLint offset, GLsizei size, void* data );
+static void* vbo_hw_map( gl_vbo *vbo );
+static void vbo_hw_unmap( gl_vbo *vbo );
+static const GLvoid* vbo_hw_pointer( gl_vbo *vbo, GLuint offset );
+static void vbo_hw_unbind (void);
+static void vbo_hw_free( gl_vbo *vbo );
+/* Client-array fallback primitives. */
+static void vbo_sw_init( gl_vbo *vbo, GLenum target, GLsizei size, void* data, GLenum usage );
+static void vbo_sw_data( gl_vbo *vbo, GLsizei size, void* data );
+static void vbo_sw_orphan( gl_vbo *vbo );
+static void vbo_sw_subData( gl_vbo *vbo, GLint offset, GLsizei size, void* data );
+static void* vbo_sw_map( gl_vbo *vbo );
+static void vbo_sw_unmap( gl_vbo *vbo );
+static const GLvoid* vbo_sw_pointer( gl_vbo *vbo, GLuint offset );
+static void vbo_sw_unbind (void);
+static void vbo_sw_free( gl_vbo *vbo );
+
+
+/*
+ * Dispatch table, defaults to the fallback so creation before
+ *  gl_initVBO() stays safe.
+ */
+static void (*vbo_sys_init)( gl_vbo*, GLenum, GLsizei, void*, GLenum ) = vbo_sw_init; /**< Initial storage. */
+static void (*vbo_sys_data)( gl_vbo*, GLsizei, void* )     = vbo_sw_data; /**< Full (re)specify. */
+static void (*vbo_sys_orphan)( gl_vbo* )                   = vbo_sw_orphan; /**< Storage orphaning. */
+static void (*vbo_sys_subData)( gl_vbo*, GLint, GLsizei, void* ) = vbo_sw_subData; /**< Partial update. */
+static void* (*vbo_sys_map)( gl_vbo* )                     = vbo_sw_map; /**< Map for writing. */
+static void (*vbo_sys_unmap)( gl_vbo* )                    = vbo_sw_unmap; /**< Unmap. */
+static const GLvoid* (*vbo_sys_pointer)( gl_vbo*, GLuint ) = vbo_sw_pointer; /**< Bind + array pointer. */
+static void (*vbo_sys_unbind)(void)                        = vbo_sw_unbind; /**< Unbind for deactivate. */
+static void (*vbo_sys_free)( gl_vbo* )                     = vbo_sw_free; /**< Release storage. */
 
 
 /**
@@ -56,8 +96,17 @@ static gl_vbo* gl_vboCreate( GLenum target, GLsizei size, void* data, GLenum usa
  */
 int gl_initVBO (void)
 {
-   if (nglGenBuffers != NULL)
-      has_vbo = 1;
+   if (nglGenBuffers != NULL) {
+      vbo_sys_init    = vbo_hw_init;
+      vbo_sys_data    = vbo_hw_data;
+      vbo_sys_orphan  = vbo_hw_orphan;
+      vbo_sys_subData = vbo_hw_subData;
+      vbo_sys_map     = vbo_hw_map;
+      vbo_sys_unmap   = vbo_hw_unmap;
+      vbo_sys_pointer = vbo_hw_pointer;
+      vbo_sys_unbind  = vbo_hw_unbind;
+      vbo_sys_free    = vbo_hw_free;
+   }
 
    return 0;
 }
@@ -68,7 +117,130 @@ int gl_initVBO (void)
  */
 void gl_exitVBO (void)
 {
-   has_vbo = 0;
+   vbo_sys_init    = vbo_sw_init;
+   vbo_sys_data    = vbo_sw_data;
+   vbo_sys_orphan  = vbo_sw_orphan;
+   vbo_sys_subData = vbo_sw_subData;
+   vbo_sys_map     = vbo_sw_map;
+   vbo_sys_unmap   = vbo_sw_unmap;
+   vbo_sys_pointer = vbo_sw_pointer;
+   vbo_sys_unbind  = vbo_sw_unbind;
+   vbo_sys_free    = vbo_sw_free;
+}
+
+
+/**
+ * @brief Gets the buffer usage matching the VBO's type.
+ *
+ *    @param vbo VBO to get the usage of.
+ *    @return The GL usage hint.
+ */
+static GLenum gl_vboUsage( const gl_vbo *vbo )
+{
+   return (vbo->type == NGL_VBO_STATIC) ? GL_STATIC_DRAW : GL_STREAM_DRAW;
+}
+
+
+/*
+ * Hardware VBO primitives.
+ */
+static void vbo_hw_init( gl_vbo *vbo, GLenum target, GLsizei size, void* data, GLenum usage )
+{
+   nglGenBuffers( 1, &vbo->id );
+   nglBindBuffer( target, vbo->id );
+   nglBufferData( target, size, data, usage );
+   nglBindBuffer( target, 0 );
+}
+static void vbo_hw_data( gl_vbo *vbo, GLsizei size, void* data )
+{
+   nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
+   nglBufferData( GL_ARRAY_BUFFER, size, data, gl_vboUsage(vbo) );
+}
+static void vbo_hw_orphan( gl_vbo *vbo )
+{
+   if (vbo->type != NGL_VBO_STREAM)
+      return;
+   nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
+   nglBufferData( GL_ARRAY_BUFFER, vbo->size, NULL, GL_STREAM_DRAW );
+}
+static void vbo_hw_subData( gl_vbo *vbo, GLint offset, GLsizei size, void* data )
+{
+   nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
+   nglBufferSubData( GL_ARRAY_BUFFER, offset, size, data );
+}
+static void* vbo_hw_map( gl_vbo *vbo )
+{
+   nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
+   return nglMapBuffer( GL_ARRAY_BUFFER, GL_WRITE_ONLY );
+}
+static void vbo_hw_unmap( gl_vbo *vbo )
+{
+   (void) vbo;
+   nglUnmapBuffer( GL_ARRAY_BUFFER );
+}
+static const GLvoid* vbo_hw_pointer( gl_vbo *vbo, GLuint offset )
+{
+   nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
+   return BUFFER_OFFSET(offset);
+}
+static void vbo_hw_unbind (void)
+{
+   nglBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+static void vbo_hw_free( gl_vbo *vbo )
+{
+   nglDeleteBuffers( 1, &vbo->id );
+}
+
+
+/*
+ * Client-array fallback primitives, batched draws out of system memory.
+ */
+static void vbo_sw_init( gl_vbo *vbo, GLenum target, GLsizei size, void* data, GLenum usage )
+{
+   (void) target;
+   (void) usage;
+   vbo->data = malloc(size);
+   if (data == NULL)
+      memset( vbo->data, 0, size );
+   else
+      memcpy( vbo->data, data, size );
+}
+static void vbo_sw_data( gl_vbo *vbo, GLsizei size, void* data )
+{
+   /* Grow memory. */
+   vbo->data = realloc( vbo->data, size );
+   if (data == NULL)
+      memset( vbo->data, 0, size );
+   else
+      memcpy( vbo->data, data, size );
+}
+static void vbo_sw_orphan( gl_vbo *vbo )
+{
+   (void) vbo; /* Nothing to synchronise against. */
+}
+static void vbo_sw_subData( gl_vbo *vbo, GLint offset, GLsizei size, void* data )
+{
+   memcpy( &vbo->data[offset], data, size );
+}
+static void* vbo_sw_map( gl_vbo *vbo )
+{
+   return vbo->data;
+}
+static void vbo_sw_unmap( gl_vbo *vbo )
+{
+   (void) vbo;
+}
+static const GLvoid* vbo_sw_pointer( gl_vbo *vbo, GLuint offset )
+{
+   return &vbo->data[offset];
+}
+static void vbo_sw_unbind (void)
+{
+}
+static void vbo_sw_free( gl_vbo *vbo )
+{
+   free(vbo->data);
 }
 
 
@@ -92,23 +264,7 @@ static gl_vbo* gl_vboCreate( GLenum target, GLsizei size, void* data, GLenum usa
    /* General stuff. */
    vbo->size = size;
 
-   if (has_vbo) {
-      /* Create the buffer. */
-      nglGenBuffers( 1, &vbo->id );
-
-      /* Upload the data. */
-      nglBindBuffer( target, vbo->id );
-      nglBufferData( target, size, data, usage );
-      nglBindBuffer( target, 0 );
-   }
-   else {
-      vbo->size = size;
-      vbo->data = malloc(size);
-      if (data == NULL)
-         memset( vbo->data, 0, size );
-      else
-         memcpy( vbo->data, data, size );
-   }
+   vbo_sys_init( vbo, target, size, data, usage );
 
    /* Check for errors. */
    gl_checkErr();
@@ -126,29 +282,29 @@ static gl_vbo* gl_vboCreate( GLenum target, GLsizei size, void* data, GLenum usa
  */
 void gl_vboData( gl_vbo *vbo, GLsizei size, void* data )
 {
-   GLenum usage;
-
    vbo->size = size;
+   vbo_sys_data( vbo, size, data );
 
-   if (has_vbo) {
-      /* Get usage. */
-      if (vbo->type == NGL_VBO_STREAM)
-         usage = GL_STREAM_DRAW;
-      else if (vbo->type == NGL_VBO_STATIC)
-         usage = GL_STATIC_DRAW;
+   /* Check for errors. */
+   gl_checkErr();
+}
 
-      /* Get new data. */
-      nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
-      nglBufferData( GL_ARRAY_BUFFER, size, data, usage );
-   }
-   else {
-      /* Grow memory. */
-      vbo->data = realloc( vbo->data, size );
-      if (data == NULL)
-         memset( vbo->data, 0, size );
-      else
-         memcpy( vbo->data, data, size );
-   }
+
+/**
+ * @brief Orphans a stream VBO's storage.
+ *
+ * Re-specifies the buffer so the following writes get fresh memory
+ *  instead of synchronising against draws still reading last frame's
+ *  contents; the driver frees the old block once the GPU is done.  Call
+ *  before rewriting the buffer each frame.  Previous contents are lost,
+ *  so only full rewrites may orphan.  A no-op for static VBOs and the
+ *  client-array fallback.
+ *
+ *    @param vbo VBO to orphan.
+ */
+void gl_vboOrphan( gl_vbo *vbo )
+{
+   vbo_sys_orphan( vbo );
 
    /* Check for errors. */
    gl_checkErr();
@@ -165,13 +321,7 @@ void gl_vboData( gl_vbo *vbo, GLsizei size, void* data )
  */
 void gl_vboSubData( gl_vbo *vbo, GLint offset, GLsizei size, void* data )
 {
-   if (has_vbo) {
-      nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
-      nglBufferSubData( GL_ARRAY_BUFFER, offset, size, data );
-   }
-   else {
-      memcpy( &vbo->data[offset], data, size );
-   }
+   vbo_sys_subData( vbo, offset, size, data );
 
    /* Check for errors. */
    gl_checkErr();
@@ -187,7 +337,7 @@ void gl_vboSubData( gl_vbo *vbo, GLint offset, GLsizei size, void* data )
 gl_vbo* gl_vboCreateStream( GLsizei size, void* data )
 {
    gl_vbo *vbo;
-   
+
    vbo = gl_vboCreate( GL_ARRAY_BUFFER, size, data, GL_STREAM_DRAW );
    vbo->type = NGL_VBO_STREAM;
 
@@ -207,7 +357,7 @@ gl_vbo* gl_vboCreateStream( GLsizei size, void* data )
 gl_vbo* gl_vboCreateStatic( GLsizei size, void* data )
 {
    gl_vbo *vbo;
-   
+
    vbo = gl_vboCreate( GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW );
    vbo->type = NGL_VBO_STATIC;
 
@@ -226,12 +376,7 @@ gl_vbo* gl_vboCreateStatic( GLsizei size, void* data )
  */
 void* gl_vboMap( gl_vbo *vbo )
 {
-   if (has_vbo) {
-      nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
-      return nglMapBuffer( GL_ARRAY_BUFFER, GL_WRITE_ONLY );
-   }
-   else
-      return vbo->data;
+   return vbo_sys_map( vbo );
 }
 
 
@@ -242,9 +387,7 @@ void* gl_vboMap( gl_vbo *vbo )
  */
 void gl_vboUnmap( gl_vbo *vbo )
 {
-   (void) vbo;
-   if (has_vbo)
-      nglUnmapBuffer( GL_ARRAY_BUFFER );
+   vbo_sys_unmap( vbo );
 
    /* Check for errors. */
    gl_checkErr();
@@ -283,12 +426,7 @@ void gl_vboActivateOffset( gl_vbo *vbo, GLuint class, GLuint offset,
    const GLvoid *pointer;
 
    /* Set up. */
-   if (has_vbo) {
-      nglBindBuffer( GL_ARRAY_BUFFER, vbo->id );
-      pointer = BUFFER_OFFSET(offset);
-   }
-   else
-      pointer = &vbo->data[offset];
+   pointer = vbo_sys_pointer( vbo, offset );
 
    /* Class specific. */
    switch (class) {
@@ -309,13 +447,13 @@ void gl_vboActivateOffset( gl_vbo *vbo, GLuint class, GLuint offset,
 
       case GL_TEXTURE0:
          nglClientActiveTexture( GL_TEXTURE0 );
-         glEnableClientState(GL_TEXTURE_COORD_ARRAY); 
+         glEnableClientState(GL_TEXTURE_COORD_ARRAY);
          glTexCoordPointer( size, type, stride, pointer );
          break;
 
       case GL_TEXTURE1:
          nglClientActiveTexture( GL_TEXTURE1 );
-         glEnableClientState(GL_TEXTURE_COORD_ARRAY); 
+         glEnableClientState(GL_TEXTURE_COORD_ARRAY);
          glTexCoordPointer( size, type, stride, pointer );
          break;
 
@@ -334,8 +472,7 @@ void gl_vboActivateOffset( gl_vbo *vbo, GLuint class, GLuint offset,
  */
 void gl_vboDeactivate (void)
 {
-   if (has_vbo)
-      nglBindBuffer(GL_ARRAY_BUFFER, 0);
+   vbo_sys_unbind();
    glDisableClientState(GL_VERTEX_ARRAY);
    glDisableClientState(GL_COLOR_ARRAY);
    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -358,11 +495,7 @@ void gl_vboDeactivate (void)
  */
 void gl_vboDestroy( gl_vbo *vbo )
 {
-   if (has_vbo)
-      /* Destroy VBO. */
-      nglDeleteBuffers( 1, &vbo->id );
-   else
-      free(vbo->data);
+   vbo_sys_free( vbo );
 
    /* Check for errors. */
    gl_checkErr();
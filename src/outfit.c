@@ -27,6 +27,7 @@
 #include "ndata.h"
 #include "spfx.h"
 #include "array.h"
+#include "strhash.h"
 
 
 #define outfit_setProp(o,p)      ((o)->properties |= p) /**< Checks outfit property. */
@@ -49,6 +50,7 @@
  * the stack
  */
 static Outfit* outfit_stack = NULL; /**< Stack of outfits. */
+static StrHash* outfit_hash = NULL; /**< Name index of the outfit stack. */
 
 
 /*
@@ -83,6 +85,15 @@ static void outfit_parseSLicense( Outfit *temp, const xmlNodePtr parent );
 Outfit* outfit_get( const char* name )
 {
    int i;
+   Outfit *o;
+
+   /* Hash is built once loading finishes. */
+   if (outfit_hash != NULL) {
+      o = strhash_get( outfit_hash, name );
+      if (o != NULL)
+         return o;
+   }
+
    for (i=0; i<array_size(outfit_stack); i++)
       if (strcmp(name,outfit_stack[i].name)==0)
          return &outfit_stack[i];
@@ -180,6 +191,30 @@ Outfit** outfit_getTech( int *n, const int *tech, const int techmax )
 }
 
 
+/**
+ * @brief Resolved damage modifiers of a damage type.
+ */
+typedef struct OutfitDamageMod_ {
+   double shield; /**< Shield damage multiplier. */
+   double armour; /**< Armour damage multiplier. */
+   double knockback; /**< Knockback modifier. */
+} OutfitDamageMod;
+
+/**
+ * Damage resolution table, indexed by DamageType.  The hit path runs this
+ *  for every single impact so it's a straight lookup and multiply instead
+ *  of a branch per type.
+ */
+static const OutfitDamageMod outfit_dmgMod[] = {
+   { 0.,   0.,  0.  }, /* DAMAGE_TYPE_NULL */
+   { 1.1,  0.7, 0.1 }, /* DAMAGE_TYPE_ENERGY */
+   { 0.8,  1.2, 1.  }, /* DAMAGE_TYPE_KINETIC */
+   { 1.,   1.,  0.4 }, /* DAMAGE_TYPE_ION */
+   { 0.15, 1.,  0.8 }, /* DAMAGE_TYPE_RADIATION, still takes damage, just not much */
+   { 0.6,  1.3, 0.  }  /* DAMAGE_TYPE_EMP */
+};
+
+
 /**
  * @brief Gives the real shield damage, armour damage and knockback modifier.
  *
@@ -192,43 +227,20 @@ Outfit** outfit_getTech( int *n, const int *tech, const int techmax )
 void outfit_calcDamage( double *dshield, double *darmour, double *knockback,
       DamageType dtype, double dmg )
 {
-   double ds, da, kn;
-   switch (dtype) {
-      case DAMAGE_TYPE_ENERGY:
-         ds = dmg*1.1;
-         da = dmg*0.7;
-         kn = 0.1;
-         break;
-      case DAMAGE_TYPE_KINETIC:
-         ds = dmg*0.8;
-         da = dmg*1.2;
-         kn = 1.;
-         break;
-      case DAMAGE_TYPE_ION:
-         ds = dmg;
-         da = dmg;
-         kn = 0.4;
-         break;
-      case DAMAGE_TYPE_RADIATION:
-         ds = dmg*0.15; /* still take damage, just not much */
-         da = dmg;
-         kn = 0.8;
-         break;
-      case DAMAGE_TYPE_EMP:
-         ds = dmg*0.6;
-         da = dmg*1.3;
-         kn = 0.;
-         break;
-
-      default:
-         WARN("Unknown damage type: %d!", dtype);
-         da = ds = kn = 0.;
-         break;
+   const OutfitDamageMod *mod;
+
+   if ((dtype <= DAMAGE_TYPE_NULL) || (dtype > DAMAGE_TYPE_EMP)) {
+      WARN("Unknown damage type: %d!", dtype);
+      if (dshield) *dshield = 0.;
+      if (darmour) *darmour = 0.;
+      if (knockback) *knockback = 0.;
+      return;
    }
 
-   if (dshield) *dshield = ds;
-   if (darmour) *darmour = da;
-   if (knockback) *knockback = kn;
+   mod = &outfit_dmgMod[ dtype ];
+   if (dshield) *dshield = dmg * mod->shield;
+   if (darmour) *darmour = dmg * mod->armour;
+   if (knockback) *knockback = mod->knockback;
 }
 
 
@@ -753,7 +765,7 @@ static void outfit_parseSBolt( Outfit* temp, const xmlNodePtr parent )
       if (xml_isNode(node,"gfx")) {
          temp->u.blt.gfx_space = xml_parseTexture( node,
                OUTFIT_GFX"space/%s.png", 6, 6,
-               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS ); 
+               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS | OPENGL_TEX_ATLAS ); 
          xmlr_attr(node, "spin", buf);
          if (buf != NULL) {
             outfit_setProp( temp, OUTFIT_PROP_WEAP_SPIN );
@@ -765,7 +777,7 @@ static void outfit_parseSBolt( Outfit* temp, const xmlNodePtr parent )
       if (xml_isNode(node,"gfx_end")) {
          temp->u.blt.gfx_end = xml_parseTexture( node,
                OUTFIT_GFX"space/%s.png", 6, 6,
-               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS ); 
+               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS | OPENGL_TEX_ATLAS ); 
          continue;
       }
 
@@ -1028,7 +1040,7 @@ static void outfit_parseSAmmo( Outfit* temp, const xmlNodePtr parent )
       if (xml_isNode(node,"gfx")) {
          temp->u.amm.gfx_space = xml_parseTexture( node,
                OUTFIT_GFX"space/%s.png", 6, 6,
-               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS );
+               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS | OPENGL_TEX_ATLAS );
          xmlr_attr(node, "spin", buf);
          if (buf != NULL) {
             outfit_setProp( temp, OUTFIT_PROP_WEAP_SPIN );
@@ -1445,7 +1457,8 @@ static int outfit_parse( Outfit* temp, const xmlNodePtr parent )
             xmlr_strd(cur,"typename",temp->typename);
             if (xml_isNode(cur,"gfx_store")) {
                temp->gfx_store = xml_parseTexture( cur,
-                     OUTFIT_GFX"store/%s.png", 1, 1, OPENGL_TEX_MIPMAPS );
+                     OUTFIT_GFX"store/%s.png", 1, 1,
+                     OPENGL_TEX_MIPMAPS | OPENGL_TEX_ATLAS );
             }
             else if (xml_isNode(cur,"slot")) {
                cprop = xml_get(cur);
@@ -1532,7 +1545,7 @@ int outfit_load (void)
    char *buf = ndata_read( OUTFIT_DATA, &bufsize );
 
    xmlNodePtr node;
-   xmlDocPtr doc = xmlParseMemory( buf, bufsize );
+   xmlDocPtr doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (!xml_isNode(node,XML_OUTFIT_ID)) {
@@ -1554,6 +1567,10 @@ int outfit_load (void)
    } while (xml_nextNode(node));
    array_shrink(&outfit_stack);
 
+   /* Build the name index, the stack won't move any more. */
+   outfit_hash = strhash_create( array_size(outfit_stack) );
+   for (i=0; i<array_size(outfit_stack); i++)
+      strhash_put( outfit_hash, outfit_stack[i].name, &outfit_stack[i] );
 
    /* Second pass, sets up ammunition relationships. */
    for (i=0; i<array_size(outfit_stack); i++) {
@@ -1610,6 +1627,8 @@ void outfit_free (void)
       free(o->name);
    }
 
+   strhash_destroy(outfit_hash);
+   outfit_hash = NULL;
    array_free(outfit_stack);
 }
 
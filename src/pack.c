@@ -16,11 +16,18 @@
  *       1.1.3.1) File Name (128 bytes max, ended in NUL)
  *       1.1.3.2) File Location (uint32_t)
  *   1.2) File data in format Size/Data
- *     1.2.1) File Size (uint32_t)
- *     1.2,2) File Data (char*)
- *     1.2.3) File MD5 (16 byte char*)
+ *     1.2.1) Stored File Size (uint32_t)
+ *     1.2.2) Uncompressed File Size (uint32_t, version 2 only)
+ *     1.2.3) File Data (char*), LZ77-compressed when smaller than raw
+ *     1.2.4) File MD5 of the uncompressed data (16 byte char*)
  *   1.3) EOF
  *
+ * Version 2 archives get a new magic number and compress each file with a
+ *  byte-oriented LZ77 scheme (LZ4-style tokens) when that actually shrinks
+ *  it; files that don't compress (images, music) are stored raw so they can
+ *  still be streamed straight off the disk or mapping.  Version 1 archives
+ *  keep working unmodified.
+ *
  * 
  * Program Overview:
  *
@@ -48,10 +55,15 @@
 #if HAS_POSIX
 #include <arpa/inet.h> /* ntohl */
 #endif /* HAS_POSIX */
+#if HAS_POSIX && HAS_FD
+#include <sys/mman.h> /* mmap */
+#endif /* HAS_POSIX && HAS_FD */
 #if HAS_WIN32
 #include <winsock2.h> /* ntohl */
 #endif /* HAS_WIN32 */
 
+#include "SDL_thread.h"
+
 #include "log.h"
 #include "md5.h"
 
@@ -78,6 +90,9 @@ struct Packfile_s {
    uint32_t start; /**< File start. */
    uint32_t end; /**< File end. */
 
+   int version; /**< Archive format version. */
+   char *data; /**< Decompressed contents for compressed entries. */
+
    uint32_t flags; /**< Special control flags. */
 };
 
@@ -96,6 +111,14 @@ struct Packcache_s {
    char **index; /**< Cached index for faster lookups. */
    uint32_t *start; /**< Cached index starts. */
    uint32_t nindex; /**< Number of index entries. */
+   uint32_t *lookup; /**< Open-addressed hash into the index. */
+   uint32_t nlookup; /**< Size of the lookup table, power of two. */
+   int version; /**< Archive format version. */
+
+#if HAS_POSIX && HAS_FD
+   char *map; /**< mmap of the whole archive, NULL if unavailable. */
+   size_t mapsize; /**< Size of the mapping. */
+#endif /* HAS_POSIX && HAS_FD */
 };
 
 /*
@@ -115,8 +138,6 @@ struct Packcache_s {
 #define DEBUG(str, args...)      do {;} while(0) /**< Hack to disable debugging. */
 
 
-#define BLOCKSIZE    128*1024 /**< The read/write block size. */
-
 #ifndef PATH_MAX
 #define PATH_MAX     256   /**< maximum file name length. */
 #endif
@@ -127,7 +148,8 @@ struct Packcache_s {
 #endif /* HAS_FD */
 
 
-const uint64_t magic =  0x25524573; /**< File magic number: sER% */
+const uint64_t magic  =  0x25524573; /**< Version 1 magic number: sER% */
+const uint64_t magic2 =  0x32524573; /**< Version 2 magic number: sER2 */
 
 
 /*
@@ -140,6 +162,22 @@ const uint64_t magic =  0x25524573; /**< File magic number: sER% */
  * Prototypes.
  */
 static off_t getfilesize( const char* filename );
+static int pack_magicVersion( const char* buf );
+static uint32_t pack_strHash( const char* str );
+static int pack_cacheFind( Packcache_t* cache, const char* filename );
+static void* pack_loadFile( const char* filename, uint32_t *size );
+static uint32_t pack_lzCompress( const uint8_t *in, uint32_t insize,
+      uint8_t *out, uint32_t outsize );
+static int pack_lzDecompress( const uint8_t *in, uint32_t insize,
+      uint8_t *out, uint32_t outsize );
+static int pack_fileLoadCompressed( Packfile_t *file,
+      uint32_t csize, uint32_t usize );
+static int pack_verifyData( Packcache_t* cache, uint32_t i,
+      const uint8_t *data, uint32_t csize, uint32_t usize );
+#if HAS_POSIX && HAS_FD
+static const char* pack_cacheMapFile( Packcache_t* cache,
+      const char* filename, uint32_t *csize, uint32_t *usize );
+#endif /* HAS_POSIX && HAS_FD */
 /* RWops stuff. */
 #if SDL_VERSION_ATLEAST(1,3,0)
 static long packrw_seek( SDL_RWops *rw, long offset, int whence );
@@ -153,6 +191,291 @@ static int packrw_write( SDL_RWops *rw, const void *ptr, int size, int num );
 static int packrw_close( SDL_RWops *rw );
 
 
+/*
+ * Compression parameters.
+ */
+#define PACK_LZ_HASHLOG    13 /**< log2 of the compressor hash table size. */
+#define PACK_LZ_MINMATCH   4 /**< Smallest match worth encoding. */
+#define PACK_LZ_LASTLITS   12 /**< Trailing bytes always stored as literals. */
+
+
+/**
+ * @brief Identifies the archive version from its magic number.
+ *
+ *    @param buf Buffer holding the first sizeof(magic) bytes of the file.
+ *    @return The format version or 0 if it is not a packfile.
+ */
+static int pack_magicVersion( const char* buf )
+{
+   uint64_t end64;
+
+   end64 = ntohll(magic);
+   if (memcmp( buf, &end64, sizeof(magic) )==0)
+      return 1;
+   end64 = ntohll(magic2);
+   if (memcmp( buf, &end64, sizeof(magic2) )==0)
+      return 2;
+   return 0;
+}
+
+
+/**
+ * @brief Hashes a file name for the cache lookup table.
+ *
+ *    @param str String to hash.
+ *    @return Hash of the string.
+ */
+static uint32_t pack_strHash( const char* str )
+{
+   uint32_t h;
+
+   h = 5381;
+   while (*str != '\0')
+      h = h*33 + (uint8_t)*str++;
+   return h;
+}
+
+
+/**
+ * @brief Finds a file in the cache index.
+ *
+ *    @param cache Cache to look the file up in.
+ *    @param filename Name of the file to find.
+ *    @return Index of the file or -1 if not found.
+ */
+static int pack_cacheFind( Packcache_t* cache, const char* filename )
+{
+   uint32_t h, i;
+
+   if (cache->nlookup == 0)
+      return -1;
+
+   /* Open addressing with linear probing, the table is never full. */
+   h = pack_strHash( filename ) & (cache->nlookup-1);
+   while ((i = cache->lookup[h]) != (uint32_t)-1) {
+      if (strcmp( cache->index[i], filename )==0)
+         return (int)i;
+      h = (h+1) & (cache->nlookup-1);
+   }
+   return -1;
+}
+
+
+/**
+ * @brief Hashes four bytes for the compressor match table.
+ *
+ *    @param p Position to hash.
+ *    @return Hash table slot for the four bytes at p.
+ */
+static uint32_t pack_lzHash( const uint8_t *p )
+{
+   uint32_t v;
+   memcpy( &v, p, 4 );
+   return (v * 2654435761U) >> (32 - PACK_LZ_HASHLOG);
+}
+
+
+/**
+ * @brief Compresses a buffer with a fast byte-oriented LZ77 scheme.
+ *
+ * The output is a sequence of LZ4-style tokens: the high nibble is the
+ *  literal run length and the low nibble the match length minus
+ *  PACK_LZ_MINMATCH, both extended by 255-runs when they reach 15, with a
+ *  two byte little endian match offset between the literals and the match.
+ *
+ *    @param in Buffer to compress.
+ *    @param insize Size of the input buffer.
+ *    @param out Buffer to compress to.
+ *    @param outsize Size of the output buffer.
+ *    @return Compressed size or 0 if the input did not fit (no gain).
+ */
+static uint32_t pack_lzCompress( const uint8_t *in, uint32_t insize,
+      uint8_t *out, uint32_t outsize )
+{
+   static uint32_t hash[ 1<<PACK_LZ_HASHLOG ];
+   const uint8_t *ip, *iend, *mlimit, *anchor, *match;
+   uint8_t *op, *oend, *token;
+   uint32_t h, len, off, lit, l;
+
+   /* Tiny files can't win anything. */
+   if (insize < 2*PACK_LZ_LASTLITS)
+      return 0;
+
+   memset( hash, 0, sizeof(hash) );
+   ip     = in;
+   iend   = in + insize;
+   mlimit = iend - PACK_LZ_LASTLITS; /* last bytes are always literals */
+   anchor = in;
+   op     = out;
+   oend   = out + outsize;
+
+   ip++;
+   while (ip < mlimit) {
+      /* Look the position up in the match table. */
+      h        = pack_lzHash(ip);
+      match    = in + hash[h];
+      hash[h]  = ip - in;
+      if ((match >= ip) || (ip - match > 0xFFFF) ||
+            (memcmp( match, ip, PACK_LZ_MINMATCH ) != 0)) {
+         ip++;
+         continue;
+      }
+
+      /* Extend the match as far as it goes. */
+      len = PACK_LZ_MINMATCH;
+      while ((ip+len < mlimit) && (match[len] == ip[len]))
+         len++;
+
+      /* Worst case space for token, literals, offset and length runs. */
+      lit = ip - anchor;
+      if (op + 2 + lit + lit/255 + 2 + (len-PACK_LZ_MINMATCH)/255 + 1 > oend)
+         return 0; /* no gain */
+
+      /* Token and literal run. */
+      token  = op++;
+      *token = (uint8_t)(MIN( lit, 15U ) << 4);
+      if (lit >= 15) {
+         l = lit - 15;
+         while (l >= 255) {
+            *op++ = 255;
+            l -= 255;
+         }
+         *op++ = (uint8_t)l;
+      }
+      memcpy( op, anchor, lit );
+      op += lit;
+
+      /* Offset and match length. */
+      off = ip - match;
+      *op++ = (uint8_t)(off & 0xFF);
+      *op++ = (uint8_t)(off >> 8);
+      l = len - PACK_LZ_MINMATCH;
+      *token |= (uint8_t)MIN( l, 15U );
+      if (l >= 15) {
+         l -= 15;
+         while (l >= 255) {
+            *op++ = 255;
+            l -= 255;
+         }
+         *op++ = (uint8_t)l;
+      }
+
+      ip    += len;
+      anchor = ip;
+   }
+
+   /* Trailing literal run. */
+   lit = iend - anchor;
+   if (op + 2 + lit + lit/255 > oend)
+      return 0;
+   token  = op++;
+   *token = (uint8_t)(MIN( lit, 15U ) << 4);
+   if (lit >= 15) {
+      l = lit - 15;
+      while (l >= 255) {
+         *op++ = 255;
+         l -= 255;
+      }
+      *op++ = (uint8_t)l;
+   }
+   memcpy( op, anchor, lit );
+   op += lit;
+
+   return op - out;
+}
+
+
+/**
+ * @brief Decompresses a buffer compressed by pack_lzCompress().
+ *
+ *    @param in Compressed buffer.
+ *    @param insize Size of the compressed buffer.
+ *    @param out Buffer to decompress to, must be the uncompressed size.
+ *    @param outsize Uncompressed size of the data.
+ *    @return 0 on success, -1 if the stream is corrupted.
+ */
+static int pack_lzDecompress( const uint8_t *in, uint32_t insize,
+      uint8_t *out, uint32_t outsize )
+{
+   const uint8_t *ip, *iend;
+   uint8_t *op, *oend;
+   uint32_t token, len, off, l;
+
+   ip   = in;
+   iend = in + insize;
+   op   = out;
+   oend = out + outsize;
+
+   while (ip < iend) {
+      token = *ip++;
+
+      /* Literal run. */
+      len = token >> 4;
+      if (len == 15) {
+         do {
+            if (ip >= iend)
+               return -1;
+            l    = *ip++;
+            len += l;
+         } while (l == 255);
+      }
+      if ((ip + len > iend) || (op + len > oend))
+         return -1;
+      memcpy( op, ip, len );
+      ip += len;
+      op += len;
+
+      /* Last run has no match. */
+      if (ip >= iend)
+         break;
+
+      /* Match. */
+      if (ip + 2 > iend)
+         return -1;
+      off = ip[0] | ((uint32_t)ip[1] << 8);
+      ip += 2;
+      len = token & 0x0F;
+      if (len == 15) {
+         do {
+            if (ip >= iend)
+               return -1;
+            l    = *ip++;
+            len += l;
+         } while (l == 255);
+      }
+      len += PACK_LZ_MINMATCH;
+      if ((off == 0) || ((uint32_t)(op - out) < off) || (op + len > oend))
+         return -1;
+
+      /* Byte copy - source and destination may overlap. */
+      while (len--) {
+         *op = *(op - off);
+         op++;
+      }
+   }
+
+   return (op == oend) ? 0 : -1;
+}
+
+
+/**
+ * @brief A name/start pair, only used to sort the cache index.
+ */
+typedef struct PackIndexEnt_s {
+   char *name; /**< File name. */
+   uint32_t start; /**< File start offset. */
+} PackIndexEnt_t;
+
+/**
+ * @brief qsort comparator for index entries, by name.
+ */
+static int pack_indexCmp( const void *a, const void *b )
+{
+   return strcmp( ((const PackIndexEnt_t*)a)->name,
+         ((const PackIndexEnt_t*)b)->name );
+}
+
+
 /**
  * @brief Opens a Packfile as a cache.
  *
@@ -162,10 +485,13 @@ static int packrw_close( SDL_RWops *rw );
 Packcache_t* pack_openCache( const char* packfile )
 {
    int j;
-   uint32_t i;
+   uint32_t i, h;
    char buf[PATH_MAX];
    Packcache_t *cache;
-   uint64_t end64;
+   PackIndexEnt_t *ents;
+#if HAS_POSIX && HAS_FD
+   struct stat pstat;
+#endif /* HAS_POSIX && HAS_FD */
 
    /*
     * Allocate memory.
@@ -191,12 +517,28 @@ Packcache_t* pack_openCache( const char* packfile )
       return NULL;
    }
 
+#if HAS_POSIX && HAS_FD
+   /*
+    * Map the entire archive so cached reads skip the syscalls.
+    */
+   if (fstat( cache->fd, &pstat ) == 0) {
+      cache->map = mmap( NULL, pstat.st_size, PROT_READ, MAP_SHARED,
+            cache->fd, 0 );
+      if (cache->map == MAP_FAILED) {
+         WARN("Unable to mmap '%s': %s", packfile, strerror(errno));
+         cache->map = NULL;
+      }
+      else
+         cache->mapsize = pstat.st_size;
+   }
+#endif /* HAS_POSIX && HAS_FD */
+
    /*
     * Check for validity.
     */
    READ( cache, buf, sizeof(magic));
-   end64 = ntohll(magic);
-   if (memcmp(buf, &end64, sizeof(magic))) {
+   cache->version = pack_magicVersion( buf );
+   if (cache->version == 0) {
       WARN("File %s is not a valid packfile", packfile);
       return NULL;
    }
@@ -224,6 +566,38 @@ Packcache_t* pack_openCache( const char* packfile )
       DEBUG("'%s' found at %d", cache->index[i], cache->start[i]);
    }
 
+   /*
+    * Sort the index so all the entries under one directory prefix are
+    *  contiguous, which lets pack_listfilesPrefix() answer directory
+    *  queries with a slice of the index.
+    */
+   ents = malloc( cache->nindex * sizeof(PackIndexEnt_t) );
+   for (i=0; i<cache->nindex; i++) {
+      ents[i].name  = cache->index[i];
+      ents[i].start = cache->start[i];
+   }
+   qsort( ents, cache->nindex, sizeof(PackIndexEnt_t), pack_indexCmp );
+   for (i=0; i<cache->nindex; i++) {
+      cache->index[i] = ents[i].name;
+      cache->start[i] = ents[i].start;
+   }
+   free(ents);
+
+   /*
+    * Hash the index so by-name lookups don't scan the whole thing.
+    */
+   cache->nlookup = 1;
+   while (cache->nlookup < 2*cache->nindex)
+      cache->nlookup *= 2;
+   cache->lookup = malloc( cache->nlookup * sizeof(uint32_t) );
+   memset( cache->lookup, 0xFF, cache->nlookup * sizeof(uint32_t) );
+   for (i=0; i<cache->nindex; i++) {
+      h = pack_strHash( cache->index[i] ) & (cache->nlookup-1);
+      while (cache->lookup[h] != (uint32_t)-1)
+         h = (h+1) & (cache->nlookup-1);
+      cache->lookup[h] = i;
+   }
+
    /*
     * Return the built cache.
     */
@@ -243,6 +617,10 @@ void pack_closeCache( Packcache_t* cache )
    /*
     * Close file.
     */
+#if HAS_POSIX && HAS_FD
+   if (cache->map != NULL)
+      munmap( cache->map, cache->mapsize );
+#endif /* HAS_POSIX && HAS_FD */
 #if HAS_FD
    close( cache->fd );
 #else /* not HAS_FD */
@@ -259,10 +637,326 @@ void pack_closeCache( Packcache_t* cache )
       free(cache->index);
       free(cache->start);
    }
+   if (cache->lookup != NULL)
+      free(cache->lookup);
    free(cache);
 }
 
 
+#if HAS_POSIX && HAS_FD
+/**
+ * @brief Looks a file up in the archive mapping.
+ *
+ *    @param cache Packcache with a valid mapping.
+ *    @param filename Name of the file to look up.
+ *    @param csize Set to the file's stored size.
+ *    @param usize Set to the file's uncompressed size, same as csize when
+ *                 the file is stored raw.
+ *    @return Pointer to the file's stored data in the mapping or NULL on
+ *            failure.
+ */
+static const char* pack_cacheMapFile( Packcache_t* cache,
+      const char* filename, uint32_t *csize, uint32_t *usize )
+{
+   int i;
+   uint32_t start, head, csz, usz;
+
+   /* Find the file. */
+   i = pack_cacheFind( cache, filename );
+   if (i < 0)
+      return NULL;
+
+   /* File sizes precede the data. */
+   start = cache->start[i];
+   head  = (cache->version >= 2) ? 8 : 4;
+   if ((size_t)start + head > cache->mapsize) {
+      WARN("File '%s' start is past the end of '%s'.", filename, cache->name);
+      return NULL;
+   }
+   memcpy( &csz, &cache->map[start], 4 );
+   csz = htonl( csz );
+   if (cache->version >= 2) {
+      memcpy( &usz, &cache->map[start+4], 4 );
+      usz = htonl( usz );
+   }
+   else
+      usz = csz;
+
+   /* Make sure data and trailing MD5 fit in the archive. */
+   if ((size_t)start + head + csz + 16 > cache->mapsize) {
+      WARN("File '%s' overflows the end of '%s'.", filename, cache->name);
+      return NULL;
+   }
+
+   *csize = csz;
+   *usize = usz;
+   return &cache->map[ start + head ];
+}
+#endif /* HAS_POSIX && HAS_FD */
+
+
+/**
+ * @brief Verifies one entry's stored digest against its contents.
+ *
+ * The digest covers the uncompressed contents, so compressed entries
+ *  get inflated into a scratch buffer first.
+ *
+ *    @param cache Cache the entry belongs to, for the name in warnings.
+ *    @param i Index of the entry.
+ *    @param data The entry's stored data followed by its 16 byte digest.
+ *    @param csize Stored size of the entry.
+ *    @param usize Uncompressed size of the entry.
+ *    @return 0 if the entry checks out, 1 if it is corrupt.
+ */
+static int pack_verifyData( Packcache_t* cache, uint32_t i,
+      const uint8_t *data, uint32_t csize, uint32_t usize )
+{
+   uint8_t *ubuf;
+   md5_state_t md5;
+   md5_byte_t md5val[16];
+
+   ubuf = NULL;
+   if (csize < usize) { /* Compressed, digest covers the plain contents. */
+      ubuf = malloc( usize );
+      if (pack_lzDecompress( data, csize, ubuf, usize ) != 0) {
+         WARN("Corrupted compressed data for '%s' in '%s'.",
+               cache->index[i], cache->name);
+         free(ubuf);
+         return 1;
+      }
+   }
+
+   md5_init(&md5);
+   md5_append( &md5, (ubuf != NULL) ? ubuf : data, usize );
+   md5_finish(&md5, md5val);
+   free(ubuf);
+
+   if (memcmp( md5val, &data[csize], 16 )) {
+      WARN("MD5 mismatch for '%s' in '%s'.", cache->index[i], cache->name);
+      return 1;
+   }
+   return 0;
+}
+
+
+#if HAS_POSIX && HAS_FD
+/**
+ * @brief A verification worker's slice of the index.
+ */
+typedef struct PackVerify_ {
+   Packcache_t *cache; /**< Cache being verified. */
+   uint32_t start; /**< First entry of the slice. */
+   uint32_t end; /**< One past the last entry of the slice. */
+   int bad; /**< Corrupt entries found in the slice. */
+   SDL_Thread *thread; /**< Worker thread. */
+} PackVerify;
+
+
+/**
+ * @brief Body of a verification worker, hashes its slice of the index.
+ *
+ *    @param data The worker's PackVerify slice.
+ *    @return 0.
+ */
+static int pack_verifyThread( void *data )
+{
+   PackVerify *v;
+   Packcache_t *cache;
+   const char *map;
+   uint32_t i, csize, usize;
+
+   v     = (PackVerify*) data;
+   cache = v->cache;
+   for (i=v->start; i<v->end; i++) {
+      map = pack_cacheMapFile( cache, cache->index[i], &csize, &usize );
+      if ((map == NULL) || pack_verifyData( cache, i,
+            (const uint8_t*)map, csize, usize ))
+         v->bad++;
+   }
+   return 0;
+}
+#endif /* HAS_POSIX && HAS_FD */
+
+
+/**
+ * @brief Verifies every entry in the archive against its stored digest.
+ *
+ * Entries are independent, so with the archive mapped the work is
+ *  sliced across one hashing thread per core - md5 itself is strictly
+ *  sequential per stream, the parallelism comes from hashing many
+ *  streams at once.
+ *
+ *    @param cache Cache to verify.
+ *    @return Number of corrupt entries found, 0 when the archive is clean.
+ */
+int pack_verifyCache( Packcache_t* cache )
+{
+   int bad;
+   uint32_t i;
+#if HAS_POSIX && HAS_FD
+   PackVerify *v;
+   int j, nworkers;
+#endif /* HAS_POSIX && HAS_FD */
+#if !HAS_FD
+   FILE *fp;
+#else /* !HAS_FD */
+   int fd;
+#endif /* !HAS_FD */
+   uint32_t csize, usize;
+   uint8_t *buf;
+
+   bad = 0;
+
+#if HAS_POSIX && HAS_FD
+   if (cache->map != NULL) {
+      nworkers = (int) sysconf( _SC_NPROCESSORS_ONLN );
+      if (nworkers < 1)
+         nworkers = 1;
+      else if (nworkers > 8)
+         nworkers = 8;
+      if ((cache->nindex > 0) && ((uint32_t)nworkers > cache->nindex))
+         nworkers = (int) cache->nindex;
+
+      v = calloc( nworkers, sizeof(PackVerify) );
+      for (j=0; j<nworkers; j++) {
+         v[j].cache = cache;
+         v[j].start = cache->nindex *  j    / nworkers;
+         v[j].end   = cache->nindex * (j+1) / nworkers;
+         v[j].thread = SDL_CreateThread( pack_verifyThread, &v[j] );
+         if (v[j].thread == NULL) /* Do it on this thread instead. */
+            pack_verifyThread( &v[j] );
+      }
+      for (j=0; j<nworkers; j++) {
+         if (v[j].thread != NULL)
+            SDL_WaitThread( v[j].thread, NULL );
+         bad += v[j].bad;
+      }
+      free(v);
+      return bad;
+   }
+#endif /* HAS_POSIX && HAS_FD */
+
+   /* No mapping - verify serially through a private descriptor so the
+    * cache's own position is left alone. */
+#if HAS_FD
+   fd = open( cache->name, O_RDONLY );
+   if (fd == -1) {
+#else /* HAS_FD */
+   fp = fopen( cache->name, "rb" );
+   if (fp == NULL) {
+#endif /* HAS_FD */
+      WARN("Erroring opening %s: %s", cache->name, strerror(errno));
+      return -1;
+   }
+
+   for (i=0; i<cache->nindex; i++) {
+#if HAS_FD
+      if (lseek( fd, cache->start[i], SEEK_SET ) != (off_t)cache->start[i]) {
+#else /* HAS_FD */
+      if (fseek( fp, cache->start[i], SEEK_SET ) != 0) {
+#endif /* HAS_FD */
+         bad++;
+         continue;
+      }
+#if HAS_FD
+      if (read( fd, &csize, 4 ) != 4) {
+#else /* HAS_FD */
+      if (fread( &csize, 1, 4, fp ) != 4) {
+#endif /* HAS_FD */
+         bad++;
+         continue;
+      }
+      csize = htonl( csize );
+      usize = csize;
+      if (cache->version >= 2) {
+#if HAS_FD
+         if (read( fd, &usize, 4 ) != 4) {
+#else /* HAS_FD */
+         if (fread( &usize, 1, 4, fp ) != 4) {
+#endif /* HAS_FD */
+            bad++;
+            continue;
+         }
+         usize = htonl( usize );
+      }
+
+      buf = malloc( csize + 16 ); /* data plus trailing digest */
+#if HAS_FD
+      if (read( fd, buf, csize + 16 ) != (ssize_t)(csize + 16)) {
+#else /* HAS_FD */
+      if (fread( buf, 1, csize + 16, fp ) != csize + 16) {
+#endif /* HAS_FD */
+         bad++;
+         free(buf);
+         continue;
+      }
+      bad += pack_verifyData( cache, i, buf, csize, usize );
+      free(buf);
+   }
+
+#if HAS_FD
+   close( fd );
+#else /* HAS_FD */
+   fclose( fp );
+#endif /* HAS_FD */
+   return bad;
+}
+
+
+/**
+ * @brief Loads and decompresses a compressed entry into the packfile.
+ *
+ * Compressed entries can't be streamed, so the whole file gets inflated
+ *  into memory and reads are served from there.
+ *
+ *    @param file Packfile positioned right after the entry's size header.
+ *    @param csize Stored (compressed) size of the entry.
+ *    @param usize Uncompressed size of the entry.
+ *    @return 0 on success, -1 on error.
+ */
+static int pack_fileLoadCompressed( Packfile_t *file,
+      uint32_t csize, uint32_t usize )
+{
+   uint8_t *cbuf;
+
+   cbuf = malloc( csize );
+   if (cbuf == NULL) {
+      WARN("Out of Memory.");
+      return -1;
+   }
+#if HAS_FD
+   if (read( file->fd, cbuf, csize ) != (ssize_t)csize) {
+#else /* not HAS_FD */
+   if (fread( cbuf, 1, csize, file->fp ) != csize) {
+#endif /* HAS_FD */
+      WARN("Fewer bytes read than expected");
+      free(cbuf);
+      return -1;
+   }
+
+   file->data = malloc( usize );
+   if (file->data == NULL) {
+      WARN("Out of Memory.");
+      free(cbuf);
+      return -1;
+   }
+   if (pack_lzDecompress( cbuf, csize, (uint8_t*)file->data, usize ) != 0) {
+      WARN("Corrupted compressed data in packfile.");
+      free(cbuf);
+      free(file->data);
+      file->data = NULL;
+      return -1;
+   }
+   free(cbuf);
+
+   /* Reads now come out of the decompressed buffer. */
+   file->start = 0;
+   file->pos   = 0;
+   file->end   = usize;
+   return 0;
+}
+
+
 /**
  * @brief Opens a Packfile from a Packcache.
  *
@@ -272,50 +966,70 @@ void pack_closeCache( Packcache_t* cache )
  */
 Packfile_t* pack_openFromCache( Packcache_t* cache, const char* filename )
 {
-   uint32_t i;
+   int i;
+   uint32_t csize, usize;
    Packfile_t *file;
 
+   /* Find the file in the hashed index. */
+   i = pack_cacheFind( cache, filename );
+   if (i < 0) {
+      WARN("File '%s' not found in packfile.", filename);
+      return NULL;
+   }
+
    file = calloc( 1, sizeof(Packfile_t) );
 
-   for (i=0; i<cache->nindex; i++) {
-      if (strcmp(cache->index[i], filename)==0) {
-         /* Copy file. */
+   /* Copy file. */
 #if HAS_FD
-         file->fd = open( cache->name, O_RDONLY );
+   file->fd = open( cache->name, O_RDONLY );
 #else /* not HAS_FD */
-         file->fp = fopen( cache->name, "rb" );
+   file->fp = fopen( cache->name, "rb" );
 #endif /* HAS_FD */
 
-         /* Copy information. */
-         file->flags |= PACKFILE_FROMCACHE;
-         file->start  = cache->start[i];
+   /* Copy information. */
+   file->flags   |= PACKFILE_FROMCACHE;
+   file->start    = cache->start[i];
+   file->version  = cache->version;
 
-         /* Seek. */
-         if (file->start) { /* go to the beginning of the file */
+   /* Seek. */
+   if (file->start) { /* go to the beginning of the file */
 #if HAS_FD
-            if ((uint32_t)lseek( file->fd, file->start, SEEK_SET ) != file->start) {
+      if ((uint32_t)lseek( file->fd, file->start, SEEK_SET ) != file->start) {
 #else /* not HAS_FD */
-            if (fseek( file->fp, file->start, SEEK_SET )) {
+      if (fseek( file->fp, file->start, SEEK_SET )) {
 #endif /* HAS_FD */
-               WARN("Failure to seek to file start: %s", strerror(errno));
+         WARN("Failure to seek to file start: %s", strerror(errno));
+         return NULL;
+      }
+      if (file->version >= 2) {
+         READ( file, &csize, 4 );
+         csize = htonl( csize );
+         READ( file, &usize, 4 );
+         usize = htonl( usize );
+         if (csize != usize) { /* compressed, inflate it */
+            if (pack_fileLoadCompressed( file, csize, usize )) {
+               pack_close( file );
                return NULL;
             }
-            READ( file, &file->end, 4 );
-            file->end = htonl( file->end );
-            file->start += 4;
+         }
+         else {
+            file->start += 8;
             file->pos    = file->start;
-            file->end   += file->start;
-            DEBUG("Opened '%s' from cache from %u to %u (%u long)", filename,
-                  file->start, file->end, file->end - file->start);
+            file->end    = csize + file->start;
          }
-
-         return file;
       }
+      else {
+         READ( file, &file->end, 4 );
+         file->end = htonl( file->end );
+         file->start += 4;
+         file->pos    = file->start;
+         file->end   += file->start;
+      }
+      DEBUG("Opened '%s' from cache from %u to %u (%u long)", filename,
+            file->start, file->end, file->end - file->start);
    }
 
-   free(file);
-   WARN("File '%s' not found in packfile.", filename);
-   return NULL;
+   return file;
 }
 
 
@@ -350,6 +1064,65 @@ static off_t getfilesize( const char* filename )
 }
 
 
+/**
+ * @brief Reads an entire file on disk into memory.
+ *
+ *    @param filename File to load.
+ *    @param size Set to the size of the file.
+ *    @return The file's contents or NULL on error, must be freed.
+ */
+static void* pack_loadFile( const char* filename, uint32_t *size )
+{
+   void *buf;
+   off_t len;
+#if HAS_FD
+   int fd;
+#else /* not HAS_FD */
+   FILE *fp;
+#endif /* HAS_FD */
+
+   len = getfilesize( filename );
+   buf = malloc( (size_t)len + 1 );
+   if (buf == NULL) {
+      WARN("Out of Memory.");
+      return NULL;
+   }
+
+#if HAS_FD
+   fd = open( filename, O_RDONLY );
+   if (fd == -1) {
+      WARN("Erroring opening %s: %s", filename, strerror(errno));
+      free(buf);
+      return NULL;
+   }
+   if (read( fd, buf, len ) != len) {
+      WARN("Fewer bytes read than expected");
+      close(fd);
+      free(buf);
+      return NULL;
+   }
+   close(fd);
+#else /* not HAS_FD */
+   fp = fopen( filename, "rb" );
+   if (fp == NULL) {
+      WARN("Erroring opening %s: %s", filename, strerror(errno));
+      free(buf);
+      return NULL;
+   }
+   if (fread( buf, 1, len, fp ) != (size_t)len) {
+      WARN("Fewer bytes read than expected");
+      fclose(fp);
+      free(buf);
+      return NULL;
+   }
+   fclose(fp);
+#endif /* HAS_FD */
+
+   *size = (uint32_t)len;
+   return buf;
+}
+
+
 /**
  * @brief Checks to see if a file is a packfile.
  *
@@ -376,7 +1149,7 @@ int pack_check( const char* filename )
       return -1;
    }
 
-   ret = (memcmp(buf,&magic,sizeof(magic))==0) ? 0 : 1 ;
+   ret = (pack_magicVersion(buf) != 0) ? 0 : 1 ;
    close(fd);
 #else /* not HAS_FD */
    FILE* file = fopen( filename, "rb" );
@@ -392,7 +1165,7 @@ int pack_check( const char* filename )
       return -1;
    }
 
-   ret = (memcmp(buf,&magic,sizeof(magic))==0) ? 0 : 1 ;
+   ret = (pack_magicVersion(buf) != 0) ? 0 : 1 ;
    fclose( file );
 #endif /* HAS_FD */
 
@@ -421,22 +1194,22 @@ int pack_check( const char* filename )
  */
 int pack_files( const char* outfile, const char** infiles, const uint32_t nfiles )
 {
-   void *buf;
+   void *buf, *cbuf;
 #if HAS_FD
    struct stat file;
-   int outfd, infd;
+   int outfd;
 #else /* HAS_FD */
-   FILE *outf, *inf;
+   FILE *outf;
 #endif /* HAS_FD */
    uint32_t i;
    int namesize;
    uint32_t indexsize, pointer;
-   int bytes;
+   uint32_t *csize, *usize, usz;
    const uint8_t b = '\0';
    uint32_t end32;
    uint64_t end64;
 
-   
+
    for (namesize=0,i=0; i < nfiles; i++) { /* make sure files exist before writing */
 #if HAS_FD
       if (stat(infiles[i], &file)) {
@@ -458,6 +1231,25 @@ int pack_files( const char* outfile, const char** infiles, const uint32_t nfiles
          (1+4)*nfiles); /* file size and extra end of string char '\0' */
    DEBUG("Index size is %d", indexsize );
 
+   /* Compress everything once up front to learn the stored sizes the
+    * index pointers depend on - entries that don't shrink stay raw. */
+   csize = malloc( nfiles * sizeof(uint32_t) );
+   usize = malloc( nfiles * sizeof(uint32_t) );
+   for (i=0; i<nfiles; i++) {
+      buf = pack_loadFile( infiles[i], &usize[i] );
+      if (buf == NULL) {
+         free(csize);
+         free(usize);
+         return -1;
+      }
+      cbuf = malloc( usize[i] );
+      csize[i] = pack_lzCompress( buf, usize[i], cbuf, usize[i] );
+      if ((csize[i] == 0) || (csize[i] >= usize[i]))
+         csize[i] = usize[i]; /* store raw */
+      free(cbuf);
+      free(buf);
+   }
+
    /* creates the output file */
 #if HAS_FD
    outfd = creat( outfile, PERMS );
@@ -473,10 +1265,10 @@ int pack_files( const char* outfile, const char** infiles, const uint32_t nfiles
    /*
     * INDEX
     */
-   buf = malloc(BLOCKSIZE);
+   buf = NULL;
    /* magic number */
-   end64 = htonll(magic);
-   WRITE( &end64, sizeof(magic));
+   end64 = htonll(magic2); /* version 2 - compressed entries */
+   WRITE( &end64, sizeof(magic2));
    DEBUG("Wrote magic number");
    /* number of files */
    end32 = htonl(nfiles);
@@ -490,7 +1282,7 @@ int pack_files( const char* outfile, const char** infiles, const uint32_t nfiles
       WRITE( &b, 1 );
       end32 = htonl(pointer);
       WRITE( &end32, 4 );
-      pointer += 4 + getfilesize( infiles[i] ) + 16; /* set pointer to be next file pos */
+      pointer += 4 + 4 + csize[i] + 16; /* set pointer to be next file pos */
    }
    /*
     * DATA
@@ -498,38 +1290,46 @@ int pack_files( const char* outfile, const char** infiles, const uint32_t nfiles
    md5_state_t md5;
    md5_byte_t *md5val = malloc(16);
    for (i=0; i<nfiles; i++) {
-      bytes = (uint32_t)getfilesize( infiles[i] );
-      end32 = htonl(bytes);
-      WRITE( &end32, 4 ); /* filesize */
-      DEBUG("About to write file '%s' of %d bytes", infiles[i], bytes);
-      md5_init(&md5);
-#if HAS_FD
-      infd = open( infiles[i], O_RDONLY );
-      while ((bytes = read( infd, buf, BLOCKSIZE ))) {
-#else /* not HAS_FD */
-      inf = fopen( infiles[i], "rb" );
-      while ((bytes = fread( buf, 1, BLOCKSIZE, inf ))) {
-#endif /* HAS_FD */
-         WRITE( buf, bytes ); /* data */
-         md5_append( &md5, buf, bytes );
+      buf = pack_loadFile( infiles[i], &usz );
+      if (buf == NULL) {
+         free(md5val);
+         free(csize);
+         free(usize);
+         return -1;
+      }
+      cbuf = NULL;
+      if (csize[i] < usize[i]) { /* compress again, sizes are deterministic */
+         cbuf = malloc( usz );
+         pack_lzCompress( buf, usz, cbuf, usz );
       }
+      DEBUG("About to write file '%s', %d of %d bytes", infiles[i],
+            csize[i], usize[i]);
+      end32 = htonl(csize[i]);
+      WRITE( &end32, 4 ); /* stored size */
+      end32 = htonl(usize[i]);
+      WRITE( &end32, 4 ); /* uncompressed size */
+      WRITE( (cbuf != NULL) ? cbuf : buf, csize[i] ); /* data */
+      /* MD5 covers the uncompressed contents so the reader also catches
+       * decompression bugs. */
+      md5_init(&md5);
+      md5_append( &md5, buf, usz );
       md5_finish(&md5, md5val);
       WRITE( md5val, 16 );
-#if HAS_FD
-      close(infd);
-#else /* not HAS_FD */
-      fclose(inf);
-#endif /* HAS_FD */
+      if (cbuf != NULL)
+         free(cbuf);
+      free(buf);
+      buf = NULL;
       DEBUG("Wrote file '%s'", infiles[i]);
    }
    free(md5val);
+   free(csize);
+   free(usize);
 
 #if HAS_FD
    close( outfd );
 #else /* not HAS_FD */
    fclose( outf );
 #endif /* HAS_FD */
-   free(buf);
 
    DEBUG("Packfile success\n\t%d files\n\t%d bytes", nfiles, (int)getfilesize(outfile));
    return 0;
@@ -548,9 +1348,9 @@ Packfile_t* pack_open( const char* packfile, const char* filename )
 {
    int j;
    uint32_t nfiles, i;
+   uint32_t csize, usize;
    char buf[PATH_MAX];
    Packfile_t *file;
-   uint64_t end64;
 
    /* Allocate memory. */
    file = malloc(sizeof(Packfile_t));
@@ -568,8 +1368,8 @@ Packfile_t* pack_open( const char* packfile, const char* filename )
    }
 
    READ( file, buf, sizeof(magic)); /* make sure it's a packfile */
-   end64 = ntohll(magic);
-   if (memcmp(buf, &end64, sizeof(magic))) {
+   file->version = pack_magicVersion( buf );
+   if (file->version == 0) {
       WARN("File %s is not a valid packfile", filename);
       return NULL;
    }
@@ -604,12 +1404,32 @@ Packfile_t* pack_open( const char* packfile, const char* filename )
          WARN("Failure to seek to file start: %s", strerror(errno));
          return NULL;
       }
-      READ( file, &file->end, 4 );
-      file->end = htonl( file->end );
-      DEBUG("\t%d bytes", file->end);
-      file->start += 4;
-      file->pos    = file->start;
-      file->end   += file->start;
+      if (file->version >= 2) {
+         READ( file, &csize, 4 );
+         csize = htonl( csize );
+         READ( file, &usize, 4 );
+         usize = htonl( usize );
+         DEBUG("\t%d of %d bytes", csize, usize);
+         if (csize != usize) { /* compressed, inflate it */
+            if (pack_fileLoadCompressed( file, csize, usize )) {
+               pack_close( file );
+               return NULL;
+            }
+         }
+         else {
+            file->start += 8;
+            file->pos    = file->start;
+            file->end    = csize + file->start;
+         }
+      }
+      else {
+         READ( file, &file->end, 4 );
+         file->end = htonl( file->end );
+         DEBUG("\t%d bytes", file->end);
+         file->start += 4;
+         file->pos    = file->start;
+         file->end   += file->start;
+      }
    }
    else {
       WARN("File '%s' not found in packfile '%s'", filename, packfile);
@@ -639,6 +1459,13 @@ ssize_t pack_read( Packfile_t* file, void* buf, size_t count )
    if (count == 0)
       return 0;
 
+   /* Compressed entries are served from the decompressed buffer. */
+   if (file->data != NULL) {
+      memcpy( buf, &file->data[ file->pos ], count );
+      file->pos += count;
+      return count;
+   }
+
 #if HAS_FD
    if ((bytes = read( file->fd, buf, count )) == -1) {
 #else /* not HAS_FD */
@@ -699,16 +1526,19 @@ off_t pack_seek( Packfile_t* file, off_t offset, int whence)
    if (target < file->start)
       return -1;
 
+   if (file->data != NULL) /* in memory, nothing to actually seek */
+      ret = target;
+   else {
 #if HAS_FD
-   ret = lseek( file->fd, target, SEEK_SET );
-   if (ret != target)
-      return -1;
+      ret = lseek( file->fd, target, SEEK_SET );
+      if (ret != target)
+         return -1;
 #else /* not HAS_FD */
-   ret = fseek( file->fp, target, SEEK_SET );
-   if (ret != 0)
-      return -1;
-   ret = target; /* fseek returns 0. */
+      if (fseek( file->fp, target, SEEK_SET ))
+         return -1;
+      ret = target; /* fseek returns 0. */
 #endif /* HAS_FD */
+   }
 
    /* Set the position in the file. */
    file->pos = ret;
@@ -839,7 +1669,6 @@ char** pack_listfiles( const char* packfile, uint32_t* nfiles )
    Packfile_t file;
    char** filenames;
    char* buf = malloc(sizeof(magic));
-   uint64_t end64;
 
    *nfiles = 0;
 
@@ -855,8 +1684,7 @@ char** pack_listfiles( const char* packfile, uint32_t* nfiles )
    }
 
    READ( &file, buf, sizeof(magic)); /* make sure it's a packfile */
-   end64 = ntohll( magic );
-   if (memcmp(buf, &end64, sizeof(magic))) {
+   if (pack_magicVersion( buf ) == 0) {
       WARN("File %s is not a valid packfile", packfile);
       return NULL;
    }
@@ -889,6 +1717,37 @@ char** pack_listfiles( const char* packfile, uint32_t* nfiles )
 void* pack_readfileCached( Packcache_t* cache, const char* filename, uint32_t *filesize )
 {
    Packfile_t *file;
+#if HAS_POSIX && HAS_FD
+   const char *data;
+   char *buf;
+   uint32_t csize, size;
+
+   /* Copy straight out of the mapping - no open/seek/read syscalls. */
+   if (cache->map != NULL) {
+      data = pack_cacheMapFile( cache, filename, &csize, &size );
+      if (data != NULL) {
+         buf = malloc( size + 1 );
+         if (buf == NULL) {
+            WARN("Out of Memory.");
+            return NULL;
+         }
+         if (csize == size) /* stored raw */
+            memcpy( buf, data, size );
+         else if (pack_lzDecompress( (const uint8_t*)data, csize,
+               (uint8_t*)buf, size ) != 0) {
+            WARN("Corrupted compressed file '%s' in '%s'.",
+                  filename, cache->name);
+            free(buf);
+            return NULL;
+         }
+         buf[size] = '\0'; /* append '\0' for it to validate as a string */
+         if (filesize)
+            *filesize = size;
+         return buf;
+      }
+      /* Lookup failed, fall through to the read path for the warnings. */
+   }
+#endif /* HAS_POSIX && HAS_FD */
 
    file = pack_openFromCache( cache, filename );
    if (file == NULL) {
@@ -913,6 +1772,53 @@ const char** pack_listfilesCached( Packcache_t* cache, uint32_t* nfiles )
 }
 
 
+/**
+ * @brief Gets the files under a path prefix from a Packcache.
+ *
+ * The index is kept sorted, so everything sharing a prefix is one
+ *  contiguous run - the return is a borrowed slice of the index, no
+ *  allocation.  Entries keep the full path.
+ *
+ *    @param cache Cache to query.
+ *    @param prefix Path prefix to match, e.g. "dat/missions/".
+ *    @param nfiles Number of files in the slice.
+ *    @return Borrowed slice of the index, do not free.
+ */
+const char** pack_listfilesPrefix( Packcache_t* cache, const char* prefix,
+      uint32_t* nfiles )
+{
+   uint32_t lo, hi, mid, first;
+   size_t len;
+
+   len = strlen(prefix);
+
+   /* First entry at or after the prefix. */
+   lo = 0;
+   hi = cache->nindex;
+   while (lo < hi) {
+      mid = (lo + hi) / 2;
+      if (strncmp( cache->index[mid], prefix, len ) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   first = lo;
+
+   /* First entry past the prefix run. */
+   hi = cache->nindex;
+   while (lo < hi) {
+      mid = (lo + hi) / 2;
+      if (strncmp( cache->index[mid], prefix, len ) <= 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   *nfiles = lo - first;
+   return (const char**) &cache->index[first];
+}
+
+
 /**
  * @brief Closes a packfile.
  *
@@ -931,6 +1837,8 @@ int pack_close( Packfile_t* file )
 #endif /* HAS_FD */
 
    /* Free memory. */
+   if (file->data != NULL)
+      free(file->data);
    free(file);
 
    DEBUG("Closing packfile.");
@@ -1060,6 +1968,18 @@ SDL_RWops *pack_rwops( const char* packfile, const char* filename )
 SDL_RWops *pack_rwopsCached( Packcache_t* cache, const char* filename )
 {
    Packfile_t *packfile;
+#if HAS_POSIX && HAS_FD
+   const char *data;
+   uint32_t csize, size;
+
+   /* Zero-copy rwops straight into the mapping, only possible for raw
+    * entries - compressed ones go through the buffering path below. */
+   if (cache->map != NULL) {
+      data = pack_cacheMapFile( cache, filename, &csize, &size );
+      if ((data != NULL) && (csize == size))
+         return SDL_RWFromConstMem( data, size );
+   }
+#endif /* HAS_POSIX && HAS_FD */
 
    /* Open the packfile. */
    packfile = pack_openFromCache( cache, filename );
@@ -32,6 +32,7 @@ typedef struct Packcache_s Packcache_t;
 Packcache_t* pack_openCache( const char* packfile );
 void pack_closeCache( Packcache_t* cache );
 Packfile_t* pack_openFromCache( Packcache_t* cache, const char* filename );
+int pack_verifyCache( Packcache_t* cache );
 
 /*
  * packfile manipulation, automatically alloced and freed (with open and close)
@@ -49,6 +50,8 @@ void* pack_readfile( const char* packfile, const char* filename, uint32_t *files
 char** pack_listfiles( const char* packfile, uint32_t* nfiles );
 void* pack_readfileCached( Packcache_t* cache, const char* filename, uint32_t *filesize );
 const char** pack_listfilesCached( Packcache_t* cache, uint32_t* nfiles );
+const char** pack_listfilesPrefix( Packcache_t* cache, const char* prefix,
+      uint32_t* nfiles ); /* borrowed slice, do not free */
 
 /*
  * for rwops.
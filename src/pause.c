@@ -7,8 +7,10 @@
  *
  * @brief Handles pausing and resuming the game.
  *
- * Main trick to pausing/unpausing is to allow things based on time to
- *  behavie properly when the toolkit opens a window.
+ * Pausing simply stops the simulation from advancing, so it costs
+ *  nothing no matter how much is in flight.  Anything that needs a
+ *  notion of "now" that freezes with the game should use sim_time
+ *  rather than wall clock time.
  */
 
 
@@ -22,6 +24,8 @@
 
 int paused     = 0; /**< is paused? */
 double dt_mod  = 1.; /**< dt modifier. */
+double sim_time = 0.; /**< Simulation clock in seconds, stops while paused. */
+double sim_interp = 1.; /**< Fraction of a sim step the render is past the last state. */
 
 
 /**
@@ -60,15 +64,6 @@ void unpause_game (void)
 }
 
 
-/**
- * @brief Sets the timers back.
- *    @param delay Delay to set timers back.
- */
-void pause_delay( unsigned int delay )
-{
-   (void) delay;
-}
-
 /**
  * @brief Adjusts the game's dt modifier.
  */
@@ -10,13 +10,13 @@
 
 extern int paused;
 extern double dt_mod;
+extern double sim_time;
+extern double sim_interp;
 
 void pause_setSpeed( double mod );
 
 void pause_game (void);
 void unpause_game (void);
 
-void pause_delay( unsigned int delay );
-
 
 #endif /* PAUSE_H */
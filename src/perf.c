@@ -0,0 +1,360 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file perf.c
+ *
+ * @brief Lightweight hierarchical frame profiler.
+ *
+ * Zones accumulate wall clock time between perf_begin() and perf_end(),
+ *  summing over multiple runs within a frame (fixed simulation steps, per
+ *  pilot AI thinks).  perf_frame() closes the frame, smooths the values for
+ *  the overlay and optionally appends a CSV row for offline analysis.
+ *
+ * Zones run unconditionally -- the timestamps cost a few microseconds per
+ *  frame -- so the spike flight recorder works in production: the last
+ *  PERF_HISTORY frames sit in a ring and perf_spike() dumps them to
+ *  spikes.log when fps_control() sees a frame above PERF_SPIKE_MS.  The
+ *  mode only controls the overlay and the CSV dump.
+ *
+ * Each zone is only ever touched from one thread (simulation zones from the
+ *  update thread, the rest from the main thread) and perf_frame() runs after
+ *  the frame join, so no locking is needed.
+ */
+
+#include "perf.h"
+
+#include "naev.h"
+
+#include <stdio.h>
+#if HAS_POSIX
+#include <sys/time.h>
+#endif /* HAS_POSIX */
+#if HAS_WIN32
+#include <sys/types.h>
+#include <sys/timeb.h>
+#endif /* HAS_WIN32 */
+
+#include "log.h"
+#include "font.h"
+#include "opengl.h"
+#include "nfile.h"
+#include "count.h"
+
+
+/*
+ * Profiler modes.
+ */
+#define PERF_MODE_OFF      0 /**< Profiler disabled. */
+#define PERF_MODE_OVERLAY  1 /**< Ingame overlay only. */
+#define PERF_MODE_DUMP     2 /**< Overlay plus CSV dump. */
+
+#define PERF_SMOOTHING     0.05 /**< Exponential smoothing for the overlay. */
+
+/*
+ * Spike flight recorder.
+ */
+#define PERF_HISTORY       64   /**< Frames of zone data kept around. */
+#define PERF_SPIKE_MS      100. /**< Frame time that triggers a dump. */
+#define PERF_SPIKE_COOLDOWN 2000000L /**< us between dumps, or one long
+                                          hitch floods the log. */
+
+
+/**
+ * @struct PerfZoneData
+ *
+ * @brief Accumulated state of a single zone.
+ */
+typedef struct PerfZoneData_ {
+   const char *name; /**< Zone name for the overlay and the CSV header. */
+   int depth;        /**< Indentation depth in the overlay. */
+   long t0;          /**< Timestamp of the current begin in us. */
+   long accum;       /**< Time accumulated this frame in us. */
+   long frame;       /**< Last completed frame's time in us. */
+   double avg;       /**< Smoothed value for the overlay in ms. */
+} PerfZoneData;
+
+
+static PerfZoneData perf_zones[PERF_MAX] = {
+   { "frame",   0, 0, 0, 0, 0. },
+   { "update",  1, 0, 0, 0, 0. },
+   { "weapons", 2, 0, 0, 0, 0. },
+   { "pilots",  2, 0, 0, 0, 0. },
+   { "ai",      3, 0, 0, 0, 0. },
+   { "render",  1, 0, 0, 0, 0. },
+   { "sound",   1, 0, 0, 0, 0. },
+   { "luagc",   1, 0, 0, 0, 0. }
+}; /**< All the zones. */
+
+/**
+ * @struct PerfFrameData
+ *
+ * @brief One ring buffer slot of the spike flight recorder.
+ */
+typedef struct PerfFrameData_ {
+   long zone[PERF_MAX]; /**< Zone times of the frame in us. */
+   long cnt[COUNT_MAX]; /**< Counter values of the frame. */
+} PerfFrameData;
+
+
+static int perf_mode    = PERF_MODE_OFF; /**< Current profiler mode. */
+static long perf_last   = 0; /**< Timestamp of the last frame close. */
+static FILE *perf_file  = NULL; /**< CSV dump file when in dump mode. */
+
+static PerfFrameData perf_hist[PERF_HISTORY]; /**< Frame history ring. */
+static int perf_histPos = 0; /**< Next slot to write in the ring. */
+static long perf_spikeLast = 0; /**< Timestamp of the last spike dump. */
+
+
+/*
+ * Prototypes.
+ */
+static long perf_getTime (void);
+static void perf_dumpOpen (void);
+
+
+/**
+ * @brief Gets the current time in microseconds.
+ *
+ * Only differences matter so the epoch is irrelevant.
+ *
+ *    @return Current time in us.
+ */
+static long perf_getTime (void)
+{
+#if HAS_POSIX
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (long)tv.tv_sec * 1000000L + (long)tv.tv_usec;
+#elif HAS_WIN32
+   struct _timeb tb;
+   _ftime( &tb );
+   return (long)tb.time * 1000000L + (long)tb.millitm * 1000L;
+#else
+#error "Feature needs implementation on this Operating System for NAEV to work."
+#endif
+}
+
+
+/**
+ * @brief Opens a zone, pairs with perf_end().
+ *
+ *    @param zone Zone to open.
+ */
+void perf_begin( PerfZone zone )
+{
+   perf_zones[zone].t0 = perf_getTime();
+}
+
+
+/**
+ * @brief Closes a zone, adding the elapsed time to the frame's total.
+ *
+ *    @param zone Zone to close.
+ */
+void perf_end( PerfZone zone )
+{
+   perf_zones[zone].accum += perf_getTime() - perf_zones[zone].t0;
+}
+
+
+/**
+ * @brief Gets the time a zone has accumulated since the last frame close.
+ *
+ * Mainly for the benchmark mode which runs ticks without closing frames.
+ *
+ *    @param zone Zone to get the time of.
+ *    @return Accumulated time in us.
+ */
+long perf_current( PerfZone zone )
+{
+   return perf_zones[zone].accum;
+}
+
+
+/**
+ * @brief Closes the frame, must run once per frame after the frame join.
+ */
+void perf_frame (void)
+{
+   int i;
+   long t;
+
+   count_reset();
+
+   /* The frame zone is the time between closes so the swap is counted. */
+   t = perf_getTime();
+   if (perf_last != 0)
+      perf_zones[PERF_FRAME].accum = t - perf_last;
+   perf_last = t;
+
+   for (i=0; i<PERF_MAX; i++) {
+      perf_zones[i].frame = perf_zones[i].accum;
+      perf_zones[i].accum = 0;
+      perf_zones[i].avg  += PERF_SMOOTHING *
+            ((double)perf_zones[i].frame/1000. - perf_zones[i].avg);
+   }
+
+   /* Record the frame in the flight recorder ring. */
+   for (i=0; i<PERF_MAX; i++)
+      perf_hist[perf_histPos].zone[i] = perf_zones[i].frame;
+   for (i=0; i<COUNT_MAX; i++)
+      perf_hist[perf_histPos].cnt[i] = count_get(i);
+   perf_histPos = (perf_histPos+1) % PERF_HISTORY;
+
+   /* Append the CSV row. */
+   if (perf_mode == PERF_MODE_DUMP) {
+      for (i=0; i<PERF_MAX; i++)
+         fprintf( perf_file, (i==0) ? "%ld" : ",%ld", perf_zones[i].frame );
+      for (i=0; i<COUNT_MAX; i++)
+         fprintf( perf_file, ",%ld", count_get(i) );
+      fprintf( perf_file, "\n" );
+   }
+}
+
+
+/**
+ * @brief Renders the overlay below the FPS display.
+ *
+ *    @param x X position to render at.
+ *    @param y Y position to render at.
+ */
+void perf_render( double x, double y )
+{
+   int i;
+
+   if (perf_mode == PERF_MODE_OFF)
+      return;
+
+   for (i=0; i<PERF_MAX; i++) {
+      gl_print( &gl_smallFont, x + 10.*perf_zones[i].depth, y, NULL,
+            "%s %.2f ms", perf_zones[i].name, perf_zones[i].avg );
+      y -= gl_smallFont.h + 5.;
+   }
+   for (i=0; i<COUNT_MAX; i++) {
+      gl_print( &gl_smallFont, x, y, NULL,
+            "%s %ld", count_name(i), count_get(i) );
+      y -= gl_smallFont.h + 5.;
+   }
+   if (perf_mode == PERF_MODE_DUMP)
+      gl_print( &gl_smallFont, x, y, NULL, "dumping to profile.csv" );
+}
+
+
+/**
+ * @brief Dumps the flight recorder if the frame was a spike.
+ *
+ * Called from fps_control() with the measured frame time.  Appends the
+ *  whole history ring to spikes.log, oldest frame first, so the frames
+ *  leading up to the hitch are visible too.
+ *
+ *    @param dt Frame time in seconds.
+ */
+void perf_spike( double dt )
+{
+   char path[PATH_MAX];
+   FILE *f;
+   int i, j, p;
+   long t;
+
+   if (dt*1000. < PERF_SPIKE_MS)
+      return;
+
+   /* One multi-second hitch would otherwise dump every frame. */
+   t = perf_getTime();
+   if ((perf_spikeLast != 0) && (t - perf_spikeLast < PERF_SPIKE_COOLDOWN))
+      return;
+   perf_spikeLast = t;
+
+   snprintf( path, PATH_MAX, "%sspikes.log", nfile_basePath() );
+   f = fopen( path, "a" );
+   if (f == NULL) {
+      WARN("Unable to open '%s' for writing!", path);
+      return;
+   }
+
+   fprintf( f, "== spike: %.1f ms ==\n", dt*1000. );
+   for (i=0; i<PERF_MAX; i++)
+      fprintf( f, (i==0) ? "%s_us" : ",%s_us", perf_zones[i].name );
+   for (i=0; i<COUNT_MAX; i++)
+      fprintf( f, ",%s", count_name(i) );
+   fprintf( f, "\n" );
+   for (j=0; j<PERF_HISTORY; j++) {
+      p = (perf_histPos+j) % PERF_HISTORY; /* Oldest first. */
+      for (i=0; i<PERF_MAX; i++)
+         fprintf( f, (i==0) ? "%ld" : ",%ld", perf_hist[p].zone[i] );
+      for (i=0; i<COUNT_MAX; i++)
+         fprintf( f, ",%ld", perf_hist[p].cnt[i] );
+      fprintf( f, "\n" );
+   }
+   fclose(f);
+
+   DEBUG("Frame spike of %.1f ms, dumped flight recorder to spikes.log.",
+         dt*1000.);
+}
+
+
+/**
+ * @brief Opens the CSV dump file and writes the header.
+ */
+static void perf_dumpOpen (void)
+{
+   int i;
+   char path[PATH_MAX];
+
+   snprintf( path, PATH_MAX, "%sprofile.csv", nfile_basePath() );
+   perf_file = fopen( path, "w" );
+   if (perf_file == NULL) {
+      WARN("Unable to open '%s' for writing!", path);
+      return;
+   }
+
+   /* Header, times are in microseconds, counters are per frame. */
+   for (i=0; i<PERF_MAX; i++)
+      fprintf( perf_file, (i==0) ? "%s_us" : ",%s_us", perf_zones[i].name );
+   for (i=0; i<COUNT_MAX; i++)
+      fprintf( perf_file, ",%s", count_name(i) );
+   fprintf( perf_file, "\n" );
+}
+
+
+/**
+ * @brief Cycles the profiler: off -> overlay -> overlay and CSV dump -> off.
+ */
+void perf_toggle (void)
+{
+   switch (perf_mode) {
+      case PERF_MODE_OFF:
+         perf_mode = PERF_MODE_OVERLAY;
+         break;
+
+      case PERF_MODE_OVERLAY:
+         perf_dumpOpen();
+         if (perf_file == NULL) { /* Failed to open, wrap around. */
+            perf_mode = PERF_MODE_OFF;
+            break;
+         }
+         perf_mode = PERF_MODE_DUMP;
+         break;
+
+      case PERF_MODE_DUMP:
+         fclose(perf_file);
+         perf_file = NULL;
+         perf_mode = PERF_MODE_OFF;
+         break;
+   }
+}
+
+
+/**
+ * @brief Cleans up after the profiler.
+ */
+void perf_exit (void)
+{
+   if (perf_file != NULL) {
+      fclose(perf_file);
+      perf_file = NULL;
+   }
+   perf_mode = PERF_MODE_OFF;
+}
@@ -0,0 +1,54 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef PERF_H
+#  define PERF_H
+
+
+/**
+ * @enum PerfZone
+ *
+ * @brief The profiled zones.
+ *
+ * Children must follow their parent so the overlay indents properly.
+ */
+typedef enum PerfZone_ {
+   PERF_FRAME = 0, /**< Whole frame, buffer swap included. */
+   PERF_UPDATE,    /**< Simulation (all the fixed steps of the frame). */
+   PERF_WEAPONS,   /**< Weapon update within the simulation. */
+   PERF_PILOTS,    /**< Pilot update within the simulation. */
+   PERF_AI,        /**< AI thinking within the pilot update. */
+   PERF_RENDER,    /**< Scene rendering. */
+   PERF_SOUND,     /**< Sound update. */
+   PERF_LUAGC,     /**< Lua GC steps run in frame slack. */
+   PERF_MAX        /**< Sentinel. */
+} PerfZone;
+
+
+/*
+ * Instrumentation, cheap enough to stay on in production.
+ */
+#define PERF_BEGIN(z)   perf_begin(z)
+#define PERF_END(z)     perf_end(z)
+void perf_begin( PerfZone zone );
+void perf_end( PerfZone zone );
+long perf_current( PerfZone zone );
+
+/*
+ * Frame handling.
+ */
+void perf_frame (void);
+void perf_render( double x, double y );
+void perf_spike( double dt );
+
+/*
+ * Control.
+ */
+void perf_toggle (void);
+void perf_exit (void);
+
+
+#endif /* PERF_H */
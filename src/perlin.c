@@ -54,6 +54,7 @@
 #include "log.h"
 #include "rng.h"
 #include "nfile.h"
+#include "njob.h"
 
 
 #define TCOD_NOISE_MAX_OCTAVES            4 /**< Default octaves for noise. */
@@ -100,6 +101,22 @@ static float TCOD_noise_get2( perlin_data_t* pdata, float f[2] );
 /* turbulence */
 static float TCOD_noise_turbulence3( perlin_data_t* noise, float f[3], int octaves );
 static float TCOD_noise_turbulence2( perlin_data_t* noise, float f[2], int octaves );
+/* nebula generation */
+static void noise_genNebulaMapRows( int start, int end, void *data );
+
+
+/**
+ * @brief Parameters for the sharded nebula generation.
+ */
+typedef struct nebu_gen_s {
+   perlin_data_t *noise; /**< Shared noise state, read-only while sampling. */
+   float *nebula; /**< Map being filled. */
+   int w; /**< Map width. */
+   int h; /**< Map height. */
+   int n; /**< Number of slices. */
+   float zoom; /**< Zoom level of the map. */
+   int octaves; /**< Octaves to sample. */
+} nebu_gen_t;
 
 
 /**
@@ -462,6 +479,38 @@ float* noise_genRadarInt( const int w, const int h, float rug )
 }
 
 
+/**
+ * @brief Fills a band of nebula scanlines.
+ *
+ * The noise tables are immutable once created, so every worker samples
+ *  the same state and rows come out identical to the serial version.
+ *
+ *    @param start First global scanline (z*h + y) to fill.
+ *    @param end One past the last scanline to fill.
+ *    @param data The nebu_gen_t describing the map.
+ */
+static void noise_genNebulaMapRows( int start, int end, void *data )
+{
+   nebu_gen_t *gen = (nebu_gen_t*) data;
+   int x, y, z, row;
+   float f[3];
+
+   for (row=start; row<end; row++) {
+      z = row / gen->h;
+      y = row % gen->h;
+
+      f[2] = gen->zoom * (float)z / (float)gen->n;
+      f[1] = gen->zoom * (float)y / (float)gen->h;
+
+      for (x=0; x<gen->w; x++) {
+         f[0] = gen->zoom * (float)x / (float)gen->w;
+         gen->nebula[ row*gen->w + x ] =
+               TCOD_noise_turbulence3( gen->noise, f, gen->octaves );
+      }
+   }
+}
+
+
 /**
  * @brief Generates a 3d nebula map.
  *
@@ -473,23 +522,19 @@ float* noise_genRadarInt( const int w, const int h, float rug )
  */
 float* noise_genNebulaMap( const int w, const int h, const int n, float rug )
 {
-   int x, y, z;
-   float f[3];
-   int octaves;
+   int i;
    float hurst;
    float lacunarity;
    perlin_data_t* noise;
    float *nebula;
    float value;
-   float zoom;
    float max;
-   unsigned int *t, s;
+   unsigned int s;
+   nebu_gen_t gen;
 
    /* pretty default values */
-   octaves     = 3;
    hurst       = TCOD_NOISE_DEFAULT_HURST;
    lacunarity  = TCOD_NOISE_DEFAULT_LACUNARITY;
-   zoom        = rug * ((float)h/768.)*((float)w/1024.);
 
    /* create noise and data */
    noise       = TCOD_noise_new( 3, hurst, lacunarity );
@@ -501,42 +546,27 @@ float* noise_genNebulaMap( const int w, const int h, const int n, float rug )
 
    /* Some debug information and time setting */
    s = SDL_GetTicks();
-   t = malloc(sizeof(unsigned int)*n);
    DEBUG("Generating Nebula of size %dx%dx%d", w, h, n);
 
-   /* Start to create the nebula */
-   max = 0.;
-   for (z=0; z<n; z++) {
-
-      f[2] = zoom * (float)z / (float)n;
-
-      for (y=0; y<h; y++) {
-
-         f[1] = zoom * (float)y / (float)h;
-
-         for (x=0; x<w; x++) {
-
-            f[0] = zoom * (float)x / (float)w;
-
-            value = TCOD_noise_turbulence3( noise, f, octaves );
-            if (max < value) max = value;
-
-            nebula[z*w*h + y*w + x] = value;
-         }
-      }
-
-      /* More time magic debug */
-      t[z] = SDL_GetTicks();
-      DEBUG("   Layer %d/%d generated in %d ms", z+1, n,
-            (z>0) ? t[z] - t[z-1] : t[z] - s );
-   }
+   /* Create the nebula - scanlines are independent so they shard
+    * across cores. */
+   gen.noise   = noise;
+   gen.nebula  = nebula;
+   gen.w       = w;
+   gen.h       = h;
+   gen.n       = n;
+   gen.zoom    = rug * ((float)h/768.)*((float)w/1024.);
+   gen.octaves = 3;
+   njob_parallelFor( noise_genNebulaMapRows, h*n, &gen );
 
    /* Post filtering */
+   max = 0.;
+   for (i=0; i<w*h*n; i++)
+      if (max < nebula[i])
+         max = nebula[i];
    value = 1. - max;
-   for (z=0; z<n; z++)
-      for (y=0; y<h; y++)
-         for (x=0; x<w; x++)
-            nebula[z*w*h + y*w + x] += value;
+   for (i=0; i<w*h*n; i++)
+      nebula[i] += value;
 
    /* Clean up */
    TCOD_noise_delete( noise );
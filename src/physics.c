@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "log.h"
+#include "pause.h"
 
 
 /*
@@ -72,9 +73,45 @@ void limit_speed( Vector2d* vel, const double speed, const double dt )
  * V E C T O R 2 D
  *
  */
+/**
+ * @brief Gets the modulus of a vector, refreshing the polar cache.
+ *
+ *    @param v Vector to get the modulus of.
+ *    @return The modulus of the vector.
+ */
+double vect_vmod( Vector2d* v )
+{
+   if (!v->polar) {
+      v->mod   = MOD(v->x,v->y);
+      v->angle = ANGLE(v->x,v->y);
+      v->polar = 1;
+   }
+   return v->mod;
+}
+
+
+/**
+ * @brief Gets the angle of a vector, refreshing the polar cache.
+ *
+ *    @param v Vector to get the angle of.
+ *    @return The angle of the vector.
+ */
+double vect_vangle( Vector2d* v )
+{
+   if (!v->polar) {
+      v->mod   = MOD(v->x,v->y);
+      v->angle = ANGLE(v->x,v->y);
+      v->polar = 1;
+   }
+   return v->angle;
+}
+
+
 /**
  * @brief Set the vector value using cartesian coordinates
  *
+ * The polar form is computed lazily on the next VMOD()/VANGLE().
+ *
  *    @param v Vector to set.
  *    @param x X value for vector.
  *    @param y Y value for vector.
@@ -83,8 +120,7 @@ void vect_cset( Vector2d* v, const double x, const double y )
 {
    v->x     = x;
    v->y     = y;
-   v->mod   = MOD(x,y);
-   v->angle = ANGLE(x,y);
+   v->polar = 0;
 }
 
 
@@ -97,8 +133,9 @@ void vect_cset( Vector2d* v, const double x, const double y )
  */
 void vect_csetmin( Vector2d* v, const double x, const double y )
 {
-   v->x = x;
-   v->y = y;
+   v->x     = x;
+   v->y     = y;
+   v->polar = 0;
 }
 
 
@@ -113,6 +150,7 @@ void vect_pset( Vector2d* v, const double mod, const double angle )
 {
    v->mod   = mod;
    v->angle = angle;
+   v->polar = 1;
    v->x     = v->mod*cos(v->angle);
    v->y     = v->mod*sin(v->angle);
 }
@@ -130,6 +168,7 @@ void vectcpy( Vector2d* dest, const Vector2d* src )
    dest->y     = src->y;
    dest->mod   = src->mod;
    dest->angle = src->angle;
+   dest->polar = src->polar;
 }
 
 
@@ -144,6 +183,7 @@ void vectnull( Vector2d* v )
    v->y     = 0.;
    v->mod   = 0.;
    v->angle = 0.;
+   v->polar = 1;
 }
 
 
@@ -176,8 +216,7 @@ void vect_cadd( Vector2d* v, const double x, const double y )
 {
    v->x    += x;
    v->y    += y;
-   v->mod   = MOD(v->x,v->y);
-   v->angle = ANGLE(v->x,v->y);
+   v->polar = 0;
 }
 
 
@@ -195,8 +234,7 @@ void vect_reflect( Vector2d* r, Vector2d* v, Vector2d* n )
    dot      = vect_dot( v, n );
    r->x     = v->x - ((2. * dot) * n->x);
    r->y     = v->y - ((2. * dot) * n->y);
-   r->mod   = MOD(r->x,r->y);
-   r->angle = MOD(r->x,r->y);
+   r->polar = 0;
 }
 
 
@@ -235,6 +273,9 @@ static void simple_update (Solid *obj, const double dt)
 {
    double px,py, vx,vy, ax;
 
+   /* Save the previous state for render interpolation. */
+   vectcpy( &obj->ppos, &obj->pos );
+
    /* make sure angle doesn't flip */
    obj->dir += M_PI/180.*obj->dir_vel*dt;
    if (obj->dir >= 2*M_PI)
@@ -257,9 +298,6 @@ static void simple_update (Solid *obj, const double dt)
 
       px += vx*dt + 0.5*ax * dt*dt;
       py += vy*dt + 0.5*ay * dt*dt;
-
-      obj->vel.mod = MOD(vx,vy);
-      obj->vel.angle = ANGLE(vx,vy);
    }
    else {
       px += vx*dt;
@@ -306,6 +344,9 @@ static void rk4_update (Solid *obj, const double dt)
    double h, px,py, vx,vy; /* pass, and position/velocity values */
    double ix,iy, tx,ty, ax; /* initial and temporary cartesian vector values */
 
+   /* Save the previous state for render interpolation. */
+   vectcpy( &obj->ppos, &obj->pos );
+
    /* Initial RK parameters. */
    N = (dt>RK4_MIN_H) ? (int)(dt/RK4_MIN_H) : 1 ;
    h = dt / (double)N; /* step */
@@ -365,6 +406,42 @@ static void rk4_update (Solid *obj, const double dt)
 #endif /* !HAS_FREEBSD */
 
 
+/**
+ * @brief Cheap one-step Euler integrator for solids far from the camera.
+ *
+ * The RK4 substeps buy sub-pixel accuracy that is invisible off-screen,
+ *  so distant weapons and pilots use this instead; callers pick based on
+ *  gl_cameraInView() with SOLID_FAR_MARGIN.
+ *
+ *    @param obj Solid to update.
+ *    @param dt Current delta tick.
+ */
+void solid_updateFar( Solid *obj, const double dt )
+{
+   double ax;
+
+   /* Save the previous state for render interpolation. */
+   vectcpy( &obj->ppos, &obj->pos );
+
+   /* Rotation. */
+   obj->dir += M_PI/180.*obj->dir_vel*dt;
+   if (obj->dir >= 2.*M_PI)
+      obj->dir -= 2.*M_PI;
+   else if (obj->dir < 0.)
+      obj->dir += 2.*M_PI;
+
+   /* Acceleration. */
+   if (obj->force_x > 0.) {
+      ax = obj->force_x / obj->mass;
+      vect_cadd( &obj->vel, ax*cos(obj->dir)*dt, ax*sin(obj->dir)*dt );
+   }
+
+   /* Position. */
+   vect_cset( &obj->pos, obj->pos.x + obj->vel.x*dt,
+         obj->pos.y + obj->vel.y*dt );
+}
+
+
 /**
  * @brief Initializes a new Solid.
  *
@@ -404,6 +481,7 @@ void solid_init( Solid* dest, const double mass, const double dir,
       vectnull( &dest->pos );
    else
       vectcpy( &dest->pos, pos);
+   vectcpy( &dest->ppos, &dest->pos );
 
 /*
  * FreeBSD seems to have a bug with optimizations in rk4_update causing it to
@@ -446,3 +524,33 @@ void solid_free( Solid* src )
    free(src);
 }
 
+
+#define SOLID_INTERP_SNAP 100. /**< Largest step considered actual motion. */
+/**
+ * @brief Gets the solid's position interpolated between the last two
+ *        simulation steps.
+ *
+ * Uses sim_interp, the fraction of a step the render is past the last
+ *  simulated state.  A jump larger than any ship can move in one step
+ *  is a teleport (hyperspace, takeoff) and snaps instead of streaking.
+ *
+ *    @param s Solid to get the position of.
+ *    @param[out] x X position to get.
+ *    @param[out] y Y position to get.
+ */
+void solid_getInterpPos( const Solid *s, double *x, double *y )
+{
+   double dx, dy;
+
+   dx = s->pos.x - s->ppos.x;
+   dy = s->pos.y - s->ppos.y;
+   if ((FABS(dx) > SOLID_INTERP_SNAP) || (FABS(dy) > SOLID_INTERP_SNAP)) {
+      *x = s->pos.x;
+      *y = s->pos.y;
+      return;
+   }
+
+   *x = s->ppos.x + dx * sim_interp;
+   *y = s->ppos.y + dy * sim_interp;
+}
+
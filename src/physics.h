@@ -13,8 +13,8 @@
 
 #define VX(v)     ((v).x) /**< Gets the X component of a vector. */
 #define VY(v)     ((v).y) /**< Gets the Y component of a vector. */
-#define VMOD(v)   ((v).mod) /**< Gets the modulus of a vector. */
-#define VANGLE(v) ((v).angle) /**< Gets the angle of a vector. */
+#define VMOD(v)   vect_vmod( (Vector2d*) &(v) ) /**< Gets the modulus of a vector. */
+#define VANGLE(v) vect_vangle( (Vector2d*) &(v) ) /**< Gets the angle of a vector. */
 
 #define MOD(x,y)  (sqrt((x)*(x)+(y)*(y))) /**< Gets the modulus of a vector by cartesian coordinates. */
 #define ANGLE(x,y) (atan2(y,x)) /**< Gets the angle of two cartesian coordinates. */
@@ -26,12 +26,16 @@
 
 /**
  * @brief Represents a 2d vector.
+ *
+ * The polar fields are caches computed on demand by VMOD()/VANGLE(),
+ *  so cartesian updates (the integrator hot path) do no trigonometry.
  */
 typedef struct Vector2d_ {                                          
    double x; /**< X cartesian position of the vector. */
    double y; /**< Y cartesian position of the vector. */
-   double mod; /**< Modulus of the vector. */
-   double angle; /**< Angle of the vector. */
+   double mod; /**< Modulus of the vector, lazily computed. */
+   double angle; /**< Angle of the vector, lazily computed. */
+   int polar; /**< Non-zero when mod and angle are up to date. */
 } Vector2d; /**< 2 dimensional vector. */
 
 
@@ -45,6 +49,8 @@ void limit_speed( Vector2d* vel, const double speed, const double dt );
 /*
  * vector manipulation
  */
+double vect_vmod( Vector2d* v );
+double vect_vangle( Vector2d* v );
 void vect_cset( Vector2d* v, const double x, const double y );
 void vect_csetmin( Vector2d* v, const double x, const double y ); /* does not set mod nor angle */
 void vect_pset( Vector2d* v, const double mod, const double angle );
@@ -65,20 +71,26 @@ typedef struct Solid_ {
    double dir_vel; /**< Velocity at which solid is rotating. */
    Vector2d vel; /**< Velocity of the solid. */
    Vector2d pos; /**< Position of the solid. */
+   Vector2d ppos; /**< Position at the previous simulation step. */
    double force_x; /**< X force in RELATIVE to solid position. */
    /*double force_y;*/ /**< Y force in RELATIVE to solid position. */
    void (*update)( struct Solid_*, const double ); /**< Update method. */
 } Solid;
 
 
+#define SOLID_FAR_MARGIN   500. /**< Distance past the screen edge where cheap integration kicks in. */
+
+
 /*
  * solid manipulation
  */
+void solid_updateFar( Solid *obj, const double dt );
 void solid_init( Solid* dest, const double mass, const double dir,
       const Vector2d* pos, const Vector2d* vel );
 Solid* solid_create( const double mass, const double dir,
       const Vector2d* pos, const Vector2d* vel );
 void solid_free( Solid* src );
+void solid_getInterpPos( const Solid *s, double *x, double *y );
 
 
 #endif /* PHYSICS_H */
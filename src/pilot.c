@@ -22,6 +22,7 @@
 #include "nxml.h"
 
 #include "log.h"
+#include "count.h"
 #include "weapon.h"
 #include "ndata.h"
 #include "spfx.h"
@@ -30,17 +31,27 @@
 #include "map.h"
 #include "explosion.h"
 #include "escort.h"
+#include "nmem.h"
 #include "music.h"
 #include "player.h"
 #include "gui.h"
 #include "board.h"
 #include "debris.h"
 #include "ntime.h"
+#include "njob.h"
+#include "spatial.h"
+#include "intern.h"
+#include "nalloc.h"
+#include "array.h"
 
 
 #define PILOT_CHUNK     32 /**< Chunks to increment pilot_stack by */
 #define CHUNK_SIZE      32 /**< Size to allocate memory by. */
 
+#define PILOT_GRID_CELL 256. /**< Side of a proximity grid cell. */
+
+#define PILOT_LOD_PIXELS 4. /**< On-screen size below which pilots render as points. */
+
 
 /* ID Generators. */
 static unsigned int pilot_id = PLAYER_ID; /**< Stack of pilot ids to assure uniqueness */
@@ -55,9 +66,54 @@ int pilot_nstack = 0; /**< same */
 static int pilot_mstack = 0; /**< Memory allocated for pilot_stack. */
 
 
+/*
+ * Pilots in the stack are also chained into an id hash so pilot_get()
+ *  resolves ids in O(1) instead of binary searching an array that moves
+ *  every time a pilot dies.  Ids are never reused so a cached id acts as
+ *  a generation-stamped handle on its own.
+ */
+#define PILOT_HASH_SIZE    256 /**< Buckets in the id hash, power of two. */
+#define PILOT_HASH(id)     ((id) & (PILOT_HASH_SIZE-1)) /**< Bucket of an id. */
+static Pilot *pilot_hash[PILOT_HASH_SIZE]; /**< Id hash of the stack pilots. */
+
+
+/*
+ * The stack is additionally partitioned into per-faction membership
+ *  lists so hostile-target scans only walk pilots that can actually be
+ *  hostile instead of filtering the whole stack.  Pilots flagged
+ *  hostile regardless of faction sit in a small stack of their own.
+ */
+static Pilot **pilot_flist = NULL; /**< Faction list heads, indexed by faction id. */
+static int pilot_nflist = 0; /**< Number of faction list heads. */
+static Pilot **pilot_hostiles = NULL; /**< Flag-hostile pilots, array.c vector. */
+
+
+/*
+ * Pilots get allocated from contiguous slabs instead of individual mallocs
+ *  so that walking the stack in pilots_update() streams through memory
+ *  instead of jumping around the heap.
+ */
+#define PILOT_SLAB_SIZE    64 /**< Pilots per allocation slab. */
+/**
+ * @brief A slot in a pilot slab - a pilot or a free list link.
+ */
+typedef union PilotSlot_ {
+   Pilot p; /**< Actual pilot data when in use. */
+   union PilotSlot_ *next; /**< Next free slot when unused. */
+} PilotSlot;
+static PilotSlot **pilot_slabs = NULL; /**< All the allocated slabs. */
+static int pilot_nslabs = 0; /**< Number of allocated slabs. */
+static PilotSlot *pilot_slotfree = NULL; /**< Head of the free slot list. */
+
+
 /* misc */
 static double sensor_curRange = 0.; /**< Current base sensor range, used to calculate
                                          what is in range and what isn't. */
+static SpatialGrid *pilot_grid = NULL; /**< Proximity grid, shared with the
+                                            weapon collision broad phase. */
+static double pilot_visPlayerMoved = 0.; /**< Player movement accumulator for
+                                              the visibility cache. */
+static int pilot_visGen = 1; /**< Bumped when the sensor range changes. */
 
 
 /*
@@ -71,8 +127,14 @@ extern void ai_think( Pilot* pilot, const double dt ); /**< from ai.c */
 /* internal */
 /* update. */
 static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w );
+static void pilot_updateSerial( Pilot* pilot, const double dt );
+static void pilot_updatePhysics( Pilot* pilot, const double dt );
+static void pilots_updatePhysics( int start, int end, void *data );
 static void pilot_hyperspace( Pilot* pilot, double dt );
 static void pilot_refuel( Pilot *p, double dt );
+/* outfits. */
+static void pilot_shipTemplate( Ship *ship );
+static PilotOutfitSlot* pilot_outfitsFork( Pilot* pilot, PilotOutfitSlot *s );
 /* cargo. */
 static int pilot_rmCargoRaw( Pilot* pilot, Commodity* cargo, int quantity, int cleanup );
 static void pilot_calcCargo( Pilot* pilot );
@@ -81,8 +143,19 @@ static int pilot_addCargoRaw( Pilot* pilot, Commodity* cargo,
 /* clean up. */
 void pilot_free( Pilot* p ); /* externed in player.c */
 static void pilot_dead( Pilot* p );
+/* allocation. */
+static Pilot* pilot_alloc (void);
+static void pilot_dealloc( Pilot *p );
 /* misc */
 static int pilot_getStackPos( const unsigned int id );
+static void pilot_hashAdd( Pilot *p );
+static void pilot_hashRemove( Pilot *p );
+static void pilot_factionAdd( Pilot *p );
+static void pilot_factionRemove( Pilot *p );
+static void pilot_hostilesRemove( Pilot *p );
+static int pilot_nearestConsider( const Pilot *p, Pilot *t,
+      double *dist, unsigned int *ids, int nfound, int max );
+static int pilot_getNearby( const Pilot *p, Pilot ***nearby );
 static void pilot_updateMass( Pilot *pilot );
 
 
@@ -110,6 +183,124 @@ static int pilot_getStackPos( const unsigned int id )
 }
 
 
+/**
+ * @brief Adds a pilot to the id hash.
+ *
+ *    @param p Pilot to add.
+ */
+static void pilot_hashAdd( Pilot *p )
+{
+   int b;
+
+   b = PILOT_HASH(p->id);
+   p->hnext = pilot_hash[b];
+   pilot_hash[b] = p;
+}
+
+
+/**
+ * @brief Removes a pilot from the id hash, no-op if he isn't in it.
+ *
+ *    @param p Pilot to remove.
+ */
+static void pilot_hashRemove( Pilot *p )
+{
+   Pilot **pp;
+
+   pp = &pilot_hash[ PILOT_HASH(p->id) ];
+   while (*pp != NULL) {
+      if (*pp == p) {
+         *pp = p->hnext;
+         p->hnext = NULL;
+         return;
+      }
+      pp = &(*pp)->hnext;
+   }
+}
+
+
+/**
+ * @brief Adds a pilot to his faction's membership list.
+ *
+ *    @param p Pilot to add.
+ */
+static void pilot_factionAdd( Pilot *p )
+{
+   if (pilot_flist == NULL) {
+      pilot_nflist = faction_count();
+      pilot_flist  = calloc( pilot_nflist, sizeof(Pilot*) );
+   }
+   if ((p->faction < 0) || (p->faction >= pilot_nflist))
+      return;
+   p->fnext = pilot_flist[ p->faction ];
+   pilot_flist[ p->faction ] = p;
+}
+
+
+/**
+ * @brief Removes a pilot from his faction's membership list.
+ *
+ *    @param p Pilot to remove.
+ */
+static void pilot_factionRemove( Pilot *p )
+{
+   Pilot **pp;
+
+   if ((pilot_flist == NULL) ||
+         (p->faction < 0) || (p->faction >= pilot_nflist))
+      return;
+   pp = &pilot_flist[ p->faction ];
+   while (*pp != NULL) {
+      if (*pp == p) {
+         *pp = p->fnext;
+         p->fnext = NULL;
+         return;
+      }
+      pp = &(*pp)->fnext;
+   }
+}
+
+
+/**
+ * @brief Removes a pilot from the flag-hostile stack, no-op if absent.
+ *
+ *    @param p Pilot to remove.
+ */
+static void pilot_hostilesRemove( Pilot *p )
+{
+   int i, n;
+
+   if (pilot_hostiles == NULL)
+      return;
+   n = array_size(pilot_hostiles);
+   for (i=0; i<n; i++)
+      if (pilot_hostiles[i] == p) {
+         pilot_hostiles[i] = pilot_hostiles[n-1];
+         array_size(pilot_hostiles) = n-1;
+         return;
+      }
+}
+
+
+/**
+ * @brief Changes a pilot's faction, keeping the membership lists in sync.
+ *
+ * Must be used instead of writing the faction directly once the pilot
+ *  is in the stack.
+ *
+ *    @param p Pilot to change.
+ *    @param faction New faction of the pilot.
+ */
+void pilot_setFaction( Pilot *p, int faction )
+{
+   if (p->faction == faction)
+      return;
+   pilot_factionRemove( p );
+   p->faction = faction;
+   pilot_factionAdd( p );
+}
+
+
 /**
  * @brief Gets the next pilot based on id.
  *
@@ -119,7 +310,9 @@ static int pilot_getStackPos( const unsigned int id )
  */
 unsigned int pilot_getNextID( const unsigned int id, int mode )
 {
-   int m, p;
+   int m, p, f, n;
+   unsigned int best;
+   Pilot *t;
 
    /* Player must exist. */
    if (player == NULL)
@@ -138,21 +331,36 @@ unsigned int pilot_getNextID( const unsigned int id, int mode )
       while (p < pilot_nstack) {
          if (((pilot_stack[p]->faction != FACTION_PLAYER) ||
                   (pilot_isDisabled(pilot_stack[p]))) &&
-               pilot_inRangePilot( player, pilot_stack[p] ))
+               pilot_inRangePlayer( pilot_stack[p] ))
             return pilot_stack[p]->id;
          p++;
       }
    }
-   /* Get first hostile in range. */
+   /* Get first hostile in range - ids are monotonic so the stack is
+    * sorted by id and "next in the stack" is "smallest greater id".
+    * Only the hostile partition gets walked. */
    if (mode == 1) {
-      while (p < pilot_nstack) {
-         if ((pilot_stack[p]->faction != FACTION_PLAYER) &&
-               pilot_inRangePilot( player, pilot_stack[p] ) &&
-               (pilot_isFlag(pilot_stack[p],PILOT_HOSTILE) ||
-                  areEnemies( FACTION_PLAYER, pilot_stack[p]->faction)))
-            return pilot_stack[p]->id;
-         p++;
+      best = 0;
+      for (f=0; f<pilot_nflist; f++) {
+         if ((f == FACTION_PLAYER) || !areEnemies( FACTION_PLAYER, f ))
+            continue;
+         for (t = pilot_flist[f]; t != NULL; t = t->fnext)
+            if ((t->id > id) && ((best == 0) || (t->id < best)) &&
+                  pilot_inRangePlayer( t ))
+               best = t->id;
+      }
+      if (pilot_hostiles != NULL) {
+         n = array_size(pilot_hostiles);
+         for (f=0; f<n; f++) {
+            t = pilot_hostiles[f];
+            if ((t->faction != FACTION_PLAYER) &&
+                  (t->id > id) && ((best == 0) || (t->id < best)) &&
+                  pilot_inRangePlayer( t ))
+               best = t->id;
+         }
       }
+      if (best != 0)
+         return best;
    }
 
    /* None found. */
@@ -168,7 +376,9 @@ unsigned int pilot_getNextID( const unsigned int id, int mode )
  */
 unsigned int pilot_getPrevID( const unsigned int id, int mode )
 {
-   int m, p;
+   int m, p, f, n;
+   unsigned int best;
+   Pilot *t;
 
    /* Player must exist. */
    if (player == NULL)
@@ -190,21 +400,36 @@ unsigned int pilot_getPrevID( const unsigned int id, int mode )
       while (p >= 0) {
          if (((pilot_stack[p]->faction != FACTION_PLAYER) ||
                   (pilot_isDisabled(pilot_stack[p]))) &&
-               pilot_inRangePilot( player, pilot_stack[p] ))
+               pilot_inRangePlayer( pilot_stack[p] ))
             return pilot_stack[p]->id;
          p--;
       }
    }
-   /* Get first hostile in range. */
+   /* Get first hostile in range - the previous pilot in the stack is
+    * the largest smaller id, wrapping to the largest id when coming
+    * from the front.  Only the hostile partition gets walked. */
    else if (mode == 1) {
-      while (p >= 0) {
-         if ((pilot_stack[p]->faction != FACTION_PLAYER) &&
-               pilot_inRangePilot( player, pilot_stack[p] ) &&
-               (pilot_isFlag(pilot_stack[p],PILOT_HOSTILE) ||
-                  areEnemies( FACTION_PLAYER, pilot_stack[p]->faction)))
-            return pilot_stack[p]->id;
-         p--;
+      best = 0;
+      for (f=0; f<pilot_nflist; f++) {
+         if ((f == FACTION_PLAYER) || !areEnemies( FACTION_PLAYER, f ))
+            continue;
+         for (t = pilot_flist[f]; t != NULL; t = t->fnext)
+            if (((m == 0) || (t->id < id)) && (t->id > best) &&
+                  pilot_inRangePlayer( t ))
+               best = t->id;
       }
+      if (pilot_hostiles != NULL) {
+         n = array_size(pilot_hostiles);
+         for (f=0; f<n; f++) {
+            t = pilot_hostiles[f];
+            if ((t->faction != FACTION_PLAYER) &&
+                  ((m == 0) || (t->id < id)) && (t->id > best) &&
+                  pilot_inRangePlayer( t ))
+               best = t->id;
+         }
+      }
+      if (best != 0)
+         return best;
    }
 
    /* None found. */
@@ -212,6 +437,131 @@ unsigned int pilot_getPrevID( const unsigned int id, int mode )
 }
 
 
+/**
+ * @brief Gets the candidates for a proximity query around a pilot.
+ *
+ * Uses the shared spatial grid when the sensor range is finite so
+ *  queries only touch nearby cells; falls back to the whole stack when
+ *  there's no interference (infinite range) or no grid yet.
+ *
+ *    @param p Pilot to query around.
+ *    @param[out] nearby Set to the candidate list.
+ *    @return Number of candidates.
+ */
+static int pilot_getNearby( const Pilot *p, Pilot ***nearby )
+{
+   if ((pilot_grid == NULL) || (cur_system->interference == 0.)) {
+      *nearby = pilot_stack;
+      return pilot_nstack;
+   }
+
+   return spatial_query( pilot_grid, (void***)nearby,
+         p->solid->pos.x, p->solid->pos.y, sqrt(sensor_curRange) );
+}
+
+
+/**
+ * @brief Gets up to max nearest enemies of the pilot, nearest first.
+ *
+ * Shared by the AI and anything else that wants a batch of hostiles
+ *  instead of calling pilot_getNearestEnemy() repeatedly.
+ *
+ *    @param p Pilot to get the enemies of.
+ *    @param[out] ids Array of at least max entries to fill with ids.
+ *    @param max Maximum enemies to get, capped at PILOT_MAX_NEAREST.
+ *    @return Number of enemies found.
+ */
+/**
+ * @brief Runs the shared candidate checks and the sorted insert for the
+ *  nearest-enemies scan.
+ *
+ *    @param p Pilot scanning for enemies.
+ *    @param t Candidate enemy.
+ *    @param dist Distances of the entries in ids.
+ *    @param ids Ids found so far, sorted by distance.
+ *    @param nfound Number of entries in ids.
+ *    @param max Maximum entries ids can hold.
+ *    @return The new number of entries in ids.
+ */
+static int pilot_nearestConsider( const Pilot *p, Pilot *t,
+      double *dist, unsigned int *ids, int nfound, int max )
+{
+   int j;
+   double td;
+
+   /* Must not be bribed. */
+   if ((t->faction == FACTION_PLAYER) && pilot_isFlag(p,PILOT_BRIBED))
+      return nfound;
+
+   /* Shouldn't be disabled. */
+   if (pilot_isDisabled(t))
+      return nfound;
+
+   /* Must be in range. */
+   if (!pilot_inRangePilot( p, t ))
+      return nfound;
+
+   /* Insert sorted by distance, dropping the farthest when full. */
+   td = vect_dist2(&t->solid->pos, &p->solid->pos);
+   for (j=nfound; (j>0) && (dist[j-1] > td); j--) {
+      if (j < max) {
+         dist[j] = dist[j-1];
+         ids[j]  = ids[j-1];
+      }
+   }
+   if (j < max) {
+      dist[j] = td;
+      ids[j]  = t->id;
+      if (nfound < max)
+         nfound++;
+   }
+   return nfound;
+}
+
+
+int pilot_getNearestEnemies( const Pilot* p, unsigned int *ids, int max )
+{
+   int i, n, f, nfound;
+   double dist[PILOT_MAX_NEAREST];
+   Pilot **nearby;
+   Pilot *t;
+
+   if (max > PILOT_MAX_NEAREST)
+      max = PILOT_MAX_NEAREST;
+
+   nfound = 0;
+
+   /* With interference the spatial grid already narrows the scan. */
+   if ((pilot_grid != NULL) && (cur_system->interference != 0.)) {
+      n = spatial_query( pilot_grid, (void***)&nearby,
+            p->solid->pos.x, p->solid->pos.y, sqrt(sensor_curRange) );
+      for (i=0; i<n; i++) {
+         t = nearby[i];
+         if (!(areEnemies(p->faction, t->faction) || /* Enemy faction. */
+               ((t->id == PLAYER_ID) &&
+                  pilot_isFlag(p,PILOT_HOSTILE)))) /* Hostile to player. */
+            continue;
+         nfound = pilot_nearestConsider( p, t, dist, ids, nfound, max );
+      }
+      return nfound;
+   }
+
+   /* Otherwise walk only the factions actually hostile to p. */
+   for (f=0; f<pilot_nflist; f++) {
+      if (!areEnemies( p->faction, f ))
+         continue;
+      for (t = pilot_flist[f]; t != NULL; t = t->fnext)
+         nfound = pilot_nearestConsider( p, t, dist, ids, nfound, max );
+   }
+   /* The player is also a target when p is flagged hostile. */
+   if (pilot_isFlag(p,PILOT_HOSTILE) && (player != NULL) &&
+         !areEnemies( p->faction, FACTION_PLAYER ))
+      nfound = pilot_nearestConsider( p, player, dist, ids, nfound, max );
+
+   return nfound;
+}
+
+
 /**
  * @brief Gets the nearest enemy to the pilot.
  *
@@ -221,36 +571,60 @@ unsigned int pilot_getPrevID( const unsigned int id, int mode )
 unsigned int pilot_getNearestEnemy( const Pilot* p )
 {
    unsigned int tp;
-   int i;
-   double d, td;
 
-   tp = 0;
-   d = 0.;
-   for (i=0; i<pilot_nstack; i++) {
-      /* Must not be bribed. */
-      if ((pilot_stack[i]->faction == FACTION_PLAYER) && pilot_isFlag(p,PILOT_BRIBED))
-         continue;
+   if (pilot_getNearestEnemies( p, &tp, 1 ) == 0)
+      return 0;
+   return tp;
+}
 
-      if ((areEnemies(p->faction, pilot_stack[i]->faction) || /* Enemy faction. */
-            ((pilot_stack[i]->id == PLAYER_ID) && 
-               pilot_isFlag(p,PILOT_HOSTILE)))) { /* Hostile to player. */
 
-         /* Shouldn't be disabled. */
-         if (pilot_isDisabled(pilot_stack[i]))
-            continue;
+/**
+ * @brief Gets the hostile nearest to the player.
+ *
+ * Only walks the hostile partition like the hostile target cycling, so
+ *  it's cheap enough to poll every frame.
+ *
+ *    @return ID of the nearest hostile in sensor range or PLAYER_ID if none.
+ */
+unsigned int pilot_getNearestHostile (void)
+{
+   unsigned int tp;
+   int f, n;
+   double d, td;
+   Pilot *t;
 
-         /* Must be in range. */
-         if (!pilot_inRangePilot( p, pilot_stack[i] ))
-            continue;
+   if (player == NULL)
+      return PLAYER_ID;
 
-         /* Check distance. */
-         td = vect_dist2(&pilot_stack[i]->solid->pos, &p->solid->pos);
-         if (!tp || (td < d)) {
-            d = td;
-            tp = pilot_stack[i]->id;
+   tp = PLAYER_ID;
+   d  = 0.;
+   for (f=0; f<pilot_nflist; f++) {
+      if ((f == FACTION_PLAYER) || !areEnemies( FACTION_PLAYER, f ))
+         continue;
+      for (t = pilot_flist[f]; t != NULL; t = t->fnext) {
+         if (!pilot_inRangePlayer( t ))
+            continue;
+         td = vect_dist2( &t->solid->pos, &player->solid->pos );
+         if ((tp == PLAYER_ID) || (td < d)) {
+            d  = td;
+            tp = t->id;
+         }
+      }
+   }
+   if (pilot_hostiles != NULL) {
+      n = array_size(pilot_hostiles);
+      for (f=0; f<n; f++) {
+         t = pilot_hostiles[f];
+         if ((t->faction == FACTION_PLAYER) || !pilot_inRangePlayer( t ))
+            continue;
+         td = vect_dist2( &t->solid->pos, &player->solid->pos );
+         if ((tp == PLAYER_ID) || (td < d)) {
+            d  = td;
+            tp = t->id;
          }
       }
    }
+
    return tp;
 }
 
@@ -264,32 +638,34 @@ unsigned int pilot_getNearestEnemy( const Pilot* p )
 unsigned int pilot_getNearestPilot( const Pilot* p )
 {
    unsigned int tp;
-   int i;
+   int i, n;
+   Pilot **nearby;
    double d, td;
 
    tp=PLAYER_ID;
    d=0;
-   for (i=0; i<pilot_nstack; i++) {
-      if (pilot_stack[i] == p)
+   n = pilot_getNearby( p, &nearby );
+   for (i=0; i<n; i++) {
+      if (nearby[i] == p)
          continue;
 
       /* Player doesn't select escorts. */
       if ((p->faction == FACTION_PLAYER) &&
-            (pilot_stack[i]->faction == FACTION_PLAYER))
+            (nearby[i]->faction == FACTION_PLAYER))
          continue;
 
       /* Shouldn't be disabled. */
-      if (pilot_isDisabled(pilot_stack[i]))
+      if (pilot_isDisabled(nearby[i]))
          continue;
 
       /* Must be in range. */
-      if (!pilot_inRangePilot( p, pilot_stack[i] ))
+      if (!pilot_inRangePilot( p, nearby[i] ))
          continue;
 
-      td = vect_dist2(&pilot_stack[i]->solid->pos, &player->solid->pos);       
+      td = vect_dist2(&nearby[i]->solid->pos, &player->solid->pos);
       if (((tp==PLAYER_ID) || (td < d))) {
          d = td;
-         tp = pilot_stack[i]->id;
+         tp = nearby[i]->id;
       }
    }
    return tp;
@@ -299,25 +675,26 @@ unsigned int pilot_getNearestPilot( const Pilot* p )
 /**
  * @brief Pulls a pilot out of the pilot_stack based on ID.
  *
- * It's a binary search ( O(logn) ) therefore it's pretty fast and can be
- *  abused all the time.  Maximum iterations is 32 on a platfom with 32 bit
- *  unsigned ints.
+ * It's an O(1) hash lookup therefore it's pretty fast and can be abused
+ *  all the time.
  *
  *    @param id ID of the pilot to get.
  *    @return The actual pilot who has matching ID or NULL if not found.
  */
 Pilot* pilot_get( const unsigned int id )
 {
-   int m;
+   Pilot *p;
+
+   COUNT_INC( COUNT_PILOT_GET );
 
    if (id==PLAYER_ID) return player; /* special case player */
-  
-   m = pilot_getStackPos(id);
 
-   if (m==-1)
-      return NULL;
-   else
-      return pilot_stack[m];
+   for (p = pilot_hash[ PILOT_HASH(id) ]; p != NULL; p = p->hnext)
+      if (p->id == id)
+         return p;
+
+   /* Not found. */
+   return NULL;
 }
 
 
@@ -423,6 +800,11 @@ void pilot_setHostile( Pilot* p )
 
       player_enemies++;
       pilot_setFlag(p, PILOT_HOSTILE);
+
+      /* Track him so the targeting cycle doesn't rescan the stack. */
+      if (pilot_hostiles == NULL)
+         pilot_hostiles = array_create( Pilot* );
+      array_grow( &pilot_hostiles ) = p;
    }
 }
 
@@ -476,6 +858,45 @@ int pilot_inRangePilot( const Pilot *p, const Pilot *target )
 }
 
 
+/**
+ * @brief Checks if a pilot is in sensor range of the player, cached.
+ *
+ * The answer can only change once the pair has moved more than the
+ *  slack between their distance and the sensor range at the time the
+ *  bit was computed, so the cached bit stays exact while everything the
+ *  radar, the targeting cycle and the comm checks per frame reads it
+ *  for free.
+ *
+ *    @param p Pilot to check.
+ *    @return 1 if the pilot is in sensor range of the player.
+ */
+int pilot_inRangePlayer( const Pilot *p )
+{
+   Pilot *t = (Pilot*) p;
+   double d;
+
+   if (cur_system->interference == 0.)
+      return 1;
+   if (player == NULL)
+      return 0;
+   if (p == player)
+      return 1;
+
+   /* Cached bit is still exact within the movement budget. */
+   if ((t->vis_gen == pilot_visGen) &&
+         (t->vis_moved + (pilot_visPlayerMoved - t->vis_pmoved) < t->vis_slack))
+      return t->vis_player;
+
+   d = vect_dist2( &t->solid->pos, &player->solid->pos );
+   t->vis_player = (d < sensor_curRange);
+   t->vis_slack  = FABS( sqrt(d) - sqrt(sensor_curRange) );
+   t->vis_moved  = 0.;
+   t->vis_pmoved = pilot_visPlayerMoved;
+   t->vis_gen    = pilot_visGen;
+   return t->vis_player;
+}
+
+
 /**
  * @brief Check to see if a planet is in sensor range of the pilot.
  *
@@ -534,7 +955,7 @@ void pilot_message( Pilot *p, unsigned int target, const char *msg, int ignore_i
       return;
 
    /* Must be in range. */
-   if (!ignore_int && !pilot_inRangePilot( player, p ))
+   if (!ignore_int && !pilot_inRangePlayer( p ))
       return;
 
    /* Only really affects player atm. */
@@ -557,7 +978,7 @@ void pilot_broadcast( Pilot *p, const char *msg, int ignore_int )
       return;
 
    /* Check if should ignore interference. */
-   if (!ignore_int && !pilot_inRangePilot( player, p ))
+   if (!ignore_int && !pilot_inRangePlayer( p ))
       return;
 
    player_message( "Broadcast %s> \"%s\"", p->name, msg );
@@ -640,6 +1061,7 @@ void pilot_rmHostile( Pilot* p )
       if (!pilot_isDisabled(p))
          player_enemies--;
       pilot_rmFlag(p, PILOT_HOSTILE);
+      pilot_hostilesRemove(p);
 
       /* Change music back to ambient if no more enemies. */
       if (player_enemies <= 0) {
@@ -1001,8 +1423,10 @@ static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w )
       WARN("Shooting unknown weapon type: %s", w->outfit->name);
    }
 
-   /* Reset timer. */
+   /* Reset timer and register the countdown. */
    w->timer += outfit_delay( w->outfit );
+   if (w->timer > 0.)
+      p->otimers++;
 
    return 0;
 }
@@ -1023,7 +1447,11 @@ void pilot_switchSecondary( Pilot* p, PilotOutfitSlot* w )
 
 
 /**
- * @brief Damages the pilot.
+ * @brief Damages the pilot immediately.
+ *
+ * Queues the damage and resolves it in one go; callers that can take
+ *  many hits per frame should use pilot_hitBatch() instead and let
+ *  pilots_flushHits() resolve them all at once.
  *
  *    @param p Pilot that is taking damage.
  *    @param w Solid that is hitting pilot.
@@ -1035,14 +1463,35 @@ void pilot_switchSecondary( Pilot* p, PilotOutfitSlot* w )
 double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
       const DamageType dtype, const double damage )
 {
-   int mod, h;
-   double damage_shield, damage_armour, knockback, dam_mod, dmg;
-   Pilot *pshooter;
+   double dmg;
 
-   /* Defaults. */
-   pshooter = NULL;
-   dam_mod  = 0.;
-   dmg      = 0.;
+   dmg = pilot_hitBatch( p, w, shooter, dtype, damage );
+   pilot_hitResolve( p );
+
+   return dmg;
+}
+
+
+/**
+ * @brief Accumulates damage on the pilot without resolving it.
+ *
+ * The damage is applied when pilot_hitResolve() runs, so a burst of
+ *  projectile impacts pays for the shield/armour resolution, disable
+ *  check, death handling and hooks only once per frame.
+ *
+ *    @param p Pilot that is taking damage.
+ *    @param w Solid that is hitting pilot.
+ *    @param shooter Attacker that shot the pilot.
+ *    @param dtype Type of damage.
+ *    @param damage Amount of damage.
+ *    @return The damage that will be done, exact if the batch is resolved
+ *            before more damage accumulates.
+ */
+double pilot_hitBatch( Pilot* p, const Solid* w, const unsigned int shooter,
+      const DamageType dtype, const double damage )
+{
+   double damage_shield, damage_armour, knockback, dmg;
+   double shield;
 
    /* calculate the damage */
    outfit_calcDamage( &damage_shield, &damage_armour, &knockback, dtype, damage );
@@ -1056,16 +1505,73 @@ double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
    /*
     * EMP don't do damage if pilot is disabled.
     */
-   if (pilot_isDisabled(p) && (dtype == DAMAGE_TYPE_EMP)) {
-      dmg        = 0.;
-      dam_mod    = 0.;
+   if (pilot_isDisabled(p) && (dtype == DAMAGE_TYPE_EMP))
+      dmg = 0.;
+   else {
+      /* Estimate the damage against what the pilot has left once the
+       * already queued damage lands. */
+      shield = p->shield - p->hit.shield;
+      if (shield < 0.)
+         shield = 0.;
+      if (shield - damage_shield > 0.)
+         dmg = damage_shield;
+      else if (shield > 0.)
+         dmg = shield + (1. - shield/damage_shield) * damage_armour;
+      else if (p->armour > 0.)
+         dmg = damage_armour;
+      else
+         dmg = 0.;
+
+      /* Queue the damage. */
+      p->hit.shield += damage_shield;
+      p->hit.armour += damage_armour;
    }
 
+   /* Queue the knockback, the damage modifier term is scaled when the
+    * batch resolves. */
+   if (w != NULL) {
+      p->hit.kx  += knockback * (w->vel.x * (w->mass/p->solid->mass/6.));
+      p->hit.ky  += knockback * (w->vel.y * (w->mass/p->solid->mass/6.));
+      p->hit.kdx += knockback * w->vel.x / 9.;
+      p->hit.kdy += knockback * w->vel.y / 9.;
+   }
+
+   /* Remember the shooter for hooks and combat rating. */
+   if (shooter != 0)
+      p->hit.shooter = shooter;
+   p->hit.pending = 1;
+
+   return dmg;
+}
+
+
+/**
+ * @brief Resolves the damage accumulated on a pilot.
+ *
+ *    @param p Pilot to resolve the queued damage of.
+ */
+void pilot_hitResolve( Pilot* p )
+{
+   int mod, h;
+   double damage_shield, damage_armour, dam_mod;
+   unsigned int shooter;
+   Pilot *pshooter;
+
+   /* Nothing queued. */
+   if (!p->hit.pending)
+      return;
+
+   /* Defaults. */
+   damage_shield = p->hit.shield;
+   damage_armour = p->hit.armour;
+   shooter  = p->hit.shooter;
+   pshooter = NULL;
+   dam_mod  = 0.;
+
    /*
     * Shields take entire blow.
     */
-   else if (p->shield-damage_shield > 0.) {
-      dmg        = damage_shield;
+   if (p->shield-damage_shield > 0.) {
       p->shield -= damage_shield;
       dam_mod    = damage_shield/p->shield_max;
    }
@@ -1073,7 +1579,6 @@ double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
     * Shields take part of the blow.
     */
    else if (p->shield > 0.) {
-      dmg        = p->shield + (1. - p->shield/damage_shield) * damage_armour;
       p->armour -= (1. - p->shield/damage_shield) * damage_armour;
       p->shield  = 0.;
       dam_mod    = (damage_shield+damage_armour) /
@@ -1083,7 +1588,6 @@ double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
     * Armour takes the entire blow.
     */
    else if (p->armour > 0.) {
-      dmg        = damage_armour;
       p->armour -= damage_armour;
    }
 
@@ -1143,43 +1647,95 @@ double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
    }
 
 
-   if (w != NULL)
-      /* knock back effect is dependent on both damage and mass of the weapon 
-       * should probably get turned into a partial conservative collision */
+   /* knock back effect is dependent on both damage and mass of the weapon
+    * should probably get turned into a partial conservative collision */
+   if ((p->hit.kx != 0.) || (p->hit.ky != 0.) ||
+         (p->hit.kdx != 0.) || (p->hit.kdy != 0.))
       vect_cadd( &p->solid->vel,
-            knockback * (w->vel.x * (dam_mod/9. + w->mass/p->solid->mass/6.)),
-            knockback * (w->vel.y * (dam_mod/9. + w->mass/p->solid->mass/6.)) );
+            p->hit.kx + p->hit.kdx * dam_mod,
+            p->hit.ky + p->hit.kdy * dam_mod );
 
-   return dmg;
+   /* Clear the batch. */
+   memset( &p->hit, 0, sizeof(PilotHit) );
 }
 
 
 /**
- * @brief Pilot is dead, now will slowly explode.
- *
- *    @param p Pilot that just died.
+ * @brief Resolves the damage batched on all pilots this frame.
  */
-void pilot_dead( Pilot* p )
+void pilots_flushHits (void)
 {
-   if (pilot_isFlag(p,PILOT_DEAD)) return; /* he's already dead */
-
-   /* basically just set timers */
-   if (p->id==PLAYER_ID)
-      player_dead();
-   p->timer[0] = 0.; /* no need for AI anymore */
-   p->ptimer = 1. + sqrt(10*p->armour_max*p->shield_max) / 1500.;
-   p->timer[1] = 0.; /* explosion timer */
+   int i;
 
-   /* flag cleanup - fixes some issues */
-   if (pilot_isFlag(p,PILOT_HYP_PREP))
-      pilot_rmFlag(p,PILOT_HYP_PREP);
-   if (pilot_isFlag(p,PILOT_HYP_BEGIN))
-      pilot_rmFlag(p,PILOT_HYP_BEGIN);
-   if (pilot_isFlag(p,PILOT_HYPERSPACE))
-      pilot_rmFlag(p,PILOT_HYPERSPACE);
+   for (i=0; i<pilot_nstack; i++)
+      pilot_hitResolve( pilot_stack[i] );
+}
 
-   /* PILOT R OFFICIALLY DEADZ0R */
-   pilot_setFlag(p,PILOT_DEAD);
+
+/**
+ * @brief Queues nebula volatility damage on every pilot in the system.
+ *
+ * One sweep over the pilot stack through the batched damage path, so the
+ *  environmental damage folds into the same pilots_flushHits() resolve
+ *  as the frame's weapon impacts - the disable/death checks and hooks
+ *  run once per pilot and only when its state actually changes.
+ *
+ *    @param volatility Nebula volatility of the system (0-1000).
+ *    @param dt Current delta tick.
+ */
+void pilots_volatilityDamage( const double volatility, const double dt )
+{
+   int i;
+   double dmg;
+   Pilot *p;
+
+   dmg = pow2(volatility) / 500. * dt;
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+      if (pilot_isFlag(p, PILOT_DEAD) || pilot_isFlag(p, PILOT_DELETE))
+         continue;
+      pilot_hitBatch( p, NULL, 0, DAMAGE_TYPE_RADIATION, dmg );
+   }
+}
+
+
+/**
+ * @brief Pilot is dead, now will slowly explode.
+ *
+ *    @param p Pilot that just died.
+ */
+void pilot_dead( Pilot* p )
+{
+   Pilot *parent;
+
+   if (pilot_isFlag(p,PILOT_DEAD)) return; /* he's already dead */
+
+   /* basically just set timers */
+   if (p->id==PLAYER_ID)
+      player_dead();
+   p->timer[0] = 0.; /* no need for AI anymore */
+   p->ptimer = 1. + sqrt(10*p->armour_max*p->shield_max) / 1500.;
+   p->timer[1] = 0.; /* explosion timer */
+
+   /* flag cleanup - fixes some issues */
+   if (pilot_isFlag(p,PILOT_HYP_PREP))
+      pilot_rmFlag(p,PILOT_HYP_PREP);
+   if (pilot_isFlag(p,PILOT_HYP_BEGIN))
+      pilot_rmFlag(p,PILOT_HYP_BEGIN);
+   if (pilot_isFlag(p,PILOT_HYPERSPACE))
+      pilot_rmFlag(p,PILOT_HYPERSPACE);
+
+   /* Drop out of the parent's escort list so orders don't walk dead ids.
+    * The player's list is kept since it doubles as the data used to
+    * respawn his escorts on jumping. */
+   if (pilot_isFlag(p,PILOT_ESCORT) && (p->parent != PLAYER_ID)) {
+      parent = pilot_get(p->parent);
+      if (parent != NULL)
+         escort_rmList( parent, p->id );
+   }
+
+   /* PILOT R OFFICIALLY DEADZ0R */
+   pilot_setFlag(p,PILOT_DEAD);
 
    /* run hook if pilot has a death hook */
    pilot_runHook( p, PILOT_HOOK_DEATH );
@@ -1259,25 +1815,8 @@ int pilot_dock( Pilot *p, Pilot *target, int deployed )
 
    /* Remove from pilot's escort list. */
    if (deployed) {
-      for (i=0; i<target->nescorts; i++) {
-         if ((target->escorts[i].type == ESCORT_TYPE_BAY) &&
-               (target->escorts[i].id == p->id))
-            break;
-      }
-      /* Not found as pilot's escorts. */
-      if (i >= target->nescorts)
+      if (escort_rmList( target, p->id ) != 0)
          return -1;
-      /* Free if last pilot. */
-      if (target->nescorts == 1) {
-         free(target->escorts);
-         target->escorts   = NULL;
-         target->nescorts  = 0;
-      }
-      else {
-         memmove( &target->escorts[i], &target->escorts[i+1],
-               sizeof(Escort_t) * (target->nescorts-i-1) );
-         target->nescorts--;
-      }
    }
 
    /* Destroy the pilot. */
@@ -1319,16 +1858,29 @@ int pilot_hasDeployed( Pilot *p )
 void pilot_explode( double x, double y, double radius,
       DamageType dtype, double damage, unsigned int parent )
 {
-   int i;
+   int i, n;
    double rx, ry;
    double dist, rad2;
+   double dmg;
    Pilot *p;
+   Pilot **pstack;
+   SpatialGrid *grid;
    Solid s; /* Only need to manipulate mass and vel. */
 
    rad2 = radius*radius;
 
-   for (i=0; i<pilot_nstack; i++) {
-      p = pilot_stack[i];
+   /* Only consider pilots near the blast, insertion radius covers the
+    * ship size slack.  Fall back to the full stack without a grid. */
+   grid = pilot_getGrid();
+   if (grid != NULL)
+      n = spatial_query( grid, (void***)&pstack, x, y, radius );
+   else {
+      pstack = pilot_stack;
+      n = pilot_nstack;
+   }
+
+   for (i=0; i<n; i++) {
+      p = pstack[i];
 
       /* Calculate a bit. */
       rx = p->solid->pos.x - x;
@@ -1342,19 +1894,19 @@ void pilot_explode( double x, double y, double radius,
       if (dist < rad2) {
 
          /* Adjust damage based on distance. */
-         damage *= 1. - sqrt(dist / rad2);
+         dmg = damage * (1. - sqrt(dist / rad2));
 
          /* Impact settings. */
-         s.mass =  pow2(damage) / 30.;
+         s.mass =  pow2(dmg) / 30.;
          s.vel.x = rx;
          s.vel.y = ry;
 
          /* Actual damage calculations. */
-         pilot_hit( p, &s, parent, dtype, damage );
+         pilot_hit( p, &s, parent, dtype, dmg );
 
          /* Shock wave from the explosion. */
          if (p->id == PILOT_PLAYER)
-            spfx_shake( pow2(damage) / pow2(100.) * SHAKE_MAX );
+            spfx_shake( pow2(dmg) / pow2(100.) * SHAKE_MAX );
       }
    }
 }
@@ -1368,47 +1920,56 @@ void pilot_explode( double x, double y, double radius,
  */
 void pilot_render( Pilot* p, const double dt )
 {
+   double x, y, z;
+   glColour *c;
    (void) dt;
 
+   /* Skip pilots the camera can't see. */
+   if (!gl_cameraInView( p->solid->pos.x, p->solid->pos.y,
+         p->ship->gfx_space->sw ))
+      return;
+
+   /* Interpolate between the last two simulated states. */
+   solid_getInterpPos( p->solid, &x, &y );
+
+   /* Far LOD - when zoomed out enough that the sprite is only a few
+    * pixels it becomes a faction-coloured point, skipping the texture
+    * bind and the direction lookup. */
+   gl_cameraZoomGet( &z );
+   if (p->ship->gfx_space->sw * z < PILOT_LOD_PIXELS) {
+      c = faction_colour( p->faction );
+      gl_batchPoint( x, y, (c != NULL) ? c : &cNeutral );
+      return;
+   }
+
    if (p->ship->gfx_engine != NULL)
-      gl_blitSpriteInterpolate( p->ship->gfx_space, p->ship->gfx_engine, 
-            1.-p->engine_glow, p->solid->pos.x, p->solid->pos.y,
+      gl_batchSpriteInterpolate( p->ship->gfx_space, p->ship->gfx_engine,
+            1.-p->engine_glow, x, y,
             p->tsx, p->tsy, NULL );
    else
-      gl_blitSprite( p->ship->gfx_space,
-            p->solid->pos.x, p->solid->pos.y,
+      gl_batchSprite( p->ship->gfx_space,
+            x, y,
             p->tsx, p->tsy, NULL );
 }
 
 
 /**
- * @brief Updates the pilot.
+ * @brief Runs the parts of the pilot update that can't run concurrently.
+ *
+ * Death handling, sounds, explosions, cargo jettison and boarding all
+ *  touch global state, so pilots_update() runs this pass serially before
+ *  sharding pilot_updatePhysics() across the job system.
  *
  *    @param pilot Pilot to update.
  *    @param dt Current delta tick.
  */
-void pilot_update( Pilot* pilot, const double dt )
+static void pilot_updateSerial( Pilot* pilot, const double dt )
 {
    int i;
    unsigned int l;
    Pilot *target;
    double a, px,py, vx,vy;
    char buf[16];
-   PilotOutfitSlot *o;
-
-   /*
-    * Update timers.
-    */
-   pilot->ptimer -= dt;
-   pilot->tcontrol -= dt;
-   for (i=0; i<MAX_AI_TIMERS; i++)
-      if (pilot->timer[i] > 0.)
-         pilot->timer[i] -= dt;
-   for (i=0; i<pilot->noutfits; i++) {
-      o = pilot->outfits[i];
-      if (o->timer > 0.)
-         o->timer -= dt;
-   }
 
    /* he's dead jim */
    if (pilot_isFlag(pilot,PILOT_DEAD)) {
@@ -1471,6 +2032,103 @@ void pilot_update( Pilot* pilot, const double dt )
    else if (pilot->armour <= 0.) /* PWNED */
       pilot_dead(pilot); /* start death stuff */
 
+   /* Disabled pilots just drift, nothing serial left to do. */
+   if (pilot_isDisabled(pilot))
+      return;
+
+   /* Pilot is board/refueling.  Hack to match speeds. */
+   if (pilot_isFlag(pilot, PILOT_REFUELBOARDING))
+      pilot_refuel(pilot, dt);
+
+   /* Pilot is boarding it's target.  Hack to match speeds. */
+   if (pilot_isFlag(pilot, PILOT_BOARDING)) {
+      target = pilot_get(pilot->target);
+      if (target==NULL)
+         pilot_rmFlag(pilot, PILOT_BOARDING);
+      else {
+         /* Match speeds. */
+         vectcpy( &pilot->solid->vel, &target->solid->vel );
+
+         /* See if boarding is finished. */
+         if (pilot->ptimer < 0.)
+            pilot_boardComplete(pilot);
+      }
+   }
+
+   /* Engine trail, the emitter only writes spawn events.  Runs in the
+    * serial pass since the trail ring isn't shard safe, and only for
+    * pilots the camera can see - trails are purely cosmetic. */
+   pilot->trail_timer -= dt;
+   if ((pilot->engine_glow > 0.) && (pilot->trail_timer <= 0.) &&
+         gl_cameraInView( pilot->solid->pos.x, pilot->solid->pos.y,
+            pilot->ship->gfx_space->sw )) {
+      static const glColour cTrail    = { .r=0.4, .g=0.7, .b=1.0, .a=1. };
+      static const glColour cTrailAfb = { .r=1.0, .g=0.6, .b=0.3, .a=1. };
+      double dx, dy, r;
+      int afb;
+
+      afb = pilot_isFlag(pilot, PILOT_AFTERBURNER);
+      dx  = cos(pilot->solid->dir);
+      dy  = sin(pilot->solid->dir);
+      r   = pilot->ship->gfx_space->sw / 3.;
+      spfx_trailAdd(
+            pilot->solid->pos.x - dx*r,
+            pilot->solid->pos.y - dy*r,
+            pilot->solid->vel.x*0.5 - dx*50. + (RNGF()*20.-10.),
+            pilot->solid->vel.y*0.5 - dy*50. + (RNGF()*20.-10.),
+            0.6, afb ? &cTrailAfb : &cTrail,
+            0.8 * pilot->engine_glow );
+      pilot->trail_timer = afb ? 0.015 : 0.03;
+   }
+}
+
+
+/**
+ * @brief Runs the physics/regen part of the pilot update.
+ *
+ * Only touches the pilot itself, so pilots_update() can run this pass
+ *  for independent pilots concurrently via njob_parallelFor().
+ *
+ *    @param pilot Pilot to update.
+ *    @param dt Current delta tick.
+ */
+static void pilot_updatePhysics( Pilot* pilot, const double dt )
+{
+   int i;
+   PilotOutfitSlot *o;
+
+   /* Getting deleted, nothing left to simulate. */
+   if (pilot_isFlag(pilot, PILOT_DELETE))
+      return;
+
+   /* Accumulate movement for the visibility cache - |vx|+|vy| bounds
+    * the real distance from above, so the cache only errs towards
+    * recomputing. */
+   if (cur_system->interference != 0.) {
+      pilot->vis_moved += (ABS(pilot->solid->vel.x) +
+            ABS(pilot->solid->vel.y)) * dt;
+      if (pilot == player)
+         pilot_visPlayerMoved = pilot->vis_moved;
+   }
+
+   /*
+    * Update timers.
+    */
+   pilot->ptimer -= dt;
+   pilot->tcontrol -= dt;
+   for (i=0; i<MAX_AI_TIMERS; i++)
+      if (pilot->timer[i] > 0.)
+         pilot->timer[i] -= dt;
+   if (pilot->otimers > 0) /* Skip outfit sweep when nothing is cooling down. */
+      for (i=0; i<pilot->noutfits; i++) {
+         o = pilot->outfits[i];
+         if (o->timer > 0.) {
+            o->timer -= dt;
+            if (o->timer <= 0.)
+               pilot->otimers--;
+         }
+      }
+
    /* purpose fallthrough to get the movement like disabled */
    if (pilot_isDisabled(pilot)) {
 
@@ -1482,7 +2140,11 @@ void pilot_update( Pilot* pilot, const double dt )
       pilot_setTurn( pilot, 0. );
 
       /* update the solid */
-      pilot->solid->update( pilot->solid, dt );
+      if (gl_cameraInView( pilot->solid->pos.x, pilot->solid->pos.y,
+            SOLID_FAR_MARGIN ))
+         pilot->solid->update( pilot->solid, dt );
+      else
+         solid_updateFar( pilot->solid, dt );
       gl_getSpriteFromDir( &pilot->tsx, &pilot->tsy,
             pilot->ship->gfx_space, pilot->solid->dir );
 
@@ -1536,26 +2198,6 @@ void pilot_update( Pilot* pilot, const double dt )
    if (pilot->energy > pilot->energy_max)
       pilot->energy = pilot->energy_max;
 
-   /* Pilot is board/refueling.  Hack to match speeds. */
-   if (pilot_isFlag(pilot, PILOT_REFUELBOARDING))
-      pilot_refuel(pilot, dt);
-
-   /* Pilot is boarding it's target.  Hack to match speeds. */
-   if (pilot_isFlag(pilot, PILOT_BOARDING)) {
-      target = pilot_get(pilot->target);
-      if (target==NULL)
-         pilot_rmFlag(pilot, PILOT_BOARDING);
-      else {
-         /* Match speeds. */
-         vectcpy( &pilot->solid->vel, &target->solid->vel );
-
-         /* See if boarding is finished. */
-         if (pilot->ptimer < 0.)
-            pilot_boardComplete(pilot);
-      }
-   }
-
-
    /* Set engine glow. */
    if (pilot->solid->force_x > 0) {
       /*pilot->engine_glow += pilot->thrust / pilot->speed * dt;*/
@@ -1569,8 +2211,12 @@ void pilot_update( Pilot* pilot, const double dt )
          pilot->engine_glow = 0.;
    }
 
-   /* update the solid */
-   pilot->solid->update( pilot->solid, dt );
+   /* update the solid; distant pilots use cheap integration */
+   if (gl_cameraInView( pilot->solid->pos.x, pilot->solid->pos.y,
+         SOLID_FAR_MARGIN ))
+      pilot->solid->update( pilot->solid, dt );
+   else
+      solid_updateFar( pilot->solid, dt );
    gl_getSpriteFromDir( &pilot->tsx, &pilot->tsy,  
          pilot->ship->gfx_space, pilot->solid->dir );
 
@@ -1593,6 +2239,22 @@ void pilot_update( Pilot* pilot, const double dt )
 }
 
 
+/**
+ * @brief Updates the pilot.
+ *
+ * Runs both passes back to back - pilots_update() uses the split passes
+ *  directly so the physics can shard across cores.
+ *
+ *    @param pilot Pilot to update.
+ *    @param dt Current delta tick.
+ */
+void pilot_update( Pilot* pilot, const double dt )
+{
+   pilot_updateSerial( pilot, dt );
+   pilot_updatePhysics( pilot, dt );
+}
+
+
 /**
  * @brief Handles pilot's hyperspace states.
  *
@@ -1774,6 +2436,65 @@ static void pilot_refuel( Pilot *p, double dt )
 }
 
 
+/**
+ * @brief Gives the pilot private copies of the shared slot arrays.
+ *
+ * Pilots spawn pointing at their ship's empty loadout template, which is
+ *  safe because slot state never changes while no outfit is equipped.
+ *  The first real outfit change lands here and copies the arrays.
+ *
+ *    @param pilot Pilot to fork.
+ *    @param s Slot pointer the caller is working with, possibly into the
+ *             shared arrays.
+ *    @return The slot translated into the pilot's private arrays.
+ */
+static PilotOutfitSlot* pilot_outfitsFork( Pilot* pilot, PilotOutfitSlot *s )
+{
+   int i, p;
+   PilotOutfitSlot *old_low, *old_medium, *old_high;
+
+   if (!pilot->outfit_shared)
+      return s;
+
+   old_low    = pilot->outfit_low;
+   old_medium = pilot->outfit_medium;
+   old_high   = pilot->outfit_high;
+
+   /* Private copies. */
+   pilot->outfit_low = malloc( sizeof(PilotOutfitSlot) * pilot->outfit_nlow );
+   memcpy( pilot->outfit_low, old_low,
+         sizeof(PilotOutfitSlot) * pilot->outfit_nlow );
+   pilot->outfit_medium = malloc( sizeof(PilotOutfitSlot) * pilot->outfit_nmedium );
+   memcpy( pilot->outfit_medium, old_medium,
+         sizeof(PilotOutfitSlot) * pilot->outfit_nmedium );
+   pilot->outfit_high = malloc( sizeof(PilotOutfitSlot) * pilot->outfit_nhigh );
+   memcpy( pilot->outfit_high, old_high,
+         sizeof(PilotOutfitSlot) * pilot->outfit_nhigh );
+
+   /* The pointer array pointed into the template. */
+   pilot->outfits = malloc( sizeof(PilotOutfitSlot*) * pilot->noutfits );
+   p = 0;
+   for (i=0; i<pilot->outfit_nlow; i++)
+      pilot->outfits[p++] = &pilot->outfit_low[i];
+   for (i=0; i<pilot->outfit_nmedium; i++)
+      pilot->outfits[p++] = &pilot->outfit_medium[i];
+   for (i=0; i<pilot->outfit_nhigh; i++)
+      pilot->outfits[p++] = &pilot->outfit_high[i];
+
+   /* Secondary and afterburner are NULL while shared since no slot has
+    * an outfit, so only the caller's slot needs translating. */
+   if ((s >= old_low) && (s < &old_low[pilot->outfit_nlow]))
+      s = &pilot->outfit_low[ s - old_low ];
+   else if ((s >= old_medium) && (s < &old_medium[pilot->outfit_nmedium]))
+      s = &pilot->outfit_medium[ s - old_medium ];
+   else if ((s >= old_high) && (s < &old_high[pilot->outfit_nhigh]))
+      s = &pilot->outfit_high[ s - old_high ];
+
+   pilot->outfit_shared = 0;
+   return s;
+}
+
+
 /**
  * @brief Adds an outfit to the pilot, ignoring CPU or other limits.
  *
@@ -1786,6 +2507,9 @@ static void pilot_refuel( Pilot *p, double dt )
  */
 int pilot_addOutfitRaw( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s )
 {
+   /* Equipping mutates slot state, stop sharing the template. */
+   s = pilot_outfitsFork( pilot, s );
+
    /* Set the outfit. */
    s->outfit   = outfit;
    s->quantity = 1; /* Sort of pointless, but hey. */
@@ -1866,6 +2590,9 @@ int pilot_addOutfit( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s )
 {
    int ret;
 
+   /* Fork up front so s stays valid across the raw add. */
+   s = pilot_outfitsFork( pilot, s );
+
    /* Test to see if outfit can be added. */
    ret = pilot_addOutfitTest( pilot, outfit, s, 1 );
    if (ret != 0)
@@ -1874,8 +2601,9 @@ int pilot_addOutfit( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s )
    /* Add outfit. */
    ret = pilot_addOutfitRaw( pilot, outfit, s );
 
-   /* recalculate the stats */
-   pilot_calcStats(pilot);
+   /* Apply the single slot's delta, full rebuild if it can't. */
+   if (pilot_calcStatsSlot( pilot, s, 1 ) != 0)
+      pilot_calcStats(pilot);
 
    return ret;
 }
@@ -1894,6 +2622,10 @@ int pilot_rmOutfitRaw( Pilot* pilot, PilotOutfitSlot *s )
 {
    int ret;
 
+   /* Shared arrays mean the loadout is still empty, nothing to remove. */
+   if (pilot->outfit_shared)
+      return 1;
+
    /* Remove the outfit. */
    ret         = (s->outfit==NULL);
    s->outfit   = NULL;
@@ -1918,7 +2650,7 @@ int pilot_rmOutfitRaw( Pilot* pilot, PilotOutfitSlot *s )
 int pilot_rmOutfit( Pilot* pilot, PilotOutfitSlot *s )
 {
    const char *str;
-   int ret;
+   int ret, full;
 
    str = pilot_canEquip( pilot, s, s->outfit, 0 );
    if (str != NULL) {
@@ -1927,10 +2659,14 @@ int pilot_rmOutfit( Pilot* pilot, PilotOutfitSlot *s )
       return -1;
    }
 
+   /* Apply the delta while the slot still holds its outfit. */
+   full = pilot_calcStatsSlot( pilot, s, 0 );
+
    ret = pilot_rmOutfitRaw( pilot, s );
 
-   /* recalculate the stats */
-   pilot_calcStats(pilot);
+   /* Full rebuild fallback, after the slot is actually empty. */
+   if (full != 0)
+      pilot_calcStats(pilot);
 
    return ret;
 }
@@ -2218,7 +2954,9 @@ int pilot_rmAmmo( Pilot* pilot, PilotOutfitSlot *s, int quantity )
 
 /**
  * @brief Gets all the outfits in nice text form.
- *    
+ *
+ * The string is frame memory and must not be freed or kept.
+ *
  *    @param pilot Pilot to get the oufits from.
  */
 char* pilot_getOutfits( Pilot* pilot )
@@ -2229,7 +2967,7 @@ char* pilot_getOutfits( Pilot* pilot )
 
    len = 1024;
 
-   buf = malloc(sizeof(char)*len);
+   buf = nalloc_frame(sizeof(char)*len);
    buf[0] = '\0';
    p = 0;
    for (i=1; i<pilot->noutfits; i++) {
@@ -2255,8 +2993,6 @@ void pilot_calcStats( Pilot* pilot )
 {
    int i;
    double q;
-   double wrange, wspeed;
-   int nweaps;
    Outfit* o;
    PilotOutfitSlot *slot;
    double ac, sc, ec, fc; /* temporary health coeficients to set */
@@ -2296,8 +3032,9 @@ void pilot_calcStats( Pilot* pilot )
    /*
     * now add outfit changes
     */
-   nweaps = 0;
-   wrange = wspeed = 0.;
+   pilot->weap_nprimary = 0;
+   pilot->weap_rangesum = 0.;
+   pilot->weap_speedsum = 0.;
    pilot->mass_outfit = 0.;
    for (i=0; i<pilot->noutfits; i++) {
       slot = pilot->outfits[i];
@@ -2349,9 +3086,9 @@ void pilot_calcStats( Pilot* pilot )
       }
       if ((outfit_isWeapon(o) || outfit_isTurret(o)) && /* Primary weapon */
             !outfit_isProp(o,OUTFIT_PROP_WEAP_SECONDARY)) {
-         nweaps++;
-         wrange += outfit_range(o);
-         wspeed += outfit_speed(o);
+         pilot->weap_nprimary++;
+         pilot->weap_rangesum += outfit_range(o);
+         pilot->weap_speedsum += outfit_speed(o);
       }
       /* Add ammo mass. */
       if (outfit_ammo(o) != NULL) {
@@ -2364,9 +3101,9 @@ void pilot_calcStats( Pilot* pilot )
    pilot->energy_tau = pilot->energy_max / pilot->energy_regen;
 
    /* Set weapon range and speed */
-   if (nweaps > 0) {
-      pilot->weap_range = wrange / (double)nweaps;
-      pilot->weap_speed = wspeed / (double)nweaps;
+   if (pilot->weap_nprimary > 0) {
+      pilot->weap_range = pilot->weap_rangesum / (double)pilot->weap_nprimary;
+      pilot->weap_speed = pilot->weap_speedsum / (double)pilot->weap_nprimary;
    }
    else {
       pilot->weap_range = 0.;
@@ -2387,6 +3124,113 @@ void pilot_calcStats( Pilot* pilot )
 }
 
 
+/**
+ * @brief Applies a single outfit slot's stat contribution incrementally.
+ *
+ * Avoids the full O(slots) pilot_calcStats() rebuild when only one slot
+ *  changed.  Outfits with non-linear contributions (jammers substitute the
+ *  best one, afterburner removal needs a rescan) can't be applied as a
+ *  delta and report failure so the caller can do the full rebuild.
+ *
+ *    @param pilot Pilot whose slot changed.
+ *    @param s Slot that is being added or removed, must still hold its outfit.
+ *    @param added Non-zero if the slot is being added, zero if removed.
+ *    @return 0 if the delta was applied, -1 if a full rebuild is needed.
+ */
+int pilot_calcStatsSlot( Pilot* pilot, PilotOutfitSlot *s, int added )
+{
+   double q, sign;
+   double ac, sc, ec, fc; /* temporary health coeficients to set */
+   Outfit *o;
+
+   o = s->outfit;
+   if (o == NULL)
+      return 0;
+
+   /* Non-linear contributions need the full rebuild. */
+   if (outfit_isJammer(o) || (!added && outfit_isAfterburner(o)))
+      return -1;
+
+   sign = (added) ? 1. : -1.;
+   q    = sign * (double) s->quantity;
+
+   /* Save health proportions. */
+   ac = pilot->armour / pilot->armour_max;
+   sc = pilot->shield / pilot->shield_max;
+   ec = pilot->energy / pilot->energy_max;
+   fc = pilot->fuel   / pilot->fuel_max;
+
+   /* Subtract CPU. */
+   pilot->cpu           -= outfit_cpu(o) * q;
+   if (outfit_cpu(o) < 0.)
+      pilot->cpu_max    -= outfit_cpu(o) * q;
+
+   /* Add mass. */
+   pilot->mass_outfit   += sign * o->mass;
+
+   if (outfit_isMod(o)) { /* Modification */
+      /* movement */
+      pilot->thrust        += o->u.mod.thrust * pilot->ship->mass * q;
+      pilot->thrust        += o->u.mod.thrust_rel * pilot->ship->thrust * q;
+      pilot->turn_base     += o->u.mod.turn * q;
+      pilot->turn_base     += o->u.mod.turn_rel * pilot->ship->turn * q;
+      pilot->speed         += o->u.mod.speed * q;
+      pilot->speed         += o->u.mod.speed_rel * pilot->ship->speed * q;
+      /* health */
+      pilot->armour_max    += o->u.mod.armour * q;
+      pilot->armour_regen  += o->u.mod.armour_regen * q;
+      pilot->shield_max    += o->u.mod.shield * q;
+      pilot->shield_regen  += o->u.mod.shield_regen * q;
+      pilot->energy_max    += o->u.mod.energy * q;
+      pilot->energy_regen  += o->u.mod.energy_regen * q;
+      /* fuel */
+      pilot->fuel_max      += o->u.mod.fuel * q;
+      /* misc */
+      pilot->cargo_free    += o->u.mod.cargo * q;
+      pilot->mass_outfit   += o->u.mod.mass_rel * pilot->ship->mass * q;
+   }
+   else if (outfit_isAfterburner(o)) /* Afterburner */
+      pilot->afterburner = s; /* Set afterburner */
+   if ((outfit_isWeapon(o) || outfit_isTurret(o)) && /* Primary weapon */
+         !outfit_isProp(o,OUTFIT_PROP_WEAP_SECONDARY)) {
+      pilot->weap_nprimary += (added) ? 1 : -1;
+      pilot->weap_rangesum += sign * outfit_range(o);
+      pilot->weap_speedsum += sign * outfit_speed(o);
+
+      if (pilot->weap_nprimary > 0) {
+         pilot->weap_range = pilot->weap_rangesum / (double)pilot->weap_nprimary;
+         pilot->weap_speed = pilot->weap_speedsum / (double)pilot->weap_nprimary;
+      }
+      else {
+         pilot->weap_range = 0.;
+         pilot->weap_speed = 0.;
+      }
+   }
+   /* Add ammo mass. */
+   if (outfit_ammo(o) != NULL) {
+      if (s->u.ammo.outfit != NULL)
+         pilot->mass_outfit += sign * s->u.ammo.quantity * s->u.ammo.outfit->mass;
+   }
+
+   /* Set final energy tau. */
+   pilot->energy_tau = pilot->energy_max / pilot->energy_regen;
+
+   /* Give the pilot his health proportion back */
+   pilot->armour = ac * pilot->armour_max;
+   pilot->shield = sc * pilot->shield_max;
+   pilot->energy = ec * pilot->energy_max;
+   pilot->fuel   = fc * pilot->fuel_max;
+
+   /* Calculate mass. */
+   pilot->solid->mass = pilot->ship->mass + pilot->mass_cargo + pilot->mass_outfit;
+
+   /* Modulate by mass. */
+   pilot_updateMass( pilot );
+
+   return 0;
+}
+
+
 /**
  * @brief Updates the pilot stats after mass change.
  */
@@ -2419,14 +3263,15 @@ int pilot_cargoFree( Pilot* p )
  */
 int pilot_moveCargo( Pilot* dest, Pilot* src )
 {
-   int i;
+   int i, q;
 
    /* Nothing to copy, success! */
    if (src->ncommodities == 0)
       return 0;
 
    /* Check if it fits. */
-   if (pilot_cargoUsed(src) > pilot_cargoFree(dest)) {
+   q = pilot_cargoUsed(src);
+   if (q > pilot_cargoFree(dest)) {
       WARN("Unable to copy cargo over from pilot '%s' to '%s'", src->name, dest->name );
       return -1;
    }
@@ -2436,11 +3281,22 @@ int pilot_moveCargo( Pilot* dest, Pilot* src )
    dest->ncommodities += src->ncommodities;
    dest->commodities   = realloc( dest->commodities,
          sizeof(PilotCommodity)*dest->ncommodities);
-  
+
    /* Copy over. */
-   memmove( &dest->commodities[0], &src->commodities[0],
+   memmove( &dest->commodities[i], &src->commodities[0],
          sizeof(PilotCommodity) * src->ncommodities);
 
+   /* Keep the running totals in step. */
+   dest->cargo_free    -= q;
+   dest->mass_cargo    += q;
+   dest->solid->mass   += q;
+   pilot_updateMass( dest );
+
+   src->cargo_free     += q;
+   src->mass_cargo     -= q;
+   src->solid->mass    -= q;
+   pilot_updateMass( src );
+
    /* Clean src. */
    if (src->commodities != NULL)
       free(src->commodities);
@@ -2531,29 +3387,34 @@ int pilot_addCargo( Pilot* pilot, Commodity* cargo, int quantity )
 /**
  * @brief Gets how much cargo ship has on board.
  *
+ * Running total maintained by the add/remove paths, no summing.
+ *
  *    @param pilot Pilot to get used cargo space of.
  *    @return The used cargo space by pilot.
  */
 int pilot_cargoUsed( Pilot* pilot )
 {
-   int i, q;
-
-   q = 0; 
-   for (i=0; i<pilot->ncommodities; i++)
-      q += pilot->commodities[i].quantity;
-
-   return q;
+   return (int)pilot->mass_cargo;
 }
 
 
 /**
  * @brief Calculates how much cargo ship has left and such.
  *
+ * Only place that recomputes the running totals from the commodity
+ *  array itself.
+ *
  *    @param pilot Pilot to calculate free cargo space of.
  */
 static void pilot_calcCargo( Pilot* pilot )
 {
-   pilot->mass_cargo  = pilot_cargoUsed( pilot );
+   int i, q;
+
+   q = 0;
+   for (i=0; i<pilot->ncommodities; i++)
+      q += pilot->commodities[i].quantity;
+
+   pilot->mass_cargo  = q;
    pilot->cargo_free  = pilot->ship->cap_cargo - pilot->mass_cargo;
    pilot->solid->mass = pilot->ship->mass + pilot->mass_cargo + pilot->mass_outfit;
    pilot_updateMass( pilot );
@@ -2752,12 +3613,15 @@ void pilot_addHook( Pilot *pilot, int type, unsigned int hook )
  *    @param vel Initial velocity.
  *    @param flags Used for tweaking the pilot.
  */
-void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const char *ai,
-      const double dir, const Vector2d* pos, const Vector2d* vel,
+/**
+ * @brief Base phase: identity, solid and behaviour of the pilot.
+ *
+ * See pilot_init() for the parameters, which just drops the AI name.
+ */
+static void pilot_initBase( Pilot* pilot, Ship* ship, const char* name,
+      int faction, const double dir, const Vector2d* pos, const Vector2d* vel,
       const unsigned int flags )
 {
-   int i, p;
-
    /* Clear memory. */
    memset(pilot, 0, sizeof(Pilot));
 
@@ -2768,13 +3632,16 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
 
    /* Basic information. */
    pilot->ship = ship;
-   pilot->name = strdup( (name==NULL) ? ship->name : name );
+   /* Fleet pilots reuse the same few names thousands of times over a
+    * session, the intern pool stores each once. */
+   pilot->name = (char*) str_intern( (name==NULL) ? ship->name : name );
 
    /* faction */
    pilot->faction = faction;
 
-   /* solid */
-   pilot->solid = solid_create(ship->mass, dir, pos, vel);
+   /* solid - embedded in the pilot to keep the update loop cache-friendly */
+   solid_init( &pilot->solid_data, ship->mass, dir, pos, vel );
+   pilot->solid = &pilot->solid_data;
 
    /* First pass to make sure requirements make sense. */
    pilot->armour = pilot->armour_max = 1.; /* hack to have full armour */
@@ -2783,51 +3650,6 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
    pilot->fuel   = pilot->fuel_max   = 1.; /* ditto fuel */
    pilot_calcStats(pilot);
 
-   /* Allocate outfit memory. */
-   /* Slot types. */
-   pilot->outfit_nlow    = ship->outfit_nlow;
-   pilot->outfit_low     = calloc( ship->outfit_nlow, sizeof(PilotOutfitSlot) );
-   pilot->outfit_nmedium = ship->outfit_nmedium;
-   pilot->outfit_medium  = calloc( ship->outfit_nmedium, sizeof(PilotOutfitSlot) );
-   pilot->outfit_nhigh   = ship->outfit_nhigh;
-   pilot->outfit_high    = calloc( ship->outfit_nhigh, sizeof(PilotOutfitSlot) );
-   /* Global. */
-   pilot->noutfits = pilot->outfit_nlow + pilot->outfit_nmedium + pilot->outfit_nhigh;
-   pilot->outfits  = calloc( pilot->noutfits, sizeof(PilotOutfitSlot*) );
-   /* First pass copy data. */
-   p = 0;
-   for (i=0; i<pilot->outfit_nlow; i++) {
-      pilot->outfit_low[i].slot = OUTFIT_SLOT_LOW;
-      pilot->outfits[p] = &pilot->outfit_low[i];
-      memcpy( &pilot->outfits[p]->mount, &ship->outfit_low[i].mount, sizeof(ShipMount) );
-      p++;
-   }
-   for (i=0; i<pilot->outfit_nmedium; i++) {
-      pilot->outfit_medium[i].slot = OUTFIT_SLOT_MEDIUM;
-      pilot->outfits[p] = &pilot->outfit_medium[i];
-      memcpy( &pilot->outfits[p]->mount, &ship->outfit_medium[i].mount, sizeof(ShipMount) );
-      p++;
-   }
-   for (i=0; i<pilot->outfit_nhigh; i++) {
-      pilot->outfit_high[i].slot = OUTFIT_SLOT_HIGH;
-      pilot->outfits[p] = &pilot->outfit_high[i];
-      memcpy( &pilot->outfits[p]->mount, &ship->outfit_high[i].mount, sizeof(ShipMount) );
-      p++;
-   }
-
-   /* cargo - must be set before calcStats */
-   pilot->cargo_free = pilot->ship->cap_cargo; /* should get redone with calcCargo */
-
-   /* set the pilot stats based on his ship and outfits */
-   pilot_calcStats(pilot);
-
-   /* Sanity check. */
-#ifdef DEBUGGING
-   const char *str = pilot_checkSanity( pilot );
-   if (str != NULL)
-      DEBUG( "Pilot '%s' failed sanity check: %s", pilot->name, str );
-#endif /* DEBUGGING */
-
    /* set flags and functions */
    if (flags & PILOT_PLAYER) {
       pilot->think  = player_think; /* players don't need to think! :P */
@@ -2863,13 +3685,170 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
    gl_getSpriteFromDir( &pilot->tsx, &pilot->tsy,
          pilot->ship->gfx_space, pilot->solid->dir );
 
+   /* No target until the AI picks one. */
+   pilot->target = pilot->id;
+}
+
+
+/**
+ * @brief Builds the ship's shared empty loadout template.
+ *
+ * Built once per ship on the first spawn; every pilot of the ship then
+ *  shares the arrays until its own loadout diverges.
+ *
+ *    @param ship Ship to build the template for.
+ */
+static void pilot_shipTemplate( Ship *ship )
+{
+   int i, p, n;
+   PilotOutfitSlot *low, *medium, *high;
+
+   low    = calloc( ship->outfit_nlow, sizeof(PilotOutfitSlot) );
+   medium = calloc( ship->outfit_nmedium, sizeof(PilotOutfitSlot) );
+   high   = calloc( ship->outfit_nhigh, sizeof(PilotOutfitSlot) );
+   n      = ship->outfit_nlow + ship->outfit_nmedium + ship->outfit_nhigh;
+   ship->tmpl_all = calloc( n, sizeof(PilotOutfitSlot*) );
+
+   p = 0;
+   for (i=0; i<ship->outfit_nlow; i++) {
+      low[i].slot = OUTFIT_SLOT_LOW;
+      memcpy( &low[i].mount, &ship->outfit_low[i].mount, sizeof(ShipMount) );
+      ship->tmpl_all[p++] = &low[i];
+   }
+   for (i=0; i<ship->outfit_nmedium; i++) {
+      medium[i].slot = OUTFIT_SLOT_MEDIUM;
+      memcpy( &medium[i].mount, &ship->outfit_medium[i].mount, sizeof(ShipMount) );
+      ship->tmpl_all[p++] = &medium[i];
+   }
+   for (i=0; i<ship->outfit_nhigh; i++) {
+      high[i].slot = OUTFIT_SLOT_HIGH;
+      memcpy( &high[i].mount, &ship->outfit_high[i].mount, sizeof(ShipMount) );
+      ship->tmpl_all[p++] = &high[i];
+   }
+
+   ship->tmpl_low    = low;
+   ship->tmpl_medium = medium;
+   ship->tmpl_high   = high;
+}
+
+
+/**
+ * @brief Equip phase: outfit slots, cargo and the final stats.
+ *
+ * The slot arrays are shared with the ship template and only copied when
+ *  an outfit is actually equipped or removed, see pilot_outfitsFork().
+ *
+ *    @param pilot Pilot to equip.
+ */
+static void pilot_initEquip( Pilot* pilot )
+{
+   Ship *ship;
+
+   ship = pilot->ship;
+
+   /* Share the ship's empty loadout. */
+   if (ship->tmpl_all == NULL)
+      pilot_shipTemplate( ship );
+   pilot->outfit_nlow    = ship->outfit_nlow;
+   pilot->outfit_low     = ship->tmpl_low;
+   pilot->outfit_nmedium = ship->outfit_nmedium;
+   pilot->outfit_medium  = ship->tmpl_medium;
+   pilot->outfit_nhigh   = ship->outfit_nhigh;
+   pilot->outfit_high    = ship->tmpl_high;
+   pilot->noutfits = pilot->outfit_nlow + pilot->outfit_nmedium + pilot->outfit_nhigh;
+   pilot->outfits  = ship->tmpl_all;
+   pilot->outfit_shared = 1;
+
+   /* The player's loadout code holds slot pointers across equips, give
+    * it private arrays straight away. */
+   if (pilot_isFlag(pilot, PILOT_PLAYER))
+      pilot_outfitsFork( pilot, NULL );
+
+   /* cargo - must be set before calcStats */
+   pilot->cargo_free = pilot->ship->cap_cargo; /* should get redone with calcCargo */
+
+   /* set the pilot stats based on his ship and outfits */
+   pilot_calcStats(pilot);
+
+   /* Sanity check. */
+#ifdef DEBUGGING
+   {
+      const char *str = pilot_checkSanity( pilot );
+      if (str != NULL)
+         DEBUG( "Pilot '%s' failed sanity check: %s", pilot->name, str );
+   }
+#endif /* DEBUGGING */
+}
+
+
+/**
+ * @brief Runs all the creation phases in one go.
+ *
+ * See pilot_initBase() for the shared parameters.
+ */
+void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const char *ai,
+      const double dir, const Vector2d* pos, const Vector2d* vel,
+      const unsigned int flags )
+{
+   pilot_initBase( pilot, ship, name, faction, dir, pos, vel, flags );
+   pilot_initEquip( pilot );
+
    /* AI */
-   pilot->target = pilot->id; /* Self = no target. */
    if (ai != NULL)
       ai_pinit( pilot, ai ); /* Must run before ai_create */
 }
 
 
+/**
+ * @brief Allocates a pilot from the slab pool.
+ *
+ *    @return The newly allocated pilot.
+ */
+static Pilot* pilot_alloc (void)
+{
+   int i;
+   PilotSlot *slab, *slot;
+
+   /* Grow by a slab when the free list runs out. */
+   if (pilot_slotfree == NULL) {
+      slab = malloc( PILOT_SLAB_SIZE * sizeof(PilotSlot) );
+      if (slab == NULL) {
+         WARN("Unable to allocate memory");
+         return NULL;
+      }
+      pilot_nslabs++;
+      pilot_slabs = realloc( pilot_slabs, pilot_nslabs * sizeof(PilotSlot*) );
+      pilot_slabs[ pilot_nslabs-1 ] = slab;
+      nmem_count( MEM_PILOT, PILOT_SLAB_SIZE * sizeof(PilotSlot), +1 );
+
+      /* Chain the slots in reverse so they pop in ascending address order. */
+      for (i=PILOT_SLAB_SIZE-1; i>=0; i--) {
+         slab[i].next   = pilot_slotfree;
+         pilot_slotfree = &slab[i];
+      }
+   }
+
+   slot = pilot_slotfree;
+   pilot_slotfree = slot->next;
+   return &slot->p;
+}
+
+
+/**
+ * @brief Returns a pilot to the slab pool.
+ *
+ *    @param p Pilot to return.
+ */
+static void pilot_dealloc( Pilot *p )
+{
+   PilotSlot *slot;
+
+   slot = (PilotSlot*) p;
+   slot->next = pilot_slotfree;
+   pilot_slotfree = slot;
+}
+
+
 /**
  * @brief Creates a new pilot
  *
@@ -2885,27 +3864,108 @@ unsigned int pilot_create( Ship* ship, const char* name, int faction, const char
 {
    Pilot *dyn;
 
-   /* Allocate pilot memory. */
-   dyn = malloc(sizeof(Pilot));
-   if (dyn == NULL) {
-      WARN("Unable to allocate memory");
+   dyn = pilot_createBegin( ship, name, faction, dir, pos, vel, flags );
+   if (dyn == NULL)
       return 0;
-   }
+   pilot_createEquip( dyn );
+   return pilot_createFinish( dyn, ai );
+}
+
+
+/**
+ * @brief First creation phase: allocation and base initialization.
+ *
+ * The pilot is not in the stack yet and must be completed with
+ *  pilot_createEquip() and pilot_createFinish(), or thrown away with
+ *  pilot_createAbort().  The spawn queue runs one phase per pilot per
+ *  frame so big fleet arrivals don't hitch.
+ *
+ * See pilot_init() for the parameters.
+ *
+ *    @return The partially created pilot or NULL on failure.
+ */
+Pilot* pilot_createBegin( Ship* ship, const char* name, int faction,
+      const double dir, const Vector2d* pos, const Vector2d* vel,
+      const unsigned int flags )
+{
+   Pilot *dyn;
+
+   dyn = pilot_alloc();
+   if (dyn == NULL)
+      return NULL;
+
+   pilot_initBase( dyn, ship, name, faction, dir, pos, vel, flags );
+   return dyn;
+}
+
+
+/**
+ * @brief Second creation phase: outfits, cargo and final stats.
+ *
+ *    @param pilot Pilot from pilot_createBegin().
+ */
+void pilot_createEquip( Pilot* pilot )
+{
+   pilot_initEquip( pilot );
+}
+
 
+/**
+ * @brief Last creation phase: AI state, then the pilot enters the stack.
+ *
+ *    @param pilot Pilot from pilot_createEquip().
+ *    @param ai AI profile to use, NULL for none.
+ *    @return The pilot's id.
+ */
+unsigned int pilot_createFinish( Pilot* pilot, const char *ai )
+{
    /* See if memory needs to grow */
    if (pilot_nstack+1 > pilot_mstack) { /* needs to grow */
       pilot_mstack += PILOT_CHUNK;
       pilot_stack = realloc( pilot_stack, pilot_mstack*sizeof(Pilot*) );
    }
 
-   /* Set the pilot in the stack -- must be there before initializing */
-   pilot_stack[pilot_nstack] = dyn;
+   /* Set the pilot in the stack -- must be there before the AI runs. */
+   pilot_stack[pilot_nstack] = pilot;
    pilot_nstack++; /* there's a new pilot */
-  
-   /* Initialize the pilot. */
-   pilot_init( dyn, ship, name, faction, ai, dir, pos, vel, flags );
 
-   return dyn->id;
+   /* AI */
+   if (ai != NULL)
+      ai_pinit( pilot, ai ); /* Must run before ai_create */
+
+   /* Hash stack pilots - the player is special cased in pilot_get(). */
+   if (pilot->id != PLAYER_ID)
+      pilot_hashAdd( pilot );
+
+   /* Everyone goes into his faction's membership list. */
+   pilot_factionAdd( pilot );
+
+   return pilot->id;
+}
+
+
+/**
+ * @brief Throws away a pilot that never finished creation.
+ *
+ * Frees only what the earlier phases allocated; the pilot was never in
+ *  the stack.
+ *
+ *    @param pilot Pilot to abort.
+ */
+void pilot_createAbort( Pilot* pilot )
+{
+   /* The name is interned, not owned. */
+   if (!pilot->outfit_shared) {
+      if (pilot->outfit_low != NULL)
+         free( pilot->outfit_low );
+      if (pilot->outfit_medium != NULL)
+         free( pilot->outfit_medium );
+      if (pilot->outfit_high != NULL)
+         free( pilot->outfit_high );
+      if (pilot->outfits != NULL)
+         free( pilot->outfits );
+   }
+   pilot_dealloc( pilot );
 }
 
 
@@ -2923,11 +3983,9 @@ Pilot* pilot_createEmpty( Ship* ship, const char* name,
       int faction, const char *ai, const unsigned int flags )
 {
    Pilot* dyn;
-   dyn = malloc(sizeof(Pilot));
-   if (dyn == NULL) {
-      WARN("Unable to allocate memory");
+   dyn = pilot_alloc();
+   if (dyn == NULL)
       return 0;
-   }
    pilot_init( dyn, ship, name, faction, ai, 0., NULL, NULL, flags | PILOT_EMPTY );
    return dyn;
 }
@@ -2942,43 +4000,48 @@ Pilot* pilot_createEmpty( Ship* ship, const char* name,
 Pilot* pilot_copy( Pilot* src )
 {
    int i, p;
-   Pilot *dest = malloc(sizeof(Pilot));
+   Pilot *dest = pilot_alloc();
 
    /* Copy data over, we'll have to reset all the pointers though. */
    memcpy( dest, src, sizeof(Pilot) );
 
-   /* Copy names. */
-   if (src->name)
-      dest->name = strdup(src->name);
+   /* Copy names - the interned name came over with the memcpy. */
    if (src->title)
       dest->title = strdup(src->title);
 
-   /* Copy solid. */
-   dest->solid = malloc(sizeof(Solid));
-   memcpy( dest->solid, src->solid, sizeof(Solid) );
-
-   /* Copy outfits. */
-   dest->noutfits = src->noutfits;
-   dest->outfits  = malloc( sizeof(PilotOutfitSlot*) * dest->noutfits );
-   dest->outfit_nlow = src->outfit_nlow;
-   dest->outfit_low  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nlow );
-   memcpy( dest->outfit_low, src->outfit_low,
-         sizeof(PilotOutfitSlot) * dest->outfit_nlow );
-   dest->outfit_nmedium = src->outfit_nmedium;
-   dest->outfit_medium  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
-   memcpy( dest->outfit_medium, src->outfit_medium,
-         sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
-   dest->outfit_nhigh = src->outfit_nhigh;
-   dest->outfit_high  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
-   memcpy( dest->outfit_high, src->outfit_high,
-         sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
-   p = 0;
-   for (i=0; i<dest->outfit_nlow; i++)
-      dest->outfits[p++] = &dest->outfit_low[i];
-   for (i=0; i<dest->outfit_nmedium; i++)
-      dest->outfits[p++] = &dest->outfit_medium[i];
-   for (i=0; i<dest->outfit_nhigh; i++)
-      dest->outfits[p++] = &dest->outfit_high[i];
+   /* Solid got copied with the rest of the struct, just point back at it. */
+   dest->solid = &dest->solid_data;
+
+   /* Copies aren't in the stack and thus in neither the hash nor the
+    * faction lists. */
+   dest->hnext = NULL;
+   dest->fnext = NULL;
+
+   /* Copy outfits.  If the source still shares the ship template the
+    * copy can too, the pointers came over with the memcpy. */
+   if (!src->outfit_shared) {
+      dest->noutfits = src->noutfits;
+      dest->outfits  = malloc( sizeof(PilotOutfitSlot*) * dest->noutfits );
+      dest->outfit_nlow = src->outfit_nlow;
+      dest->outfit_low  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nlow );
+      memcpy( dest->outfit_low, src->outfit_low,
+            sizeof(PilotOutfitSlot) * dest->outfit_nlow );
+      dest->outfit_nmedium = src->outfit_nmedium;
+      dest->outfit_medium  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
+      memcpy( dest->outfit_medium, src->outfit_medium,
+            sizeof(PilotOutfitSlot) * dest->outfit_nmedium );
+      dest->outfit_nhigh = src->outfit_nhigh;
+      dest->outfit_high  = malloc( sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
+      memcpy( dest->outfit_high, src->outfit_high,
+            sizeof(PilotOutfitSlot) * dest->outfit_nhigh );
+      p = 0;
+      for (i=0; i<dest->outfit_nlow; i++)
+         dest->outfits[p++] = &dest->outfit_low[i];
+      for (i=0; i<dest->outfit_nmedium; i++)
+         dest->outfits[p++] = &dest->outfit_medium[i];
+      for (i=0; i<dest->outfit_nhigh; i++)
+         dest->outfits[p++] = &dest->outfit_high[i];
+   }
    dest->secondary   = NULL;
    dest->afterburner = NULL;
 
@@ -3017,7 +4080,10 @@ Pilot* pilot_copy( Pilot* src )
 void pilot_free( Pilot* p )
 {
    int i;
-  
+
+   /* Weapons cache resolved pilot pointers. */
+   weapons_forgetPilot(p);
+
    /* Clear up pilot hooks. */
    if (p->hooks) {
       for (i=0; i<p->nhooks; i++)
@@ -3028,24 +4094,24 @@ void pilot_free( Pilot* p )
    /* If hostile, must remove counter. */
    pilot_rmHostile(p);
 
-   /* Free outfits. */
-   if (p->outfits != NULL)
-      free(p->outfits);
-   if (p->outfit_low != NULL)
-      free(p->outfit_low);
-   if (p->outfit_medium != NULL)
-      free(p->outfit_medium);
-   if (p->outfit_high != NULL)
-      free(p->outfit_high);
+   /* Free outfits - shared arrays belong to the ship template. */
+   if (!p->outfit_shared) {
+      if (p->outfits != NULL)
+         free(p->outfits);
+      if (p->outfit_low != NULL)
+         free(p->outfit_low);
+      if (p->outfit_medium != NULL)
+         free(p->outfit_medium);
+      if (p->outfit_high != NULL)
+         free(p->outfit_high);
+   }
 
    /* Remove commodities. */
    while (p->commodities != NULL)
       pilot_rmCargoRaw( p, p->commodities[0].commodity,
             p->commodities[0].quantity, 1 );
 
-   /* Free name and title. */
-   if (p->name != NULL)
-      free(p->name);
+   /* Free the title; the name is interned and not owned. */
    if (p->title != NULL)
       free(p->title);
 
@@ -3055,7 +4121,6 @@ void pilot_free( Pilot* p )
    /* Case if pilot is the player. */
    if (player==p)
       player = NULL;
-   solid_free(p->solid);
    if (p->mounted != NULL)
       free(p->mounted);
 
@@ -3069,7 +4134,7 @@ void pilot_free( Pilot* p )
    memset( p, 0, sizeof(Pilot) );
 #endif /* DEBUGGING */
 
-   free(p);
+   pilot_dealloc(p);
 }
 
 
@@ -3088,6 +4153,10 @@ void pilot_destroy(Pilot* p)
          break;
 
    /* pilot is eliminated */
+   pilot_hashRemove(p);
+   pilot_factionRemove(p);
+   if (pilot_isFlag(p, PILOT_HOSTILE))
+      pilot_hostilesRemove(p);
    pilot_free(p);
    pilot_nstack--;
 
@@ -3108,6 +4177,32 @@ void pilots_free (void)
    pilot_stack = NULL;
    player = NULL;
    pilot_nstack = 0;
+   memset( pilot_hash, 0, sizeof(pilot_hash) );
+
+   /* The faction lists held the dead pilots too. */
+   free(pilot_flist);
+   pilot_flist  = NULL;
+   pilot_nflist = 0;
+   if (pilot_hostiles != NULL) {
+      array_free(pilot_hostiles);
+      pilot_hostiles = NULL;
+   }
+
+   /* Free the proximity grid. */
+   if (pilot_grid != NULL) {
+      spatial_free( pilot_grid );
+      pilot_grid = NULL;
+   }
+
+   /* Release the allocation slabs themselves. */
+   for (i=0; i < pilot_nslabs; i++) {
+      free(pilot_slabs[i]);
+      nmem_count( MEM_PILOT, -(long)(PILOT_SLAB_SIZE * sizeof(PilotSlot)), -1 );
+   }
+   free(pilot_slabs);
+   pilot_slabs    = NULL;
+   pilot_nslabs   = 0;
+   pilot_slotfree = NULL;
 }
 
 
@@ -3126,9 +4221,24 @@ void pilots_clean (void)
       else /* rest get killed */
          pilot_free(pilot_stack[i]);
 
+   /* Hash only held the dead pilots - the player isn't in it. */
+   memset( pilot_hash, 0, sizeof(pilot_hash) );
+
+   /* The faction lists held everyone, the player gets re-added below. */
+   if (pilot_flist != NULL)
+      memset( pilot_flist, 0, pilot_nflist * sizeof(Pilot*) );
+   if (pilot_hostiles != NULL)
+      array_clear( pilot_hostiles );
+
+   /* Grid is full of freed pilots now. */
+   if (pilot_grid != NULL)
+      spatial_clear( pilot_grid );
+
    if (player != NULL) { /* set stack to 1 if pilot exists */
       pilot_nstack = 1;
       pilot_clearTimers( player ); /* Reset the player's timers. */
+      player->fnext = NULL;
+      pilot_factionAdd( player );
    }
 }
 
@@ -3140,6 +4250,7 @@ void pilots_cleanAll (void)
 {
    pilots_clean();
    if (player != NULL) {
+      pilot_factionRemove(player);
       pilot_free(player);
       player = NULL;
    }
@@ -3169,6 +4280,68 @@ void pilot_updateSensorRange (void)
 
    /* Speeds up calculations. */
    sensor_curRange = pow2(sensor_curRange);
+
+   /* Every cached visibility bit was computed for the old range. */
+   pilot_visGen++;
+}
+
+
+/**
+ * @brief Rebuilds the shared spatial grid from the pilot stack.
+ *
+ * The weapon collision broad phase and the proximity queries both use
+ *  this grid.
+ */
+void pilots_updateGrid (void)
+{
+   int i;
+   Pilot *p;
+
+   if (pilot_grid == NULL)
+      pilot_grid = spatial_create( PILOT_GRID_CELL );
+
+   spatial_clear( pilot_grid );
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+      spatial_insert( pilot_grid, p, p->solid->pos.x, p->solid->pos.y,
+            (p->ship->gfx_space->sw + p->ship->gfx_space->sh)/2. );
+   }
+}
+
+
+/**
+ * @brief Gets the shared pilot spatial grid.
+ *
+ *    @return The grid or NULL if it hasn't been built yet.
+ */
+SpatialGrid* pilot_getGrid (void)
+{
+   return pilot_grid;
+}
+
+
+/**
+ * @brief Job function running the physics pass over a slice of the stack.
+ *
+ * Player and scripted pilots are skipped - they already got their full
+ *  update in the serial pass.
+ *
+ *    @param start First stack position to update.
+ *    @param end One past the last stack position to update.
+ *    @param data Pointer to the delta tick.
+ */
+static void pilots_updatePhysics( int start, int end, void *data )
+{
+   int i;
+   Pilot *p;
+   double dt;
+
+   dt = *(double*)data;
+   for (i=start; i<end; i++) {
+      p = pilot_stack[i];
+      if (p->update == pilot_update)
+         pilot_updatePhysics( p, dt );
+   }
 }
 
 
@@ -3179,18 +4352,26 @@ void pilot_updateSensorRange (void)
  */
 void pilots_update( double dt )
 {
-   int i;
+   int i, destroyed;
    Pilot *p;
 
-   /* Now update all the pilots. */
+   /* Destroy deleted pilots first so the grid holds no stale pointers
+    * when the AI queries it below. */
+   destroyed = 0;
    for ( i=0; i < pilot_nstack; i++ ) {
-      p = pilot_stack[i];
-
-      /* Destroy pilot and go on. */
-      if (pilot_isFlag(p, PILOT_DELETE)) {
-         pilot_destroy(p);
-         continue;
+      if (pilot_isFlag(pilot_stack[i], PILOT_DELETE)) {
+         pilot_destroy(pilot_stack[i]);
+         destroyed = 1;
+         i--;
       }
+   }
+   if (destroyed)
+      pilots_updateGrid();
+
+   /* Serial pass: thinking, scripted updates and side effects that can't
+    * run concurrently (sound, explosions, destruction, boarding). */
+   for ( i=0; i < pilot_nstack; i++ ) {
+      p = pilot_stack[i];
 
       /* See if should think. */
       if (p->think && !pilot_isDisabled(p)) {
@@ -3209,10 +4390,23 @@ void pilots_update( double dt )
             p->think(p, dt);
       }
 
-      /* Just update the pilot. */
-      if (p->update) /* update */
+      /* No update hook at all. */
+      if (p->update == NULL)
+         continue;
+
+      /* Player and scripted pilots update fully serial. */
+      if (p->update != pilot_update) {
          p->update( p, dt );
+         continue;
+      }
+
+      /* Standard pilots run the serial part now, physics below. */
+      pilot_updateSerial( p, dt );
    }
+
+   /* Physics/regen pass - pilots don't touch each other here so it
+    * shards across cores. */
+   njob_parallelFor( pilots_updatePhysics, pilot_nstack, &dt );
 }
 
 
@@ -3224,11 +4418,15 @@ void pilots_update( double dt )
 void pilots_render( double dt )
 {
    int i;
+
+   /* Batch so each texture is bound and drawn only once. */
+   gl_batchBegin();
    for (i=0; i<pilot_nstack; i++) {
       if (player == pilot_stack[i]) continue; /* skip player */
       if (pilot_stack[i]->render != NULL) /* render */
          pilot_stack[i]->render(pilot_stack[i], dt);
    }
+   gl_batchEnd();
 }
 
 
@@ -3244,6 +4442,7 @@ void pilot_clearTimers( Pilot *pilot )
 
    pilot->ptimer = 0.;
    pilot->tcontrol = 0.;
+   pilot->tthink = 0.;
    for (i=0; i<MAX_AI_TIMERS; i++)
       pilot->timer[i] = 0.;
    for (i=0; i<pilot->noutfits; i++) {
@@ -3251,4 +4450,5 @@ void pilot_clearTimers( Pilot *pilot )
       if (o->timer > 0.)
          o->timer = 0.;
    }
+   pilot->otimers = 0;
 }
@@ -14,6 +14,7 @@
 #include "faction.h"
 #include "sound.h"
 #include "economy.h"
+#include "spatial.h"
 
 
 #define PLAYER_ID       1 /**< Player pilot ID. */
@@ -32,7 +33,14 @@
 #define HYPERSPACE_ENTER_MAX     HYPERSPACE_VEL*0.6 /**< Maxmimu entering distance. */
 #define HYPERSPACE_EXIT_MIN      1500. /**< Minimum distance to begin jumping. */
 
+/* C-side steering behaviors - set once by the AI Lua, flown every frame. */
+#define PILOT_STEER_NONE      0  /**< No steering behavior active. */
+#define PILOT_STEER_PURSUE    1  /**< Chase steer_target until within steer_dist. */
+#define PILOT_STEER_ORBIT     2  /**< Circle steer_target at radius steer_dist. */
+#define PILOT_STEER_EVADE     3  /**< Fly straight away from steer_target. */
+
 #define PILOT_SIZE_APROX      0.8   /**< aproximation for pilot size */
+#define PILOT_MAX_NEAREST     16    /**< Most enemies a batched query returns. */
 #define PILOT_DISABLED_ARMOR  0.3   /**< armour % that gets it disabled */
 #define PILOT_REFUEL_TIME     3. /**< Time to complete refueling. */
 #define PILOT_REFUEL_RATE     HYPERSPACE_FUEL/PILOT_REFUEL_TIME /**< Fuel per second. */
@@ -179,31 +187,38 @@ typedef struct Escort_s {
 /**
  * @brief The representation of an in-game pilot.
  */
+/**
+ * @brief Damage accumulated on a pilot over a frame, resolved in one go.
+ */
+typedef struct PilotHit_ {
+   double shield; /**< Accumulated shield-type damage. */
+   double armour; /**< Accumulated armour-type damage. */
+   double kx; /**< Accumulated X knockback, weapon mass term. */
+   double ky; /**< Accumulated Y knockback, weapon mass term. */
+   double kdx; /**< Accumulated X knockback, damage modifier term. */
+   double kdy; /**< Accumulated Y knockback, damage modifier term. */
+   unsigned int shooter; /**< Last shooter this frame. */
+   int pending; /**< Non-zero when there is damage to resolve. */
+} PilotHit;
+
+
 typedef struct Pilot_ {
 
    unsigned int id; /**< pilot's id, used for many functions */
-   char* name; /**< pilot's name (if unique) */
-   char* title; /**< title - usually indicating special properties - @todo use */
 
-   int faction; /**< Pilot's faction. */
-
-   /* Object caracteristics */
-   Ship* ship; /**< ship pilot is flying */
-   Solid* solid; /**< associated solid (physics) */
-   double mass_cargo; /**< Amount of cargo mass added. */
-   double mass_outfit; /**< Amount of outfit mass added. */
+   /*
+    * Hot per-frame data.
+    *
+    * Everything touched every tick by pilots_update() and the weapon
+    * collision pass lives together at the front of the struct, with the
+    * solid embedded instead of heap-allocated, so the update loop streams
+    * through memory instead of chasing pointers all over the heap.
+    */
+   Solid solid_data; /**< Pilot's solid, accessed through ->solid. */
+   Solid* solid; /**< associated solid (physics), points at solid_data */
    int tsx; /**< current sprite x position., calculated on update. */
    int tsy; /**< current sprite y position, calculated on update. */
-
-   /* Properties. */
-   double cpu; /**< Amount of CPU the pilot has left. */
-   double cpu_max; /**< Maximum amount of CPU the pilot has. */
-
-   /* Movement */
-   double thrust; /**< Pilot's thrust. */
-   double speed; /**< Pilot's speed. */
-   double turn; /**< Pilot's turn. */
-   double turn_base; /**< Pilot's base turn. */
+   uint32_t flags; /**< used for AI and others */
 
    /* Current health */
    double armour; /**< Current armour. */
@@ -214,6 +229,7 @@ typedef struct Pilot_ {
    double fuel_max; /**< Maximum fuel. */
    double armour_regen; /**< Armour regeneration rate (per second). */
    double shield_regen; /**< Shield regeneration rate (per second). */
+   PilotHit hit; /**< Damage accumulated this frame. */
 
    /* Energy is handled a bit differently. */
    double energy; /**< Current energy. */
@@ -221,6 +237,36 @@ typedef struct Pilot_ {
    double energy_regen; /**< Energy regeneration rate (per second). */
    double energy_tau; /**< Tau regeneration rate for energy. */
 
+   /* Timers. */
+   double ptimer; /**< generic timer for internal pilot use */
+   double tcontrol; /**< timer for control tick */
+   double tthink; /**< timer until the AI gets to think again */
+   double timer[MAX_AI_TIMERS]; /**< timers for AI */
+   int otimers; /**< Number of outfit slot timers currently counting down. */
+
+   /*
+    * Cold data, only touched on events or through the pointer.
+    */
+   char* name; /**< pilot's name (if unique) */
+   char* title; /**< title - usually indicating special properties - @todo use */
+
+   int faction; /**< Pilot's faction. */
+
+   /* Object caracteristics */
+   Ship* ship; /**< ship pilot is flying */
+   double mass_cargo; /**< Amount of cargo mass added. */
+   double mass_outfit; /**< Amount of outfit mass added. */
+
+   /* Properties. */
+   double cpu; /**< Amount of CPU the pilot has left. */
+   double cpu_max; /**< Maximum amount of CPU the pilot has. */
+
+   /* Movement */
+   double thrust; /**< Pilot's thrust. */
+   double speed; /**< Pilot's speed. */
+   double turn; /**< Pilot's turn. */
+   double turn_base; /**< Pilot's base turn. */
+
    /* Associated functions */
    void (*think)(struct Pilot_*, const double); /**< AI thinking for the pilot */
    void (*update)(struct Pilot_*, const double); /**< updates the pilot */
@@ -237,6 +283,7 @@ typedef struct Pilot_ {
    PilotOutfitSlot *outfit_medium; /**< The medium energy slots. */
    int outfit_nhigh; /**< Number of high energy slots. */
    PilotOutfitSlot *outfit_high; /**< The high energy slots. */
+   int outfit_shared; /**< Slot arrays are the ship's shared empty template. */
    /* For easier usage. */
    PilotOutfitSlot *secondary; /**< secondary weapon */
    PilotOutfitSlot *afterburner; /**< the afterburner */
@@ -254,15 +301,17 @@ typedef struct Pilot_ {
    /* Weapon properties */
    double weap_range; /**< Average range of primary weapons */
    double weap_speed; /**< Average speed of primary weapons */
+   int weap_nprimary; /**< Number of primary weapons, for incremental averages. */
+   double weap_rangesum; /**< Summed primary weapon range. */
+   double weap_speedsum; /**< Summed primary weapon speed. */
 
    /* Misc */
-   uint32_t flags; /**< used for AI and others */
-   double ptimer; /**< generic timer for internal pilot use */
    int lockons; /**< Stores how many seeking weapons are targetting pilot */
    int *mounted; /**< Number of mounted outfits on the mount. */
    double player_damage; /**< Accumulates damage done by player for hostileness.
                               In per one of max shield + armour. */
    double engine_glow; /**< Amount of engine glow to display. */
+   double trail_timer; /**< Timer until the next engine trail particle. */
 
    /* Hook attached to the pilot */
    PilotHook *hooks; /**< Pilot hooks. */
@@ -276,9 +325,21 @@ typedef struct Pilot_ {
    /* AI */
    unsigned int target; /**< AI target. */
    AI_Profile* ai; /**< ai personality profile */
-   double tcontrol; /**< timer for control tick */
-   double timer[MAX_AI_TIMERS]; /**< timers for AI */
    Task* task; /**< current action */
+   int steer; /**< Active C-side steering behavior, PILOT_STEER_*. */
+   unsigned int steer_target; /**< Pilot the steering behavior tracks. */
+   double steer_dist; /**< Range/radius parameter of the steering behavior. */
+
+   /* Internal. */
+   struct Pilot_ *hnext; /**< Next pilot in the same id hash bucket. */
+   struct Pilot_ *fnext; /**< Next pilot in the same faction list. */
+
+   /* Cached visibility vs the player, see pilot_inRangePlayer(). */
+   double vis_moved; /**< Distance bound moved since the bit was computed. */
+   double vis_pmoved; /**< Player movement accumulator at compute time. */
+   double vis_slack; /**< Movement budget before the bit can change. */
+   int vis_player; /**< Cached in-sensor-range-of-player bit. */
+   int vis_gen; /**< Sensor-range generation the bit was computed for. */
 } Pilot;
 
 
@@ -290,9 +351,11 @@ Pilot* pilot_get( const unsigned int id );
 unsigned int pilot_getNextID( const unsigned int id, int mode );
 unsigned int pilot_getPrevID( const unsigned int id, int mode );
 unsigned int pilot_getNearestEnemy( const Pilot* p );
+int pilot_getNearestEnemies( const Pilot* p, unsigned int *ids, int max );
 unsigned int pilot_getNearestHostile (void); /* only for the player */
 unsigned int pilot_getNearestPilot( const Pilot* p );
 int pilot_getJumps( const Pilot* p );
+SpatialGrid* pilot_getGrid (void);
 
 
 /*
@@ -303,6 +366,11 @@ void pilot_shootSecondary( Pilot* p );
 void pilot_shootStop( Pilot* p, const int secondary );
 double pilot_hit( Pilot* p, const Solid* w, const unsigned int shooter,
       const DamageType dtype, const double damage );
+double pilot_hitBatch( Pilot* p, const Solid* w, const unsigned int shooter,
+      const DamageType dtype, const double damage );
+void pilot_hitResolve( Pilot* p );
+void pilots_flushHits (void);
+void pilots_volatilityDamage( const double volatility, const double dt );
 void pilot_explode( double x, double y, double radius,
       DamageType dtype, double damage, unsigned int parent );
 double pilot_face( Pilot* p, const double dir );
@@ -328,6 +396,7 @@ int pilot_oquantity( Pilot* p, PilotOutfitSlot* w );
 /* Other. */
 char* pilot_getOutfits( Pilot* pilot );
 void pilot_calcStats( Pilot* pilot );
+int pilot_calcStatsSlot( Pilot* pilot, PilotOutfitSlot *s, int added );
 /* Special outfit stuff. */
 int pilot_getMount( const Pilot *p, const PilotOutfitSlot *w, Vector2d *v );
 void pilot_switchSecondary( Pilot* p, PilotOutfitSlot *w );
@@ -365,6 +434,13 @@ void pilot_init( Pilot* dest, Ship* ship, const char* name, int faction, const c
 unsigned int pilot_create( Ship* ship, const char* name, int faction, const char *ai,
       const double dir, const Vector2d* pos, const Vector2d* vel,
       const unsigned int flags );
+/* Phased creation, used by the spawn queue to spread the cost. */
+Pilot* pilot_createBegin( Ship* ship, const char* name, int faction,
+      const double dir, const Vector2d* pos, const Vector2d* vel,
+      const unsigned int flags );
+void pilot_createEquip( Pilot* pilot );
+unsigned int pilot_createFinish( Pilot* pilot, const char *ai );
+void pilot_createAbort( Pilot* pilot );
 Pilot* pilot_createEmpty( Ship* ship, const char* name,
       int faction, const char *ai, const unsigned int flags );
 Pilot* pilot_copy( Pilot* src );
@@ -392,6 +468,7 @@ void pilot_setTurn( Pilot *p, double turn );
  */
 void pilot_update( Pilot* pilot, const double dt );
 void pilots_update( double dt );
+void pilots_updateGrid (void);
 void pilots_render( double dt );
 void pilot_render( Pilot* pilot, const double dt );
 
@@ -410,6 +487,7 @@ void pilot_distress( Pilot *p, const char *msg, int ignore_int );
 void pilot_updateSensorRange (void);
 int pilot_inRange( const Pilot *p, double x, double y );
 int pilot_inRangePilot( const Pilot *p, const Pilot *target );
+int pilot_inRangePlayer( const Pilot *p );
 int pilot_inRangePlanet( const Pilot *p, int target );
 
 
@@ -418,6 +496,7 @@ int pilot_inRangePlanet( const Pilot *p, int target );
  */
 void pilot_setHostile( Pilot *p );
 void pilot_rmHostile( Pilot *p );
+void pilot_setFaction( Pilot *p, int faction );
 void pilot_setFriendly( Pilot *p );
 void pilot_rmFriendly( Pilot *p );
 int pilot_isHostile( const Pilot *p );
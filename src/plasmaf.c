@@ -14,30 +14,101 @@
 #include "log.h"
 #include "rng.h"
 #include "opengl.h"
+#include "nthread.h"
+
+
+#define PF_RNG_BATCH    512 /**< Randoms drawn from the stream per refill. */
+
+
+/**
+ * @brief Buffered draw from an independent random stream.
+ *
+ * The fractal is generated on a worker thread, so it cannot touch the
+ *  global generator - each generation owns one of these.
+ */
+typedef struct PfRng_ {
+   RngStream s; /**< The stream itself. */
+   float buf[PF_RNG_BATCH]; /**< Buffered randoms. */
+   int pos; /**< Next random to use. */
+} PfRng;
+
+/**
+ * @brief A generated fractal texture kept for reuse.
+ */
+typedef struct PfCache_ {
+   struct PfCache_ *next; /**< Next in linked list. */
+   int w; /**< Width it was generated at. */
+   int h; /**< Height it was generated at. */
+   double rug; /**< Rugosity it was generated with. */
+   uint32_t seed; /**< Seed it was generated with. */
+   glTexture *tex; /**< The texture, cache holds one reference. */
+} PfCache;
+static PfCache *pf_cache = NULL; /**< Generated fractals. */
+
+/**
+ * @brief A fractal being generated on a worker thread.
+ */
+typedef struct PfPrefetch_ {
+   struct PfPrefetch_ *next; /**< Next in linked list. */
+   int w; /**< Width to generate at. */
+   int h; /**< Height to generate at. */
+   double rug; /**< Rugosity to generate with. */
+   uint32_t seed; /**< Seed to generate with. */
+   SDL_Surface *surface; /**< Result, set by the worker. */
+   NTask *task; /**< Generator task handle. */
+} PfPrefetch;
+static PfPrefetch *pf_prefetch = NULL; /**< Generations in flight. */
 
 
 /*
  * prototypes
  */
-static double* pf_genFractalMap( const int w, const int h, double rug );
+static double pf_rngf( PfRng *r );
+static SDL_Surface* pf_genSurface( const int w, const int h, double rug,
+      uint32_t seed );
+static int pf_genThread( void *data );
+static glTexture* pf_cacheAdd( const int w, const int h, double rug,
+      uint32_t seed, SDL_Surface *sur );
+static double* pf_genFractalMap( const int w, const int h, double rug,
+      uint32_t seed );
 static void pf_divFractal( double *map, const double x, const double y,
       const double w, const double h, const double rw, const double rh,
-      double c1, double c2, double c3, double c4, double rug );
+      double c1, double c2, double c3, double c4, double rug, PfRng *rng );
 
 
-/*
- * actually generates the fractal and loads it up in an opengl texture
+/**
+ * @brief Gets the next random from the generation's stream.
  */
-glTexture* pf_genFractal( const int w, const int h, double rug )
+static double pf_rngf( PfRng *r )
+{
+   if (r->pos >= PF_RNG_BATCH) {
+      rng_streamBatch( &r->s, r->buf, PF_RNG_BATCH );
+      r->pos = 0;
+   }
+   return (double) r->buf[ r->pos++ ];
+}
+
+
+/**
+ * @brief Does the GL-free part of generating a fractal.
+ *
+ * Midpoint displacement plus the colour conversion, no OpenGL calls so
+ *  it is safe to run on a worker thread, see pf_prefetchFractal().
+ *
+ *    @return Surface ready for gl_loadImage() or NULL on error.
+ */
+static SDL_Surface* pf_genSurface( const int w, const int h, double rug,
+      uint32_t seed )
 {
    int i;
    double *map;
    SDL_Surface *sur;
    uint32_t *pix;
-   glTexture *tex;
    double c;
 
-   map = pf_genFractalMap( w, h, rug );
+   map = pf_genFractalMap( w, h, rug, seed );
+   if (map == NULL)
+      return NULL;
 
    sur = SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, RGBAMASK );
    pix = sur->pixels;
@@ -52,19 +123,191 @@ glTexture* pf_genFractal( const int w, const int h, double rug )
 
    free(map);
 
-   tex = gl_loadImage( sur, 0 );
+   return sur;
+}
+
 
-   return tex;
+/**
+ * @brief Worker side of a prefetch, just the generation.
+ */
+static int pf_genThread( void *data )
+{
+   PfPrefetch *p = (PfPrefetch*) data;
+   p->surface = pf_genSurface( p->w, p->h, p->rug, p->seed );
+   return 0;
+}
+
+
+/**
+ * @brief Uploads a generated surface and caches the texture.
+ */
+static glTexture* pf_cacheAdd( const int w, const int h, double rug,
+      uint32_t seed, SDL_Surface *sur )
+{
+   PfCache *c;
+
+   c = malloc(sizeof(PfCache));
+   c->w    = w;
+   c->h    = h;
+   c->rug  = rug;
+   c->seed = seed;
+   c->tex  = gl_loadImage( sur, 0 );
+   c->next = pf_cache;
+   pf_cache = c;
+
+   return gl_dupTexture( c->tex ); /* cache keeps the first reference */
+}
+
+
+/**
+ * @brief Starts generating a fractal on a worker thread ahead of use.
+ *
+ * The next pf_genFractalSeeded() with the same parameters picks the
+ *  result up and only does the GPU upload.  A no-op if the fractal is
+ *  already cached or being generated.
+ *
+ *    @param w Width of the fractal.
+ *    @param h Height of the fractal.
+ *    @param rug Rugosity of the fractal.
+ *    @param seed Seed to generate with.
+ */
+void pf_prefetchFractal( const int w, const int h, const double rug,
+      const uint32_t seed )
+{
+   PfCache *c;
+   PfPrefetch *p;
+
+   /* Already cached. */
+   for (c=pf_cache; c!=NULL; c=c->next)
+      if ((c->w==w) && (c->h==h) && (c->rug==rug) && (c->seed==seed))
+         return;
+
+   /* Already in flight. */
+   for (p=pf_prefetch; p!=NULL; p=p->next)
+      if ((p->w==w) && (p->h==h) && (p->rug==rug) && (p->seed==seed))
+         return;
+
+   p = malloc(sizeof(PfPrefetch));
+   p->w       = w;
+   p->h       = h;
+   p->rug     = rug;
+   p->seed    = seed;
+   p->surface = NULL;
+   p->next    = pf_prefetch;
+   pf_prefetch = p;
+   p->task    = ntask_start( pf_genThread, p );
+   if (p->task == NULL) { /* Generate inline when it's actually needed. */
+      pf_prefetch = p->next;
+      free(p);
+   }
+}
+
+
+/**
+ * @brief Gets a seeded fractal texture, generating it if needed.
+ *
+ * The same seed and parameters always return the same cached texture,
+ *  so repeat users only pay for the generation once.  Free with
+ *  gl_freeTexture() as usual, the cache holds its own reference.
+ *
+ *    @param w Width of the fractal.
+ *    @param h Height of the fractal.
+ *    @param rug Rugosity of the fractal.
+ *    @param seed Seed to generate with.
+ *    @return The fractal texture.
+ */
+glTexture* pf_genFractalSeeded( const int w, const int h, const double rug,
+      const uint32_t seed )
+{
+   PfCache *c;
+   PfPrefetch *p, *last;
+   SDL_Surface *sur;
+
+   /* Cached. */
+   for (c=pf_cache; c!=NULL; c=c->next)
+      if ((c->w==w) && (c->h==h) && (c->rug==rug) && (c->seed==seed))
+         return gl_dupTexture( c->tex );
+
+   /* Use the prefetched generation if there is one; the join is the
+    * synchronization point with the worker. */
+   sur  = NULL;
+   last = NULL;
+   for (p=pf_prefetch; p!=NULL; p=p->next) {
+      if ((p->w==w) && (p->h==h) && (p->rug==rug) && (p->seed==seed)) {
+         ntask_wait( p->task ); /* the join publishes the surface */
+         sur = p->surface;
+         if (last == NULL)
+            pf_prefetch = p->next;
+         else
+            last->next = p->next;
+         free(p);
+         break;
+      }
+      last = p;
+   }
+
+   if (sur == NULL)
+      sur = pf_genSurface( w, h, rug, seed );
+   if (sur == NULL)
+      return NULL;
+
+   return pf_cacheAdd( w, h, rug, seed, sur );
+}
+
+
+/*
+ * actually generates the fractal and loads it up in an opengl texture
+ */
+glTexture* pf_genFractal( const int w, const int h, double rug )
+{
+   SDL_Surface *sur;
+
+   /* Unseeded callers just want a random one, not cached. */
+   sur = pf_genSurface( w, h, rug, randint() );
+   if (sur == NULL)
+      return NULL;
+
+   return gl_loadImage( sur, 0 );
+}
+
+
+/**
+ * @brief Frees the fractal cache and drains pending generations.
+ */
+void pf_exit (void)
+{
+   PfCache *c, *cnext;
+   PfPrefetch *p, *pnext;
+
+   /* Drain generations nobody picked up. */
+   for (p=pf_prefetch; p!=NULL; p=pnext) {
+      pnext = p->next;
+      ntask_wait( p->task );
+      if (p->surface != NULL)
+         SDL_FreeSurface( p->surface );
+      free(p);
+   }
+   pf_prefetch = NULL;
+
+   /* Release the cached textures. */
+   for (c=pf_cache; c!=NULL; c=cnext) {
+      cnext = c->next;
+      gl_freeTexture( c->tex );
+      free(c);
+   }
+   pf_cache = NULL;
 }
 
 
 /*
  * generates a map representing the fractal
  */
-static double* pf_genFractalMap( const int w, const int h, double rug )
+static double* pf_genFractalMap( const int w, const int h, double rug,
+      uint32_t seed )
 {
    double *map; /* we'll use it to map out the fractal before saving */
    double cx, cy;
+   PfRng rng;
 
    map = malloc( w*h * sizeof(double) );
    if (map == NULL) {
@@ -72,23 +315,27 @@ static double* pf_genFractalMap( const int w, const int h, double rug )
       return NULL;
    }
 
+   /* own stream so generation can run off the main thread */
+   rng_streamInitSeed( &rng.s, seed );
+   rng.pos = PF_RNG_BATCH; /* force a fill on first draw */
+
    /* set up initial values */
    cx = (double)w/2.;
    cy = (double)h/2.;
 
    /* start by doing the four squares */
-   pf_divFractal( map, 0., 0., cx, cy, w, h, 0., 0., 1., 0., rug );
-   pf_divFractal( map, cx, 0., cx, cy, w, h, 0., 0., 0., 1., rug );
-   pf_divFractal( map, cx, cy, cx, cy, w, h, 1., 0., 0., 0., rug );
-   pf_divFractal( map, 0., cy, cx, cy, w, h, 0., 1., 0., 0., rug );
+   pf_divFractal( map, 0., 0., cx, cy, w, h, 0., 0., 1., 0., rug, &rng );
+   pf_divFractal( map, cx, 0., cx, cy, w, h, 0., 0., 0., 1., rug, &rng );
+   pf_divFractal( map, cx, cy, cx, cy, w, h, 1., 0., 0., 0., rug, &rng );
+   pf_divFractal( map, 0., cy, cx, cy, w, h, 0., 1., 0., 0., rug, &rng );
 
    return map;
 }
 
 
 static void pf_divFractal( double *map, const double x, const double y,
-      const double w, const double h, const double rw, const double rh, 
-      double c1, double c2, double c3, double c4, double rug )
+      const double w, const double h, const double rw, const double rh,
+      double c1, double c2, double c3, double c4, double rug, PfRng *rng )
 {
    double nw, nh; /* new dimensions */
    double m, e1,e2,e3,e4; /* middle and edges */
@@ -107,20 +354,18 @@ static void pf_divFractal( double *map, const double x, const double y,
       e4 = (c4 + c1)/2.;
 
       /* now change the middle colour */
-      m += rug*(RNGF()-0.5) * ((nw+nh)/(rw+rh) * 3.);
+      m += rug*(pf_rngf(rng)-0.5) * ((nw+nh)/(rw+rh) * 3.);
       if (m < 0.) m = 0.;
       else if (m > 1.) m = 1.;
 
       /* recursivation */
-      pf_divFractal( map, x,    y,    nw, nh, rw, rh, c1, e1, m,  e4, rug );
-      pf_divFractal( map, x+nw, y,    nw, nh, rw, rh, e1, c2, e2, m,  rug );
-      pf_divFractal( map, x+nw, y+nh, nw, nh, rw, rh, m,  e2, c3, e3, rug );
-      pf_divFractal( map, x,    y+nh, nw, nh, rw, rh, e4, m,  e3, c4, rug );
+      pf_divFractal( map, x,    y,    nw, nh, rw, rh, c1, e1, m,  e4, rug, rng );
+      pf_divFractal( map, x+nw, y,    nw, nh, rw, rh, e1, c2, e2, m,  rug, rng );
+      pf_divFractal( map, x+nw, y+nh, nw, nh, rw, rh, m,  e2, c3, e3, rug, rng );
+      pf_divFractal( map, x,    y+nh, nw, nh, rw, rh, e4, m,  e3, c4, rug, rng );
    }
    else /* actually write the pixel */
       map[(int)y*(int)rw + (int)x] = (c1 + c2 + c3 + c4)/4.;
 }
 
 
-
-
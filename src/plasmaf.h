@@ -7,10 +7,17 @@
 #  define PLASMAF_H
 
 
+#include <stdint.h>
+
 #include "opengl.h"
 
 
 glTexture* pf_genFractal( const int w, const int h, const double rug );
+glTexture* pf_genFractalSeeded( const int w, const int h, const double rug,
+      const uint32_t seed );
+void pf_prefetchFractal( const int w, const int h, const double rug,
+      const uint32_t seed );
+void pf_exit (void);
 
 
 #endif /* PLASMAF_H */
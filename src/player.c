@@ -58,6 +58,8 @@
 #define ZOOM_OUT_MAX             conf.zoom_min /**< Maximum zoom out. */
 #define ZOOM_IN_MAX              conf.zoom_max /**< Maximum zoom in. */
 
+#define AUTONAV_SPEEDUP          4. /**< Time compression while autonaving clear of hostiles. */
+
 
 /*
  * player stuff
@@ -307,7 +309,7 @@ static int player_newMake (void)
       return -1;
 
    /* Load the XML file. */
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (!xml_isNode(node,XML_START_ID)) {
@@ -484,7 +486,7 @@ static void player_newShipMake( char* name )
       ship->loc = strdup( land_planet->name );;
       player_nstack++;
    }
-   gl_cameraBind( &player->solid->pos ); /* set opengl camera */
+   gl_cameraBind( player->solid ); /* set opengl camera */
 
    /* money. */
    player->credits = player_credits;
@@ -532,7 +534,7 @@ void player_swapShip( char* shipname )
          /* Copy position back. */
          vectcpy( &player->solid->pos, &v );
 
-         gl_cameraBind( &player->solid->pos ); /* don't forget the camera */
+         gl_cameraBind( player->solid ); /* don't forget the camera */
          return;
       }
    }
@@ -951,6 +953,17 @@ void player_think( Pilot* pplayer, const double dt )
             player_accel( 1. );
       }
 
+      /* Compress time while clear, drop back the moment a hostile shows
+       * up.  The abort paths above reset the speed themselves. */
+      if (player_isFlag(PLAYER_AUTONAV)) {
+         if (pilot_getNearestHostile() != PLAYER_ID) {
+            if (dt_mod != 1.)
+               pause_setSpeed(1.);
+         }
+         else if (dt_mod != AUTONAV_SPEEDUP)
+            pause_setSpeed(AUTONAV_SPEEDUP);
+      }
+
       /* Disable turning. */
       facing = 1;
    }
@@ -1278,6 +1291,10 @@ void player_targetPlanet (void)
       /* In range, target planet. */
       if (pilot_inRangePlanet( player, planet_target )) {
          player_playSound(snd_nav, 1);
+         /* Start preparing the landing assets in the background. */
+         if (planet_hasService( cur_system->planets[planet_target],
+               PLANET_SERVICE_LAND ))
+            land_prefetch( cur_system->planets[planet_target] );
          return;
       }
 
@@ -1378,6 +1395,9 @@ void player_land (void)
       /* no landable planet */
       if (planet_target < 0) return;
 
+      /* Start preparing the landing assets in the background. */
+      land_prefetch( cur_system->planets[planet_target] );
+
       player_land(); /* rerun land protocol */
    }
 }
@@ -1442,6 +1462,8 @@ void player_jump (void)
       /* Stop possible shooting. */
       pilot_shootStop( player, 0 );
       pilot_shootStop( player, 1 );
+      /* Start decoding the destination's graphics during the wind-up. */
+      space_prefetch( system_getIndex( cur_system->jumps[hyperspace_target] ) );
    }
 }
 
@@ -1482,6 +1504,8 @@ void player_brokeHyperspace (void)
       if (hyperspace_target == -1) {
          player_message( "Autonav arrived at destination.");
          player_rmFlag(PLAYER_AUTONAV);
+         if (dt_mod != 1.)
+            pause_setSpeed(1.);
       }
       else {
          player_message( "Autonav continuing until destination (%d jump%s left).",
@@ -1607,7 +1631,7 @@ void player_targetHostile (void)
          continue;
  
       /* Must be in range. */
-      if (!pilot_inRangePilot( player, pilot_stack[i] ))
+      if (!pilot_inRangePlayer( pilot_stack[i] ))
          continue;
 
       /* Normal unbribed check. */
@@ -2656,7 +2680,7 @@ static int player_parse( xmlNodePtr parent )
    player_warp( pnt->pos.x + RNG(-sw/2,sw/2),
          pnt->pos.y + RNG(-sh/2,sh/2) );
    player->solid->dir = RNG(0,359) * M_PI/180.;
-   gl_cameraBind(&player->solid->pos);
+   gl_cameraBind( player->solid );
 
    /* initialize the system */
    music_choose("takeoff");
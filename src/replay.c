@@ -0,0 +1,316 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file replay.c
+ *
+ * @brief Deterministic session recording and playback.
+ *
+ * Records the RNG seed, the per-frame dt and all the input events to a
+ *  compact binary log so a session can be re-run as a bit-identical
+ *  workload - mainly to reproduce and bisect performance regressions.
+ *
+ * During playback real input is suppressed at the event loop call sites
+ *  and the recorded events are injected through input_handle() just
+ *  before the frame's dt is substituted, preserving the original
+ *  ordering.  The format dumps native-endian values, so logs are only
+ *  meant to be read on the machine that wrote them.
+ */
+
+#include "replay.h"
+
+#include "naev.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "conf.h"
+#include "rng.h"
+#include "input.h"
+
+
+#define REPLAY_MAGIC       "NREPLAY1" /**< File magic, 8 bytes. */
+#define REPLAY_MAX_EVENTS  64 /**< Maximum recorded events per frame. */
+
+
+/**
+ * @struct ReplayEvent
+ *
+ * @brief Serialized form of the input events we care about.
+ */
+typedef struct ReplayEvent_ {
+   uint8_t type; /**< SDL event type. */
+   int32_t d1;   /**< Keysym / axis / button. */
+   int32_t d2;   /**< Modifiers / value / x. */
+   int32_t d3;   /**< Unicode / state / y. */
+} ReplayEvent;
+
+
+static int replay_state    = REPLAY_OFF; /**< Current replay state. */
+static FILE *replay_file   = NULL; /**< Log being written or read. */
+static SDL_Event replay_pending[REPLAY_MAX_EVENTS]; /**< Events of the frame. */
+static int replay_npending = 0; /**< Number of pending events. */
+
+
+/*
+ * Prototypes.
+ */
+static void replay_writeFrame( double dt );
+static void replay_readFrame( double *dt );
+static void replay_stop (void);
+
+
+/**
+ * @brief Initializes recording or playback based on the configuration.
+ *
+ * Must run after rng_init() and before anything consumes random numbers,
+ *  since both modes reseed the generator.
+ */
+void replay_init (void)
+{
+   char magic[8];
+   uint32_t seed;
+
+   if (conf.record != NULL) {
+      replay_file = fopen( conf.record, "wb" );
+      if (replay_file == NULL) {
+         WARN("Unable to open '%s' for writing!", conf.record);
+         return;
+      }
+      seed = (uint32_t)time(NULL) ^ SDL_GetTicks();
+      rng_initSeed( seed );
+      fwrite( REPLAY_MAGIC, 1, 8, replay_file );
+      fwrite( &seed, sizeof(uint32_t), 1, replay_file );
+      replay_state = REPLAY_RECORD;
+      LOG("Recording replay to '%s' (seed %u)", conf.record, seed);
+   }
+   else if (conf.replay != NULL) {
+      replay_file = fopen( conf.replay, "rb" );
+      if (replay_file == NULL) {
+         WARN("Unable to open '%s' for reading!", conf.replay);
+         return;
+      }
+      if ((fread( magic, 1, 8, replay_file ) != 8) ||
+            (memcmp( magic, REPLAY_MAGIC, 8 ) != 0) ||
+            (fread( &seed, sizeof(uint32_t), 1, replay_file ) != 1)) {
+         WARN("'%s' is not a replay log!", conf.replay);
+         fclose(replay_file);
+         replay_file = NULL;
+         return;
+      }
+      rng_initSeed( seed );
+      replay_state = REPLAY_PLAYBACK;
+      LOG("Playing back replay '%s' (seed %u)", conf.replay, seed);
+   }
+}
+
+
+/**
+ * @brief Gets the current replay state.
+ *
+ *    @return REPLAY_OFF, REPLAY_RECORD or REPLAY_PLAYBACK.
+ */
+int replay_mode (void)
+{
+   return replay_state;
+}
+
+
+/**
+ * @brief Queues an input event for the current frame's record.
+ *
+ * Called from input_handle() so both the main loop and the secondary
+ *  dialogue loops are covered.
+ *
+ *    @param event Event to record.
+ */
+void replay_event( SDL_Event *event )
+{
+   if (replay_state != REPLAY_RECORD)
+      return;
+
+   /* Only the events the game actually consumes. */
+   switch (event->type) {
+      case SDL_KEYDOWN:
+      case SDL_KEYUP:
+      case SDL_MOUSEMOTION:
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP:
+      case SDL_JOYAXISMOTION:
+      case SDL_JOYBUTTONDOWN:
+      case SDL_JOYBUTTONUP:
+         break;
+      default:
+         return;
+   }
+
+   if (replay_npending >= REPLAY_MAX_EVENTS) {
+      WARN("Too many input events in one frame, dropping.");
+      return;
+   }
+   replay_pending[ replay_npending++ ] = *event;
+}
+
+
+/**
+ * @brief Writes the frame's dt and pending events to the log.
+ *
+ *    @param dt Frame dt in seconds.
+ */
+static void replay_writeFrame( double dt )
+{
+   int i;
+   uint8_t n;
+   SDL_Event *e;
+   ReplayEvent rev;
+
+   fwrite( &dt, sizeof(double), 1, replay_file );
+   n = (uint8_t) replay_npending;
+   fwrite( &n, sizeof(uint8_t), 1, replay_file );
+
+   for (i=0; i<replay_npending; i++) {
+      e = &replay_pending[i];
+      memset( &rev, 0, sizeof(ReplayEvent) );
+      rev.type = e->type;
+      switch (e->type) {
+         case SDL_KEYDOWN:
+         case SDL_KEYUP:
+            rev.d1 = e->key.keysym.sym;
+            rev.d2 = e->key.keysym.mod;
+            rev.d3 = e->key.keysym.unicode; /* Toolkit needs it. */
+            break;
+         case SDL_MOUSEMOTION:
+            rev.d1 = e->motion.x;
+            rev.d2 = e->motion.y;
+            rev.d3 = e->motion.state;
+            break;
+         case SDL_MOUSEBUTTONDOWN:
+         case SDL_MOUSEBUTTONUP:
+            rev.d1 = e->button.button;
+            rev.d2 = e->button.x;
+            rev.d3 = e->button.y;
+            break;
+         case SDL_JOYAXISMOTION:
+            rev.d1 = e->jaxis.axis;
+            rev.d2 = e->jaxis.value;
+            break;
+         case SDL_JOYBUTTONDOWN:
+         case SDL_JOYBUTTONUP:
+            rev.d1 = e->jbutton.button;
+            break;
+      }
+      fwrite( &rev, sizeof(ReplayEvent), 1, replay_file );
+   }
+   replay_npending = 0;
+}
+
+
+/**
+ * @brief Injects the next frame's events and substitutes its dt.
+ *
+ * Playback stops cleanly when the log runs out.
+ *
+ *    @param[out] dt Overwritten with the recorded frame dt.
+ */
+static void replay_readFrame( double *dt )
+{
+   int i;
+   uint8_t n;
+   double rdt;
+   SDL_Event ev;
+   ReplayEvent rev;
+
+   if (fread( &rdt, sizeof(double), 1, replay_file ) != 1) {
+      LOG("Replay finished.");
+      replay_stop();
+      return;
+   }
+   if (fread( &n, sizeof(uint8_t), 1, replay_file ) != 1) {
+      WARN("Replay log truncated!");
+      replay_stop();
+      return;
+   }
+
+   for (i=0; i<n; i++) {
+      if (fread( &rev, sizeof(ReplayEvent), 1, replay_file ) != 1) {
+         WARN("Replay log truncated!");
+         replay_stop();
+         return;
+      }
+      memset( &ev, 0, sizeof(SDL_Event) );
+      ev.type = rev.type;
+      switch (rev.type) {
+         case SDL_KEYDOWN:
+         case SDL_KEYUP:
+            ev.key.state = (rev.type==SDL_KEYDOWN) ? SDL_PRESSED : SDL_RELEASED;
+            ev.key.keysym.sym     = rev.d1;
+            ev.key.keysym.mod     = rev.d2;
+            ev.key.keysym.unicode = rev.d3;
+            break;
+         case SDL_MOUSEMOTION:
+            ev.motion.x     = rev.d1;
+            ev.motion.y     = rev.d2;
+            ev.motion.state = rev.d3;
+            break;
+         case SDL_MOUSEBUTTONDOWN:
+         case SDL_MOUSEBUTTONUP:
+            ev.button.state  = (rev.type==SDL_MOUSEBUTTONDOWN) ?
+                  SDL_PRESSED : SDL_RELEASED;
+            ev.button.button = rev.d1;
+            ev.button.x      = rev.d2;
+            ev.button.y      = rev.d3;
+            break;
+         case SDL_JOYAXISMOTION:
+            ev.jaxis.axis  = rev.d1;
+            ev.jaxis.value = rev.d2;
+            break;
+         case SDL_JOYBUTTONDOWN:
+         case SDL_JOYBUTTONUP:
+            ev.jbutton.button = rev.d1;
+            break;
+      }
+      input_handle( &ev );
+   }
+
+   *dt = rdt;
+}
+
+
+/**
+ * @brief Records or substitutes the frame dt, once per frame.
+ *
+ *    @param[in,out] dt The frame dt measured by fps_control().
+ */
+void replay_update( double *dt )
+{
+   if (replay_state == REPLAY_RECORD)
+      replay_writeFrame( *dt );
+   else if (replay_state == REPLAY_PLAYBACK)
+      replay_readFrame( dt );
+}
+
+
+/**
+ * @brief Stops recording or playback and closes the log.
+ */
+static void replay_stop (void)
+{
+   if (replay_file != NULL) {
+      fclose(replay_file);
+      replay_file = NULL;
+   }
+   replay_state = REPLAY_OFF;
+}
+
+
+/**
+ * @brief Cleans up the replay system.
+ */
+void replay_exit (void)
+{
+   replay_stop();
+}
@@ -0,0 +1,32 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+
+#ifndef REPLAY_H
+#  define REPLAY_H
+
+
+#include "SDL.h"
+
+
+/*
+ * Replay states.
+ */
+#define REPLAY_OFF      0 /**< Replay system inactive. */
+#define REPLAY_RECORD   1 /**< Recording the current session. */
+#define REPLAY_PLAYBACK 2 /**< Playing a recorded session back. */
+
+
+/* Init/exit. */
+void replay_init (void);
+void replay_exit (void);
+
+/* Recording and playback. */
+int replay_mode (void);
+void replay_event( SDL_Event *event );
+void replay_update( double *dt );
+
+
+#endif /* REPLAY_H */
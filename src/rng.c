@@ -37,9 +37,7 @@
 /*
  * mersenne twister state
  */
-static uint32_t MT[624]; /**< Mersenne twister state. */
-static uint32_t mt_y; /**< Internal mersenne twister variable. */
-static int mt_pos = 0; /**< Current number being used. */
+static RngStream rng_global; /**< Global mersenne twister stream. */
 
 
 /*
@@ -47,9 +45,9 @@ static int mt_pos = 0; /**< Current number being used. */
  */
 static uint32_t rng_timeEntropy (void);
 /* mersenne twister */
-static void mt_initArray( uint32_t seed );
-static void mt_genArray (void);
-static uint32_t mt_getInt (void);
+static void mt_initArray( RngStream *s, uint32_t seed );
+static void mt_genArray( RngStream *s );
+static uint32_t mt_getInt( RngStream *s );
 
 
 /**
@@ -68,7 +66,7 @@ void rng_init (void)
    fd = open("/dev/urandom", O_RDONLY); /* /dev/urandom is better than time seed */
    if (fd != -1) {
       i = sizeof(uint32_t)*624;
-      if (read( fd, &MT, i ) == (ssize_t)i)
+      if (read( fd, &rng_global.mt, i ) == (ssize_t)i)
          need_init = 0;
       else
          i = rng_timeEntropy();
@@ -81,9 +79,26 @@ void rng_init (void)
 #endif /* HAS_LINUX */
 
    if (need_init)
-      mt_initArray( i );
+      mt_initArray( &rng_global, i );
    for (i=0; i<10; i++) /* generate numbers to get away from poor initial values */
-      mt_genArray();
+      mt_genArray( &rng_global );
+}
+
+
+/**
+ * @brief Reseeds the generator with a known seed.
+ *
+ * Used by the replay system which needs a reproducible random stream.
+ *
+ *    @param seed Seed to use.
+ */
+void rng_initSeed( uint32_t seed )
+{
+   int i;
+
+   mt_initArray( &rng_global, seed );
+   for (i=0; i<10; i++) /* generate numbers to get away from poor initial values */
+      mt_genArray( &rng_global );
 }
 
 
@@ -113,59 +128,59 @@ static uint32_t rng_timeEntropy (void)
 
 
 /**
- * @fn static void mt_initArray( uint32_t seed )
+ * @fn static void mt_initArray( RngStream *s, uint32_t seed )
  *
  * @brief Generates the initial mersenne twister based on seed.
  */
-static void mt_initArray( uint32_t seed )
+static void mt_initArray( RngStream *s, uint32_t seed )
 {
    int i;
 
-   MT[0] = seed;
+   s->mt[0] = seed;
    for (i=1; i<624; i++)
-      MT[i] = 1812433253 * (MT[i-1] ^ (((MT[i-1])) + i) >> 30);
-   mt_pos = 0;
+      s->mt[i] = 1812433253 * (s->mt[i-1] ^ (((s->mt[i-1])) + i) >> 30);
+   s->pos = 0;
 }
 
 
 /**
- * @fn static void mt_genArray (void)
+ * @fn static void mt_genArray( RngStream *s )
  *
  * @brief Generates a new set of random numbers for the mersenne twister.
  */
-static void mt_genArray (void)
+static void mt_genArray( RngStream *s )
 {
    int i;
 
    for (i=0; i<624; i++ ) {
-      mt_y = (MT[i] & 0x80000000) + ((MT[i] % 624) & 0x7FFFFFFF);
-      if (mt_y % 2) /* odd */
-         MT[i] = (MT[(i+397) % 624] ^ (mt_y >> 1)) ^ 2567483615U;
+      s->y = (s->mt[i] & 0x80000000) + ((s->mt[i] % 624) & 0x7FFFFFFF);
+      if (s->y % 2) /* odd */
+         s->mt[i] = (s->mt[(i+397) % 624] ^ (s->y >> 1)) ^ 2567483615U;
       else /* even */
-         MT[i] = MT[(i+397) % 624] ^ (mt_y >> 1);
+         s->mt[i] = s->mt[(i+397) % 624] ^ (s->y >> 1);
    }
-   mt_pos = 0;
+   s->pos = 0;
 }
 
 
 /**
- * @fn static uint32_t mt_getInt (void)
+ * @fn static uint32_t mt_getInt( RngStream *s )
  *
  * @brief Gets the next int.
  *
  *    @return A random 4 byte number.
  */
-static uint32_t mt_getInt (void)
+static uint32_t mt_getInt( RngStream *s )
 {
-   if (mt_pos >= 624) mt_genArray();
+   if (s->pos >= 624) mt_genArray( s );
 
-   mt_y = MT[mt_pos++];
-   mt_y ^= mt_y >> 11;
-   mt_y ^= (mt_y << 7) & 2636928640U;
-   mt_y ^= (mt_y << 15) & 4022730752U;
-   mt_y ^= mt_y >> 18;
+   s->y = s->mt[s->pos++];
+   s->y ^= s->y >> 11;
+   s->y ^= (s->y << 7) & 2636928640U;
+   s->y ^= (s->y << 15) & 4022730752U;
+   s->y ^= s->y >> 18;
 
-   return mt_y;
+   return s->y;
 }
 
 
@@ -178,7 +193,7 @@ static uint32_t mt_getInt (void)
  */
 unsigned int randint (void)
 {
-   return mt_getInt();
+   return mt_getInt( &rng_global );
 }
 
 
@@ -192,11 +207,97 @@ unsigned int randint (void)
 static double m_div = (double)(0xFFFFFFFF); /**< Number to divide by. */
 double randfp (void)
 {
-   double m = (double)mt_getInt();
+   double m = (double)mt_getInt( &rng_global );
    return m / m_div;
 }
 
 
+/**
+ * @brief Fills a buffer with random floats between 0 and 1 (inclusive).
+ *
+ * Draws whole blocks out of the twister state at a time, so bulk
+ *  consumers (weapon spread, debris, nebula puffs) avoid the per-draw
+ *  call overhead of RNGF().
+ *
+ *    @param out Buffer to fill.
+ *    @param n Number of floats to generate.
+ */
+void rng_batch( float *out, int n )
+{
+   rng_streamBatch( &rng_global, out, n );
+}
+
+
+/**
+ * @brief Initializes an independent stream, seeded off the global generator.
+ *
+ * Must be called from the main thread; afterwards the stream may be used
+ *  by another thread without touching the global state.
+ *
+ *    @param s Stream to initialize.
+ */
+void rng_streamInit( RngStream *s )
+{
+   int i;
+
+   mt_initArray( s, mt_getInt( &rng_global ) );
+   for (i=0; i<10; i++) /* generate numbers to get away from poor initial values */
+      mt_genArray( s );
+}
+
+
+/**
+ * @brief Initializes an independent stream from a known seed.
+ *
+ * Same stream for the same seed, for reproducible procedural content.
+ *
+ *    @param s Stream to initialize.
+ *    @param seed Seed to use.
+ */
+void rng_streamInitSeed( RngStream *s, uint32_t seed )
+{
+   int i;
+
+   mt_initArray( s, seed );
+   for (i=0; i<10; i++) /* generate numbers to get away from poor initial values */
+      mt_genArray( s );
+}
+
+
+/**
+ * @brief Fills a buffer with random floats from an independent stream.
+ *
+ *    @param s Stream to draw from.
+ *    @param out Buffer to fill.
+ *    @param n Number of floats to generate.
+ */
+void rng_streamBatch( RngStream *s, float *out, int n )
+{
+   uint32_t y;
+   int i, left, run;
+
+   i = 0;
+   while (i < n) {
+      if (s->pos >= 624)
+         mt_genArray( s );
+
+      /* Temper and convert a whole run of the state array. */
+      left = n - i;
+      run  = 624 - s->pos;
+      if (run > left)
+         run = left;
+      for (; run > 0; run--) {
+         y  = s->mt[s->pos++];
+         y ^= y >> 11;
+         y ^= (y << 7) & 2636928640U;
+         y ^= (y << 15) & 4022730752U;
+         y ^= y >> 18;
+         out[i++] = (float)((double)y / m_div);
+      }
+   }
+}
+
+
 /**
  * @fn double Normal( double x )
  *
@@ -8,6 +8,9 @@
 #  define RNG_H
 
 
+#include <stdint.h>
+
+
 /**
  * @brief Gets a random number between L and H (L <= RNG <= H).
  *
@@ -44,13 +47,35 @@
 #define RNG_3SIGMA()       NormalInverse(0.001 + RNGF()*(1.-0.001*2.))
 
 
+/**
+ * @brief An independent mersenne twister stream.
+ *
+ * Parallel loops should draw from their own stream instead of contending
+ *  on the global generator.
+ */
+typedef struct RngStream_ {
+   uint32_t mt[624]; /**< Mersenne twister state. */
+   uint32_t y; /**< Internal mersenne twister variable. */
+   int pos; /**< Current number being used. */
+} RngStream;
+
+
 /* Init */
 void rng_init (void);
+void rng_initSeed( uint32_t seed );
 
 /* Random functions */
 unsigned int randint (void);
 double randfp (void);
 
+/* Batch generation. */
+void rng_batch( float *out, int n );
+
+/* Independent streams. */
+void rng_streamInit( RngStream *s );
+void rng_streamInitSeed( RngStream *s, uint32_t seed );
+void rng_streamBatch( RngStream *s, float *out, int n );
+
 /* Probability functions */
 double Normal( double x );
 double NormalInverse( double p );
@@ -14,6 +14,11 @@
 
 #include <stdio.h> /* remove() */
 #include <errno.h> /* errno */
+#include <string.h> /* strerror() */
+#include <zlib.h> /* gzopen() and friends */
+
+#include "SDL.h"
+#include "SDL_thread.h"
 
 #include "log.h"
 #include "nxml.h"
@@ -27,6 +32,9 @@
 #include "unidiff.h"
 #include "nlua_var.h"
 #include "event.h"
+#include "land.h"
+#include "space.h"
+#include "ntime.h"
 
 
 #define LOAD_WIDTH      400 /**< Load window width. */
@@ -63,50 +71,260 @@ extern int diff_save( xmlTextWriterPtr writer ); /**< Saves the universe diffs.
 extern int diff_load( xmlNodePtr parent ); /**< Loads the universe diffs. */
 /* menu.c */
 extern void menu_main_close (void); /**< Closes the main menu. */
+
+
+/**
+ * @brief A savegame section with its cached serialization.
+ */
+typedef struct SaveSectionCache_ {
+   int (*save)( xmlTextWriterPtr writer ); /**< Serializes the section. */
+   int dirty; /**< Whether the cache is stale. */
+   xmlBufferPtr cache; /**< Bytes from the last serialization. */
+} SaveSectionCache;
+
+/*
+ * Sections are serialized separately so autosave can splice the cached
+ *  bytes of the ones whose state didn't change since the last save.
+ *  Order must match the SaveSection enum and is also the order sections
+ *  end up in the file - diffs must come first, see save_data().
+ */
+static SaveSectionCache save_sections[SAVE_NUM_SECTIONS] = {
+   { diff_save,           1, NULL }, /* SAVE_DIFF */
+   { player_save,         1, NULL }, /* SAVE_PLAYER */
+   { missions_saveActive, 1, NULL }, /* SAVE_MISSIONS */
+   { var_save,            1, NULL }, /* SAVE_VAR */
+   { pfaction_save,       1, NULL }, /* SAVE_FACTION */
+   { hook_save,           1, NULL }, /* SAVE_HOOK */
+   { space_sysSave,       1, NULL }  /* SAVE_SPACE */
+};
+
+
 /* static */
+static int save_section( SaveSectionCache *sec );
 static int save_data( xmlTextWriterPtr writer );
+static int save_write( void *unused );
+static void save_metadata (void);
+static char* load_readFile( const char* file, int *size );
 static void load_menu_close( unsigned int wdw, char *str );
 static void load_menu_load( unsigned int wdw, char *str );
+static void load_menu_update( unsigned int wdw, char *str );
 static void load_menu_delete( unsigned int wdw, char *str );
 static int load_game( const char* file );
 
 
+/*
+ * Asynchronous writing.  The save is serialized into a reusable buffer on
+ *  the main thread (which is what snapshots the game state), then the
+ *  actual disk I/O happens on a helper thread so autosave doesn't hitch.
+ */
+static SDL_Thread *save_thread = NULL; /**< Pending write thread. */
+static xmlBufferPtr save_buf   = NULL; /**< Reusable serialization buffer. */
+static char save_path[PATH_MAX]; /**< File the pending write targets. */
+
+
+/**
+ * @brief Marks a save section's cached serialization as stale.
+ *
+ *    @param section Section whose state changed.
+ */
+void save_dirty( SaveSection section )
+{
+   save_sections[section].dirty = 1;
+}
+
+
+/**
+ * @brief Reserializes a section into its cache buffer.
+ *
+ *    @param sec Section to serialize.
+ *    @return 0 on success.
+ */
+static int save_section( SaveSectionCache *sec )
+{
+   xmlTextWriterPtr writer;
+
+   /* Create or recycle the section buffer. */
+   if (sec->cache == NULL)
+      sec->cache = xmlBufferCreate();
+   else
+      xmlBufferEmpty( sec->cache );
+   writer = xmlNewTextWriterMemory( sec->cache, 0 );
+   if (writer == NULL) {
+      ERR("Error creating the xml writer");
+      return -1;
+   }
+   xmlTextWriterSetIndentString(writer, (const xmlChar*)" ");
+   xmlTextWriterSetIndent(writer, 1);
+
+   if (sec->save(writer) < 0) {
+      xmlFreeTextWriter(writer);
+      return -1;
+   }
+
+   /* Freeing flushes the remaining bytes into the buffer. */
+   xmlFreeTextWriter(writer);
+   sec->dirty = 0;
+   return 0;
+}
+
+
 /**
  * @brief Saves all the player's game data.
  *
+ * Sections that are not dirty get their cached bytes spliced in instead
+ *  of being re-serialized.  Diffs must come first in the file or they
+ *  can clear state the later sections just loaded.
+ *
  *    @param writer XML writer to use.
  *    @return 0 on success.
  */
 static int save_data( xmlTextWriterPtr writer )
 {
-   /* the data itself */
-   if (diff_save(writer) < 0) return -1; /* Must save first or can get cleared. */
-   if (player_save(writer) < 0) return -1;
-   if (missions_saveActive(writer) < 0) return -1;
-   if (var_save(writer) < 0) return -1;
-   if (pfaction_save(writer) < 0) return -1;
-   if (hook_save(writer) < 0) return -1;
-   if (space_sysSave(writer) < 0) return -1;
+   SaveSectionCache *sec;
+   const char *content;
+   int i, len;
+
+   /* These practically always change between saves, never cache them. */
+   save_sections[SAVE_PLAYER].dirty   = 1;
+   save_sections[SAVE_MISSIONS].dirty = 1;
+
+   for (i=0; i<SAVE_NUM_SECTIONS; i++) {
+      sec = &save_sections[i];
+
+      /* Refresh stale sections. */
+      if (sec->dirty || (sec->cache == NULL))
+         if (save_section( sec ) < 0)
+            return -1;
+
+      /* Splice the cached bytes, skipping the XML declaration the
+       * section writer emits on its first element. */
+      content = (const char*) xmlBufferContent( sec->cache );
+      len     = xmlBufferLength( sec->cache );
+      if ((len > 5) && (strncmp( content, "<?xml", 5 )==0)) {
+         while ((len > 0) && (*content != '\n')) {
+            content++;
+            len--;
+         }
+      }
+      xmlw_raw( writer, content, len );
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Writes the serialized savegame to disk.
+ *
+ * Runs on a helper thread, only touches save_buf and save_path which the
+ *  main thread leaves alone until it has joined us again.
+ *
+ *    @param unused Unused.
+ *    @return 0 on success.
+ */
+static int save_write( void *unused )
+{
+   gzFile gz;
+   char tmp[PATH_MAX];
+   int len;
+   (void) unused;
+
+   /* Back up old savegame. */
+   if (nfile_backupIfExists(save_path) < 0) {
+      WARN("Aborting save...");
+      return -1;
+   }
+
+   /* Compress into a temporary file first so a crash mid-write can never
+    * leave a half-written savegame behind. */
+   snprintf( tmp, PATH_MAX, "%s.tmp", save_path );
+   gz = nfile_gzOpen( "wb", "%s", tmp );
+   if (gz == NULL) {
+      WARN("Failed to write savegame!  You'll most likely have to restore it by copying your backup savegame over your current savegame.");
+      return -1;
+   }
+   len = (int) xmlBufferLength(save_buf);
+   if (gzwrite( gz, xmlBufferContent(save_buf), len ) != len) {
+      WARN("Failed to write savegame!  You'll most likely have to restore it by copying your backup savegame over your current savegame.");
+      gzclose(gz);
+      remove(tmp);
+      return -1;
+   }
+   if (gzclose(gz) != Z_OK) {
+      WARN("Failed to write savegame!  You'll most likely have to restore it by copying your backup savegame over your current savegame.");
+      remove(tmp);
+      return -1;
+   }
+
+   /* Flip the finished file into place - the backup above moved the old
+    * savegame away so the rename is portable. */
+   if (rename( tmp, save_path ) < 0) {
+      WARN("Unable to rename '%s' to '%s': %s", tmp, save_path,
+            strerror(errno));
+      return -1;
+   }
 
    return 0;
 }
 
 
+/**
+ * @brief Writes the metadata sidecar next to the savegame.
+ *
+ * A small "Key: value" text file the load menu reads to show details of
+ *  a save without opening the compressed XML.  Best effort - a save
+ *  without a sidecar just shows no details.
+ */
+static void save_metadata (void)
+{
+   char buf[256];
+   int len;
+
+   len = snprintf( buf, sizeof(buf),
+         "Player: %s\n"
+         "Credits: %u\n"
+         "Location: %s\n"
+         "Date: %s\n",
+         player_name, player->credits,
+         (landed && (land_planet != NULL)) ?
+               land_planet->name : cur_system->name,
+         ntime_prettyRaw() );
+   nfile_writeFile( buf, len, "%s.meta", save_path );
+}
+
+
 /**
  * @brief Saves the current game.
  *
+ * Serialization runs synchronously so it sees a consistent snapshot of
+ *  the game state, the disk write is handed off to a helper thread.
+ *
  *    @return 0 on success.
  */
 int save_all (void)
 {
-   char file[PATH_MAX];
-   xmlDocPtr doc;
    xmlTextWriterPtr writer;
 
-   /* Create the writer. */
-   writer = xmlNewTextWriterDoc(&doc, 1);
+   /* Wait for a previous write before reusing the buffer. */
+   if (save_thread != NULL) {
+      SDL_WaitThread( save_thread, NULL );
+      save_thread = NULL;
+   }
+
+   /* Create or recycle the serialization buffer. */
+   if (save_buf == NULL)
+      save_buf = xmlBufferCreate();
+   else
+      xmlBufferEmpty(save_buf);
+   if (save_buf == NULL) {
+      ERR("Error creating the xml buffer");
+      return -1;
+   }
+
+   /* Create the writer, streams straight into the buffer. */
+   writer = xmlNewTextWriterMemory(save_buf, 0);
    if (writer == NULL) {
-      ERR("testXmlwriterDoc: Error creating the xml writer");
+      ERR("Error creating the xml writer");
       return -1;
    }
 
@@ -133,38 +351,55 @@ int save_all (void)
    /* Finish element. */
    xmlw_endElem(writer); /* "naev_save" */
    xmlw_done(writer);
+   xmlFreeTextWriter(writer);
 
    /* Write to file. */
    if (nfile_dirMakeExist("%ssaves", nfile_basePath()) < 0) {
       WARN("Aborting save...");
-      goto err_writer;
+      return -1;
    }
-   snprintf(file, PATH_MAX, "%ssaves/%s.ns", nfile_basePath(), player_name);
+   snprintf(save_path, PATH_MAX, "%ssaves/%s.ns", nfile_basePath(), player_name);
 
-   /* Back up old savegame. */
-   if (nfile_backupIfExists(file) < 0) {
-      WARN("Aborting save...");
-      goto err_writer;
-   }
+   /* Sidecar so the load menu can show details without parsing saves. */
+   save_metadata();
 
-   /* Critical section, if crashes here player's game gets corrupted.
-    * Luckily we have a copy just in case... */
-   xmlFreeTextWriter(writer);
-   if (xmlSaveFileEnc(file, doc, "UTF-8") < 0) {
-      WARN("Failed to write savegame!  You'll most likely have to restore it by copying your backup savegame over your current savegame.");
-      goto err;
-   }
-   xmlFreeDoc(doc);
+   /* Hand the I/O off to a helper thread, fall back to writing inline. */
+   save_thread = SDL_CreateThread( save_write, NULL );
+   if (save_thread == NULL)
+      return save_write(NULL);
 
    return 0;
 
 err_writer:
    xmlFreeTextWriter(writer);
-err:
-   xmlFreeDoc(doc);
    return -1;
 }
 
+
+/**
+ * @brief Waits for any pending save to hit the disk and frees resources.
+ */
+void save_exit (void)
+{
+   int i;
+
+   if (save_thread != NULL) {
+      SDL_WaitThread( save_thread, NULL );
+      save_thread = NULL;
+   }
+   if (save_buf != NULL) {
+      xmlBufferFree(save_buf);
+      save_buf = NULL;
+   }
+   for (i=0; i<SAVE_NUM_SECTIONS; i++) {
+      if (save_sections[i].cache != NULL) {
+         xmlBufferFree(save_sections[i].cache);
+         save_sections[i].cache = NULL;
+         save_sections[i].dirty = 1;
+      }
+   }
+}
+
 /**
  * @brief Reload the current savegame.
  */
@@ -209,8 +444,14 @@ void load_game_menu (void)
       nfiles = 1;
    }
    window_addList( wid, 20, -50,
-         LOAD_WIDTH-BUTTON_WIDTH-50, LOAD_HEIGHT-110,
-         "lstSaves", files, nfiles, 0, NULL );
+         150, LOAD_HEIGHT-110,
+         "lstSaves", files, nfiles, 0, load_menu_update );
+
+   /* details from the metadata sidecar of the selected save */
+   window_addText( wid, 180, -50,
+         LOAD_WIDTH-180-BUTTON_WIDTH-40, LOAD_HEIGHT-110, 0,
+         "txtData", &gl_smallFont, &cBlack, NULL );
+   load_menu_update( wid, NULL );
 
    /* buttons */
    window_addButton( wid, -20, 20, BUTTON_WIDTH, BUTTON_HEIGHT,
@@ -261,6 +502,38 @@ static void load_menu_load( unsigned int wdw, char *str )
       load_game_menu();
    }
 }
+/**
+ * @brief Updates the displayed details when the selected save changes.
+ *
+ * Only reads the metadata sidecar, never the save itself.
+ *
+ *    @param wdw Window triggering function.
+ *    @param str Unused.
+ */
+static void load_menu_update( unsigned int wdw, char *str )
+{
+   (void)str;
+   char *save, *buf;
+   char display[256];
+   int len;
+
+   save = toolkit_getList( wdw, "lstSaves" );
+   if (strcmp(save,"None") == 0) {
+      window_modifyText( wdw, "txtData", NULL );
+      return;
+   }
+
+   buf = nfile_readFile( &len, "%ssaves/%s.ns.meta",
+         nfile_basePath(), save );
+   if (buf == NULL) { /* Save predates the sidecars. */
+      window_modifyText( wdw, "txtData", "No details available." );
+      return;
+   }
+
+   snprintf( display, sizeof(display), "%.*s", len, buf );
+   window_modifyText( wdw, "txtData", display );
+   free(buf);
+}
 /**
  * @brief Deletes an old game.
  *    @param wdw Window to delete.
@@ -285,12 +558,60 @@ static void load_menu_delete( unsigned int wdw, char *str )
    snprintf( path, PATH_MAX, "%ssaves/%s.ns", nfile_basePath(), save );
    remove(path); /* remove is portable and will call unlink on linux. */
 
+   /* remove the metadata sidecar too */
+   snprintf( path, PATH_MAX, "%ssaves/%s.ns.meta", nfile_basePath(), save );
+   remove(path);
+
    /* need to reload the menu */
    load_menu_close(wdw, NULL);
    load_game_menu();
 }
 
 
+/**
+ * @brief Reads an entire savegame, transparently decompressing gzip.
+ *
+ * gzread() passes uncompressed data straight through, so old plain XML
+ *  savegames keep loading without a special case.
+ *
+ *    @param file File to read.
+ *    @param size Set to the uncompressed size.
+ *    @return The file's contents or NULL on error, must be freed.
+ */
+static char* load_readFile( const char* file, int *size )
+{
+   gzFile gz;
+   char *buf;
+   int len, cap, n;
+
+   gz = nfile_gzOpen( "rb", "%s", file );
+   if (gz == NULL)
+      return NULL;
+
+   /* Uncompressed size isn't known up front, grow as needed. */
+   cap = 256*1024;
+   buf = malloc( cap );
+   len = 0;
+   while ((n = gzread( gz, &buf[len], cap-len )) > 0) {
+      len += n;
+      if (len == cap) {
+         cap *= 2;
+         buf = realloc( buf, cap );
+      }
+   }
+   gzclose(gz);
+
+   if (n < 0) {
+      WARN("Error reading savegame '%s'.", file);
+      free(buf);
+      return NULL;
+   }
+
+   *size = len;
+   return buf;
+}
+
+
 /**
  * @brief Actually loads a new game based on file.
  *
@@ -299,9 +620,17 @@ static void load_menu_delete( unsigned int wdw, char *str )
  */
 static int load_game( const char* file )
 {
+   char *buf;
+   int i, size;
    xmlNodePtr node;
    xmlDocPtr doc;
 
+   /* Don't read a savegame that is still being written. */
+   if (save_thread != NULL) {
+      SDL_WaitThread( save_thread, NULL );
+      save_thread = NULL;
+   }
+
    /* Make sure it exists. */
    if (!nfile_fileExists(file)) {
       dialogue_alert("Savegame file seems to have been deleted.");
@@ -309,7 +638,11 @@ static int load_game( const char* file )
    }
 
    /* Load the XML. */
-   doc   = xmlParseFile(file);
+   buf = load_readFile( file, &size );
+   if (buf == NULL)
+      goto err;
+   doc = xml_parseMemory( buf, size );
+   free(buf);
    if (doc == NULL)
       goto err;
    node  = doc->xmlChildrenNode; /* base node */
@@ -332,6 +665,10 @@ static int load_game( const char* file )
    hook_load(node);
    space_sysLoad(node);
 
+   /* The loaded state invalidates every cached save section. */
+   for (i=0; i<SAVE_NUM_SECTIONS; i++)
+      save_sections[i].dirty = 1;
+
    /* Initialize the economy. */
    economy_init();
 
@@ -7,7 +7,30 @@
 #  define SAVE_H
 
 
+/**
+ * @enum SaveSection
+ *
+ * @brief Independently serialized chunks of the savegame.
+ *
+ * Subsystems call save_dirty() when their saved state changes so autosave
+ *  can splice the cached bytes of untouched sections instead of
+ *  re-serializing everything.
+ */
+typedef enum SaveSection_ {
+   SAVE_DIFF, /**< Universe diffs. */
+   SAVE_PLAYER, /**< Player, ships and licenses. */
+   SAVE_MISSIONS, /**< Active missions. */
+   SAVE_VAR, /**< Mission variables. */
+   SAVE_FACTION, /**< Faction standings. */
+   SAVE_HOOK, /**< Mission and event hooks. */
+   SAVE_SPACE, /**< Known systems. */
+   SAVE_NUM_SECTIONS /**< Total number of sections. */
+} SaveSection;
+
+
 int save_all (void);
+void save_dirty( SaveSection section );
+void save_exit (void);
 void reload (void);
 void load_game_menu (void);
 
@@ -22,6 +22,7 @@
 #include "ndata.h"
 #include "toolkit.h"
 #include "array.h"
+#include "strhash.h"
 
 
 #define XML_ID    "Ships"  /**< XML document identifier */
@@ -45,6 +46,7 @@
 
 
 static Ship* ship_stack = NULL; /**< Stack of ships available in the game. */
+static StrHash* ship_hash = NULL; /**< Name index of the ship stack. */
 
 
 /*
@@ -65,6 +67,14 @@ Ship* ship_get( const char* name )
    Ship* temp = ship_stack;
    int i;
 
+   /* Hash is built once loading finishes. */
+   if (ship_hash != NULL) {
+      temp = strhash_get( ship_hash, name );
+      if (temp != NULL)
+         return temp;
+      temp = ship_stack;
+   }
+
    for (i=0; i < array_size(ship_stack); i++)
       if (strcmp((temp+i)->name, name)==0) break;
 
@@ -352,11 +362,12 @@ static int ship_parse( Ship *temp, xmlNodePtr parent )
          /* Load the space sprite. */
          snprintf( str, PATH_MAX, SHIP_GFX"%s/%s"SHIP_EXT, base, buf );
          temp->gfx_space = gl_newSprite( str, sx, sy,
-               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS );
+               OPENGL_TEX_MAPTRANS | OPENGL_TEX_MIPMAPS | OPENGL_TEX_ATLAS );
 
          /* Load the engine sprite .*/
          snprintf( str, PATH_MAX, SHIP_GFX"%s/%s"SHIP_ENGINE SHIP_EXT, base, buf );
-         temp->gfx_engine = gl_newSprite( str, sx, sy, OPENGL_TEX_MIPMAPS );
+         temp->gfx_engine = gl_newSprite( str, sx, sy,
+               OPENGL_TEX_MIPMAPS | OPENGL_TEX_ATLAS );
          if (temp->gfx_engine == NULL)
             WARN("Ship '%s' does not have an engine sprite (%s).", temp->name, str );
 
@@ -538,11 +549,12 @@ static int ship_parse( Ship *temp, xmlNodePtr parent )
  */
 int ships_load (void)
 {
+   int i;
    uint32_t bufsize;
    char *buf = ndata_read( SHIP_DATA, &bufsize);
 
    xmlNodePtr node;
-   xmlDocPtr doc = xmlParseMemory( buf, bufsize );
+   xmlDocPtr doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode; /* Ships node */
    if (strcmp((char*)node->name,XML_ID)) {
@@ -564,6 +576,11 @@ int ships_load (void)
    } while (xml_nextNode(node));
    array_shrink(&ship_stack);
 
+   /* Build the name index, the stack won't move any more. */
+   ship_hash = strhash_create( array_size(ship_stack) );
+   for (i=0; i<array_size(ship_stack); i++)
+      strhash_put( ship_hash, ship_stack[i].name, &ship_stack[i] );
+
    xmlFreeDoc(doc);
    free(buf);
 
@@ -603,6 +620,16 @@ void ships_free (void)
       if (s->outfit_high != NULL)
          free(s->outfit_high);
 
+      /* Free the shared loadout template if pilot.c built it. */
+      if (s->tmpl_low != NULL)
+         free(s->tmpl_low);
+      if (s->tmpl_medium != NULL)
+         free(s->tmpl_medium);
+      if (s->tmpl_high != NULL)
+         free(s->tmpl_high);
+      if (s->tmpl_all != NULL)
+         free(s->tmpl_all);
+
       /* Free graphics. */
       gl_freeTexture(s->gfx_space);
       if (s->gfx_engine != NULL)
@@ -611,6 +638,8 @@ void ships_free (void)
       free(s->gfx_comm);
    }
 
+   strhash_destroy(ship_hash);
+   ship_hash = NULL;
    array_free(ship_stack);
    ship_stack = NULL;
 }
@@ -63,6 +63,9 @@ typedef struct ShipMount_ {
 } ShipMount;
 
 
+struct PilotOutfitSlot_; /* Defined in pilot.h. */
+
+
 /**
  * @brief Ship outfit slot.
  */
@@ -127,6 +130,13 @@ typedef struct Ship_ {
    int outfit_nhigh; /**< Number of high energy outfit slots. */
    ShipOutfitSlot *outfit_high; /**< Outfit high energy slots. */
 
+   /* Shared empty loadout, built lazily by pilot.c on the first spawn.
+    * Pilots reference these until an outfit actually changes. */
+   struct PilotOutfitSlot_ *tmpl_low; /**< Template low slots. */
+   struct PilotOutfitSlot_ *tmpl_medium; /**< Template medium slots. */
+   struct PilotOutfitSlot_ *tmpl_high; /**< Template high slots. */
+   struct PilotOutfitSlot_ **tmpl_all; /**< Template global slot pointers. */
+
    /* mounts */
    double mangle; /**< Mount angle to simplify mount calculations. */
 } Ship;
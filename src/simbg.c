@@ -0,0 +1,193 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file simbg.c
+ *
+ * @brief Coarse background simulation of the systems around the player.
+ *
+ * Pilots only exist in the current system, but each system keeps a
+ *  presence level per fleet slot.  The player's system runs the real
+ *  simulation; systems one jump away get a cheap statistical tick every
+ *  few seconds where hostile fleets wear each other down and traffic
+ *  regenerates towards its nominal level; everything further out is
+ *  dormant and keeps whatever state it last had.
+ *
+ * space_init() and the respawn logic scale their fleet chances by the
+ *  presence, so a battle that raged next door while the player was busy
+ *  shows as thinned traffic when they arrive.  The tick touches at most
+ *  the current system's neighbours, so the cost is fixed and tiny no
+ *  matter how big the universe is.
+ */
+
+#include "simbg.h"
+
+#include "naev.h"
+
+#include <stdlib.h>
+
+#include "log.h"
+#include "space.h"
+#include "fleet.h"
+#include "faction.h"
+#include "rng.h"
+
+
+/*
+ * From space.c.
+ */
+extern int systems_nstack;
+
+
+#define SIMBG_INTERVAL       5. /**< Game seconds between coarse ticks. */
+#define SIMBG_REGEN        0.02 /**< Pull towards nominal presence per tick. */
+#define SIMBG_BATTLE_CHANCE 0.1 /**< Chance two hostile fleets clash per tick. */
+#define SIMBG_BATTLE_LOSS  0.25 /**< Maximum presence lost in a clash. */
+#define SIMBG_PRESENCE_MAX   2. /**< Presence cap, nominal is 1. */
+
+
+static double **simbg_presence = NULL; /**< Per system per fleet presence. */
+static int simbg_nsystems      = 0; /**< Systems allocated for. */
+static double simbg_timer      = 0.; /**< Time until the next tick. */
+
+
+/*
+ * Prototypes.
+ */
+static void simbg_tick( StarSystem *sys );
+
+
+/**
+ * @brief Allocates the presence levels, must run after systems load.
+ */
+void simbg_init (void)
+{
+   int i, j;
+   StarSystem *sys;
+
+   simbg_exit(); /* In case of reload. */
+
+   simbg_nsystems = systems_nstack;
+   simbg_presence = malloc( simbg_nsystems * sizeof(double*) );
+   for (i=0; i<simbg_nsystems; i++) {
+      sys = system_getIndex(i);
+      if (sys->nfleets == 0) {
+         simbg_presence[i] = NULL;
+         continue;
+      }
+      simbg_presence[i] = malloc( sys->nfleets * sizeof(double) );
+      for (j=0; j<sys->nfleets; j++)
+         simbg_presence[i][j] = 1.; /* Everything starts nominal. */
+   }
+   simbg_timer = SIMBG_INTERVAL;
+}
+
+
+/**
+ * @brief Frees the presence levels.
+ */
+void simbg_exit (void)
+{
+   int i;
+
+   if (simbg_presence == NULL)
+      return;
+
+   for (i=0; i<simbg_nsystems; i++)
+      if (simbg_presence[i] != NULL)
+         free( simbg_presence[i] );
+   free( simbg_presence );
+   simbg_presence = NULL;
+   simbg_nsystems = 0;
+}
+
+
+/**
+ * @brief Runs one coarse tick on a single system.
+ *
+ *    @param sys System to tick.
+ */
+static void simbg_tick( StarSystem *sys )
+{
+   int i, j, id;
+   double *p;
+   double loss;
+
+   id = sys - system_getIndex(0);
+   if ((id < 0) || (id >= simbg_nsystems) || (simbg_presence[id] == NULL))
+      return;
+   p = simbg_presence[id];
+
+   for (i=0; i<sys->nfleets; i++) {
+      /* Traffic trickles back towards nominal. */
+      p[i] += SIMBG_REGEN * (1. - p[i]);
+
+      /* Hostile fleets wear each other down. */
+      for (j=i+1; j<sys->nfleets; j++) {
+         if (!areEnemies( sys->fleets[i].fleet->faction,
+               sys->fleets[j].fleet->faction ))
+            continue;
+         /* Both sides must actually be around to clash. */
+         if (RNGF() > SIMBG_BATTLE_CHANCE * MIN( p[i], p[j] ))
+            continue;
+         loss  = RNGF() * SIMBG_BATTLE_LOSS;
+         p[i] -= loss * p[j];
+         p[j] -= loss * p[i];
+         if (p[i] < 0.) p[i] = 0.;
+         if (p[j] < 0.) p[j] = 0.;
+      }
+
+      p[i] = CLAMP( 0., SIMBG_PRESENCE_MAX, p[i] );
+   }
+}
+
+
+/**
+ * @brief Updates the background simulation.
+ *
+ * Only the current system's neighbours tick; everything else stays
+ *  frozen until the player gets close again.
+ *
+ *    @param dt Game time increment in seconds.
+ */
+void simbg_update( double dt )
+{
+   int i;
+
+   if ((simbg_presence == NULL) || (cur_system == NULL))
+      return;
+
+   simbg_timer -= dt;
+   if (simbg_timer > 0.)
+      return;
+   simbg_timer = SIMBG_INTERVAL;
+
+   for (i=0; i<cur_system->njumps; i++)
+      simbg_tick( system_getIndex( cur_system->jumps[i] ) );
+}
+
+
+/**
+ * @brief Gets the presence factor of a fleet slot in a system.
+ *
+ * 1. is nominal, 0. means the fleet was wiped out recently.
+ *
+ *    @param sys System to look in.
+ *    @param fleet Index into the system's fleet array.
+ *    @return Presence factor in [0, SIMBG_PRESENCE_MAX].
+ */
+double simbg_getPresence( const StarSystem *sys, int fleet )
+{
+   int id;
+
+   if (simbg_presence == NULL)
+      return 1.;
+
+   id = sys - system_getIndex(0);
+   if ((id < 0) || (id >= simbg_nsystems) || (simbg_presence[id] == NULL) ||
+         (fleet < 0) || (fleet >= sys->nfleets))
+      return 1.;
+
+   return simbg_presence[id][fleet];
+}
@@ -0,0 +1,26 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef SIMBG_H
+#  define SIMBG_H
+
+
+#include "space.h"
+
+
+/*
+ * Lifetime, driven by space.c.
+ */
+void simbg_init (void);
+void simbg_exit (void);
+
+/*
+ * Per-frame update and presence lookup.
+ */
+void simbg_update( double dt );
+double simbg_getPresence( const StarSystem *sys, int fleet );
+
+
+#endif /* SIMBG_H */
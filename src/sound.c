@@ -23,7 +23,9 @@
 #include "sound_openal.h"
 #include "sound_sdlmix.h"
 #include "log.h"
+#include "count.h"
 #include "ndata.h"
+#include "njob.h"
 #include "music.h"
 #include "physics.h"
 #include "conf.h"
@@ -38,6 +40,16 @@
 #define voiceUnlock()      SDL_UnlockMutex(voice_mutex)
 
 
+#define SOUND_MAX_DIST     5000. /**< Maximum distance at which a voice is
+                                      audible, matches the AL_MAX_DISTANCE the
+                                      OpenAL backend sets on its sources. */
+#define SOUND_MAX_INSTANCES 4 /**< Overlapping instances of one sound before
+                                   new ones must steal a voice. */
+#define SOUND_MERGE_MAX    32 /**< Distinct samples tracked for merging per
+                                  frame. */
+#define SOUND_MERGE_GAIN_MAX 2. /**< Gain cap for merged voices. */
+
+
 /*
  * Global sound properties.
  */
@@ -60,6 +72,28 @@ static alVoice *voice_pool    = NULL; /**< Pool of free voices. */
 static SDL_mutex *voice_mutex = NULL; /**< Lock for voices. */
 
 
+/*
+ * Listener, used to cull voices before they hit the backend.
+ */
+static double listener_x      = 0.; /**< Listener X position. */
+static double listener_y      = 0.; /**< Listener Y position. */
+
+/**
+ * @brief One sample played this frame, for merging identical repeats.
+ */
+typedef struct SoundMerge_ {
+   int sound; /**< Sound being tracked. */
+   int voice; /**< Voice the merged instances share. */
+   int count; /**< Instances merged so far. */
+   double px; /**< Accumulated X positions. */
+   double py; /**< Accumulated Y positions. */
+   double vx; /**< Accumulated X velocities. */
+   double vy; /**< Accumulated Y velocities. */
+} SoundMerge;
+static SoundMerge sound_merge[SOUND_MERGE_MAX]; /**< Samples played this frame. */
+static int sound_nmerge       = 0; /**< Samples tracked this frame. */
+
+
 
 /*
  * Function pointers for backends.
@@ -79,7 +113,13 @@ int  (*sound_sys_playPos) ( alVoice *v, alSound *s,
       double px, double py, double vx, double vy ) = NULL;
 int  (*sound_sys_updatePos) ( alVoice *v, double px, double py,
       double vx, double vy )           = NULL;
+int  (*sound_sys_setGain) ( alVoice *v, double gain ) = NULL; /**< Optional,
+                                  scales one voice relative to the master
+                                  volume. */
 void (*sound_sys_updateVoice) ( alVoice *v ) = NULL;
+void (*sound_sys_updateBegin) (void)   = NULL; /**< Optional, brackets the
+                                                    voice update loop. */
+void (*sound_sys_updateEnd) (void)     = NULL;
  /* Sound management. */
 void (*sound_sys_update) (void)        = NULL;
 void (*sound_sys_stop) ( alVoice *v )  = NULL;
@@ -99,14 +139,27 @@ void (*sound_sys_resumeGroup) (int group ) = NULL;
 int  (*sound_sys_env) ( SoundEnv_t env, double param ) = NULL;
 
 
+/**
+ * @struct SoundLoad
+ *
+ * @brief Job data for the parallel sound decode.
+ */
+typedef struct SoundLoad_ {
+   char **paths; /**< Path of each sound in the list. */
+   int *failed;  /**< Nonzero where the load failed. */
+} SoundLoad;
+
+
 /*
  * prototypes
  */
 /* General. */
 static int sound_makeList (void);
+static void sound_loadRange( int start, int end, void *data );
 static int sound_load( alSound *snd, const char *filename );
 static void sound_free( alSound *snd );
 /* Voices. */
+static int voice_steal( int sound, double dist2 );
 
 
 /**
@@ -148,7 +201,10 @@ int sound_init (void)
       sound_sys_play       = sound_al_play;
       sound_sys_playPos    = sound_al_playPos;
       sound_sys_updatePos  = sound_al_updatePos;
+      sound_sys_setGain    = sound_al_setGain;
       sound_sys_updateVoice = sound_al_updateVoice;
+      sound_sys_updateBegin = sound_al_updateBegin;
+      sound_sys_updateEnd  = sound_al_updateEnd;
       /* Sound management. */
       sound_sys_update     = sound_al_update;
       sound_sys_stop       = sound_al_stop;
@@ -188,6 +244,7 @@ int sound_init (void)
       sound_sys_play       = sound_mix_play;
       sound_sys_playPos    = sound_mix_playPos;
       sound_sys_updatePos  = sound_mix_updatePos;
+      sound_sys_setGain    = sound_mix_setGain;
       sound_sys_updateVoice = sound_mix_updateVoice;
       /* Sound management. */
       sound_sys_update     = sound_mix_update;
@@ -354,19 +411,27 @@ int sound_play( int sound )
    if ((sound < 0) || (sound > sound_nlist))
       return -1;
 
-   /* Gets a new voice. */
-   v = voice_new();
-
    /* Get the sound. */
    s = &sound_list[sound];
 
+   /* Enough of this sound already, listener won't tell the difference. */
+   if (s->playing >= SOUND_MAX_INSTANCES)
+      return 0;
+
+   /* Gets a new voice. */
+   v = voice_new();
+
    /* Try to play the sound. */
    if (sound_sys_play( v, s ))
       return -1;
 
    /* Set state and add to list. */
+   COUNT_INC( COUNT_SOUND );
    v->state = VOICE_PLAYING;
    v->id = ++voice_genid;
+   v->sound = sound;
+   v->dist2 = 0.;
+   s->playing++;
    voice_add(v);
 
    return v->id;
@@ -387,6 +452,9 @@ int sound_playPos( int sound, double px, double py, double vx, double vy )
 {
    alVoice *v;
    alSound *s;
+   SoundMerge *m;
+   double dist2, gain;
+   int i;
 
    if (sound_disabled)
       return 0;
@@ -394,25 +462,116 @@ int sound_playPos( int sound, double px, double py, double vx, double vy )
    if ((sound < 0) || (sound > sound_nlist))
       return -1;
 
-   /* Gets a new voice. */
-   v = voice_new();
+   /* Cull sounds the listener can't hear, they would just tie up a source
+    * until they ran out. */
+   dist2 = pow2(px - listener_x) + pow2(py - listener_y);
+   if (dist2 > pow2(SOUND_MAX_DIST))
+      return 0;
 
    /* Get the sound. */
    s = &sound_list[sound];
 
+   /* Merge with an identical sample already fired this frame - a volley
+    * collapses into one louder voice at the average position, which both
+    * bounds the voice cost and sounds better than stacked clones. */
+   for (i=0; i<sound_nmerge; i++) {
+      m = &sound_merge[i];
+      if (m->sound != sound)
+         continue;
+      m->count++;
+      m->px += px;
+      m->py += py;
+      m->vx += vx;
+      m->vy += vy;
+      sound_updatePos( m->voice,
+            m->px / (double)m->count, m->py / (double)m->count,
+            m->vx / (double)m->count, m->vy / (double)m->count );
+      if (sound_sys_setGain != NULL) {
+         v = voice_get( m->voice );
+         if (v != NULL) {
+            gain = sqrt( (double)m->count );
+            if (gain > SOUND_MERGE_GAIN_MAX)
+               gain = SOUND_MERGE_GAIN_MAX;
+            sound_sys_setGain( v, gain );
+         }
+      }
+      return m->voice;
+   }
+
+   /* At the concurrency cap the farthest instance gets stolen; if this
+    * one is the farthest it's dropped instead. */
+   if ((s->playing >= SOUND_MAX_INSTANCES) && voice_steal( sound, dist2 ))
+      return 0;
+
+   /* Gets a new voice. */
+   v = voice_new();
+
    /* Try to play the sound. */
    if (sound_sys_playPos( v, s, px, py, vx, vy ))
       return -1;
 
    /* Actually add the voice to the list. */
+   COUNT_INC( COUNT_SOUND );
    v->state = VOICE_PLAYING;
    v->id = ++voice_genid;
+   v->sound = sound;
+   v->dist2 = dist2;
+   s->playing++;
    voice_add(v);
 
+   /* Track it so identical repeats this frame merge into this voice. */
+   if (sound_nmerge < SOUND_MERGE_MAX) {
+      m = &sound_merge[ sound_nmerge++ ];
+      m->sound = sound;
+      m->voice = v->id;
+      m->count = 1;
+      m->px    = px;
+      m->py    = py;
+      m->vx    = vx;
+      m->vy    = vy;
+   }
+
    return v->id;
 }
 
 
+/**
+ * @brief Stops the least audible instance of a sound to make room.
+ *
+ *    @param sound Sound needing a free slot.
+ *    @param dist2 Squared listener distance of the new instance.
+ *    @return 0 if a voice was freed, -1 if the new instance loses.
+ */
+static int voice_steal( int sound, double dist2 )
+{
+   alVoice *v, *worst;
+
+   voiceLock();
+
+   /* Find the farthest playing instance. */
+   worst = NULL;
+   for (v=voice_active; v!=NULL; v=v->next)
+      if ((v->sound == sound) && (v->state == VOICE_PLAYING) &&
+            ((worst == NULL) || (v->dist2 > worst->dist2)))
+         worst = v;
+
+   /* New instance is the least audible, drop it. */
+   if ((worst == NULL) || (worst->dist2 <= dist2)) {
+      voiceUnlock();
+      return -1;
+   }
+
+   /* Stop the victim; sound_update() recycles it. */
+   sound_sys_stop( worst );
+   worst->state = VOICE_STOPPED;
+   worst->sound = -1;
+   sound_list[sound].playing--;
+
+   voiceUnlock();
+   return 0;
+}
+
+
 /**
  * @brief Updates the position of a voice.
  *
@@ -433,6 +592,9 @@ int sound_updatePos( int voice, double px, double py, double vx, double vy )
       /* Update the voice. */
       if (sound_sys_updatePos( v, px, py, vx, vy))
          return -1;
+
+      /* Keep the stealing priority current. */
+      v->dist2 = pow2(px - listener_x) + pow2(py - listener_y);
    }
 
    return 0;
@@ -454,6 +616,9 @@ int sound_update( double dt )
    if (sound_disabled)
       return 0;
 
+   /* New frame, stop merging into last frame's voices. */
+   sound_nmerge = 0;
+
    /* System update. */
    sound_sys_update();
 
@@ -462,6 +627,10 @@ int sound_update( double dt )
 
    voiceLock();
 
+   /* Batch the backend updates, one lock section for the whole loop. */
+   if (sound_sys_updateBegin != NULL)
+      sound_sys_updateBegin();
+
    /* The actual control loop. */
    for (v=voice_active; v!=NULL; v=v->next) {
 
@@ -471,6 +640,12 @@ int sound_update( double dt )
       /* Destroy and toss into pool. */
       if ((v->state == VOICE_STOPPED) || (v->state == VOICE_DESTROY)) {
 
+         /* Release the concurrency slot. */
+         if (v->sound >= 0) {
+            sound_list[v->sound].playing--;
+            v->sound = -1;
+         }
+
          /* Remove from active list. */
          tv = v->prev;
          if (tv == NULL) {
@@ -498,6 +673,9 @@ int sound_update( double dt )
       }
    }
 
+   if (sound_sys_updateEnd != NULL)
+      sound_sys_updateEnd();
+
    voiceUnlock();
 
    return 0;
@@ -567,6 +745,10 @@ int sound_updateListener( double dir, double px, double py,
    if (sound_disabled)
       return 0;
 
+   /* Remember the position for voice culling. */
+   listener_x = px;
+   listener_y = py;
+
    return sound_sys_updateListener( dir, px, py, vx, vy );
 }
 
@@ -587,6 +769,10 @@ void sound_setSpeed( double s )
 
 /**
  * @brief Makes the list of available sounds.
+ *
+ * Builds the list first and then decodes every sound across the worker
+ *  pool: the decode is pure CPU per file, the backends only lock for
+ *  the final buffer upload.
  */
 static int sound_makeList (void)
 {
@@ -595,7 +781,8 @@ static int sound_makeList (void)
    char path[PATH_MAX];
    char tmp[64];
    int len, suflen, flen;
-   int mem;
+   int n, mem;
+   SoundLoad ld;
 
    if (sound_disabled)
       return 0;
@@ -605,6 +792,7 @@ static int sound_makeList (void)
 
    /* load the profiles */
    mem = 0;
+   ld.paths = NULL;
    suflen = strlen(SOUND_SUFFIX_WAV);
    for (i=0; i<nfiles; i++) {
       flen = strlen(files[i]);
@@ -627,6 +815,7 @@ static int sound_makeList (void)
       if (sound_nlist > mem) { /* we must grow */
          mem += 32; /* we'll overallocate most likely */
          sound_list = realloc( sound_list, mem*sizeof(alSound));
+         ld.paths   = realloc( ld.paths, mem*sizeof(char*) );
       }
 
       /* remove the suffix */
@@ -634,16 +823,37 @@ static int sound_makeList (void)
       strncpy( tmp, files[i], len );
       tmp[len] = '\0';
 
-      /* Load the sound. */
+      /* Queue the sound for loading. */
       sound_list[sound_nlist-1].name = strdup(tmp);
+      sound_list[sound_nlist-1].playing = 0;
       snprintf( path, PATH_MAX, SOUND_PREFIX"%s", files[i] );
-      if (sound_load( &sound_list[sound_nlist-1], path )) {
-         sound_nlist--; /* Song not actually added. */
-      }
+      ld.paths[sound_nlist-1] = strdup(path);
 
       /* Clean up. */
       free(files[i]);
    }
+
+   /* Decode everything across the worker pool. */
+   ld.failed = calloc( sound_nlist, sizeof(int) );
+   njob_parallelFor( sound_loadRange, sound_nlist, &ld );
+
+   /* Drop whatever failed to load, keeping the order. */
+   n = 0;
+   for (len=0; len<sound_nlist; len++) {
+      if (ld.failed[len]) {
+         free( sound_list[len].name );
+         continue;
+      }
+      sound_list[n++] = sound_list[len];
+   }
+
+   /* Clean up the job data. */
+   for (len=0; len<sound_nlist; len++)
+      free( ld.paths[len] );
+   free(ld.paths);
+   free(ld.failed);
+   sound_nlist = n;
+
    /* shrink to minimum ram usage */
    sound_list = realloc( sound_list, sound_nlist*sizeof(alSound));
 
@@ -656,6 +866,25 @@ static int sound_makeList (void)
 }
 
 
+/**
+ * @brief Loads a range of the sound list, run on the worker pool.
+ *
+ *    @param start First sound to load.
+ *    @param end First sound not to load.
+ *    @param data SoundLoad with the paths and failure flags.
+ */
+static void sound_loadRange( int start, int end, void *data )
+{
+   int i;
+   SoundLoad *ld;
+
+   ld = data;
+   for (i=start; i<end; i++)
+      if (sound_load( &sound_list[i], ld->paths[i] ))
+         ld->failed[i] = 1;
+}
+
+
 /**
  * @brief Sets the volume.
  *
@@ -56,6 +56,10 @@
 #define SOUND_MAX_SOURCES     128
 #define SOUND_FADEOUT         100
 
+#define SOUND_POS_THRESHOLD   5. /**< Smallest audible position change, 1% of
+                                      the reference distance. */
+#define SOUND_VEL_THRESHOLD   5. /**< Smallest audible velocity change. */
+
 
 #define soundLock()     SDL_mutexP(sound_lock)
 #define soundUnlock()   SDL_mutexV(sound_lock)
@@ -104,8 +108,9 @@ typedef struct alGroup_s {
    int id; /**< Group ID. */
 
    /* Sources. */
-   ALuint *sources; /**< Sources in the group. */
-   int nsources; /**< Number of sources in the group. */
+   ALuint *sources; /**< Sources the group currently holds. */
+   int nsources; /**< Number of sources currently held. */
+   int size; /**< Most sources the group may hold at once. */
 
    voice_state_t state; /**< Currenty global group state. */
    int fade_timer; /**< Fadeout timer. */
@@ -142,6 +147,11 @@ static int sound_al_loadOgg( alSound *snd, OggVorbis_File *vf );
  */
 static void al_pausev( ALint n, ALuint *s );
 static void al_resumev( ALint n, ALuint *s );
+/*
+ * Groups.
+ */
+static ALuint al_groupSource( alGroup_t *g );
+static void al_groupSourceReturn( alGroup_t *g, int j );
 
 
 /*
@@ -1026,18 +1036,75 @@ int sound_al_playPos( alVoice *v, alSound *s,
 int sound_al_updatePos( alVoice *v,
             double px, double py, double vx, double vy )
 {
+   /* Skip deltas too small to hear - the uploaded values then stay
+    * within the threshold of the truth, the error does not grow. */
+   if (!(v->flags & VOICE_UPDATE) &&
+         (FABS(px - v->u.al.pos[0]) < SOUND_POS_THRESHOLD) &&
+         (FABS(py - v->u.al.pos[1]) < SOUND_POS_THRESHOLD) &&
+         (FABS(vx - v->u.al.vel[0]) < SOUND_VEL_THRESHOLD) &&
+         (FABS(vy - v->u.al.vel[1]) < SOUND_VEL_THRESHOLD))
+      return 0;
+
    v->u.al.pos[0] = px;
    v->u.al.pos[1] = py;
    v->u.al.vel[0] = vx;
    v->u.al.vel[1] = vy;
 
+   /* Gets uploaded next sound_al_updateVoice. */
+   v->flags |= VOICE_UPDATE;
+
    return 0;
 }
 
 
+/**
+ * @brief Scales a voice's gain relative to the master volume.
+ *
+ *    @param v Voice to scale.
+ *    @param gain Multiplier on the master volume.
+ *    @return 0 on success.
+ */
+int sound_al_setGain( alVoice *v, double gain )
+{
+   soundLock();
+   alSourcef( v->u.al.source, AL_GAIN, svolume * (ALfloat)gain );
+   al_checkErr();
+   soundUnlock();
+   return 0;
+}
+
+
+/**
+ * @brief Takes the OpenAL lock for a batch of voice updates.
+ *
+ * sound_update() brackets its voice loop with this and
+ *  sound_al_updateEnd() so the whole frame's source updates cross the
+ *  context lock once instead of once per voice.
+ */
+void sound_al_updateBegin (void)
+{
+   soundLock();
+}
+
+
+/**
+ * @brief Releases the OpenAL lock taken by sound_al_updateBegin().
+ */
+void sound_al_updateEnd (void)
+{
+   /* One error check for the whole batch. */
+   al_checkErr();
+
+   soundUnlock();
+}
+
+
 /**
  * @brief Updates the voice.
  *
+ * Called with the lock held, between sound_al_updateBegin() and
+ *  sound_al_updateEnd().
+ *
  *    @param v Voice to update.
  */
 void sound_al_updateVoice( alVoice *v )
@@ -1050,8 +1117,6 @@ void sound_al_updateVoice( alVoice *v )
       return;
    }
 
-   soundLock();
-
    /* Get status. */
    alGetSourcei( v->u.al.source, AL_SOURCE_STATE, &state );
    if (state == AL_STOPPED) {
@@ -1059,11 +1124,6 @@ void sound_al_updateVoice( alVoice *v )
       /* Remove buffer so it doesn't start up again if resume is called. */
       alSourcei( v->u.al.source, AL_BUFFER, AL_NONE );
 
-      /* Check for errors. */
-      al_checkErr();
-
-      soundUnlock();
-
       /* Put source back on the list. */
       source_stack[source_nstack] = v->u.al.source;
       source_nstack++;
@@ -1074,15 +1134,14 @@ void sound_al_updateVoice( alVoice *v )
       return;
    }
 
-   /* Set up properties. */
-   alSourcef(  v->u.al.source, AL_GAIN, svolume );
-   alSourcefv( v->u.al.source, AL_POSITION, v->u.al.pos );
-   alSourcefv( v->u.al.source, AL_VELOCITY, v->u.al.vel );
-
-   /* Check for errors. */
-   al_checkErr();
-
-   soundUnlock();
+   /* Only touch the source when the position actually changed, this runs
+    * every frame for every voice.  Gain is set at play time and pushed to
+    * all sources by sound_al_volume. */
+   if (v->flags & VOICE_UPDATE) {
+      alSourcefv( v->u.al.source, AL_POSITION, v->u.al.pos );
+      alSourcefv( v->u.al.source, AL_VELOCITY, v->u.al.vel );
+      v->flags &= ~VOICE_UPDATE;
+   }
 }
 
 
@@ -1252,7 +1311,7 @@ int sound_al_env( SoundEnv_t env, double param )
  */
 int sound_al_createGroup( int size )
 {
-   int i, j, id;
+   int id;
    alGroup_t *g;
 
    /* Get new ID. */
@@ -1265,44 +1324,90 @@ int sound_al_createGroup( int size )
    g->id     = id;
    g->state  = VOICE_PLAYING;
 
-   /* Allocate sources. */
+   /* Sources get borrowed from the shared pool at play time, the group
+    * only reserves the right to hold this many at once. */
    g->sources  = malloc( sizeof(ALuint) * size );
-   g->nsources = size;
-
-   /* Add some sources. */
-   for (i=0; i<size; i++) {
-      /* Make sure there's enough. */
-      if (source_nstack <= 0)
-         goto group_err;
-
-      /* Pull one off the stack. */
-      source_nstack--;
-      g->sources[i] = source_stack[source_nstack];
-
-      /* Disable EFX, they don't affect groups. */
-      if (al_info.efx_reverb == AL_TRUE) {
-         alSourcef(  g->sources[i], AL_AIR_ABSORPTION_FACTOR, 0. );
-         alSource3i( g->sources[i], AL_AUXILIARY_SEND_FILTER,
-               AL_EFFECTSLOT_NULL, 0, AL_FILTER_NULL );
-      }
+   g->nsources = 0;
+   g->size     = size;
 
-      /* Remove from total too. */
-      for (j=0; j<source_ntotal; j++) {
-         if (g->sources[i] == source_total[j]) {
-            source_ntotal--;
-            memmove( &source_total[j], &source_total[j+1],
-                  sizeof(ALuint) * (source_ntotal - j) );
-            break;
-         }
+   return id;
+}
+
+
+/**
+ * @brief Borrows a source from the shared pool for a group.
+ *
+ * Must be called with the lock held.
+ *
+ *    @param g Group borrowing the source.
+ *    @return The source or 0 if the group is full or the pool is empty.
+ */
+static ALuint al_groupSource( alGroup_t *g )
+{
+   ALuint s;
+   int j;
+
+   if ((g->nsources >= g->size) || (source_nstack <= 0))
+      return 0;
+
+   /* Pull one off the stack. */
+   source_nstack--;
+   s = source_stack[source_nstack];
+   g->sources[ g->nsources++ ] = s;
+
+   /* Disable EFX, they don't affect groups. */
+   if (al_info.efx_reverb == AL_TRUE) {
+      alSourcef(  s, AL_AIR_ABSORPTION_FACTOR, 0. );
+      alSource3i( s, AL_AUXILIARY_SEND_FILTER,
+            AL_EFFECTSLOT_NULL, 0, AL_FILTER_NULL );
+   }
+
+   /* Remove from total too. */
+   for (j=0; j<source_ntotal; j++) {
+      if (s == source_total[j]) {
+         source_ntotal--;
+         memmove( &source_total[j], &source_total[j+1],
+               sizeof(ALuint) * (source_ntotal - j) );
+         break;
       }
    }
 
-   return id;
+   return s;
+}
 
-group_err:
-   free(g->sources);
-   al_ngroups--;
-   return 0;
+
+/**
+ * @brief Returns one of a group's sources to the shared pool.
+ *
+ * Must be called with the lock held.
+ *
+ *    @param g Group holding the source.
+ *    @param j Index of the source within the group.
+ */
+static void al_groupSourceReturn( alGroup_t *g, int j )
+{
+   ALuint s;
+
+   s = g->sources[j];
+
+   /* Clear the group state off it. */
+   alSourceStop( s );
+   alSourcei( s, AL_BUFFER, AL_NONE );
+   alSourcei( s, AL_LOOPING, AL_FALSE );
+   alSourcef( s, AL_GAIN, svolume );
+
+   /* Back onto the EFX slot for the one-shot users. */
+   if (al_info.efx == AL_TRUE)
+      alSource3i( s, AL_AUXILIARY_SEND_FILTER,
+            efx_directSlot, 0, AL_FILTER_NULL );
+
+   /* Back into the pools. */
+   source_total[ source_ntotal++ ] = s;
+   source_stack[ source_nstack++ ] = s;
+
+   /* Swap remove, order within the group doesn't matter. */
+   g->nsources--;
+   g->sources[j] = g->sources[ g->nsources ];
 }
 
 
@@ -1314,56 +1419,63 @@ int sound_al_playGroup( int group, alSound *s, int once )
    int i, j;
    alGroup_t *g;
    ALint state;
+   ALuint source;
 
    for (i=0; i<al_ngroups; i++) {
-      if (al_groups[i].id == group) {
-         g = &al_groups[i];
-         g->state = VOICE_PLAYING;
-         soundLock();
-         for (j=0; j<g->nsources; j++) {
-            alGetSourcei( g->sources[j], AL_SOURCE_STATE, &state );
-          
-            /* No free ones, just smash the last one. */
-            if (j == g->nsources-1) {
-               if (state != AL_STOPPED) {
-                  alSourceStop( g->sources[j] );
-                  alSourcef( g->sources[j], AL_GAIN, svolume );
-               }
-            }
-            /* Ignore playing/paused. */
-            else if ((state == AL_PLAYING) || (state == AL_PAUSED))
-               continue;
+      if (al_groups[i].id != group)
+         continue;
 
-            /* Attach buffer. */
-            alSourcei( g->sources[j], AL_BUFFER, s->u.al.buf );
+      g = &al_groups[i];
+      g->state = VOICE_PLAYING;
+      soundLock();
+
+      /* Reuse a stopped source the group still holds. */
+      source = 0;
+      for (j=0; j<g->nsources; j++) {
+         alGetSourcei( g->sources[j], AL_SOURCE_STATE, &state );
+         if ((state != AL_PLAYING) && (state != AL_PAUSED)) {
+            source = g->sources[j];
+            break;
+         }
+      }
 
-            /* Do not do positional sound. */
-            alSourcei( g->sources[j], AL_SOURCE_RELATIVE, AL_TRUE );
+      /* Borrow a fresh one from the pool. */
+      if (source == 0)
+         source = al_groupSource( g );
 
-            /* See if should loop. */
-            alSourcei( g->sources[j], AL_LOOPING, (once) ? AL_FALSE : AL_TRUE );
+      /* No free ones, just smash the last one. */
+      if ((source == 0) && (g->nsources > 0)) {
+         source = g->sources[ g->nsources-1 ];
+         alSourceStop( source );
+         alSourcef( source, AL_GAIN, svolume );
+      }
 
-            /* Start playing. */
-            alSourcePlay( g->sources[j] );
+      if (source == 0) {
+         soundUnlock();
+         WARN("Group '%d' has no free sounds.", group );
+         return -1;
+      }
 
-            /* Check for errors. */
-            al_checkErr();
+      /* Attach buffer. */
+      alSourcei( source, AL_BUFFER, s->u.al.buf );
 
-            soundUnlock();
-            return 0;
-         }
-         soundUnlock();
+      /* Do not do positional sound. */
+      alSourcei( source, AL_SOURCE_RELATIVE, AL_TRUE );
 
-         WARN("Group '%d' has no free sounds.", group );
+      /* See if should loop. */
+      alSourcei( source, AL_LOOPING, (once) ? AL_FALSE : AL_TRUE );
 
-         /* Group matched but not found. */
-         break;
-      }
-   }
+      /* Start playing. */
+      alSourcePlay( source );
 
-   if (i>=al_ngroups)
-      WARN("Group '%d' not found.", group);
+      /* Check for errors. */
+      al_checkErr();
+
+      soundUnlock();
+      return 0;
+   }
 
+   WARN("Group '%d' not found.", group);
    return -1;
 }
 
@@ -1476,6 +1588,7 @@ void sound_al_update (void)
    int i, j;
    alGroup_t *g;
    ALfloat d;
+   ALint state;
    unsigned int t, f;
 
    t = SDL_GetTicks();
@@ -1496,14 +1609,11 @@ void sound_al_update (void)
             al_checkErr();
             soundUnlock();
          }
-         /* Fadeout done. */
+         /* Fadeout done, sources go back to the pool. */
          else {
             soundLock();
-            for (j=0; j<g->nsources; j++) {
-               alSourceStop( g->sources[j] );
-               alSourcei( g->sources[j], AL_BUFFER, AL_NONE );
-               alSourcef( g->sources[j], AL_GAIN, svolume );
-            }
+            while (g->nsources > 0)
+               al_groupSourceReturn( g, g->nsources-1 );
             /* Check for errors. */
             al_checkErr();
             soundUnlock();
@@ -1512,6 +1622,20 @@ void sound_al_update (void)
             g->state = VOICE_PLAYING;
          }
       }
+      /* Reclaim sources whose one-shots finished. */
+      else if (g->nsources > 0) {
+         soundLock();
+         for (j=0; j<g->nsources; j++) {
+            alGetSourcei( g->sources[j], AL_SOURCE_STATE, &state );
+            if (state == AL_STOPPED) {
+               al_groupSourceReturn( g, j );
+               j--;
+            }
+         }
+         /* Check for errors. */
+         al_checkErr();
+         soundUnlock();
+      }
    }
 }
 
@@ -180,8 +180,11 @@ double sound_al_getVolume (void);
 int sound_al_play( alVoice *v, alSound *s );
 int sound_al_playPos( alVoice *v, alSound *s,
       double px, double py, double vx, double vy );
+void sound_al_updateBegin (void);
+void sound_al_updateEnd (void);
 int sound_al_updatePos( alVoice *v,
       double px, double py, double vx, double vy );
+int sound_al_setGain( alVoice *v, double gain );
 void sound_al_updateVoice( alVoice *v );
 
 /*
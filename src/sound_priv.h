@@ -25,6 +25,7 @@
  */
 #define VOICE_LOOPING      (1<<10) /* voice loops */
 #define VOICE_STATIC       (1<<11) /* voice isn't relative */
+#define VOICE_UPDATE       (1<<12) /* voice position changed since last upload */
 
 
 #define MUSIC_FADEOUT_DELAY   1000 /**< Time it takes to fade out. */
@@ -39,6 +40,7 @@
 typedef struct alSound_ {
    char *name; /**< Buffer's name. */
    double length; /**< Length of the buffer. */
+   int playing; /**< Instances currently playing, for concurrency caps. */
 
    /*
     * Backend specific.
@@ -83,6 +85,8 @@ typedef struct alVoice_ {
    struct alVoice_ *next; /**< Linked list next member. */
 
    int id; /**< Identifier of the voice. */
+   int sound; /**< Index of the sound playing, -1 when none. */
+   double dist2; /**< Squared distance to the listener, for stealing. */
 
    voice_state_t state; /**< Current state of the sound. */
    unsigned int flags; /**< Voice flags. */
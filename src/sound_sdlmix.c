@@ -274,6 +274,25 @@ int sound_mix_updatePos( alVoice *v,
 }
 
 
+/**
+ * @brief Scales a voice's volume relative to the master volume.
+ *
+ *    @param v Voice to scale.
+ *    @param gain Multiplier on the master volume.
+ *    @return 0 on success.
+ */
+int sound_mix_setGain( alVoice *v, double gain )
+{
+   int vol;
+
+   vol = (int)((double)sound_mixVolume * gain);
+   if (vol > MIX_MAX_VOLUME)
+      vol = MIX_MAX_VOLUME;
+   Mix_Volume( v->u.mix.channel, vol );
+   return 0;
+}
+
+
 /**
  * @brief Pauses all the sounds.
  */
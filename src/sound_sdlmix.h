@@ -42,6 +42,7 @@ int sound_mix_playPos( alVoice *v, alSound *s,
       double px, double py, double vx, double vy );
 int sound_mix_updatePos( alVoice *v,
       double px, double py, double vx, double vy );
+int sound_mix_setGain( alVoice *v, double gain );
 void sound_mix_updateVoice( alVoice *v );
 
 /*
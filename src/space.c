@@ -19,6 +19,7 @@
 
 #include "opengl.h"
 #include "log.h"
+#include "save.h"
 #include "rng.h"
 #include "ndata.h"
 #include "player.h"
@@ -34,6 +35,11 @@
 #include "fleet.h"
 #include "mission.h"
 #include "conf.h"
+#include "strhash.h"
+#include "map.h"
+#include "simbg.h"
+#include "intern.h"
+#include "nalloc.h"
 
 
 #define XML_PLANET_ID         "Planets" /**< Planet xml document tag. */
@@ -84,6 +90,8 @@ static int systems_mstack = 0; /**< Number of memory allocated for star system s
  * Planet stack.
  */
 static Planet *planet_stack = NULL; /**< Planet stack. */
+static StrHash *planet_hash = NULL; /**< Name index of the planet stack. */
+static StrHash *system_hash = NULL; /**< Name index of the system stack. */
 static int planet_nstack = 0; /**< Planet stack size. */
 static int planet_mstack = 0; /**< Memory size of planet stack. */
 
@@ -99,6 +107,34 @@ StarSystem *cur_system = NULL; /**< Current star system. */
  */
 int space_spawn = 1; /**< Spawn enabled by default. */
 static double spawn_timer = 0; /**< Timer that controls spawn rate. */
+static int *spawn_cum = NULL; /**< Cumulative scaled fleet chances. */
+static int spawn_cumTotal = 0; /**< Roll range of the cumulative table. */
+
+/*
+ * Spawn queue.  Creating a whole fleet of pilots in one frame hitches, so
+ * space_addFleet() only computes where each pilot goes and queues it; the
+ * queue drains at a fixed budget per frame.
+ */
+#define SPAWN_QUEUE_MAX    256 /**< Pilots that can be pending at once. */
+#define SPAWN_BUDGET       2 /**< Pilots created per frame. */
+/**
+ * @struct SpawnEntry
+ *
+ * @brief A pilot waiting to be created.
+ */
+typedef struct SpawnEntry_ {
+   Fleet *fleet; /**< Fleet the pilot belongs to. */
+   FleetPilot *plt; /**< Pilot slot within the fleet. */
+   double a; /**< Direction to create with. */
+   Vector2d vp; /**< Position to create at. */
+   Vector2d vv; /**< Velocity to create with. */
+   unsigned int flags; /**< Creation flags. */
+   Pilot *p; /**< In-flight pilot, NULL until the first phase runs. */
+   int phase; /**< Creation phases completed so far. */
+} SpawnEntry;
+static SpawnEntry spawn_queue[SPAWN_QUEUE_MAX]; /**< Pending pilots. */
+static int spawn_qhead = 0; /**< Next slot to drain. */
+static int spawn_qtail = 0; /**< Next slot to fill. */
 extern int pilot_nstack;
 
 
@@ -106,16 +142,22 @@ extern int pilot_nstack;
  * star stack and friends
  */
 #define STAR_BUF  100   /**< Area to leave around screen for stars, more = less repitition */
+#define STAR_LAYERS 16  /**< Parallax layers the stars are bucketed into. */
 /**
  * @struct Star
  *
  * @brief Represents a background star. */
 static gl_vbo *star_vertexVBO = NULL; /**< Star Vertex VBO. */
 static gl_vbo *star_colourVBO = NULL; /**< Star Colour VBO. */
+static gl_vbo *star_lineVBO = NULL; /**< Star hyperspace blur line VBO. */
 static GLfloat *star_vertex = NULL; /**< Vertex of the stars. */
 static GLfloat *star_colour = NULL; /**< Brightness of the stars. */
+static GLfloat *star_lines = NULL; /**< Scratch for the hyperspace blur lines. */
 static unsigned int nstars = 0; /**< total stars */
 static unsigned int mstars = 0; /**< memory stars are taking */
+static GLfloat star_layerOff[2*STAR_LAYERS]; /**< Accumulated scroll of each layer. */
+static GLfloat star_layerDiv[STAR_LAYERS]; /**< Parallax divisor of each layer. */
+static GLuint star_layerStart[STAR_LAYERS+1]; /**< First star of each layer. */
 
 
 /*
@@ -139,7 +181,13 @@ static void system_parseJumps( const xmlNodePtr parent );
 static int system_calcSecurity( StarSystem *sys );
 static void system_setFaction( StarSystem *sys );
 static void space_addFleet( Fleet* fleet, int init );
+static void spawn_buildTable (void);
+static void spawn_push( Fleet *fleet, FleetPilot *plt, double a,
+      Vector2d *vp, Vector2d *vv, unsigned int flags );
+static void spawn_drain (void);
 static PlanetClass planetclass_get( const char a );
+/* render */
+static void space_renderLayer( unsigned int l, GLfloat ox, GLfloat oy );
 /*
  * Externed prototypes.
  */
@@ -279,6 +327,8 @@ int space_hyperspace( Pilot* p )
  * @brief Gets the name of all the planets that belong to factions.
  *
  *    @param[out] nplanets Number of planets found.
+ * The array is frame memory and must not be freed or kept.
+ *
  *    @param factions Factions to check against.
  *    @param nfactions Number of factions in factions.
  *    @return An array of faction names.  Individual names are not allocated.
@@ -291,21 +341,20 @@ char** space_getFactionPlanet( int *nplanets, int *factions, int nfactions )
    int ntmp;
    int mtmp;
 
-   ntmp = 0;
-   mtmp = CHUNK_SIZE;
-   tmp = malloc(sizeof(char*) * mtmp);
+   /* Worst case is every planet matching, so one frame allocation
+    * covers it without growing. */
+   mtmp = 0;
+   for (i=0; i<systems_nstack; i++)
+      mtmp += systems_stack[i].nplanets;
+   tmp = nalloc_frame(sizeof(char*) * mtmp);
 
+   ntmp = 0;
    for (i=0; i<systems_nstack; i++)
       for (j=0; j<systems_stack[i].nplanets; j++) {
          planet = systems_stack[i].planets[j];
          for (k=0; k<nfactions; k++)
             if (planet->faction == factions[k]) {
-               ntmp++;
-               if (ntmp > mtmp) { /* need more space */
-                  mtmp += CHUNK_SIZE;
-                  tmp = realloc(tmp, sizeof(char*) * mtmp);
-               }
-               tmp[ntmp-1] = planet->name;
+               tmp[ntmp++] = planet->name;
                break; /* no need to check all factions */
             }
       }
@@ -328,22 +377,17 @@ char* space_getRndPlanet (void)
    int mtmp;
    char *res;
 
-   ntmp = 0;
-   mtmp = CHUNK_SIZE;
-   tmp = malloc(sizeof(char*) * mtmp);
+   mtmp = 0;
+   for (i=0; i<systems_nstack; i++)
+      mtmp += systems_stack[i].nplanets;
+   tmp = nalloc_frame(sizeof(char*) * mtmp);
 
+   ntmp = 0;
    for (i=0; i<systems_nstack; i++)
-      for (j=0; j<systems_stack[i].nplanets; j++) {
-         ntmp++;
-         if (ntmp > mtmp) { /* need more space */
-            mtmp += CHUNK_SIZE;
-            tmp = realloc(tmp, sizeof(char*) * mtmp);
-         }
-         tmp[ntmp-1] = systems_stack[i].planets[j]->name;
-      }
+      for (j=0; j<systems_stack[i].nplanets; j++)
+         tmp[ntmp++] = systems_stack[i].planets[j]->name;
 
    res = tmp[RNG(0,ntmp-1)];
-   free(tmp);
 
    return res;
 }
@@ -378,6 +422,14 @@ int space_sysReachable( StarSystem *sys )
 StarSystem* system_get( const char* sysname )
 {
    int i;
+   StarSystem *sys;
+
+   /* Hash is built once loading finishes. */
+   if (system_hash != NULL) {
+      sys = strhash_get( system_hash, sysname );
+      if (sys != NULL)
+         return sys;
+   }
 
    for (i=0; i<systems_nstack; i++)
       if (strcmp(sysname, systems_stack[i].name)==0)
@@ -410,8 +462,11 @@ char* planet_getSystem( const char* planetname )
 {
    int i;
 
+   /* The stack names are interned, so one intern of the query turns the
+    * scan into pointer compares. */
+   planetname = str_intern( planetname );
    for (i=0; i<spacename_nstack; i++)
-      if (strcmp(planetname_stack[i],planetname)==0)
+      if (planetname_stack[i] == planetname)
          return systemname_stack[i];
 
    DEBUG("Planet '%s' not found in planetname stack", planetname);
@@ -428,6 +483,14 @@ char* planet_getSystem( const char* planetname )
 Planet* planet_get( const char* planetname )
 {
    int i;
+   Planet *planet;
+
+   /* Hash is built once loading finishes. */
+   if (planet_hash != NULL) {
+      planet = strhash_get( planet_hash, planetname );
+      if (planet != NULL)
+         return planet;
+   }
 
    for (i=0; i<planet_nstack; i++)
       if (strcmp(planet_stack[i].name,planetname)==0)
@@ -438,6 +501,86 @@ Planet* planet_get( const char* planetname )
 }
 
 
+/*
+ * Shop stock caching.
+ *
+ * Planets memoize the outfitter/shipyard lists the tech scan produces so
+ *  landing is a cache read instead of a full catalog scan and qsort.  The
+ *  generation counter starts above the zeroed planet fields so a fresh
+ *  planet always builds its cache, and bumping it stales every planet at
+ *  once when a unidiff retunes tech levels.
+ */
+static int space_techGen = 1; /**< Current tech generation. */
+
+
+/**
+ * @brief Rebuilds a planet's cached shop stock if it's stale.
+ *
+ *    @param p Planet to refresh.
+ */
+static void planet_refreshTech( Planet *p )
+{
+   if (p->tech_gen == space_techGen)
+      return;
+
+   if (p->tech_outfits != NULL)
+      free( p->tech_outfits );
+   if (p->tech_ships != NULL)
+      free( p->tech_ships );
+
+   p->tech_outfits = outfit_getTech( &p->tech_noutfits,
+         p->tech, PLANET_TECH_MAX );
+   p->tech_ships = ship_getTech( &p->tech_nships,
+         p->tech, PLANET_TECH_MAX );
+   p->tech_gen = space_techGen;
+}
+
+
+/**
+ * @brief Gets the planet's cached outfitter stock.
+ *
+ * The array is owned by the planet, do not free it.
+ *
+ *    @param[out] n Number of outfits in the stock.
+ *    @param p Planet to get the stock of.
+ *    @return The sorted outfit stock.
+ */
+Outfit** planet_getOutfitTech( int *n, Planet *p )
+{
+   planet_refreshTech( p );
+   *n = p->tech_noutfits;
+   return p->tech_outfits;
+}
+
+
+/**
+ * @brief Gets the planet's cached shipyard stock.
+ *
+ * The array is owned by the planet, do not free it.
+ *
+ *    @param[out] n Number of ships in the stock.
+ *    @param p Planet to get the stock of.
+ *    @return The sorted ship stock.
+ */
+Ship** planet_getShipTech( int *n, Planet *p )
+{
+   planet_refreshTech( p );
+   *n = p->tech_nships;
+   return p->tech_ships;
+}
+
+
+/**
+ * @brief Marks every planet's cached shop stock as stale.
+ *
+ * Called when tech levels change, currently only by unidiff patching.
+ */
+void space_techChanged (void)
+{
+   space_techGen++;
+}
+
+
 /**
  * @brief Controls fleet spawning.
  *
@@ -453,6 +596,8 @@ void space_update( const double dt )
    if (cur_system == NULL)
       return;
 
+   /* Coarse tick for the neighbouring systems. */
+   simbg_update( dt );
 
    /*
     * Spawning.
@@ -460,21 +605,28 @@ void space_update( const double dt )
    if (space_spawn) {
       spawn_timer -= dt;
 
+      /* Pilots queued earlier trickle in under the frame budget. */
+      spawn_drain();
+
       /* Only check if there are fleets and pilots. */
       if ((cur_system->nfleets == 0) || (cur_system->avg_pilot == 0.))
          spawn_timer = 300.;
 
       if (spawn_timer < 0.) { /* time to possibly spawn */
 
-         /* spawn chance is based on overall % */
-         f = RNG(0,100*cur_system->nfleets);
-         j = 0;
-         for (i=0; i < cur_system->nfleets; i++) {
-            j += cur_system->fleets[i].chance;
-            if (f < j) { /* add one fleet */
-               space_addFleet( cur_system->fleets[i].fleet, 0 );
-               break;
+         /* Single roll against the precomputed cumulative table. */
+         f = RNG( 0, spawn_cumTotal );
+         if (f < spawn_cum[ cur_system->nfleets-1 ]) {
+            /* Binary search for the first entry above the roll. */
+            i = 0;
+            j = cur_system->nfleets-1;
+            while (i < j) {
+               if (f < spawn_cum[ (i+j)/2 ])
+                  j = (i+j)/2;
+               else
+                  i = (i+j)/2 + 1;
             }
+            space_addFleet( cur_system->fleets[i].fleet, 0 );
          }
 
          /* Target is actually half of average pilots. */
@@ -499,12 +651,10 @@ void space_update( const double dt )
    /*
     * Volatile systems.
     */
-   if (cur_system->nebu_volatility > 0.) {
-      /* Player takes damage. */
-      if (player)
-         pilot_hit( player, NULL, 0, DAMAGE_TYPE_RADIATION,
-               pow2(cur_system->nebu_volatility) / 500. * dt );
-   }
+   if (cur_system->nebu_volatility > 0.)
+      /* Everything in the system takes damage, batched so it resolves
+       * with the frame's weapon impacts. */
+      pilots_volatilityDamage( cur_system->nebu_volatility, dt );
 
 
    /*
@@ -551,9 +701,117 @@ void space_update( const double dt )
 }
 
 
+/**
+ * @brief Builds the cumulative spawn chance table for the current system.
+ *
+ * Folds the per-fleet chance and the background-simulation presence into
+ *  one table so the respawn roll is a single RNG call and a binary
+ *  search instead of re-evaluating the fleet list.
+ */
+static void spawn_buildTable (void)
+{
+   int i, c;
+
+   if (spawn_cum != NULL) {
+      free( spawn_cum );
+      spawn_cum = NULL;
+   }
+   spawn_cumTotal = 0;
+
+   if (cur_system->nfleets == 0)
+      return;
+
+   spawn_cum = malloc( cur_system->nfleets * sizeof(int) );
+   c = 0;
+   for (i=0; i<cur_system->nfleets; i++) {
+      /* Thinned out if the fleet got mauled while we were away. */
+      c += (int)((double)cur_system->fleets[i].chance *
+            simbg_getPresence( cur_system, i ));
+      spawn_cum[i] = c;
+   }
+   /* Keep the original miss probability: the roll range stays 100 per
+    * fleet even though presence may have shrunk the table. */
+   spawn_cumTotal = 100 * cur_system->nfleets;
+}
+
+
+/**
+ * @brief Queues a pilot for creation, or creates it if the queue is full.
+ */
+static void spawn_push( Fleet *fleet, FleetPilot *plt, double a,
+      Vector2d *vp, Vector2d *vv, unsigned int flags )
+{
+   SpawnEntry *e;
+
+   if ((spawn_qtail+1) % SPAWN_QUEUE_MAX == spawn_qhead) {
+      /* Queue full, creating immediately beats losing the pilot. */
+      fleet_createPilot( fleet, plt, a, vp, vv, NULL, flags );
+      return;
+   }
+
+   e = &spawn_queue[ spawn_qtail ];
+   e->fleet = fleet;
+   e->plt   = plt;
+   e->a     = a;
+   vectcpy( &e->vp, vp );
+   vectcpy( &e->vv, vv );
+   e->flags = flags;
+   e->p     = NULL;
+   e->phase = 0;
+   spawn_qtail = (spawn_qtail+1) % SPAWN_QUEUE_MAX;
+}
+
+
+/**
+ * @brief Runs up to SPAWN_BUDGET pilot creation phase steps.
+ *
+ * Creation is three phases -- allocate/copy, equip, AI init -- and the
+ *  head pilot advances one phase per step, entering the pilot stack only
+ *  when the last phase completes.
+ */
+static void spawn_drain (void)
+{
+   int n;
+   SpawnEntry *e;
+   const char *ai;
+
+   n = 0;
+   while ((spawn_qhead != spawn_qtail) && (n < SPAWN_BUDGET)) {
+      e = &spawn_queue[ spawn_qhead ];
+
+      switch (e->phase) {
+         case 0: /* Allocation and base state. */
+            e->p = pilot_createBegin( e->plt->ship, e->plt->name,
+                  e->fleet->faction, e->a, &e->vp, &e->vv, e->flags );
+            if (e->p == NULL) { /* Drop the pilot, allocation failed. */
+               spawn_qhead = (spawn_qhead+1) % SPAWN_QUEUE_MAX;
+               break;
+            }
+            e->phase = 1;
+            break;
+
+         case 1: /* Outfits and stats. */
+            pilot_createEquip( e->p );
+            e->phase = 2;
+            break;
+
+         case 2: /* AI state, pilot goes live. */
+            ai = (e->plt->ai != NULL) ? e->plt->ai : e->fleet->ai;
+            pilot_createFinish( e->p, ai );
+            spawn_qhead = (spawn_qhead+1) % SPAWN_QUEUE_MAX;
+            break;
+      }
+      n++;
+   }
+}
+
+
 /**
  * @brief Creates a fleet.
  *
+ * Pilots don't get created here, they get queued and trickle in through
+ *  spawn_drain() so a big fleet doesn't hitch the frame.
+ *
  *    @param fleet Fleet to add to the system.
  *    @param init Is being run during the space initialization.
  */
@@ -614,7 +872,7 @@ static void space_addFleet( Fleet* fleet, int init )
       }
    }
 
-   for (i=0; i < fleet->npilots; i++)
+   for (i=0; i < fleet->npilots; i++) {
       plt = &fleet->pilots[i];
       if (RNG(0,100) <= plt->chance) {
          /* other ships in the fleet should start split up */
@@ -638,9 +896,10 @@ static void space_addFleet( Fleet* fleet, int init )
             /* Put speed at half in case they start very near. */
             vect_pset( &vv, plt->ship->speed * 0.5, a );
 
-         /* Create the pilot. */
-         fleet_createPilot( fleet, plt, a, &vp, &vv, NULL, flags );
+         /* Queue the pilot. */
+         spawn_push( fleet, plt, a, &vp, &vv, flags );
       }
+   }
 }
 
 
@@ -651,8 +910,9 @@ static void space_addFleet( Fleet* fleet, int init )
  */
 void space_initStars( int n )
 {
-   unsigned int i;
+   unsigned int i, l, p;
    GLfloat w, h, hw, hh;
+   GLfloat b;
    double size;
 
    /* Calculate size. */
@@ -673,25 +933,41 @@ void space_initStars( int n )
 
    if (mstars < nstars) {
       /* Create data. */
-      star_vertex = realloc( star_vertex, nstars * sizeof(GLfloat) * 4 );
+      star_vertex = realloc( star_vertex, nstars * sizeof(GLfloat) * 2 );
       star_colour = realloc( star_colour, nstars * sizeof(GLfloat) * 8 );
+      star_lines  = realloc( star_lines,  nstars * sizeof(GLfloat) * 4 );
       mstars = nstars;
    }
-   for (i=0; i < nstars; i++) {
-      /* Set the position. */
-      star_vertex[4*i+0] = RNGF()*w - hw;
-      star_vertex[4*i+1] = RNGF()*h - hh;
-      star_vertex[4*i+2] = 0.;
-      star_vertex[4*i+3] = 0.;
-      /* Set the colour. */
-      star_colour[8*i+0] = 1.;
-      star_colour[8*i+1] = 1.;
-      star_colour[8*i+2] = 1.;
-      star_colour[8*i+3] = RNGF()*0.6 + 0.2;
-      star_colour[8*i+4] = 1.;
-      star_colour[8*i+5] = 1.;
-      star_colour[8*i+6] = 1.;
-      star_colour[8*i+7] = 0.;
+
+   /* Split the stars into parallax layers so scrolling is a per-layer
+    * translation instead of a per-star rewrite and upload every frame. */
+   p = 0;
+   for (l=0; l < STAR_LAYERS; l++) {
+      star_layerStart[l] = p;
+      p += nstars / STAR_LAYERS + ((l < nstars % STAR_LAYERS) ? 1 : 0);
+      /* Parallax divisor from the centre of the layer's brightness band. */
+      b = 0.2 + 0.6 * ((GLfloat)l + 0.5) / (GLfloat)STAR_LAYERS;
+      star_layerDiv[l] = 9. - 10.*b;
+      star_layerOff[2*l+0] = 0.;
+      star_layerOff[2*l+1] = 0.;
+   }
+   star_layerStart[STAR_LAYERS] = nstars;
+
+   for (l=0; l < STAR_LAYERS; l++) {
+      for (i=star_layerStart[l]; i < star_layerStart[l+1]; i++) {
+         /* Set the position. */
+         star_vertex[2*i+0] = RNGF()*w - hw;
+         star_vertex[2*i+1] = RNGF()*h - hh;
+         /* Set the colour, brightness within the layer's band. */
+         star_colour[8*i+0] = 1.;
+         star_colour[8*i+1] = 1.;
+         star_colour[8*i+2] = 1.;
+         star_colour[8*i+3] = 0.2 + 0.6 * ((GLfloat)l + RNGF()) / (GLfloat)STAR_LAYERS;
+         star_colour[8*i+4] = 1.;
+         star_colour[8*i+5] = 1.;
+         star_colour[8*i+6] = 1.;
+         star_colour[8*i+7] = 0.;
+      }
    }
 
    /* Destroy old VBO. */
@@ -703,12 +979,18 @@ void space_initStars( int n )
       gl_vboDestroy( star_colourVBO );
       star_colourVBO = NULL;
    }
+   if (star_lineVBO != NULL) {
+      gl_vboDestroy( star_lineVBO );
+      star_lineVBO = NULL;
+   }
 
-   /* Create now VBO. */
-   star_vertexVBO = gl_vboCreateStream(
-         nstars * sizeof(GLfloat) * 4, star_vertex );
+   /* Create now VBO.  Positions are static, only the blur lines stream. */
+   star_vertexVBO = gl_vboCreateStatic(
+         nstars * sizeof(GLfloat) * 2, star_vertex );
    star_colourVBO = gl_vboCreateStatic(
          nstars * sizeof(GLfloat) * 8, star_colour );
+   star_lineVBO = gl_vboCreateStream(
+         nstars * sizeof(GLfloat) * 4, NULL );
 }
 
 
@@ -719,12 +1001,13 @@ void space_initStars( int n )
  */
 void space_init ( const char* sysname )
 {
-   char* nt;
-   int i;
+   int i, j;
+   Planet *pnt;
 
    /* cleanup some stuff */
    player_clear(); /* clears targets */
-   pilot_clearTimers(player); /* Clear timers. */
+   if (player != NULL) /* No player in benchmark mode. */
+      pilot_clearTimers(player); /* Clear timers. */
    pilots_clean(); /* destroy all the current pilots, except player */
    weapon_clear(); /* get rid of all the weapons */
    spfx_clear(); /* get rid of the explosions */
@@ -732,7 +1015,8 @@ void space_init ( const char* sysname )
    interference_timer = 0.; /* Restart timer. */
 
    /* Must clear escorts to keep deployment sane. */
-   player_clearEscorts();
+   if (player != NULL)
+      player_clearEscorts();
 
    if ((sysname==NULL) && (cur_system==NULL))
       ERR("Cannot reinit system if there is no system previously loaded");
@@ -743,11 +1027,30 @@ void space_init ( const char* sysname )
 
       if (i>=systems_nstack)
          ERR("System %s not found in stack", sysname);
+
+      /* Planet graphics are per system; drop the old system's references
+       * so the texture LRU can reclaim them. */
+      if ((cur_system != NULL) && (cur_system != systems_stack+i)) {
+         for (j=0; j<cur_system->nplanets; j++) {
+            pnt = cur_system->planets[j];
+            if (pnt->gfx_space != NULL) {
+               gl_freeTexture( pnt->gfx_space );
+               pnt->gfx_space = NULL;
+            }
+         }
+      }
       cur_system = systems_stack+i;
 
-      nt = ntime_pretty(0);
-      player_message("Entering System %s on %s.", sysname, nt);
-      free(nt);
+      /* Load this system's planet graphics; a space_prefetch() during the
+       * hyperspace wind-up makes this a cheap GPU handoff. */
+      for (j=0; j<cur_system->nplanets; j++) {
+         pnt = cur_system->planets[j];
+         if ((pnt->gfx_space == NULL) && (pnt->gfx_spaceFile != NULL))
+            pnt->gfx_space = gl_newImage( pnt->gfx_spaceFile, OPENGL_TEX_MIPMAPS );
+      }
+
+      player_message("Entering System %s on %s.",
+            sysname, ntime_prettyRaw() );
 
       /* Handle background */
       if (cur_system->nebu_density > 0.) {
@@ -783,9 +1086,22 @@ void space_init ( const char* sysname )
    /* Update the pilot sensor range. */
    pilot_updateSensorRange();
 
-   /* set up fleets -> pilots */
+   /* Pilots queued for the previous system must not leak into this one;
+    * a half-created head pilot is not in the stack yet and gets freed by
+    * hand. */
+   if ((spawn_qhead != spawn_qtail) && (spawn_queue[spawn_qhead].phase > 0))
+      pilot_createAbort( spawn_queue[spawn_qhead].p );
+   spawn_qhead = 0;
+   spawn_qtail = 0;
+
+   /* Fold chances and presence into the cumulative spawn table. */
+   spawn_buildTable();
+
+   /* set up fleets -> pilots, scaled by what the background simulation
+    * says is left of each fleet */
    for (i=0; i < cur_system->nfleets; i++) {
-      if (RNG(0,100) <= (cur_system->fleets[i].chance/2)) /* fleet check (50% chance) */
+      if (RNG(0,100) <= (int)((double)(cur_system->fleets[i].chance/2) *
+            simbg_getPresence( cur_system, i )))
          space_addFleet( cur_system->fleets[i].fleet, 1 );
    }
 
@@ -794,6 +1110,32 @@ void space_init ( const char* sysname )
 
    /* we now know this system */
    sys_setFlag(cur_system,SYSTEM_KNOWN);
+   save_dirty(SAVE_SPACE);
+}
+
+
+/**
+ * @brief Starts decoding a system's planet graphics ahead of arrival.
+ *
+ * Called when the player begins the hyperspace wind-up so the
+ *  space_init() on the other side only uploads to the GPU instead of
+ *  hitting the disk and the image decoder.
+ *
+ *    @param sys System the player is about to jump to.
+ */
+void space_prefetch( StarSystem *sys )
+{
+   int i;
+   Planet *pnt;
+
+   if (sys == NULL)
+      return;
+
+   for (i=0; i<sys->nplanets; i++) {
+      pnt = sys->planets[i];
+      if ((pnt->gfx_space == NULL) && (pnt->gfx_spaceFile != NULL))
+         gl_prefetchImage( pnt->gfx_spaceFile, OPENGL_TEX_MIPMAPS );
+   }
 }
 
 
@@ -810,7 +1152,7 @@ static int planets_load ( void )
    xmlDocPtr doc;
 
    buf = ndata_read( PLANET_DATA, &bufsize );
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (strcmp((char*)node->name,XML_PLANET_ID)) {
@@ -882,9 +1224,11 @@ static int planet_parse( Planet *planet, const xmlNodePtr parent )
       if (xml_isNode(node,"GFX")) {
          cur = node->children;
          do {
-            if (xml_isNode(cur,"space")) { /* load space gfx */
-               planet->gfx_space = xml_parseTexture( cur,
-                     PLANET_GFX_SPACE"%s", 1, 1, OPENGL_TEX_MIPMAPS );
+            if (xml_isNode(cur,"space")) { /* store space gfx path */
+               /* Loaded when the player enters a system with the planet,
+                * see space_init() and space_prefetch(). */
+               snprintf( str, PATH_MAX, PLANET_GFX_SPACE"%s", xml_get(cur));
+               planet->gfx_spaceFile = strdup(str);
             }
             else if (xml_isNode(cur,"exterior")) { /* load land gfx */
                snprintf( str, PATH_MAX, PLANET_GFX_EXTERIOR"%s", xml_get(cur));
@@ -976,7 +1320,7 @@ static int planet_parse( Planet *planet, const xmlNodePtr parent )
  * verification
  */
 #define MELEMENT(o,s)   if (o) WARN("Planet '%s' missing '"s"' element", planet->name)
-   MELEMENT(planet->gfx_space==NULL,"GFX space");
+   MELEMENT(planet->gfx_spaceFile==NULL,"GFX space");
    MELEMENT( planet_hasService(planet,PLANET_SERVICE_LAND) &&
          planet->gfx_exterior==NULL,"GFX exterior");
    MELEMENT( planet_hasService(planet,PLANET_SERVICE_BASIC) &&
@@ -1038,11 +1382,15 @@ int system_addPlanet( StarSystem *sys, const char *planetname )
       systemname_stack = realloc(systemname_stack,
             sizeof(char*) * spacename_mstack);
    }
-   planetname_stack[spacename_nstack-1] = planet->name;
-   systemname_stack[spacename_nstack-1] = sys->name;
+   /* Interned so planet_getSystem() can compare pointers. */
+   planetname_stack[spacename_nstack-1] = (char*) str_intern( planet->name );
+   systemname_stack[spacename_nstack-1] = (char*) str_intern( sys->name );
 
    system_setFaction(sys);
 
+   /* The map bakes the faction territory. */
+   map_cacheInvalidate();
+
    /* Regenerate the economy stuff. */
    economy_refresh();
 
@@ -1101,6 +1449,9 @@ int system_rmPlanet( StarSystem *sys, const char *planetname )
 
    system_setFaction(sys);
 
+   /* The map bakes the faction territory. */
+   map_cacheInvalidate();
+
    /* Regenerate the economy stuff. */
    economy_refresh();
 
@@ -1458,10 +1809,24 @@ int space_load (void)
    /* Done loading. */
    systems_loading = 0;
 
+   /* Build the name indices, the stacks won't move any more. */
+   planet_hash = strhash_create( planet_nstack );
+   for (i=0; i<planet_nstack; i++)
+      strhash_put( planet_hash, planet_stack[i].name, &planet_stack[i] );
+   system_hash = strhash_create( systems_nstack );
+   for (i=0; i<systems_nstack; i++)
+      strhash_put( system_hash, systems_stack[i].name, &systems_stack[i] );
+
    /* Calculate system properties. */
    for (i=0; i<systems_nstack; i++)
       system_calcSecurity(&systems_stack[i]);
 
+   /* Jump graph is final, precompute the map routes. */
+   map_buildRouteCache();
+
+   /* The background simulation needs the final fleet lists. */
+   simbg_init();
+
    return 0;
 }
 
@@ -1531,7 +1896,7 @@ static int systems_load (void)
    if (buf == NULL)
       return -1;
 
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
    if (doc == NULL) {
       WARN("'%s' is not a valid XML file.", SYSTEM_DATA);
       return -1;
@@ -1638,9 +2003,10 @@ void space_renderOverlay( const double dt )
  */
 void space_renderStars( const double dt )
 {
-   unsigned int i;
+   unsigned int i, l;
    GLfloat hh, hw, h, w;
-   GLfloat x, y, m, b;
+   GLfloat x, y, m;
+   GLfloat ox, oy, wx, wy;
    GLfloat brightness;
    double z;
 
@@ -1655,6 +2021,14 @@ void space_renderStars( const double dt )
    gl_matrixPush();
       gl_matrixScale( z, z );
 
+   /* Calculate some dimensions. */
+   w  = (SCREEN_W + 2.*STAR_BUF);
+   w += conf.zoom_stars * (w / conf.zoom_min - 1.);
+   h  = (SCREEN_H + 2.*STAR_BUF);
+   h += conf.zoom_stars * (h / conf.zoom_min - 1.);
+   hw = w/2.;
+   hh = h/2.;
+
    if ((player != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
          !player_isFlag(PLAYER_CREATING) &&
          pilot_isFlag(player,PILOT_HYPERSPACE) && /* hyperspace fancy effects */
@@ -1669,18 +2043,35 @@ void space_renderStars( const double dt )
       x = m*cos(VANGLE(player->solid->vel)+M_PI);
       y = m*sin(VANGLE(player->solid->vel)+M_PI);
 
-      /* Generate lines. */
-      for (i=0; i < nstars; i++) {
-         brightness = star_colour[8*i+3];
-         star_vertex[4*i+2] = star_vertex[4*i+0] + x*brightness;
-         star_vertex[4*i+3] = star_vertex[4*i+1] + y*brightness;
+      /* Generate lines from the current scrolled positions. */
+      for (l=0; l < STAR_LAYERS; l++) {
+         ox = star_layerOff[2*l+0];
+         oy = star_layerOff[2*l+1];
+         for (i=star_layerStart[l]; i < star_layerStart[l+1]; i++) {
+            wx = star_vertex[2*i+0] + ox;
+            wy = star_vertex[2*i+1] + oy;
+            if (wx > hw)
+               wx -= w;
+            else if (wx < -hw)
+               wx += w;
+            if (wy > hh)
+               wy -= h;
+            else if (wy < -hh)
+               wy += h;
+            brightness = star_colour[8*i+3];
+            star_lines[4*i+0] = wx;
+            star_lines[4*i+1] = wy;
+            star_lines[4*i+2] = wx + x*brightness;
+            star_lines[4*i+3] = wy + y*brightness;
+         }
       }
 
       /* Draw the lines. */
-      gl_vboSubData( star_vertexVBO, 0, nstars * 4 * sizeof(GLfloat), star_vertex );
-      gl_vboActivate( star_vertexVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 0 );
+      gl_vboOrphan( star_lineVBO );
+      gl_vboSubData( star_lineVBO, 0, nstars * 4 * sizeof(GLfloat), star_lines );
+      gl_vboActivate( star_lineVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 0 );
       gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 0 );
-      glDrawArrays( GL_LINES, 0, nstars );
+      glDrawArrays( GL_LINES, 0, 2*nstars );
 
       glShadeModel(GL_FLAT);
    }
@@ -1688,43 +2079,41 @@ void space_renderStars( const double dt )
       if (!paused && (player != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
             !player_isFlag(PLAYER_CREATING)) { /* update position */
 
-         /* Calculate some dimensions. */
-         w  = (SCREEN_W + 2.*STAR_BUF);
-         w += conf.zoom_stars * (w / conf.zoom_min - 1.);
-         h  = (SCREEN_H + 2.*STAR_BUF);
-         h += conf.zoom_stars * (h / conf.zoom_min - 1.);
-         hw = w/2.;
-         hh = h/2.;
-
-         /* Calculate new star positions. */
-         for (i=0; i < nstars; i++) {
-
-            /* calculate new position */
-            b = 9. - 10.*star_colour[8*i+3];
-            star_vertex[4*i+0] = star_vertex[4*i+0] -
-               (GLfloat)player->solid->vel.x / b*(GLfloat)dt;
-            star_vertex[4*i+1] = star_vertex[4*i+1] -
-               (GLfloat)player->solid->vel.y / b*(GLfloat)dt;
+         /* Scroll each layer, positions themselves stay on the GPU. */
+         for (l=0; l < STAR_LAYERS; l++) {
+            ox = star_layerOff[2*l+0] -
+               (GLfloat)player->solid->vel.x / star_layerDiv[l]*(GLfloat)dt;
+            oy = star_layerOff[2*l+1] -
+               (GLfloat)player->solid->vel.y / star_layerDiv[l]*(GLfloat)dt;
 
             /* check boundries */
-            if (star_vertex[4*i+0] > hw)
-               star_vertex[4*i+0] -= w;
-            else if (star_vertex[4*i+0] < -hw)
-               star_vertex[4*i+0] += w;
-            if (star_vertex[4*i+1] > hh)
-               star_vertex[4*i+1] -= h;
-            else if (star_vertex[4*i+1] < -hh)
-               star_vertex[4*i+1] += h;
+            if (ox > hw)
+               ox -= w;
+            else if (ox < -hw)
+               ox += w;
+            if (oy > hh)
+               oy -= h;
+            else if (oy < -hh)
+               oy += h;
+
+            star_layerOff[2*l+0] = ox;
+            star_layerOff[2*l+1] = oy;
          }
-
-         /* Upload the data. */
-         gl_vboSubData( star_vertexVBO, 0, nstars * 4 * sizeof(GLfloat), star_vertex );
       }
 
-      /* Render. */
-      gl_vboActivate( star_vertexVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 2 * sizeof(GLfloat) );
-      gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 4 * sizeof(GLfloat) );
-      glDrawArrays( GL_POINTS, 0, nstars );
+      /* Render each layer four times so the wrap shows on every side. */
+      gl_vboActivate( star_vertexVBO, GL_VERTEX_ARRAY, 2, GL_FLOAT, 0 );
+      gl_vboActivate( star_colourVBO, GL_COLOR_ARRAY,  4, GL_FLOAT, 8 * sizeof(GLfloat) );
+      for (l=0; l < STAR_LAYERS; l++) {
+         ox = star_layerOff[2*l+0];
+         oy = star_layerOff[2*l+1];
+         wx = (ox > 0.) ? ox - w : ox + w;
+         wy = (oy > 0.) ? oy - h : oy + h;
+         space_renderLayer( l, ox, oy );
+         space_renderLayer( l, wx, oy );
+         space_renderLayer( l, ox, wy );
+         space_renderLayer( l, wx, wy );
+      }
       gl_checkErr();
    }
 
@@ -1736,18 +2125,45 @@ void space_renderStars( const double dt )
 }
 
 
+/**
+ * @brief Renders one parallax layer of stars at an offset.
+ *
+ *    @param l Layer to render.
+ *    @param ox Horizontal offset to render at.
+ *    @param oy Vertical offset to render at.
+ */
+static void space_renderLayer( unsigned int l, GLfloat ox, GLfloat oy )
+{
+   gl_matrixPush();
+      gl_matrixTranslate( ox, oy );
+   glDrawArrays( GL_POINTS, star_layerStart[l],
+         star_layerStart[l+1] - star_layerStart[l] );
+   gl_matrixPop();
+}
+
+
 /**
  * @brief Renders the current systemsplanets.
  */
 void planets_render (void)
 {
+   int i;
+   Planet *pnt;
+
    if (cur_system==NULL) return;
 
-   int i;
-   for (i=0; i < cur_system->nplanets; i++)
-      gl_blitSprite( cur_system->planets[i]->gfx_space,
-            cur_system->planets[i]->pos.x, cur_system->planets[i]->pos.y,
-            0, 0, NULL );
+   /* Batch so planets sharing a texture draw together. */
+   gl_batchBegin();
+   for (i=0; i < cur_system->nplanets; i++) {
+      pnt = cur_system->planets[i];
+
+      /* Skip planets the camera can't see. */
+      if (!gl_cameraInView( pnt->pos.x, pnt->pos.y, pnt->gfx_space->sw ))
+         continue;
+
+      gl_batchSprite( pnt->gfx_space, pnt->pos.x, pnt->pos.y, 0, 0, NULL );
+   }
+   gl_batchEnd();
 }
 
 
@@ -1758,6 +2174,21 @@ void space_exit (void)
 {
    int i;
 
+   /* Background simulation. */
+   simbg_exit();
+
+   /* Spawn table. */
+   if (spawn_cum != NULL) {
+      free( spawn_cum );
+      spawn_cum = NULL;
+   }
+
+   /* Free the name indices. */
+   strhash_destroy(planet_hash);
+   planet_hash = NULL;
+   strhash_destroy(system_hash);
+   system_hash = NULL;
+
    /* Free the names. */
    if (planetname_stack)
       free(planetname_stack);
@@ -1777,11 +2208,19 @@ void space_exit (void)
       /* graphics */
       if (planet_stack[i].gfx_space)
          gl_freeTexture(planet_stack[i].gfx_space);
+      if (planet_stack[i].gfx_spaceFile)
+         free(planet_stack[i].gfx_spaceFile);
       if (planet_stack[i].gfx_exterior)
          free(planet_stack[i].gfx_exterior);
 
       /* commodities */
       free(planet_stack[i].commodities);
+
+      /* cached shop stock */
+      if (planet_stack[i].tech_outfits)
+         free(planet_stack[i].tech_outfits);
+      if (planet_stack[i].tech_ships)
+         free(planet_stack[i].tech_ships);
    }
    free(planet_stack);
    planet_stack = NULL;
@@ -1812,6 +2251,10 @@ void space_exit (void)
       free(star_colour);
       star_colour = NULL;
    }
+   if (star_lines) {
+      free(star_lines);
+      star_lines = NULL;
+   }
    nstars = 0;
    mstars = 0;
 }
@@ -96,10 +96,16 @@ typedef struct Planet_ {
                                    (everything that and below) while
                                    tech[1-PLANET_TECH_MAX] store the
                                    "unique" tech levels (only matches */
+   Outfit **tech_outfits; /**< Cached outfitter stock, owned by the planet. */
+   int tech_noutfits; /**< Number of outfits in the cached stock. */
+   Ship **tech_ships; /**< Cached shipyard stock, owned by the planet. */
+   int tech_nships; /**< Number of ships in the cached stock. */
+   int tech_gen; /**< Tech generation the cached stocks were built against. */
    int bribed; /**< If planet has been bribed. */
 
    /* Graphics. */
-   glTexture* gfx_space; /**< graphic in space */
+   glTexture* gfx_space; /**< graphic in space, loaded per system */
+   char *gfx_spaceFile; /**< Path of the space graphic, loaded on entry */
    char *gfx_exterior; /**< Don't actually load the texture */
 } Planet;
 
@@ -158,7 +164,6 @@ typedef struct StarSystem_ {
    double avg_pilot; /**< Target amount of pilots in the system. */
 
    /* Calculated. */
-   double *prices; /**< Handles the prices in the system. */
    double security; /**< % of security in this system. */
 
    /* Markers. */
@@ -180,6 +185,7 @@ extern int space_spawn; /**< 1 if spawning is enabled. */
  */
 void space_initStars( int n );
 void space_init( const char* sysname );
+void space_prefetch( StarSystem *sys );
 int space_load (void);
 void space_exit (void);
 
@@ -189,6 +195,9 @@ void space_exit (void);
 char* planet_getSystem( const char* planetname );
 Planet* planet_get( const char* planetname );
 char planet_getClass( Planet *p );
+Outfit** planet_getOutfitTech( int *n, Planet *p ); /* borrowed, do not free */
+Ship** planet_getShipTech( int *n, Planet *p ); /* borrowed, do not free */
+void space_techChanged (void);
 
 /*
  * system adding/removing stuff.
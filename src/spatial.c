@@ -0,0 +1,350 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file spatial.c
+ *
+ * @brief Uniform spatial hash grid used as a collision broad phase.
+ *
+ * Objects are bucketed by the grid cells their bounding circle overlaps.
+ *  A query walks only the cells overlapped by the query circle, so testing
+ *  a weapon against the pilot stack stops being O(W*P) in crowded systems.
+ *
+ * The grid is meant to be rebuilt every tick: clearing is O(1) as buckets
+ *  just get their heads reset, and all memory is reused between ticks.
+ */
+
+
+#include "spatial.h"
+
+#include "naev.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+
+#define SPATIAL_BUCKETS    1024 /**< Number of hash buckets, must be a power of two. */
+#define SPATIAL_CHUNK      256 /**< Size to increase arrays with. */
+
+
+/**
+ * @brief An object inserted into the grid.
+ */
+typedef struct SpatialEntry_ {
+   void *data; /**< User data. */
+   unsigned int mark; /**< Stamp of the last query that returned it. */
+} SpatialEntry;
+
+/**
+ * @brief Links an entry into a cell's bucket.
+ */
+typedef struct SpatialNode_ {
+   int entry; /**< Index of the entry in this cell. */
+   int next; /**< Next node in the bucket or -1. */
+} SpatialNode;
+
+
+/**
+ * @struct SpatialGrid_
+ *
+ * @brief The actual grid: entries, cell nodes and bucket heads.
+ */
+struct SpatialGrid_ {
+   double cell; /**< Side of a grid cell. */
+   int head[SPATIAL_BUCKETS]; /**< First node of each bucket or -1. */
+
+   SpatialEntry *entries; /**< All inserted entries. */
+   int nentries; /**< Number of entries in use. */
+   int mentries; /**< Allocated entry space. */
+
+   SpatialNode *nodes; /**< Cell membership nodes. */
+   int nnodes; /**< Number of nodes in use. */
+   int mnodes; /**< Allocated node space. */
+
+   void **results; /**< Scratch buffer handed out by queries. */
+   int mresults; /**< Allocated result space. */
+
+   unsigned int stamp; /**< Current query stamp, for deduplication. */
+};
+
+
+/*
+ * Prototypes.
+ */
+static int spatial_hash( int cx, int cy );
+
+
+/**
+ * @brief Hashes cell coordinates into a bucket index.
+ *
+ *    @param cx X coordinate of the cell.
+ *    @param cy Y coordinate of the cell.
+ *    @return Bucket the cell maps to.
+ */
+static int spatial_hash( int cx, int cy )
+{
+   unsigned int h;
+   h = (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u;
+   return (int)(h & (SPATIAL_BUCKETS-1));
+}
+
+
+/**
+ * @brief Creates a new spatial grid.
+ *
+ *    @param cell Side of a grid cell, should be around the size of the
+ *                biggest objects that will be inserted.
+ *    @return The newly created grid.
+ */
+SpatialGrid* spatial_create( double cell )
+{
+   SpatialGrid *grid;
+
+   grid = calloc( 1, sizeof(SpatialGrid) );
+   grid->cell = cell;
+   spatial_clear( grid );
+
+   return grid;
+}
+
+
+/**
+ * @brief Frees a spatial grid.
+ *
+ *    @param grid Grid to free.
+ */
+void spatial_free( SpatialGrid *grid )
+{
+   if (grid == NULL)
+      return;
+
+   if (grid->entries != NULL)
+      free(grid->entries);
+   if (grid->nodes != NULL)
+      free(grid->nodes);
+   if (grid->results != NULL)
+      free(grid->results);
+   free(grid);
+}
+
+
+/**
+ * @brief Empties a grid without freeing its memory.
+ *
+ *    @param grid Grid to clear.
+ */
+void spatial_clear( SpatialGrid *grid )
+{
+   int i;
+
+   for (i=0; i<SPATIAL_BUCKETS; i++)
+      grid->head[i] = -1;
+   grid->nentries = 0;
+   grid->nnodes   = 0;
+}
+
+
+/**
+ * @brief Inserts an object into the grid.
+ *
+ *    @param grid Grid to insert into.
+ *    @param data User data to associate with the object.
+ *    @param x X position of the object.
+ *    @param y Y position of the object.
+ *    @param radius Bounding radius of the object.
+ */
+void spatial_insert( SpatialGrid *grid, void *data,
+      double x, double y, double radius )
+{
+   int e, b, cx, cy;
+   int cx1,cx2, cy1,cy2;
+   SpatialNode *node;
+
+   /* Add the entry. */
+   if (grid->nentries >= grid->mentries) {
+      grid->mentries += SPATIAL_CHUNK;
+      grid->entries = realloc( grid->entries,
+            grid->mentries * sizeof(SpatialEntry) );
+   }
+   e = grid->nentries++;
+   grid->entries[e].data = data;
+   grid->entries[e].mark = 0;
+
+   /* Link it into every cell its bounding circle overlaps. */
+   cx1 = (int)floor( (x-radius) / grid->cell );
+   cx2 = (int)floor( (x+radius) / grid->cell );
+   cy1 = (int)floor( (y-radius) / grid->cell );
+   cy2 = (int)floor( (y+radius) / grid->cell );
+   for (cy=cy1; cy<=cy2; cy++) {
+      for (cx=cx1; cx<=cx2; cx++) {
+         if (grid->nnodes >= grid->mnodes) {
+            grid->mnodes += SPATIAL_CHUNK;
+            grid->nodes = realloc( grid->nodes,
+                  grid->mnodes * sizeof(SpatialNode) );
+         }
+         b = spatial_hash( cx, cy );
+         node = &grid->nodes[ grid->nnodes ];
+         node->entry = e;
+         node->next  = grid->head[b];
+         grid->head[b] = grid->nnodes++;
+      }
+   }
+}
+
+
+/**
+ * @brief Gets all the objects whose cells overlap a query circle.
+ *
+ * This is a broad phase: the caller still has to narrow-phase the results,
+ *  which may include objects that are merely in neighbouring cells.
+ *
+ *    @param grid Grid to query.
+ *    @param[out] items Array of matching objects, owned by the grid and
+ *                      valid until the next query or insertion.
+ *    @param x X position of the query.
+ *    @param y Y position of the query.
+ *    @param radius Radius of the query.
+ *    @return Number of objects found.
+ */
+int spatial_query( SpatialGrid *grid, void ***items,
+      double x, double y, double radius )
+{
+   int n, i, cx, cy;
+   int cx1,cx2, cy1,cy2;
+   SpatialNode *node;
+   SpatialEntry *entry;
+
+   /* New stamp so entries spanning several cells only get returned once. */
+   grid->stamp++;
+
+   n   = 0;
+   cx1 = (int)floor( (x-radius) / grid->cell );
+   cx2 = (int)floor( (x+radius) / grid->cell );
+   cy1 = (int)floor( (y-radius) / grid->cell );
+   cy2 = (int)floor( (y+radius) / grid->cell );
+   for (cy=cy1; cy<=cy2; cy++) {
+      for (cx=cx1; cx<=cx2; cx++) {
+         for (i = grid->head[ spatial_hash(cx,cy) ]; i != -1; i = node->next) {
+            node  = &grid->nodes[i];
+            entry = &grid->entries[ node->entry ];
+
+            /* Already returned by this query. */
+            if (entry->mark == grid->stamp)
+               continue;
+            entry->mark = grid->stamp;
+
+            if (n >= grid->mresults) {
+               grid->mresults += SPATIAL_CHUNK;
+               grid->results = realloc( grid->results,
+                     grid->mresults * sizeof(void*) );
+            }
+            grid->results[n++] = entry->data;
+         }
+      }
+   }
+
+   *items = grid->results;
+   return n;
+}
+
+
+/**
+ * @brief Gets all the objects whose cells a line segment passes through.
+ *
+ * Walks the cells from the segment start outwards, so the cost is
+ *  proportional to the segment length instead of the query area.  Like
+ *  spatial_query() this is a broad phase and the caller still has to
+ *  narrow-phase the results.
+ *
+ *    @param grid Grid to query.
+ *    @param[out] items Array of matching objects, owned by the grid and
+ *                      valid until the next query or insertion.
+ *    @param x X position of the segment start.
+ *    @param y Y position of the segment start.
+ *    @param dir Direction of the segment in radians.
+ *    @param range Length of the segment.
+ *    @return Number of objects found.
+ */
+int spatial_queryLine( SpatialGrid *grid, void ***items,
+      double x, double y, double dir, double range )
+{
+   int n, i, cx, cy, ex, ey, stepx, stepy;
+   double dx, dy, tmaxx, tmaxy, tdx, tdy;
+   SpatialNode *node;
+   SpatialEntry *entry;
+
+   /* New stamp so entries spanning several cells only get returned once. */
+   grid->stamp++;
+
+   dx = cos(dir);
+   dy = sin(dir);
+
+   /* Start and end cells. */
+   cx = (int)floor( x / grid->cell );
+   cy = (int)floor( y / grid->cell );
+   ex = (int)floor( (x + dx*range) / grid->cell );
+   ey = (int)floor( (y + dy*range) / grid->cell );
+
+   /* Distance along the segment per cell crossed on each axis. */
+   stepx = (dx > 0.) ? 1 : -1;
+   stepy = (dy > 0.) ? 1 : -1;
+   tdx   = (dx != 0.) ? FABS( grid->cell / dx ) : HUGE_VAL;
+   tdy   = (dy != 0.) ? FABS( grid->cell / dy ) : HUGE_VAL;
+
+   /* Distance along the segment to the first cell boundary on each axis. */
+   if (dx > 0.)
+      tmaxx = ((double)(cx+1) * grid->cell - x) / dx;
+   else if (dx < 0.)
+      tmaxx = ((double)cx * grid->cell - x) / dx;
+   else
+      tmaxx = HUGE_VAL;
+   if (dy > 0.)
+      tmaxy = ((double)(cy+1) * grid->cell - y) / dy;
+   else if (dy < 0.)
+      tmaxy = ((double)cy * grid->cell - y) / dy;
+   else
+      tmaxy = HUGE_VAL;
+
+   /* Walk the cells from the start outwards. */
+   n = 0;
+   while (1) {
+      for (i = grid->head[ spatial_hash(cx,cy) ]; i != -1; i = node->next) {
+         node  = &grid->nodes[i];
+         entry = &grid->entries[ node->entry ];
+
+         /* Already returned by this query. */
+         if (entry->mark == grid->stamp)
+            continue;
+         entry->mark = grid->stamp;
+
+         if (n >= grid->mresults) {
+            grid->mresults += SPATIAL_CHUNK;
+            grid->results = realloc( grid->results,
+                  grid->mresults * sizeof(void*) );
+         }
+         grid->results[n++] = entry->data;
+      }
+
+      if ((cx == ex) && (cy == ey))
+         break;
+      if (tmaxx < tmaxy) {
+         if (tmaxx > range) /* past the end without hitting the end cell */
+            break;
+         cx    += stepx;
+         tmaxx += tdx;
+      }
+      else {
+         if (tmaxy > range)
+            break;
+         cy    += stepy;
+         tmaxy += tdy;
+      }
+   }
+
+   *items = grid->results;
+   return n;
+}
@@ -0,0 +1,39 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef SPATIAL_H
+#  define SPATIAL_H
+
+
+/*
+ * Opaque uniform hash grid for collision broad phases and proximity queries.
+ */
+struct SpatialGrid_;
+typedef struct SpatialGrid_ SpatialGrid;
+
+
+/*
+ * Creation/destruction.
+ */
+SpatialGrid* spatial_create( double cell );
+void spatial_free( SpatialGrid *grid );
+
+/*
+ * Population.
+ */
+void spatial_clear( SpatialGrid *grid );
+void spatial_insert( SpatialGrid *grid, void *data,
+      double x, double y, double radius );
+
+/*
+ * Queries.
+ */
+int spatial_query( SpatialGrid *grid, void ***items,
+      double x, double y, double radius );
+int spatial_queryLine( SpatialGrid *grid, void ***items,
+      double x, double y, double dir, double range );
+
+
+#endif /* SPATIAL_H */
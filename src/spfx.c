@@ -22,6 +22,7 @@
 
 #include "log.h"
 #include "pilot.h"
+#include "gui.h"
 #include "physics.h"
 #include "opengl.h"
 #include "pause.h"
@@ -29,6 +30,7 @@
 #include "ndata.h"
 #include "nxml.h"
 #include "debris.h"
+#include "array.h"
 
 
 #define SPFX_XML_ID     "spfxs" /**< XML Document tag. */
@@ -40,7 +42,7 @@
 
 #define CHUNK_SIZE      32 /**< Chunk size to allocate spfx bases. */
 
-#define SPFX_CHUNK      32 /**< chunk to alloc when needed */
+#define SPFX_MAX_LAYER  256 /**< Maximum active effects per layer. */
 
 #define SHAKE_VEL_MOD   0.0008 /**< Shake modifier. */
 
@@ -80,7 +82,7 @@ typedef struct SPFX_Base_ {
    glTexture *gfx; /**< will use each sprite as a frame */
 } SPFX_Base;
 
-static SPFX_Base *spfx_effects = NULL; /**< Total special effects. */
+static SPFX_Base *spfx_effects = NULL; /**< Total special effects, array.c vector. */
 static int spfx_neffects = 0; /**< Total number of special effects. */
 
 
@@ -90,23 +92,66 @@ static int spfx_neffects = 0; /**< Total number of special effects. */
  * @brief An actual in-game active special effect.
  */
 typedef struct SPFX_ {
-   Vector2d pos; /**< Current position. */
-   Vector2d vel; /**< Current velocity. */
+   Vector2d pos; /**< Spawn position. */
+   Vector2d vel; /**< Velocity, constant over the effect's life. */
 
    int lastframe; /**< Needed when paused */
    int effect; /**< The real effect */
 
-   double timer; /**< Time left */
+   double t0; /**< Value of sim_time at spawn. */
+   double timer; /**< Total time to live */
 } SPFX;
 
 
+/* Effects are parametric: nothing moves during the update pass, positions
+ *  are derived from the spawn conditions and the layer clock at render. */
+
+
 /* front stack is for effects on player, back is for the rest */
-static SPFX *spfx_stack_front = NULL; /**< Frontal special effect layer. */
+/* Fixed-capacity pools - effects are cosmetic so overflow just drops them,
+ *  and death order doesn't matter so removal can swap in the last slot. */
+static SPFX spfx_stack_front[SPFX_MAX_LAYER]; /**< Frontal special effect layer. */
 static int spfx_nstack_front = 0; /**< Number of special effects in front. */
-static int spfx_mstack_front = 0; /**< Memory allocated for frontal special effects. */
-static SPFX *spfx_stack_back = NULL; /**< Back special effect layer. */
+static SPFX spfx_stack_back[SPFX_MAX_LAYER]; /**< Back special effect layer. */
 static int spfx_nstack_back = 0; /**< Number of special effects in back. */
-static int spfx_mstack_back = 0; /**< Memory allocated for special effects in back. */
+
+
+/*
+ * Engine trail particles.  Emitters only write spawn events into a
+ *  fixed ring and motion is closed form from the spawn record, so a
+ *  particle costs nothing between spawn and draw.  Without vertex
+ *  shaders the integration happens while staging the point array -
+ *  one multiply-add per axis - and everything draws as a single
+ *  GL_POINTS call from a stream VBO.
+ */
+#define SPFX_TRAIL_MAX  2048 /**< Trail particle ring capacity. */
+#define SPFX_TRAIL_SIZE 3. /**< Point size of a trail particle at 1x zoom. */
+
+/**
+ * @struct SPFXTrail
+ *
+ * @brief Spawn record of a single trail particle.
+ */
+typedef struct SPFXTrail_ {
+   double x; /**< Spawn X position. */
+   double y; /**< Spawn Y position. */
+   double vx; /**< X velocity, constant over the particle's life. */
+   double vy; /**< Y velocity, constant over the particle's life. */
+   double t0; /**< Value of sim_time at spawn. */
+   double life; /**< How long the particle lives. */
+   GLfloat r; /**< Red. */
+   GLfloat g; /**< Green. */
+   GLfloat b; /**< Blue. */
+   GLfloat a; /**< Spawn alpha, fades to zero over life. */
+} SPFXTrail;
+
+static SPFXTrail trail_ring[SPFX_TRAIL_MAX]; /**< Spawn event ring. */
+static int trail_head = 0; /**< Next ring slot to write. */
+static int trail_n = 0; /**< Used slots, saturates at capacity. */
+static gl_vbo *trail_vbo = NULL; /**< Persistent stream VBO for the points. */
+static GLsizei trail_vboColourOffset = 0; /**< Offset of colour data. */
+static GLfloat trail_vertex[SPFX_TRAIL_MAX*2]; /**< Staging vertices. */
+static GLfloat trail_colour[SPFX_TRAIL_MAX*4]; /**< Staging colours. */
 
 
 /*
@@ -116,7 +161,7 @@ static int spfx_mstack_back = 0; /**< Memory allocated for special effects in ba
 static int spfx_base_parse( SPFX_Base *temp, const xmlNodePtr parent );
 static void spfx_base_free( SPFX_Base *effect );
 static void spfx_destroy( SPFX *layer, int *nlayer, int spfx );
-static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt );
+static void spfx_trail_render (void);
 /* Haptic. */
 static int spfx_hapticInit (void);
 static void spfx_hapticRumble( double mod );
@@ -146,7 +191,7 @@ static int spfx_base_parse( SPFX_Base *temp, const xmlNodePtr parent )
       xmlr_float(node, "ttl", temp->ttl);
       if (xml_isNode(node,"gfx"))
          temp->gfx = xml_parseTexture( node,
-               SPFX_GFX_PRE"%s"SPFX_GFX_SUF, 6, 5, 0 );
+               SPFX_GFX_PRE"%s"SPFX_GFX_SUF, 6, 5, OPENGL_TEX_ATLAS );
    } while (xml_nextNode(node));
 
    /* Convert from ms to s. */
@@ -209,7 +254,6 @@ int spfx_get( char* name )
  */
 int spfx_load (void)
 {
-   int mem;
    uint32_t bufsize;
    char *buf;
    xmlNodePtr node;
@@ -217,7 +261,7 @@ int spfx_load (void)
 
    /* Load and read the data. */
    buf = ndata_read( SPFX_DATA, &bufsize );
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    /* Check to see if document exists. */
    node = doc->xmlChildrenNode;
@@ -234,26 +278,25 @@ int spfx_load (void)
    }
 
    /* First pass, loads up ammunition. */
-   mem = 0;
+   spfx_effects = array_create_size( SPFX_Base, CHUNK_SIZE );
    do {
-      if (xml_isNode(node,SPFX_XML_TAG)) {
-
-         spfx_neffects++;
-         if (spfx_neffects > mem) {
-            mem += CHUNK_SIZE;
-            spfx_effects = realloc(spfx_effects, sizeof(SPFX_Base)*mem);
-         }
-         spfx_base_parse( &spfx_effects[spfx_neffects-1], node );
-      }
+      if (xml_isNode(node,SPFX_XML_TAG))
+         spfx_base_parse( &array_grow( &spfx_effects ), node );
    } while (xml_nextNode(node));
    /* Shrink back to minimum - shouldn't change ever. */
-   spfx_effects = realloc(spfx_effects, sizeof(SPFX_Base) * spfx_neffects);
+   array_shrink( &spfx_effects );
+   spfx_neffects = array_size( spfx_effects );
 
    /* Clean up. */
    xmlFreeDoc(doc);
    free(buf);
 
 
+   /* Trail particle VBO, vertices then colours. */
+   trail_vboColourOffset = sizeof(GLfloat) * 2 * SPFX_TRAIL_MAX;
+   trail_vbo = gl_vboCreateStream(
+         sizeof(GLfloat) * 6 * SPFX_TRAIL_MAX, NULL );
+
    /*
     * Now initialize force feedback.
     */
@@ -273,21 +316,21 @@ void spfx_free (void)
    /* Clean up the debris. */
    debris_cleanup();
 
-   /* get rid of all the particles and free the stacks */
+   /* get rid of all the particles */
    spfx_clear();
-   if (spfx_stack_front) free(spfx_stack_front);
-   spfx_stack_front = NULL;
-   spfx_mstack_front = 0;
-   if (spfx_stack_back) free(spfx_stack_back);
-   spfx_stack_back = NULL;
-   spfx_mstack_back = 0;
 
    /* now clear the effects */
    for (i=0; i<spfx_neffects; i++)
       spfx_base_free( &spfx_effects[i] );
-   free(spfx_effects);
+   array_free(spfx_effects);
    spfx_effects = NULL;
    spfx_neffects = 0;
+
+   /* Free the trail VBO. */
+   if (trail_vbo != NULL) {
+      gl_vboDestroy(trail_vbo);
+      trail_vbo = NULL;
+   }
 }
 
 
@@ -318,18 +361,14 @@ void spfx_add( int effect,
     * Select the Layer
     */
    if (layer == SPFX_LAYER_FRONT) { /* front layer */
-      if (spfx_mstack_front < spfx_nstack_front+1) { /* need more memory */
-         spfx_mstack_front += SPFX_CHUNK;
-         spfx_stack_front = realloc( spfx_stack_front, spfx_mstack_front*sizeof(SPFX) );
-      }
+      if (spfx_nstack_front >= SPFX_MAX_LAYER) /* pool full, drop the effect */
+         return;
       cur_spfx = &spfx_stack_front[spfx_nstack_front];
       spfx_nstack_front++;
    }
    else if (layer == SPFX_LAYER_BACK) { /* back layer */
-      if (spfx_mstack_back < spfx_nstack_back+1) { /* need more memory */
-         spfx_mstack_back += SPFX_CHUNK;
-         spfx_stack_back = realloc( spfx_stack_back, spfx_mstack_back*sizeof(SPFX) );
-      }
+      if (spfx_nstack_back >= SPFX_MAX_LAYER) /* pool full, drop the effect */
+         return;
       cur_spfx = &spfx_stack_back[spfx_nstack_back];
       spfx_nstack_back++;
    }
@@ -338,6 +377,7 @@ void spfx_add( int effect,
    cur_spfx->effect = effect;
    vect_csetmin( &cur_spfx->pos, px, py );
    vect_csetmin( &cur_spfx->vel, vx, vy );
+   cur_spfx->t0 = sim_time;
    /* Timer magic if ttl != anim */
    ttl = spfx_effects[effect].ttl;
    anim = spfx_effects[effect].anim;
@@ -348,6 +388,44 @@ void spfx_add( int effect,
 }
 
 
+/**
+ * @brief Adds an engine trail particle.
+ *
+ * Only the spawn event is recorded, the particle costs nothing until
+ *  it gets staged for drawing.  The ring overwrites its oldest slot
+ *  when full, trails are cosmetic so losing one early is harmless.
+ *
+ *    @param px X position to spawn at.
+ *    @param py Y position to spawn at.
+ *    @param vx X velocity, constant over the particle's life.
+ *    @param vy Y velocity, constant over the particle's life.
+ *    @param life How long the particle lives.
+ *    @param c Base colour.
+ *    @param alpha Spawn alpha, fades to zero over life.
+ */
+void spfx_trailAdd( double px, double py, double vx, double vy,
+      double life, const glColour *c, double alpha )
+{
+   SPFXTrail *t;
+
+   t = &trail_ring[trail_head];
+   trail_head = (trail_head+1) % SPFX_TRAIL_MAX;
+   if (trail_n < SPFX_TRAIL_MAX)
+      trail_n++;
+
+   t->x    = px;
+   t->y    = py;
+   t->vx   = vx;
+   t->vy   = vy;
+   t->t0   = sim_time;
+   t->life = life;
+   t->r    = c->r;
+   t->g    = c->g;
+   t->b    = c->b;
+   t->a    = (GLfloat) alpha;
+}
+
+
 /**
  * @brief Clears all the currently running effects.
  */
@@ -363,6 +441,10 @@ void spfx_clear (void)
    for (i=spfx_nstack_back-1; i>=0; i--)
       spfx_destroy( spfx_stack_back, &spfx_nstack_back, i );
 
+   /* Clear the trail particles. */
+   trail_head = 0;
+   trail_n    = 0;
+
    /* Clear rumble */
    shake_rad = 0.;
    shake_pos.x = shake_pos.y = 0.;
@@ -378,47 +460,9 @@ void spfx_clear (void)
  */
 static void spfx_destroy( SPFX *layer, int *nlayer, int spfx )
 {
+   /* Swap-remove, order among effects doesn't matter. */
    (*nlayer)--;
-   memmove( &layer[spfx], &layer[spfx+1], (*nlayer-spfx)*sizeof(SPFX) );
-}
-
-
-/**
- * @brief Updates all the spfx.
- *
- *    @param dt Current delta tick.
- */
-void spfx_update( const double dt )
-{
-   spfx_update_layer( spfx_stack_front, &spfx_nstack_front, dt );
-   spfx_update_layer( spfx_stack_back, &spfx_nstack_back, dt );
-}
-
-
-/**
- * @brief Updates an individual spfx.
- *
- *    @param layer Layer the spfx is on.
- *    @param nlayer Pointer to the assosciated nlayer.
- *    @param dt Current delta tick.
- */
-static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt )
-{
-   int i;
-
-   for (i=0; i<*nlayer; i++) {
-      layer[i].timer -= dt; /* less time to live */
-
-      /* time to die! */
-      if (layer[i].timer < 0.) {
-         spfx_destroy( layer, nlayer, i );
-         i--;
-         continue;
-      }
-
-      /* actually update it */
-      vect_cadd( &layer[i].pos, dt*VX(layer[i].vel), dt*VY(layer[i].vel) );
-   }
+   layer[spfx] = layer[*nlayer];
 }
 
 
@@ -649,44 +693,135 @@ void spfx_cinematic (void)
 void spfx_render( const int layer )
 {
    SPFX *spfx_stack;
-   int i, spfx_nstack;
+   int *spfx_nstack;
    SPFX_Base *effect;
+   int i;
    int sx, sy;
-   double time;
+   double time, elapsed;
+   double px, py;
 
    
    /* get the appropriate layer */
    switch (layer) {
       case SPFX_LAYER_FRONT:
          spfx_stack = spfx_stack_front;
-         spfx_nstack = spfx_nstack_front;
+         spfx_nstack = &spfx_nstack_front;
          break;
 
       case SPFX_LAYER_BACK:
          spfx_stack = spfx_stack_back;
-         spfx_nstack = spfx_nstack_back;
+         spfx_nstack = &spfx_nstack_back;
          break;
    }
 
-   /* Now render the layer */
-   for (i=spfx_nstack-1; i>=0; i--) {
+   /* Now render the layer, grouped by texture. */
+   gl_batchBegin();
+   for (i=*spfx_nstack-1; i>=0; i--) {
       effect = &spfx_effects[ spfx_stack[i].effect ];
 
       /* Simplifies */
       sx = (int)effect->gfx->sx;
       sy = (int)effect->gfx->sy;
 
+      /* Position and remaining life follow the clock parametrically. */
+      elapsed = sim_time - spfx_stack[i].t0;
+
+      /* Expired, the tail swaps in - the stack is unordered and the
+       * swapped-in slot was already visited walking downwards.  This
+       * replaces the old per-effect update pass entirely. */
+      if (elapsed > spfx_stack[i].timer) {
+         spfx_destroy( spfx_stack, spfx_nstack, i );
+         continue;
+      }
+      px = VX(spfx_stack[i].pos) + elapsed * VX(spfx_stack[i].vel);
+      py = VY(spfx_stack[i].pos) + elapsed * VY(spfx_stack[i].vel);
+
+      /* Skip effects the camera can't see, the frame is parametric in the
+       * clock so it catches up if the effect scrolls back in. */
+      if (!gl_cameraInView( px, py, effect->gfx->sw ))
+         continue;
+
       if (!paused) { /* don't calculate frame if paused */
-         time = fmod(spfx_stack[i].timer,effect->anim) / effect->anim;
+         time = fmod(spfx_stack[i].timer - elapsed, effect->anim) / effect->anim;
          spfx_stack[i].lastframe = sx * sy * MIN(time, 1.);
       }
-      
+
       /* Renders */
-      gl_blitSprite( effect->gfx, 
-            VX(spfx_stack[i].pos), VY(spfx_stack[i].pos),
+      gl_batchSprite( effect->gfx, px, py,
             spfx_stack[i].lastframe % sx,
             spfx_stack[i].lastframe / sx,
             NULL );
    }
+   gl_batchEnd();
+
+   /* Engine trails ride the back layer so they draw under the ships. */
+   if (layer == SPFX_LAYER_BACK)
+      spfx_trail_render();
+}
+
+
+/**
+ * @brief Renders all the live trail particles in one point batch.
+ *
+ * Walks the spawn ring deriving each particle's position and fade from
+ *  its record and the clock, stages the survivors into the stream VBO
+ *  and draws them with a single GL_POINTS call.
+ */
+static void spfx_trail_render (void)
+{
+   double cx,cy, gx,gy, z;
+   double elapsed, px,py;
+   SPFXTrail *t;
+   int i, p;
+
+   if (trail_n == 0)
+      return;
+
+   gl_cameraGet( &cx, &cy );
+   gui_getOffset( &gx, &gy );
+   gl_cameraZoomGet( &z );
+
+   p = 0;
+   for (i=0; i<trail_n; i++) {
+      t = &trail_ring[i];
+
+      /* Expired slots just stay in the ring until overwritten. */
+      elapsed = sim_time - t->t0;
+      if ((elapsed < 0.) || (elapsed >= t->life))
+         continue;
+
+      /* Closed form motion from the spawn record. */
+      px = t->x + elapsed * t->vx;
+      py = t->y + elapsed * t->vy;
+      if (!gl_cameraInView( px, py, SPFX_TRAIL_SIZE ))
+         continue;
+
+      trail_vertex[2*p+0] = (GLfloat)((px - cx + gx) * z);
+      trail_vertex[2*p+1] = (GLfloat)((py - cy + gy) * z);
+      trail_colour[4*p+0] = t->r;
+      trail_colour[4*p+1] = t->g;
+      trail_colour[4*p+2] = t->b;
+      trail_colour[4*p+3] = t->a * (GLfloat)(1. - elapsed / t->life);
+      p++;
+   }
+
+   if (p == 0)
+      return;
+
+   glPointSize( MAX( 1., SPFX_TRAIL_SIZE * z ) );
+
+   /* Upload and draw in one go. */
+   gl_vboOrphan( trail_vbo );
+   gl_vboSubData( trail_vbo, 0, sizeof(GLfloat) * 2*p, trail_vertex );
+   gl_vboSubData( trail_vbo, trail_vboColourOffset,
+         sizeof(GLfloat) * 4*p, trail_colour );
+   gl_vboActivateOffset( trail_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( trail_vbo, GL_COLOR_ARRAY, trail_vboColourOffset,
+         4, GL_FLOAT, 0 );
+   glDrawArrays( GL_POINTS, 0, p );
+   gl_vboDeactivate();
+   glPointSize( 1. );
+
+   gl_checkErr();
 }
 
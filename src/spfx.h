@@ -27,12 +27,13 @@ void spfx_add( const int effect,
       const double px, const double py,
       const double vx, const double vy,
       const int layer );
+void spfx_trailAdd( double px, double py, double vx, double vy,
+      double life, const glColour *c, double alpha );
 
 
 /*
  * stack mass manipulation functions
  */
-void spfx_update( const double dt );
 void spfx_render( const int layer );
 void spfx_clear (void);
 
@@ -0,0 +1,215 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file strhash.c
+ *
+ * @brief Simple chained hash table mapping strings to pointers.
+ *
+ * The name stacks (outfits, ships, systems, planets) used to be searched
+ *  with linear strcmp scans.  Mission Lua code resolves names thousands of
+ *  times when generating mission lists or entering systems, so each stack
+ *  builds one of these tables once loading finishes and lookups become O(1).
+ *
+ * Keys are borrowed, not copied, so the table must be destroyed before
+ *  whatever owns the strings frees them.
+ */
+
+
+#include "strhash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+
+/**
+ * @brief Node of a hash bucket chain.
+ */
+typedef struct StrHashNode_ {
+   const char *key; /**< Borrowed key string. */
+   void *value; /**< Value associated to the key. */
+   struct StrHashNode_ *next; /**< Next node in the same bucket. */
+} StrHashNode;
+
+/**
+ * @struct StrHash
+ *
+ * @brief The hash table itself.
+ */
+struct StrHash_ {
+   StrHashNode **buckets; /**< Bucket chain heads. */
+   int nbuckets; /**< Number of buckets, always a power of two. */
+};
+
+
+/*
+ * Prototypes.
+ */
+static unsigned int strhash_hash( const char *key );
+
+
+/**
+ * @brief Hashes a string (FNV-1a).
+ *
+ *    @param key String to hash.
+ *    @return Hash of the string.
+ */
+static unsigned int strhash_hash( const char *key )
+{
+   unsigned int hash;
+
+   hash = 2166136261U;
+   while (*key != '\0') {
+      hash ^= (unsigned char) *key++;
+      hash *= 16777619U;
+   }
+
+   return hash;
+}
+
+
+/**
+ * @brief Creates a new hash table.
+ *
+ *    @param size Rough number of entries the table will hold.
+ *    @return The new hash table.
+ */
+StrHash* strhash_create( int size )
+{
+   StrHash *h;
+
+   h = malloc( sizeof(StrHash) );
+   if (h == NULL) {
+      WARN("Out of memory");
+      return NULL;
+   }
+
+   /* Power of two number of buckets so the modulo is a mask. */
+   h->nbuckets = 16;
+   while (h->nbuckets < size)
+      h->nbuckets <<= 1;
+
+   h->buckets = calloc( h->nbuckets, sizeof(StrHashNode*) );
+   if (h->buckets == NULL) {
+      WARN("Out of memory");
+      free(h);
+      return NULL;
+   }
+
+   return h;
+}
+
+
+/**
+ * @brief Destroys a hash table.
+ *
+ * Does not touch the keys nor the values.
+ *
+ *    @param h Hash table to destroy.
+ */
+void strhash_destroy( StrHash *h )
+{
+   int i;
+   StrHashNode *node, *next;
+
+   if (h == NULL)
+      return;
+
+   for (i=0; i<h->nbuckets; i++) {
+      node = h->buckets[i];
+      while (node != NULL) {
+         next = node->next;
+         free(node);
+         node = next;
+      }
+   }
+   free(h->buckets);
+   free(h);
+}
+
+
+/**
+ * @brief Adds a key to the hash table.
+ *
+ * The key is borrowed, it is not copied.  Duplicate keys are not checked
+ *  for, the first one added wins on lookup.
+ *
+ *    @param h Hash table to add the key to.
+ *    @param key Key to add.
+ *    @param value Value to associate to the key.
+ */
+void strhash_put( StrHash *h, const char *key, void *value )
+{
+   unsigned int b;
+   StrHashNode *node;
+
+   node = malloc( sizeof(StrHashNode) );
+   if (node == NULL) {
+      WARN("Out of memory");
+      return;
+   }
+
+   b = strhash_hash(key) & (unsigned int)(h->nbuckets-1);
+   node->key   = key;
+   node->value = value;
+   node->next  = h->buckets[b];
+   h->buckets[b] = node;
+}
+
+
+/**
+ * @brief Removes a key from the hash table.
+ *
+ * Does not touch the key nor the value.  A no-op if the key is not in
+ *  the table.
+ *
+ *    @param h Hash table to remove the key from.
+ *    @param key Key to remove.
+ */
+void strhash_del( StrHash *h, const char *key )
+{
+   unsigned int b;
+   StrHashNode *node, *last;
+
+   b    = strhash_hash(key) & (unsigned int)(h->nbuckets-1);
+   last = NULL;
+   node = h->buckets[b];
+   while (node != NULL) {
+      if (strcmp(node->key, key)==0) {
+         if (last == NULL)
+            h->buckets[b] = node->next;
+         else
+            last->next = node->next;
+         free(node);
+         return;
+      }
+      last = node;
+      node = node->next;
+   }
+}
+
+
+/**
+ * @brief Looks a key up in the hash table.
+ *
+ *    @param h Hash table to look the key up in.
+ *    @param key Key to look up.
+ *    @return Value associated to the key or NULL if not found.
+ */
+void* strhash_get( const StrHash *h, const char *key )
+{
+   StrHashNode *node;
+
+   node = h->buckets[ strhash_hash(key) & (unsigned int)(h->nbuckets-1) ];
+   while (node != NULL) {
+      if (strcmp(node->key, key)==0)
+         return node->value;
+      node = node->next;
+   }
+
+   return NULL;
+}
+
@@ -0,0 +1,35 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef STRHASH_H
+#  define STRHASH_H
+
+
+/*
+ * Simple string -> pointer hash table used to index the big name stacks
+ * (outfits, ships, systems, planets) once they finish loading.
+ *
+ * Keys are borrowed, not copied, so they must outlive the table.
+ */
+struct StrHash_;
+typedef struct StrHash_ StrHash;
+
+
+/*
+ * Creation/destruction.
+ */
+StrHash* strhash_create( int size );
+void strhash_destroy( StrHash *h );
+
+/*
+ * Insertion/lookup.
+ */
+void strhash_put( StrHash *h, const char *key, void *value );
+void strhash_del( StrHash *h, const char *key );
+void* strhash_get( const StrHash *h, const char *key );
+
+
+#endif /* STRHASH_H */
+
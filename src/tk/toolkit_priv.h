@@ -10,6 +10,8 @@
 
 #include "naev.h"
 #include "log.h"
+#include "opengl_vbo.h"
+#include "strhash.h"
 
 #include "tk/widget.h"
 
@@ -61,6 +63,7 @@ typedef enum WidgetStatus_ {
 #define WGT_FLAG_CANFOCUS     (1<<0)   /**< Widget can get focus. */
 #define WGT_FLAG_RAWINPUT     (1<<1)   /**< Widget should always get raw input. */
 #define WGT_FLAG_ALWAYSMMOVE  (1<<2)   /**< Widget should always get mouse motion events. */
+#define WGT_FLAG_DYNAMIC      (1<<3)   /**< Widget re-renders every frame, parent window can't be cached. */
 #define WGT_FLAG_KILL         (1<<9)   /**< Widget should die. */
 #define wgt_setFlag(w,f)      ((w)->flags |= (f)) /**< Sets a widget flag. */
 #define wgt_rmFlag(w,f)       ((w)->flags &= ~(f)) /**< Removes a widget flag. */
@@ -163,6 +166,22 @@ typedef struct Window_ {
 
    int focus; /**< Current focused widget. */
    Widget *widgets; /**< Widget storage. */
+   StrHash *wgthash; /**< Widget name to widget lookup. */
+
+   /* Render caching. */
+   int dirty; /**< Widgets changed since the cache was captured. */
+   GLuint cache; /**< Texture holding the last rendered window contents. */
+   int cache_w; /**< Cache texture width (power of two). */
+   int cache_h; /**< Cache texture height (power of two). */
+
+   /* Baked chrome. */
+   gl_vbo *chrome_vbo; /**< Baked border/bevel geometry. */
+   GLsizei chrome_nfill; /**< Fill (triangle) vertices in the chrome VBO. */
+   GLsizei chrome_nline; /**< Outline (line) vertices in the chrome VBO. */
+   double chrome_x; /**< X position the chrome was baked at. */
+   double chrome_y; /**< Y position the chrome was baked at. */
+   double chrome_w; /**< Width the chrome was baked at. */
+   double chrome_h; /**< Height the chrome was baked at. */
 } Window;
 
 
@@ -177,6 +196,7 @@ void window_renderOverlay( Window* w );
 /* Widget stuff. */
 Widget* window_newWidget( Window* w, const char *name );
 void widget_cleanup( Widget *widget );
+void widget_dirty( Widget *wgt );
 Widget* window_getwgt( const unsigned int wid, const char* name );
 void toolkit_setPos( Window *wdw, Widget *wgt, int x, int y );
 void toolkit_nextFocus (void);
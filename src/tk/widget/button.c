@@ -93,6 +93,7 @@ void window_disableButton( const unsigned int wid, char* name )
    /* Disable button. */
    wgt->dat.btn.disabled = 1;
    wgt_rmFlag(wgt, WGT_FLAG_CANFOCUS);
+   widget_dirty(wgt);
 }
 
 
@@ -120,6 +121,7 @@ void window_enableButton( const unsigned int wid, char *name )
    /* Enable button. */
    wgt->dat.btn.disabled = 0;
    wgt_setFlag(wgt, WGT_FLAG_CANFOCUS);
+   widget_dirty(wgt);
 }
 
 
@@ -149,6 +151,7 @@ void window_buttonCaption( const unsigned int wid, char *name, char *display )
    if (wgt->dat.btn.display != NULL)
       free(wgt->dat.btn.display);
    wgt->dat.btn.display = strdup(display);
+   widget_dirty(wgt);
 }
 
 
@@ -105,6 +105,7 @@ void window_checkboxCaption( const unsigned int wid, const char *name, char *dis
    if (wgt->dat.chk.display != NULL)
       free(wgt->dat.chk.display);
    wgt->dat.chk.display = strdup(display);
+   widget_dirty(wgt);
 }
 
 
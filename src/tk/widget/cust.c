@@ -52,6 +52,7 @@ void window_addCust( const unsigned int wid,
 
    /* generic */
    wgt->type   = WIDGET_CUST;
+   wgt_setFlag(wgt, WGT_FLAG_DYNAMIC); /* Render callback draws live content. */
 
    /* specific */
    wgt->render          = cst_render;
@@ -159,6 +160,33 @@ void window_custSetClipping( const unsigned int wid, const char *name, int clip
 }
 
 
+/**
+ * @brief Changes whether a custom widget renders live content.
+ *
+ * Custom widgets default to dynamic since the toolkit can't know what
+ *  the render callback draws.  A widget whose content only changes in
+ *  response to input can disable this so the parent window's render
+ *  cache works; it must then rely on widget_dirty()/input to refresh.
+ *
+ *    @param wid Window to which widget belongs.
+ *    @param name Name of the widget.
+ *    @param dynamic If 0 the widget is considered static, otherwise it
+ *                   re-renders every frame.
+ */
+void window_custSetDynamic( const unsigned int wid, const char *name, int dynamic )
+{
+   Widget *wgt = cst_getWidget( wid, name );
+   if (wgt == NULL)
+      return;
+
+   if (dynamic)
+      wgt_setFlag(wgt, WGT_FLAG_DYNAMIC);
+   else
+      wgt_rmFlag(wgt, WGT_FLAG_DYNAMIC);
+   widget_dirty(wgt);
+}
+
+
 /**
  * @brief Sets the widget overlay.
  *
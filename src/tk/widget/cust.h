@@ -35,6 +35,7 @@ void window_addCust( const unsigned int wid,
 
 
 void window_custSetClipping( const unsigned int wid, const char *name, int clip );
+void window_custSetDynamic( const unsigned int wid, const char *name, int dynamic );
 void window_custSetOverlay( const unsigned int wid, const char *name,
       void (*renderOverlay) (double bx, double by, double bw, double bh, void* data) );
 void *window_custGetData( const unsigned int wid, const char *name );
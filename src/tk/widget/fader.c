@@ -238,6 +238,7 @@ void window_faderValue( const unsigned int wid,
 
    /* Set fader value. */
    fad_setValue(wgt, value);
+   widget_dirty(wgt);
 }
 
 
@@ -271,4 +272,5 @@ void window_faderBounds( const unsigned int wid,
 
    /* Set the value. */
    fad_setValue(wgt, wgt->dat.fad.value );
+   widget_dirty(wgt);
 }
@@ -137,6 +137,7 @@ void window_modifyImage( const unsigned int wid,
    
    /* Set the image. */
    wgt->dat.img.image = image;
+   widget_dirty(wgt);
 }
 
 
@@ -165,5 +166,6 @@ void window_imgColour( const unsigned int wid,
    
    /* Set the colour. */
    wgt->dat.img.colour = colour;
+   widget_dirty(wgt);
 }
 
@@ -78,6 +78,7 @@ void window_addImageArray( const unsigned int wid,
    wgt->mmoveevent         = iar_mmove;
    wgt_setFlag(wgt, WGT_FLAG_ALWAYSMMOVE);
    wgt->dat.iar.images     = tex;
+   wgt->dat.iar.scaled     = calloc( nelem, sizeof(glTexture*) );
    wgt->dat.iar.captions   = caption;
    wgt->dat.iar.nelements  = nelem;
    wgt->dat.iar.selected   = 0;
@@ -116,12 +117,13 @@ static void iar_getDim( Widget* iar, double *w, double *h )
  */
 static void iar_render( Widget* iar, double bx, double by )
 {
-   int i,j;
+   int i,j, jfirst;
    double x,y, w,h, xcurs,ycurs;
    double scroll_pos;
    int xelem, yelem;
    double xspace;
    glColour *c, *dc, *lc, tc;
+   glTexture *t;
    int is_selected;
    int tw;
    double d;
@@ -156,10 +158,19 @@ static void iar_render( Widget* iar, double bx, double by )
 
    /*
     * Main drawing loop.
+    *
+    * Only the rows intersecting the widget are drawn, rows scrolled past
+    *  are skipped so huge inventories don't cost render time.
     */
    toolkit_clip( x, y, iar->w, iar->h );
-   ycurs = y + iar->h + (double)SCREEN_H/2. - h + iar->dat.iar.pos;
-   for (j=0; j<yelem; j++) {
+   jfirst = (int)(iar->dat.iar.pos / h);
+   if (jfirst < 0)
+      jfirst = 0;
+   ycurs = y + iar->h + (double)SCREEN_H/2. - h + iar->dat.iar.pos - jfirst*h;
+   for (j=jfirst; j<yelem; j++) {
+      /* Row is fully below the widget, rest are too. */
+      if (ycurs + h < y + (double)SCREEN_H/2.)
+         break;
       xcurs = x + xspace + (double)SCREEN_W/2.;
       for (i=0; i<xelem; i++) {
 
@@ -174,11 +185,20 @@ static void iar_render( Widget* iar, double bx, double by )
                   ycurs-(double)SCREEN_H/2. + 2.,
                   w - 4., h - 4., &cDConsole, NULL );
 
-         /* image */
-         if (iar->dat.iar.images[j*xelem + i] != NULL)
-            gl_blitScale( iar->dat.iar.images[j*xelem + i],
+         /* image - first display swaps in a cached cell-sized icon so
+          * the full-size texture isn't rescaled every frame */
+         t = iar->dat.iar.images[j*xelem + i];
+         if (t != NULL) {
+            if ((iar->dat.iar.scaled[j*xelem + i] == NULL) &&
+                  (t->name != NULL))
+               iar->dat.iar.scaled[j*xelem + i] = gl_newScaledImage(
+                     t->name, iar->dat.iar.iw, iar->dat.iar.ih, 0 );
+            if (iar->dat.iar.scaled[j*xelem + i] != NULL)
+               t = iar->dat.iar.scaled[j*xelem + i];
+            gl_blitScale( t,
                   xcurs + 5., ycurs + gl_smallFont.h + 7.,
                   iar->dat.iar.iw, iar->dat.iar.ih, NULL );
+         }
 
          /* caption */
          gl_printMidRaw( &gl_smallFont, iar->dat.iar.iw, xcurs + 5., ycurs + 5.,
@@ -432,10 +452,13 @@ static void iar_cleanup( Widget* iar )
             free(iar->dat.iar.alts[i]);
          if (iar->dat.iar.quantity && iar->dat.iar.quantity[i])
             free(iar->dat.iar.quantity[i]);
-      }  
+         if (iar->dat.iar.scaled[i]) /* Drop reference, stays cached. */
+            gl_freeTexture(iar->dat.iar.scaled[i]);
+      }
       /* Free the arrays */
       free( iar->dat.iar.captions );
       free( iar->dat.iar.images );
+      free( iar->dat.iar.scaled );
       if (iar->dat.iar.alts)
          free(iar->dat.iar.alts);
       if (iar->dat.iar.quantity)
@@ -487,7 +510,7 @@ static void iar_scroll( Widget* iar, int direction )
  */
 static int iar_focusImage( Widget* iar, double bx, double by )
 {
-   int i,j;
+   int i,j, jfirst;
    double x,y, w,h, ycurs,xcurs;
    int xelem, xspace, yelem;
 
@@ -504,9 +527,15 @@ static int iar_focusImage( Widget* iar, double bx, double by )
    xspace = (((int)iar->w - 10) % (int)w) / (xelem + 1);
    if (bx < iar->w - 10.) {
 
-      /* Loop through elements until finding collision. */
-      ycurs = iar->h - h + iar->dat.iar.pos;
-      for (j=0; j<yelem; j++) {
+      /* Loop through visible elements until finding collision. */
+      jfirst = (int)(iar->dat.iar.pos / h);
+      if (jfirst < 0)
+         jfirst = 0;
+      ycurs = iar->h - h + iar->dat.iar.pos - jfirst*h;
+      for (j=jfirst; j<yelem; j++) {
+         /* Row is fully below the widget, rest are too. */
+         if (ycurs + h < 0.)
+            break;
          xcurs = xspace;
          for (i=0; i<xelem; i++) {
             /* Out of elements. */
@@ -672,6 +701,7 @@ int toolkit_setImageArrayOffset( const unsigned int wid, const char* name, doubl
    /* Move if needed. */
    hmax = h * (wgt->dat.iar.yelem - (int)(wgt->h / h));
    wgt->dat.iar.pos = CLAMP( 0., hmax, off );
+   widget_dirty(wgt);
 
    return 0;
 }
@@ -699,6 +729,7 @@ int toolkit_setImageArrayPos( const unsigned int wid, const char* name, int pos
       wgt->dat.iar.fptr( wgt->wdw, wgt->name );
 
    iar_centerSelected( wgt );
+   widget_dirty(wgt);
 
    return 0;
 }
@@ -729,6 +760,7 @@ int toolkit_setImageArrayAlt( const unsigned int wid, const char* name, char **a
 
    /* Set. */
    wgt->dat.iar.alts = alt;
+   widget_dirty(wgt);
    return 0;
 }
 
@@ -759,6 +791,7 @@ int toolkit_setImageArrayQuantity( const unsigned int wid, const char* name,
 
    /* Set. */
    wgt->dat.iar.quantity = quantity;
+   widget_dirty(wgt);
    return 0;
 }
 
@@ -18,6 +18,7 @@
  */
 typedef struct WidgetImageArrayData_ {
    glTexture **images; /**< Image array. */
+   glTexture **scaled; /**< Cell-sized icons, filled lazily on display. */
    char **captions; /**< Corresponding caption array. */
    char **alts; /**< Alt text when mouse over. */
    char **quantity; /**< Number in top-left corner. */
@@ -314,6 +314,7 @@ char* window_setInput( const unsigned int wid, char* name, const char *msg )
    }
 
    /* Get the value. */
+   widget_dirty(wgt);
    return wgt->dat.inp.input;
 }
 
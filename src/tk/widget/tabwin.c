@@ -58,6 +58,7 @@ unsigned int* window_addTabbedWindow( const unsigned int wid,
    
    /* specific */
    wgt_setFlag( wgt, WGT_FLAG_RAWINPUT );
+   wgt_setFlag( wgt, WGT_FLAG_DYNAMIC ); /* Embedded windows manage their own state. */
    wgt->rawevent           = tab_raw;
    wgt->render             = tab_render;
    wgt->renderOverlay      = tab_renderOverlay;
@@ -297,6 +298,7 @@ int window_tabWinSetActive( const unsigned int wid, const char *tab, int active
 
    /* Set active window. */
    wgt->dat.tab.active = active;
+   widget_dirty(wgt);
 
    /* Create event. */
    if (wgt->dat.tab.onChange != NULL)
@@ -306,6 +308,33 @@ int window_tabWinSetActive( const unsigned int wid, const char *tab, int active
 }
 
 
+/**
+ * @brief Gets the active tab.
+ *
+ *    @param wid Window to which tabbed window belongs.
+ *    @param tab Name of the tabbed window.
+ *    @return The currently active tab or -1 on error.
+ */
+int window_tabWinGetActive( const unsigned int wid, const char *tab )
+{
+   Widget *wgt = window_getwgt( wid, tab );
+
+   /* Must be found in stack. */
+   if (wgt == NULL) {
+      WARN("Widget '%s' not found", tab);
+      return -1;
+   }
+
+   /* Must be an image array. */
+   if (wgt->type != WIDGET_TABBEDWINDOW) {
+      WARN("Widget '%s' is not an image array.", tab);
+      return -1;
+   }
+
+   return wgt->dat.tab.active;
+}
+
+
 /**
  * @brief Sets the onChange function callback.
  *
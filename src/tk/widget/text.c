@@ -125,5 +125,6 @@ void window_modifyText( const unsigned int wid,
    if (wgt->dat.txt.text)
       free(wgt->dat.txt.text);
    wgt->dat.txt.text = (newstring) ?  strdup(newstring) : NULL;
+   widget_dirty(wgt);
 }
 
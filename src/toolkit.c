@@ -18,6 +18,7 @@
 #include "tk/toolkit_priv.h"
 
 #include "log.h"
+#include "nmem.h"
 #include "pause.h"
 #include "opengl.h"
 #include "input.h"
@@ -41,6 +42,7 @@ static int toolkit_delayCounter = 0; /**< Horrible hack around secondary loop. *
  */
 #define MIN_WINDOWS  3 /**< Minimum windows to prealloc. */
 static Window *windows = NULL; /**< Window linked list, not to be confused with MS windows. */
+static Window *window_wcache = NULL; /**< Last window_wget() hit. */
 static int window_dead = 0; /**< There are dead windows lying around. */
 
 
@@ -67,6 +69,15 @@ glColour* toolkit_colDark  = &cGrey30; /**< Dark outline colour. */
 static gl_vbo *toolkit_vbo; /**< Toolkit VBO. */
 static GLsizei toolkit_vboColourOffset; /**< Colour offset. */
 
+#define CHROME_FILL_MAX    96 /**< Fill vertices a chrome bake can produce. */
+#define CHROME_LINE_MAX   120 /**< Outline vertices a chrome bake can produce. */
+
+/** Corner curve of the window border, offsets from the corner. */
+static const double chrome_curve[7][2] = {
+   { 21., 0. }, { 15., 1. }, { 10., 3. }, { 6., 6. },
+   { 3., 10. }, { 1., 15. }, { 0., 21. }
+};
+
 
 /*
  * static prototypes
@@ -80,7 +91,20 @@ static int toolkit_keyEvent( Window *wdw, SDL_Event* event );
 static int toolkit_isFocusable( Widget *wgt );
 static Widget* toolkit_getFocus( Window *wdw );
 /* render */
+static int chrome_vertex( GLfloat *vtx, GLfloat *col, int n,
+      double x, double y, const glColour *c );
+static int chrome_rect( GLfloat *vtx, GLfloat *col, int n,
+      double x, double y, double rw, double rh,
+      const glColour *c, const glColour *lc );
+static int chrome_fan( GLfloat *vtx, GLfloat *col, int n, int np,
+      const double *px, const double *py, const glColour **pc );
+static void chrome_outline( double *px, double *py,
+      double x, double y, double ww, double wh, double inset );
+static void window_chromeBake( Window *w );
 static void window_renderBorder( Window* w );
+static void window_renderCached( Window *w );
+static void window_cacheCapture( Window *w );
+static int window_isDynamic( Window *w );
 /* Death. */
 static void widget_kill( Widget *wgt );
 static void window_kill( Window *wdw );
@@ -165,13 +189,14 @@ Widget* window_newWidget( Window* w, const char *name )
          wlast->next = wgt->next;
 
       /* Prepare and return this widget. */
+      strhash_del( w->wgthash, wgt->name );
       widget_cleanup(wgt);
       break;
    }
 
    /* Must grow widgets. */
    if (wgt == NULL)
-      wgt = malloc( sizeof(Widget) );
+      wgt = nmem_alloc( MEM_TOOLKIT, sizeof(Widget) );
 
    /* Sane defaults. */
    memset( wgt, 0, sizeof(Widget) );
@@ -190,6 +215,11 @@ Widget* window_newWidget( Window* w, const char *name )
    else
       wlast->next = wgt;
 
+   /* Index by name, the key is the widget's own name string. */
+   strhash_put( w->wgthash, wgt->name, wgt );
+
+   w->dirty = 1;
+
    return wgt;
 }
 
@@ -205,9 +235,14 @@ Window* window_wget( const unsigned int wid )
    Window *w;
    if (windows == NULL)
       return NULL;
+   /* Calls come in bursts against the same window, check the last hit. */
+   if ((window_wcache != NULL) && (window_wcache->id == wid))
+      return window_wcache;
    for (w = windows; w != NULL; w = w->next)
-      if (w->id == wid)
+      if (w->id == wid) {
+         window_wcache = w;
          return w;
+      }
    return NULL;
 }
 
@@ -230,9 +265,9 @@ Widget* window_getwgt( const unsigned int wid, const char* name )
       return NULL;
 
    /* Find the widget. */
-   for (wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next)
-      if (strcmp(wgt->name, name)==0)
-         return wgt;
+   wgt = strhash_get( wdw->wgthash, name );
+   if (wgt != NULL)
+      return wgt;
 
    WARN("Widget '%s' not found in window '%u'!", name, wid );
    return NULL;
@@ -315,6 +350,7 @@ void window_moveWidget( const unsigned int wid,
 
    /* Set position. */
    toolkit_setPos( wdw, wgt, x, y );
+   wdw->dirty = 1;
 }
 
 
@@ -370,7 +406,7 @@ unsigned int window_create( const char* name,
    Window *wcur, *wlast, *wdw;
 
    /* Allocate memory. */
-   wdw = malloc( sizeof(Window) );
+   wdw = nmem_alloc( MEM_TOOLKIT, sizeof(Window) );
    memset( wdw, 0, sizeof(Window) );
 
    const int wid = (++genwid); /* unique id */
@@ -379,10 +415,12 @@ unsigned int window_create( const char* name,
 
    wdw->id           = wid;
    wdw->name         = strdup(name);
+   wdw->wgthash      = strhash_create( 32 );
 
    /* Sane defaults. */
    wdw->idgen        = -1;
    wdw->focus        = -1;
+   wdw->dirty        = 1;
 
    /* Dimensions. */
    wdw->w            = (w == -1) ? SCREEN_W : (double) w;
@@ -582,6 +620,24 @@ void widget_cleanup( Widget *widget )
 }
 
 
+/**
+ * @brief Marks a widget's parent window as needing a re-render.
+ *
+ * Widgets must call this whenever their visible state changes so the
+ *  window's render cache gets refreshed.
+ *
+ *    @param wgt Widget that changed.
+ */
+void widget_dirty( Widget *wgt )
+{
+   Window *wdw;
+
+   wdw = window_wget( wgt->wdw );
+   if (wdw != NULL)
+      wdw->dirty = 1;
+}
+
+
 /**
  * @brief Helper function to automatically close the window calling it.
  *
@@ -641,7 +697,15 @@ static void window_kill( Window *wdw )
    if (wdw->close_fptr != NULL)
       wdw->close_fptr( wdw->id, wdw->name);
 
+   /* Invalidate the lookup cache. */
+   if (window_wcache == wdw)
+      window_wcache = NULL;
+
    /* Destroy the window. */
+   if (wdw->cache != 0)
+      glDeleteTextures( 1, &wdw->cache );
+   if (wdw->chrome_vbo != NULL)
+      gl_vboDestroy( wdw->chrome_vbo );
    if (wdw->name)
       free(wdw->name);
    wgt = wdw->widgets;
@@ -650,7 +714,8 @@ static void window_kill( Window *wdw )
       wgt = wgtkill->next;
       widget_kill(wgtkill);
    }
-   free(wdw);
+   strhash_destroy( wdw->wgthash );
+   nmem_free(wdw);
 
    /* Clear key repeat, since toolkit could miss the keyup event. */
    toolkit_clearKey();
@@ -676,9 +741,9 @@ int widget_exists( const unsigned int wid, const char* wgtname )
    }
 
    /* Check for widget. */
-   for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
-      if (strcmp(wgtname, wgt->name)==0)
-         return !wgt_isFlag(wgt, WGT_FLAG_KILL);
+   wgt = strhash_get( w->wgthash, wgtname );
+   if (wgt != NULL)
+      return !wgt_isFlag(wgt, WGT_FLAG_KILL);
 
    return 0;
 }
@@ -701,12 +766,7 @@ void window_destroyWidget( unsigned int wid, const char* wgtname )
       return;
 
    /* Get the widget. */
-   /* get widget. */
-   for (wgt=wdw->widgets; wgt!=NULL; wgt=wgt->next) {
-      if (strcmp(wgt->name, wgtname)==0) {
-         break;
-      }
-   }
+   wgt = strhash_get( wdw->wgthash, wgtname );
    if (wgt == NULL) {
       WARN("Widget '%s' not found in window '%s'", wgtname, wdw->name );
       return;
@@ -729,7 +789,7 @@ static void widget_kill( Widget *wgt )
 {
    /* Clean up. */
    widget_cleanup(wgt);
-   free(wgt);
+   nmem_free(wgt);
 }
 
 
@@ -943,17 +1003,117 @@ void toolkit_unclip (void)
 
 
 /**
- * @brief Renders a window border.
+ * @brief Appends one coloured vertex to a chrome bake.
+ */
+static int chrome_vertex( GLfloat *vtx, GLfloat *col, int n,
+      double x, double y, const glColour *c )
+{
+   vtx[2*n+0] = (GLfloat)x;
+   vtx[2*n+1] = (GLfloat)y;
+   col[4*n+0] = c->r;
+   col[4*n+1] = c->g;
+   col[4*n+2] = c->b;
+   col[4*n+3] = c->a;
+   return n+1;
+}
+
+
+/**
+ * @brief Appends a vertically shaded rectangle to a chrome bake.
  *
- *    @param w Window to render
+ * Same colour semantics as toolkit_drawRect() - c on the bottom edge,
+ *  lc (or c when NULL) on the top.
  */
-static void window_renderBorder( Window* w )
+static int chrome_rect( GLfloat *vtx, GLfloat *col, int n,
+      double x, double y, double rw, double rh,
+      const glColour *c, const glColour *lc )
+{
+   if (lc == NULL)
+      lc = c;
+   n = chrome_vertex( vtx, col, n, x,    y,    c );
+   n = chrome_vertex( vtx, col, n, x+rw, y,    c );
+   n = chrome_vertex( vtx, col, n, x,    y+rh, lc );
+   n = chrome_vertex( vtx, col, n, x+rw, y,    c );
+   n = chrome_vertex( vtx, col, n, x+rw, y+rh, lc );
+   n = chrome_vertex( vtx, col, n, x,    y+rh, lc );
+   return n;
+}
+
+
+/**
+ * @brief Fan-triangulates a convex polygon into a chrome bake.
+ */
+static int chrome_fan( GLfloat *vtx, GLfloat *col, int n, int np,
+      const double *px, const double *py, const glColour **pc )
 {
    int i;
-   GLfloat cx, cy;
+
+   for (i=1; i<np-1; i++) {
+      n = chrome_vertex( vtx, col, n, px[0],   py[0],   pc[0] );
+      n = chrome_vertex( vtx, col, n, px[i],   py[i],   pc[i] );
+      n = chrome_vertex( vtx, col, n, px[i+1], py[i+1], pc[i+1] );
+   }
+   return n;
+}
+
+
+/**
+ * @brief Builds the 31 vertex window outline into px/py.
+ *
+ *    @param inset Distance into the window, 0. for the outer outline.
+ */
+static void chrome_outline( double *px, double *py,
+      double x, double y, double ww, double wh, double inset )
+{
+   int i;
+   double cx, cy, cx2, cy2;
+
+   cx  = x + inset;
+   cy  = y + inset;
+   cx2 = x + ww - inset;
+   cy2 = y + wh - inset;
+
+   for (i=0; i<7; i++) { /* bottom left corner */
+      px[i] = cx + chrome_curve[i][0];
+      py[i] = cy + chrome_curve[i][1];
+   }
+   px[7] = cx; /* left waist */
+   py[7] = y + 0.6*wh;
+   for (i=0; i<7; i++) { /* top left corner */
+      px[8+i] = cx + chrome_curve[6-i][0];
+      py[8+i] = cy2 - chrome_curve[6-i][1];
+   }
+   for (i=0; i<7; i++) { /* top right corner */
+      px[15+i] = cx2 - chrome_curve[i][0];
+      py[15+i] = cy2 - chrome_curve[i][1];
+   }
+   px[22] = cx2; /* right waist */
+   py[22] = y + 0.6*wh;
+   for (i=0; i<7; i++) { /* bottom right corner */
+      px[23+i] = cx2 - chrome_curve[6-i][0];
+      py[23+i] = cy + chrome_curve[6-i][1];
+   }
+   px[30] = px[0]; /* close the loop */
+   py[30] = py[0];
+}
+
+
+/**
+ * @brief Bakes a window's border, background and bevel into its VBO.
+ *
+ * Run on first render and again whenever the window moves or resizes,
+ *  so per frame the chrome is just two draws off static geometry.
+ */
+static void window_chromeBake( Window *w )
+{
+   int i, n, nfill;
    double x, y;
+   double px[31], py[31];
+   const glColour *pc[31];
    glColour *lc, *c, *dc, *oc;
-   GLfloat vertex[31*4], colours[31*4];
+   GLfloat vtx[(CHROME_FILL_MAX+CHROME_LINE_MAX)*2];
+   GLfloat col[(CHROME_FILL_MAX+CHROME_LINE_MAX)*4];
+   GLsizei coffset;
 
    /* position */
    x = w->x - (double)SCREEN_W/2.;
@@ -965,322 +1125,110 @@ static void window_renderBorder( Window* w )
    dc = &cGrey50;
    oc = &cGrey30;
 
-   /*
-    * Case fullscreen.
-    */
+   n = 0;
    if (window_isFlag( w, WINDOW_FULLSCREEN )) {
-      /* Background. */
-      toolkit_drawRect( x, y,          w->w, 0.6*w->h, dc, c );
-      toolkit_drawRect( x, y+0.6*w->h, w->w, 0.4*w->h, c, NULL );
-      /* Name. */
-      gl_printMidRaw( &gl_defFont, w->w,
-            x + (double)SCREEN_W/2.,
-            y + w->h - 20. + (double)SCREEN_H/2.,
-            &cBlack, w->name );
-      return;
+      /* Fullscreen is just the shaded background. */
+      n = chrome_rect( vtx, col, n, x, y,          w->w, 0.6*w->h, dc, c );
+      n = chrome_rect( vtx, col, n, x, y+0.6*w->h, w->w, 0.4*w->h, c, NULL );
+      nfill = n;
    }
+   else {
+      /* Window shaded bg, main body. */
+      n = chrome_rect( vtx, col, n, x+21, y,          w->w-42., 0.6*w->h, dc, c );
+      n = chrome_rect( vtx, col, n, x+21, y+0.6*w->h, w->w-42., 0.4*w->h, c, NULL );
+
+      /* Left side. */
+      px[0] = x + 21.;
+      py[0] = y + 0.6*w->h;
+      pc[0] = c;
+      for (i=0; i<7; i++) { /* bottom corner */
+         px[1+i] = x + chrome_curve[i][0];
+         py[1+i] = y + chrome_curve[i][1];
+         pc[1+i] = dc;
+      }
+      px[8] = x;
+      py[8] = y + 0.6*w->h;
+      pc[8] = c;
+      for (i=0; i<7; i++) { /* top corner */
+         px[9+i] = x + chrome_curve[6-i][0];
+         py[9+i] = y + w->h - chrome_curve[6-i][1];
+         pc[9+i] = c;
+      }
+      n = chrome_fan( vtx, col, n, 16, px, py, pc );
+
+      /* Right side is the left mirrored. */
+      for (i=0; i<16; i++)
+         px[i] = 2.*x + w->w - px[i];
+      n = chrome_fan( vtx, col, n, 16, px, py, pc );
+      nfill = n;
+
+      /* Inner outline. */
+      chrome_outline( px, py, x, y, w->w, w->h, 1. );
+      for (i=0; i<31; i++)
+         pc[i] = (i < 7) ? c : (i < 23) ? lc : c;
+      for (i=0; i<30; i++) { /* loop as line segments */
+         n = chrome_vertex( vtx, col, n, px[i],   py[i],   pc[i] );
+         n = chrome_vertex( vtx, col, n, px[i+1], py[i+1], pc[i+1] );
+      }
 
-   /*
-    * window shaded bg
-    */
-   /* main body */
-   toolkit_drawRect( x+21, y,          w->w-42., 0.6*w->h, dc, c );
-   toolkit_drawRect( x+21, y+0.6*w->h, w->w-42., 0.4*w->h, c, NULL );
-
-   glShadeModel(GL_SMOOTH);
-   /* Both sides. */
-   gl_vboActivateOffset( toolkit_vbo, GL_COLOR_ARRAY,
-         toolkit_vboColourOffset, 4, GL_FLOAT, 0 );
-   gl_vboActivateOffset( toolkit_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
-   /* Colour is shared. */
-   colours[0] = c->r;
-   colours[1] = c->g;
-   colours[2] = c->r;
-   colours[3] = c->a;
-   for (i=0; i<7; i++) {
-      colours[4 + 4*i + 0] = dc->r;
-      colours[4 + 4*i + 1] = dc->g;
-      colours[4 + 4*i + 2] = dc->r;
-      colours[4 + 4*i + 3] = dc->a;
-   }
-   for (i=0; i<8; i++) {
-      colours[32 + 4*i + 0] = c->r;
-      colours[32 + 4*i + 1] = c->g;
-      colours[32 + 4*i + 2] = c->r;
-      colours[32 + 4*i + 3] = c->a;
-   }
-   gl_vboSubData( toolkit_vbo, toolkit_vboColourOffset,
-         sizeof(GLfloat) * 4*16, colours );
-   /* Left side vertex. */
-   cx = x;
-   cy = y;
-   vertex[0]  = cx + 21.;
-   vertex[1]  = cy + 0.6*w->h;
-   vertex[2]  = cx + 21.;
-   vertex[3]  = cy;
-   vertex[4]  = cx + 15.;
-   vertex[5]  = cy + 1.;
-   vertex[6]  = cx + 10.;
-   vertex[7]  = cy + 3.;
-   vertex[8]  = cx + 6.;
-   vertex[9]  = cy + 6.;
-   vertex[10] = cx + 3.;
-   vertex[11] = cy + 10.;
-   vertex[12] = cx + 1.;
-   vertex[13] = cy + 15.;
-   vertex[14] = cx;
-   vertex[15] = cy + 21.;
-   vertex[16] = cx;
-   vertex[17] = cy + 0.6*w->h;
-   vertex[18] = cx;
-   cy = y + w->h;
-   vertex[19] = cy - 21.;
-   vertex[20] = cx + 1.;
-   vertex[21] = cy - 15.;
-   vertex[22] = cx + 3.;
-   vertex[23] = cy - 10.;
-   vertex[24] = cx + 6.;
-   vertex[25] = cy - 6.;
-   vertex[26] = cx + 10.;
-   vertex[27] = cy - 3.;
-   vertex[28] = cx + 15.;
-   vertex[29] = cy - 1.;
-   vertex[30] = cx + 21.;
-   vertex[31] = cy;
-   gl_vboSubData( toolkit_vbo, 0, sizeof(GLfloat) * 2*16, vertex );
-   glDrawArrays( GL_POLYGON, 0, 16 );
-   /* Right side vertex. */
-   cx = x + w->w;
-   cy = y;
-   vertex[0]  = cx - 21.;
-   vertex[1]  = cy + 0.6*w->h;
-   vertex[2]  = cx - 21.;
-   vertex[3]  = cy;
-   vertex[4]  = cx - 15.;
-   vertex[5]  = cy + 1.;
-   vertex[6]  = cx - 10.;
-   vertex[7]  = cy + 3.;
-   vertex[8]  = cx - 6.;
-   vertex[9]  = cy + 6.;
-   vertex[10] = cx - 3.;
-   vertex[11] = cy + 10.;
-   vertex[12] = cx - 1.;
-   vertex[13] = cy + 15.;
-   vertex[14] = cx;
-   vertex[15] = cy + 21.;
-   vertex[16] = cx;
-   vertex[17] = cy + 0.6*w->h;
-   vertex[18] = cx;
-   cy = y + w->h;
-   vertex[19] = cy - 21.;
-   vertex[20] = cx - 1.;
-   vertex[21] = cy - 15.;
-   vertex[22] = cx - 3.;
-   vertex[23] = cy - 10.;
-   vertex[24] = cx - 6.;
-   vertex[25] = cy - 6.;
-   vertex[26] = cx - 10.;
-   vertex[27] = cy - 3.;
-   vertex[28] = cx - 15.;
-   vertex[29] = cy - 1.;
-   vertex[30] = cx - 21.;
-   vertex[31] = cy;
-   gl_vboSubData( toolkit_vbo, 0, sizeof(GLfloat) * 2*16, vertex );
-   glDrawArrays( GL_POLYGON, 0, 16 );
-
-
-   /* 
-    * inner outline
-    */
-   /* Colour. */
-   for (i=0; i<7; i++) {
-      colours[4*i + 0] = c->r;
-      colours[4*i + 1] = c->g;
-      colours[4*i + 2] = c->b;
-      colours[4*i + 3] = c->a;
-   }
-   for (; i<7+16; i++) {
-      colours[4*i + 0] = lc->r;
-      colours[4*i + 1] = lc->g;
-      colours[4*i + 2] = lc->b;
-      colours[4*i + 3] = lc->a;
-   }
-   for (; i<7+16+8; i++) {
-      colours[4*i + 0] = c->r;
-      colours[4*i + 1] = c->g;
-      colours[4*i + 2] = c->b;
-      colours[4*i + 3] = c->a;
+      /* Outer outline. */
+      chrome_outline( px, py, x, y, w->w, w->h, 0. );
+      for (i=0; i<30; i++) {
+         n = chrome_vertex( vtx, col, n, px[i],   py[i],   oc );
+         n = chrome_vertex( vtx, col, n, px[i+1], py[i+1], oc );
+      }
    }
-   gl_vboSubData( toolkit_vbo, toolkit_vboColourOffset,
-         sizeof(GLfloat) * 4*31, colours );
-   /* Vertex. */
-   /* Left side. */
-   cx = x + 1.;
-   cy = y + 1.;
-   vertex[0]  = cx + 21.;
-   vertex[1]  = cy;
-   vertex[2]  = cx + 15.;
-   vertex[3]  = cy + 1.;
-   vertex[4]  = cx + 10.;
-   vertex[5]  = cy + 3.;
-   vertex[6]  = cx + 6.;
-   vertex[7]  = cy + 6.;
-   vertex[8]  = cx + 3.;
-   vertex[9]  = cy + 10.;
-   vertex[10] = cx + 1.;
-   vertex[11] = cy + 15.;
-   vertex[12] = cx;
-   vertex[13] = cy + 21.;
-   vertex[14] = cx;
-   vertex[15] = cy + 0.6*w->h - 1.;
-   cy = y + w->h - 1.;
-   vertex[16] = cx;
-   vertex[17] = cy - 21.;
-   vertex[18] = cx + 1.;
-   vertex[19] = cy - 15.;
-   vertex[20] = cx + 3.;
-   vertex[21] = cy - 10.;
-   vertex[22] = cx + 6.;
-   vertex[23] = cy - 6.;
-   vertex[24] = cx + 10.;
-   vertex[25] = cy - 3.;
-   vertex[26] = cx + 15.;
-   vertex[27] = cy - 1.;
-   vertex[28] = cx + 21.;
-   vertex[29] = cy;
-   /* Right side via top. */
-   cx = x + w->w - 1.;
-   cy = y + w->h - 1.;
-   vertex[30] = cx - 21.;
-   vertex[31] = cy;
-   vertex[32] = cx - 15.;
-   vertex[33] = cy - 1.;
-   vertex[34] = cx - 10.;
-   vertex[35] = cy - 3.;
-   vertex[36] = cx - 6.;
-   vertex[37] = cy - 6.;
-   vertex[38] = cx - 3.;
-   vertex[39] = cy - 10.;
-   vertex[40] = cx - 1.;
-   vertex[41] = cy - 15.;
-   vertex[42] = cx;
-   vertex[43] = cy - 21.;
-   cy = y + 1.;
-   vertex[44] = cx;
-   vertex[45] = cy + 0.6*w->h - 1.;
-   vertex[46] = cx;
-   vertex[47] = cy + 21.;
-   vertex[48] = cx - 1.;
-   vertex[49] = cy + 15.;
-   vertex[50] = cx - 3.;
-   vertex[51] = cy + 10.;
-   vertex[52] = cx - 6.;
-   vertex[53] = cy + 6.;
-   vertex[54] = cx - 10.;
-   vertex[55] = cy + 3.;
-   vertex[56] = cx - 15.;
-   vertex[57] = cy + 1.;
-   vertex[58] = cx - 21.;
-   vertex[59] = cy;
-   cx = x + 1.;
-   cy = y + 1.;
-   vertex[60] = cx + 21.;
-   vertex[61] = cy;
-   gl_vboSubData( toolkit_vbo, 0, sizeof(GLfloat) * 2*31, vertex );
-   glDrawArrays( GL_LINE_LOOP, 0, 31 );
 
+   w->chrome_nfill = nfill;
+   w->chrome_nline = n - nfill;
+   w->chrome_x     = w->x;
+   w->chrome_y     = w->y;
+   w->chrome_w     = w->w;
+   w->chrome_h     = w->h;
+
+   /* (Re)upload, vertices then colours. */
+   coffset = sizeof(GLfloat) * 2*n;
+   if (w->chrome_vbo != NULL)
+      gl_vboDestroy( w->chrome_vbo );
+   w->chrome_vbo = gl_vboCreateStatic(
+         (GLsizei) sizeof(GLfloat) * (2+4)*n, NULL );
+   gl_vboSubData( w->chrome_vbo, 0, sizeof(GLfloat) * 2*n, vtx );
+   gl_vboSubData( w->chrome_vbo, coffset, sizeof(GLfloat) * 4*n, col );
+}
 
-   /*
-    * outter outline
-    */
-   glShadeModel(GL_FLAT);
-   /* Colour. */
-   for (i=0; i<31; i++) {
-      colours[4*i + 0] = oc->r;
-      colours[4*i + 1] = oc->g;
-      colours[4*i + 2] = oc->b;
-      colours[4*i + 3] = oc->a;
-   }
-   gl_vboSubData( toolkit_vbo, toolkit_vboColourOffset,
-         sizeof(GLfloat) * 4*31, colours );
-   /* Vertex. */
-   /* Left side. */
-   cx = x;
-   cy = y;
-   vertex[0]  = cx + 21.;
-   vertex[1]  = cy;
-   vertex[2]  = cx + 15.;
-   vertex[3]  = cy + 1.;
-   vertex[4]  = cx + 10.;
-   vertex[5]  = cy + 3.;
-   vertex[6]  = cx + 6.;
-   vertex[7]  = cy + 6.;
-   vertex[8]  = cx + 3.;
-   vertex[9]  = cy + 10.;
-   vertex[10] = cx + 1.;
-   vertex[11] = cy + 15.;
-   vertex[12] = cx;
-   vertex[13] = cy + 21.;
-   vertex[14] = cx;
-   vertex[15] = cy + 0.6*w->h;
-   cy = y + w->h;
-   vertex[16] = cx;
-   vertex[17] = cy - 21.;
-   vertex[18] = cx + 1.;
-   vertex[19] = cy - 15.;
-   vertex[20] = cx + 3.;
-   vertex[21] = cy - 10.;
-   vertex[22] = cx + 6.;
-   vertex[23] = cy - 6.;
-   vertex[24] = cx + 10.;
-   vertex[25] = cy - 3.;
-   vertex[26] = cx + 15.;
-   vertex[27] = cy - 1.;
-   vertex[28] = cx + 21.;
-   vertex[29] = cy;
-   /* Right side via top. */
-   cx = x + w->w;
-   cy = y + w->h;
-   vertex[30] = cx - 21.;
-   vertex[31] = cy;
-   vertex[32] = cx - 15.;
-   vertex[33] = cy - 1.;
-   vertex[34] = cx - 10.;
-   vertex[35] = cy - 3.;
-   vertex[36] = cx - 6.;
-   vertex[37] = cy - 6.;
-   vertex[38] = cx - 3.;
-   vertex[39] = cy - 10.;
-   vertex[40] = cx - 1.;
-   vertex[41] = cy - 15.;
-   vertex[42] = cx;
-   vertex[43] = cy - 21.;
-   cy = y;
-   vertex[44] = cx;
-   vertex[45] = cy + 0.6*w->h;
-   vertex[46] = cx;
-   vertex[47] = cy + 21.;
-   vertex[48] = cx - 1.;
-   vertex[49] = cy + 15.;
-   vertex[50] = cx - 3.;
-   vertex[51] = cy + 10.;
-   vertex[52] = cx - 6.;
-   vertex[53] = cy + 6.;
-   vertex[54] = cx - 10.;
-   vertex[55] = cy + 3.;
-   vertex[56] = cx - 15.;
-   vertex[57] = cy + 1.;
-   vertex[58] = cx - 21.;
-   vertex[59] = cy;
-   cx = x;
-   cy = y;
-   vertex[60] = cx + 21.;
-   vertex[61] = cy;
-   gl_vboSubData( toolkit_vbo, 0, sizeof(GLfloat) * 2*31, vertex );
-   glDrawArrays( GL_LINE_LOOP, 0, 31 );
 
-   /* Clean up. */
+/**
+ * @brief Renders a window border.
+ *
+ *    @param w Window to render
+ */
+static void window_renderBorder( Window* w )
+{
+   double x, y;
+   GLsizei coffset;
+
+   /* position */
+   x = w->x - (double)SCREEN_W/2.;
+   y = w->y - (double)SCREEN_H/2.;
+
+   /* Bake on first use or when the window moved or resized. */
+   if ((w->chrome_vbo == NULL) || (w->chrome_x != w->x) ||
+         (w->chrome_y != w->y) || (w->chrome_w != w->w) ||
+         (w->chrome_h != w->h))
+      window_chromeBake(w);
+
+   /* All the chrome comes off the baked VBO - the fills in one draw,
+    * the outlines in a second. */
+   glShadeModel(GL_SMOOTH);
+   coffset = sizeof(GLfloat) * 2 * (w->chrome_nfill + w->chrome_nline);
+   gl_vboActivateOffset( w->chrome_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+   gl_vboActivateOffset( w->chrome_vbo, GL_COLOR_ARRAY, coffset,
+         4, GL_FLOAT, 0 );
+   glDrawArrays( GL_TRIANGLES, 0, w->chrome_nfill );
+   if (w->chrome_nline > 0)
+      glDrawArrays( GL_LINES, w->chrome_nfill, w->chrome_nline );
    gl_vboDeactivate();
+   glShadeModel(GL_FLAT);
 
    /*
     * render window name
@@ -1299,37 +1247,178 @@ static void window_renderBorder( Window* w )
  */
 void window_render( Window *w )
 {
-   double x, y, wid, hei;
-   Widget *wgt;
+   double x, y;
+   Widget *wgt, *fwgt;
+   int cache, dynamic;
 
    /* position */
    x = w->x - (double)SCREEN_W/2.;
    y = w->y - (double)SCREEN_H/2.;
 
-   /* See if needs border. */
-   if (!window_isFlag( w, WINDOW_NOBORDER ))
-      window_renderBorder(w);
+   /* With screen scaling the backbuffer pixels don't match window
+    * coordinates, so the cache can't be captured. */
+   cache   = (gl_screen.scale == 1.);
+   dynamic = window_isDynamic(w);
+
+   /* Focused widget, the outline is drawn with the layer it belongs to. */
+   fwgt = NULL;
+   if (w->focus != -1)
+      fwgt = toolkit_getFocus( w );
+
+   /* Clean window, just composite the last render. */
+   if (cache && !w->dirty && (w->cache != 0))
+      window_renderCached(w);
+   else {
+      /* See if needs border. */
+      if (!window_isFlag( w, WINDOW_NOBORDER ))
+         window_renderBorder(w);
+
+      /*
+       * static widgets
+       */
+      for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
+         if (!wgt_isFlag(wgt, WGT_FLAG_DYNAMIC) && (wgt->render != NULL))
+            wgt->render( wgt, x, y );
+
+      /*
+       * focused widget
+       */
+      if ((fwgt != NULL) && !wgt_isFlag(fwgt, WGT_FLAG_DYNAMIC))
+         toolkit_drawOutline( x + fwgt->x, y + fwgt->y,
+               fwgt->w, fwgt->h, 3, &cBlack, NULL );
+
+      /* Capture the result so clean frames just composite it. */
+      if (cache) {
+         window_cacheCapture(w);
+         w->dirty = 0;
+      }
+   }
+
+   /* Dynamic widgets draw live content on top of the cache every frame. */
+   if (dynamic) {
+      for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
+         if (wgt_isFlag(wgt, WGT_FLAG_DYNAMIC) && (wgt->render != NULL))
+            wgt->render( wgt, x, y );
+
+      if ((fwgt != NULL) && wgt_isFlag(fwgt, WGT_FLAG_DYNAMIC))
+         toolkit_drawOutline( x + fwgt->x, y + fwgt->y,
+               fwgt->w, fwgt->h, 3, &cBlack, NULL );
+   }
+}
+
+
+/**
+ * @brief Checks whether a window has widgets that re-render every frame.
+ *
+ *    @param w Window to check.
+ *    @return 1 if the window can't be cached.
+ */
+static int window_isDynamic( Window *w )
+{
+   Widget *wgt;
 
-   /*
-    * widgets
-    */
    for (wgt=w->widgets; wgt!=NULL; wgt=wgt->next)
-      if (wgt->render != NULL)
-         wgt->render( wgt, x, y );
+      if (wgt_isFlag( wgt, WGT_FLAG_DYNAMIC ))
+         return 1;
+   return 0;
+}
 
-   /*
-    * focused widget
-    */
-   if (w->focus != -1) {
-      wgt = toolkit_getFocus( w );
-      if (wgt == NULL)
-         return;
-      x  += wgt->x;
-      y  += wgt->y;
-      wid = wgt->w;
-      hei = wgt->h;
-      toolkit_drawOutline( x, y, wid, hei, 3, &cBlack, NULL );
+
+/**
+ * @brief Composites a clean window from its cached render.
+ *
+ *    @param w Window to render.
+ */
+static void window_renderCached( Window *w )
+{
+   GLfloat vertex[4*2], tex[4*2];
+   double x, y;
+
+   /* position */
+   x = w->x - (double)SCREEN_W/2.;
+   y = w->y - (double)SCREEN_H/2.;
+
+   /* Bind the cache texture. */
+   glEnable(GL_TEXTURE_2D);
+   glBindTexture( GL_TEXTURE_2D, w->cache );
+   glColor4d( 1., 1., 1., 1. );
+
+   /* Set the vertex. */
+   vertex[0] = (GLfloat)x;
+   vertex[4] = vertex[0];
+   vertex[2] = vertex[0] + (GLfloat)w->w;
+   vertex[6] = vertex[2];
+   vertex[1] = (GLfloat)y;
+   vertex[3] = vertex[1];
+   vertex[5] = vertex[1] + (GLfloat)w->h;
+   vertex[7] = vertex[5];
+   gl_vboSubData( toolkit_vbo, 0, sizeof(vertex), vertex );
+   gl_vboActivateOffset( toolkit_vbo, GL_VERTEX_ARRAY, 0, 2, GL_FLOAT, 0 );
+
+   /* Set the texture, window occupies the lower-left of the texture. */
+   tex[0] = 0.;
+   tex[4] = tex[0];
+   tex[2] = (GLfloat)(w->w / (double)w->cache_w);
+   tex[6] = tex[2];
+   tex[1] = 0.;
+   tex[3] = tex[1];
+   tex[5] = (GLfloat)(w->h / (double)w->cache_h);
+   tex[7] = tex[5];
+   gl_vboSubData( toolkit_vbo, toolkit_vboColourOffset, sizeof(tex), tex );
+   gl_vboActivateOffset( toolkit_vbo, GL_TEXTURE_COORD_ARRAY,
+         toolkit_vboColourOffset, 2, GL_FLOAT, 0 );
+
+   /* Draw. */
+   glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+
+   /* Clear state. */
+   gl_vboDeactivate();
+   glDisable(GL_TEXTURE_2D);
+
+   gl_checkErr();
+}
+
+
+/**
+ * @brief Captures the freshly rendered window off the backbuffer.
+ *
+ *    @param w Window to capture into its cache texture.
+ */
+static void window_cacheCapture( Window *w )
+{
+   int pw, ph;
+
+   /* Round texture dimensions up to the next power of two. */
+   pw = 1;
+   while (pw < (int)w->w)
+      pw <<= 1;
+   ph = 1;
+   while (ph < (int)w->h)
+      ph <<= 1;
+
+   /* (Re)create the texture if needed. */
+   if ((w->cache == 0) || (pw != w->cache_w) || (ph != w->cache_h)) {
+      if (w->cache != 0)
+         glDeleteTextures( 1, &w->cache );
+      glGenTextures( 1, &w->cache );
+      glBindTexture( GL_TEXTURE_2D, w->cache );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, pw, ph, 0,
+            GL_RGB, GL_UNSIGNED_BYTE, NULL );
+      w->cache_w = pw;
+      w->cache_h = ph;
    }
+   else
+      glBindTexture( GL_TEXTURE_2D, w->cache );
+
+   /* Grab the window region, it was just rendered so the backbuffer is
+    * current. */
+   glCopyTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0,
+         (GLint)w->x, (GLint)w->y, (GLsizei)w->w, (GLsizei)w->h );
+   glBindTexture( GL_TEXTURE_2D, 0 );
+
+   gl_checkErr();
 }
 
 
@@ -1387,11 +1476,18 @@ void toolkit_drawScrollbar( double x, double y, double w, double h, double pos )
 void toolkit_render (void)
 {
    Window *w;
+   int force;
 
-   /* Render base. */
+   /* Render base, bottom to top.  Once a window re-renders, every window
+    * above it must too since their caches baked in what was below them. */
+   force = 0;
    for (w = windows; w!=NULL; w = w->next) {
       if (!window_isFlag(w, WINDOW_NORENDER) &&
                !window_isFlag(w, WINDOW_KILL)) {
+         if (w->dirty || window_isDynamic(w))
+            force = 1;
+         else if (force)
+            w->dirty = 1;
          window_render(w);
          window_renderOverlay(w);
       }
@@ -1467,6 +1563,10 @@ int toolkit_inputWindow( Window *wdw, SDL_Event *event, int purge )
             ret =  toolkit_keyEvent(wdw, event);
             break;
       }
+
+      /* Input can change hover/focus state, refresh the render cache. */
+      if (ret)
+         wdw->dirty = 1;
    }
 
    /* Clean up the dead if needed. */
@@ -1834,7 +1934,9 @@ static void toolkit_purgeDead (void)
                wgt = wgtlast;
                /* Kill target. */
                wgtkill->next = NULL;
+               strhash_del( wdw->wgthash, wgtkill->name );
                widget_kill( wgtkill );
+               wdw->dirty = 1;
             }
             /* Save position. */
             wgtlast = wgt;
@@ -0,0 +1,149 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file transmap.c
+ *
+ * @brief Transparency-map queries used by the pixel-perfect collisions.
+ *
+ * Kept free of any GL calls so the microbenchmark harness in utils/bench
+ *  can link these together with collision.c without the video stack.
+ */
+
+#include "opengl.h"
+
+#include "naev.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+
+/**
+ * @brief Builds a coarse block occupancy map from a transparency map.
+ *
+ * One bit per 8x8 pixel block, set if the block has any non-transparent
+ *  pixel.  Lets collision routines reject or accept whole blocks without
+ *  descending to individual pixels.
+ *
+ *    @param trans Transparency map to build from.
+ *    @param w Width of the image in pixels.
+ *    @param h Height of the image in pixels.
+ *    @param[out] bw Width of the block map in blocks.
+ *    @return The newly allocated block map.
+ */
+uint8_t* gl_transBlocks( const uint8_t *trans, int w, int h, int *bw )
+{
+   int i,j, b, nbw,nbh, size;
+   uint8_t *blocks;
+
+   nbw  = (w+7)/8;
+   nbh  = (h+7)/8;
+   size = nbw*nbh/8 + ((nbw*nbh%8)?1:0);
+   blocks = malloc(size);
+   if (blocks==NULL) {
+      WARN("Out of Memory");
+      return NULL;
+   }
+   memset(blocks, 0, size); /* important, must be set to zero */
+
+   /* Mark the block of every non-transparent pixel. */
+   for (i=0; i<h; i++)
+      for (j=0; j<w; j++)
+         if (trans[(i*w+j)/8] & (1<<((i*w+j)%8))) {
+            b = (i/8)*nbw + (j/8);
+            blocks[b/8] |= (1<<(b%8));
+         }
+
+   *bw = nbw;
+   return blocks;
+}
+
+
+/**
+ * @brief Checks to see if a pixel is transparent in a texture.
+ *
+ *    @param t Texture to check for transparency.
+ *    @param x X position of the pixel.
+ *    @param y Y position of the pixel.
+ *    @return 1 if the pixel is transparent or 0 if it isn't.
+ */
+int gl_isTrans( const glTexture* t, const int x, const int y )
+{
+   int i;
+
+   /* Get the position in the sheet. */
+   i = y*(int)(t->w) + x ;
+   /* Now we have to pull out the individual bit. */
+   return !(t->trans[ i/8 ] & (1 << (i%8)));
+}
+
+
+/**
+ * @brief Checks whether an area of a texture is fully transparent.
+ *
+ * Works at the granularity of the coarse 8x8 block map, so it can return
+ *  0 for areas that are actually transparent but share a block with
+ *  non-transparent pixels.  Meant as a cheap prepass for collisions.
+ *
+ *    @param t Texture to check for transparency.
+ *    @param x0 Left edge of the area.
+ *    @param y0 Bottom edge of the area.
+ *    @param x1 Right edge of the area.
+ *    @param y1 Top edge of the area.
+ *    @return 1 if the area only covers empty blocks, 0 otherwise.
+ */
+int gl_isTransArea( const glTexture* t, const int x0, const int y0,
+      const int x1, const int y1 )
+{
+   int bx,by, b;
+
+   /* Without a block map we can't reject anything. */
+   if (t->btrans == NULL)
+      return 0;
+
+   for (by=y0/8; by<=y1/8; by++)
+      for (bx=x0/8; bx<=x1/8; bx++) {
+         b = by*t->bw + bx;
+         if (t->btrans[ b/8 ] & (1 << (b%8)))
+            return 0; /* Block has non-transparent pixels. */
+      }
+
+   return 1;
+}
+
+
+/**
+ * @brief Gets a run of transparency map bits as a word.
+ *
+ * Bit i of the result is set if pixel (x+i,y) is non-transparent, so two
+ *  sprites' rows can be tested for overlap with a single AND instead of
+ *  per-pixel probes.
+ *
+ *    @param t Texture to get the bits of.
+ *    @param x X position of the first pixel.
+ *    @param y Y position of the row.
+ *    @param n Number of pixels to get, at most 24.
+ *    @return The transparency bits of the run.
+ */
+uint32_t gl_transRowMask( const glTexture* t, const int x, const int y,
+      const int n )
+{
+   int pos, byte, shift, i;
+   uint32_t bits;
+
+   /* Position of the first bit in the map. */
+   pos   = y*(int)(t->w) + x;
+   byte  = pos/8;
+   shift = pos%8;
+
+   /* Gather enough bytes to cover shift+n bits. */
+   bits = 0;
+   for (i=0; 8*i < shift+n; i++)
+      bits |= ((uint32_t) t->trans[ byte+i ]) << (8*i);
+   bits >>= shift;
+
+   return bits & ((1u << n) - 1u);
+}
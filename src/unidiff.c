@@ -22,6 +22,7 @@
 
 #include "log.h"
 #include "nxml.h"
+#include "save.h"
 #include "space.h"
 #include "ndata.h"
 #include "fleet.h"
@@ -117,6 +118,22 @@ typedef struct UniDiff_ {
 } UniDiff_t;
 
 
+/**
+ * @struct UniDiffData_t
+ *
+ * @brief Represents a diff pre-parsed into hunk templates.
+ *
+ * The XML is read once at load time; applying a diff just copies the
+ *  templates instead of re-parsing the file.
+ */
+typedef struct UniDiffData_ {
+   char *name; /**< Name of the diff. */
+   UniHunk_t *hunks; /**< Hunk templates in file order. */
+   int nhunks; /**< Number of hunks. */
+   int mhunks; /**< Allocated hunks. */
+} UniDiffData_t;
+
+
 /*
  * Diff stack.
  */
@@ -125,16 +142,24 @@ static int diff_nstack = 0; /**< Number of diffs in the stack. */
 static int diff_mstack = 0; /**< Currently allocated diffs. */
 
 
+/*
+ * Parsed diff data.
+ */
+static UniDiffData_t *diff_dataStack = NULL; /**< Available diffs. */
+static int diff_ndataStack = 0; /**< Number of available diffs. */
+
+
 /*
  * Prototypes.
  */
 static UniDiff_t* diff_get( const char *name );
 static UniDiff_t *diff_newDiff (void);
 static int diff_removeDiff( UniDiff_t *diff );
-static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node );
-static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node );
-static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node );
-static int diff_patch( xmlNodePtr parent );
+static UniDiffData_t* diff_getData( const char *name );
+static void diff_dataHunk( UniDiffData_t *data, UniHunk_t *hunk );
+static int diff_parseSystem( UniDiffData_t *data, xmlNodePtr node );
+static int diff_parseShip( UniDiffData_t *data, xmlNodePtr node );
+static int diff_parseOutfit( UniDiffData_t *data, xmlNodePtr node );
 static int diff_patchHunk( UniHunk_t *hunk );
 static void diff_hunkFailed( UniDiff_t *diff, UniHunk_t *hunk );
 static void diff_hunkSuccess( UniDiff_t *diff, UniHunk_t *hunk );
@@ -183,67 +208,208 @@ static UniDiff_t* diff_get( const char *name )
  */
 int diff_apply( const char *name )
 {
-   xmlNodePtr node;
-   xmlDocPtr doc;
-   uint32_t bufsize;
-   char *buf;
-   char *diffname;
+   int i;
+   UniDiff_t *diff;
+   UniDiffData_t *data;
+   UniHunk_t hunk, *fail;
+   char *target;
 
    /* Check if already applied. */
    if (diff_isApplied(name))
       return 0;
 
+   /* In case a diff fires before load_all() got to us. */
+   if (diff_dataStack == NULL)
+      diff_loadAvailable();
+
+   data = diff_getData(name);
+   if (data == NULL) {
+      WARN("UniDiff '%s' not found in "DIFF_DATA".", name);
+      return -1;
+   }
+
+   save_dirty(SAVE_DIFF);
+
+   /* Prepare it. */
+   diff = diff_newDiff();
+   memset(diff, 0, sizeof(UniDiff_t));
+   diff->name = strdup(data->name);
+
+   /* Apply the templates, duplicating the strings they own. */
+   for (i=0; i<data->nhunks; i++) {
+      memcpy( &hunk, &data->hunks[i], sizeof(UniHunk_t) );
+      hunk.target.u.name = strdup( data->hunks[i].target.u.name );
+      if ((hunk.type == HUNK_TYPE_PLANET_ADD) ||
+            (hunk.type == HUNK_TYPE_PLANET_REMOVE))
+         hunk.u.name = strdup( data->hunks[i].u.name );
+
+      if (diff_patchHunk( &hunk ) < 0)
+         diff_hunkFailed( diff, &hunk );
+      else
+         diff_hunkSuccess( diff, &hunk );
+   }
+
+   if (diff->nfailed > 0) {
+      DEBUG("Unidiff '%s' failed to apply %d hunks.", diff->name, diff->nfailed);
+      for (i=0; i<diff->nfailed; i++) {
+         fail = &diff->failed[i];
+         target = fail->target.u.name;
+         switch (fail->type) {
+            case HUNK_TYPE_PLANET_ADD:
+               DEBUG("   [%s] planet add: '%s'", target, fail->u.name);
+               break;
+            case HUNK_TYPE_PLANET_REMOVE:
+               DEBUG("   [%s] planet remove: '%s'", target, fail->u.name);
+               break;
+            case HUNK_TYPE_FLEET_ADD:
+               DEBUG("   [%s] fleet add: '%s' (%d%% chance)", target, 
+                     fail->u.fleet.fleet->name, fail->u.fleet.chance );
+               break;
+            case HUNK_TYPE_FLEET_REMOVE:
+               DEBUG("   [%s] fleet remove: '%s' (%d%% chance)", target,
+                     fail->u.fleet.fleet->name, fail->u.fleet.chance );
+               break;
+            case HUNK_TYPE_FLEETGROUP_ADD:
+               DEBUG("   [%s] fleetgroup add: '%s'", target, 
+                     fail->u.fleetgroup->name );
+               break;
+            case HUNK_TYPE_FLEETGROUP_REMOVE:
+               DEBUG("   [%s] fleetgroup remove: '%s'", target,
+                     fail->u.fleetgroup->name );
+               break;
+
+            default:
+               DEBUG("   unknown hunk '%d'", fail->type);
+               break;
+         }
+      }
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Gets a pre-parsed diff by name.
+ *
+ *    @param name Name of the diff to get.
+ *    @return The diff data or NULL if not found.
+ */
+static UniDiffData_t* diff_getData( const char *name )
+{
+   int i;
+   for (i=0; i<diff_ndataStack; i++)
+      if (strcmp(diff_dataStack[i].name,name)==0)
+         return &diff_dataStack[i];
+   return NULL;
+}
+
+
+/**
+ * @brief Adds a hunk template to a diff's data.
+ *
+ *    @param data Diff data to add the hunk to.
+ *    @param hunk Hunk to add.
+ */
+static void diff_dataHunk( UniDiffData_t *data, UniHunk_t *hunk )
+{
+   data->nhunks++;
+   if (data->nhunks > data->mhunks) {
+      data->mhunks += CHUNK_SIZE;
+      data->hunks = realloc(data->hunks, sizeof(UniHunk_t) * data->mhunks);
+   }
+   memcpy( &data->hunks[data->nhunks-1], hunk, sizeof(UniHunk_t) );
+}
+
+
+/**
+ * @brief Parses all the diffs in "DIFF_DATA" into hunk templates.
+ *
+ *    @return 0 on success.
+ */
+int diff_loadAvailable (void)
+{
+   xmlNodePtr node, cur;
+   xmlDocPtr doc;
+   uint32_t bufsize;
+   char *buf;
+   UniDiffData_t *data;
+
    buf = ndata_read( DIFF_DATA, &bufsize );
-   doc = xmlParseMemory( buf, bufsize );
+   doc = xml_parseMemory( buf, bufsize );
 
    node = doc->xmlChildrenNode;
    if (strcmp((char*)node->name,"unidiffs")) {
       ERR("Malformed unidiff file: missing root element 'unidiffs'");
-      return 0;
+      return -1;
    }
 
-   node = node->xmlChildrenNode; /* first system node */
+   node = node->xmlChildrenNode; /* first unidiff node */
    if (node == NULL) {
       ERR("Malformed unidiff file: does not contain elements");
-      return 0;
+      return -1;
    }
 
    do {
       if (xml_isNode(node,"unidiff")) {
-         /* Check to see if it's the diff we're looking for. */
-         xmlr_attr(node,"name",diffname);
-         if (strcmp(diffname,name)==0) {
-            /* Apply it. */
-            diff_patch( node );
-
-            /* Clean up. */
-            free(diffname);
-            xmlFreeDoc(doc);
-            free(buf);
-
-            return 0;
-         }
-         free(diffname);
+         /* Grow the data stack. */
+         diff_ndataStack++;
+         diff_dataStack = realloc( diff_dataStack,
+               diff_ndataStack * sizeof(UniDiffData_t) );
+         data = &diff_dataStack[diff_ndataStack-1];
+         memset(data, 0, sizeof(UniDiffData_t));
+         xmlr_attr(node,"name",data->name);
+
+         cur = node->xmlChildrenNode;
+         do {
+            if (xml_isNode(cur,"system"))
+               diff_parseSystem( data, cur );
+            else if (xml_isNode(cur, "outfit"))
+               diff_parseOutfit( data, cur );
+            else if (xml_isNode(cur, "ship"))
+               diff_parseShip( data, cur );
+         } while (xml_nextNode(cur));
       }
    } while (xml_nextNode(node));
 
-   /* More clean up. */
    xmlFreeDoc(doc);
    free(buf);
 
-   WARN("UniDiff '%s' not found in "DIFF_DATA".", name);
-   return -1;
+   return 0;
 }
 
 
 /**
- * @brief Patches a system.
+ * @brief Frees the pre-parsed diff data.
+ */
+void diff_exit (void)
+{
+   int i, j;
+   UniDiffData_t *data;
+
+   for (i=0; i<diff_ndataStack; i++) {
+      data = &diff_dataStack[i];
+      for (j=0; j<data->nhunks; j++)
+         diff_cleanupHunk( &data->hunks[j] );
+      if (data->hunks != NULL)
+         free(data->hunks);
+      free(data->name);
+   }
+   if (diff_dataStack != NULL)
+      free(diff_dataStack);
+   diff_dataStack  = NULL;
+   diff_ndataStack = 0;
+}
+
+
+/**
+ * @brief Parses a system's hunks into a diff's data.
  *
- *    @param diff Diff that is doing the patching.
+ *    @param data Diff data being parsed.
  *    @param node Node containing the system.
  *    @return 0 on success.
  */
-static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
+static int diff_parseSystem( UniDiffData_t *data, xmlNodePtr node )
 {
    UniHunk_t base, hunk;
    xmlNodePtr cur;
@@ -254,7 +420,7 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
    base.target.type = HUNK_TARGET_SYSTEM;
    xmlr_attr(node,"name",base.target.u.name);
    if (base.target.u.name==NULL)
-      WARN("Unidiff '%s' has a system node without a 'name' tag", diff->name);
+      WARN("Unidiff '%s' has a system node without a 'name' tag", data->name);
 
    /* Now parse the possible changes. */
    cur = node->xmlChildrenNode;
@@ -273,11 +439,7 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
          else if (strcmp(buf,"remove")==0)
             hunk.type = HUNK_TYPE_PLANET_REMOVE;
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_dataHunk( data, &hunk );
       }
       else if (xml_isNode(cur, "fleet")) {
          hunk.target.type = base.target.type;
@@ -298,11 +460,7 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
          else if (strcmp(buf,"remove")==0)
             hunk.type = HUNK_TYPE_FLEET_REMOVE;
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_dataHunk( data, &hunk );
       }
       else if (xml_isNode(cur, "fleetgroup")) {
          hunk.target.type = base.target.type;
@@ -320,11 +478,7 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
          else if (strcmp(buf,"remove")==0)
             hunk.type = HUNK_TYPE_FLEETGROUP_REMOVE;
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_dataHunk( data, &hunk );
       }
    } while (xml_nextNode(cur));
 
@@ -337,32 +491,31 @@ static int diff_patchSystem( UniDiff_t *diff, xmlNodePtr node )
 
 
 /**
- * @brief Patches a ship.
+ * @brief Parses a ship's hunks into a diff's data.
  *
- *    @param diff Diff that is doing the patching.
+ *    @param data Diff data being parsed.
  *    @param node Node containing the ship.
  *    @return 0 on success.
  */
-static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node )
+static int diff_parseShip( UniDiffData_t *data, xmlNodePtr node )
 {
    UniHunk_t base, hunk;
    xmlNodePtr cur;
-   Ship *s;
 
    /* Set the target. */
    memset(&base, 0, sizeof(UniHunk_t));
    base.target.type = HUNK_TARGET_SHIP;
    xmlr_attr(node,"name",base.target.u.name);
    if (base.target.u.name==NULL) {
-      WARN("Unidiff '%s' has an ship node without a 'name' tag", diff->name);
+      WARN("Unidiff '%s' has an ship node without a 'name' tag", data->name);
       return -1;
    }
 
    /* Make sure ship exists. */
-   s = ship_get(base.target.u.name);
-   if (s == NULL) {
+   if (ship_get(base.target.u.name) == NULL) {
       WARN("Unidiff '%s' ship '%s' to patch does not exist",
-            diff->name, base.target.u.name );
+            data->name, base.target.u.name );
+      free(base.target.u.name);
       return -1;
    }
 
@@ -376,15 +529,11 @@ static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node )
          /* Outfit type is constant. */
          hunk.type = HUNK_TYPE_SHIP_TECH;
 
-         /* Get the data. */
-         hunk.u.i.old = s->tech;
+         /* Get the data; the old value is captured when applied. */
+         hunk.u.i.old = 0;
          hunk.u.i.new = xml_getInt(cur);
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_dataHunk( data, &hunk );
       }
    } while (xml_nextNode(cur));
 
@@ -397,32 +546,31 @@ static int diff_patchShip( UniDiff_t *diff, xmlNodePtr node )
 
 
 /**
- * @brief Patches an outfit.
+ * @brief Parses an outfit's hunks into a diff's data.
  *
- *    @param diff Diff that is doing the patching.
+ *    @param data Diff data being parsed.
  *    @param node Node containing the outfit.
  *    @return 0 on success.
  */
-static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node )
+static int diff_parseOutfit( UniDiffData_t *data, xmlNodePtr node )
 {
    UniHunk_t base, hunk;
    xmlNodePtr cur;
-   Outfit *o;
 
    /* Set the target. */
    memset(&base, 0, sizeof(UniHunk_t));
    base.target.type = HUNK_TARGET_OUTFIT;
    xmlr_attr(node,"name",base.target.u.name);
    if (base.target.u.name==NULL) {
-      WARN("Unidiff '%s' has an outfit node without a 'name' tag", diff->name);
+      WARN("Unidiff '%s' has an outfit node without a 'name' tag", data->name);
       return -1;
    }
 
    /* Make sure outfit exists. */
-   o = outfit_get(base.target.u.name);
-   if (o == NULL) {
+   if (outfit_get(base.target.u.name) == NULL) {
       WARN("Unidiff '%s' outfit '%s' to patch does not exist",
-            diff->name, base.target.u.name );
+            data->name, base.target.u.name );
+      free(base.target.u.name);
       return -1;
    }
 
@@ -436,15 +584,11 @@ static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node )
          /* Outfit type is constant. */
          hunk.type = HUNK_TYPE_OUTFIT_TECH;
 
-         /* Get the data. */
-         hunk.u.i.old = o->tech;
+         /* Get the data; the old value is captured when applied. */
+         hunk.u.i.old = 0;
          hunk.u.i.new = xml_getInt(cur);
 
-         /* Apply diff. */
-         if (diff_patchHunk( &hunk ) < 0)
-            diff_hunkFailed( diff, &hunk );
-         else
-            diff_hunkSuccess( diff, &hunk );
+         diff_dataHunk( data, &hunk );
       }
    } while (xml_nextNode(cur));
 
@@ -456,75 +600,6 @@ static int diff_patchOutfit( UniDiff_t *diff, xmlNodePtr node )
 }
 
 
-/**
- * @brief Actually applies a diff in XML node form.
- *
- *    @param parent Node containing the diff information.
- *    @return 0 on success.
- */
-static int diff_patch( xmlNodePtr parent )
-{
-   int i;
-   UniDiff_t *diff;
-   UniHunk_t *fail;
-   xmlNodePtr node;
-   char *target;
-
-   /* Prepare it. */
-   diff = diff_newDiff();
-   memset(diff, 0, sizeof(UniDiff_t));
-   xmlr_attr(parent,"name",diff->name);
-
-   node = parent->xmlChildrenNode;
-   do {
-      if (xml_isNode(node,"system"))
-         diff_patchSystem( diff, node );
-      else if (xml_isNode(node, "outfit"))
-         diff_patchOutfit( diff, node );
-      else if (xml_isNode(node, "ship"))
-         diff_patchShip( diff, node );
-   } while (xml_nextNode(node));
-
-   if (diff->nfailed > 0) {
-      DEBUG("Unidiff '%s' failed to apply %d hunks.", diff->name, diff->nfailed);
-      for (i=0; i<diff->nfailed; i++) {
-         fail = &diff->failed[i];
-         target = fail->target.u.name;
-         switch (fail->type) {
-            case HUNK_TYPE_PLANET_ADD:
-               DEBUG("   [%s] planet add: '%s'", target, fail->u.name);
-               break;
-            case HUNK_TYPE_PLANET_REMOVE:
-               DEBUG("   [%s] planet remove: '%s'", target, fail->u.name);
-               break;
-            case HUNK_TYPE_FLEET_ADD:
-               DEBUG("   [%s] fleet add: '%s' (%d%% chance)", target, 
-                     fail->u.fleet.fleet->name, fail->u.fleet.chance );
-               break;
-            case HUNK_TYPE_FLEET_REMOVE:
-               DEBUG("   [%s] fleet remove: '%s' (%d%% chance)", target,
-                     fail->u.fleet.fleet->name, fail->u.fleet.chance );
-               break;
-            case HUNK_TYPE_FLEETGROUP_ADD:
-               DEBUG("   [%s] fleetgroup add: '%s'", target, 
-                     fail->u.fleetgroup->name );
-               break;
-            case HUNK_TYPE_FLEETGROUP_REMOVE:
-               DEBUG("   [%s] fleetgroup remove: '%s'", target,
-                     fail->u.fleetgroup->name );
-               break;
-
-            default:
-               DEBUG("   unknown hunk '%d'", fail->type);
-               break;
-         }
-      }
-   }
-
-   return 0;
-}
-
-
 /**
  * @brief Applies a hunk and adds it to the diff.
  *
@@ -568,11 +643,12 @@ static int diff_patchHunk( UniHunk_t *hunk )
          s = ship_get(hunk->target.u.name);
          if (s==NULL)
             return -1;
+         /* Swap in the new value, keeping the old one for removal. */
+         i = s->tech;
          s->tech = hunk->u.i.new;
-         /* Invert it so when it gets removed it works. */
-         i = hunk->u.i.old;
          hunk->u.i.old = hunk->u.i.new;
          hunk->u.i.new = i;
+         space_techChanged(); /* stale the cached shop stocks */
          return 0;
 
       /* Changing an outfit's technology. */
@@ -580,11 +656,12 @@ static int diff_patchHunk( UniHunk_t *hunk )
          o = outfit_get(hunk->target.u.name);
          if (o==NULL)
             return -1;
+         /* Swap in the new value, keeping the old one for removal. */
+         i = o->tech;
          o->tech = hunk->u.i.new;
-         /* Invert it so when it gets removed it works. */
-         i = hunk->u.i.old;
          hunk->u.i.old = hunk->u.i.new;
          hunk->u.i.new = i;
+         space_techChanged(); /* stale the cached shop stocks */
          return 0;
 
       default:
@@ -702,6 +779,8 @@ static int diff_removeDiff( UniDiff_t *diff )
    int i;
    UniHunk_t hunk;
 
+   save_dirty(SAVE_DIFF);
+
    for (i=0; i<diff->napplied; i++) {
       memcpy( &hunk, &diff->applied[i], sizeof(UniHunk_t) );
       /* Invert the type for reverting. */
@@ -8,6 +8,9 @@
 #  define UNIDIFF_H
 
 
+int diff_loadAvailable (void);
+void diff_exit (void);
+
 int diff_apply( const char *name );
 void diff_remove( const char *name );
 void diff_clear (void);
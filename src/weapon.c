@@ -21,20 +21,29 @@
 #include <string.h>
 
 #include "log.h"
+#include "nmem.h"
 #include "rng.h"
 #include "pilot.h"
 #include "player.h"
 #include "collision.h"
+#include "spatial.h"
 #include "spfx.h"
 #include "opengl.h"
 #include "explosion.h"
 #include "gui.h"
+#include "array.h"
 
 
 #define weapon_isSmart(w)     (w->think != NULL) /**< Checks if the weapon w is smart. */
 
 #define WEAPON_CHUNK          256 /**< Size to increase array with */
 
+/* Weapon classes, cached at creation so the update passes don't have to
+ *  re-derive them from the outfit type. */
+#define WEAPON_CLASS_SEEKER      0 /**< Ammo, may have a seeker brain. */
+#define WEAPON_CLASS_BOLT        1 /**< Dumb bolts. */
+#define WEAPON_CLASS_BEAM        2 /**< Beams. */
+
 /* Weapon status */
 #define WEAPON_STATUS_OK         0 /**< Weapon is fine */
 #define WEAPON_STATUS_LOCKEDON   1 /**< Weapon is locked on. */
@@ -65,12 +74,15 @@ static int weapon_safety = 1; /**< Enables shooting friendlies. */
  * @brief In-game representation of a weapon.
  */
 typedef struct Weapon_ {
+   Solid solid_data; /**< Weapon's solid, accessed through ->solid. */
    Solid *solid; /**< Actually has its own solid :) */
    int ID; /**< Only used for beam weapons. */
 
    int faction; /**< faction of pilot that shot it */
    unsigned int parent; /**< pilot that shot it */
    unsigned int target; /**< target to hit, only used by seeking things */
+   Pilot *parent_p; /**< Cached parent pilot, cleared when it dies. */
+   Pilot *target_p; /**< Cached target pilot, cleared when it dies. */
    const Outfit* outfit; /**< related outfit that fired it or whatnot */
 
    int voice; /**< Weapon's voice. */
@@ -89,18 +101,34 @@ typedef struct Weapon_ {
    void (*update)(struct Weapon_*, const double, WeaponLayer); /**< Updates the weapon */
    void (*think)(struct Weapon_*, const double); /**< for the smart missiles */
 
+   char wclass; /**< WEAPON_CLASS_* of the outfit. */
    char status; /**< Weapon status - to check for jamming */
 } Weapon;
 
 
+/*
+ * Weapons come out of a slab pool with a free list so that turret spam
+ *  never hits the allocator: firing pops a slot and expiry pushes it back.
+ */
+#define WEAPON_SLAB_SIZE   256 /**< Weapons per allocation slab. */
+/**
+ * @brief A slot in a weapon slab - a live weapon or a free list link.
+ */
+typedef union WeaponSlot_ {
+   Weapon w; /**< Actual weapon data when in use. */
+   union WeaponSlot_ *next; /**< Next free slot when unused. */
+} WeaponSlot;
+static WeaponSlot **weapon_slabs = NULL; /**< All the allocated slabs. */
+static int weapon_nslabs = 0; /**< Number of allocated slabs. */
+static WeaponSlot *weapon_slotfree = NULL; /**< Head of the free slot list. */
+
+
+/* Weapon layers are array.c vectors, created by weapon_layersInit();
+ * sizes live in the array headers so growth is geometric and automatic. */
 /* behind pilot_nstack layer */
 static Weapon** wbackLayer = NULL; /**< behind pilots */
-static int nwbackLayer = 0; /**< number of elements */
-static int mwbacklayer = 0; /**< alloced memory size */
 /* behind player layer */
 static Weapon** wfrontLayer = NULL; /**< infront of pilots, behind player */
-static int nwfrontLayer = 0; /**< number of elements */
-static int mwfrontLayer = 0; /**< alloced memory size */
 
 /* Graphics. */
 static gl_vbo  *weapon_vbo     = NULL; /**< Weapon VBO. */
@@ -111,11 +139,13 @@ static int weapon_vboSize      = 0; /**< Size of the VBO. */
 /* Internal stuff. */
 static int beam_idgen = 0; /**< Beam identifier generator. */
 
-
 /*
  * Prototypes
  */
 /* static */
+static void weapon_layersInit (void);
+static Weapon* weapon_alloc (void);
+static void weapon_dealloc( Weapon *w );
 static Weapon* weapon_create( const Outfit* outfit,
       const double dir, const Vector2d* pos, const Vector2d* vel,
       const unsigned int parent, const unsigned int target );
@@ -142,6 +172,21 @@ static void weapon_setThrust( Weapon *w, double thrust );
 static void weapon_setTurn( Weapon *w, double turn );
 
 
+/**
+ * @brief Lazily creates the weapon layer arrays.
+ *
+ * Reserving a chunk up front keeps growth reallocation out of the first
+ *  combat frames.
+ */
+static void weapon_layersInit (void)
+{
+   if (wbackLayer != NULL)
+      return;
+   wbackLayer  = array_create_size( Weapon*, WEAPON_CHUNK );
+   wfrontLayer = array_create_size( Weapon*, WEAPON_CHUNK );
+}
+
+
 /**
  * @brief Draws the minimap weapons (used in player.c).
  *
@@ -154,7 +199,7 @@ static void weapon_setTurn( Weapon *w, double turn );
 void weapon_minimap( const double res, const double w,
       const double h, const RadarShape shape, double alpha )
 {
-   int i, rc, p;
+   int i, rc, p, n;
    double x, y;
    Weapon *wp;
    glColour *c;
@@ -167,8 +212,11 @@ void weapon_minimap( const double res, const double w,
    if (shape==RADAR_CIRCLE)
       rc = (int)(w*w);
 
+   weapon_layersInit();
+
    /* Draw the points for weapons on all layers. */
-   for (i=0; i<nwbackLayer; i++) {
+   n = array_size(wbackLayer);
+   for (i=0; i<n; i++) {
       wp = wbackLayer[i];
 
       /* Make sure is in range. */
@@ -206,7 +254,8 @@ void weapon_minimap( const double res, const double w,
       /* "Add" pixel. */
       p++;
    }
-   for (i=0; i<nwfrontLayer; i++) {
+   n = array_size(wfrontLayer);
+   for (i=0; i<n; i++) {
       wp = wfrontLayer[i];
 
       /* Make sure is in range. */
@@ -248,6 +297,7 @@ void weapon_minimap( const double res, const double w,
    /* Only render with something to draw. */
    if (p > 0) {
       /* Upload data changes. */
+      gl_vboOrphan( weapon_vbo );
       gl_vboSubData( weapon_vbo, 0, sizeof(GLfloat) * 2*p, weapon_vboData );
       gl_vboSubData( weapon_vbo, offset * sizeof(GLfloat),
             sizeof(GLfloat) * 4*p, &weapon_vboData[offset] );
@@ -315,7 +365,7 @@ static void think_seeker( Weapon* w, const double dt )
 
    if (w->target == w->parent) return; /* no self shooting */
 
-   p = pilot_get(w->target); /* no null pilot_nstack */
+   p = w->target_p; /* cached, cleared when the target dies */
    if (p==NULL) {
       weapon_setThrust( w, 0. );
       weapon_setTurn( w, 0. );
@@ -414,7 +464,7 @@ static void think_beam( Weapon* w, const double dt )
    Vector2d v;
 
    /* Get pilot, if pilot is dead beam is destroyed. */
-   p = pilot_get(w->parent);
+   p = w->parent_p;
    if (p==NULL) {
       w->timer = -1.; /* Hack to make it get destroyed next update. */
       return;
@@ -441,7 +491,7 @@ static void think_beam( Weapon* w, const double dt )
 
       case OUTFIT_TYPE_TURRET_BEAM:
          /* Get target, if target is dead beam stops moving. */
-         t = pilot_get(w->target);
+         t = w->target_p;
          if (t==NULL) {
             weapon_setTurn( w, 0. );
             return;
@@ -469,8 +519,14 @@ static void think_beam( Weapon* w, const double dt )
  */
 void weapons_update( const double dt )
 {
+   /* Refresh the shared grid - also serves the AI proximity queries. */
+   pilots_updateGrid();
+
    weapons_updateLayer(dt,WEAPON_LAYER_BG);
    weapons_updateLayer(dt,WEAPON_LAYER_FG);
+
+   /* Resolve the damage batched by the collision passes in one go. */
+   pilots_flushHits();
 }
 
 
@@ -489,126 +545,146 @@ static void weapons_updateLayer( const double dt, const WeaponLayer layer )
    int spfx;
    int s;
 
+   weapon_layersInit();
+
    /* Choose layer. */
    switch (layer) {
       case WEAPON_LAYER_BG:
          wlayer = wbackLayer;
-         nlayer = &nwbackLayer;
+         nlayer = &array_size(wbackLayer);
          break;
       case WEAPON_LAYER_FG:
          wlayer = wfrontLayer;
-         nlayer = &nwfrontLayer;
+         nlayer = &array_size(wfrontLayer);
          break;
 
       default:
          WARN("Unknown weapon layer!");
+         return;
    }
 
+   /*
+    * One pass per weapon class - the layer is unordered (removal swaps
+    *  the tail in) so each pass runs a tight loop whose branches stay
+    *  predictable instead of re-dispatching on the outfit type per
+    *  weapon.  A destroyed weapon leaves the swapped-in tail at the
+    *  same slot, which the pass re-examines before moving on.
+    */
+
+   /* Seekers. */
    i = 0;
    while (i < *nlayer) {
       w = wlayer[i];
-      switch (w->outfit->type) {
-
-         /* most missiles behave the same */
-         case OUTFIT_TYPE_AMMO:
-         case OUTFIT_TYPE_TURRET_AMMO:
-            if (w->lockon > 0.) /* decrement lockon */
-               w->lockon -= dt;
-
-            limit_speed( &w->solid->vel, w->outfit->u.amm.speed, dt );
-            w->timer -= dt;
-            if (w->timer < 0.) {
-               spfx = -1;
-               /* See if we need armour death sprite. */
-               if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_ARMOUR))
-                  spfx = outfit_spfxArmour(w->outfit);
-               /* See if we need shield death sprite. */
-               else if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_SHIELD))
-                  spfx = outfit_spfxShield(w->outfit);
-               /* Add death sprite if needed. */
-               if (spfx != -1) {
-                  spfx_add( spfx, w->solid->pos.x, w->solid->pos.y,
-                        w->solid->vel.x, w->solid->vel.y,
-                        SPFX_LAYER_BACK ); /* presume back. */
-                  /* Add sound if explodes and has it. */
-                  s = outfit_soundHit(w->outfit);
-                  if (s != -1)
-                     w->voice = sound_playPos(s,
-                           w->solid->pos.x,
-                           w->solid->pos.y,
-                           w->solid->vel.x,
-                           w->solid->vel.y);
-               }
-               weapon_destroy(w,layer);
-               break;
-            }
-            break;
+      if (w->wclass != WEAPON_CLASS_SEEKER) {
+         i++;
+         continue;
+      }
 
-         case OUTFIT_TYPE_BOLT:
-         case OUTFIT_TYPE_TURRET_BOLT:
-            w->timer -= dt;
-            if (w->timer < 0.) {
-               spfx = -1;
-               /* See if we need armour death sprite. */
-               if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_ARMOUR))
-                  spfx = outfit_spfxArmour(w->outfit);
-               /* See if we need shield death sprite. */
-               else if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_SHIELD))
-                  spfx = outfit_spfxShield(w->outfit);
-               /* Add death sprite if needed. */
-               if (spfx != -1) {
-                  spfx_add( spfx, w->solid->pos.x, w->solid->pos.y,
-                        w->solid->vel.x, w->solid->vel.y,
-                        SPFX_LAYER_BACK ); /* presume back. */
-                  /* Add sound if explodes and has it. */
-                  s = outfit_soundHit(w->outfit);
-                  if (s != -1)
-                     w->voice = sound_playPos(s,
-                           w->solid->pos.x,
-                           w->solid->pos.y,
-                           w->solid->vel.x,
-                           w->solid->vel.y);
-               }
-               weapon_destroy(w,layer);
-               break;
-            }
-            else if (w->timer < w->falloff)
-               w->strength = w->timer / w->falloff;
-            break;
+      if (w->lockon > 0.) /* decrement lockon */
+         w->lockon -= dt;
+
+      limit_speed( &w->solid->vel, w->outfit->u.amm.speed, dt );
+      w->timer -= dt;
+      if (w->timer < 0.) {
+         spfx = -1;
+         /* See if we need armour death sprite. */
+         if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_ARMOUR))
+            spfx = outfit_spfxArmour(w->outfit);
+         /* See if we need shield death sprite. */
+         else if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_SHIELD))
+            spfx = outfit_spfxShield(w->outfit);
+         /* Add death sprite if needed. */
+         if (spfx != -1) {
+            spfx_add( spfx, w->solid->pos.x, w->solid->pos.y,
+                  w->solid->vel.x, w->solid->vel.y,
+                  SPFX_LAYER_BACK ); /* presume back. */
+            /* Add sound if explodes and has it. */
+            s = outfit_soundHit(w->outfit);
+            if (s != -1)
+               w->voice = sound_playPos(s,
+                     w->solid->pos.x,
+                     w->solid->pos.y,
+                     w->solid->vel.x,
+                     w->solid->vel.y);
+         }
+         weapon_destroy(w,layer);
+         continue;
+      }
 
-         /* Beam weapons handled a part. */
-         case OUTFIT_TYPE_BEAM:
-         case OUTFIT_TYPE_TURRET_BEAM:
-            w->timer -= dt;
-            if (w->timer < 0.) {
-               weapon_destroy(w,layer);
-               break;
-            }
-            /* We use the lockon to tell when we have to create explosions. */
-            w->lockon -= dt;
-            if (w->lockon < 0.) {
-               if (w->lockon < -1.)
-                  w->lockon = 0.100;
-               else
-                  w->lockon = -1.;
-            }
-            break;
-         default:
-            WARN("Weapon of type '%s' has no update implemented yet!",
-                  w->outfit->name);
-            break;
+      weapon_update(w,dt,layer);
+      if ((i < *nlayer) && (w == wlayer[i]))
+         i++;
+   }
+
+   /* Dumb bolts. */
+   i = 0;
+   while (i < *nlayer) {
+      w = wlayer[i];
+      if (w->wclass != WEAPON_CLASS_BOLT) {
+         i++;
+         continue;
       }
 
-      /* Out of bounds, loop is over. */
-      if (i >= *nlayer)
-         break;
+      w->timer -= dt;
+      if (w->timer < 0.) {
+         spfx = -1;
+         /* See if we need armour death sprite. */
+         if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_ARMOUR))
+            spfx = outfit_spfxArmour(w->outfit);
+         /* See if we need shield death sprite. */
+         else if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_BLOWUP_SHIELD))
+            spfx = outfit_spfxShield(w->outfit);
+         /* Add death sprite if needed. */
+         if (spfx != -1) {
+            spfx_add( spfx, w->solid->pos.x, w->solid->pos.y,
+                  w->solid->vel.x, w->solid->vel.y,
+                  SPFX_LAYER_BACK ); /* presume back. */
+            /* Add sound if explodes and has it. */
+            s = outfit_soundHit(w->outfit);
+            if (s != -1)
+               w->voice = sound_playPos(s,
+                     w->solid->pos.x,
+                     w->solid->pos.y,
+                     w->solid->vel.x,
+                     w->solid->vel.y);
+         }
+         weapon_destroy(w,layer);
+         continue;
+      }
+      else if (w->timer < w->falloff)
+         w->strength = w->timer / w->falloff;
+
+      weapon_update(w,dt,layer);
+      if ((i < *nlayer) && (w == wlayer[i]))
+         i++;
+   }
 
-      /* Only increment if weapon wasn't deleted. */
-      if (w == wlayer[i]) {
-         weapon_update(w,dt,layer);
-         if ((i < *nlayer) && (w == wlayer[i]))
-            i++;
+   /* Beams. */
+   i = 0;
+   while (i < *nlayer) {
+      w = wlayer[i];
+      if (w->wclass != WEAPON_CLASS_BEAM) {
+         i++;
+         continue;
       }
+
+      w->timer -= dt;
+      if (w->timer < 0.) {
+         weapon_destroy(w,layer);
+         continue;
+      }
+      /* We use the lockon to tell when we have to create explosions. */
+      w->lockon -= dt;
+      if (w->lockon < 0.) {
+         if (w->lockon < -1.)
+            w->lockon = 0.100;
+         else
+            w->lockon = -1.;
+      }
+
+      weapon_update(w,dt,layer);
+      if ((i < *nlayer) && (w == wlayer[i]))
+         i++;
    }
 }
 
@@ -625,22 +701,28 @@ void weapons_render( const WeaponLayer layer, const double dt )
    int* nlayer;
    int i;
 
+   weapon_layersInit();
+
    switch (layer) {
       case WEAPON_LAYER_BG:
          wlayer = wbackLayer;
-         nlayer = &nwbackLayer;
+         nlayer = &array_size(wbackLayer);
          break;
       case WEAPON_LAYER_FG:
          wlayer = wfrontLayer;
-         nlayer = &nwfrontLayer;
+         nlayer = &array_size(wfrontLayer);
          break;
 
       default:
          WARN("Unknown weapon layer!");
+         return;
    }
 
+   /* Batch so each texture is bound and drawn only once. */
+   gl_batchBegin();
    for (i=0; i<(*nlayer); i++)
       weapon_render( wlayer[i], dt );
+   gl_batchEnd();
 }
 
 
@@ -665,9 +747,16 @@ static void weapon_render( Weapon* w, const double dt )
       case OUTFIT_TYPE_TURRET_BOLT:
          gfx = outfit_gfx(w->outfit);
 
+         /* Skip weapons the camera can't see. */
+         if (!gl_cameraInView( w->solid->pos.x, w->solid->pos.y, gfx->sw ))
+            break;
+
          /* Alpha based on strength. */
          c.a = w->strength;
 
+         /* Interpolate between the last two simulated states. */
+         solid_getInterpPos( w->solid, &x, &y );
+
          /* Outfit spins around. */
          if (outfit_isProp(w->outfit, OUTFIT_PROP_WEAP_SPIN)) {
             /* Check timer. */
@@ -683,22 +772,22 @@ static void weapon_render( Weapon* w, const double dt )
 
             /* Render. */
             if (outfit_isBolt(w->outfit) && w->outfit->u.blt.gfx_end)
-               gl_blitSpriteInterpolate( gfx, w->outfit->u.blt.gfx_end,
+               gl_batchSpriteInterpolate( gfx, w->outfit->u.blt.gfx_end,
                      w->timer / w->life,
-                     w->solid->pos.x, w->solid->pos.y,
+                     x, y,
                      w->sprite % (int)gfx->sx, w->sprite / (int)gfx->sx, &c );
             else
-               gl_blitSprite( gfx, w->solid->pos.x, w->solid->pos.y,
+               gl_batchSprite( gfx, x, y,
                      w->sprite % (int)gfx->sx, w->sprite / (int)gfx->sx, &c );
          }
          /* Outfit faces direction. */
          else {
             if (outfit_isBolt(w->outfit) && w->outfit->u.blt.gfx_end)
-               gl_blitSpriteInterpolate( gfx, w->outfit->u.blt.gfx_end,
+               gl_batchSpriteInterpolate( gfx, w->outfit->u.blt.gfx_end,
                      w->timer / w->life,
-                     w->solid->pos.x, w->solid->pos.y, w->sx, w->sy, &c );
+                     x, y, w->sx, w->sy, &c );
             else
-               gl_blitSprite( gfx, w->solid->pos.x, w->solid->pos.y, w->sx, w->sy, &c );
+               gl_batchSprite( gfx, x, y, w->sx, w->sy, &c );
          }
          break;
 
@@ -707,6 +796,14 @@ static void weapon_render( Weapon* w, const double dt )
       case OUTFIT_TYPE_TURRET_BEAM:
          gfx = outfit_gfx(w->outfit);
 
+         /* Skip beams that can't reach the camera view. */
+         if (!gl_cameraInView( w->solid->pos.x, w->solid->pos.y,
+               w->outfit->u.bem.range ))
+            break;
+
+         /* Beams draw immediately, flush to keep the layer ordering. */
+         gl_batchFlush();
+
          /* Zoom. */
          gl_cameraZoomGet( &z );
 
@@ -834,7 +931,7 @@ static int weapon_checkCanHit( Weapon* w, Pilot *p )
 
    /* Let hostiles hit player. */
    if (p->faction == FACTION_PLAYER) {
-      parent = pilot_get(w->parent);
+      parent = w->parent_p;
       if (parent != NULL) {
          if (pilot_isFlag(parent, PILOT_BRIBED))
             return 0;
@@ -860,28 +957,69 @@ static int weapon_checkCanHit( Weapon* w, Pilot *p )
  */
 static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
 {
-   int i, psx,psy;
+   int i, n, psx,psy, hit;
    glTexture *gfx;
    Vector2d crash[2];
    Pilot *p;
+   Pilot **pstack;
+   double qx,qy, qr;
+   double bdx,bdy, rx,ry, t, d2;
+   double sweep, sdir;
 
    /* Get the sprite direction to speed up calculations. */
+   gfx = NULL;
+   bdx = bdy = 0.;
+   sweep = 0.;
+   sdir  = 0.;
    if (!outfit_isBeam(w->outfit)) {
       gfx = outfit_gfx(w->outfit);
       gl_getSpriteFromDir( &w->sx, &w->sy, gfx, w->solid->dir );
+
+      /* Query circle is the weapon's own sprite extent. */
+      qx = w->solid->pos.x;
+      qy = w->solid->pos.y;
+      qr = (gfx->sw + gfx->sh)/2.;
+
+      /* Fast bolts can cross a whole fighter in one tick, so they get a
+       * swept collision over the tick's motion instead of a point test. */
+      if (VMOD(w->solid->vel) * dt > qr) {
+         sweep = VMOD(w->solid->vel) * dt;
+         sdir  = VANGLE(w->solid->vel);
+         n = spatial_queryLine( pilot_getGrid(), (void***)&pstack,
+               qx, qy, sdir, sweep );
+      }
+      else /* Broad phase: only consider pilots in neighbouring cells. */
+         n = spatial_query( pilot_getGrid(), (void***)&pstack, qx, qy, qr );
+   }
+   else {
+      /* Beams walk the cells along the beam, so their cost scales with
+       * beam length instead of the pilots in a range-sized circle. */
+      bdx = cos(w->solid->dir);
+      bdy = sin(w->solid->dir);
+      n = spatial_queryLine( pilot_getGrid(), (void***)&pstack,
+            w->solid->pos.x, w->solid->pos.y, w->solid->dir,
+            w->outfit->u.bem.range );
    }
 
-   for (i=0; i<pilot_nstack; i++) {
+   for (i=0; i<n; i++) {
 
-      p = pilot_stack[i];
+      p = pstack[i];
 
-      psx = pilot_stack[i]->tsx;
-      psy = pilot_stack[i]->tsy;
+      psx = p->tsx;
+      psy = p->tsy;
 
-      if (w->parent == pilot_stack[i]->id) continue; /* pilot is self */
+      if (w->parent == p->id) continue; /* pilot is self */
 
       /* Beam weapons have special collisions. */
       if (outfit_isBeam(w->outfit)) {
+         /* Cheap distance-to-beam rejection before the pixel test. */
+         rx = p->solid->pos.x - w->solid->pos.x;
+         ry = p->solid->pos.y - w->solid->pos.y;
+         t  = CLAMP( 0., w->outfit->u.bem.range, rx*bdx + ry*bdy );
+         d2 = pow2( rx - bdx*t ) + pow2( ry - bdy*t );
+         if (d2 > pow2( p->ship->gfx_space->sw ))
+            continue;
+
          /* Check for collision. */
          if (weapon_checkCanHit(w,p) &&
                CollideLineSprite( &w->solid->pos, w->solid->dir,
@@ -897,26 +1035,38 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
       /* smart weapons only collide with their target */
       else if (weapon_isSmart(w)) {
 
-         if ((pilot_stack[i]->id == w->target) &&
+         if ((p->id == w->target) &&
                (w->status != WEAPON_STATUS_OK) && /* Must not be locking on. */
-               weapon_checkCanHit(w,p) &&
-               CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+               weapon_checkCanHit(w,p)) {
+            if (sweep > 0.)
+               hit = CollideLineSprite( &w->solid->pos, sdir, sweep,
                      p->ship->gfx_space, psx, psy,
-                     &p->solid->pos,
-                     &crash[0] )) {
-            weapon_hit( w, p, layer, &crash[0] );
-            return; /* Weapon is destroyed. */
+                     &p->solid->pos, crash );
+            else
+               hit = CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+                     p->ship->gfx_space, psx, psy,
+                     &p->solid->pos, &crash[0] );
+            if (hit) {
+               weapon_hit( w, p, layer, &crash[0] );
+               return; /* Weapon is destroyed. */
+            }
          }
       }
       /* dumb weapons hit anything not of the same faction */
       else {
-         if (weapon_checkCanHit(w,p) &&
-               CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+         if (weapon_checkCanHit(w,p)) {
+            if (sweep > 0.)
+               hit = CollideLineSprite( &w->solid->pos, sdir, sweep,
                      p->ship->gfx_space, psx, psy,
-                     &p->solid->pos,
-                     &crash[0] )) {
-            weapon_hit( w, p, layer, &crash[0] );
-            return; /* Weapon is destroyed. */
+                     &p->solid->pos, crash );
+            else
+               hit = CollideSprite( gfx, w->sx, w->sy, &w->solid->pos,
+                     p->ship->gfx_space, psx, psy,
+                     &p->solid->pos, &crash[0] );
+            if (hit) {
+               weapon_hit( w, p, layer, &crash[0] );
+               return; /* Weapon is destroyed. */
+            }
          }
       }
    }
@@ -925,8 +1075,11 @@ static void weapon_update( Weapon* w, const double dt, WeaponLayer layer )
    if (weapon_isSmart(w))
       (*w->think)(w,dt);
 
-   /* Update the solid position. */
-   (*w->solid->update)(w->solid, dt);
+   /* Update the solid position; distant weapons use cheap integration. */
+   if (gl_cameraInView( w->solid->pos.x, w->solid->pos.y, SOLID_FAR_MARGIN ))
+      (*w->solid->update)(w->solid, dt);
+   else
+      solid_updateFar( w->solid, dt );
 
    /* Update the sound. */
    sound_updatePos(w->voice, w->solid->pos.x, w->solid->pos.y,
@@ -989,7 +1142,7 @@ static void weapon_hit( Weapon* w, Pilot* p, WeaponLayer layer, Vector2d* pos )
    int s;
 
    /* Get general details. */
-   parent = pilot_get(w->parent);
+   parent = w->parent_p;
    damage = w->strength * outfit_damage(w->outfit);
    dtype  = outfit_damageType(w->outfit);
 
@@ -1002,8 +1155,8 @@ static void weapon_hit( Weapon* w, Pilot* p, WeaponLayer layer, Vector2d* pos )
             w->solid->vel.x,
             w->solid->vel.y);
 
-   /* Have pilot take damage and get real damage done. */
-   damage = pilot_hit( p, w->solid, w->parent, dtype, damage );
+   /* Have pilot batch the damage and get the damage that will be done. */
+   damage = pilot_hitBatch( p, w->solid, w->parent, dtype, damage );
 
    /* Get the layer. */
    spfx_layer = (p==player) ? SPFX_LAYER_FRONT : SPFX_LAYER_BACK;
@@ -1044,12 +1197,12 @@ static void weapon_hitBeam( Weapon* w, Pilot* p, WeaponLayer layer,
    WeaponLayer spfx_layer;
 
    /* Get general details. */
-   parent = pilot_get(w->parent);
+   parent = w->parent_p;
    damage = outfit_damage(w->outfit) * dt;
    dtype  = outfit_damageType(w->outfit);
 
-   /* Have pilot take damage and get real damage done. */
-   damage = pilot_hit( p, w->solid, w->parent, dtype, damage );
+   /* Have pilot batch the damage and get the damage that will be done. */
+   damage = pilot_hitBatch( p, w->solid, w->parent, dtype, damage );
 
    /* Add sprite, layer depends on whether player shot or not. */
    if (w->lockon == -1.) {
@@ -1075,6 +1228,52 @@ static void weapon_hitBeam( Weapon* w, Pilot* p, WeaponLayer layer,
 }
 
 
+/**
+ * @brief Allocates a weapon from the slab pool.
+ *
+ *    @return The newly allocated weapon.
+ */
+static Weapon* weapon_alloc (void)
+{
+   int i;
+   WeaponSlot *slab, *slot;
+
+   /* Grow by a slab when the free list runs out. */
+   if (weapon_slotfree == NULL) {
+      slab = malloc( WEAPON_SLAB_SIZE * sizeof(WeaponSlot) );
+      weapon_nslabs++;
+      weapon_slabs = realloc( weapon_slabs, weapon_nslabs * sizeof(WeaponSlot*) );
+      weapon_slabs[ weapon_nslabs-1 ] = slab;
+      nmem_count( MEM_WEAPON, WEAPON_SLAB_SIZE * sizeof(WeaponSlot), +1 );
+
+      /* Chain the slots in reverse so they pop in ascending address order. */
+      for (i=WEAPON_SLAB_SIZE-1; i>=0; i--) {
+         slab[i].next    = weapon_slotfree;
+         weapon_slotfree = &slab[i];
+      }
+   }
+
+   slot = weapon_slotfree;
+   weapon_slotfree = slot->next;
+   return &slot->w;
+}
+
+
+/**
+ * @brief Returns a weapon to the slab pool.
+ *
+ *    @param w Weapon to return.
+ */
+static void weapon_dealloc( Weapon *w )
+{
+   WeaponSlot *slot;
+
+   slot = (WeaponSlot*) w;
+   slot->next = weapon_slotfree;
+   weapon_slotfree = slot;
+}
+
+
 /**
  * @brief Creates a new weapon.
  *
@@ -1097,15 +1296,26 @@ static Weapon* weapon_create( const Outfit* outfit,
    Weapon* w;
 
    /* Create basic features */
-   w = malloc(sizeof(Weapon));
+   w = weapon_alloc();
    memset(w, 0, sizeof(Weapon));
-   w->faction = pilot_get(parent)->faction; /* non-changeable */
+   w->solid = &w->solid_data;
    w->parent = parent; /* non-changeable */
    w->target = target; /* non-changeable */
+   /* Resolve the pilots once - weapons_forgetPilot() clears the cached
+    * pointers when either pilot dies, so no per-frame lookups are needed. */
+   w->parent_p = pilot_get(parent);
+   w->target_p = pilot_get(target);
+   w->faction = w->parent_p->faction; /* non-changeable */
    w->outfit = outfit; /* non-changeable */
    w->update = weapon_update;
    w->status = WEAPON_STATUS_OK;
    w->strength = 1.;
+   if (outfit_isBeam(outfit))
+      w->wclass = WEAPON_CLASS_BEAM;
+   else if (outfit_isBolt(outfit))
+      w->wclass = WEAPON_CLASS_BOLT;
+   else
+      w->wclass = WEAPON_CLASS_SEEKER;
 
    switch (outfit->type) {
 
@@ -1116,7 +1326,7 @@ static Weapon* weapon_create( const Outfit* outfit,
          if ((outfit->type == OUTFIT_TYPE_TURRET_BOLT) && (w->parent!=w->target) &&
                (w->target != 0)) { /* Must have valid target */
 
-            pilot_target = pilot_get(w->target);
+            pilot_target = w->target_p;
             if (pilot_target == NULL)
                rdir = dir;
 
@@ -1159,7 +1369,7 @@ static Weapon* weapon_create( const Outfit* outfit,
          vect_cadd( &v, outfit->u.blt.speed*cos(rdir), outfit->u.blt.speed*sin(rdir));
          w->timer = outfit->u.blt.range / outfit->u.blt.speed;
          w->falloff = w->timer - outfit->u.blt.falloff / outfit->u.blt.speed;
-         w->solid = solid_create( mass, rdir, pos, &v );
+         solid_init( &w->solid_data, mass, rdir, pos, &v );
          w->voice = sound_playPos( w->outfit->u.blt.sound,
                w->solid->pos.x,
                w->solid->pos.y,
@@ -1171,7 +1381,7 @@ static Weapon* weapon_create( const Outfit* outfit,
       case OUTFIT_TYPE_BEAM:
       case OUTFIT_TYPE_TURRET_BEAM:
          if ((outfit->type == OUTFIT_TYPE_TURRET_BEAM) && (w->parent!=w->target)) {
-            pilot_target = pilot_get(target);
+            pilot_target = w->target_p;
             rdir = (pilot_target == NULL) ? dir :
                   vect_angle(pos, &pilot_target->solid->pos);
          }
@@ -1182,7 +1392,7 @@ static Weapon* weapon_create( const Outfit* outfit,
          else if (rdir >= 2.*M_PI)
             rdir -= 2.*M_PI;
          mass = 1.; /**< Needs a mass. */
-         w->solid = solid_create( mass, rdir, pos, NULL );
+         solid_init( &w->solid_data, mass, rdir, pos, NULL );
          w->think = think_beam;
          w->timer = outfit->u.bem.duration;
          w->voice = sound_playPos( w->outfit->u.bem.sound,
@@ -1196,7 +1406,7 @@ static Weapon* weapon_create( const Outfit* outfit,
       case OUTFIT_TYPE_AMMO:
       case OUTFIT_TYPE_TURRET_AMMO:
          if (w->outfit->type == OUTFIT_TYPE_TURRET_AMMO) {
-            pilot_target = pilot_get(w->target);
+            pilot_target = w->target_p;
             if (pilot_target == NULL)
                rdir = dir;
 
@@ -1245,7 +1455,7 @@ static Weapon* weapon_create( const Outfit* outfit,
          mass        = w->outfit->mass;
          w->lockon   = outfit->u.amm.lockon;
          w->timer    = outfit->u.amm.duration;
-         w->solid    = solid_create( mass, rdir, pos, &v );
+         solid_init( &w->solid_data, mass, rdir, pos, &v );
          if (w->outfit->u.amm.thrust != 0.)
             weapon_setThrust( w, w->outfit->u.amm.thrust * mass );
 
@@ -1254,7 +1464,7 @@ static Weapon* weapon_create( const Outfit* outfit,
             w->think = think_seeker; /* AI is the same atm. */
 
             /* If they are seeking a pilot, increment lockon counter. */
-            pilot_target = pilot_get(target);
+            pilot_target = w->target_p;
             if (pilot_target != NULL)
                pilot_target->lockons++;
          }
@@ -1271,7 +1481,7 @@ static Weapon* weapon_create( const Outfit* outfit,
       default:
          WARN("Weapon of type '%s' has no create implemented yet!",
                w->outfit->name);
-         w->solid = solid_create( 1., dir, pos, vel );
+         solid_init( &w->solid_data, 1., dir, pos, vel );
          break;
    }
 
@@ -1298,8 +1508,7 @@ void weapon_add( const Outfit* outfit, const double dir,
 {
    WeaponLayer layer;
    Weapon *w;
-   Weapon **curLayer;
-   int *mLayer, *nLayer;
+   Weapon ***lp;
    GLsizei size;
 
    if (!outfit_isBolt(outfit) &&
@@ -1311,40 +1520,26 @@ void weapon_add( const Outfit* outfit, const double dir,
    layer = (parent==PLAYER_ID) ? WEAPON_LAYER_FG : WEAPON_LAYER_BG;
    w = weapon_create( outfit, dir, pos, vel, parent, target );
 
+   weapon_layersInit();
+
    /* set the proper layer */
    switch (layer) {
       case WEAPON_LAYER_BG:
-         curLayer = wbackLayer;
-         nLayer = &nwbackLayer;
-         mLayer = &mwbacklayer;
+         lp = &wbackLayer;
          break;
       case WEAPON_LAYER_FG:
-         curLayer = wfrontLayer;
-         nLayer = &nwfrontLayer;
-         mLayer = &mwfrontLayer;
+         lp = &wfrontLayer;
          break;
 
       default:
          WARN("Unknown weapon layer!");
+         return;
    }
+   array_grow( lp ) = w;
 
-   if (*mLayer > *nLayer) /* more memory alloced than needed */
-      curLayer[(*nLayer)++] = w;
-   else { /* need to allocate more memory */
-      switch (layer) {
-         case WEAPON_LAYER_BG:
-            (*mLayer) += WEAPON_CHUNK;
-            curLayer = wbackLayer = realloc(curLayer, (*mLayer)*sizeof(Weapon*));
-            break;
-         case WEAPON_LAYER_FG:
-            (*mLayer) += WEAPON_CHUNK;
-            curLayer = wfrontLayer = realloc(curLayer, (*mLayer)*sizeof(Weapon*));
-            break;
-      }
-      curLayer[(*nLayer)++] = w;
-
-      /* Grow the vertex stuff. */
-      weapon_vboSize = mwfrontLayer + mwbacklayer;
+   /* Grow the vertex stuff if the layers got reallocated. */
+   if (weapon_vboSize < array_reserved(wbackLayer) + array_reserved(wfrontLayer)) {
+      weapon_vboSize = array_reserved(wbackLayer) + array_reserved(wfrontLayer);
       size = sizeof(GLfloat) * (2+4) * weapon_vboSize;
       weapon_vboData = realloc( weapon_vboData, size );
       if (weapon_vbo == NULL)
@@ -1374,8 +1569,7 @@ int beam_start( const Outfit* outfit,
 {
    WeaponLayer layer;
    Weapon *w;
-   Weapon **curLayer;
-   int *mLayer, *nLayer;
+   Weapon ***lp;
    GLsizei size;
 
    if (!outfit_isBeam(outfit)) {
@@ -1388,41 +1582,26 @@ int beam_start( const Outfit* outfit,
    w->ID = ++beam_idgen;
    w->mount = mount;
 
+   weapon_layersInit();
+
    /* set the proper layer */
    switch (layer) {
       case WEAPON_LAYER_BG:
-         curLayer = wbackLayer;
-         nLayer = &nwbackLayer;
-         mLayer = &mwbacklayer;
+         lp = &wbackLayer;
          break;
       case WEAPON_LAYER_FG:
-         curLayer = wfrontLayer;
-         nLayer = &nwfrontLayer;
-         mLayer = &mwfrontLayer;
+         lp = &wfrontLayer;
          break;
 
       default:
          ERR("Invalid WEAPON_LAYER specified");
          return -1;
    }
+   array_grow( lp ) = w;
 
-   if (*mLayer > *nLayer) /* more memory alloced than needed */
-      curLayer[(*nLayer)++] = w;
-   else { /* need to allocate more memory */
-      switch (layer) {
-         case WEAPON_LAYER_BG:
-            (*mLayer) += WEAPON_CHUNK;
-            curLayer = wbackLayer = realloc(curLayer, (*mLayer)*sizeof(Weapon*));
-            break;
-         case WEAPON_LAYER_FG:
-            (*mLayer) += WEAPON_CHUNK;
-            curLayer = wfrontLayer = realloc(curLayer, (*mLayer)*sizeof(Weapon*));
-            break;
-      }
-      curLayer[(*nLayer)++] = w;
-
-      /* Grow the vertex stuff. */
-      weapon_vboSize = mwfrontLayer + mwbacklayer;
+   /* Grow the vertex stuff if the layers got reallocated. */
+   if (weapon_vboSize < array_reserved(wbackLayer) + array_reserved(wfrontLayer)) {
+      weapon_vboSize = array_reserved(wbackLayer) + array_reserved(wfrontLayer);
       size = sizeof(GLfloat) * (2+4) * weapon_vboSize;
       weapon_vboData = realloc( weapon_vboData, size );
       if (weapon_vbo == NULL)
@@ -1441,24 +1620,21 @@ int beam_start( const Outfit* outfit,
  */
 void beam_end( const unsigned int parent, int beam )
 {
-   int i;
+   int i, n;
    WeaponLayer layer;
    Weapon **curLayer;
-   int *mLayer, *nLayer;
 
    layer = (parent==PLAYER_ID) ? WEAPON_LAYER_FG : WEAPON_LAYER_BG;
 
+   weapon_layersInit();
+
    /* set the proper layer */
    switch (layer) {
       case WEAPON_LAYER_BG:
          curLayer = wbackLayer;
-         nLayer = &nwbackLayer;
-         mLayer = &mwbacklayer;
          break;
       case WEAPON_LAYER_FG:
          curLayer = wfrontLayer;
-         nLayer = &nwfrontLayer;
-         mLayer = &mwfrontLayer;
          break;
 
       default:
@@ -1468,7 +1644,8 @@ void beam_end( const unsigned int parent, int beam )
 
 
    /* Now try to destroy the beam. */
-   for (i=0; i<*nLayer; i++) {
+   n = array_size(curLayer);
+   for (i=0; i<n; i++) {
       if (curLayer[i]->ID == beam) { /* Found it. */
          weapon_destroy(curLayer[i], layer);
          break;
@@ -1492,7 +1669,7 @@ static void weapon_destroy( Weapon* w, WeaponLayer layer )
 
    /* Decrement target lockons if needed */
    if (outfit_isSeeker(w->outfit)) {
-      pilot_target = pilot_get( w->target );
+      pilot_target = w->target_p;
       if (pilot_target != NULL)
          pilot_target->lockons--;
    }
@@ -1510,15 +1687,16 @@ static void weapon_destroy( Weapon* w, WeaponLayer layer )
    switch (layer) {
       case WEAPON_LAYER_BG:
          wlayer = wbackLayer;
-         nlayer = &nwbackLayer;
+         nlayer = &array_size(wbackLayer);
          break;
       case WEAPON_LAYER_FG:
          wlayer = wfrontLayer;
-         nlayer = &nwfrontLayer;
+         nlayer = &array_size(wfrontLayer);
          break;
 
       default:
          WARN("Unknown weapon layer!");
+         return;
    }
 
    for (i=0; (wlayer[i] != w) && (i < *nlayer); i++); /* get to the curent position */
@@ -1528,11 +1706,11 @@ static void weapon_destroy( Weapon* w, WeaponLayer layer )
    }
 
    weapon_free(wlayer[i]);
-   wlayer[i] = NULL;
    (*nlayer)--;
 
-   for ( ; i < (*nlayer); i++)
-      wlayer[i] = wlayer[i+1];
+   /* Swap the last weapon into the hole, order within a layer is not
+    * significant and this avoids shifting the whole array. */
+   wlayer[i] = wlayer[ *nlayer ];
 }
 
 
@@ -1543,13 +1721,43 @@ static void weapon_destroy( Weapon* w, WeaponLayer layer )
  */
 static void weapon_free( Weapon* w )
 {
-   solid_free(w->solid);
-
 #ifdef DEBUGGING
    memset(w, 0, sizeof(Weapon));
 #endif /* DEBUGGING */
 
-   free(w);
+   weapon_dealloc(w);
+}
+
+/**
+ * @brief Clears all cached references to a pilot that is getting freed.
+ *
+ * Weapons keep resolved Pilot pointers instead of calling pilot_get()
+ *  every frame, so the pilot code must notify them here before the
+ *  pilot's memory goes away.
+ *
+ *    @param p Pilot about to be freed.
+ */
+void weapons_forgetPilot( const Pilot *p )
+{
+   int i, n;
+
+   if (wbackLayer == NULL)
+      return;
+
+   n = array_size(wbackLayer);
+   for (i=0; i < n; i++) {
+      if (wbackLayer[i]->parent_p == p)
+         wbackLayer[i]->parent_p = NULL;
+      if (wbackLayer[i]->target_p == p)
+         wbackLayer[i]->target_p = NULL;
+   }
+   n = array_size(wfrontLayer);
+   for (i=0; i < n; i++) {
+      if (wfrontLayer[i]->parent_p == p)
+         wfrontLayer[i]->parent_p = NULL;
+      if (wfrontLayer[i]->target_p == p)
+         wfrontLayer[i]->target_p = NULL;
+   }
 }
 
 /**
@@ -1557,18 +1765,24 @@ static void weapon_free( Weapon* w )
  */
 void weapon_clear (void)
 {
-   int i;
+   int i, n;
+
+   if (wbackLayer == NULL)
+      return;
+
    /* Don't forget to stop the sounds. */
-   for (i=0; i < nwbackLayer; i++) {
+   n = array_size(wbackLayer);
+   for (i=0; i < n; i++) {
       sound_stop(wbackLayer[i]->voice);
       weapon_free(wbackLayer[i]);
    }
-   nwbackLayer = 0;
-   for (i=0; i < nwfrontLayer; i++) {
+   array_clear(wbackLayer);
+   n = array_size(wfrontLayer);
+   for (i=0; i < n; i++) {
       sound_stop(wfrontLayer[i]->voice);
       weapon_free(wfrontLayer[i]);
    }
-   nwfrontLayer = 0;
+   array_clear(wfrontLayer);
 }
 
 /**
@@ -1576,20 +1790,16 @@ void weapon_clear (void)
  */
 void weapon_exit (void)
 {
+   int i;
+
    weapon_clear();
 
-   /* Destroy front layer. */
+   /* Destroy the layers. */
    if (wbackLayer != NULL) {
-      free(wbackLayer);
+      array_free(wbackLayer);
       wbackLayer  = NULL;
-      mwbacklayer = 0;
-   }
-
-   /* Destroy back layer. */
-   if (wfrontLayer != NULL) {
-      free(wfrontLayer);
-      wfrontLayer  = NULL;
-      mwfrontLayer = 0;
+      array_free(wfrontLayer);
+      wfrontLayer = NULL;
    }
 
    /* Destroy VBO. */
@@ -1599,6 +1809,16 @@ void weapon_exit (void)
       gl_vboDestroy( weapon_vbo );
       weapon_vbo = NULL;
    }
+
+   /* Release the allocation slabs themselves. */
+   for (i=0; i < weapon_nslabs; i++) {
+      free(weapon_slabs[i]);
+      nmem_count( MEM_WEAPON, -(long)(WEAPON_SLAB_SIZE * sizeof(WeaponSlot)), -1 );
+   }
+   free(weapon_slabs);
+   weapon_slabs    = NULL;
+   weapon_nslabs   = 0;
+   weapon_slotfree = NULL;
 }
 
 
@@ -1626,15 +1846,18 @@ static void weapon_explodeLayer( WeaponLayer layer,
    int *nLayer;
    double dist, rad2;
 
+   if (wbackLayer == NULL)
+      return;
+
    /* set the proper layer */
    switch (layer) {
       case WEAPON_LAYER_BG:
          curLayer = wbackLayer;
-         nLayer = &nwbackLayer;
+         nLayer = &array_size(wbackLayer);
          break;
       case WEAPON_LAYER_FG:
          curLayer = wfrontLayer;
-         nLayer = &nwfrontLayer;
+         nLayer = &array_size(wfrontLayer);
          break;
 
       default:
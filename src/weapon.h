@@ -46,6 +46,7 @@ void weapon_explode( double x, double y, double radius,
       DamageType dtype, double damage,
       unsigned int parent, int mode );
 void weapon_toggleSafety (void);
+void weapons_forgetPilot( const Pilot *p );
 
 
 /*
@@ -0,0 +1,248 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+/**
+ * @file main.c
+ *
+ * @brief Standalone microbenchmark for the collision and physics kernels.
+ *
+ * Built with "make bench" from the repository root.  Runs CollideSprite(),
+ *  CollideLineSprite() and the solid integrators over deterministic
+ *  pseudo-random workloads shaped like real play (mixed hit/miss sprite
+ *  pairs, beam sweeps, far-from-camera integration) and reports ns per
+ *  call.  With a stored baseline it prints the delta of every kernel:
+ *
+ *    ./bench        run, comparing against bench.baseline if present
+ *    ./bench -s     run and (re)write bench.baseline
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "naev.h"
+#include "physics.h"
+#include "collision.h"
+#include "opengl.h"
+
+
+#define TEX_SIZE     64    /**< Width and height of the test sprites. */
+#define N_PAIRS      4096  /**< Precomputed sprite pair positions. */
+#define N_SOLIDS     4096  /**< Solids to integrate. */
+#define SPRITE_REPS  64    /**< Passes over the sprite pairs. */
+#define SOLID_REPS   600   /**< Integration steps (ten simulated seconds). */
+
+#define BASELINE_FILE "bench.baseline" /**< Where -s stores the results. */
+
+
+double sim_interp = 0.; /**< physics.o needs it (render interpolation). */
+
+static unsigned int bench_seed = 2531011; /**< Deterministic LCG state. */
+
+
+/**
+ * @brief Deterministic random double in [0,1).
+ */
+static double brandf (void)
+{
+   bench_seed = bench_seed*1664525u + 1013904223u;
+   return (double)bench_seed / 4294967296.;
+}
+
+
+/**
+ * @brief Gets the current time in microseconds.
+ */
+static long bench_time (void)
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return (long)tv.tv_sec * 1000000L + (long)tv.tv_usec;
+}
+
+
+/**
+ * @brief Builds a synthetic sprite with a filled disc transparency map.
+ *
+ * A disc is about the shape of a ship sprite: opaque core, transparent
+ *  corners, so the block map rejects some tiles and accepts others.
+ */
+static void tex_init( glTexture *t, const char *name, int w, int h )
+{
+   int x,y, i, size;
+   double cx,cy, r2;
+
+   memset( t, 0, sizeof(glTexture) );
+   t->name = strdup(name);
+   t->w  = (double)w;
+   t->h  = (double)h;
+   t->sx = 1;
+   t->sy = 1;
+   t->sw = t->w;
+   t->sh = t->h;
+
+   size = w*h/8 + ((w*h%8)?1:0);
+   t->trans = calloc( 1, size );
+   cx = (double)w/2.;
+   cy = (double)h/2.;
+   r2 = pow2( (double)w * 0.45 );
+   for (y=0; y<h; y++)
+      for (x=0; x<w; x++)
+         if (pow2((double)x-cx) + pow2((double)y-cy) < r2) {
+            i = y*w + x;
+            t->trans[ i/8 ] |= (1 << (i%8));
+         }
+   t->btrans = gl_transBlocks( t->trans, w, h, &t->bw );
+}
+
+
+/**
+ * @brief Reports a result and compares it against the baseline.
+ *
+ *    @param name Kernel name.
+ *    @param ns Nanoseconds per call measured.
+ *    @param save File to append the result to or NULL.
+ *    @param base Baseline file content or NULL.
+ */
+static void bench_report( const char *name, double ns, FILE *save,
+      const char *base )
+{
+   const char *p;
+   double bns;
+   char buf[64];
+
+   if (save != NULL)
+      fprintf( save, "%s %f\n", name, ns );
+
+   /* Find the kernel in the baseline dump. */
+   bns = 0.;
+   if (base != NULL) {
+      snprintf( buf, sizeof(buf), "%s ", name );
+      p = strstr( base, buf );
+      if (p != NULL)
+         bns = atof( p + strlen(buf) );
+   }
+
+   if (bns > 0.)
+      printf( "   %-16s %10.1f ns/call   baseline %10.1f   %+6.1f%%\n",
+            name, ns, bns, 100.*(ns-bns)/bns );
+   else
+      printf( "   %-16s %10.1f ns/call\n", name, ns );
+}
+
+
+int main( int argc, char *argv[] )
+{
+   int i, r, hits;
+   long t0, calls;
+   double ns, ad, al;
+   glTexture ta, tb;
+   Vector2d pa, pb, crash[2];
+   Vector2d *pos;
+   Solid *solids;
+   FILE *save;
+   char *base;
+   long len;
+
+   /* Optionally load the baseline and open the save file. */
+   save = NULL;
+   base = NULL;
+   if ((argc > 1) && (strcmp( argv[1], "-s" ) == 0)) {
+      save = fopen( BASELINE_FILE, "w" );
+      if (save == NULL)
+         fprintf( stderr, "Unable to open '%s' for writing!\n", BASELINE_FILE );
+   }
+   else {
+      FILE *f = fopen( BASELINE_FILE, "r" );
+      if (f != NULL) {
+         fseek( f, 0, SEEK_END );
+         len = ftell( f );
+         fseek( f, 0, SEEK_SET );
+         base = malloc( len+1 );
+         if (fread( base, 1, len, f ) != (size_t)len)
+            base[0] = '\0';
+         else
+            base[len] = '\0';
+         fclose(f);
+      }
+   }
+
+   tex_init( &ta, "bench_a", TEX_SIZE, TEX_SIZE );
+   tex_init( &tb, "bench_b", TEX_SIZE, TEX_SIZE );
+
+   /* Sprite pair offsets: spread past the sprite size so the mix covers
+    * bounding box rejects, block map rejects and actual hits. */
+   pos = malloc( N_PAIRS * sizeof(Vector2d) );
+   for (i=0; i<N_PAIRS; i++)
+      vect_cset( &pos[i], (brandf()-0.5)*3.*TEX_SIZE,
+            (brandf()-0.5)*3.*TEX_SIZE );
+   vectnull( &pa );
+
+   printf( "Collision and physics kernels (%d sprite pairs, %d solids):\n",
+         N_PAIRS, N_SOLIDS );
+
+   /* CollideSprite. */
+   hits  = 0;
+   calls = (long)N_PAIRS * SPRITE_REPS;
+   t0 = bench_time();
+   for (r=0; r<SPRITE_REPS; r++)
+      for (i=0; i<N_PAIRS; i++)
+         hits += CollideSprite( &ta, 0, 0, &pa, &tb, 0, 0, &pos[i], &crash[0] );
+   ns = 1000. * (double)(bench_time() - t0) / (double)calls;
+   bench_report( "CollideSprite", ns, save, base );
+
+   /* CollideLineSprite: beams from outside sweeping over the sprite. */
+   hits  = 0;
+   calls = (long)N_PAIRS * SPRITE_REPS;
+   vect_cset( &pb, -2.*TEX_SIZE, 0. );
+   al = 4.*TEX_SIZE;
+   t0 = bench_time();
+   for (r=0; r<SPRITE_REPS; r++)
+      for (i=0; i<N_PAIRS; i++) {
+         ad = atan2( pos[i].y - pb.y, pos[i].x - pb.x ) +
+               (brandf()-0.5) * 0.5;
+         hits += CollideLineSprite( &pb, ad, al, &ta, 0, 0, &pos[i], crash );
+      }
+   ns = 1000. * (double)(bench_time() - t0) / (double)calls;
+   bench_report( "CollideLineSprite", ns, save, base );
+
+   /* Solid integration, the RK4 path pilots use on screen. */
+   solids = malloc( N_SOLIDS * sizeof(Solid) );
+   for (i=0; i<N_SOLIDS; i++) {
+      vect_cset( &pa, brandf()*1000., brandf()*1000. );
+      vect_cset( &pb, (brandf()-0.5)*200., (brandf()-0.5)*200. );
+      solid_init( &solids[i], 100.+brandf()*1000., brandf()*2.*M_PI,
+            &pa, &pb );
+      solids[i].force_x = brandf()*300.;
+      solids[i].dir_vel = (brandf()-0.5)*2.;
+   }
+   calls = (long)N_SOLIDS * SOLID_REPS;
+   t0 = bench_time();
+   for (r=0; r<SOLID_REPS; r++)
+      for (i=0; i<N_SOLIDS; i++)
+         solids[i].update( &solids[i], 1./60. );
+   ns = 1000. * (double)(bench_time() - t0) / (double)calls;
+   bench_report( "solid_update", ns, save, base );
+
+   /* Far integrator used off screen. */
+   t0 = bench_time();
+   for (r=0; r<SOLID_REPS; r++)
+      for (i=0; i<N_SOLIDS; i++)
+         solid_updateFar( &solids[i], 1./60. );
+   ns = 1000. * (double)(bench_time() - t0) / (double)calls;
+   bench_report( "solid_updateFar", ns, save, base );
+
+   if (save != NULL) {
+      fclose(save);
+      printf( "Baseline written to %s.\n", BASELINE_FILE );
+   }
+   if (base != NULL)
+      free(base);
+   free(pos);
+   free(solids);
+
+   return hits & 0; /* Keeps the kernels from being optimized out. */
+}